@@ -0,0 +1,343 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <AsyncLog.h>
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Counts the messages without keeping them, to measure the logging alone.
+    class CountingSink : public AsyncLog::Sink
+    {
+    public:
+        void Write(const AsyncLog::Message&) override
+        {
+            m_messageCount++;
+        }
+
+        uint64_t m_messageCount = 0;
+    };
+
+    // Keeps the messages.
+    class CapturingSink : public AsyncLog::Sink
+    {
+    public:
+        struct CapturedMessage
+        {
+            int64_t time;
+            uint32_t threadId;
+            std::string text;
+            std::string line;
+        };
+
+        void Write(const AsyncLog::Message& message) override
+        {
+            m_messages.push_back({message.time, message.threadId, std::string(message.text), std::string(message.line)});
+        }
+
+        std::vector<CapturedMessage> m_messages;
+    };
+
+    std::filesystem::path GetTemporaryPath(const char* name)
+    {
+        std::error_code error;
+        return std::filesystem::temp_directory_path(error) / (std::string("SampleBenchmarks-") + name + ".log");
+    }
+
+    std::string ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    // Logging a message with a number, a float and a string from the render loop. The messages are formatted outside of the
+    // timing every 4096 messages, as the background thread formats far fewer messages than a loop of nothing but logging writes.
+    void BM_AsyncLogWrite(benchmark::State& state)
+    {
+        auto sink = std::make_shared<CountingSink>();
+        AsyncLog::Settings settings;
+        settings.bytesPerThread = 1 << 20;
+        settings.flushInterval = std::chrono::hours(1);
+        AsyncLog::Start({sink}, settings);
+
+        uint32_t frame = 0;
+        for (auto _ : state)
+        {
+            AsyncLog::Write("Frame %u took %.2f ms in %s", frame++, 11.1, "Render");
+            if (frame % 4096 == 0)
+            {
+                state.PauseTiming();
+                AsyncLog::Flush();
+                state.ResumeTiming();
+            }
+        }
+
+        AsyncLog::Stop();
+        state.counters["dropped"] = static_cast<double>(state.iterations() - sink->m_messageCount);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // What DebugLog costs the calling thread before writing to the debugger: formatting into a stack buffer.
+    void BM_AsyncLogFormatOnCaller(benchmark::State& state)
+    {
+        uint32_t frame = 0;
+        for (auto _ : state)
+        {
+            char buffer[1024];
+            benchmark::DoNotOptimize(std::snprintf(buffer, sizeof(buffer), "Frame %u took %.2f ms in %s", frame++, 11.1, "Render"));
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // The formatting the background thread does per message.
+    void BM_AsyncLogFormat(benchmark::State& state)
+    {
+        std::string text;
+        uint32_t frame = 0;
+        for (auto _ : state)
+        {
+            text.clear();
+            AsyncLog::Format(text, "Frame %u took %.2f ms in %s", frame++, 11.1, "Render");
+            benchmark::DoNotOptimize(text.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_AsyncLogRotatingFileSink(benchmark::State& state)
+    {
+        const std::filesystem::path path = GetTemporaryPath("rotating");
+        const std::string line = "[12-34-56.123456] (t:1a2b): Frame 1234 took 11.10 ms in Render\n";
+        const AsyncLog::Message message{0, 0x1a2b, std::string_view(line).substr(28, line.size() - 29), line};
+        {
+            AsyncLog::RotatingFileSink sink(path, 1 << 20, 2);
+            for (auto _ : state)
+            {
+                sink.Write(message);
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        std::filesystem::remove(std::filesystem::path(path) += ".1", error);
+        state.SetBytesProcessed(state.iterations() * line.size());
+    }
+
+    struct FormatCase
+    {
+        std::string actual;
+        const char* expected;
+    };
+
+    template <typename... Args>
+    FormatCase MakeFormatCase(const char* expected, const char* format, const Args&... args)
+    {
+        FormatCase formatCase{{}, expected};
+        AsyncLog::Format(formatCase.actual, format, args...);
+        return formatCase;
+    }
+
+    // Checks the formatting, that messages of several threads arrive complete and in order, both overflow policies, and the
+    // rotation of the log files.
+    void BM_AsyncLogChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            enum class Color : uint8_t
+            {
+                Red = 3
+            };
+            const std::string string = "string";
+            const wchar_t wideArray[] = L"array";
+
+            const FormatCase formatCases[] = {
+                MakeFormatCase("-5 3.14 +7", "%d %.2f %+d", -5, 3.14159, int8_t(7)),
+                MakeFormatCase("ffffffff 0000BEEF 377", "%x %08X %o", -1, 0xbeefu, uint16_t(255)),
+                MakeFormatCase("-9000000000 18446744073709551615", "%lld %I64u", int64_t(-9'000'000'000), UINT64_MAX),
+                MakeFormatCase("[abc] [ab    ] [abc] [    ab]", "[%s] [%-6s] [%.3s] [%*s]", "abc", "ab", "abcdef", 6, "ab"),
+                MakeFormatCase("string wide array \xc3\xa9\xf0\x9f\x98\x80", "%s %ls %ws %s", string, L"wide", wideArray, L"é\U0001F600"),
+                MakeFormatCase("x 100% 3 1", "%c 100%% %d %s", 'x', Color::Red, true),
+                MakeFormatCase("1 %d", "%d %d", 1),
+                MakeFormatCase("(null) 12 1.5e+03", "%s %s %.1e", static_cast<const char*>(nullptr), 12, 1500.0f),
+            };
+            for (const FormatCase& formatCase : formatCases)
+            {
+                if (formatCase.actual != formatCase.expected)
+                {
+                    state.SkipWithError(("unexpected formatting: " + formatCase.actual).c_str());
+                    return;
+                }
+            }
+
+            // Messages of several threads through small rings, waiting when a ring is full.
+            {
+                constexpr int ThreadCount = 4;
+                constexpr int MessageCount = 2000;
+
+                auto sink = std::make_shared<CapturingSink>();
+                AsyncLog::Settings settings;
+                settings.bytesPerThread = 4096;
+                settings.overflowPolicy = AsyncLog::OverflowPolicy::Block;
+                settings.flushInterval = std::chrono::milliseconds(1);
+                AsyncLog::Start({sink}, settings);
+
+                std::vector<std::thread> threads;
+                for (int t = 0; t < ThreadCount; ++t)
+                {
+                    threads.emplace_back([t]() {
+                        for (int i = 0; i < MessageCount; ++i)
+                        {
+                            AsyncLog::Write("Thread %d message %d of %s\n", t, i, "the check");
+                        }
+                    });
+                }
+                for (std::thread& thread : threads)
+                {
+                    thread.join();
+                }
+                AsyncLog::Stop();
+
+                std::map<int, int> nextMessage;
+                for (const CapturingSink::CapturedMessage& message : sink->m_messages)
+                {
+                    int thread = -1;
+                    int index = -1;
+                    if (std::sscanf(message.text.c_str(), "Thread %d message %d of the check", &thread, &index) != 2 ||
+                        index != nextMessage[thread]++ || message.line.front() != '[' ||
+                        message.line.find("): " + message.text + "\n") == std::string::npos)
+                    {
+                        state.SkipWithError(("unexpected message: " + message.line).c_str());
+                        return;
+                    }
+                }
+                if (sink->m_messages.size() != size_t(ThreadCount) * MessageCount)
+                {
+                    state.SkipWithError("messages lost while blocking");
+                    return;
+                }
+            }
+
+            // Messages logged before a flush are written in the order of their time, across threads.
+            {
+                auto sink = std::make_shared<CapturingSink>();
+                AsyncLog::Settings settings;
+                settings.flushInterval = std::chrono::hours(1);
+                AsyncLog::Start({sink}, settings);
+
+                std::vector<std::thread> threads;
+                for (int t = 0; t < 3; ++t)
+                {
+                    threads.emplace_back([]() {
+                        for (int i = 0; i < 100; ++i)
+                        {
+                            AsyncLog::Write("Message %d", i);
+                        }
+                    });
+                }
+                for (std::thread& thread : threads)
+                {
+                    thread.join();
+                }
+                AsyncLog::Flush();
+
+                bool ordered = sink->m_messages.size() == 300;
+                for (size_t i = 1; ordered && i < sink->m_messages.size(); ++i)
+                {
+                    ordered = sink->m_messages[i - 1].time <= sink->m_messages[i].time;
+                }
+                AsyncLog::Stop();
+                if (!ordered)
+                {
+                    state.SkipWithError("messages not merged by time");
+                    return;
+                }
+            }
+
+            // A ring which is not drained keeps what fits and drops the rest, and the number of dropped messages is logged.
+            {
+                auto sink = std::make_shared<CapturingSink>();
+                AsyncLog::Settings settings;
+                settings.bytesPerThread = 1024;
+                settings.flushInterval = std::chrono::hours(1);
+                AsyncLog::Start({sink}, settings);
+                std::thread([]() {
+                    for (int i = 0; i < 200; ++i)
+                    {
+                        AsyncLog::Write("Overflow %d", i);
+                    }
+                }).join();
+                AsyncLog::Stop();
+
+                unsigned long long dropped = 0;
+                for (const CapturingSink::CapturedMessage& message : sink->m_messages)
+                {
+                    std::sscanf(message.text.c_str(), "Dropped %llu messages", &dropped);
+                }
+                if (sink->m_messages.size() < 2 || dropped == 0 || sink->m_messages.size() - 1 + dropped != 200)
+                {
+                    state.SkipWithError("full ring not handled");
+                    return;
+                }
+            }
+
+            // The rotating file sink keeps the newest lines in its files.
+            {
+                const std::filesystem::path path = GetTemporaryPath("rotation");
+                const auto numbered = [&path](int i) { return std::filesystem::path(path) += "." + std::to_string(i); };
+                std::string lines;
+                {
+                    AsyncLog::RotatingFileSink sink(path, 4096, 3);
+                    for (int i = 0; i < 300; ++i)
+                    {
+                        char line[64];
+                        const int length = std::snprintf(line, sizeof(line), "Line %03d of the rotating file sink check.......\n", i);
+                        lines.append(line, length);
+                        sink.Write({0, 0, std::string_view(line, length - 1), std::string_view(line, length)});
+                    }
+                }
+
+                const std::string content = ReadFile(numbered(2)) + ReadFile(numbered(1)) + ReadFile(path);
+                const bool rotated = std::filesystem::exists(numbered(2)) && !std::filesystem::exists(numbered(3)) &&
+                                     std::filesystem::file_size(path) <= 4096 && !content.empty() && content.size() < lines.size() &&
+                                     lines.ends_with(content);
+                std::error_code error;
+                std::filesystem::remove(path, error);
+                std::filesystem::remove(numbered(1), error);
+                std::filesystem::remove(numbered(2), error);
+                if (!rotated)
+                {
+                    state.SkipWithError("log files not rotated");
+                    return;
+                }
+            }
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_AsyncLogWrite);
+BENCHMARK(BM_AsyncLogFormatOnCaller);
+BENCHMARK(BM_AsyncLogFormat);
+BENCHMARK(BM_AsyncLogRotatingFileSink);
+BENCHMARK(BM_AsyncLogChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,515 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Entry point of the benchmarks. Besides the google-benchmark flags, it accepts
+//
+//   --baseline=<file>             JSON results of an earlier run (--benchmark_out=<file> --benchmark_out_format=json) to
+//                                 compare this run with.
+//   --baseline_threshold=<pct>    Slowdown in percent above which a benchmark counts as regressed, 10 by default.
+//
+// With a baseline, the times of this run are compared with the baseline per benchmark after the run, and the process exits
+// with 1 if any benchmark regressed beyond the threshold. Iterations and median aggregates are compared by CPU time, or by
+// real time for benchmarks measured in real time. Of repeated runs, the fastest counts.
+//
+// With or without a baseline, the process exits with 1 if a benchmark reported an error, which is how the BM_*Checks
+// benchmarks report a failed check.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    // Time per iteration in nanoseconds, by benchmark name.
+    using Timings = std::map<std::string, double>;
+
+    void AddTiming(Timings& timings, const std::string& name, double nanoseconds)
+    {
+        auto [it, inserted] = timings.try_emplace(name, nanoseconds);
+        if (!inserted)
+        {
+            it->second = std::min(it->second, nanoseconds);
+        }
+    }
+
+    // Parses just enough JSON to read the results written by the JSON reporter of google-benchmark: the objects of the
+    // "benchmarks" array with their string, number and boolean members. Other values are skipped.
+    class BaselineParser
+    {
+    public:
+        explicit BaselineParser(std::string_view json)
+            : m_json(json)
+        {
+        }
+
+        bool Parse(Timings& timings)
+        {
+            if (!Consume('{'))
+            {
+                return false;
+            }
+            if (Consume('}'))
+            {
+                return true;
+            }
+
+            do
+            {
+                std::string key;
+                if (!ParseString(key) || !Consume(':'))
+                {
+                    return false;
+                }
+
+                if (key == "benchmarks")
+                {
+                    if (!ParseBenchmarks(timings))
+                    {
+                        return false;
+                    }
+                }
+                else if (!SkipValue())
+                {
+                    return false;
+                }
+            } while (Consume(','));
+
+            return Consume('}');
+        }
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            std::string runType;
+            std::string aggregateName;
+            std::string timeUnit = "ns";
+            double realTime = 0;
+            double cpuTime = 0;
+            bool error = false;
+        };
+
+        bool ParseBenchmarks(Timings& timings)
+        {
+            if (!Consume('['))
+            {
+                return false;
+            }
+            if (Consume(']'))
+            {
+                return true;
+            }
+
+            do
+            {
+                Entry entry;
+                if (!ParseEntry(entry))
+                {
+                    return false;
+                }
+
+                const bool compared = entry.runType == "iteration" || (entry.runType == "aggregate" && entry.aggregateName == "median");
+                if (compared && !entry.error)
+                {
+                    const bool realTime = entry.name.find("/real_time") != std::string::npos ||
+                                          entry.name.find("/manual_time") != std::string::npos;
+                    const double time = realTime ? entry.realTime : entry.cpuTime;
+                    AddTiming(timings, entry.name, time * NanosecondsPerUnit(entry.timeUnit));
+                }
+            } while (Consume(','));
+
+            return Consume(']');
+        }
+
+        bool ParseEntry(Entry& entry)
+        {
+            if (!Consume('{'))
+            {
+                return false;
+            }
+            if (Consume('}'))
+            {
+                return true;
+            }
+
+            do
+            {
+                std::string key;
+                if (!ParseString(key) || !Consume(':'))
+                {
+                    return false;
+                }
+
+                bool ok;
+                if (key == "name")
+                {
+                    ok = ParseString(entry.name);
+                }
+                else if (key == "run_type")
+                {
+                    ok = ParseString(entry.runType);
+                }
+                else if (key == "aggregate_name")
+                {
+                    ok = ParseString(entry.aggregateName);
+                }
+                else if (key == "time_unit")
+                {
+                    ok = ParseString(entry.timeUnit);
+                }
+                else if (key == "real_time")
+                {
+                    ok = ParseNumber(entry.realTime);
+                }
+                else if (key == "cpu_time")
+                {
+                    ok = ParseNumber(entry.cpuTime);
+                }
+                else if (key == "error_occurred")
+                {
+                    SkipWhitespace();
+                    entry.error = m_json.substr(m_offset, 4) == "true";
+                    ok = SkipValue();
+                }
+                else
+                {
+                    ok = SkipValue();
+                }
+
+                if (!ok)
+                {
+                    return false;
+                }
+            } while (Consume(','));
+
+            return Consume('}');
+        }
+
+        static double NanosecondsPerUnit(const std::string& unit)
+        {
+            if (unit == "us")
+            {
+                return 1e3;
+            }
+            if (unit == "ms")
+            {
+                return 1e6;
+            }
+            if (unit == "s")
+            {
+                return 1e9;
+            }
+            return 1;
+        }
+
+        void SkipWhitespace()
+        {
+            while (m_offset < m_json.size() && std::isspace(static_cast<unsigned char>(m_json[m_offset])))
+            {
+                m_offset++;
+            }
+        }
+
+        bool Consume(char c)
+        {
+            SkipWhitespace();
+            if (m_offset < m_json.size() && m_json[m_offset] == c)
+            {
+                m_offset++;
+                return true;
+            }
+            return false;
+        }
+
+        // Benchmark names are plain ASCII, escapes other than \uXXXX are unescaped, \uXXXX is kept as is.
+        bool ParseString(std::string& value)
+        {
+            if (!Consume('"'))
+            {
+                return false;
+            }
+
+            value.clear();
+            while (m_offset < m_json.size())
+            {
+                const char c = m_json[m_offset++];
+                if (c == '"')
+                {
+                    return true;
+                }
+                if (c == '\\')
+                {
+                    if (m_offset == m_json.size())
+                    {
+                        return false;
+                    }
+                    const char escaped = m_json[m_offset++];
+                    switch (escaped)
+                    {
+                        case 'n':
+                            value += '\n';
+                            break;
+                        case 't':
+                            value += '\t';
+                            break;
+                        case 'r':
+                            value += '\r';
+                            break;
+                        case 'b':
+                            value += '\b';
+                            break;
+                        case 'f':
+                            value += '\f';
+                            break;
+                        case 'u':
+                            value += "\\u";
+                            break;
+                        default:
+                            value += escaped;
+                            break;
+                    }
+                }
+                else
+                {
+                    value += c;
+                }
+            }
+            return false;
+        }
+
+        bool ParseNumber(double& value)
+        {
+            SkipWhitespace();
+            const std::string number(m_json.substr(m_offset, std::min<size_t>(64, m_json.size() - m_offset)));
+            char* end = nullptr;
+            value = std::strtod(number.c_str(), &end);
+            if (end == number.c_str())
+            {
+                return false;
+            }
+            m_offset += end - number.c_str();
+            return true;
+        }
+
+        bool SkipValue()
+        {
+            SkipWhitespace();
+            if (m_offset == m_json.size())
+            {
+                return false;
+            }
+
+            const char c = m_json[m_offset];
+            if (c == '"')
+            {
+                std::string ignored;
+                return ParseString(ignored);
+            }
+            if (c == '{' || c == '[')
+            {
+                const char close = c == '{' ? '}' : ']';
+                m_offset++;
+                if (Consume(close))
+                {
+                    return true;
+                }
+                do
+                {
+                    if (c == '{')
+                    {
+                        std::string key;
+                        if (!ParseString(key) || !Consume(':'))
+                        {
+                            return false;
+                        }
+                    }
+                    if (!SkipValue())
+                    {
+                        return false;
+                    }
+                } while (Consume(','));
+                return Consume(close);
+            }
+
+            // Number, true, false or null.
+            const size_t start = m_offset;
+            while (m_offset < m_json.size() && m_json[m_offset] != ',' && m_json[m_offset] != '}' && m_json[m_offset] != ']' &&
+                   !std::isspace(static_cast<unsigned char>(m_json[m_offset])))
+            {
+                m_offset++;
+            }
+            return m_offset > start;
+        }
+
+        std::string_view m_json;
+        size_t m_offset = 0;
+    };
+
+    bool ReadBaseline(const std::string& path, Timings& timings)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+
+        std::stringstream json;
+        json << file.rdbuf();
+        return BaselineParser(json.str()).Parse(timings);
+    }
+
+    // Console output as usual, while collecting the times of the runs to compare them with the baseline and the runs which
+    // reported an error.
+    class CollectingReporter : public benchmark::ConsoleReporter
+    {
+    public:
+        CollectingReporter()
+            : ConsoleReporter(OO_None)
+        {
+        }
+
+        void ReportRuns(const std::vector<Run>& reports) override
+        {
+            for (const Run& run : reports)
+            {
+                if (run.error_occurred)
+                {
+                    m_failedRuns.push_back(run.benchmark_name() + ": " + run.error_message);
+                }
+
+                const bool compared =
+                    run.run_type == Run::RT_Iteration || (run.run_type == Run::RT_Aggregate && run.aggregate_name == "median");
+                if (compared && !run.error_occurred)
+                {
+                    const double time = run.run_name.time_type.empty() ? run.GetAdjustedCPUTime() : run.GetAdjustedRealTime();
+                    AddTiming(m_timings, run.benchmark_name(), time * 1e9 / benchmark::GetTimeUnitMultiplier(run.time_unit));
+                }
+            }
+
+            ConsoleReporter::ReportRuns(reports);
+        }
+
+        const Timings& GetTimings() const
+        {
+            return m_timings;
+        }
+
+        const std::vector<std::string>& GetFailedRuns() const
+        {
+            return m_failedRuns;
+        }
+
+    private:
+        Timings m_timings;
+        std::vector<std::string> m_failedRuns;
+    };
+
+    // Prints the runs which reported an error and returns their number.
+    size_t ReportFailedRuns(const std::vector<std::string>& failedRuns)
+    {
+        if (!failedRuns.empty())
+        {
+            std::printf("\n%zu benchmarks reported an error:\n", failedRuns.size());
+            for (const std::string& failedRun : failedRuns)
+            {
+                std::printf("  %s\n", failedRun.c_str());
+            }
+        }
+        return failedRuns.size();
+    }
+
+    // Prints the comparison and returns the number of regressions.
+    size_t CompareWithBaseline(const Timings& baseline, const Timings& current, double thresholdPercent)
+    {
+        size_t regressions = 0;
+        size_t missing = 0;
+
+        std::printf("\nComparison with the baseline (regression threshold %.1f%%):\n", thresholdPercent);
+        std::printf("%-60s %14s %14s %9s\n", "Benchmark", "Baseline ns", "Current ns", "Change");
+        for (const auto& [name, time] : current)
+        {
+            const auto it = baseline.find(name);
+            if (it == baseline.end())
+            {
+                missing++;
+                continue;
+            }
+
+            const double change = it->second > 0 ? (time / it->second - 1.0) * 100.0 : 0.0;
+            const bool regressed = change > thresholdPercent;
+            regressions += regressed ? 1 : 0;
+            std::printf("%-60s %14.1f %14.1f %+8.1f%%%s\n", name.c_str(), it->second, time, change, regressed ? "  REGRESSION" : "");
+        }
+
+        if (missing > 0)
+        {
+            std::printf("%zu benchmarks are not in the baseline.\n", missing);
+        }
+        std::printf("%zu of %zu compared benchmarks regressed.\n", regressions, current.size() - missing);
+        return regressions;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // Take out the baseline flags, google-benchmark rejects flags it does not know.
+    std::string baselinePath;
+    double thresholdPercent = 10.0;
+    int remaining = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg.starts_with("--baseline="))
+        {
+            baselinePath = arg.substr(std::strlen("--baseline="));
+        }
+        else if (arg.starts_with("--baseline_threshold="))
+        {
+            thresholdPercent = std::atof(argv[i] + std::strlen("--baseline_threshold="));
+        }
+        else
+        {
+            argv[remaining++] = argv[i];
+        }
+    }
+    argc = remaining;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    Timings baseline;
+    if (!baselinePath.empty() && !ReadBaseline(baselinePath, baseline))
+    {
+        std::fprintf(stderr, "Could not read the baseline %s\n", baselinePath.c_str());
+        return 1;
+    }
+
+    CollectingReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    const size_t regressions = baselinePath.empty() ? 0 : CompareWithBaseline(baseline, reporter.GetTimings(), thresholdPercent);
+    const size_t failedRuns = ReportFailedRuns(reporter.GetFailedRuns());
+    return regressions > 0 || failedRuns > 0 ? 1 : 0;
+}
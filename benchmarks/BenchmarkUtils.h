@@ -0,0 +1,99 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <holographic/FrustumCullingBatch.h>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace BenchmarkUtils
+{
+    // Frustum of a camera at the origin looking down -Z with a 90 degree field of view, a near plane at 0.1 m and a far plane
+    // at 20 m. The plane order matches FrustumCulling::TryGetFrustumPlanes (bottom, far, left, near, right, top).
+    inline FrustumCulling::FrustumPlanes MakeCameraFrustum()
+    {
+        const float c = std::sqrt(0.5f);
+        const float planes[FrustumCulling::FrustumPlanes::PlaneCount][4] = {
+            {0.0f, -c, c, 0.0f},
+            {0.0f, 0.0f, -1.0f, -20.0f},
+            {-c, 0.0f, c, 0.0f},
+            {0.0f, 0.0f, 1.0f, 0.1f},
+            {c, 0.0f, c, 0.0f},
+            {0.0f, c, c, 0.0f}};
+
+        FrustumCulling::FrustumPlanes result;
+        for (size_t i = 0; i < FrustumCulling::FrustumPlanes::PlaneCount; ++i)
+        {
+            result.normalX[i] = planes[i][0];
+            result.normalY[i] = planes[i][1];
+            result.normalZ[i] = planes[i][2];
+            result.d[i] = planes[i][3];
+        }
+        return result;
+    }
+
+    // Surface mesh in the format delivered by SpatialSurfaceMesh: int16 normalized positions (x, y, z, w) and uint16 indices.
+    struct SurfaceMesh
+    {
+        std::vector<int16_t> positions;
+        std::vector<uint16_t> indices;
+        float scale[3] = {2.0f, 2.0f, 2.0f};
+
+        uint32_t VertexCount() const
+        {
+            return static_cast<uint32_t>(positions.size() / 4);
+        }
+    };
+
+    // A wall with a corner, scanned as a grid of gridSize x gridSize vertices with a few millimeters of sensor noise, which is
+    // what the surface observer delivers for most parts of a room.
+    inline SurfaceMesh MakeSurfaceMesh(uint32_t gridSize)
+    {
+        std::mt19937 random(5);
+        std::normal_distribution<float> noise(0.0f, 0.002f);
+
+        SurfaceMesh mesh;
+        mesh.positions.reserve(size_t(gridSize) * gridSize * 4);
+        for (uint32_t y = 0; y < gridSize; ++y)
+        {
+            for (uint32_t x = 0; x < gridSize; ++x)
+            {
+                // positions in meters within [-scale, scale], folded into two perpendicular walls at x = 0
+                const float u = 3.6f * x / (gridSize - 1) - 1.8f;
+                const float v = 3.6f * y / (gridSize - 1) - 1.8f;
+                const float position[3] = {u < 0.0f ? u : 0.0f, v, (u < 0.0f ? 0.0f : -u) + noise(random)};
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    mesh.positions.push_back(static_cast<int16_t>(std::lround(position[axis] / mesh.scale[axis] * 32767.0f)));
+                }
+                mesh.positions.push_back(32767);
+            }
+        }
+
+        mesh.indices.reserve(size_t(gridSize - 1) * (gridSize - 1) * 6);
+        for (uint32_t y = 0; y + 1 < gridSize; ++y)
+        {
+            for (uint32_t x = 0; x + 1 < gridSize; ++x)
+            {
+                const uint16_t i = static_cast<uint16_t>(y * gridSize + x);
+                const uint16_t right = static_cast<uint16_t>(i + 1);
+                const uint16_t up = static_cast<uint16_t>(i + gridSize);
+                const uint16_t upRight = static_cast<uint16_t>(up + 1);
+                mesh.indices.insert(mesh.indices.end(), {i, up, right, right, up, upRight});
+            }
+        }
+        return mesh;
+    }
+} // namespace BenchmarkUtils
@@ -0,0 +1,435 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <BitrateController.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace
+{
+    // Link capacity over time, one value in kbps per second.
+    using CapacityTrace = std::vector<uint32_t>;
+
+    constexpr uint32_t TraceSeconds = 120;
+
+    CapacityTrace MakeConstantTrace()
+    {
+        return CapacityTrace(TraceSeconds, 30000);
+    }
+
+    // Good link which drops to a fraction of its capacity for 40s, e.g. while another device streams on the same access point.
+    CapacityTrace MakeStepTrace()
+    {
+        CapacityTrace trace(TraceSeconds, 30000);
+        std::fill(trace.begin() + 40, trace.begin() + 80, 8000);
+        return trace;
+    }
+
+    // Wi-Fi link whose capacity wanders between 6 and 35 Mbps, with short drops to 4 Mbps. Uses its own generator, so that the
+    // trace is the same with every standard library.
+    CapacityTrace MakeWifiTrace()
+    {
+        uint32_t state = 12345;
+        auto random = [&state]() {
+            state = state * 1664525u + 1013904223u;
+            return double(state >> 8) / double(1u << 24);
+        };
+
+        CapacityTrace trace(TraceSeconds);
+        double capacity = 20000.0;
+        for (uint32_t second = 0; second < TraceSeconds; ++second)
+        {
+            capacity = std::clamp(capacity + (random() - 0.5) * 6000.0, 6000.0, 35000.0);
+            trace[second] = static_cast<uint32_t>(capacity);
+            if (random() < 0.015)
+            {
+                const uint32_t dropEnd = std::min(second + 3, TraceSeconds);
+                for (; second < dropEnd; ++second)
+                {
+                    trace[second] = 4000;
+                }
+                second--;
+            }
+        }
+        return trace;
+    }
+
+    struct SimulationResult
+    {
+        std::vector<BitrateWindowStatistics> windows;
+        std::vector<uint32_t> targets;
+        uint64_t frameCount = 0;
+        uint64_t lostFrameCount = 0;
+        double deliveredKbits = 0.0;
+        double capacityKbits = 0.0;
+        double latencySum = 0.0;
+    };
+
+    // Replays a capacity trace through a simulated video stream: the encoder produces 60 frames per second at the target
+    // bitrate, the frames queue up in front of the link, and the player counts them into one BitrateWindowStatistics per second,
+    // which the controller turns into the target of the next second. Without a controller the bitrate is fixed at the initial
+    // target, as today. Frames which arrive more than DiscardDelayMs late are discarded, frames which the encoder would add to a
+    // queue of more than SkipDelayMs are never sent (skipped).
+    SimulationResult Simulate(const CapacityTrace& trace, BitrateController* controller, uint32_t fixedKbps = 20000)
+    {
+        constexpr uint32_t FrameRate = 60;
+        constexpr double BaseLatencyMs = 40.0;
+        constexpr double DiscardDelayMs = 150.0;
+        constexpr double SkipDelayMs = 400.0;
+
+        struct QueuedFrame
+        {
+            uint32_t emitTimeMs;
+            double remainingKbits;
+            double kbits;
+        };
+
+        SimulationResult result;
+        std::deque<QueuedFrame> queue;
+        double queuedKbits = 0.0;
+        uint32_t targetKbps = controller ? controller->GetTargetKbps() : fixedKbps;
+        uint32_t frameIndex = 0;
+        uint32_t lastArrivalMs = 0;
+
+        for (uint32_t second = 0; second < trace.size(); ++second)
+        {
+            BitrateWindowStatistics window;
+            double windowLatencySum = 0.0;
+            const double capacityKbitsPerMs = trace[second] / 1000.0;
+            result.capacityKbits += trace[second];
+
+            for (uint32_t ms = second * 1000; ms < (second + 1) * 1000; ++ms)
+            {
+                // Emit a frame every 1/60s, with a key frame of four times the average size once per second.
+                if ((ms * FrameRate) / 1000 != ((ms + 1) * FrameRate) / 1000)
+                {
+                    const double averageKbits = double(targetKbps) / FrameRate;
+                    const double kbits =
+                        (frameIndex++ % FrameRate == 0) ? averageKbits * 4.0 : averageKbits * (FrameRate - 4.0) / (FrameRate - 1.0);
+                    if (queuedKbits / capacityKbitsPerMs > SkipDelayMs)
+                    {
+                        window.framesSkipped++;
+                    }
+                    else
+                    {
+                        queue.push_back({ms, kbits, kbits});
+                        queuedKbits += kbits;
+                    }
+                }
+
+                // Drain the link.
+                double credit = capacityKbitsPerMs;
+                while (!queue.empty() && credit > 0.0)
+                {
+                    QueuedFrame& frame = queue.front();
+                    const double sent = std::min(credit, frame.remainingKbits);
+                    frame.remainingKbits -= sent;
+                    queuedKbits -= sent;
+                    credit -= sent;
+                    if (frame.remainingKbits > 0.0)
+                    {
+                        break;
+                    }
+
+                    const double delayMs = double(ms + 1 - frame.emitTimeMs);
+                    window.framesReceived++;
+                    window.frameMaxDelta = std::max(window.frameMaxDelta, (ms + 1 - lastArrivalMs) / 1000.0f);
+                    lastArrivalMs = ms + 1;
+                    windowLatencySum += (BaseLatencyMs + delayMs) / 1000.0;
+                    if (delayMs > DiscardDelayMs)
+                    {
+                        window.framesDiscarded++;
+                    }
+                    else
+                    {
+                        result.deliveredKbits += frame.kbits;
+                    }
+                    queue.pop_front();
+                }
+            }
+
+            // A stall which lasts until the end of the window counts into this window.
+            window.frameMaxDelta = std::max(window.frameMaxDelta, ((second + 1) * 1000 - lastArrivalMs) / 1000.0f);
+            window.latencyAvg = window.framesReceived > 0 ? float(windowLatencySum / window.framesReceived) : 0.0f;
+
+            result.frameCount += window.framesReceived + window.framesSkipped;
+            result.lostFrameCount += window.framesSkipped + window.framesDiscarded;
+            result.latencySum += windowLatencySum;
+            result.windows.push_back(window);
+
+            // The encoder picks up the new target right away. This is the best case, a remote which applies the target when it
+            // reconnects follows the same targets later.
+            if (controller)
+            {
+                targetKbps = controller->Update(window).targetKbps;
+            }
+            result.targets.push_back(targetKbps);
+        }
+        return result;
+    }
+
+    double LossRatio(const SimulationResult& result)
+    {
+        return result.frameCount > 0 ? double(result.lostFrameCount) / double(result.frameCount) : 0.0;
+    }
+
+    double Utilization(const SimulationResult& result)
+    {
+        return result.deliveredKbits / result.capacityKbits;
+    }
+
+    BitrateWindowStatistics CleanWindow(float latency = 0.05f)
+    {
+        return {60, 0, 0, 0.02f, latency};
+    }
+
+    const char* CheckBitrateControllerRules()
+    {
+        BitrateControllerSettings settings;
+
+        // clean windows grow the target quickly until the first congestion, then hold at the maximum
+        {
+            BitrateController controller(settings);
+            uint32_t previousKbps = controller.GetTargetKbps();
+            for (int i = 0; i < 3; ++i)
+            {
+                const BitrateUpdate update = controller.Update(CleanWindow());
+                if (update.decision != BitrateDecision::Increase || update.targetKbps <= previousKbps)
+                {
+                    return "clean windows should increase the target";
+                }
+                previousKbps = update.targetKbps;
+            }
+            for (int i = 0; i < 10; ++i)
+            {
+                controller.Update(CleanWindow());
+            }
+            if (controller.GetTargetKbps() != settings.maxKbps || controller.Update(CleanWindow()).decision != BitrateDecision::Hold)
+            {
+                return "target should hold at the maximum";
+            }
+        }
+
+        // each congestion signal cuts the target multiplicatively, and the next window is held
+        {
+            const BitrateWindowStatistics congested[] = {
+                {60, 3, 0, 0.05f, 0.05f}, {60, 0, 2, 0.05f, 0.05f}, {60, 0, 0, 0.3f, 0.05f}, {60, 0, 0, 0.02f, 0.2f}};
+            const BitrateDecision expected[] = {
+                BitrateDecision::DecreaseLoss,
+                BitrateDecision::DecreaseLoss,
+                BitrateDecision::DecreaseStall,
+                BitrateDecision::DecreaseLatency};
+            for (size_t i = 0; i < std::size(congested); ++i)
+            {
+                BitrateController controller(settings);
+                controller.Update(CleanWindow());
+                // Frame loss cuts deeper, down to the share of the frames which arrived.
+                const BitrateWindowStatistics& window = congested[i];
+                const double lossRatio =
+                    double(window.framesSkipped + window.framesDiscarded) / double(window.framesReceived + window.framesSkipped);
+                const double factor = settings.decreaseFactor * std::min(1.0, 1.0 - lossRatio + settings.maxFrameLossRatio);
+                const uint32_t beforeKbps = controller.GetTargetKbps();
+                const BitrateUpdate update = controller.Update(window);
+                if (update.decision != expected[i] || update.targetKbps != uint32_t(std::lround(beforeKbps * factor)))
+                {
+                    return "congestion should decrease the target multiplicatively";
+                }
+                if (controller.Update(congested[i]).decision != BitrateDecision::Hold)
+                {
+                    return "window after a decrease should hold";
+                }
+                if (controller.Update(congested[i]).decision != expected[i])
+                {
+                    return "congestion after the hold window should decrease again";
+                }
+            }
+        }
+
+        // after a congestion, the target grows additively, and slower around the congested target
+        {
+            BitrateController controller(settings);
+            controller.Update(CleanWindow());
+            const uint32_t congestedKbps = controller.GetTargetKbps();
+            controller.Update({60, 10, 0, 0.05f, 0.05f});
+            controller.Update(CleanWindow());
+            uint32_t previousKbps = controller.GetTargetKbps();
+            uint32_t fastSteps = 0;
+            uint32_t slowSteps = 0;
+            for (int i = 0; i < 15; ++i)
+            {
+                const uint32_t targetKbps = controller.Update(CleanWindow()).targetKbps;
+                fastSteps += (targetKbps - previousKbps == settings.increaseKbps) ? 1 : 0;
+                slowSteps += (targetKbps - previousKbps == settings.increaseKbps / 4) ? 1 : 0;
+                const bool nearCongestedKbps =
+                    previousKbps + settings.increaseKbps > congestedKbps && previousKbps < congestedKbps + settings.increaseKbps;
+                if (targetKbps - previousKbps == settings.increaseKbps && nearCongestedKbps)
+                {
+                    return "target should grow slowly around the congested target";
+                }
+                previousKbps = targetKbps;
+            }
+            if (fastSteps == 0 || slowSteps == 0)
+            {
+                return "target should grow additively after a congestion";
+            }
+        }
+
+        // latency is compared with the minimum of the recent windows, windows without video change nothing, the target stays
+        // within its bounds
+        {
+            BitrateController controller(settings);
+            controller.Update(CleanWindow(0.05f));
+            controller.Update(CleanWindow(0.07f));
+            if (controller.Update(CleanWindow(0.075f)).decision != BitrateDecision::Increase)
+            {
+                return "slowly rising latency within the margin should not decrease the target";
+            }
+            if (controller.Update(CleanWindow(0.09f)).decision != BitrateDecision::DecreaseLatency)
+            {
+                return "latency above the margin over the recent minimum should decrease the target";
+            }
+
+            const uint32_t targetKbps = controller.GetTargetKbps();
+            if (controller.Update({}).decision != BitrateDecision::Hold || controller.GetTargetKbps() != targetKbps)
+            {
+                return "window without video should hold the target";
+            }
+
+            for (int i = 0; i < 30; ++i)
+            {
+                controller.Update({30, 30, 0, 0.5f, 0.0f});
+            }
+            if (controller.GetTargetKbps() != settings.minKbps)
+            {
+                return "target should not drop below the minimum";
+            }
+        }
+        return nullptr;
+    }
+
+    const char* CheckBitrateControllerSimulation()
+    {
+        // The controller is a pure function of the windows: replaying the windows of a run gives the same targets.
+        for (const CapacityTrace& trace : {MakeConstantTrace(), MakeStepTrace(), MakeWifiTrace()})
+        {
+            BitrateController controller;
+            const SimulationResult result = Simulate(trace, &controller);
+
+            controller.Reset();
+            for (size_t i = 0; i < result.windows.size(); ++i)
+            {
+                if (controller.Update(result.windows[i]).targetKbps != result.targets[i])
+                {
+                    return "replayed windows should give the same targets";
+                }
+            }
+
+            const SimulationResult fixed = Simulate(trace, nullptr);
+            if (LossRatio(result) > std::max(0.01, LossRatio(fixed) / 3.0))
+            {
+                return "controlled bitrate should lose far fewer frames than the fixed bitrate";
+            }
+            if (result.deliveredKbits < 0.9 * fixed.deliveredKbits)
+            {
+                return "controlled bitrate should deliver at least about as much as the fixed bitrate";
+            }
+        }
+
+        // A good link carries more than the fixed bitrate.
+        {
+            BitrateController controller;
+            const SimulationResult result = Simulate(MakeConstantTrace(), &controller);
+            if (Utilization(result) < 0.75 || Utilization(result) <= 1.15 * Utilization(Simulate(MakeConstantTrace(), nullptr)))
+            {
+                return "controller should use the headroom of a good link";
+            }
+        }
+
+        // A congested link loses much less video than with the fixed bitrate, and the target follows the drop within a few
+        // seconds.
+        {
+            BitrateController controller;
+            const CapacityTrace trace = MakeStepTrace();
+            const SimulationResult result = Simulate(trace, &controller);
+            if (LossRatio(result) * 5.0 > LossRatio(Simulate(trace, nullptr)))
+            {
+                return "controller should avoid the frame loss of a congested link";
+            }
+            if (result.targets[45] > 8000)
+            {
+                return "target should follow a capacity drop within 5 windows";
+            }
+            if (*std::max_element(result.targets.begin() + 100, result.targets.end()) < 27000)
+            {
+                return "target should recover within 20 windows after the capacity returned";
+            }
+        }
+        return nullptr;
+    }
+
+    void BM_BitrateControllerChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckBitrateControllerRules())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+            if (const char* error = CheckBitrateControllerSimulation())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Arguments: capacity trace (0 constant, 1 step, 2 Wi-Fi), controlled (1) or fixed 20 Mbps (0).
+    void BM_BitrateControllerSimulation(benchmark::State& state)
+    {
+        const CapacityTrace traces[] = {MakeConstantTrace(), MakeStepTrace(), MakeWifiTrace()};
+        const CapacityTrace& trace = traces[state.range(0)];
+        SimulationResult result;
+        for (auto _ : state)
+        {
+            BitrateController controller;
+            result = Simulate(trace, state.range(1) != 0 ? &controller : nullptr);
+        }
+
+        state.counters["Utilization"] = Utilization(result);
+        state.counters["LossPct"] = 100.0 * LossRatio(result);
+        state.counters["DeliveredMbps"] = result.deliveredKbits / 1000.0 / double(trace.size());
+        state.counters["LatencyAvgMs"] = result.frameCount > 0 ? 1000.0 * result.latencySum / double(result.frameCount) : 0.0;
+    }
+
+    // Cost of one controller update, the work the player adds per statistics window.
+    void BM_BitrateControllerUpdate(benchmark::State& state)
+    {
+        BitrateController controller;
+        const SimulationResult result = Simulate(MakeWifiTrace(), &controller);
+        size_t index = 0;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(controller.Update(result.windows[index]));
+            index = (index + 1) % result.windows.size();
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_BitrateControllerChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BitrateControllerSimulation)->ArgsProduct({{0, 1, 2}, {0, 1}})->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BitrateControllerUpdate);
@@ -0,0 +1,278 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "BenchmarkUtils.h"
+
+#include <holographic/BoundingVolumeHierarchy.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace BenchmarkUtils;
+using namespace FrustumCulling;
+
+namespace
+{
+    // Surface mesh parts of a room around the camera. The spatial mapping volume is split into cells of roughly one cubic
+    // meter, and the parts are jittered and sized like the walls, floor and furniture pieces observed in a furnished room.
+    std::vector<BoundingBox> MakeRoomParts(size_t count)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> position(-12.0f, 12.0f);
+        std::uniform_real_distribution<float> height(-1.5f, 1.5f);
+        std::uniform_real_distribution<float> size(0.2f, 1.2f);
+
+        std::vector<BoundingBox> parts(count);
+        for (auto& part : parts)
+        {
+            const float center[3] = {position(random), height(random), position(random)};
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const float extent = 0.5f * size(random);
+                part.min[axis] = center[axis] - extent;
+                part.max[axis] = center[axis] + extent;
+            }
+        }
+        return parts;
+    }
+
+    // Parts which all share the same center, so that every split of the build has equal keys.
+    std::vector<BoundingBox> MakeStackedParts(size_t count)
+    {
+        std::vector<BoundingBox> parts(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float extent = 0.1f + 0.01f * static_cast<float>(i % 7);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                parts[i].min[axis] = (axis == 2 ? -3.0f : 0.5f) - extent;
+                parts[i].max[axis] = (axis == 2 ? -3.0f : 0.5f) + extent;
+            }
+        }
+        return parts;
+    }
+
+    // Empty boxes (points) on a line through the side planes of the frustum, half of them inside.
+    std::vector<BoundingBox> MakePointParts(size_t count)
+    {
+        std::vector<BoundingBox> parts(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float x = -10.0f + 20.0f * static_cast<float>(i) / static_cast<float>(std::max<size_t>(count, 2) - 1);
+            parts[i].min[0] = parts[i].max[0] = x;
+            parts[i].min[2] = parts[i].max[2] = -5.0f;
+        }
+        return parts;
+    }
+
+    // The camera frustum turned to look down +X instead of -Z.
+    FrustumPlanes MakeTurnedCameraFrustum()
+    {
+        FrustumPlanes planes = MakeCameraFrustum();
+        for (size_t i = 0; i < FrustumPlanes::PlaneCount; ++i)
+        {
+            const float x = planes.normalX[i];
+            planes.normalX[i] = -planes.normalZ[i];
+            planes.normalZ[i] = x;
+        }
+        return planes;
+    }
+
+    std::vector<uint32_t> QueryBruteForce(const FrustumPlanes& planes, const std::vector<BoundingBox>& parts)
+    {
+        std::vector<uint32_t> visible;
+        for (uint32_t i = 0; i < parts.size(); ++i)
+        {
+            if (BoxInFrustum(planes, parts[i]))
+            {
+                visible.push_back(i);
+            }
+        }
+        return visible;
+    }
+
+    // Returns an empty string if the hierarchy finds exactly the parts which the brute force loop finds, for both frustums.
+    std::string CheckQuery(const BoundingVolumeHierarchy& hierarchy, const std::vector<BoundingBox>& parts)
+    {
+        if (hierarchy.GetLeafCount() != parts.size())
+        {
+            return "wrong leaf count";
+        }
+        for (uint32_t i = 0; i < parts.size(); ++i)
+        {
+            if (hierarchy.GetLeafBox(i) != parts[i])
+            {
+                return "leaf box not updated";
+            }
+        }
+
+        for (const FrustumPlanes& planes : {MakeCameraFrustum(), MakeTurnedCameraFrustum()})
+        {
+            std::vector<uint32_t> visible;
+            hierarchy.Query(planes, visible);
+            std::sort(visible.begin(), visible.end());
+            if (std::adjacent_find(visible.begin(), visible.end()) != visible.end())
+            {
+                return "part reported twice";
+            }
+            if (visible != QueryBruteForce(planes, parts))
+            {
+                return "visible parts differ from the brute force loop";
+            }
+        }
+        return {};
+    }
+
+    // Checks the query results against the brute force loop after building and after refitting, for parts spread over a room,
+    // parts stacked on one center and empty boxes, at sizes from an empty hierarchy to more than a room holds.
+    void BM_SurfacePartsHierarchyChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            using MakeParts = std::vector<BoundingBox> (*)(size_t);
+            const std::pair<const char*, MakeParts> layouts[] = {
+                {"room", MakeRoomParts}, {"stacked", MakeStackedParts}, {"points", MakePointParts}};
+
+            std::mt19937 random(11);
+            std::uniform_real_distribution<float> move(-4.0f, 4.0f);
+            std::uniform_real_distribution<float> grow(0.0f, 2.0f);
+            BoundingVolumeHierarchy hierarchy;
+            for (const auto& [name, makeParts] : layouts)
+            {
+                for (size_t count : {0, 1, 2, 3, 17, 100, 2000})
+                {
+                    std::vector<BoundingBox> parts = makeParts(count);
+                    hierarchy.Build(parts.data(), static_cast<uint32_t>(parts.size()));
+                    std::string error = CheckQuery(hierarchy, parts);
+
+                    // Refit with small moves, as every frame does, then with moves across the frustum planes and growing boxes,
+                    // leaving some parts unchanged.
+                    for (int round = 0; error.empty() && round < 4; ++round)
+                    {
+                        for (uint32_t i = 0; i < parts.size(); ++i)
+                        {
+                            if (i % 5 == static_cast<uint32_t>(round))
+                            {
+                                continue;
+                            }
+
+                            BoundingBox& part = parts[i];
+                            for (int axis = 0; axis < 3; ++axis)
+                            {
+                                const float offset = round == 0 ? 0.001f : move(random);
+                                part.min[axis] += offset - (round == 3 ? grow(random) : 0.0f);
+                                part.max[axis] += offset;
+                            }
+                            hierarchy.Refit(i, part);
+                        }
+                        error = CheckQuery(hierarchy, parts);
+                    }
+
+                    if (!error.empty())
+                    {
+                        state.SkipWithError((error + " for " + std::to_string(count) + " " + name + " parts").c_str());
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    // Testing every part against the frustum, which is what a flat loop over m_meshParts would do.
+    void BM_SurfacePartsBruteForce(benchmark::State& state)
+    {
+        const FrustumPlanes planes = MakeCameraFrustum();
+        const std::vector<BoundingBox> parts = MakeRoomParts(static_cast<size_t>(state.range(0)));
+        std::vector<uint32_t> visible;
+        visible.reserve(parts.size());
+
+        for (auto _ : state)
+        {
+            visible.clear();
+            for (uint32_t i = 0; i < parts.size(); ++i)
+            {
+                if (BoxInFrustum(planes, parts[i]))
+                {
+                    visible.push_back(i);
+                }
+            }
+            benchmark::DoNotOptimize(visible.data());
+        }
+        state.counters["visible"] = static_cast<double>(visible.size());
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_SurfacePartsHierarchyQuery(benchmark::State& state)
+    {
+        const FrustumPlanes planes = MakeCameraFrustum();
+        const std::vector<BoundingBox> parts = MakeRoomParts(static_cast<size_t>(state.range(0)));
+        BoundingVolumeHierarchy hierarchy;
+        hierarchy.Build(parts.data(), static_cast<uint32_t>(parts.size()));
+
+        std::vector<uint32_t> visible;
+        visible.reserve(parts.size());
+
+        for (auto _ : state)
+        {
+            visible.clear();
+            hierarchy.Query(planes, visible);
+            benchmark::DoNotOptimize(visible.data());
+        }
+        state.counters["visible"] = static_cast<double>(visible.size());
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_SurfacePartsHierarchyBuild(benchmark::State& state)
+    {
+        const std::vector<BoundingBox> parts = MakeRoomParts(static_cast<size_t>(state.range(0)));
+        BoundingVolumeHierarchy hierarchy;
+
+        for (auto _ : state)
+        {
+            hierarchy.Build(parts.data(), static_cast<uint32_t>(parts.size()));
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // Every frame each part moves slightly as the model matrices are brought to rendering space.
+    void BM_SurfacePartsHierarchyRefit(benchmark::State& state)
+    {
+        std::vector<BoundingBox> parts = MakeRoomParts(static_cast<size_t>(state.range(0)));
+        BoundingVolumeHierarchy hierarchy;
+        hierarchy.Build(parts.data(), static_cast<uint32_t>(parts.size()));
+
+        float offset = 0.0f;
+        for (auto _ : state)
+        {
+            offset = offset > 0.0f ? -0.001f : 0.001f;
+            for (uint32_t i = 0; i < parts.size(); ++i)
+            {
+                BoundingBox& part = parts[i];
+                part.min[0] += offset;
+                part.max[0] += offset;
+                hierarchy.Refit(i, part);
+            }
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+} // namespace
+
+BENCHMARK(BM_SurfacePartsBruteForce)->Arg(100)->Arg(500)->Arg(2000);
+BENCHMARK(BM_SurfacePartsHierarchyQuery)->Arg(100)->Arg(500)->Arg(2000);
+BENCHMARK(BM_SurfacePartsHierarchyBuild)->Arg(100)->Arg(500)->Arg(2000);
+BENCHMARK(BM_SurfacePartsHierarchyRefit)->Arg(100)->Arg(500)->Arg(2000);
+BENCHMARK(BM_SurfacePartsHierarchyChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,166 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <CubeInstancing.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Cube
+    {
+        XrPosef pose;
+        XrVector3f scale;
+        XrVector3f colorFilter;
+    };
+
+    // Boxes of 5 to 50 cm spread over a room, as placed by the sample's holograms.
+    std::vector<Cube> MakeCubes(size_t count)
+    {
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+        std::uniform_real_distribution<float> size(0.05f, 0.5f);
+        std::uniform_real_distribution<float> color(0.0f, 1.0f);
+        std::normal_distribution<float> orientation(0.0f, 1.0f);
+
+        std::vector<Cube> cubes;
+        for (size_t i = 0; i < count; ++i)
+        {
+            XrQuaternionf q = {orientation(random), orientation(random), orientation(random), orientation(random)};
+            const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+            q = {q.x / length, q.y / length, q.z / length, q.w / length};
+            cubes.push_back({{q, {position(random), position(random), position(random)}},
+                             {size(random), size(random), size(random)},
+                             {color(random), color(random), color(random)}});
+        }
+        return cubes;
+    }
+
+    const char* CheckPacking()
+    {
+        const std::vector<Cube> cubes = MakeCubes(103);
+        sample::CubeInstanceBatch batch;
+        for (const Cube& cube : cubes)
+        {
+            batch.Add(cube.pose, cube.scale, cube.colorFilter);
+        }
+
+        std::vector<sample::CubeInstance> instances;
+        batch.Pack(instances);
+        if (instances.size() != cubes.size())
+        {
+            return "one instance per cube expected";
+        }
+
+        for (size_t i = 0; i < cubes.size(); ++i)
+        {
+            const Cube& cube = cubes[i];
+            const sample::CubeInstance& instance = instances[i];
+
+            // The vertex shader computes mul(float4(position, 1), Model) with a column_major Model, which is the transposed
+            // matrix in memory times the position as column vector.
+            const float corner[3] = {0.5f, -0.5f, 0.5f};
+            float transformed[4];
+            for (size_t row = 0; row < 4; ++row)
+            {
+                const float* m = instance.Model + row * 4;
+                transformed[row] = m[0] * corner[0] + m[1] * corner[1] + m[2] * corner[2] + m[3];
+            }
+
+            const XrVector3f expected = xr::math::Batch::Scalar::TransformPoint(
+                cube.pose, {corner[0] * cube.scale.x, corner[1] * cube.scale.y, corner[2] * cube.scale.z});
+            if (std::abs(transformed[0] - expected.x) > 1e-5f || std::abs(transformed[1] - expected.y) > 1e-5f ||
+                std::abs(transformed[2] - expected.z) > 1e-5f || transformed[3] != 1.0f)
+            {
+                return "instance model matrix does not place the cube corner";
+            }
+
+            if (instance.ColorFilter[0] != cube.colorFilter.x || instance.ColorFilter[1] != cube.colorFilter.y ||
+                instance.ColorFilter[2] != cube.colorFilter.z || instance.ColorFilter[3] != 1.0f)
+            {
+                return "instance color filter differs from the cube";
+            }
+        }
+
+        batch.Clear();
+        batch.Pack(instances);
+        if (batch.Size() != 0 || !instances.empty())
+        {
+            return "cleared batch should pack no instances";
+        }
+        return nullptr;
+    }
+
+    void BM_CubeInstancingChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckPacking())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Model matrix and color filter computed per cube, as for the former per-cube constant buffer updates. range(0) is the
+    // number of cubes.
+    void BM_CubeInstancesPerCube(benchmark::State& state)
+    {
+        const std::vector<Cube> cubes = MakeCubes(static_cast<size_t>(state.range(0)));
+        std::vector<sample::CubeInstance> instances(cubes.size());
+
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < cubes.size(); ++i)
+            {
+                sample::CubeInstance& instance = instances[i];
+                xr::math::Batch::Scalar::StoreTransposedMatrix(cubes[i].pose, cubes[i].scale, instance.Model);
+                instance.ColorFilter[0] = cubes[i].colorFilter.x;
+                instance.ColorFilter[1] = cubes[i].colorFilter.y;
+                instance.ColorFilter[2] = cubes[i].colorFilter.z;
+                instance.ColorFilter[3] = 1.0f;
+            }
+            benchmark::DoNotOptimize(instances.data());
+        }
+        state.SetItemsProcessed(state.iterations() * cubes.size());
+    }
+
+    // Collecting and packing all cubes into the instance buffer data, once per RenderView.
+    void BM_CubeInstancesPacked(benchmark::State& state)
+    {
+        const std::vector<Cube> cubes = MakeCubes(static_cast<size_t>(state.range(0)));
+        sample::CubeInstanceBatch batch;
+        std::vector<sample::CubeInstance> instances;
+
+        for (auto _ : state)
+        {
+            batch.Clear();
+            for (const Cube& cube : cubes)
+            {
+                batch.Add(cube.pose, cube.scale, cube.colorFilter);
+            }
+            batch.Pack(instances);
+            benchmark::DoNotOptimize(instances.data());
+        }
+        state.SetItemsProcessed(state.iterations() * cubes.size());
+        state.SetLabel(xr::math::Batch::KernelName());
+    }
+} // namespace
+
+BENCHMARK(BM_CubeInstancingChecks);
+BENCHMARK(BM_CubeInstancesPerCube)->Arg(16)->Arg(512);
+BENCHMARK(BM_CubeInstancesPacked)->Arg(16)->Arg(512);
@@ -0,0 +1,145 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <Content/DDSHeader.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // DXGI_FORMAT_R8G8B8A8_UNORM and D3D11_RESOURCE_DIMENSION_TEXTURE2D.
+    constexpr uint32_t FormatR8G8B8A8 = 28;
+    constexpr uint32_t ResourceDimensionTexture2D = 3;
+
+    // A DDS file of a width x height RGBA texture, with the DX10 extension header if dxt10 is set.
+    std::vector<uint8_t> MakeDDSFile(uint32_t width, uint32_t height, bool dxt10)
+    {
+        DDS_HEADER header = {};
+        header.size = sizeof(DDS_HEADER);
+        header.flags = DDS_WIDTH | DDS_HEIGHT;
+        header.width = width;
+        header.height = height;
+        header.mipMapCount = 1;
+        header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+        if (dxt10)
+        {
+            header.ddspf.flags = DDS_FOURCC;
+            header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+        }
+        else
+        {
+            header.ddspf.flags = DDS_RGB | DDS_ALPHA;
+            header.ddspf.RGBBitCount = 32;
+            header.ddspf.RBitMask = 0x000000ff;
+            header.ddspf.GBitMask = 0x0000ff00;
+            header.ddspf.BBitMask = 0x00ff0000;
+            header.ddspf.ABitMask = 0xff000000;
+        }
+
+        const size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + (dxt10 ? sizeof(DDS_HEADER_DXT10) : 0);
+        std::vector<uint8_t> file(headerSize + size_t(width) * height * 4, 0x80);
+        std::memcpy(file.data(), &DDS_MAGIC, sizeof(uint32_t));
+        std::memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+        if (dxt10)
+        {
+            DDS_HEADER_DXT10 headerDxt10 = {};
+            headerDxt10.dxgiFormat = FormatR8G8B8A8;
+            headerDxt10.resourceDimension = ResourceDimensionTexture2D;
+            headerDxt10.arraySize = 1;
+            std::memcpy(file.data() + sizeof(uint32_t) + sizeof(DDS_HEADER), &headerDxt10, sizeof(headerDxt10));
+        }
+        return file;
+    }
+
+    void BM_DDSHeaderParse(benchmark::State& state)
+    {
+        const std::vector<uint8_t> file = MakeDDSFile(256, 256, state.range(0) != 0);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(file.data());
+            DDSFileLayout layout;
+            const bool valid = ParseDDSHeader(file.data(), file.size(), layout);
+            benchmark::DoNotOptimize(valid);
+            benchmark::DoNotOptimize(layout);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Checks the header validation against well-formed, truncated and damaged files.
+    void BM_DDSHeaderChecks(benchmark::State& state)
+    {
+        const std::vector<uint8_t> plain = MakeDDSFile(64, 32, false);
+        const std::vector<uint8_t> dxt10 = MakeDDSFile(64, 32, true);
+        const size_t plainOffset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+        const size_t dxt10Offset = plainOffset + sizeof(DDS_HEADER_DXT10);
+
+        for (auto _ : state)
+        {
+            DDSFileLayout layout;
+            if (!ParseDDSHeader(plain.data(), plain.size(), layout) || layout.headerDxt10 || layout.bitOffset != plainOffset ||
+                layout.header->width != 64 || layout.header->height != 32)
+            {
+                state.SkipWithError("plain header not parsed");
+                return;
+            }
+
+            if (!ParseDDSHeader(dxt10.data(), dxt10.size(), layout) || !layout.headerDxt10 || layout.bitOffset != dxt10Offset ||
+                layout.headerDxt10->dxgiFormat != FormatR8G8B8A8 || layout.headerDxt10->arraySize != 1)
+            {
+                state.SkipWithError("DX10 header not parsed");
+                return;
+            }
+
+            // Files cut within the headers are rejected, files cut within the texture data are left to the texture creation.
+            for (size_t size = 0; size < dxt10Offset; ++size)
+            {
+                const bool valid = ParseDDSHeader(dxt10.data(), size, layout);
+                if (valid || layout.header)
+                {
+                    state.SkipWithError("truncated header accepted");
+                    return;
+                }
+            }
+            if (!ParseDDSHeader(plain.data(), plainOffset, layout) || !ParseDDSHeader(dxt10.data(), dxt10Offset, layout))
+            {
+                state.SkipWithError("file without texture data rejected");
+                return;
+            }
+
+            if (ParseDDSHeader(nullptr, plain.size(), layout))
+            {
+                state.SkipWithError("missing data accepted");
+                return;
+            }
+
+            // A damaged magic number, header size or pixel format size.
+            for (size_t offset : {size_t(0), sizeof(uint32_t), sizeof(uint32_t) + offsetof(DDS_HEADER, ddspf)})
+            {
+                std::vector<uint8_t> damaged = plain;
+                damaged[offset] ^= 0x01;
+                if (ParseDDSHeader(damaged.data(), damaged.size(), layout))
+                {
+                    state.SkipWithError("damaged header accepted");
+                    return;
+                }
+            }
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_DDSHeaderParse)->ArgName("dxt10")->Arg(0)->Arg(1);
+BENCHMARK(BM_DDSHeaderChecks)->Iterations(1);
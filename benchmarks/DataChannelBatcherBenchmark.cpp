@@ -0,0 +1,312 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <DataChannelBatcher.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    using namespace DataChannel;
+    using Clock = MessageBatcher::Clock;
+
+    constexpr MessageType TelemetryType = MessageType::FirstApplicationType;
+    constexpr MessageType BlobType = static_cast<MessageType>(static_cast<uint16_t>(MessageType::FirstApplicationType) + 1);
+
+    struct Telemetry
+    {
+        uint32_t sequence;
+        float values[11];
+    };
+
+    // In-process transport which keeps the sent packets, like a data channel copying them into its send queue.
+    class LoopbackTransport : public IPacketTransport
+    {
+    public:
+        bool SendPacket(std::span<const uint8_t> packet, bool) override
+        {
+            std::lock_guard lock(m_mutex);
+            if (failing)
+            {
+                return false;
+            }
+            packets.emplace_back(packet.begin(), packet.end());
+            return true;
+        }
+
+        bool failing = false;
+        std::vector<std::vector<uint8_t>> packets;
+
+    private:
+        std::mutex m_mutex;
+    };
+
+    void AddTelemetry(MessageBatcher& batcher, uint32_t sequence, Clock::time_point now, bool urgent = false)
+    {
+        batcher.BeginMessage(TelemetryType).Write(Telemetry{sequence, {}});
+        batcher.EndMessage(now, urgent);
+    }
+
+    // Dispatches the received packets and returns the telemetry sequence numbers in the order received, ~0u for other messages.
+    std::vector<uint32_t> ReceiveSequences(const LoopbackTransport& transport)
+    {
+        std::vector<uint32_t> sequences;
+        MessageDispatcher dispatcher;
+        dispatcher.Register(TelemetryType, [&](const MessageView& message) {
+            PayloadReader payload(message.payload);
+            Telemetry telemetry;
+            sequences.push_back(payload.Read(telemetry) ? telemetry.sequence : ~0u);
+        });
+        dispatcher.Register(BlobType, [&](const MessageView&) { sequences.push_back(~0u); });
+
+        for (const std::vector<uint8_t>& packet : transport.packets)
+        {
+            dispatcher.Dispatch(packet);
+        }
+        return sequences;
+    }
+
+    bool IsSequence(const std::vector<uint32_t>& sequences, uint32_t count)
+    {
+        if (sequences.size() != count)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (sequences[i] != i)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char* CheckBatcher()
+    {
+        const Clock::time_point start = Clock::now();
+        const BatcherSettings settings = {1200, 2000us, true};
+
+        // small messages are coalesced into full packets, in order
+        {
+            LoopbackTransport transport;
+            MessageBatcher batcher(transport, settings);
+            for (uint32_t i = 0; i < 300; ++i)
+            {
+                AddTelemetry(batcher, i, start);
+            }
+            batcher.Flush();
+
+            const size_t messagesPerPacket = settings.maxPacketSize / (MessageHeaderSize + sizeof(Telemetry));
+            const size_t expectedPackets = (300 + messagesPerPacket - 1) / messagesPerPacket;
+            if (transport.packets.size() != expectedPackets || batcher.GetStatistics().packetCount != expectedPackets)
+            {
+                return "small messages should be coalesced into full packets";
+            }
+            for (const std::vector<uint8_t>& packet : transport.packets)
+            {
+                if (packet.size() > settings.maxPacketSize)
+                {
+                    return "batch exceeds the maximum packet size";
+                }
+            }
+            if (!IsSequence(ReceiveSequences(transport), 300) || batcher.GetStatistics().messageCount != 300)
+            {
+                return "batched messages should arrive in order";
+            }
+        }
+
+        // the batch is sent once the latency budget of its first message is spent
+        {
+            LoopbackTransport transport;
+            MessageBatcher batcher(transport, settings);
+            AddTelemetry(batcher, 0, start);
+            AddTelemetry(batcher, 1, start + 1500us);
+            batcher.Poll(start + 1999us);
+            if (!transport.packets.empty() || batcher.GetDeadline() != start + 2000us)
+            {
+                return "batch should wait for the latency budget";
+            }
+            batcher.Poll(start + 2000us);
+            if (transport.packets.size() != 1 || batcher.GetDeadline() != Clock::time_point::max() ||
+                batcher.GetStatistics().deadlinePacketCount != 1)
+            {
+                return "batch should be sent when the latency budget is spent";
+            }
+
+            // a message added after the deadline sends the batch right away
+            AddTelemetry(batcher, 2, start + 3000us);
+            AddTelemetry(batcher, 3, start + 5001us);
+            if (transport.packets.size() != 2 || !IsSequence(ReceiveSequences(transport), 4))
+            {
+                return "adding a message should send the overdue batch";
+            }
+        }
+
+        // urgent messages flush the batch including the messages before them
+        {
+            LoopbackTransport transport;
+            MessageBatcher batcher(transport, settings);
+            AddTelemetry(batcher, 0, start);
+            AddTelemetry(batcher, 1, start);
+            AddTelemetry(batcher, 2, start, true);
+            if (transport.packets.size() != 1 || !IsSequence(ReceiveSequences(transport), 3) ||
+                batcher.GetPendingMessageCount() != 0)
+            {
+                return "urgent message should send the batch";
+            }
+        }
+
+        // a message larger than a packet is sent on its own, after the batch before it
+        {
+            LoopbackTransport transport;
+            MessageBatcher batcher(transport, settings);
+            const std::vector<uint8_t> blob(5000, 0xAB);
+            AddTelemetry(batcher, 0, start);
+            batcher.BeginMessage(BlobType).WriteBytes(blob);
+            batcher.EndMessage(start);
+            AddTelemetry(batcher, 1, start);
+            batcher.Flush();
+
+            if (transport.packets.size() != 3 || transport.packets[1].size() != MessageHeaderSize + 4 + blob.size())
+            {
+                return "large message should be sent in a packet of its own";
+            }
+            const std::vector<uint32_t> sequences = ReceiveSequences(transport);
+            if (sequences.size() != 3 || sequences[0] != 0 || sequences[1] != ~0u || sequences[2] != 1)
+            {
+                return "large message should keep its order";
+            }
+        }
+
+        // packets the transport fails to send are dropped and counted
+        {
+            LoopbackTransport transport;
+            MessageBatcher batcher(transport, settings);
+            transport.failing = true;
+            AddTelemetry(batcher, 0, start);
+            batcher.Flush();
+            transport.failing = false;
+            AddTelemetry(batcher, 1, start);
+            batcher.Flush();
+
+            const std::vector<uint32_t> sequences = ReceiveSequences(transport);
+            if (batcher.GetStatistics().failedPacketCount != 1 || sequences.size() != 1 || sequences[0] != 1)
+            {
+                return "failed packet should be dropped";
+            }
+        }
+        return nullptr;
+    }
+
+    void BM_DataChannelBatcherChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckBatcher())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Telemetry traffic of several hundred tiny messages per second on a simulated clock, polled every half millisecond. A
+    // maximum packet size of 0 sends every message on its own, like the samples did before batching.
+    void BM_DataChannelBatchTelemetryTraffic(benchmark::State& state)
+    {
+        const BatcherSettings settings = {static_cast<size_t>(state.range(0)), std::chrono::microseconds(state.range(1)), true};
+        const Clock::time_point start = Clock::now();
+
+        BatcherStatistics statistics;
+        Clock::duration maxLatency{0};
+        for (auto _ : state)
+        {
+            LoopbackTransport transport;
+            MessageBatcher batcher(transport, settings);
+
+            std::mt19937 random(7);
+            std::exponential_distribution<double> interval(800.0); // messages per second
+            std::vector<Clock::time_point> addTimes;
+            std::vector<Clock::time_point> packetTimes;
+
+            Clock::time_point nextMessage = start;
+            for (Clock::time_point now = start; now < start + 1s; now += 500us)
+            {
+                while (nextMessage <= now)
+                {
+                    AddTelemetry(batcher, static_cast<uint32_t>(addTimes.size()), nextMessage);
+                    addTimes.push_back(nextMessage);
+                    packetTimes.resize(transport.packets.size(), nextMessage);
+                    nextMessage += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval(random)));
+                }
+                batcher.Poll(now);
+                packetTimes.resize(transport.packets.size(), now);
+            }
+            batcher.Flush();
+            packetTimes.resize(transport.packets.size(), start + 1s);
+
+            // latency from adding each message until its packet was sent
+            size_t message = 0;
+            for (size_t packet = 0; packet < transport.packets.size(); ++packet)
+            {
+                MessageView view;
+                PacketReader reader(transport.packets[packet]);
+                while (reader.Next(view) == ReadStatus::Ok)
+                {
+                    maxLatency = std::max(maxLatency, packetTimes[packet] - addTimes[message++]);
+                }
+            }
+            statistics = batcher.GetStatistics();
+        }
+
+        state.counters["MessagesPerPacket"] = statistics.GetMessagesPerPacket();
+        state.counters["AvgPacketBytes"] = statistics.GetAveragePacketSize();
+        state.counters["MaxLatencyUs"] = std::chrono::duration<double, std::micro>(maxLatency).count();
+    }
+
+    // Cost of sending a burst of tiny messages, including the per packet cost of the transport.
+    void BM_DataChannelSendBurst(benchmark::State& state)
+    {
+        const BatcherSettings settings = {static_cast<size_t>(state.range(0)), 2000us, true};
+        const Clock::time_point now = Clock::now();
+        constexpr uint32_t MessageCount = 256;
+
+        LoopbackTransport transport;
+        MessageBatcher batcher(transport, settings);
+        for (auto _ : state)
+        {
+            for (uint32_t i = 0; i < MessageCount; ++i)
+            {
+                AddTelemetry(batcher, i, now);
+            }
+            batcher.Flush();
+            transport.packets.clear();
+        }
+        state.SetItemsProcessed(state.iterations() * MessageCount);
+        state.counters["MessagesPerPacket"] = batcher.GetStatistics().GetMessagesPerPacket();
+    }
+} // namespace
+
+BENCHMARK(BM_DataChannelBatcherChecks)->Iterations(1);
+BENCHMARK(BM_DataChannelBatchTelemetryTraffic)->Args({0, 2000})->Args({1200, 2000})->Args({1200, 5000})->Iterations(3);
+BENCHMARK(BM_DataChannelSendBurst)->Arg(0)->Arg(1200);
@@ -0,0 +1,470 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include "BenchmarkUtils.h"
+
+#include <DataChannelCompression.h>
+#include <DataChannelStream.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace DataChannel;
+
+    constexpr MessageType PositionsType = MessageType::FirstApplicationType;
+    constexpr MessageType IndicesType = static_cast<MessageType>(static_cast<uint16_t>(MessageType::FirstApplicationType) + 1);
+    constexpr MessageType StateType = static_cast<MessageType>(static_cast<uint16_t>(MessageType::FirstApplicationType) + 2);
+    constexpr MessageType RandomType = static_cast<MessageType>(static_cast<uint16_t>(MessageType::FirstApplicationType) + 3);
+
+    // Bytes of a stream chunk, the size payloads are compressed at when they are streamed.
+    constexpr size_t ChunkSize = 1200 - MessageHeaderSize - StreamChunkHeaderSize;
+
+    template <typename T>
+    std::vector<uint8_t> ToBytes(const std::vector<T>& values)
+    {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(values.data());
+        return std::vector<uint8_t>(data, data + values.size() * sizeof(T));
+    }
+
+    // Object state as an application would send it as text.
+    std::vector<uint8_t> MakeStateText(size_t size)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> position(-5.0f, 5.0f);
+        std::string text;
+        for (uint32_t id = 0; text.size() < size; ++id)
+        {
+            char object[200];
+            std::snprintf(
+                object,
+                sizeof(object),
+                "{\"id\":%u,\"name\":\"Cube %u\",\"position\":[%.3f,%.3f,%.3f],\"visible\":%s},",
+                id,
+                id,
+                position(random),
+                position(random),
+                position(random),
+                id % 3 == 0 ? "false" : "true");
+            text += object;
+        }
+        text.resize(size);
+        return std::vector<uint8_t>(text.begin(), text.end());
+    }
+
+    std::vector<uint8_t> MakeRandomBytes(size_t size)
+    {
+        std::mt19937 random(8);
+        std::vector<uint8_t> bytes(size);
+        for (uint8_t& value : bytes)
+        {
+            value = static_cast<uint8_t>(random());
+        }
+        return bytes;
+    }
+
+    struct Payload
+    {
+        const char* name;
+        MessageType type;
+        uint8_t int16Stride;
+        std::vector<uint8_t> bytes;
+    };
+
+    const std::vector<Payload>& GetPayloads()
+    {
+        static const std::vector<Payload> payloads = [] {
+            const BenchmarkUtils::SurfaceMesh mesh = BenchmarkUtils::MakeSurfaceMesh(128);
+            return std::vector<Payload>{
+                {"MeshPositions", PositionsType, 4, ToBytes(mesh.positions)},
+                {"MeshIndices", IndicesType, 1, ToBytes(mesh.indices)},
+                {"StateText", StateType, 0, MakeStateText(128 * 1024)},
+                {"Random", RandomType, 0, MakeRandomBytes(128 * 1024)}};
+        }();
+        return payloads;
+    }
+
+    std::vector<uint8_t> Encode(PayloadCodec codec, std::span<const uint8_t> input, uint8_t stride)
+    {
+        std::vector<uint8_t> output;
+        if (codec == PayloadCodec::Lz)
+        {
+            CompressLz(input, output);
+        }
+        else
+        {
+            EncodeDeltaVarint16(input, stride, output);
+        }
+        return output;
+    }
+
+    bool Decode(PayloadCodec codec, std::span<const uint8_t> input, uint8_t stride, std::span<uint8_t> output)
+    {
+        return codec == PayloadCodec::Lz ? DecompressLz(input, output) : DecodeDeltaVarint16(input, stride, output);
+    }
+
+    const char* CheckCodecs()
+    {
+        std::vector<std::vector<uint8_t>> inputs;
+        for (size_t size : {0, 1, 3, 4, 5, 15, 16, 19, 270, 4000})
+        {
+            inputs.push_back(MakeRandomBytes(size));
+        }
+        // runs longer than the match length field, and matches which overlap what they produce
+        inputs.push_back(std::vector<uint8_t>(5000, 42));
+        inputs.push_back(MakeStateText(70 * 1000));
+        for (const Payload& payload : GetPayloads())
+        {
+            inputs.push_back(payload.bytes);
+            inputs.push_back(std::vector<uint8_t>(payload.bytes.begin(), payload.bytes.begin() + 1001));
+        }
+
+        for (const std::vector<uint8_t>& input : inputs)
+        {
+            for (PayloadCodec codec : {PayloadCodec::Lz, PayloadCodec::DeltaVarint16})
+            {
+                for (uint8_t stride : {1, 3, 4})
+                {
+                    const std::vector<uint8_t> encoded = Encode(codec, input, stride);
+                    std::vector<uint8_t> decoded(input.size());
+                    if (!Decode(codec, encoded, stride, decoded) || decoded != input)
+                    {
+                        return "codec should round trip";
+                    }
+                    // LZ input ends exactly at the end of the output. (Delta coding can not tell a truncated odd output.)
+                    if (codec == PayloadCodec::Lz && !input.empty() &&
+                        Decode(codec, encoded, stride, std::span(decoded).first(input.size() - 1)))
+                    {
+                        return "codec should reject a wrong output size";
+                    }
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // Corrupted and truncated payloads must be rejected or decode to something of the declared size, without reading or
+    // writing out of bounds (run with -fsanitize=address to check the latter).
+    const char* CheckCorruptPayloads()
+    {
+        std::mt19937 random(9);
+        PayloadCompressor compressor;
+        compressor.SetInt16Layout(PositionsType, 4);
+        compressor.SetInt16Layout(IndicesType, 1);
+
+        for (const Payload& payload : GetPayloads())
+        {
+            std::vector<uint8_t> packet;
+            MessageWriter writer(packet);
+            compressor.WriteMessage(writer, payload.type, std::span(payload.bytes).first(ChunkSize));
+
+            std::vector<uint8_t> buffer;
+            for (int i = 0; i < 2000; ++i)
+            {
+                std::vector<uint8_t> corrupt(packet.begin() + MessageHeaderSize, packet.end());
+                if (i % 2 == 0)
+                {
+                    corrupt.resize(std::uniform_int_distribution<size_t>(0, corrupt.size())(random));
+                }
+                for (int j = i % 4; j > 0 && !corrupt.empty(); --j)
+                {
+                    corrupt[std::uniform_int_distribution<size_t>(0, corrupt.size() - 1)(random)] = static_cast<uint8_t>(random());
+                }
+
+                const MessageView message = {payload.type, static_cast<uint8_t>(random() % 4), corrupt};
+                std::span<const uint8_t> decoded;
+                if (DecodePayload(message, buffer, decoded) && message.flags != 0 && decoded.size() != buffer.size())
+                {
+                    return "decoded payload should have the declared size";
+                }
+            }
+        }
+
+        const uint8_t unknown[] = {1, 2, 3, 4};
+        std::vector<uint8_t> buffer;
+        std::span<const uint8_t> decoded;
+        if (DecodePayload({StateType, 0x04, unknown}, buffer, decoded) || DecodePayload({StateType, 0x03, unknown}, buffer, decoded))
+        {
+            return "unknown encodings should be rejected";
+        }
+        return nullptr;
+    }
+
+    // The compressor picks the codec by type: delta coding for int16 arrays, LZ for text, none for random data.
+    const char* CheckAdaptiveSelection()
+    {
+        PayloadCompressor compressor;
+        for (const Payload& payload : GetPayloads())
+        {
+            if (payload.int16Stride > 0)
+            {
+                compressor.SetInt16Layout(payload.type, payload.int16Stride);
+            }
+        }
+
+        std::vector<uint8_t> packet;
+        MessageWriter writer(packet);
+        MessageDispatcher dispatcher;
+        const char* error = nullptr;
+        for (const Payload& payload : GetPayloads())
+        {
+            std::vector<uint8_t> received;
+            dispatcher.Register(payload.type, [&received, &error](const MessageView& message) {
+                std::vector<uint8_t> buffer;
+                std::span<const uint8_t> decoded;
+                if (!DecodePayload(message, buffer, decoded))
+                {
+                    error = "compressed message should decode";
+                }
+                received.insert(received.end(), decoded.begin(), decoded.end());
+            });
+
+            for (size_t offset = 0; offset < payload.bytes.size(); offset += ChunkSize)
+            {
+                packet.clear();
+                const size_t size = std::min(ChunkSize, payload.bytes.size() - offset);
+                compressor.WriteMessage(writer, payload.type, std::span(payload.bytes).subspan(offset, size));
+                dispatcher.Dispatch(packet);
+            }
+            if (error || received != payload.bytes)
+            {
+                return error ? error : "compressed messages should round trip";
+            }
+        }
+
+        if (compressor.GetCodec(PositionsType) != PayloadCodec::DeltaVarint16 ||
+            compressor.GetCodec(IndicesType) != PayloadCodec::DeltaVarint16 || compressor.GetCodec(StateType) != PayloadCodec::Lz ||
+            compressor.GetCodec(RandomType) != PayloadCodec::None)
+        {
+            return "compressor should pick the codec which suits the payload type";
+        }
+        return nullptr;
+    }
+
+    // A mesh streamed with compressed chunks arrives intact and takes less bandwidth.
+    const char* CheckCompressedStream()
+    {
+        class Loopback : public IPacketTransport
+        {
+        public:
+            explicit Loopback(MessageDispatcher& dispatcher)
+                : m_dispatcher(dispatcher)
+            {
+            }
+
+            bool SendPacket(std::span<const uint8_t> packet, bool) override
+            {
+                sentBytes += packet.size();
+                m_dispatcher.Dispatch(packet);
+                return true;
+            }
+
+            size_t sentBytes = 0;
+
+        private:
+            MessageDispatcher& m_dispatcher;
+        };
+
+        const Payload& positions = GetPayloads()[0];
+        std::vector<uint8_t> received;
+        StreamReceiver receiver([&](uint32_t, MessageType, std::vector<uint8_t>&& payload) { received = std::move(payload); });
+        MessageDispatcher dispatcher;
+        receiver.Register(dispatcher);
+        Loopback channel(dispatcher);
+        PayloadCompressor compressor;
+        compressor.SetInt16Layout(positions.type, positions.int16Stride);
+        StreamSender sender(channel, {}, &compressor);
+
+        sender.Send(positions.type, positions.bytes);
+        sender.Pump();
+        if (received != positions.bytes)
+        {
+            return "compressed stream should be reassembled";
+        }
+        if (channel.sentBytes > positions.bytes.size() * 3 / 4)
+        {
+            return "compressed stream should take less bandwidth";
+        }
+        return nullptr;
+    }
+
+    void BM_DataChannelCompressionChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            for (const char* (*check)() : {CheckCodecs, CheckCorruptPayloads, CheckAdaptiveSelection, CheckCompressedStream})
+            {
+                if (const char* error = check())
+                {
+                    state.SkipWithError(error);
+                    return;
+                }
+            }
+        }
+    }
+
+    // Compresses the payload in chunks of a stream, like it is sent.
+    void CompressChunks(benchmark::State& state, PayloadCodec codec, std::span<const uint8_t> payload, uint8_t stride)
+    {
+        std::vector<uint8_t> output;
+        size_t outputSize = 0;
+        for (auto _ : state)
+        {
+            outputSize = 0;
+            for (size_t offset = 0; offset < payload.size(); offset += ChunkSize)
+            {
+                output.clear();
+                const std::span<const uint8_t> chunk = payload.subspan(offset, std::min(ChunkSize, payload.size() - offset));
+                if (codec == PayloadCodec::Lz)
+                {
+                    CompressLz(chunk, output);
+                }
+                else
+                {
+                    EncodeDeltaVarint16(chunk, stride, output);
+                }
+                outputSize += output.size();
+            }
+            benchmark::DoNotOptimize(outputSize);
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(payload.size()));
+        state.counters["Ratio"] = double(outputSize) / double(payload.size());
+    }
+
+    void DecompressChunks(benchmark::State& state, PayloadCodec codec, std::span<const uint8_t> payload, uint8_t stride)
+    {
+        std::vector<std::vector<uint8_t>> chunks;
+        for (size_t offset = 0; offset < payload.size(); offset += ChunkSize)
+        {
+            chunks.push_back(Encode(codec, payload.subspan(offset, std::min(ChunkSize, payload.size() - offset)), stride));
+        }
+
+        std::vector<uint8_t> output(payload.size());
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < chunks.size(); ++i)
+            {
+                const size_t offset = i * ChunkSize;
+                if (!Decode(codec, chunks[i], stride, std::span(output).subspan(offset, std::min(ChunkSize, payload.size() - offset))))
+                {
+                    state.SkipWithError("chunk should decode");
+                    return;
+                }
+            }
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(payload.size()));
+    }
+
+    // Arguments: codec (1 LZ, 2 delta varint), payload (0 mesh positions, 1 mesh indices, 2 state text, 3 random).
+    void BM_DataChannelCompress(benchmark::State& state)
+    {
+        const Payload& payload = GetPayloads()[state.range(1)];
+        state.SetLabel(payload.name);
+        CompressChunks(state, static_cast<PayloadCodec>(state.range(0)), payload.bytes, std::max<uint8_t>(payload.int16Stride, 1));
+    }
+
+    void BM_DataChannelDecompress(benchmark::State& state)
+    {
+        const Payload& payload = GetPayloads()[state.range(1)];
+        state.SetLabel(payload.name);
+        DecompressChunks(state, static_cast<PayloadCodec>(state.range(0)), payload.bytes, std::max<uint8_t>(payload.int16Stride, 1));
+    }
+
+    // The adaptive compressor over the chunks of each payload, including its probing of all codecs.
+    void BM_DataChannelCompressAdaptive(benchmark::State& state)
+    {
+        const Payload& payload = GetPayloads()[state.range(0)];
+        PayloadCompressor compressor;
+        if (payload.int16Stride > 0)
+        {
+            compressor.SetInt16Layout(payload.type, payload.int16Stride);
+        }
+
+        std::vector<uint8_t> output;
+        for (auto _ : state)
+        {
+            for (size_t offset = 0; offset < payload.bytes.size(); offset += ChunkSize)
+            {
+                output.clear();
+                compressor.Compress(
+                    payload.type, std::span(payload.bytes).subspan(offset, std::min(ChunkSize, payload.bytes.size() - offset)), output);
+            }
+            benchmark::DoNotOptimize(output.data());
+        }
+
+        const char* codecNames[] = {"None", "Lz", "DeltaVarint16"};
+        state.SetLabel(std::string(payload.name) + " " + codecNames[static_cast<size_t>(compressor.GetCodec(payload.type))]);
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(payload.bytes.size()));
+        state.counters["Ratio"] = compressor.GetStatistics().GetRatio();
+    }
+
+    // Recorded meshes are read from the directory in SAMPLE_BENCHMARKS_RECORDED_MESHES, one mesh per *.mesh file: uint32 vertex
+    // count, uint32 index count, the SpatialSurfaceMeshPart::Vertex_t positions (4 x int16 per vertex) and the uint16 indices.
+    const bool RecordedMeshesRegistered = [] {
+        const char* directory = std::getenv("SAMPLE_BENCHMARKS_RECORDED_MESHES");
+        std::error_code error;
+        if (!directory || !std::filesystem::is_directory(directory, error))
+        {
+            return false;
+        }
+
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+        {
+            if (entry.path().extension() != ".mesh")
+            {
+                continue;
+            }
+
+            std::ifstream file(entry.path(), std::ios::binary);
+            uint32_t counts[2] = {};
+            file.read(reinterpret_cast<char*>(counts), sizeof(counts));
+            auto positions = std::make_shared<std::vector<uint8_t>>(size_t(counts[0]) * 4 * sizeof(int16_t));
+            auto indices = std::make_shared<std::vector<uint8_t>>(size_t(counts[1]) * sizeof(uint16_t));
+            file.read(reinterpret_cast<char*>(positions->data()), std::streamsize(positions->size()));
+            file.read(reinterpret_cast<char*>(indices->data()), std::streamsize(indices->size()));
+            if (!file)
+            {
+                std::fprintf(stderr, "Skipping truncated recorded mesh %s\n", entry.path().string().c_str());
+                continue;
+            }
+
+            const std::string name = entry.path().stem().string();
+            for (PayloadCodec codec : {PayloadCodec::Lz, PayloadCodec::DeltaVarint16})
+            {
+                const std::string codecName = codec == PayloadCodec::Lz ? "Lz" : "DeltaVarint16";
+                benchmark::RegisterBenchmark(("BM_DataChannelCompressRecorded/" + name + "/Positions/" + codecName).c_str(),
+                                             [codec, positions](benchmark::State& state) { CompressChunks(state, codec, *positions, 4); });
+                benchmark::RegisterBenchmark(("BM_DataChannelCompressRecorded/" + name + "/Indices/" + codecName).c_str(),
+                                             [codec, indices](benchmark::State& state) { CompressChunks(state, codec, *indices, 1); });
+            }
+        }
+        return true;
+    }();
+} // namespace
+
+BENCHMARK(BM_DataChannelCompressionChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DataChannelCompress)->ArgsProduct({{1, 2}, {0, 1, 2, 3}})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_DataChannelDecompress)->ArgsProduct({{1, 2}, {0, 1, 2, 3}})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_DataChannelCompressAdaptive)->DenseRange(0, 3)->Unit(benchmark::kMicrosecond);
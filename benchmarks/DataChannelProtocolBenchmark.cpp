@@ -0,0 +1,356 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <DataChannelProtocol.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    using namespace DataChannel;
+
+    constexpr MessageType TelemetryType = static_cast<MessageType>(static_cast<uint16_t>(MessageType::FirstApplicationType) + 0);
+    constexpr MessageType AnnotationType = static_cast<MessageType>(static_cast<uint16_t>(MessageType::FirstApplicationType) + 1);
+    constexpr MessageType MeshType = static_cast<MessageType>(static_cast<uint16_t>(MessageType::FirstApplicationType) + 2);
+
+    struct Telemetry
+    {
+        uint64_t timestamp;
+        float position[3];
+        float orientation[4];
+    };
+
+    // A packet like the app state we send: telemetry, annotations and small meshes.
+    void WriteAppStatePacket(std::vector<uint8_t>& packet, uint32_t messageCount, std::mt19937& random)
+    {
+        MessageWriter writer(packet);
+        for (uint32_t i = 0; i < messageCount; ++i)
+        {
+            switch (random() % 4)
+            {
+                case 0:
+                    writer.WriteMessage(MessageType::Ping);
+                    break;
+
+                case 1:
+                    writer.BeginMessage(AnnotationType);
+                    writer.Write(i);
+                    writer.WriteString("Annotation placed on the table");
+                    writer.EndMessage();
+                    break;
+
+                case 2:
+                {
+                    std::vector<int16_t> positions(3 * (random() % 64));
+                    for (int16_t& value : positions)
+                    {
+                        value = static_cast<int16_t>(random());
+                    }
+                    writer.BeginMessage(MeshType);
+                    writer.Write(i);
+                    writer.WriteArray(std::span<const int16_t>(positions));
+                    writer.EndMessage();
+                    break;
+                }
+
+                default:
+                    writer.BeginMessage(TelemetryType);
+                    writer.Write(Telemetry{i, {1.0f, 2.0f, 3.0f}, {0.0f, 0.0f, 0.0f, 1.0f}});
+                    writer.EndMessage();
+                    break;
+            }
+        }
+    }
+
+    // Reads every field of every message and checks that all views lie within the packet. Returns the number of messages read.
+    uint32_t ReadAppStatePacket(std::span<const uint8_t> packet, const char*& error)
+    {
+        const auto isWithinPacket = [&](std::span<const uint8_t> bytes) {
+            return bytes.empty() || (bytes.data() >= packet.data() && bytes.data() + bytes.size() <= packet.data() + packet.size());
+        };
+
+        PacketReader reader(packet);
+        MessageView message;
+        uint32_t messageCount = 0;
+        while (reader.Next(message) == ReadStatus::Ok)
+        {
+            ++messageCount;
+            if (!isWithinPacket(message.payload))
+            {
+                error = "message payload outside of the packet";
+            }
+
+            PayloadReader payload(message.payload);
+            uint32_t index = 0;
+            if (message.type == AnnotationType)
+            {
+                std::string_view text;
+                payload.Read(index);
+                if (payload.ReadString(text) &&
+                    !isWithinPacket({reinterpret_cast<const uint8_t*>(text.data()), text.size()}))
+                {
+                    error = "string outside of the payload";
+                }
+            }
+            else if (message.type == MeshType)
+            {
+                UnalignedArrayView<int16_t> positions;
+                payload.Read(index);
+                if (payload.ReadArray(positions) && !isWithinPacket(positions.GetBytes()))
+                {
+                    error = "array outside of the payload";
+                }
+            }
+            else if (message.type == TelemetryType)
+            {
+                Telemetry telemetry;
+                payload.Read(telemetry);
+            }
+        }
+        return messageCount;
+    }
+
+    const char* CheckRoundTrip()
+    {
+        std::vector<uint8_t> packet;
+        MessageWriter writer(packet);
+
+        const int16_t positions[] = {-1, 2, -3, 4, 32767, -32768};
+        writer.BeginMessage(MeshType);
+        writer.Write(uint8_t(7)); // leaves the array unaligned
+        writer.WriteArray(std::span<const int16_t>(positions));
+        writer.WriteString("mesh");
+        writer.EndMessage();
+        writer.WriteMessage(MessageType::Ping);
+
+        MessageDispatcher dispatcher;
+        const char* error = "mesh message not dispatched";
+        dispatcher.Register(MeshType, [&](const MessageView& message) {
+            PayloadReader payload(message.payload);
+            uint8_t tag = 0;
+            UnalignedArrayView<int16_t> values;
+            std::string_view name;
+            payload.Read(tag);
+            payload.ReadArray(values);
+            payload.ReadString(name);
+            if (!payload.IsValid() || payload.GetRemainingSize() != 0 || tag != 7 || values.size() != std::size(positions) ||
+                name != "mesh")
+            {
+                error = "mesh message read back differently";
+                return;
+            }
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                if (values[i] != positions[i])
+                {
+                    error = "array read back differently";
+                    return;
+                }
+            }
+            error = nullptr;
+        });
+
+        MessageDispatcher::DispatchResult result = dispatcher.Dispatch(packet);
+        if (error != nullptr)
+        {
+            return error;
+        }
+        if (result.dispatchedCount != 1 || result.unhandledCount != 1 || result.status != ReadStatus::End)
+        {
+            return "dispatch should handle the mesh message and skip the ping";
+        }
+
+        // reading past the end fails all following reads
+        PayloadReader payload(std::span<const uint8_t>(packet).subspan(MessageHeaderSize, 3));
+        uint32_t value = 0;
+        uint8_t byte = 0;
+        if (payload.Read(value) || payload.Read(byte) || payload.IsValid())
+        {
+            return "reading past the end of a payload should fail";
+        }
+
+        // legacy ping, truncation and unknown versions
+        const uint8_t legacyPing[] = {LegacyPingPacket};
+        bool pinged = false;
+        dispatcher.Register(MessageType::Ping, [&](const MessageView& message) { pinged = message.payload.empty(); });
+        result = dispatcher.Dispatch(legacyPing);
+        if (!pinged || result.dispatchedCount != 1 || result.status != ReadStatus::End)
+        {
+            return "legacy ping should be dispatched as ping";
+        }
+
+        std::vector<uint8_t> truncated(packet.begin(), packet.end() - 1);
+        result = dispatcher.Dispatch(truncated);
+        if (result.dispatchedCount != 1 || result.status != ReadStatus::Truncated)
+        {
+            return "truncated message should not be dispatched";
+        }
+
+        std::vector<uint8_t> newer = packet;
+        newer[0] = ProtocolVersion + 1;
+        if (dispatcher.Dispatch(newer).status != ReadStatus::UnsupportedVersion)
+        {
+            return "newer protocol version should not be parsed";
+        }
+
+        dispatcher.Register(MeshType, nullptr);
+        if (dispatcher.IsRegistered(MeshType) || !dispatcher.IsRegistered(MessageType::Ping))
+        {
+            return "registering an empty handler should unregister the type";
+        }
+        return nullptr;
+    }
+
+    // Mutates valid packets (bit flips, overwritten sizes, truncation, appended garbage) and reads them back. The reader may
+    // reject them, but must never reach outside of the packet.
+    const char* CheckFuzzedPackets()
+    {
+        std::mt19937 random(1234);
+        std::vector<uint8_t> packet;
+        const char* error = nullptr;
+
+        for (uint32_t iteration = 0; iteration < 20000 && error == nullptr; ++iteration)
+        {
+            packet.clear();
+            WriteAppStatePacket(packet, 1 + random() % 8, random);
+
+            const uint32_t mutationCount = 1 + random() % 4;
+            for (uint32_t i = 0; i < mutationCount && !packet.empty(); ++i)
+            {
+                switch (random() % 4)
+                {
+                    case 0:
+                        packet[random() % packet.size()] ^= static_cast<uint8_t>(1 << (random() % 8));
+                        break;
+
+                    case 1:
+                        packet[random() % packet.size()] = static_cast<uint8_t>(random());
+                        break;
+
+                    case 2:
+                        packet.resize(random() % packet.size());
+                        break;
+
+                    default:
+                        packet.push_back(static_cast<uint8_t>(random()));
+                        break;
+                }
+            }
+
+            // copied to an exactly sized buffer, so that the address sanitizer catches reads past the end
+            const std::vector<uint8_t> fuzzed(packet.begin(), packet.end());
+            ReadAppStatePacket(fuzzed, error);
+        }
+        return error;
+    }
+
+    void BM_DataChannelProtocolChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckRoundTrip())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+            if (const char* error = CheckFuzzedPackets())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    void BM_DataChannelWriteTelemetry(benchmark::State& state)
+    {
+        const uint32_t messageCount = static_cast<uint32_t>(state.range(0));
+        std::vector<uint8_t> packet;
+        for (auto _ : state)
+        {
+            packet.clear();
+            MessageWriter writer(packet);
+            for (uint32_t i = 0; i < messageCount; ++i)
+            {
+                writer.BeginMessage(TelemetryType);
+                writer.Write(Telemetry{i, {1.0f, 2.0f, 3.0f}, {0.0f, 0.0f, 0.0f, 1.0f}});
+                writer.EndMessage();
+            }
+            benchmark::DoNotOptimize(packet.data());
+        }
+        state.SetItemsProcessed(state.iterations() * messageCount);
+        state.SetBytesProcessed(state.iterations() * packet.size());
+    }
+
+    void BM_DataChannelDispatchTelemetry(benchmark::State& state)
+    {
+        const uint32_t messageCount = static_cast<uint32_t>(state.range(0));
+        std::vector<uint8_t> packet;
+        MessageWriter writer(packet);
+        for (uint32_t i = 0; i < messageCount; ++i)
+        {
+            writer.BeginMessage(TelemetryType);
+            writer.Write(Telemetry{i, {1.0f, 2.0f, 3.0f}, {0.0f, 0.0f, 0.0f, 1.0f}});
+            writer.EndMessage();
+        }
+
+        uint64_t timestampSum = 0;
+        MessageDispatcher dispatcher;
+        dispatcher.Register(TelemetryType, [&](const MessageView& message) {
+            PayloadReader payload(message.payload);
+            Telemetry telemetry;
+            if (payload.Read(telemetry))
+            {
+                timestampSum += telemetry.timestamp;
+            }
+        });
+
+        for (auto _ : state)
+        {
+            dispatcher.Dispatch(packet);
+        }
+        benchmark::DoNotOptimize(timestampSum);
+        state.SetItemsProcessed(state.iterations() * messageCount);
+        state.SetBytesProcessed(state.iterations() * packet.size());
+    }
+
+    void BM_DataChannelReadMixed(benchmark::State& state)
+    {
+        std::mt19937 random(42);
+        std::vector<uint8_t> packet;
+        WriteAppStatePacket(packet, static_cast<uint32_t>(state.range(0)), random);
+
+        const char* error = nullptr;
+        uint64_t messageCount = 0;
+        for (auto _ : state)
+        {
+            messageCount += ReadAppStatePacket(packet, error);
+        }
+        if (error != nullptr)
+        {
+            state.SkipWithError(error);
+            return;
+        }
+        state.SetItemsProcessed(messageCount);
+        state.SetBytesProcessed(state.iterations() * packet.size());
+    }
+} // namespace
+
+BENCHMARK(BM_DataChannelProtocolChecks)->Iterations(1);
+BENCHMARK(BM_DataChannelWriteTelemetry)->Arg(16)->Arg(256);
+BENCHMARK(BM_DataChannelDispatchTelemetry)->Arg(16)->Arg(256);
+BENCHMARK(BM_DataChannelReadMixed)->Arg(256);
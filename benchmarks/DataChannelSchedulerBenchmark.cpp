@@ -0,0 +1,425 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <DataChannelScheduler.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <span>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    using namespace DataChannel;
+    using Clock = MessageScheduler::Clock;
+
+    constexpr MessageType TrafficType = MessageType::FirstApplicationType;
+
+    // Payload of the simulated messages, padded to the message size.
+    struct TrafficHeader
+    {
+        uint8_t trafficClass;
+        int64_t enqueueTime; // nanoseconds since the start of the simulation
+    };
+
+    std::vector<uint8_t> MakeMessage(TrafficClass trafficClass, Clock::duration enqueueTime, size_t payloadSize)
+    {
+        std::vector<uint8_t> packet;
+        MessageWriter writer(packet);
+        writer.BeginMessage(TrafficType);
+        writer.Write(TrafficHeader{static_cast<uint8_t>(trafficClass), std::chrono::nanoseconds(enqueueTime).count()});
+        writer.WriteBytes(std::vector<uint8_t>(payloadSize - std::min(payloadSize, sizeof(TrafficHeader) + 4)));
+        writer.EndMessage();
+        return packet;
+    }
+
+    struct ClassDelivery
+    {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+        Clock::duration totalLatency{0};
+        Clock::duration maxLatency{0};
+    };
+
+    // Data channel with a send queue which drains at a rate given by a curve over time. Delivered messages are parsed to
+    // measure the latency from enqueueing to leaving the channel.
+    class SimulatedChannel : public IPacketTransport
+    {
+    public:
+        bool SendPacket(std::span<const uint8_t> packet, bool) override
+        {
+            m_packets.push_back({std::vector<uint8_t>(packet.begin(), packet.end()), 0});
+            queuedBytes += packet.size();
+            maxQueuedBytes = std::max(maxQueuedBytes, queuedBytes);
+            return true;
+        }
+
+        // Drains the bytes the channel can send until now.
+        void Drain(Clock::duration now, double bytes)
+        {
+            m_drainCredit += bytes;
+            while (!m_packets.empty() && m_drainCredit > 0.0)
+            {
+                Packet& packet = m_packets.front();
+                const size_t drained = std::min(packet.bytes.size() - packet.drained, static_cast<size_t>(m_drainCredit));
+                packet.drained += drained;
+                queuedBytes -= drained;
+                m_drainCredit -= static_cast<double>(drained);
+                if (packet.drained < packet.bytes.size())
+                {
+                    break;
+                }
+                Deliver(now, packet.bytes);
+                m_packets.pop_front();
+            }
+            // unused capacity is lost
+            if (m_packets.empty())
+            {
+                m_drainCredit = 0.0;
+            }
+        }
+
+        size_t queuedBytes = 0;
+        size_t maxQueuedBytes = 0;
+        std::array<ClassDelivery, TrafficClassCount> delivered{};
+
+    private:
+        struct Packet
+        {
+            std::vector<uint8_t> bytes;
+            size_t drained;
+        };
+
+        void Deliver(Clock::duration now, std::span<const uint8_t> packet)
+        {
+            PacketReader reader(packet);
+            MessageView message;
+            while (reader.Next(message) == ReadStatus::Ok)
+            {
+                TrafficHeader header;
+                PayloadReader payload(message.payload);
+                if (payload.Read(header))
+                {
+                    ClassDelivery& delivery = delivered[header.trafficClass];
+                    const Clock::duration latency = now - std::chrono::nanoseconds(header.enqueueTime);
+                    ++delivery.count;
+                    delivery.bytes += MessageHeaderSize + message.payload.size();
+                    delivery.totalLatency += latency;
+                    delivery.maxLatency = std::max(delivery.maxLatency, latency);
+                }
+            }
+        }
+
+        std::deque<Packet> m_packets;
+        double m_drainCredit = 0.0;
+    };
+
+    // Drain rate of the channel over time, in bytes per second.
+    using DrainRateCurve = std::function<double(double seconds)>;
+
+    const DrainRateCurve ConstantCurve = [](double) { return 2.0e6; };
+    const DrainRateCurve StepCurve = [](double t) { return t >= 2.0 && t < 4.0 ? 0.5e6 : 4.0e6; };
+    const DrainRateCurve OscillatingCurve = [](double t) { return 1.5e6 + 1.0e6 * std::sin(2.0 * 3.14159265358979 * t); };
+
+    struct SimulationResult
+    {
+        std::array<ClassDelivery, TrafficClassCount> delivered;
+        double capacityBytes = 0.0;
+        size_t maxChannelQueue = 0;
+    };
+
+    // Pose updates at 90 Hz (critical, coalescing), annotations at 30 Hz (interactive) and a bulk transfer which always has
+    // data to send, over 6 seconds in 1 ms steps. Without a scheduler, messages are sent right away as long as the send queue
+    // of the channel is below 1 MiB, like the samples did before.
+    SimulationResult Simulate(const DrainRateCurve& curve, bool scheduled)
+    {
+        constexpr Clock::duration Step = 1ms;
+        constexpr Clock::duration Duration = 6s;
+        constexpr size_t BulkChunkSize = 16 * 1024;
+        const Clock::time_point start{};
+
+        SimulatedChannel channel;
+        MessageScheduler scheduler(channel, start);
+        SimulationResult result;
+
+        const auto send = [&](TrafficClass trafficClass, Clock::duration now, size_t size, uint64_t coalescingKey) {
+            const std::vector<uint8_t> message = MakeMessage(trafficClass, now, size);
+            if (scheduled)
+            {
+                scheduler.Enqueue(trafficClass, message, start + now, coalescingKey);
+            }
+            else if (channel.queuedBytes < 1024 * 1024)
+            {
+                channel.SendPacket(message, true);
+            }
+        };
+
+        for (Clock::duration now{0}; now < Duration; now += Step)
+        {
+            if (now % 11ms == 0ms)
+            {
+                send(TrafficClass::Critical, now, 64, 1);
+            }
+            if (now % 33ms == 0ms)
+            {
+                send(TrafficClass::Interactive, now, 200, MessageScheduler::NoCoalescing);
+            }
+            if (scheduled)
+            {
+                while (scheduler.GetQueuedBytes(TrafficClass::Bulk) + BulkChunkSize <= 512 * 1024)
+                {
+                    send(TrafficClass::Bulk, now, BulkChunkSize, MessageScheduler::NoCoalescing);
+                }
+                scheduler.Service(start + now, channel.queuedBytes);
+            }
+            else
+            {
+                while (channel.queuedBytes < 1024 * 1024)
+                {
+                    send(TrafficClass::Bulk, now, BulkChunkSize, MessageScheduler::NoCoalescing);
+                }
+            }
+
+            const double rate = curve(std::chrono::duration<double>(now).count());
+            const double capacity = rate * std::chrono::duration<double>(Step).count();
+            result.capacityBytes += capacity;
+            channel.Drain(now + Step, capacity);
+        }
+
+        result.delivered = channel.delivered;
+        result.maxChannelQueue = channel.maxQueuedBytes;
+        return result;
+    }
+
+    double ToMilliseconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    const char* CheckSchedulerQueues()
+    {
+        const Clock::time_point start{};
+        const auto message = [](TrafficClass trafficClass, size_t size) { return MakeMessage(trafficClass, 0ms, size); };
+
+        // critical messages go first, the others wait for tokens
+        {
+            SimulatedChannel channel;
+            SchedulerSettings settings;
+            settings.initialRate = 40 * 1000; // 500 bytes of tokens per 10 ms at the probing rate
+            MessageScheduler scheduler(channel, start, settings);
+            scheduler.Enqueue(TrafficClass::Bulk, message(TrafficClass::Bulk, 800), start);
+            scheduler.Enqueue(TrafficClass::Interactive, message(TrafficClass::Interactive, 800), start);
+            scheduler.Enqueue(TrafficClass::Critical, message(TrafficClass::Critical, 100), start);
+            scheduler.Service(start + 10ms, 0);
+            channel.Drain(10ms, 1e9);
+
+            if (channel.delivered[0].count != 1 || channel.delivered[0].maxLatency != 10ms)
+            {
+                return "critical message should be sent first";
+            }
+            if (channel.delivered[1].count != 1 || channel.delivered[2].count != 0)
+            {
+                return "token bucket should hold back non-critical messages";
+            }
+        }
+
+        // byte budgets: drop oldest and reject newest
+        {
+            SimulatedChannel channel;
+            SchedulerSettings settings;
+            settings.classes[0] = {1000, OverflowPolicy::DropOldest, 1};
+            settings.classes[2] = {1000, OverflowPolicy::RejectNewest, 1};
+            MessageScheduler scheduler(channel, start, settings);
+            for (int i = 0; i < 5; ++i)
+            {
+                scheduler.Enqueue(TrafficClass::Critical, message(TrafficClass::Critical, 300), start);
+                scheduler.Enqueue(TrafficClass::Bulk, message(TrafficClass::Bulk, 300), start);
+            }
+            const TrafficClassStatistics& critical = scheduler.GetStatistics(TrafficClass::Critical);
+            const TrafficClassStatistics& bulk = scheduler.GetStatistics(TrafficClass::Bulk);
+            if (critical.droppedCount != 2 || critical.rejectedCount != 0 || scheduler.GetQueuedBytes(TrafficClass::Critical) > 1000)
+            {
+                return "drop oldest policy should keep the newest messages within the budget";
+            }
+            if (bulk.rejectedCount != 2 || bulk.droppedCount != 0 || scheduler.GetQueuedBytes(TrafficClass::Bulk) > 1000)
+            {
+                return "reject newest policy should keep the oldest messages within the budget";
+            }
+        }
+
+        // coalescing replaces the queued state in place
+        {
+            SimulatedChannel channel;
+            MessageScheduler scheduler(channel, start);
+            scheduler.Enqueue(TrafficClass::Critical, MakeMessage(TrafficClass::Critical, 1ms, 64), start, 7);
+            scheduler.Enqueue(TrafficClass::Critical, MakeMessage(TrafficClass::Critical, 2ms, 64), start, 8);
+            if (scheduler.Enqueue(TrafficClass::Critical, MakeMessage(TrafficClass::Critical, 3ms, 64), start, 7) !=
+                EnqueueResult::Coalesced)
+            {
+                return "message with a queued coalescing key should coalesce";
+            }
+            scheduler.Service(start + 1ms, 0);
+            channel.Drain(10ms, 1e9);
+            // latest state of key 7 first (7 ms since enqueued at 3 ms), then key 8 (8 ms)
+            const ClassDelivery& critical = channel.delivered[0];
+            if (critical.count != 2 || critical.maxLatency != 8ms || critical.totalLatency != 15ms)
+            {
+                return "coalesced message should keep its place with the latest content";
+            }
+        }
+
+        // a packet queued with EnqueuePacket is sent on its own, between the packets of the messages queued around it
+        {
+            class RecordingTransport : public IPacketTransport
+            {
+            public:
+                bool SendPacket(std::span<const uint8_t> packet, bool) override
+                {
+                    packets.emplace_back(packet.begin(), packet.end());
+                    return true;
+                }
+
+                std::vector<std::vector<uint8_t>> packets;
+            };
+
+            RecordingTransport transport;
+            MessageScheduler scheduler(transport, start);
+            const std::vector<uint8_t> first = message(TrafficClass::Critical, 100);
+            const std::vector<uint8_t> second = message(TrafficClass::Critical, 120);
+            const uint8_t legacyPing = LegacyPingPacket;
+            scheduler.Enqueue(TrafficClass::Critical, first, start);
+            scheduler.EnqueuePacket(TrafficClass::Critical, {&legacyPing, 1}, start);
+            scheduler.Enqueue(TrafficClass::Critical, second, start);
+            scheduler.Service(start + 1ms, 0);
+            if (transport.packets.size() != 3 || transport.packets[0] != first ||
+                transport.packets[1] != std::vector<uint8_t>{legacyPing} || transport.packets[2] != second)
+            {
+                return "a packet queued with EnqueuePacket should be sent on its own and in order";
+            }
+        }
+
+        // interactive and bulk share the bandwidth by weight while both are backlogged
+        {
+            SimulatedChannel channel;
+            SchedulerSettings settings;
+            settings.initialRate = 1.0e6;
+            settings.probeFactor = 1.0;
+            settings.drainRateSmoothing = 0.0;
+            MessageScheduler scheduler(channel, start, settings);
+            for (Clock::duration now = 1ms; now <= 1s; now += 1ms)
+            {
+                while (scheduler.GetQueuedBytes(TrafficClass::Interactive) < 8 * 1024)
+                {
+                    scheduler.Enqueue(TrafficClass::Interactive, message(TrafficClass::Interactive, 400), start + now);
+                }
+                while (scheduler.GetQueuedBytes(TrafficClass::Bulk) < 8 * 1024)
+                {
+                    scheduler.Enqueue(TrafficClass::Bulk, message(TrafficClass::Bulk, 400), start + now);
+                }
+                scheduler.Service(start + now, 0);
+            }
+            const double share = double(scheduler.GetStatistics(TrafficClass::Interactive).sentBytes) /
+                                 double(scheduler.GetStatistics(TrafficClass::Bulk).sentBytes);
+            if (share < 2.7 || share > 3.3)
+            {
+                return "interactive and bulk should share the bandwidth 3:1";
+            }
+        }
+        return nullptr;
+    }
+
+    const char* CheckSchedulerSimulation()
+    {
+        for (const DrainRateCurve* curve : {&ConstantCurve, &StepCurve, &OscillatingCurve})
+        {
+            const SimulationResult unscheduled = Simulate(*curve, false);
+            const SimulationResult scheduled = Simulate(*curve, true);
+
+            const ClassDelivery& critical = scheduled.delivered[0];
+            if (critical.count < 500 || scheduled.delivered[1].count < 170 || scheduled.delivered[2].count == 0)
+            {
+                return "all classes should be delivered";
+            }
+            if (critical.maxLatency > 150ms || critical.maxLatency * 5 > unscheduled.delivered[0].maxLatency)
+            {
+                return "bulk traffic should not delay critical messages";
+            }
+
+            uint64_t deliveredBytes = 0;
+            for (const ClassDelivery& delivery : scheduled.delivered)
+            {
+                deliveredBytes += delivery.bytes;
+            }
+            if (double(deliveredBytes) < 0.85 * scheduled.capacityBytes)
+            {
+                return "shaper should use the bandwidth of the channel";
+            }
+        }
+        return nullptr;
+    }
+
+    void BM_DataChannelSchedulerChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckSchedulerQueues())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+            if (const char* error = CheckSchedulerSimulation())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Arguments: drain rate curve (0 constant, 1 step, 2 oscillating), scheduled (1) or sent right away (0).
+    void BM_DataChannelSchedulerSimulation(benchmark::State& state)
+    {
+        const DrainRateCurve* curves[] = {&ConstantCurve, &StepCurve, &OscillatingCurve};
+        SimulationResult result;
+        for (auto _ : state)
+        {
+            result = Simulate(*curves[state.range(0)], state.range(1) != 0);
+        }
+
+        uint64_t deliveredBytes = 0;
+        for (const ClassDelivery& delivery : result.delivered)
+        {
+            deliveredBytes += delivery.bytes;
+        }
+        const ClassDelivery& critical = result.delivered[0];
+        const ClassDelivery& interactive = result.delivered[1];
+        state.counters["CriticalMaxMs"] = ToMilliseconds(critical.maxLatency);
+        state.counters["CriticalAvgMs"] = critical.count > 0 ? ToMilliseconds(critical.totalLatency) / double(critical.count) : 0.0;
+        state.counters["InteractiveMaxMs"] = ToMilliseconds(interactive.maxLatency);
+        state.counters["Utilization"] = double(deliveredBytes) / result.capacityBytes;
+        state.counters["ChannelQueueKiB"] = double(result.maxChannelQueue) / 1024.0;
+    }
+} // namespace
+
+BENCHMARK(BM_DataChannelSchedulerChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DataChannelSchedulerSimulation)
+    ->ArgsProduct({{0, 1, 2}, {0, 1}})
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,429 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <DataChannelScheduler.h>
+#include <DataChannelStream.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <numeric>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    using namespace DataChannel;
+
+    constexpr MessageType MeshType = MessageType::FirstApplicationType;
+    constexpr MessageType PoseType = static_cast<MessageType>(static_cast<uint16_t>(MessageType::FirstApplicationType) + 1);
+
+    // In-memory channel which keeps the sent packets until they are delivered, and rejects packets at random to exercise the
+    // backpressure handling of the sender.
+    class LoopbackChannel : public IPacketTransport
+    {
+    public:
+        explicit LoopbackChannel(uint32_t seed = 0, double rejectProbability = 0.0)
+            : m_random(seed)
+            , m_rejectProbability(rejectProbability)
+        {
+        }
+
+        bool SendPacket(std::span<const uint8_t> packet, bool) override
+        {
+            if (m_rejectProbability > 0.0 && std::bernoulli_distribution(m_rejectProbability)(m_random))
+            {
+                return false;
+            }
+            packets.emplace_back(packet.begin(), packet.end());
+            return true;
+        }
+
+        void Deliver(MessageDispatcher& dispatcher)
+        {
+            for (const std::vector<uint8_t>& packet : packets)
+            {
+                dispatcher.Dispatch(packet);
+            }
+            packets.clear();
+        }
+
+        std::deque<std::vector<uint8_t>> packets;
+
+    private:
+        std::mt19937 m_random;
+        double m_rejectProbability;
+    };
+
+    std::vector<uint8_t> MakePayload(size_t size, uint32_t seed)
+    {
+        std::vector<uint8_t> payload(size);
+        std::mt19937 random(seed);
+        for (uint8_t& value : payload)
+        {
+            value = static_cast<uint8_t>(random());
+        }
+        return payload;
+    }
+
+    // Splits the payload into segments at random positions, including empty segments.
+    std::vector<std::span<const uint8_t>> SplitPayload(std::span<const uint8_t> payload, std::mt19937& random)
+    {
+        std::vector<size_t> cuts(std::uniform_int_distribution<size_t>(0, 5)(random));
+        for (size_t& cut : cuts)
+        {
+            cut = std::uniform_int_distribution<size_t>(0, payload.size())(random);
+        }
+        cuts.push_back(0);
+        cuts.push_back(payload.size());
+        std::sort(cuts.begin(), cuts.end());
+
+        std::vector<std::span<const uint8_t>> segments;
+        for (size_t i = 1; i < cuts.size(); ++i)
+        {
+            segments.push_back(payload.subspan(cuts[i - 1], cuts[i] - cuts[i - 1]));
+        }
+        return segments;
+    }
+
+    // Sends several streams with random sizes and segmentation at once, interleaved with pose messages, while the channel
+    // rejects packets at random and some streams are cancelled on either side. Every completed stream has to match its
+    // payload, cancelled ones must not complete, and the progress of each stream has to grow up to its size.
+    const char* CheckRandomizedLoopback(uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        LoopbackChannel channel(seed, 0.2);
+        StreamSender sender(channel);
+
+        struct StreamRecord
+        {
+            std::vector<uint8_t> payload;
+            uint64_t sentProgress = 0;
+            uint64_t receivedProgress = 0;
+            StreamState senderState = StreamState::InProgress;
+            StreamState receiverState = StreamState::InProgress;
+            bool progressValid = true;
+        };
+        std::map<uint32_t, StreamRecord> streams;
+        const auto track = [&streams](uint64_t StreamRecord::*transferred, StreamState StreamRecord::*state) {
+            return [&streams, transferred, state](const StreamProgress& progress) {
+                StreamRecord& record = streams[progress.streamId];
+                record.progressValid = record.progressValid && progress.transferredBytes >= record.*transferred &&
+                                       progress.totalBytes == record.payload.size() && record.*state == StreamState::InProgress;
+                record.*transferred = progress.transferredBytes;
+                record.*state = progress.state;
+            };
+        };
+
+        const char* error = nullptr;
+        StreamReceiver receiver(
+            [&](uint32_t streamId, MessageType contentType, std::vector<uint8_t>&& payload) {
+                if (contentType != MeshType || payload != streams[streamId].payload)
+                {
+                    error = "reassembled stream should match the sent payload";
+                }
+            },
+            track(&StreamRecord::receivedProgress, &StreamRecord::receiverState));
+        MessageDispatcher dispatcher;
+        receiver.Register(dispatcher);
+        uint32_t receivedPoseCount = 0;
+        dispatcher.Register(PoseType, [&](const MessageView&) { ++receivedPoseCount; });
+
+        const size_t streamCount = std::uniform_int_distribution<size_t>(1, 6)(random);
+        std::vector<std::vector<std::span<const uint8_t>>> segments(streamCount);
+        for (size_t i = 0; i < streamCount; ++i)
+        {
+            // some streams are empty or end on a chunk boundary
+            size_t size = std::uniform_int_distribution<size_t>(0, 200 * 1024)(random);
+            size = i % 4 == 1 ? 0 : i % 4 == 2 ? size - size % StreamSenderSettings{}.chunkSize : size;
+
+            std::vector<uint8_t> payload = MakePayload(size, seed * 16 + static_cast<uint32_t>(i));
+            const uint32_t expectedId = static_cast<uint32_t>(i + 1);
+            streams[expectedId].payload = std::move(payload);
+            segments[i] = SplitPayload(streams[expectedId].payload, random);
+            if (sender.Send(MeshType, segments[i], track(&StreamRecord::sentProgress, &StreamRecord::senderState)) != expectedId)
+            {
+                return "stream ids should be assigned in order";
+            }
+        }
+
+        uint32_t sentPoseCount = 0;
+        for (int step = 0; step < 100000 && (sender.HasPendingMessages() || !channel.packets.empty()); ++step)
+        {
+            // other traffic between the chunks
+            std::vector<uint8_t> pose;
+            MessageWriter(pose).WriteMessage(PoseType);
+            if (channel.SendPacket(pose, true))
+            {
+                ++sentPoseCount;
+            }
+
+            sender.Pump(std::uniform_int_distribution<size_t>(1, 8 * 1024)(random));
+
+            const uint32_t action = std::uniform_int_distribution<uint32_t>(0, 999)(random);
+            const uint32_t streamId = std::uniform_int_distribution<uint32_t>(1, static_cast<uint32_t>(streamCount))(random);
+            if (action == 0)
+            {
+                sender.Cancel(streamId);
+            }
+            else if (action == 1)
+            {
+                receiver.Cancel(streamId);
+            }
+
+            // deliver some of the sent packets
+            const size_t deliverCount = std::uniform_int_distribution<size_t>(0, channel.packets.size())(random);
+            for (size_t i = 0; i < deliverCount; ++i)
+            {
+                dispatcher.Dispatch(channel.packets.front());
+                channel.packets.pop_front();
+            }
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        if (sender.GetActiveStreamCount() > 0 || receiver.GetActiveStreamCount() > 0)
+        {
+            return "all streams should be completed or cancelled";
+        }
+        if (receivedPoseCount != sentPoseCount)
+        {
+            return "other traffic should be delivered between the chunks";
+        }
+        for (const auto& [streamId, record] : streams)
+        {
+            if (!record.progressValid || record.senderState == StreamState::InProgress || record.receiverState == StreamState::InProgress)
+            {
+                return "progress should grow and end in one final state";
+            }
+            if (record.senderState == StreamState::Completed && record.sentProgress != record.payload.size())
+            {
+                return "completed stream should have sent all bytes";
+            }
+            if (record.senderState == StreamState::Cancelled && record.receiverState != StreamState::Cancelled)
+            {
+                return "stream cancelled by the sender should be cancelled on the receiver";
+            }
+            if (record.receiverState == StreamState::Completed && record.receivedProgress != record.payload.size())
+            {
+                return "completed stream should have received all bytes";
+            }
+        }
+        return nullptr;
+    }
+
+    const char* CheckStreamReassembly()
+    {
+        // chunks in any order, with duplicates and chunks which do not belong to the stream
+        {
+            LoopbackChannel channel;
+            StreamSender sender(channel);
+            const std::vector<uint8_t> payload = MakePayload(50 * 1000, 1);
+            sender.Send(MeshType, payload);
+            sender.Pump();
+
+            std::vector<std::vector<uint8_t>> chunks(channel.packets.begin() + 1, channel.packets.end());
+            std::shuffle(chunks.begin(), chunks.end(), std::mt19937(1));
+            chunks.push_back(chunks.front());
+            std::vector<uint8_t> invalid;
+            MessageWriter writer(invalid);
+            writer.BeginMessage(MessageType::StreamChunk);
+            writer.Write(uint32_t(1));
+            writer.Write(uint32_t(1000));
+            writer.EndMessage();
+            writer.BeginMessage(MessageType::StreamChunk);
+            writer.Write(uint32_t(2));
+            writer.Write(uint32_t(0));
+            writer.EndMessage();
+            writer.BeginMessage(MessageType::StreamChunk);
+            writer.Write(uint32_t(1));
+            writer.Write(uint32_t(2));
+            writer.WriteRawBytes(payload);
+            writer.EndMessage();
+            chunks.insert(chunks.begin() + chunks.size() / 2, invalid);
+
+            std::vector<uint8_t> received;
+            StreamReceiver receiver([&](uint32_t, MessageType, std::vector<uint8_t>&& data) { received = std::move(data); });
+            MessageDispatcher dispatcher;
+            receiver.Register(dispatcher);
+            dispatcher.Dispatch(channel.packets.front());
+            for (const std::vector<uint8_t>& chunk : chunks)
+            {
+                dispatcher.Dispatch(chunk);
+            }
+            if (received != payload || receiver.GetStatistics().ignoredChunkCount != 4)
+            {
+                return "stream should be reassembled from chunks in any order";
+            }
+        }
+
+        // limits of the receiver
+        {
+            LoopbackChannel channel;
+            StreamSender sender(channel);
+            const std::vector<uint8_t> payload(2000);
+            sender.Send(MeshType, payload);
+            sender.Send(MeshType, payload);
+            sender.Send(MeshType, std::span(payload).first(1000));
+            sender.Pump();
+
+            StreamReceiverSettings settings;
+            settings.maxStreamSize = 1500;
+            settings.maxActiveStreamCount = 1;
+            uint32_t completedCount = 0;
+            StreamReceiver receiver([&](uint32_t, MessageType, std::vector<uint8_t>&&) { ++completedCount; }, {}, settings);
+            MessageDispatcher dispatcher;
+            receiver.Register(dispatcher);
+            channel.Deliver(dispatcher);
+            if (completedCount != 1 || receiver.GetStatistics().rejectedCount != 2)
+            {
+                return "streams over the limits should be rejected";
+            }
+        }
+
+        for (uint32_t seed = 1; seed <= 200; ++seed)
+        {
+            if (const char* error = CheckRandomizedLoopback(seed))
+            {
+                return error;
+            }
+        }
+        return nullptr;
+    }
+
+    // A large stream queued as bulk traffic does not hold back interactive messages queued after it: they are sent within the
+    // next packets instead of after the stream.
+    const char* CheckStreamInterleaving()
+    {
+        using Clock = MessageScheduler::Clock;
+        const Clock::time_point start{};
+
+        LoopbackChannel channel;
+        SchedulerSettings settings;
+        settings.initialRate = 1.0e6;
+        settings.maxRate = 1.0e6;
+        MessageScheduler scheduler(channel, start, settings);
+        ScheduledTransport bulkTransport(scheduler, TrafficClass::Bulk);
+        StreamSender sender(bulkTransport);
+
+        const std::vector<uint8_t> payload = MakePayload(4 * 1024 * 1024, 2);
+        sender.Send(MeshType, payload);
+
+        size_t poseIndex = 0;
+        for (Clock::duration now = 1ms; now <= 100ms; now += 1ms)
+        {
+            sender.Pump();
+            if (now == 50ms)
+            {
+                std::vector<uint8_t> pose;
+                MessageWriter(pose).WriteMessage(PoseType);
+                scheduler.Enqueue(TrafficClass::Interactive, pose, start + now);
+                poseIndex = channel.packets.size();
+            }
+            scheduler.Service(start + now, 0);
+        }
+
+        // The pose goes out with the next round of the scheduler, after at most one bulk packet.
+        for (size_t i = poseIndex; i < std::min(poseIndex + 2, channel.packets.size()); ++i)
+        {
+            PacketReader reader(channel.packets[i]);
+            MessageView message;
+            while (reader.Next(message) == ReadStatus::Ok)
+            {
+                if (message.type == PoseType)
+                {
+                    return sender.GetActiveStreamCount() == 1 ? nullptr : "stream should still be in progress";
+                }
+            }
+        }
+        return "interactive message should not wait for the stream";
+    }
+
+    void BM_DataChannelStreamChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckStreamReassembly())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+            if (const char* error = CheckStreamInterleaving())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Sends and reassembles a payload of range(0) bytes from range(1) segments, like a spatial mesh snapshot.
+    void BM_DataChannelStreamLoopback(benchmark::State& state)
+    {
+        const std::vector<uint8_t> payload = MakePayload(static_cast<size_t>(state.range(0)), 3);
+        std::vector<std::span<const uint8_t>> segments;
+        const size_t segmentSize = payload.size() / static_cast<size_t>(state.range(1));
+        for (size_t offset = 0; offset < payload.size(); offset += segmentSize)
+        {
+            segments.push_back(std::span(payload).subspan(offset, std::min(segmentSize, payload.size() - offset)));
+        }
+
+        // The channel hands each packet to the receiver right away.
+        class DirectChannel : public IPacketTransport
+        {
+        public:
+            explicit DirectChannel(MessageDispatcher& dispatcher)
+                : m_dispatcher(dispatcher)
+            {
+            }
+
+            bool SendPacket(std::span<const uint8_t> packet, bool) override
+            {
+                m_dispatcher.Dispatch(packet);
+                return true;
+            }
+
+        private:
+            MessageDispatcher& m_dispatcher;
+        };
+
+        size_t receivedSize = 0;
+        StreamReceiver receiver([&](uint32_t, MessageType, std::vector<uint8_t>&& data) { receivedSize = data.size(); });
+        MessageDispatcher dispatcher;
+        receiver.Register(dispatcher);
+        DirectChannel channel(dispatcher);
+        StreamSender sender(channel);
+
+        for (auto _ : state)
+        {
+            sender.Send(MeshType, segments);
+            sender.Pump();
+            benchmark::DoNotOptimize(receivedSize);
+        }
+        if (receivedSize != payload.size())
+        {
+            state.SkipWithError("stream should be reassembled");
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+    }
+} // namespace
+
+BENCHMARK(BM_DataChannelStreamChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DataChannelStreamLoopback)->ArgsProduct({{64 * 1024, 4 * 1024 * 1024}, {1, 16}})->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,405 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <FramePipeline.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Mimics the frame pacing of xrWaitFrame, xrBeginFrame and xrEndFrame. WaitFrame blocks until the previously waited frame
+    // has begun, then returns at the start of the next display period, at most once per period. A frame is displayed at the
+    // first period boundary after it has ended, and is late when that is after its predicted display time (two periods after
+    // WaitFrame returned). Violations of the call order are recorded as errors.
+    class SimulatedXrRuntime
+    {
+    public:
+        struct FrameState
+        {
+            uint64_t frameIndex;
+            Clock::time_point waitTime;
+            Clock::time_point predictedDisplayTime;
+        };
+
+        explicit SimulatedXrRuntime(Clock::duration period)
+            : m_period(period)
+            , m_start(Clock::now())
+            , m_lastWaitBoundary(m_start - period)
+        {
+        }
+
+        FrameState WaitFrame()
+        {
+            Clock::time_point boundary;
+            uint64_t frameIndex;
+            {
+                std::unique_lock lock(m_mutex);
+                m_frameBegun.wait(lock, [&] { return m_begunCount == m_waitedCount; });
+
+                const Clock::duration sinceStart = Clock::now() - m_start;
+                boundary = m_start + ((sinceStart + m_period - Clock::duration(1)) / m_period) * m_period;
+                if (boundary <= m_lastWaitBoundary)
+                {
+                    boundary = m_lastWaitBoundary + m_period;
+                }
+                m_lastWaitBoundary = boundary;
+                frameIndex = m_waitedCount++;
+            }
+
+            std::this_thread::sleep_until(boundary);
+            return {frameIndex, boundary, boundary + 2 * m_period};
+        }
+
+        void BeginFrame(uint64_t frameIndex)
+        {
+            std::lock_guard lock(m_mutex);
+            if (frameIndex != m_begunCount || m_begunCount >= m_waitedCount)
+            {
+                m_error = "frame begun out of order or without waiting";
+            }
+            m_begunCount++;
+            m_frameBegun.notify_all();
+        }
+
+        void EndFrame(const FrameState& frame)
+        {
+            const Clock::time_point end = Clock::now();
+            std::lock_guard lock(m_mutex);
+            if (frame.frameIndex != m_endedCount || m_endedCount >= m_begunCount)
+            {
+                m_error = "frame ended out of order or without beginning";
+            }
+            m_endedCount++;
+
+            const Clock::duration sinceStart = end - m_start;
+            const Clock::time_point displayed = m_start + ((sinceStart + m_period - Clock::duration(1)) / m_period) * m_period;
+            m_lateCount += displayed > frame.predictedDisplayTime ? 1 : 0;
+            m_lastDisplayed = displayed;
+            m_latency += displayed - frame.waitTime;
+        }
+
+        // Error of the call order, or of frames waited but never ended.
+        const char* GetError() const
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_error == nullptr && (m_begunCount != m_waitedCount || m_endedCount != m_waitedCount))
+            {
+                return "waited frames should be begun and ended";
+            }
+            return m_error;
+        }
+
+        uint64_t GetEndedCount() const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_endedCount;
+        }
+
+        uint64_t GetLateCount() const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_lateCount;
+        }
+
+        // Display periods from the start to the display of the last frame.
+        double GetDisplayedPeriods() const
+        {
+            std::lock_guard lock(m_mutex);
+            return double((m_lastDisplayed - m_start) / m_period);
+        }
+
+        // Average time from the return of WaitFrame to the display of the frame.
+        Clock::duration GetAverageLatency() const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_endedCount > 0 ? m_latency / static_cast<Clock::rep>(m_endedCount) : Clock::duration(0);
+        }
+
+    private:
+        const Clock::duration m_period;
+        const Clock::time_point m_start;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_frameBegun;
+        Clock::time_point m_lastWaitBoundary;
+        Clock::time_point m_lastDisplayed{};
+        uint64_t m_waitedCount = 0;
+        uint64_t m_begunCount = 0;
+        uint64_t m_endedCount = 0;
+        uint64_t m_lateCount = 0;
+        Clock::duration m_latency{0};
+        const char* m_error = nullptr;
+    };
+
+    struct FramePacket
+    {
+        SimulatedXrRuntime::FrameState frame;
+        std::vector<uint64_t> holograms;
+    };
+
+    // Work of the simulation stage (input, hologram poses) and of the render stage (view location, draw, submission) of a
+    // frame. They wait instead of computing, like the real stages which mostly wait on the runtime and the GPU.
+    struct StageCosts
+    {
+        Clock::duration simulate;
+        Clock::duration render;
+    };
+
+    void SimulateHolograms(const SimulatedXrRuntime::FrameState& frame, FramePacket& packet, Clock::duration cost)
+    {
+        std::this_thread::sleep_for(cost);
+        packet.frame = frame;
+        packet.holograms.assign(4, frame.frameIndex);
+    }
+
+    void RenderHolograms(SimulatedXrRuntime& runtime, const FramePacket& packet, Clock::duration cost)
+    {
+        runtime.BeginFrame(packet.frame.frameIndex);
+        std::this_thread::sleep_for(cost);
+        runtime.EndFrame(packet.frame);
+    }
+
+    // The frame loop before pipelining: both stages on one thread.
+    void RunSerialFrames(SimulatedXrRuntime& runtime, const StageCosts& costs, uint64_t frameCount)
+    {
+        FramePacket packet;
+        for (uint64_t i = 0; i < frameCount; ++i)
+        {
+            SimulateHolograms(runtime.WaitFrame(), packet, costs.simulate);
+            RenderHolograms(runtime, packet, costs.render);
+        }
+    }
+
+    void RunPipelinedFrames(SimulatedXrRuntime& runtime, const StageCosts& costs, uint64_t frameCount)
+    {
+        sample::FramePipeline<FramePacket> pipeline([&](FramePacket& packet) { RenderHolograms(runtime, packet, costs.render); });
+        pipeline.Start();
+        for (uint64_t i = 0; i < frameCount; ++i)
+        {
+            FramePacket& packet = pipeline.BeginFrame();
+            SimulateHolograms(runtime.WaitFrame(), packet, costs.simulate);
+            pipeline.SubmitFrame();
+        }
+        pipeline.Stop();
+    }
+
+    const char* CheckPacketExchange()
+    {
+        struct Packet
+        {
+            uint64_t index = 0;
+            std::vector<uint64_t> values;
+        };
+
+        // packets arrive complete and in order, and close delivers the packets published before it
+        constexpr uint64_t PacketCount = 20000;
+        sample::FramePacketExchange<Packet> exchange;
+        const char* error = nullptr;
+        uint64_t receivedCount = 0;
+
+        std::thread consumer([&] {
+            while (Packet* packet = exchange.BeginRead())
+            {
+                if (packet->index != receivedCount || packet->values.size() != packet->index % 7)
+                {
+                    error = "packet received out of order";
+                }
+                for (uint64_t value : packet->values)
+                {
+                    if (value != packet->index)
+                    {
+                        error = "packet received before it was complete";
+                    }
+                }
+                ++receivedCount;
+                exchange.EndRead();
+            }
+        });
+
+        for (uint64_t i = 0; i < PacketCount; ++i)
+        {
+            Packet& packet = exchange.BeginWrite();
+            packet.index = i;
+            packet.values.assign(i % 7, i);
+            exchange.EndWrite();
+        }
+        exchange.Close();
+        consumer.join();
+
+        if (error != nullptr)
+        {
+            return error;
+        }
+        if (receivedCount != PacketCount)
+        {
+            return "closing should deliver all published packets";
+        }
+
+        // the producer is at most two packets ahead
+        exchange.Reset();
+        exchange.BeginWrite();
+        exchange.EndWrite();
+        exchange.BeginWrite();
+        exchange.EndWrite();
+        std::atomic<bool> thirdWritten = false;
+        std::thread producer([&] {
+            exchange.BeginWrite();
+            thirdWritten = true;
+            exchange.EndWrite();
+            exchange.Close();
+        });
+        std::this_thread::sleep_for(5ms);
+        const bool blocked = !thirdWritten;
+        int readCount = 0;
+        while (exchange.BeginRead() != nullptr)
+        {
+            ++readCount;
+            exchange.EndRead();
+        }
+        producer.join();
+        if (!blocked || readCount != 3)
+        {
+            return "producer should wait while both slots are full";
+        }
+        return nullptr;
+    }
+
+    const char* CheckPipeline()
+    {
+        // every waited frame is begun and ended in order, also when the render stage is slower than the display period
+        for (const StageCosts& costs : {StageCosts{200us, 300us}, StageCosts{600us, 2500us}})
+        {
+            SimulatedXrRuntime runtime(2ms);
+            RunPipelinedFrames(runtime, costs, 12);
+            if (const char* error = runtime.GetError())
+            {
+                return error;
+            }
+            if (runtime.GetEndedCount() != 12)
+            {
+                return "pipeline should render every submitted frame";
+            }
+        }
+
+        // an exception of the render stage is rethrown by BeginFrame, and the pipeline can be restarted
+        int renderedCount = 0;
+        sample::FramePipeline<FramePacket> pipeline([&](FramePacket& packet) {
+            if (packet.frame.frameIndex == 2)
+            {
+                throw std::runtime_error("render failed");
+            }
+            ++renderedCount;
+        });
+
+        pipeline.Start();
+        bool rethrown = false;
+        for (uint64_t i = 0; i < 100 && !rethrown; ++i)
+        {
+            try
+            {
+                pipeline.BeginFrame().frame.frameIndex = i;
+                pipeline.SubmitFrame();
+            }
+            catch (const std::runtime_error&)
+            {
+                rethrown = true;
+            }
+            std::this_thread::sleep_for(100us);
+        }
+        pipeline.Stop();
+        if (!rethrown || renderedCount != 2)
+        {
+            return "render exception should be rethrown by BeginFrame";
+        }
+
+        pipeline.Start();
+        pipeline.BeginFrame().frame.frameIndex = 3;
+        pipeline.SubmitFrame();
+        pipeline.Stop();
+        if (renderedCount != 3)
+        {
+            return "restarted pipeline should render again";
+        }
+        return nullptr;
+    }
+
+    void BM_FramePipelineChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckPacketExchange())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+            if (const char* error = CheckPipeline())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // A 4 ms display period with stages of 2 ms and 3 ms, which together miss every other period when run serially.
+    constexpr Clock::duration DisplayPeriod = 4ms;
+    constexpr StageCosts Costs = {2ms, 3ms};
+    constexpr uint64_t FrameCount = 30;
+
+    void ReportFrames(benchmark::State& state, const SimulatedXrRuntime& runtime)
+    {
+        if (const char* error = runtime.GetError())
+        {
+            state.SkipWithError(error);
+            return;
+        }
+        state.counters["PeriodsPerFrame"] = runtime.GetDisplayedPeriods() / double(runtime.GetEndedCount());
+        state.counters["LateFrames"] = double(runtime.GetLateCount());
+        state.counters["LatencyMs"] = std::chrono::duration<double, std::milli>(runtime.GetAverageLatency()).count();
+    }
+
+    void BM_FrameLoopSerial(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            SimulatedXrRuntime runtime(DisplayPeriod);
+            RunSerialFrames(runtime, Costs, FrameCount);
+            ReportFrames(state, runtime);
+        }
+    }
+
+    void BM_FrameLoopPipelined(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            SimulatedXrRuntime runtime(DisplayPeriod);
+            RunPipelinedFrames(runtime, Costs, FrameCount);
+            ReportFrames(state, runtime);
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_FramePipelineChecks)->Iterations(3);
+BENCHMARK(BM_FrameLoopSerial)->Iterations(2)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_FrameLoopPipelined)->Iterations(2)->Unit(benchmark::kMillisecond)->UseRealTime();
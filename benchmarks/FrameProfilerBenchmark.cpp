@@ -0,0 +1,288 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <FrameProfiler.h>
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace FrameProfiler;
+
+namespace
+{
+    // Counts the events without keeping them, to measure the recording alone.
+    class CountingSink : public EventSink
+    {
+    public:
+        void BeginSession(int64_t) override
+        {
+        }
+
+        void WriteThreadName(uint32_t, const std::string&) override
+        {
+        }
+
+        void WriteEvents(uint32_t, std::span<const Event> events) override
+        {
+            m_eventCount += events.size();
+        }
+
+        void EndSession(uint64_t droppedEventCount) override
+        {
+            m_droppedCount = droppedEventCount;
+        }
+
+        uint64_t m_eventCount = 0;
+        uint64_t m_droppedCount = 0;
+    };
+
+    // Keeps the events per thread.
+    class CapturingSink : public EventSink
+    {
+    public:
+        void BeginSession(int64_t startTime) override
+        {
+            m_startTime = startTime;
+        }
+
+        void WriteThreadName(uint32_t threadId, const std::string& name) override
+        {
+            m_threadNames[threadId] = name;
+        }
+
+        void WriteEvents(uint32_t threadId, std::span<const Event> events) override
+        {
+            std::vector<Event>& threadEvents = m_events[threadId];
+            threadEvents.insert(threadEvents.end(), events.begin(), events.end());
+        }
+
+        void EndSession(uint64_t droppedEventCount) override
+        {
+            m_droppedCount = droppedEventCount;
+            m_ended = true;
+        }
+
+        int64_t m_startTime = 0;
+        std::map<uint32_t, std::string> m_threadNames;
+        std::map<uint32_t, std::vector<Event>> m_events;
+        uint64_t m_droppedCount = 0;
+        bool m_ended = false;
+    };
+
+    // The cost of a scope in a build with the profiler compiled in, while nothing is recorded.
+    void BM_FrameProfilerScopeIdle(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            FRAME_PROFILER_SCOPE("Idle");
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // The cost of a scope while recording, with the flusher draining the ring in the background. The ring holds more events
+    // than the benchmark records between two flushes, so that no event is dropped. Reading the clock twice makes up most of it.
+    void BM_FrameProfilerScopeRecording(benchmark::State& state)
+    {
+        CountingSink sink;
+        Settings settings;
+        settings.eventsPerThread = 1 << 20;
+        settings.flushInterval = std::chrono::milliseconds(1);
+        Start(sink, settings);
+
+        for (auto _ : state)
+        {
+            FRAME_PROFILER_SCOPE("Recording");
+            benchmark::ClobberMemory();
+        }
+
+        Stop();
+        state.counters["dropped"] = static_cast<double>(sink.m_droppedCount);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_FrameProfilerChromeTraceWrite(benchmark::State& state)
+    {
+        std::vector<Event> events(1024);
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            events[i] = {i % 2 ? "Render" : "Update", int64_t(i) * 16'666'667, int64_t(i) * 16'666'667 + 4'000'000};
+        }
+
+        std::ostringstream stream;
+        ChromeTraceWriter writer(stream);
+        for (auto _ : state)
+        {
+            stream.str({});
+            writer.BeginSession(0);
+            writer.WriteEvents(1, events);
+            writer.EndSession(0);
+            benchmark::DoNotOptimize(stream.tellp());
+        }
+        state.SetItemsProcessed(state.iterations() * events.size());
+    }
+
+    // Checks that the events of several threads arrive complete and in order, that a full ring drops and counts the events, and
+    // the JSON the trace writer produces.
+    void BM_FrameProfilerChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            constexpr int ThreadCount = 4;
+            constexpr int FrameCount = 5000;
+
+            CapturingSink sink;
+            Settings settings;
+            settings.eventsPerThread = 256;
+            settings.flushInterval = std::chrono::milliseconds(1);
+            Start(sink, settings);
+
+            std::vector<std::thread> threads;
+            for (int t = 0; t < ThreadCount; ++t)
+            {
+                threads.emplace_back([t]() {
+                    const std::string name = "Worker " + std::to_string(t);
+                    FRAME_PROFILER_THREAD_NAME(name.c_str());
+                    for (int frame = 0; frame < FrameCount; ++frame)
+                    {
+                        FRAME_PROFILER_SCOPE("Frame");
+                        {
+                            FRAME_PROFILER_SCOPE("Update");
+                        }
+                        {
+                            FRAME_PROFILER_SCOPE("Render");
+                        }
+                        // Leave the flusher time to drain the small ring.
+                        if (frame % 32 == 0)
+                        {
+                            std::this_thread::sleep_for(std::chrono::microseconds(200));
+                        }
+                    }
+                });
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+            Stop();
+
+            if (!sink.m_ended || sink.m_events.size() != ThreadCount || sink.m_threadNames.size() != ThreadCount)
+            {
+                state.SkipWithError("threads missing from the trace");
+                return;
+            }
+
+            uint64_t eventCount = 0;
+            for (const auto& [threadId, events] : sink.m_events)
+            {
+                if (sink.m_threadNames[threadId].rfind("Worker ", 0) != 0)
+                {
+                    state.SkipWithError("thread name missing");
+                    return;
+                }
+
+                // The events of a thread are in the order in which the scopes ended.
+                for (size_t i = 0; i < events.size(); ++i)
+                {
+                    const Event& event = events[i];
+                    if (event.end < event.begin || event.begin < sink.m_startTime || (i > 0 && event.end < events[i - 1].end))
+                    {
+                        state.SkipWithError("events out of order");
+                        return;
+                    }
+                }
+
+                // Without drops, each frame scope follows its two nested scopes.
+                for (size_t i = 2; sink.m_droppedCount == 0 && i < events.size(); i += 3)
+                {
+                    const Event& frame = events[i];
+                    const Event& update = events[i - 2];
+                    const Event& render = events[i - 1];
+                    if (std::strcmp(frame.name, "Frame") != 0 || std::strcmp(update.name, "Update") != 0 ||
+                        std::strcmp(render.name, "Render") != 0 || update.begin < frame.begin || render.end > frame.end)
+                    {
+                        state.SkipWithError("scopes not nested");
+                        return;
+                    }
+                }
+                eventCount += events.size();
+            }
+
+            if (eventCount + sink.m_droppedCount != uint64_t(ThreadCount) * FrameCount * 3)
+            {
+                state.SkipWithError("events lost without being counted as dropped");
+                return;
+            }
+
+            // A ring which is not drained keeps its capacity of events and drops the rest.
+            CountingSink fullSink;
+            settings.flushInterval = std::chrono::hours(1);
+            Start(fullSink, settings);
+            std::thread([]() {
+                for (int i = 0; i < 300; ++i)
+                {
+                    FRAME_PROFILER_SCOPE("Overflow");
+                }
+            }).join();
+            Stop();
+            if (fullSink.m_eventCount != 256 || fullSink.m_droppedCount != 300 - 256)
+            {
+                state.SkipWithError("full ring not handled");
+                return;
+            }
+
+            // Not recording: scopes leave no events.
+            {
+                FRAME_PROFILER_SCOPE("Stopped");
+            }
+            CountingSink idleSink;
+            Start(idleSink, settings);
+            Stop();
+            if (idleSink.m_eventCount != 0)
+            {
+                state.SkipWithError("event recorded while stopped");
+                return;
+            }
+
+            std::ostringstream stream;
+            ChromeTraceWriter writer(stream);
+            writer.BeginSession(1000);
+            writer.WriteThreadName(3, "Render \"main\"");
+            const Event events[] = {{"Blit", 2234, 2734}, {"Present", 500, 1500}};
+            writer.WriteEvents(3, events);
+            writer.EndSession(7);
+            const std::string expected = R"({"traceEvents":[
+{"name":"thread_name","ph":"M","pid":1,"tid":3,"args":{"name":"Render \"main\""}},
+{"name":"Blit","ph":"X","pid":1,"tid":3,"ts":1.234,"dur":0.500},
+{"name":"Present","ph":"X","pid":1,"tid":3,"ts":0.000,"dur":1.000}
+],"displayTimeUnit":"ms","otherData":{"droppedEvents":"7"}}
+)";
+            if (stream.str() != expected)
+            {
+                state.SkipWithError("unexpected trace JSON");
+                return;
+            }
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_FrameProfilerScopeIdle);
+BENCHMARK(BM_FrameProfilerScopeRecording);
+BENCHMARK(BM_FrameProfilerChromeTraceWrite);
+BENCHMARK(BM_FrameProfilerChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
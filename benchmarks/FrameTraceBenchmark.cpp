@@ -0,0 +1,848 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <CubeInstancing.h>
+#include <FrameStatisticsSummary.h>
+#include <FrameTrace.h>
+#include <StatisticsHelper.h>
+#include <holographic/FrustumCullingBatch.h>
+#include <holographic/SpatialInputInstancing.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace FrameTrace;
+
+namespace
+{
+    constexpr int64_t FrameIntervalMicroseconds = 16667;
+
+    // Recorded input of one frame, as the sample apps write it.
+    struct SyntheticFrame
+    {
+        int64_t timestamp = 0;
+        std::vector<ViewRecord> views;
+        std::vector<JointRecord> joints;
+        std::vector<HologramRecord> holograms;
+        FrameStatisticsRecord statistics{};
+    };
+
+    void Rotate(const float (&q)[4], const float (&v)[3], float (&result)[3])
+    {
+        // v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v), as in SpatialInput_VertexShader
+        const float t[3] = {
+            q[1] * v[2] - q[2] * v[1] + q[3] * v[0], q[2] * v[0] - q[0] * v[2] + q[3] * v[1], q[0] * v[1] - q[1] * v[0] + q[3] * v[2]};
+        result[0] = v[0] + 2.0f * (q[1] * t[2] - q[2] * t[1]);
+        result[1] = v[1] + 2.0f * (q[2] * t[0] - q[0] * t[2]);
+        result[2] = v[2] + 2.0f * (q[0] * t[1] - q[1] * t[0]);
+    }
+
+    void SetYaw(float yaw, float (&orientation)[4])
+    {
+        orientation[0] = 0.0f;
+        orientation[1] = std::sin(0.5f * yaw);
+        orientation[2] = 0.0f;
+        orientation[3] = std::cos(0.5f * yaw);
+    }
+
+    // View projection of an eye at position looking down -z rotated by yaw around y, with a 90 degree field of view, a near
+    // plane at 0.1 m and a far plane at 20 m (XMMatrixPerspectiveFovRH).
+    void MakeViewProjection(const float (&position)[3], float yaw, float (&viewProjection)[16])
+    {
+        const float c = std::cos(yaw);
+        const float s = std::sin(yaw);
+        const float right[3] = {c, 0.0f, -s};
+        const float up[3] = {0.0f, 1.0f, 0.0f};
+        const float back[3] = {s, 0.0f, c};
+        const auto dot = [&](const float(&axis)[3]) { return axis[0] * position[0] + axis[1] * position[1] + axis[2] * position[2]; };
+        const float view[16] = {
+            right[0], up[0], back[0], 0.0f,
+            right[1], up[1], back[1], 0.0f,
+            right[2], up[2], back[2], 0.0f,
+            -dot(right), -dot(up), -dot(back), 1.0f};
+
+        const float nearPlane = 0.1f;
+        const float farPlane = 20.0f;
+        const float projection[16] = {
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, farPlane / (nearPlane - farPlane), -1.0f,
+            0.0f, 0.0f, nearPlane * farPlane / (nearPlane - farPlane), 0.0f};
+
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                float sum = 0.0f;
+                for (int k = 0; k < 4; ++k)
+                {
+                    sum += view[row * 4 + k] * projection[k * 4 + column];
+                }
+                viewProjection[row * 4 + column] = sum;
+            }
+        }
+    }
+
+    // A user walking around in a room with 20 spinning holograms around them, looking around and holding up both hands, at 60
+    // fps with some frame time jitter and a video stream with occasional losses.
+    std::vector<SyntheticFrame> MakeSyntheticFrames(size_t count)
+    {
+        std::mt19937 random(23);
+        std::uniform_int_distribution<int64_t> jitter(-500, 500);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+        std::vector<SyntheticFrame> frames(count);
+        int64_t timestamp = 1234567890;
+        for (SyntheticFrame& frame : frames)
+        {
+            const int64_t interval = FrameIntervalMicroseconds + jitter(random);
+            timestamp += interval;
+            frame.timestamp = timestamp;
+            const float t = static_cast<float>(timestamp - 1234567890) * 1e-6f;
+
+            const float head[3] = {0.3f * std::sin(0.5f * t), 1.6f + 0.02f * std::sin(3.0f * t), 0.3f * std::cos(0.4f * t)};
+            const float yaw = 0.6f * t;
+            float headOrientation[4];
+            SetYaw(yaw, headOrientation);
+
+            for (float eyeOffset : {-0.032f, 0.032f})
+            {
+                ViewRecord view;
+                const float offset[3] = {eyeOffset, 0.0f, 0.0f};
+                float rotatedOffset[3];
+                Rotate(headOrientation, offset, rotatedOffset);
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    view.pose.position[axis] = head[axis] + rotatedOffset[axis];
+                }
+                std::copy(std::begin(headOrientation), std::end(headOrientation), view.pose.orientation);
+                MakeViewProjection(view.pose.position, yaw, view.viewProjection);
+                frame.views.push_back(view);
+            }
+
+            for (int side = -1; side <= 1; side += 2)
+            {
+                for (int joint = 0; joint < 26; ++joint)
+                {
+                    const float local[3] = {
+                        side * (0.15f + 0.01f * (joint % 5)),
+                        -0.3f + 0.01f * (joint / 5) + 0.02f * std::sin(2.0f * t + joint),
+                        -0.4f - 0.005f * joint};
+                    float rotated[3];
+                    Rotate(headOrientation, local, rotated);
+
+                    JointRecord record;
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        record.pose.position[axis] = head[axis] + rotated[axis];
+                    }
+                    std::copy(std::begin(headOrientation), std::end(headOrientation), record.pose.orientation);
+                    record.length = 0.03f;
+                    record.radius = 0.008f - 0.0001f * joint;
+                    frame.joints.push_back(record);
+                }
+            }
+
+            for (uint32_t id = 0; id < 20; ++id)
+            {
+                const float angle = 2.0f * 3.14159265f * id / 20.0f;
+                HologramRecord hologram;
+                hologram.id = id;
+                hologram.pose.position[0] = 2.5f * std::sin(angle);
+                hologram.pose.position[1] = 1.2f + 0.4f * (id % 3);
+                hologram.pose.position[2] = -2.5f * std::cos(angle);
+                SetYaw(t * (1.0f + 0.1f * id), hologram.pose.orientation);
+                std::fill(std::begin(hologram.scale), std::end(hologram.scale), 0.1f + 0.01f * id);
+                hologram.color[0] = (id % 2) ? 1.0f : 0.5f;
+                hologram.color[1] = (id % 3) ? 1.0f : 0.5f;
+                hologram.color[2] = 1.0f;
+                frame.holograms.push_back(hologram);
+            }
+
+            FrameStatisticsRecord& statistics = frame.statistics;
+            statistics.TimeSinceLastPresent = static_cast<float>(interval) * 1e-6f;
+            const float videoRoll = uniform(random);
+            statistics.VideoFramesReceived = videoRoll < 0.03f ? 0 : (videoRoll > 0.97f ? 2 : 1);
+            statistics.VideoFramesSkipped = videoRoll < 0.01f ? 1 : 0;
+            statistics.VideoFrameReusedCount = statistics.VideoFramesReceived == 0 ? 1 : 0;
+            statistics.VideoFrameMinDelta = statistics.TimeSinceLastPresent - 0.001f;
+            statistics.VideoFrameMaxDelta = statistics.TimeSinceLastPresent + 0.001f;
+            statistics.Latency = 0.045f + 0.01f * std::sin(0.7f * t) + 0.005f * uniform(random);
+            statistics.VideoFramesDiscarded = statistics.VideoFramesReceived > 1 ? 1 : 0;
+        }
+        return frames;
+    }
+
+    bool WriteFrame(TraceWriter& writer, const SyntheticFrame& frame)
+    {
+        const std::chrono::microseconds timestamp(frame.timestamp);
+        return writer.Write(RecordType::FrameBegin, timestamp) &&
+               writer.Write(RecordType::Views, timestamp, std::span<const ViewRecord>(frame.views)) &&
+               writer.Write(RecordType::Joints, timestamp, std::span<const JointRecord>(frame.joints)) &&
+               writer.Write(RecordType::Holograms, timestamp, std::span<const HologramRecord>(frame.holograms)) &&
+               writer.Write(RecordType::FrameStatistics, timestamp, std::span<const FrameStatisticsRecord>(&frame.statistics, 1));
+    }
+
+    std::filesystem::path GetTracePath(const char* name)
+    {
+        std::error_code error;
+        return std::filesystem::temp_directory_path(error) / (std::string("SampleBenchmarks-") + name + ".trace");
+    }
+
+    bool WriteTraceFile(const std::filesystem::path& path, const std::vector<SyntheticFrame>& frames, size_t initialCapacity = 1 << 20)
+    {
+        TraceWriter writer;
+        if (!writer.Open(path, initialCapacity))
+        {
+            return false;
+        }
+        for (const SyntheticFrame& frame : frames)
+        {
+            if (!WriteFrame(writer, frame))
+            {
+                return false;
+            }
+        }
+        writer.Close();
+        return true;
+    }
+
+    // Writes the frames to a trace file and reads the file back.
+    std::vector<uint8_t> MakeTrace(const std::vector<SyntheticFrame>& frames, const char* name, size_t initialCapacity = 1 << 20)
+    {
+        const std::filesystem::path path = GetTracePath(name);
+        std::vector<uint8_t> trace;
+        MappedTrace mapped;
+        if (WriteTraceFile(path, frames, initialCapacity) && mapped.Open(path))
+        {
+            trace.assign(mapped.GetData().begin(), mapped.GetData().end());
+        }
+        mapped.Close();
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return trace;
+    }
+
+    // Planes of the frustum of a view projection matrix (Gribb and Hartmann), in the order and convention of
+    // FrustumCulling::TryGetFrustumPlanes (bottom, far, left, near, right, top).
+    FrustumCulling::FrustumPlanes MakeFrustumPlanes(const float (&viewProjection)[16])
+    {
+        // Inside of plane i: sign * clip[axis] + wScale * clip.w >= 0, with clip = [p 1] * viewProjection.
+        constexpr int axes[6] = {1, 2, 0, 2, 0, 1};
+        constexpr float signs[6] = {1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f};
+        constexpr float wScales[6] = {1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+
+        FrustumCulling::FrustumPlanes planes;
+        for (size_t i = 0; i < FrustumCulling::FrustumPlanes::PlaneCount; ++i)
+        {
+            float plane[4];
+            for (int row = 0; row < 4; ++row)
+            {
+                plane[row] = -(signs[i] * viewProjection[row * 4 + axes[i]] + wScales[i] * viewProjection[row * 4 + 3]);
+            }
+            const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            planes.normalX[i] = plane[0] / length;
+            planes.normalY[i] = plane[1] / length;
+            planes.normalZ[i] = plane[2] / length;
+            planes.d[i] = plane[3] / length;
+        }
+        return planes;
+    }
+
+    // The platform-neutral per-frame work of the samples for the recorded input: culling the holograms and hand joints against
+    // each view, packing the visible cubes and the joint instances, and summarizing the frame statistics. Every result is folded
+    // into a digest, so that two runs over the same input can be compared.
+    class ReplayPipeline
+    {
+    public:
+        void ProcessFrame(
+            std::chrono::microseconds timestamp,
+            std::span<const ViewRecord> views,
+            std::span<const JointRecord> joints,
+            std::span<const HologramRecord> holograms,
+            const FrameStatisticsRecord* statistics)
+        {
+            m_hologramSpheres.Clear();
+            for (const HologramRecord& hologram : holograms)
+            {
+                const float* p = hologram.pose.position;
+                const float* s = hologram.scale;
+                m_hologramSpheres.Add(p[0], p[1], p[2], 0.5f * std::sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]));
+            }
+
+            m_jointSpheres.Clear();
+            m_jointInstances.Clear();
+            constexpr float noColor[3] = {0.0f, 0.0f, 0.0f};
+            for (const JointRecord& joint : joints)
+            {
+                // Bounding spheres as built by SpatialInputRenderer::Update.
+                const float tip[3] = {0.0f, 0.0f, -0.5f * joint.length};
+                float offset[3];
+                Rotate(joint.pose.orientation, tip, offset);
+                m_jointSpheres.Add(
+                    joint.pose.position[0] + offset[0],
+                    joint.pose.position[1] + offset[1],
+                    joint.pose.position[2] + offset[2],
+                    std::max(joint.radius, 0.5f * joint.length));
+                m_jointInstances.Add(
+                    SpatialInputInstancing::Shape::Joint, joint.pose.position, joint.pose.orientation, joint.length, joint.radius, noColor);
+            }
+            m_jointInstances.Pack();
+
+            m_hologramVisible.assign(holograms.size(), 0);
+            m_visibleJointRanges.clear();
+            for (const ViewRecord& view : views)
+            {
+                const FrustumCulling::FrustumPlanes planes = MakeFrustumPlanes(view.viewProjection);
+                m_hologramSpheres.Cull(&planes);
+                for (size_t i = 0; i < holograms.size(); ++i)
+                {
+                    m_hologramVisible[i] |= m_hologramSpheres.IsVisible(i) ? 1 : 0;
+                }
+
+                m_jointSpheres.Cull(&planes);
+                SpatialInputInstancing::AppendVisibleRanges(
+                    m_jointInstances.GetRange(SpatialInputInstancing::Shape::Joint), m_jointSpheres, m_visibleJointRanges);
+            }
+
+            m_cubes.Clear();
+            for (size_t i = 0; i < holograms.size(); ++i)
+            {
+                if (m_hologramVisible[i])
+                {
+                    const HologramRecord& hologram = holograms[i];
+                    const Pose& pose = hologram.pose;
+                    const XrPosef xrPose{
+                        {pose.orientation[0], pose.orientation[1], pose.orientation[2], pose.orientation[3]},
+                        {pose.position[0], pose.position[1], pose.position[2]}};
+                    m_cubes.Add(
+                        xrPose,
+                        {hologram.scale[0], hologram.scale[1], hologram.scale[2]},
+                        {hologram.color[0], hologram.color[1], hologram.color[2]});
+                }
+            }
+            m_cubes.Pack(m_cubeInstances);
+            m_visibleHologramCount += m_cubeInstances.size();
+
+            if (statistics)
+            {
+                // The statistics windows advance with the recorded time instead of the wall clock.
+                using Clock = std::chrono::steady_clock;
+                m_statistics.Update(*statistics, Clock::time_point(std::chrono::duration_cast<Clock::duration>(timestamp)));
+                const auto& summary = m_statistics.GetStatisticsSummary();
+                Hash(&summary.latencyAvg, sizeof(summary.latencyAvg));
+                Hash(&summary.videoFramesReceived, sizeof(summary.videoFramesReceived));
+            }
+
+            Hash(m_cubeInstances.data(), m_cubeInstances.size() * sizeof(sample::CubeInstance));
+            Hash(m_visibleJointRanges.data(), m_visibleJointRanges.size() * sizeof(SpatialInputInstancing::InstanceRange));
+            Hash(m_jointInstances.GetInstances().data(), m_jointInstances.GetInstances().size() * sizeof(SpatialInputInstancing::Instance));
+        }
+
+        uint64_t GetDigest() const
+        {
+            return m_digest;
+        }
+
+        uint64_t GetVisibleHologramCount() const
+        {
+            return m_visibleHologramCount;
+        }
+
+    private:
+        // FNV-1a
+        void Hash(const void* data, size_t size)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                m_digest = (m_digest ^ bytes[i]) * 0x100000001b3ull;
+            }
+        }
+
+        FrustumCulling::SphereBatch m_hologramSpheres;
+        FrustumCulling::SphereBatch m_jointSpheres;
+        std::vector<uint8_t> m_hologramVisible;
+        sample::CubeInstanceBatch m_cubes;
+        std::vector<sample::CubeInstance> m_cubeInstances;
+        SpatialInputInstancing::InstanceBatch m_jointInstances;
+        std::vector<SpatialInputInstancing::InstanceRange> m_visibleJointRanges;
+        StatisticsHelper<FrameStatisticsRecord, FrameStatisticsSummary<FrameStatisticsRecord>> m_statistics;
+        uint64_t m_digest = 0xcbf29ce484222325ull;
+        uint64_t m_visibleHologramCount = 0;
+    };
+
+    // Feeds the frames of a replayer into the pipeline. Returns the number of frames.
+    class TraceReplay
+    {
+    public:
+        size_t Run(FrameReplayer& replayer, ReplayPipeline& pipeline)
+        {
+            size_t frameCount = 0;
+            while (replayer.NextFrame(m_frame))
+            {
+                m_views.clear();
+                m_joints.clear();
+                m_holograms.clear();
+                bool hasStatistics = false;
+                for (const Record& record : m_frame.records)
+                {
+                    switch (record.type)
+                    {
+                        case RecordType::Views:
+                            record.CopyTo(m_views);
+                            break;
+                        case RecordType::Joints:
+                            record.CopyTo(m_joints);
+                            break;
+                        case RecordType::Holograms:
+                            record.CopyTo(m_holograms);
+                            break;
+                        case RecordType::FrameStatistics:
+                            record.CopyTo(m_statistics);
+                            hasStatistics = !m_statistics.empty();
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                pipeline.ProcessFrame(m_frame.timestamp, m_views, m_joints, m_holograms, hasStatistics ? &m_statistics.front() : nullptr);
+                frameCount++;
+            }
+            return frameCount;
+        }
+
+    private:
+        Frame m_frame;
+        std::vector<ViewRecord> m_views;
+        std::vector<JointRecord> m_joints;
+        std::vector<HologramRecord> m_holograms;
+        std::vector<FrameStatisticsRecord> m_statistics;
+    };
+
+    uint64_t ProcessLive(const std::vector<SyntheticFrame>& frames, ReplayPipeline& pipeline)
+    {
+        for (const SyntheticFrame& frame : frames)
+        {
+            pipeline.ProcessFrame(
+                std::chrono::microseconds(frame.timestamp - frames.front().timestamp),
+                frame.views,
+                frame.joints,
+                frame.holograms,
+                &frame.statistics);
+        }
+        return pipeline.GetDigest();
+    }
+
+    template <typename T>
+    bool PayloadEquals(const Record& record, const std::vector<T>& expected)
+    {
+        return record.payload.size() == expected.size() * sizeof(T) &&
+               (expected.empty() || std::memcmp(record.payload.data(), expected.data(), record.payload.size()) == 0);
+    }
+
+    // Returns nullptr if the trace format round-trips and rejects damaged traces, or the description of the first failure.
+    const char* CheckTraceFormat()
+    {
+        // All records come back bit exact, with their timestamps relative to the first record, also when the mapping had to
+        // grow several times.
+        const std::vector<SyntheticFrame> frames = MakeSyntheticFrames(300);
+        const std::vector<uint8_t> trace = MakeTrace(frames, "Format", 4096);
+        if (trace.size() < 200 * 1024)
+        {
+            return "trace should hold all frames after growing the mapping";
+        }
+
+        {
+            TraceReader reader(trace);
+            if (!reader.IsValid())
+            {
+                return "written trace should have a valid header";
+            }
+            for (const SyntheticFrame& frame : frames)
+            {
+                const std::chrono::microseconds timestamp(frame.timestamp - frames.front().timestamp);
+                const RecordType types[] = {
+                    RecordType::FrameBegin, RecordType::Views, RecordType::Joints, RecordType::Holograms, RecordType::FrameStatistics};
+                for (RecordType type : types)
+                {
+                    Record record;
+                    if (reader.Next(record) != ReadStatus::Ok || record.type != type || record.timestamp != timestamp)
+                    {
+                        return "records should be read back in order with their timestamps";
+                    }
+                    const bool payloadEquals = (type == RecordType::FrameBegin && record.payload.empty()) ||
+                                               (type == RecordType::Views && PayloadEquals(record, frame.views)) ||
+                                               (type == RecordType::Joints && PayloadEquals(record, frame.joints)) ||
+                                               (type == RecordType::Holograms && PayloadEquals(record, frame.holograms)) ||
+                                               (type == RecordType::FrameStatistics &&
+                                                PayloadEquals(record, std::vector<FrameStatisticsRecord>{frame.statistics}));
+                    if (!payloadEquals)
+                    {
+                        return "record payloads should be read back unchanged";
+                    }
+                }
+            }
+            Record record;
+            if (reader.Next(record) != ReadStatus::End || reader.Next(record) != ReadStatus::End)
+            {
+                return "reader should report the end of the trace after the last record";
+            }
+        }
+
+        // The first timestamp is kept in the header, a decreasing timestamp is stored as the previous one.
+        {
+            const std::filesystem::path path = GetTracePath("Timestamps");
+            TraceWriter writer;
+            // Records of type, delta and size, the delta of 500 takes two bytes.
+            if (!writer.Open(path) || !writer.Write(RecordType::FrameBegin, std::chrono::microseconds(1000)) ||
+                !writer.Write(RecordType::FrameBegin, std::chrono::microseconds(900)) ||
+                !writer.Write(RecordType::FrameBegin, std::chrono::microseconds(1500)))
+            {
+                return "writer should record into a temporary file";
+            }
+            writer.Close();
+
+            MappedTrace mapped;
+            if (!mapped.Open(path) || mapped.GetData().size() != sizeof(FileHeader) + 3 + 3 + 4)
+            {
+                return "closing the writer should truncate the file to the records";
+            }
+            FileHeader header;
+            std::memcpy(&header, mapped.GetData().data(), sizeof(header));
+            TraceReader reader(mapped.GetData());
+            Record records[3];
+            for (Record& record : records)
+            {
+                reader.Next(record);
+            }
+            if (header.startTimestamp != 1000 || records[0].timestamp.count() != 0 || records[1].timestamp.count() != 0 ||
+                records[2].timestamp.count() != 500)
+            {
+                return "timestamps should be stored as non-negative deltas to the first record";
+            }
+            mapped.Close();
+            std::error_code error;
+            std::filesystem::remove(path, error);
+
+            if (writer.Open(path.parent_path() / "missing-directory" / "trace.trace") || writer.IsOpen())
+            {
+                return "opening a file in a missing directory should fail";
+            }
+        }
+
+        // The zero-filled tail of a recording which was not closed reads as the end.
+        {
+            std::vector<uint8_t> padded = trace;
+            padded.resize(trace.size() + 65536, 0);
+            TraceReader reader(padded);
+            size_t recordCount = 0;
+            Record record;
+            ReadStatus status;
+            while ((status = reader.Next(record)) == ReadStatus::Ok)
+            {
+                recordCount++;
+            }
+            if (status != ReadStatus::End || recordCount != frames.size() * 5)
+            {
+                return "zero-filled tail should read as the end of the trace";
+            }
+        }
+
+        // A trace cut at any byte gives the records before the cut, followed by the end at a record boundary and by Corrupt
+        // within a record.
+        {
+            const std::vector<SyntheticFrame> shortFrames(frames.begin(), frames.begin() + 3);
+            const std::vector<uint8_t> shortTrace = MakeTrace(shortFrames, "Truncated");
+            std::set<size_t> boundaries;
+            {
+                TraceReader reader(shortTrace);
+                boundaries.insert(sizeof(FileHeader));
+                Record record;
+                while (reader.Next(record) == ReadStatus::Ok)
+                {
+                    boundaries.insert(static_cast<size_t>(record.payload.data() + record.payload.size() - shortTrace.data()));
+                }
+            }
+
+            for (size_t size = 0; size <= shortTrace.size(); ++size)
+            {
+                TraceReader reader(std::span<const uint8_t>(shortTrace).first(size));
+                Record record;
+                if (size < sizeof(FileHeader))
+                {
+                    if (reader.IsValid() || reader.Next(record) != ReadStatus::Corrupt)
+                    {
+                        return "trace without a complete header should be invalid";
+                    }
+                    continue;
+                }
+
+                size_t end = sizeof(FileHeader);
+                ReadStatus status;
+                while ((status = reader.Next(record)) == ReadStatus::Ok)
+                {
+                    end = static_cast<size_t>(record.payload.data() + record.payload.size() - shortTrace.data());
+                }
+                const bool atBoundary = boundaries.count(size) != 0;
+                if (status != (atBoundary ? ReadStatus::End : ReadStatus::Corrupt) || end > size || (atBoundary && end != size))
+                {
+                    return "truncated trace should give the complete records, then the end or Corrupt";
+                }
+            }
+        }
+
+        // Damaged bytes never lead to a record outside of the trace (the build with the address sanitizer checks the reads).
+        {
+            std::mt19937 random(31);
+            const std::vector<SyntheticFrame> shortFrames(frames.begin(), frames.begin() + 4);
+            const std::vector<uint8_t> cleanTrace = MakeTrace(shortFrames, "Damaged");
+            std::uniform_int_distribution<size_t> position(0, cleanTrace.size() - 1);
+            std::uniform_int_distribution<int> value(0, 255);
+            for (int iteration = 0; iteration < 2000; ++iteration)
+            {
+                std::vector<uint8_t> damaged = cleanTrace;
+                const int damageCount = 1 + iteration % 4;
+                for (int i = 0; i < damageCount; ++i)
+                {
+                    damaged[iteration < 100 ? i : position(random)] = static_cast<uint8_t>(value(random));
+                }
+
+                TraceReader reader(damaged);
+                Record record;
+                while (reader.Next(record) == ReadStatus::Ok)
+                {
+                    const uint8_t* end = record.payload.data() + record.payload.size();
+                    if (record.payload.data() < damaged.data() || end > damaged.data() + damaged.size())
+                    {
+                        return "records of a damaged trace should stay within the trace";
+                    }
+                }
+
+                FrameReplayer replayer(damaged, ReplaySpeed::Maximum);
+                ReplayPipeline pipeline;
+                TraceReplay().Run(replayer, pipeline);
+            }
+
+            std::vector<uint8_t> wrongMagic = cleanTrace;
+            wrongMagic[0] ^= 0xff;
+            FrameReplayer replayer(wrongMagic, ReplaySpeed::Maximum);
+            Frame frame;
+            if (TraceReader(wrongMagic).IsValid() || replayer.NextFrame(frame) || replayer.GetStatus() != ReadStatus::Corrupt)
+            {
+                return "trace with a wrong magic should be rejected";
+            }
+        }
+        return nullptr;
+    }
+
+    // Returns nullptr if replaying a trace reproduces the frames which were recorded, or the description of the first failure.
+    const char* CheckReplay()
+    {
+        const std::vector<SyntheticFrame> frames = MakeSyntheticFrames(600);
+        const std::vector<uint8_t> trace = MakeTrace(frames, "Replay");
+
+        ReplayPipeline live;
+        const uint64_t liveDigest = ProcessLive(frames, live);
+        if (live.GetVisibleHologramCount() == 0 || live.GetVisibleHologramCount() >= frames.size() * 20)
+        {
+            return "synthetic frames should have visible and culled holograms";
+        }
+
+        // Replaying gives the same result as the live frames, run after run.
+        FrameReplayer replayer(trace, ReplaySpeed::Maximum);
+        TraceReplay replay;
+        for (int run = 0; run < 2; ++run)
+        {
+            ReplayPipeline pipeline;
+            if (replay.Run(replayer, pipeline) != frames.size() || replayer.GetStatus() != ReadStatus::End)
+            {
+                return "replay should hand out every recorded frame";
+            }
+            if (pipeline.GetDigest() != liveDigest)
+            {
+                return "replay should reproduce the results of the recorded frames";
+            }
+            replayer.Rewind();
+        }
+
+        Frame frame;
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            replayer.NextFrame(frame);
+            if (frame.index != i || frame.timestamp.count() != frames[i].timestamp - frames[0].timestamp || frame.records.size() != 4)
+            {
+                return "frames should be grouped by their FrameBegin records";
+            }
+        }
+
+        // At the recorded speed, the frames are handed out when they are due.
+        {
+            std::vector<SyntheticFrame> pacedFrames(frames.begin(), frames.begin() + 6);
+            for (size_t i = 0; i < pacedFrames.size(); ++i)
+            {
+                pacedFrames[i].timestamp = 20000 * int64_t(i);
+            }
+            const std::vector<uint8_t> pacedTrace = MakeTrace(pacedFrames, "Paced");
+            FrameReplayer pacedReplayer(pacedTrace, ReplaySpeed::Recorded);
+            pacedReplayer.NextFrame(frame);
+            const auto start = std::chrono::steady_clock::now();
+            size_t frameCount = 1;
+            while (pacedReplayer.NextFrame(frame))
+            {
+                frameCount++;
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            if (frameCount != pacedFrames.size() || elapsed < std::chrono::milliseconds(99) || elapsed > std::chrono::seconds(2))
+            {
+                return "recorded speed should hand out the frames at their recorded pace";
+            }
+        }
+        return nullptr;
+    }
+
+    void BM_FrameTraceChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckTraceFormat())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+            if (const char* error = CheckReplay())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Cost of recording one frame (views, 52 joints, 20 holograms and the frame statistics), which the apps add to their frame
+    // loop while recording.
+    void BM_FrameTraceWrite(benchmark::State& state)
+    {
+        const std::vector<SyntheticFrame> frames = MakeSyntheticFrames(600);
+        const std::filesystem::path path = GetTracePath("Write");
+        TraceWriter writer;
+        if (!writer.Open(path))
+        {
+            state.SkipWithError("could not create the trace file");
+            return;
+        }
+
+        size_t frameIndex = 0;
+        int64_t bytes = 0;
+        for (auto _ : state)
+        {
+            if (!WriteFrame(writer, frames[frameIndex]))
+            {
+                state.SkipWithError("could not grow the trace file");
+                break;
+            }
+            frameIndex = (frameIndex + 1) % frames.size();
+            if (frameIndex == 0 && writer.GetSize() > (64 << 20))
+            {
+                state.PauseTiming();
+                bytes += int64_t(writer.GetSize());
+                writer.Open(path);
+                state.ResumeTiming();
+            }
+        }
+        bytes += int64_t(writer.GetSize());
+        writer.Close();
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(bytes);
+    }
+
+    // Replay of a whole trace at maximum speed through the culling, instance packing and statistics of the samples.
+    void ReplayTrace(benchmark::State& state, std::span<const uint8_t> trace)
+    {
+        FrameReplayer replayer(trace, ReplaySpeed::Maximum);
+        TraceReplay replay;
+        size_t frameCount = 0;
+        for (auto _ : state)
+        {
+            ReplayPipeline pipeline;
+            replayer.Rewind();
+            frameCount = replay.Run(replayer, pipeline);
+            benchmark::DoNotOptimize(pipeline.GetDigest());
+        }
+        if (replayer.GetStatus() == ReadStatus::Corrupt)
+        {
+            state.SkipWithError("trace is corrupt");
+        }
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(frameCount));
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(trace.size()));
+        state.counters["Frames"] = double(frameCount);
+    }
+
+    void BM_FrameTraceReplay(benchmark::State& state)
+    {
+        const std::vector<uint8_t> trace = MakeTrace(MakeSyntheticFrames(600), "Replay");
+        ReplayTrace(state, trace);
+    }
+
+    // Decoding alone, without the per-frame work.
+    void BM_FrameTraceRead(benchmark::State& state)
+    {
+        const std::vector<uint8_t> trace = MakeTrace(MakeSyntheticFrames(600), "Read");
+        for (auto _ : state)
+        {
+            TraceReader reader(trace);
+            Record record;
+            while (reader.Next(record) == ReadStatus::Ok)
+            {
+                benchmark::DoNotOptimize(record.payload.data());
+            }
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(trace.size()));
+    }
+
+    // A trace recorded by one of the sample apps (-trace <file>) is replayed from the file in SAMPLE_BENCHMARKS_FRAME_TRACE.
+    const bool RecordedTraceRegistered = [] {
+        const char* file = std::getenv("SAMPLE_BENCHMARKS_FRAME_TRACE");
+        if (!file)
+        {
+            return false;
+        }
+
+        auto mapped = std::make_shared<MappedTrace>();
+        if (!mapped->Open(file))
+        {
+            std::fprintf(stderr, "Skipping unreadable frame trace %s\n", file);
+            return false;
+        }
+        benchmark::RegisterBenchmark(("BM_FrameTraceReplayRecorded/" + std::filesystem::path(file).stem().string()).c_str(),
+                                     [mapped](benchmark::State& state) { ReplayTrace(state, mapped->GetData()); })
+            ->Unit(benchmark::kMillisecond);
+        return true;
+    }();
+} // namespace
+
+BENCHMARK(BM_FrameTraceChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FrameTraceWrite);
+BENCHMARK(BM_FrameTraceReplay)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FrameTraceRead)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,225 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "BenchmarkUtils.h"
+
+#include <holographic/FrustumCullingBatch.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace BenchmarkUtils;
+using namespace FrustumCulling;
+
+namespace
+{
+    // Spheres scattered around the camera, roughly a quarter of them are visible.
+    SphereBatch MakeSpheres(size_t count)
+    {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+        std::uniform_real_distribution<float> radius(0.005f, 0.2f);
+
+        SphereBatch spheres;
+        spheres.Reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            spheres.Add(position(random), position(random), position(random), radius(random));
+        }
+        return spheres;
+    }
+
+    // The per-call path: one sphere at a time, with the planes copied for every call like the
+    // cullingFrustum.Value() call in FrustumCulling::SphereInFrustum.
+    void BM_SphereInFrustumPerCall(benchmark::State& state)
+    {
+        const FrustumPlanes planes = MakeCameraFrustum();
+        const SphereBatch spheres = MakeSpheres(static_cast<size_t>(state.range(0)));
+        const SphereArrays arrays = spheres.GetArrays();
+        std::vector<uint64_t> mask(VisibilityMaskWordCount(arrays.count));
+
+        for (auto _ : state)
+        {
+            std::fill(mask.begin(), mask.end(), 0);
+            for (size_t i = 0; i < arrays.count; ++i)
+            {
+                FrustumPlanes frustum = planes;
+                benchmark::DoNotOptimize(frustum);
+                if (SphereInFrustum(frustum, arrays.centerX[i], arrays.centerY[i], arrays.centerZ[i], arrays.radius[i]))
+                {
+                    mask[i / 64] |= uint64_t(1) << (i % 64);
+                }
+            }
+            benchmark::DoNotOptimize(mask.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_SpheresInFrustumScalar(benchmark::State& state)
+    {
+        const FrustumPlanes planes = MakeCameraFrustum();
+        const SphereBatch spheres = MakeSpheres(static_cast<size_t>(state.range(0)));
+        std::vector<uint64_t> mask(VisibilityMaskWordCount(spheres.Size()));
+
+        for (auto _ : state)
+        {
+            SpheresInFrustumScalar(planes, spheres.GetArrays(), mask.data());
+            benchmark::DoNotOptimize(mask.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_SpheresInFrustum(benchmark::State& state)
+    {
+        const FrustumPlanes planes = MakeCameraFrustum();
+        const SphereBatch spheres = MakeSpheres(static_cast<size_t>(state.range(0)));
+        std::vector<uint64_t> mask(VisibilityMaskWordCount(spheres.Size()));
+        std::vector<uint64_t> expected(mask.size());
+
+        SpheresInFrustumScalar(planes, spheres.GetArrays(), expected.data());
+        SpheresInFrustum(planes, spheres.GetArrays(), mask.data());
+        if (mask != expected)
+        {
+            state.SkipWithError("SIMD kernel disagrees with the scalar kernel");
+            return;
+        }
+
+        for (auto _ : state)
+        {
+            SpheresInFrustum(planes, spheres.GetArrays(), mask.data());
+            benchmark::DoNotOptimize(mask.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetLabel(SpheresInFrustumKernelName());
+    }
+
+    // Spheres which touch a plane of MakeCameraFrustum exactly, followed by the same spheres moved or shrunk by one ulp so that
+    // they lie just outside of it. Touching spheres are visible, and all kernels have to agree on them.
+    void AddBoundarySpheres(SphereBatch& spheres)
+    {
+        // the far plane at z = -20, with a radius of 0.5
+        spheres.Add(1.0f, -2.0f, -20.5f, 0.5f);
+        spheres.Add(1.0f, -2.0f, -20.5f, std::nextafter(0.5f, 0.0f));
+        // the near plane at z = -0.1, with a radius of 0
+        spheres.Add(0.0f, 0.0f, -0.1f, 0.0f);
+        spheres.Add(0.0f, 0.0f, std::nextafter(-0.1f, 0.0f), 0.0f);
+        // points on the left plane x = z
+        spheres.Add(-5.0f, 0.0f, -5.0f, 0.0f);
+        spheres.Add(std::nextafter(-5.0f, -10.0f), 0.0f, -5.0f, 0.0f);
+        // points on the top plane y = -z
+        spheres.Add(0.0f, 3.0f, -3.0f, 0.0f);
+        spheres.Add(0.0f, std::nextafter(3.0f, 10.0f), -3.0f, 0.0f);
+    }
+
+    // Checks that SpheresInFrustum (the SIMD kernel of this build, see the label) and SpheresInFrustumScalar write the same
+    // visibility mask as the per-sphere SphereInFrustum test, for every sphere count up to three mask words, which covers all
+    // tails of the 4 and 8 wide kernels, and with spheres exactly on a plane in every lane position. Bits beyond the last sphere
+    // have to stay clear. Build with SAMPLE_BENCHMARKS_NATIVE_ARCH to check the AVX2 kernel.
+    void BM_FrustumCullingChecks(benchmark::State& state)
+    {
+        const FrustumPlanes planes = MakeCameraFrustum();
+
+        for (auto _ : state)
+        {
+            for (size_t boundaryOffset = 0; boundaryOffset < 8; ++boundaryOffset)
+            {
+                // random spheres around the camera, with the boundary spheres shifted through all lanes of the kernels
+                const SphereBatch random = MakeSpheres(200);
+                const SphereArrays randomArrays = random.GetArrays();
+                SphereBatch spheres;
+                for (size_t i = 0; i < boundaryOffset; ++i)
+                {
+                    spheres.Add(randomArrays.centerX[i], randomArrays.centerY[i], randomArrays.centerZ[i], randomArrays.radius[i]);
+                }
+                AddBoundarySpheres(spheres);
+                for (size_t i = boundaryOffset; i < randomArrays.count; ++i)
+                {
+                    spheres.Add(randomArrays.centerX[i], randomArrays.centerY[i], randomArrays.centerZ[i], randomArrays.radius[i]);
+                }
+
+                const SphereArrays all = spheres.GetArrays();
+                if (SphereInFrustum(planes, all.centerX[boundaryOffset + 1], all.centerY[boundaryOffset + 1],
+                                    all.centerZ[boundaryOffset + 1], all.radius[boundaryOffset + 1]) ||
+                    !SphereInFrustum(planes, all.centerX[boundaryOffset], all.centerY[boundaryOffset], all.centerZ[boundaryOffset],
+                                     all.radius[boundaryOffset]))
+                {
+                    state.SkipWithError("A sphere touching the far plane is not visible, or one just outside of it is");
+                    return;
+                }
+
+                for (size_t count = 0; count <= 3 * 64 && count <= all.count; ++count)
+                {
+                    SphereArrays arrays = all;
+                    arrays.count = count;
+
+                    // one word more than needed, filled with set bits, to catch writes beyond the mask
+                    std::vector<uint64_t> expected(VisibilityMaskWordCount(count) + 1, 0);
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        if (SphereInFrustum(planes, arrays.centerX[i], arrays.centerY[i], arrays.centerZ[i], arrays.radius[i]))
+                        {
+                            expected[i / 64] |= uint64_t(1) << (i % 64);
+                        }
+                    }
+                    expected.back() = ~uint64_t(0);
+
+                    std::vector<uint64_t> mask(expected.size(), ~uint64_t(0));
+                    SpheresInFrustum(planes, arrays, mask.data());
+                    if (mask != expected)
+                    {
+                        state.SkipWithError("SpheresInFrustum disagrees with the per-sphere test");
+                        return;
+                    }
+
+                    std::fill(mask.begin(), mask.end(), ~uint64_t(0));
+                    SpheresInFrustumScalar(planes, arrays, mask.data());
+                    if (mask != expected)
+                    {
+                        state.SkipWithError("SpheresInFrustumScalar disagrees with the per-sphere test");
+                        return;
+                    }
+                }
+
+                // the batch culls through the same kernel and treats all spheres as visible without planes
+                spheres.Cull(&planes);
+                for (size_t i = 0; i < all.count; ++i)
+                {
+                    if (spheres.IsVisible(i) != SphereInFrustum(planes, all.centerX[i], all.centerY[i], all.centerZ[i], all.radius[i]))
+                    {
+                        state.SkipWithError("SphereBatch::Cull disagrees with the per-sphere test");
+                        return;
+                    }
+                }
+                spheres.Cull(nullptr);
+                for (size_t i = 0; i < all.count; ++i)
+                {
+                    if (!spheres.IsVisible(i))
+                    {
+                        state.SkipWithError("SphereBatch::Cull without planes culled a sphere");
+                        return;
+                    }
+                }
+            }
+        }
+        state.SetLabel(SpheresInFrustumKernelName());
+    }
+} // namespace
+
+BENCHMARK(BM_SphereInFrustumPerCall)->Arg(64)->Arg(1024)->Arg(16384);
+BENCHMARK(BM_SpheresInFrustumScalar)->Arg(64)->Arg(1024)->Arg(16384);
+BENCHMARK(BM_SpheresInFrustum)->Arg(64)->Arg(1024)->Arg(16384);
+BENCHMARK(BM_FrustumCullingChecks)->Iterations(1);
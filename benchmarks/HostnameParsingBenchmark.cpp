@@ -0,0 +1,73 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <Utils.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+namespace
+{
+    struct AddressCase
+    {
+        const wchar_t* address;
+        const wchar_t* hostname;
+        uint16_t port;
+    };
+
+    // Addresses as passed on the command line of the remote samples. The port stays at its default (0 here) if none is given.
+    constexpr AddressCase s_addresses[] = {
+        {L"192.168.0.10", L"192.168.0.10", 0},
+        {L"192.168.0.10:8265", L"192.168.0.10", 8265},
+        {L"hololens.local:8266", L"hololens.local", 8266},
+        {L"[fe80::1ff:fe23:4567:890a]", L"[fe80::1ff:fe23:4567:890a]", 0},
+        {L"[fe80::1ff:fe23:4567:890a]:8265", L"[fe80::1ff:fe23:4567:890a]", 8265},
+        {L"", L"", 0},
+    };
+
+    void BM_SplitHostnameAndPort(benchmark::State& state)
+    {
+        const std::wstring address = s_addresses[state.range(0)].address;
+
+        for (auto _ : state)
+        {
+            uint16_t port = 0;
+            std::wstring hostname = Utils::SplitHostnameAndPortString(address, port);
+            benchmark::DoNotOptimize(hostname.data());
+            benchmark::DoNotOptimize(port);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Checks the split of all address forms.
+    void BM_SplitHostnameAndPortChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            for (const AddressCase& address : s_addresses)
+            {
+                uint16_t port = 0;
+                const std::wstring hostname = Utils::SplitHostnameAndPortString(address.address, port);
+                if (hostname != address.hostname || port != address.port)
+                {
+                    state.SkipWithError("address split wrongly");
+                    return;
+                }
+            }
+        }
+    }
+} // namespace
+
+// Hostname, IPv4 and IPv6 with port.
+BENCHMARK(BM_SplitHostnameAndPort)->Arg(1)->Arg(2)->Arg(4);
+BENCHMARK(BM_SplitHostnameAndPortChecks)->Iterations(1);
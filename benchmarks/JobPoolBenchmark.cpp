@@ -0,0 +1,320 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "BenchmarkUtils.h"
+
+#include <JobPool.h>
+#include <SpscQueue.h>
+#include <holographic/MeshSimplifier.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace BenchmarkUtils;
+
+namespace
+{
+    // Round trip of a burst of trivial jobs, which measures the scheduling overhead of the pool.
+    void BM_JobPoolBurst(benchmark::State& state)
+    {
+        JobPool pool(static_cast<uint32_t>(state.range(0)));
+        const int jobCount = static_cast<int>(state.range(1));
+        std::atomic<int> executed = 0;
+
+        for (auto _ : state)
+        {
+            executed = 0;
+            for (int i = 0; i < jobCount; ++i)
+            {
+                pool.Submit([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); });
+            }
+            pool.WaitIdle();
+
+            if (executed != jobCount)
+            {
+                state.SkipWithError("Not every job was executed exactly once");
+                return;
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * jobCount);
+    }
+
+    // Jobs which submit further jobs from a worker, which go to the worker's own queue and have to be stolen by the others.
+    void BM_JobPoolNestedSubmit(benchmark::State& state)
+    {
+        JobPool pool(static_cast<uint32_t>(state.range(0)));
+        constexpr int OuterJobCount = 8;
+        constexpr int InnerJobCount = 64;
+        std::atomic<int> executed = 0;
+
+        for (auto _ : state)
+        {
+            executed = 0;
+            for (int i = 0; i < OuterJobCount; ++i)
+            {
+                pool.Submit([&pool, &executed]() {
+                    for (int j = 0; j < InnerJobCount; ++j)
+                    {
+                        pool.Submit([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); });
+                    }
+                });
+            }
+            pool.WaitIdle();
+
+            if (executed != OuterJobCount * InnerJobCount)
+            {
+                state.SkipWithError("Not every nested job was executed exactly once");
+                return;
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * OuterJobCount * InnerJobCount);
+    }
+
+    struct StagingBlock
+    {
+        uint32_t part;
+        std::vector<uint16_t> indices;
+    };
+
+    // A relocalization burst: every surface part is simplified by the pool and handed to the consuming (render) thread through
+    // one queue per worker and an overflow list for blocks which do not fit, the pattern of SpatialSurfaceMeshRenderer. The
+    // consumer only polls the queues, as it would once per frame, and checks that every part arrives exactly once.
+    void BM_JobPoolMeshIngestionBurst(benchmark::State& state)
+    {
+        const SurfaceMesh mesh = MakeSurfaceMesh(33);
+        const uint32_t partCount = static_cast<uint32_t>(state.range(1));
+
+        JobPool pool(static_cast<uint32_t>(state.range(0)));
+        std::vector<std::unique_ptr<SpscQueue<std::unique_ptr<StagingBlock>>>> queues;
+        for (uint32_t i = 0; i < pool.GetThreadCount(); ++i)
+        {
+            queues.push_back(std::make_unique<SpscQueue<std::unique_ptr<StagingBlock>>>(16));
+        }
+
+        std::mutex overflowMutex;
+        std::vector<std::unique_ptr<StagingBlock>> overflow;
+        std::atomic<bool> overflowPending = false;
+
+        std::vector<uint8_t> received(partCount);
+        for (auto _ : state)
+        {
+            std::fill(received.begin(), received.end(), uint8_t(0));
+            for (uint32_t part = 0; part < partCount; ++part)
+            {
+                pool.Submit([&, part]() {
+                    thread_local MeshSimplification::Simplifier simplifier;
+
+                    MeshSimplification::MeshView view;
+                    view.positions = mesh.positions.data();
+                    view.vertexCount = mesh.VertexCount();
+                    view.indices = mesh.indices.data();
+                    view.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+                    auto block = std::make_unique<StagingBlock>();
+                    block->part = part;
+                    simplifier.Simplify(view, view.indexCount / 2, 0.01f, block->indices);
+
+                    auto& queue = *queues[pool.GetCurrentWorkerIndex()];
+                    if (overflowPending.load(std::memory_order_acquire) || !queue.TryPush(std::move(block)))
+                    {
+                        std::lock_guard lock(overflowMutex);
+                        overflow.push_back(std::move(block));
+                        overflowPending.store(true, std::memory_order_release);
+                    }
+                });
+            }
+
+            uint32_t receivedCount = 0;
+            std::unique_ptr<StagingBlock> block;
+            while (receivedCount < partCount)
+            {
+                for (auto& queue : queues)
+                {
+                    while (queue->TryPop(block))
+                    {
+                        received[block->part]++;
+                        receivedCount++;
+                    }
+                }
+                if (overflowPending.load(std::memory_order_acquire))
+                {
+                    std::lock_guard lock(overflowMutex);
+                    for (auto& overflowBlock : overflow)
+                    {
+                        received[overflowBlock->part]++;
+                        receivedCount++;
+                    }
+                    overflow.clear();
+                    overflowPending.store(false, std::memory_order_relaxed);
+                }
+                std::this_thread::yield();
+            }
+            pool.WaitIdle();
+
+            if (std::count(received.begin(), received.end(), uint8_t(1)) != partCount)
+            {
+                state.SkipWithError("Not every part was received exactly once");
+                return;
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * partCount);
+    }
+    // Submits a job which fulfills a promise and waits for it with a timeout, a lost wake-up of a sleeping worker then fails
+    // the check instead of hanging.
+    bool RunsJobWithinTimeout(JobPool& pool)
+    {
+        std::promise<void> done;
+        std::future<void> future = done.get_future();
+        pool.Submit([&done]() { done.set_value(); });
+        return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    }
+
+    // Checks of the pool: each job runs exactly once when submitted from several threads at the same time, from workers or
+    // through ParallelFor, WaitIdle only returns once all jobs finished, jobs submitted to sleeping workers wake them up, the
+    // worker index is valid on workers only, and the destructor runs all jobs still queued.
+    void BM_JobPoolChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            for (uint32_t threadCount : {1u, 2u, 4u})
+            {
+                JobPool pool(threadCount);
+
+                if (pool.GetCurrentWorkerIndex() != JobPool::InvalidWorkerIndex)
+                {
+                    state.SkipWithError("A thread outside the pool has a worker index");
+                    return;
+                }
+
+                // submitters racing each other and the workers, every job counts its own slot
+                constexpr int SubmitterCount = 4;
+                constexpr int JobsPerSubmitter = 2000;
+                std::vector<std::atomic<int>> executions(SubmitterCount * JobsPerSubmitter);
+                std::atomic<int> finished = 0;
+                std::atomic<bool> invalidWorkerIndex = false;
+                std::vector<std::thread> submitters;
+                for (int submitter = 0; submitter < SubmitterCount; ++submitter)
+                {
+                    submitters.emplace_back([&, submitter]() {
+                        for (int i = 0; i < JobsPerSubmitter; ++i)
+                        {
+                            pool.Submit([&, slot = submitter * JobsPerSubmitter + i]() {
+                                if (pool.GetCurrentWorkerIndex() >= pool.GetThreadCount())
+                                {
+                                    invalidWorkerIndex = true;
+                                }
+                                executions[slot].fetch_add(1, std::memory_order_relaxed);
+                                finished.fetch_add(1, std::memory_order_release);
+                            });
+                        }
+                    });
+                }
+                for (std::thread& submitter : submitters)
+                {
+                    submitter.join();
+                }
+                pool.WaitIdle();
+
+                if (finished.load(std::memory_order_acquire) != SubmitterCount * JobsPerSubmitter)
+                {
+                    state.SkipWithError("WaitIdle returned before all jobs finished");
+                    return;
+                }
+                for (const std::atomic<int>& count : executions)
+                {
+                    if (count != 1)
+                    {
+                        state.SkipWithError("A job submitted from several threads did not run exactly once");
+                        return;
+                    }
+                }
+                if (invalidWorkerIndex)
+                {
+                    state.SkipWithError("A job ran with an invalid worker index");
+                    return;
+                }
+
+                // jobs submitted from jobs are counted by WaitIdle before their parent finishes
+                std::atomic<int> nested = 0;
+                pool.Submit([&]() {
+                    for (int i = 0; i < 100; ++i)
+                    {
+                        pool.Submit([&]() {
+                            std::this_thread::sleep_for(std::chrono::microseconds(10));
+                            nested.fetch_add(1, std::memory_order_relaxed);
+                        });
+                    }
+                });
+                pool.WaitIdle();
+                if (nested != 100)
+                {
+                    state.SkipWithError("WaitIdle returned before the nested jobs finished");
+                    return;
+                }
+
+                // single jobs to workers which went to sleep
+                for (int i = 0; i < 50; ++i)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(i % 5 == 0 ? 2000 : 50));
+                    if (!RunsJobWithinTimeout(pool))
+                    {
+                        state.SkipWithError("A job submitted to sleeping workers did not run");
+                        return;
+                    }
+                }
+
+                std::vector<std::atomic<int>> covered(1001);
+                pool.ParallelFor(covered.size(), 16, [&covered](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        covered[i].fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+                for (const std::atomic<int>& count : covered)
+                {
+                    if (count != 1)
+                    {
+                        state.SkipWithError("ParallelFor did not cover every index exactly once");
+                        return;
+                    }
+                }
+            }
+
+            // the destructor runs the jobs still queued
+            std::atomic<int> executed = 0;
+            {
+                JobPool pool(2);
+                for (int i = 0; i < 1000; ++i)
+                {
+                    pool.Submit([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); });
+                }
+            }
+            if (executed != 1000)
+            {
+                state.SkipWithError("The destructor dropped queued jobs");
+                return;
+            }
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_JobPoolBurst)->ArgsProduct({{1, 2, 4}, {64, 1024}})->UseRealTime();
+BENCHMARK(BM_JobPoolNestedSubmit)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK(BM_JobPoolMeshIngestionBurst)->ArgsProduct({{1, 2, 4}, {48}})->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_JobPoolChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,243 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <LatencyHistogram.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr double PercentileFractions[] = {0.5, 0.9, 0.99, 0.999};
+
+    // Frame latencies around 50ms with a long tail, as seen on congested Wi-Fi.
+    std::vector<float> MakeLatencies(size_t count)
+    {
+        std::mt19937 random(3);
+        std::lognormal_distribution<float> latency(std::log(0.05f), 0.35f);
+
+        std::vector<float> latencies(count);
+        std::generate(latencies.begin(), latencies.end(), [&]() { return latency(random); });
+        return latencies;
+    }
+
+    void BM_LatencyHistogramRecord(benchmark::State& state)
+    {
+        const std::vector<float> latencies = MakeLatencies(4096);
+        LatencyHistogram histogram;
+
+        for (auto _ : state)
+        {
+            for (float latency : latencies)
+            {
+                histogram.Record(latency);
+            }
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * latencies.size());
+    }
+
+    // Percentiles of one window as reported by StatisticsHelperPercentileSummary::GetLatencyPercentiles. Reports the largest relative
+    // error of the histogram percentiles against the exact percentiles of the sorted values.
+    void BM_LatencyHistogramPercentiles(benchmark::State& state)
+    {
+        std::vector<float> latencies = MakeLatencies(static_cast<size_t>(state.range(0)));
+        LatencyHistogram histogram;
+        for (float latency : latencies)
+        {
+            histogram.Record(latency);
+        }
+
+        for (auto _ : state)
+        {
+            for (double fraction : PercentileFractions)
+            {
+                benchmark::DoNotOptimize(histogram.GetPercentile(fraction));
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        double maxRelativeError = 0.0;
+        for (double fraction : PercentileFractions)
+        {
+            const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(fraction * latencies.size())));
+            const double exact = latencies[rank - 1];
+            maxRelativeError = std::max(maxRelativeError, std::abs(histogram.GetPercentile(fraction) - exact) / exact);
+        }
+        state.counters["max_relative_error"] = maxRelativeError;
+    }
+
+    // Merging one second windows into a session histogram.
+    void BM_LatencyHistogramMerge(benchmark::State& state)
+    {
+        LatencyHistogram window;
+        for (float latency : MakeLatencies(60))
+        {
+            window.Record(latency);
+        }
+        LatencyHistogram session;
+
+        for (auto _ : state)
+        {
+            session.Merge(window);
+            benchmark::ClobberMemory();
+        }
+    }
+
+    // The value of the given rank (1 based) in the sorted values, which is what GetPercentile approximates.
+    double ExactPercentile(const std::vector<float>& sortedValues, double fraction)
+    {
+        const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(fraction * sortedValues.size())));
+        return sortedValues[rank - 1];
+    }
+
+    // Returns true if both histograms hold the same number of values in every bucket: the percentile of each rank matches.
+    bool HaveSameBuckets(const LatencyHistogram& a, const LatencyHistogram& b)
+    {
+        if (a.GetCount() != b.GetCount())
+        {
+            return false;
+        }
+        for (uint64_t rank = 1; rank <= a.GetCount(); ++rank)
+        {
+            const double fraction = static_cast<double>(rank) / static_cast<double>(a.GetCount());
+            if (a.GetPercentile(fraction) != b.GetPercentile(fraction))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Checks the bucket layout, the percentiles against the sorted values, and that Remove and Merge give the histogram of
+    // recording the remaining values and the union.
+    void BM_LatencyHistogramChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            // Every bucket starts where the previous one ends, buckets above the linear range are at most 1/32 of their lower
+            // bound wide, and all durations from 2^MaxExponent microseconds on fall into the last bucket.
+            for (uint32_t i = 0; i < LatencyHistogram::BucketCount; ++i)
+            {
+                const uint32_t lowerBound = LatencyHistogram::BucketLowerBound(i);
+                const uint32_t upperBound = LatencyHistogram::BucketLowerBound(i + 1);
+                const bool inLinearRange = lowerBound < (1u << LatencyHistogram::SignificantBits);
+                if (upperBound <= lowerBound || LatencyHistogram::BucketIndex(lowerBound) != i ||
+                    (i + 1 < LatencyHistogram::BucketCount && LatencyHistogram::BucketIndex(upperBound - 1) != i) ||
+                    (inLinearRange ? upperBound - lowerBound != 1 : (upperBound - lowerBound) * 32 > lowerBound))
+                {
+                    state.SkipWithError(("wrong bounds of bucket " + std::to_string(i)).c_str());
+                    return;
+                }
+            }
+            if (LatencyHistogram::BucketIndex(1u << LatencyHistogram::MaxExponent) != LatencyHistogram::BucketCount - 1 ||
+                LatencyHistogram::BucketIndex(UINT32_MAX) != LatencyHistogram::BucketCount - 1)
+            {
+                state.SkipWithError("long durations not in the last bucket");
+                return;
+            }
+
+            LatencyHistogram empty;
+            if (empty.GetPercentile(0.5) != 0.0f)
+            {
+                state.SkipWithError("percentile of an empty histogram");
+                return;
+            }
+
+            // The reported middle of a bucket is at most half a bucket (1/64 of the lower bound) away from any value in it,
+            // plus the rounding to microseconds.
+            std::mt19937 random(9);
+            std::uniform_real_distribution<float> uniform(0.001f, 0.2f);
+            std::vector<std::vector<float>> distributions = {MakeLatencies(60), MakeLatencies(600), MakeLatencies(36000), {}, {}};
+            for (int i = 0; i < 5000; ++i)
+            {
+                distributions[3].push_back(uniform(random));
+                // Mostly fast frames with rare spikes, the tail percentiles land in the spikes.
+                distributions[4].push_back(i % 97 == 0 ? 0.5f + uniform(random) : 0.016f + 0.01f * uniform(random));
+            }
+
+            for (std::vector<float>& values : distributions)
+            {
+                LatencyHistogram histogram;
+                for (float value : values)
+                {
+                    histogram.Record(value);
+                }
+                std::sort(values.begin(), values.end());
+
+                for (double fraction : PercentileFractions)
+                {
+                    const double exact = ExactPercentile(values, fraction);
+                    const double tolerance = exact / 64.0 + 0.5e-6 + exact * 1e-6;
+                    if (histogram.GetCount() != values.size() || std::abs(histogram.GetPercentile(fraction) - exact) > tolerance)
+                    {
+                        state.SkipWithError(("percentile " + std::to_string(fraction) + " out of the error bound for " +
+                                             std::to_string(values.size()) + " values")
+                                                .c_str());
+                        return;
+                    }
+                }
+            }
+
+            // Merging windows gives the histogram of recording all their values, removing values the histogram of the rest.
+            std::vector<float> values = MakeLatencies(3000);
+            LatencyHistogram merged;
+            LatencyHistogram all;
+            LatencyHistogram secondHalf;
+            for (size_t first = 0; first < values.size(); first += 600)
+            {
+                LatencyHistogram window;
+                for (size_t i = first; i < first + 600; ++i)
+                {
+                    window.Record(values[i]);
+                    all.Record(values[i]);
+                    if (i >= values.size() / 2)
+                    {
+                        secondHalf.Record(values[i]);
+                    }
+                }
+                merged.Merge(window);
+            }
+            if (!HaveSameBuckets(merged, all))
+            {
+                state.SkipWithError("merged histogram differs from recording the union");
+                return;
+            }
+
+            for (size_t i = 0; i < values.size() / 2; ++i)
+            {
+                all.Remove(values[i]);
+            }
+            if (!HaveSameBuckets(all, secondHalf))
+            {
+                state.SkipWithError("removing values differs from not recording them");
+                return;
+            }
+
+            all.Reset();
+            if (all.GetCount() != 0 || all.GetPercentile(0.99) != 0.0f)
+            {
+                state.SkipWithError("histogram not reset");
+                return;
+            }
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_LatencyHistogramRecord);
+BENCHMARK(BM_LatencyHistogramPercentiles)->Arg(60)->Arg(600)->Arg(36000);
+BENCHMARK(BM_LatencyHistogramMerge);
+BENCHMARK(BM_LatencyHistogramChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,284 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "BenchmarkUtils.h"
+
+#include <holographic/MeshSimplifier.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace BenchmarkUtils;
+using namespace MeshSimplification;
+
+namespace
+{
+    MeshView MakeView(const SurfaceMesh& mesh)
+    {
+        MeshView view;
+        view.positions = mesh.positions.data();
+        view.vertexCount = mesh.VertexCount();
+        view.indices = mesh.indices.data();
+        view.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            view.scale[axis] = mesh.scale[axis];
+        }
+        return view;
+    }
+
+    // Simplification of one surface part to the given percentage of its triangles, with the error bound of the farthest
+    // level of detail used by SpatialSurfaceMeshRenderer.
+    void BM_SimplifySurfaceMesh(benchmark::State& state)
+    {
+        const SurfaceMesh mesh = MakeSurfaceMesh(static_cast<uint32_t>(state.range(0)));
+        const MeshView view = MakeView(mesh);
+        const uint32_t targetIndexCount = static_cast<uint32_t>(mesh.indices.size() * state.range(1) / 100);
+
+        Simplifier simplifier;
+        std::vector<uint16_t> result;
+        uint32_t indexCount = 0;
+        for (auto _ : state)
+        {
+            indexCount = simplifier.Simplify(view, targetIndexCount, 0.05f, result);
+            benchmark::DoNotOptimize(result.data());
+        }
+
+        state.counters["triangles"] = static_cast<double>(mesh.indices.size() / 3);
+        state.counters["kept"] = static_cast<double>(indexCount) / mesh.indices.size();
+        state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+    }
+
+    // The wall of MakeSurfaceMesh with a hole cut into it, which adds an inner border.
+    SurfaceMesh MakeSurfaceMeshWithHole(uint32_t gridSize)
+    {
+        SurfaceMesh mesh = MakeSurfaceMesh(gridSize);
+        std::vector<uint16_t> indices;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            const uint32_t x = mesh.indices[i] % gridSize;
+            const uint32_t y = mesh.indices[i] / gridSize;
+            if (x < gridSize / 3 || x > gridSize / 2 || y < gridSize / 3 || y > gridSize / 2)
+            {
+                indices.insert(indices.end(), mesh.indices.begin() + i, mesh.indices.begin() + i + 3);
+            }
+        }
+        mesh.indices = std::move(indices);
+        return mesh;
+    }
+
+    // Edges used by exactly one triangle, as (smaller, larger) vertex pairs.
+    std::set<std::pair<uint32_t, uint32_t>> GetBorderEdges(const uint16_t* indices, size_t indexCount)
+    {
+        std::map<std::pair<uint32_t, uint32_t>, int> edgeUseCount;
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const uint32_t a = indices[i + corner];
+                const uint32_t b = indices[i + (corner + 1) % 3];
+                edgeUseCount[{std::min(a, b), std::max(a, b)}]++;
+            }
+        }
+
+        std::set<std::pair<uint32_t, uint32_t>> borderEdges;
+        for (const auto& [edge, useCount] : edgeUseCount)
+        {
+            if (useCount == 1)
+            {
+                borderEdges.insert(edge);
+            }
+        }
+        return borderEdges;
+    }
+
+    // Returns an empty string if the simplified indices are a valid mesh over the vertices of the source: indices in range, no
+    // degenerate or flipped triangles, and the same open borders. Also checks that the area weighted quadric error of every
+    // vertex cluster, which is a kept vertex and the vertices collapsed into it, is within maxError at the kept vertex. The
+    // quadrics are computed here in double precision from the source triangles.
+    std::string CheckSimplifiedMesh(
+        const SurfaceMesh& mesh, const uint16_t* indices, uint32_t indexCount, const std::vector<uint16_t>& result,
+        const std::vector<uint32_t>& vertexRemap, float maxError)
+    {
+        const uint32_t vertexCount = mesh.VertexCount();
+        auto position = [&mesh](uint32_t vertex, int axis) {
+            return std::max(mesh.positions[size_t(vertex) * 4 + axis] / 32767.0, -1.0) * mesh.scale[axis];
+        };
+        auto normal = [&position](const uint16_t* triangle) {
+            double edges[2][3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                edges[0][axis] = position(triangle[1], axis) - position(triangle[0], axis);
+                edges[1][axis] = position(triangle[2], axis) - position(triangle[0], axis);
+            }
+            return std::array<double, 3>{
+                edges[0][1] * edges[1][2] - edges[0][2] * edges[1][1], edges[0][2] * edges[1][0] - edges[0][0] * edges[1][2],
+                edges[0][0] * edges[1][1] - edges[0][1] * edges[1][0]};
+        };
+
+        if (result.size() % 3 != 0)
+        {
+            return "index count not a multiple of 3";
+        }
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            const uint16_t* triangle = &result[i];
+            if (triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount)
+            {
+                return "index out of range";
+            }
+            const std::array<double, 3> n = normal(triangle);
+            if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0] ||
+                n[0] * n[0] + n[1] * n[1] + n[2] * n[2] == 0.0)
+            {
+                return "degenerate triangle";
+            }
+        }
+
+        // Vertices are never moved and border vertices never collapse, so the borders stay exactly in place.
+        if (GetBorderEdges(result.data(), result.size()) != GetBorderEdges(indices, indexCount))
+        {
+            return "borders changed";
+        }
+
+        std::vector<uint8_t> referenced(vertexCount, 0);
+        for (uint16_t index : result)
+        {
+            referenced[index] = 1;
+        }
+        std::vector<std::array<double, 11>> quadrics(vertexCount, std::array<double, 11>{});
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            std::array<double, 3> n = normal(indices + i);
+            const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0.0)
+            {
+                continue;
+            }
+            for (double& component : n)
+            {
+                component /= length;
+            }
+            const double d = -(n[0] * position(indices[i], 0) + n[1] * position(indices[i], 1) + n[2] * position(indices[i], 2));
+            const double w = 0.5 * length;
+            const std::array<double, 11> plane = {
+                w * n[0] * n[0], w * n[1] * n[1], w * n[2] * n[2], w * n[0] * n[1], w * n[0] * n[2], w * n[1] * n[2],
+                w * n[0] * d,    w * n[1] * d,    w * n[2] * d,    w * d * d,       w};
+
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                // the quadric goes to the cluster of the kept vertex
+                const uint32_t vertex = indices[i + corner];
+                const uint32_t kept = vertexRemap[vertex];
+                if (kept >= vertexCount || !referenced[kept] || vertexRemap[kept] != kept)
+                {
+                    return "vertex collapsed into a vertex which is not kept";
+                }
+                for (size_t k = 0; k < plane.size(); ++k)
+                {
+                    quadrics[kept][k] += plane[k];
+                }
+            }
+        }
+
+        for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            const std::array<double, 11>& q = quadrics[vertex];
+            if (q[10] == 0.0)
+            {
+                continue;
+            }
+            const double x = position(vertex, 0), y = position(vertex, 1), z = position(vertex, 2);
+            const double error = q[0] * x * x + q[1] * y * y + q[2] * z * z + 2.0 * (q[3] * x * y + q[4] * x * z + q[5] * y * z) +
+                                 2.0 * (q[6] * x + q[7] * y + q[8] * z) + q[9];
+            if (error / q[10] > double(maxError) * maxError * 1.01 + 1e-6)
+            {
+                return "quadric error of a collapsed vertex above the bound";
+            }
+        }
+        return {};
+    }
+
+    // Checks the levels of detail as SpatialSurfaceMeshRenderer builds them, each simplified from the previous level, with the
+    // renderer's error bounds, with an error bound which lets the simplifier reach every target, and with an error bound below
+    // the sensor noise which stops it long before the target.
+    void BM_SimplifySurfaceMeshChecks(benchmark::State& state)
+    {
+        struct Level
+        {
+            float triangleRatio;
+            float maxError;
+        };
+        const Level rendererLevels[] = {{0.4f, 0.01f}, {0.15f, 0.03f}};
+        const Level reachableLevels[] = {{0.4f, 1.0f}, {0.15f, 1.0f}, {0.05f, 1.0f}};
+        const Level boundLevels[] = {{0.05f, 0.003f}};
+
+        for (auto _ : state)
+        {
+            Simplifier simplifier;
+            for (const SurfaceMesh& mesh : {MakeSurfaceMesh(65), MakeSurfaceMesh(129), MakeSurfaceMeshWithHole(65)})
+            {
+                for (std::span<const Level> levels : {std::span<const Level>(rendererLevels), std::span<const Level>(reachableLevels),
+                                                      std::span<const Level>(boundLevels)})
+                {
+                    const uint32_t fullIndexCount = static_cast<uint32_t>(mesh.indices.size());
+                    std::vector<uint16_t> indices = mesh.indices;
+                    for (const Level& level : levels)
+                    {
+                        MeshView view = MakeView(mesh);
+                        view.indices = indices.data();
+                        view.indexCount = static_cast<uint32_t>(indices.size());
+
+                        const uint32_t targetIndexCount = static_cast<uint32_t>(fullIndexCount * level.triangleRatio);
+                        std::vector<uint16_t> result;
+                        const uint32_t indexCount = simplifier.Simplify(view, targetIndexCount, level.maxError, result);
+
+                        std::string error = CheckSimplifiedMesh(
+                            mesh, view.indices, view.indexCount, result, simplifier.GetVertexRemap(), level.maxError);
+                        if (error.empty() && (indexCount != result.size() || indexCount > view.indexCount))
+                        {
+                            error = "triangle count grew";
+                        }
+                        // Without a binding error bound the simplifier stops at the target, give or take the triangles of the
+                        // collapses of its last pass.
+                        if (error.empty() && level.maxError >= 1.0f &&
+                            (indexCount > targetIndexCount || indexCount + fullIndexCount / 50 < targetIndexCount))
+                        {
+                            error = "target triangle count missed: " + std::to_string(indexCount / 3) + " triangles for " +
+                                    std::to_string(targetIndexCount / 3);
+                        }
+                        if (!error.empty())
+                        {
+                            state.SkipWithError((error + " at " + std::to_string(level.triangleRatio) + " of " +
+                                                 std::to_string(fullIndexCount / 3) + " triangles")
+                                                    .c_str());
+                            return;
+                        }
+
+                        indices = std::move(result);
+                    }
+                }
+            }
+        }
+    }
+} // namespace
+
+// 65x65 to 181x181 vertices covers the part sizes observed at 750 triangles per cubic meter.
+BENCHMARK(BM_SimplifySurfaceMesh)->ArgsProduct({{65, 129, 181}, {50, 20}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SimplifySurfaceMeshChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,192 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <RingBufferAllocator.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Frames the GPU lags behind the CPU, as with the per-frame event queries of DynamicVertexRingBuffer.
+    constexpr uint64_t FramesInFlight = 3;
+
+    // Returns nullptr if the allocator behaves as documented for the basic cases, or the description of the first failure.
+    const char* CheckBasicBehavior()
+    {
+        RingBufferAllocator allocator(1024);
+
+        if (allocator.Allocate(100, 16) != 0 || allocator.Allocate(10, 16) != 112 || allocator.GetUsedSize() != 122)
+        {
+            return "allocations are not placed at the aligned write position";
+        }
+        allocator.EndFrame(1);
+        if (allocator.HasOpenFrame() || allocator.GetPendingFrameCount() != 1)
+        {
+            return "EndFrame did not close the frame";
+        }
+
+        // frame 2 leaves two bytes at the end, too few for an aligned allocation
+        if (allocator.Allocate(900, 1) != 122 || allocator.Allocate(1, 16) != RingBufferAllocator::InvalidOffset)
+        {
+            return "full buffer returned an allocation";
+        }
+        allocator.EndFrame(2);
+
+        allocator.Release(1);
+        if (allocator.GetUsedSize() != 900 || allocator.GetPendingFrameCount() != 1)
+        {
+            return "Release did not free exactly the completed frame";
+        }
+
+        // frame 3 wraps, the two bytes at the end are skipped
+        if (allocator.Allocate(130, 1) != RingBufferAllocator::InvalidOffset || allocator.Allocate(122, 1) != 0)
+        {
+            return "allocation did not wrap into the space of the completed frame";
+        }
+        allocator.EndFrame(3);
+        if (allocator.GetUsedSize() != 1024)
+        {
+            return "wrap padding is not counted as used";
+        }
+
+        allocator.Release(2);
+        if (allocator.GetUsedSize() != 124 || allocator.Allocate(900, 1) != 122)
+        {
+            return "space behind the wrapped frame was not freed";
+        }
+        allocator.EndFrame(4);
+
+        allocator.Release(4);
+        if (allocator.GetUsedSize() != 0 || allocator.GetPendingFrameCount() != 0 || allocator.Allocate(1024, 1) != 0)
+        {
+            return "an empty buffer is not available as a whole";
+        }
+
+        allocator.Reset(64);
+        if (allocator.GetCapacity() != 64 || allocator.GetUsedSize() != 0 ||
+            allocator.Allocate(65, 1) != RingBufferAllocator::InvalidOffset)
+        {
+            return "Reset did not free everything or change the capacity";
+        }
+
+        return nullptr;
+    }
+
+    // Random frames with up to FramesInFlight frames pending, tracking which frame owns every byte. Returns nullptr if no
+    // allocation overlaps one that is still in use, or the description of the first failure.
+    const char* CheckRandomFrames()
+    {
+        constexpr size_t Capacity = 4096;
+        RingBufferAllocator allocator(Capacity);
+        std::vector<uint64_t> owner(Capacity, 0);
+        std::mt19937 random(11);
+        std::uniform_int_distribution<size_t> sizeDistribution(1, 700);
+        std::uniform_int_distribution<int> countDistribution(0, 5);
+
+        for (uint64_t frame = 1; frame <= 20000; ++frame)
+        {
+            const uint64_t completedFrame = frame > FramesInFlight ? frame - FramesInFlight : 0;
+            allocator.Release(completedFrame);
+
+            const int count = countDistribution(random);
+            for (int i = 0; i < count; ++i)
+            {
+                const size_t size = sizeDistribution(random);
+                const size_t offset = allocator.Allocate(size, 16);
+                if (offset == RingBufferAllocator::InvalidOffset)
+                {
+                    continue;
+                }
+                if (offset % 16 != 0 || offset + size > Capacity)
+                {
+                    return "allocation is misaligned or outside of the buffer";
+                }
+
+                for (size_t byte = offset; byte < offset + size; ++byte)
+                {
+                    if (owner[byte] > completedFrame)
+                    {
+                        return "allocation overlaps the allocation of a frame in flight";
+                    }
+                    owner[byte] = frame;
+                }
+            }
+            allocator.EndFrame(frame);
+
+            if (allocator.GetUsedSize() > Capacity)
+            {
+                return "used size exceeds the capacity";
+            }
+        }
+
+        return nullptr;
+    }
+
+    void BM_RingBufferAllocatorChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            const char* error = CheckBasicBehavior();
+            if (error == nullptr)
+            {
+                error = CheckRandomFrames();
+            }
+            if (error != nullptr)
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Allocator overhead per draw: range(0) uploads per frame of the sizes the QR code and hand joint renderers produce,
+    // with the GPU FramesInFlight frames behind.
+    void BM_RingBufferAllocatorFrames(benchmark::State& state)
+    {
+        const int drawsPerFrame = static_cast<int>(state.range(0));
+        RingBufferAllocator allocator(4 * 1024 * 1024);
+        std::mt19937 random(3);
+        std::uniform_int_distribution<size_t> sizeDistribution(24 * 36, 26 * 24 * 36);
+        std::vector<size_t> sizes(1024);
+        for (size_t& size : sizes)
+        {
+            size = sizeDistribution(random);
+        }
+
+        uint64_t frame = 0;
+        size_t next = 0;
+        for (auto _ : state)
+        {
+            ++frame;
+            allocator.Release(frame > FramesInFlight ? frame - FramesInFlight : 0);
+            for (int i = 0; i < drawsPerFrame; ++i)
+            {
+                const size_t offset = allocator.Allocate(sizes[next], 16);
+                benchmark::DoNotOptimize(offset);
+                if (offset == RingBufferAllocator::InvalidOffset)
+                {
+                    state.SkipWithError("buffer of a few frames in flight is full");
+                    return;
+                }
+                next = (next + 1) % sizes.size();
+            }
+            allocator.EndFrame(frame);
+        }
+        state.SetItemsProcessed(state.iterations() * drawsPerFrame);
+    }
+} // namespace
+
+BENCHMARK(BM_RingBufferAllocatorChecks)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RingBufferAllocatorFrames)->Arg(2)->Arg(8)->Arg(32);
@@ -0,0 +1,302 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <holographic/SceneMeshConversion.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+using namespace SceneMeshConversion;
+
+namespace
+{
+    // Scene Understanding world mesh, split into meshes of meshGridSize x meshGridSize vertices like the scene object meshes.
+    struct WorldMesh
+    {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        uint32_t vertexCount = 0;
+    };
+
+    WorldMesh MakeWorldMesh(uint32_t gridSize)
+    {
+        WorldMesh mesh;
+        mesh.vertexCount = gridSize * gridSize;
+        mesh.positions.reserve(size_t(mesh.vertexCount) * 3);
+        for (uint32_t y = 0; y < gridSize; ++y)
+        {
+            for (uint32_t x = 0; x < gridSize; ++x)
+            {
+                const float u = 8.0f * x / (gridSize - 1);
+                const float v = 8.0f * y / (gridSize - 1);
+                mesh.positions.insert(mesh.positions.end(), {u, 0.05f * std::sin(u * 3.0f) * std::cos(v * 2.0f), v});
+            }
+        }
+
+        mesh.indices.reserve(size_t(gridSize - 1) * (gridSize - 1) * 6);
+        for (uint32_t y = 0; y + 1 < gridSize; ++y)
+        {
+            for (uint32_t x = 0; x + 1 < gridSize; ++x)
+            {
+                const uint32_t i = y * gridSize + x;
+                mesh.indices.insert(mesh.indices.end(), {i, i + gridSize, i + 1, i + 1, i + gridSize, i + gridSize + 1});
+            }
+        }
+        return mesh;
+    }
+
+    // A scene object location: rotated around y and moved.
+    constexpr float s_objectToScene[16] = {
+        0.8f, 0.0f, -0.6f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.6f, 0.0f, 0.8f, 0.0f, 1.0f, -1.5f, 2.0f, 1.0f};
+    constexpr float s_color[3] = {100 / 255.0f, 1.0f, 1.0f};
+
+    // Vertex of the scene mesh before it was indexed, see SceneUnderstandingRenderer::VertexPositionUVColor.
+    struct VertexPositionUVColor
+    {
+        float pos[3];
+        float uv[2];
+        float color[3];
+    };
+
+    // The previous conversion: three full vertices per triangle, appended one by one.
+    void AppendDeindexedMesh(const WorldMesh& mesh, std::vector<VertexPositionUVColor>& vertices)
+    {
+        const float(&m)[16] = s_objectToScene;
+        for (uint32_t i = 0; i < mesh.indices.size(); ++i)
+        {
+            const float* p = &mesh.positions[size_t(mesh.indices[i]) * 3];
+            VertexPositionUVColor vertex;
+            vertex.pos[0] = p[0] * m[0] + p[1] * m[4] + p[2] * m[8] + m[12];
+            vertex.pos[1] = p[0] * m[1] + p[1] * m[5] + p[2] * m[9] + m[13];
+            vertex.pos[2] = p[0] * m[2] + p[1] * m[6] + p[2] * m[10] + m[14];
+            vertex.uv[0] = 0.0f;
+            vertex.uv[1] = 0.0f;
+            vertex.color[0] = s_color[0];
+            vertex.color[1] = s_color[1];
+            vertex.color[2] = s_color[2];
+            vertices.push_back(vertex);
+        }
+    }
+
+    void BM_SceneMeshDeindexed(benchmark::State& state)
+    {
+        const WorldMesh mesh = MakeWorldMesh(static_cast<uint32_t>(state.range(0)));
+
+        size_t bytes = 0;
+        for (auto _ : state)
+        {
+            std::vector<VertexPositionUVColor> vertices;
+            AppendDeindexedMesh(mesh, vertices);
+            benchmark::DoNotOptimize(vertices.data());
+            bytes = vertices.capacity() * sizeof(VertexPositionUVColor);
+        }
+
+        state.counters["bufferBytes"] = static_cast<double>(mesh.indices.size() * sizeof(VertexPositionUVColor));
+        state.counters["allocatedBytes"] = static_cast<double>(bytes);
+        state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+    }
+
+    void BM_SceneMeshIndexed(benchmark::State& state)
+    {
+        const WorldMesh mesh = MakeWorldMesh(static_cast<uint32_t>(state.range(0)));
+        const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+        size_t bytes = 0;
+        size_t bufferBytes = 0;
+        for (auto _ : state)
+        {
+            IndexedMeshBuilder builder;
+            builder.Reserve(mesh.vertexCount, indexCount);
+            builder.AppendMesh(mesh.positions.data(), mesh.vertexCount, mesh.indices.data(), indexCount, s_objectToScene, s_color);
+            benchmark::DoNotOptimize(builder.GetVertices().data());
+            bufferBytes = builder.GetVertices().size() * sizeof(Vertex) + builder.GetIndices().size() * sizeof(uint32_t);
+            bytes = builder.GetVertices().capacity() * sizeof(Vertex) + builder.GetIndices().capacity() * sizeof(uint32_t);
+        }
+
+        state.counters["bufferBytes"] = static_cast<double>(bufferBytes);
+        state.counters["allocatedBytes"] = static_cast<double>(bytes);
+        state.SetItemsProcessed(state.iterations() * indexCount / 3);
+    }
+
+    // Checks that both conversions produce the same triangles.
+    void BM_SceneMeshConversionMatches(benchmark::State& state)
+    {
+        const WorldMesh mesh = MakeWorldMesh(64);
+        std::vector<VertexPositionUVColor> reference;
+        AppendDeindexedMesh(mesh, reference);
+
+        IndexedMeshBuilder builder;
+        for (auto _ : state)
+        {
+            builder.Clear();
+            // two halves, which must be merged into one draw
+            const uint32_t half = static_cast<uint32_t>(mesh.indices.size() / 2);
+            builder.AppendMesh(mesh.positions.data(), mesh.vertexCount, mesh.indices.data(), half, s_objectToScene, s_color);
+            builder.AppendMesh(
+                mesh.positions.data(),
+                mesh.vertexCount,
+                mesh.indices.data() + half,
+                static_cast<uint32_t>(mesh.indices.size()) - half,
+                s_objectToScene,
+                s_color);
+            benchmark::DoNotOptimize(builder.GetIndices().data());
+        }
+
+        const std::vector<uint32_t>& indices = builder.GetIndices();
+        if (builder.GetDraws().size() != 1 || builder.GetDraws()[0].indexCount != indices.size() || indices.size() != reference.size())
+        {
+            state.SkipWithError("draws do not cover the mesh");
+            return;
+        }
+
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            const Vertex& vertex = builder.GetVertices()[indices[i]];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (std::abs(vertex.position[axis] - reference[i].pos[axis]) > 1e-5f)
+                {
+                    state.SkipWithError("indexed mesh differs from the de-indexed mesh");
+                    return;
+                }
+            }
+        }
+    }
+
+    // Extents of the quads of a scene with objectCount walls, floors, ceilings and platforms.
+    std::vector<float> MakeQuadExtents(size_t objectCount)
+    {
+        std::vector<float> extents(objectCount * 2);
+        for (size_t i = 0; i < extents.size(); ++i)
+        {
+            extents[i] = 0.5f + 0.25f * static_cast<float>(i % 13);
+        }
+        return extents;
+    }
+
+    // The previous quad generation in SceneUnderstandingRenderer: corners transformed one by one, six vertices pushed back.
+    void AppendQuadReference(
+        const float (&positions)[4][3], const float (&uvs)[4][2], const float (&color)[3], std::vector<QuadVertex>& vertices)
+    {
+        const float(&m)[16] = s_objectToScene;
+        QuadVertex vertex;
+        vertex.color[0] = color[0];
+        vertex.color[1] = color[1];
+        vertex.color[2] = color[2];
+        for (int corner : {0, 2, 3, 3, 1, 0})
+        {
+            const float* p = positions[corner];
+            vertex.position[0] = p[0] * m[0] + p[1] * m[4] + p[2] * m[8] + m[12];
+            vertex.position[1] = p[0] * m[1] + p[1] * m[5] + p[2] * m[9] + m[13];
+            vertex.position[2] = p[0] * m[2] + p[1] * m[6] + p[2] * m[10] + m[14];
+            vertex.uv[0] = uvs[corner][0];
+            vertex.uv[1] = uvs[corner][1];
+            vertices.push_back(vertex);
+        }
+    }
+
+    void BM_SceneQuads(benchmark::State& state)
+    {
+        const std::vector<float> extents = MakeQuadExtents(static_cast<size_t>(state.range(0)));
+        const size_t objectCount = extents.size() / 2;
+
+        std::vector<QuadVertex> quadVertices;
+        std::vector<QuadVertex> labelVertices;
+        for (auto _ : state)
+        {
+            quadVertices.clear();
+            labelVertices.clear();
+            for (size_t i = 0; i < objectCount; ++i)
+            {
+                AppendSceneQuad(extents[i * 2], extents[i * 2 + 1], s_objectToScene, s_color, quadVertices);
+                AppendSceneQuadLabel(s_objectToScene, s_color, labelVertices);
+            }
+            benchmark::DoNotOptimize(quadVertices.data());
+            benchmark::DoNotOptimize(labelVertices.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * objectCount);
+    }
+
+    // Checks that the quads and labels match the previous generation in the renderer.
+    void BM_SceneQuadsMatch(benchmark::State& state)
+    {
+        const std::vector<float> extents = MakeQuadExtents(64);
+
+        std::vector<QuadVertex> reference;
+        for (size_t i = 0; i < extents.size(); i += 2)
+        {
+            const float width = extents[i];
+            const float height = extents[i + 1];
+            const float quad[4][3] = {
+                {-width / 2, -height / 2, 0.0f},
+                {width / 2, -height / 2, 0.0f},
+                {-width / 2, height / 2, 0.0f},
+                {width / 2, height / 2, 0.0f}};
+            const float quadUvs[4][2] = {{0, 0}, {0, width}, {height, 0}, {height, width}};
+            AppendQuadReference(quad, quadUvs, s_color, reference);
+
+            const float label[4][3] = {
+                {-LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
+                {LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
+                {-LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f},
+                {LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f}};
+            const float labelUvs[4][2] = {{0, 1}, {1, 1}, {0, 0}, {1, 0}};
+            AppendQuadReference(label, labelUvs, s_color, reference);
+        }
+
+        std::vector<QuadVertex> vertices;
+        for (auto _ : state)
+        {
+            vertices.clear();
+            for (size_t i = 0; i < extents.size(); i += 2)
+            {
+                AppendSceneQuad(extents[i], extents[i + 1], s_objectToScene, s_color, vertices);
+                AppendSceneQuadLabel(s_objectToScene, s_color, vertices);
+            }
+            benchmark::DoNotOptimize(vertices.data());
+        }
+
+        if (vertices.size() != reference.size())
+        {
+            state.SkipWithError("quad vertex count differs");
+            return;
+        }
+
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            const QuadVertex& a = vertices[i];
+            const QuadVertex& b = reference[i];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (std::abs(a.position[axis] - b.position[axis]) > 1e-5f || a.color[axis] != b.color[axis] ||
+                    (axis < 2 && a.uv[axis] != b.uv[axis]))
+                {
+                    state.SkipWithError("quad vertices differ from the previous generation");
+                    return;
+                }
+            }
+        }
+    }
+} // namespace
+
+// 256x256 to 1024x1024 vertices covers rooms to large floors scanned at the fine Scene Understanding mesh level.
+BENCHMARK(BM_SceneMeshDeindexed)->Arg(256)->Arg(512)->Arg(1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneMeshIndexed)->Arg(256)->Arg(512)->Arg(1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneMeshConversionMatches)->Iterations(1);
+
+// A few hundred quads for a room, thousands for a floor of an office building.
+BENCHMARK(BM_SceneQuads)->Arg(256)->Arg(4096);
+BENCHMARK(BM_SceneQuadsMatch)->Iterations(1);
@@ -0,0 +1,332 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <JobPool.h>
+
+#include <holographic/SceneMeshConversion.h>
+#include <holographic/SceneObjectCache.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace SceneMeshConversion;
+using namespace SceneObjectCaching;
+
+namespace
+{
+    // Scene object of a synthetic scene: a quad (wall, floor, platform, ...) or a small mesh (furniture scanned as world mesh).
+    // The content is generated from the version, a changed object gets a new version.
+    struct SyntheticObject
+    {
+        ObjectId id;
+        uint32_t version = 0;
+        bool hasMesh = false;
+    };
+
+    constexpr uint32_t s_meshGridSize = 24;
+    constexpr float s_color[3] = {100 / 255.0f, 1.0f, 1.0f};
+
+    // The vertices created for one object, see SceneUnderstandingRenderer::SceneObjectVertices.
+    struct ObjectVertices
+    {
+        std::vector<float> quadVertices;
+        IndexedMeshBuilder mesh;
+    };
+
+    using Cache = ObjectResultCache<ObjectVertices>;
+
+    // A scene with every tenth object a mesh, as in a furnished room.
+    std::vector<SyntheticObject> MakeScene(size_t objectCount)
+    {
+        std::mt19937_64 random(7);
+        std::vector<SyntheticObject> objects(objectCount);
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            objects[i].id.data[0] = random();
+            objects[i].id.data[1] = random();
+            objects[i].hasMesh = i % 10 == 0;
+        }
+        return objects;
+    }
+
+    // Changes changedPercent of the objects, spread over the scene.
+    void ChangeObjects(std::vector<SyntheticObject>& objects, uint32_t changedPercent, uint32_t& round)
+    {
+        round++;
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            if ((i * 7919 + round) % 100 < changedPercent)
+            {
+                objects[i].version++;
+            }
+        }
+    }
+
+    void MakeLocation(const SyntheticObject& object, float (&location)[16])
+    {
+        const float angle = 0.1f * object.version + static_cast<float>(object.id.data[0] % 628) * 0.01f;
+        const float c = std::cos(angle);
+        const float s = std::sin(angle);
+        const float values[16] = {c, 0, -s, 0, 0, 1, 0, 0, s, 0, c, 0, (object.id.data[1] % 100) * 0.1f, 0, 1.0f, 1};
+        std::copy(std::begin(values), std::end(values), location);
+    }
+
+    // Stands in for reading a mesh from Scene Understanding, which copies the positions and indices out of the scene.
+    void ReadMesh(const SyntheticObject& object, std::vector<float>& positions, std::vector<uint32_t>& indices)
+    {
+        static const std::vector<float> s_positions = []() {
+            std::vector<float> result;
+            for (uint32_t y = 0; y < s_meshGridSize; ++y)
+            {
+                for (uint32_t x = 0; x < s_meshGridSize; ++x)
+                {
+                    result.insert(result.end(), {x * 0.02f, 0.01f * std::sin(0.3f * (x + y)), y * 0.02f});
+                }
+            }
+            return result;
+        }();
+        static const std::vector<uint32_t> s_indices = []() {
+            const uint32_t n = s_meshGridSize;
+            std::vector<uint32_t> result;
+            for (uint32_t y = 0; y + 1 < n; ++y)
+            {
+                for (uint32_t x = 0; x + 1 < n; ++x)
+                {
+                    const uint32_t i = y * n + x;
+                    result.insert(result.end(), {i, i + n, i + 1, i + 1, i + n, i + n + 1});
+                }
+            }
+            return result;
+        }();
+
+        positions.assign(s_positions.begin(), s_positions.end());
+        indices.assign(s_indices.begin(), s_indices.end());
+
+        // a changed mesh has one vertex moved
+        positions[(object.version % s_meshGridSize) * 3 + 1] += 0.001f * object.version;
+    }
+
+    // Per-object work as in SceneUnderstandingRenderer::ProcessSceneObject: read, hash, reuse or create.
+    Cache::Entry ProcessObject(const SyntheticObject& object, const Cache& cache, std::atomic<size_t>& createdCount)
+    {
+        thread_local std::vector<float> positions;
+        thread_local std::vector<uint32_t> indices;
+
+        float location[16];
+        MakeLocation(object, location);
+
+        ContentHasher hasher;
+        hasher.AddValue(location);
+        if (object.hasMesh)
+        {
+            ReadMesh(object, positions, indices);
+            hasher.Add(positions.data(), positions.size() * sizeof(float));
+            hasher.Add(indices.data(), indices.size() * sizeof(uint32_t));
+        }
+
+        Cache::Entry entry = cache.Find(object.id, hasher.Get());
+        if (entry.result)
+        {
+            return entry;
+        }
+
+        auto vertices = std::make_shared<ObjectVertices>();
+        if (object.hasMesh)
+        {
+            vertices->mesh.AppendMesh(
+                positions.data(),
+                static_cast<uint32_t>(positions.size() / 3),
+                indices.data(),
+                static_cast<uint32_t>(indices.size()),
+                location,
+                s_color);
+        }
+        else
+        {
+            // six vertices of position, uv and color
+            vertices->quadVertices.resize(6 * 8);
+            for (size_t i = 0; i < 6; ++i)
+            {
+                for (size_t axis = 0; axis < 3; ++axis)
+                {
+                    vertices->quadVertices[i * 8 + axis] = location[12 + axis] + location[axis * 4] * (i % 2);
+                }
+            }
+        }
+
+        createdCount.fetch_add(1, std::memory_order_relaxed);
+        entry.result = std::move(vertices);
+        return entry;
+    }
+
+    // Merges the vertices of all objects as CreateVerticesAsync does before exchanging them under the lock.
+    size_t Merge(const std::vector<Cache::Entry>& entries, std::vector<float>& quadVertices, IndexedMeshBuilder& mesh)
+    {
+        size_t quadCount = 0;
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        for (const Cache::Entry& entry : entries)
+        {
+            quadCount += entry.result->quadVertices.size();
+            vertexCount += entry.result->mesh.GetVertices().size();
+            indexCount += entry.result->mesh.GetIndices().size();
+        }
+
+        quadVertices.clear();
+        quadVertices.reserve(quadCount);
+        mesh.Clear();
+        mesh.Reserve(vertexCount, indexCount);
+        for (const Cache::Entry& entry : entries)
+        {
+            quadVertices.insert(quadVertices.end(), entry.result->quadVertices.begin(), entry.result->quadVertices.end());
+            mesh.Append(entry.result->mesh);
+        }
+        return mesh.GetIndices().size() + quadVertices.size();
+    }
+
+    // One scene update of the renderer with the given number of workers. changedPercent of the objects change per update,
+    // 100 corresponds to rebuilding every object as before the cache.
+    void BM_SceneObjectUpdate(benchmark::State& state)
+    {
+        std::vector<SyntheticObject> objects = MakeScene(static_cast<size_t>(state.range(0)));
+        const uint32_t changedPercent = static_cast<uint32_t>(state.range(1));
+        JobPool pool(static_cast<uint32_t>(state.range(2)));
+
+        Cache cache;
+        std::vector<Cache::Entry> entries(objects.size());
+        std::vector<float> quadVertices;
+        IndexedMeshBuilder mesh;
+        std::vector<Cache::ResultPtr> results;
+        std::vector<Cache::ResultPtr> mergedResults;
+        std::atomic<size_t> createdCount = 0;
+        uint32_t round = 0;
+
+        // fill the cache with the initial scene
+        pool.ParallelFor(objects.size(), 32, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                entries[i] = ProcessObject(objects[i], cache, createdCount);
+            }
+        });
+        cache.Replace(entries);
+        createdCount = 0;
+
+        for (auto _ : state)
+        {
+            ChangeObjects(objects, changedPercent, round);
+            if (changedPercent >= 100)
+            {
+                cache.Clear();
+            }
+
+            pool.ParallelFor(objects.size(), 32, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    entries[i] = ProcessObject(objects[i], cache, createdCount);
+                }
+            });
+            cache.Replace(entries);
+
+            // the renderer only merges again if an object changed
+            results.clear();
+            for (const Cache::Entry& entry : entries)
+            {
+                results.push_back(entry.result);
+            }
+            if (results != mergedResults)
+            {
+                benchmark::DoNotOptimize(Merge(entries, quadVertices, mesh));
+                std::swap(results, mergedResults);
+            }
+        }
+
+        state.counters["createdPerUpdate"] = static_cast<double>(createdCount.load()) / state.iterations();
+        state.SetItemsProcessed(state.iterations() * objects.size());
+    }
+
+    // Checks that objects keep their results until they change, and that merged meshes match the per-object meshes.
+    void BM_SceneObjectCacheReuse(benchmark::State& state)
+    {
+        std::vector<SyntheticObject> objects = MakeScene(200);
+        JobPool pool(2);
+        Cache cache;
+        std::vector<Cache::Entry> entries(objects.size());
+        std::atomic<size_t> createdCount = 0;
+
+        auto update = [&]() {
+            pool.ParallelFor(objects.size(), 32, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    entries[i] = ProcessObject(objects[i], cache, createdCount);
+                }
+            });
+            cache.Replace(entries);
+        };
+
+        for (auto _ : state)
+        {
+            createdCount = 0;
+            update();
+            const size_t initialCount = createdCount.exchange(0);
+            update();
+            const size_t unchangedCount = createdCount.exchange(0);
+            objects[3].version++;
+            objects[10].version++;
+            update();
+            const size_t changedCount = createdCount.exchange(0);
+
+            if (initialCount != objects.size() || unchangedCount != 0 || changedCount != 2 || cache.Size() != objects.size())
+            {
+                state.SkipWithError("cache did not reuse exactly the unchanged objects");
+                return;
+            }
+        }
+
+        std::vector<float> quadVertices;
+        IndexedMeshBuilder mesh;
+        Merge(entries, quadVertices, mesh);
+        size_t offset = 0;
+        for (const Cache::Entry& entry : entries)
+        {
+            const IndexedMeshBuilder& objectMesh = entry.result->mesh;
+            for (size_t i = 0; i < objectMesh.GetIndices().size(); ++i)
+            {
+                const Vertex& expected = objectMesh.GetVertices()[objectMesh.GetIndices()[i]];
+                const Vertex& merged = mesh.GetVertices()[mesh.GetIndices()[offset + i]];
+                if (expected.position[0] != merged.position[0] || expected.position[2] != merged.position[2])
+                {
+                    state.SkipWithError("merged mesh differs from the object meshes");
+                    return;
+                }
+            }
+            offset += objectMesh.GetIndices().size();
+        }
+        if (mesh.GetDraws().size() != 1)
+        {
+            state.SkipWithError("meshes of the same color were not merged into one draw");
+        }
+    }
+} // namespace
+
+// 2000 to 8000 objects: a furnished room to a floor. 100% changed is a full rebuild, 1% and 0% are typical periodic refreshes.
+BENCHMARK(BM_SceneObjectUpdate)
+    ->ArgsProduct({{2000, 8000}, {100, 10, 1, 0}, {1, 2}})
+    ->ArgNames({"objects", "changed%", "threads"})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneObjectCacheReuse)->Iterations(1);
@@ -0,0 +1,215 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <SnapshotPublisher.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace
+{
+    // Every field holds the same sequence number, so a snapshot mixing two publications is detected by the reader.
+    struct Snapshot
+    {
+        uint64_t values[32];
+    };
+
+    void WriteSnapshot(Snapshot& snapshot, uint64_t sequence)
+    {
+        for (uint64_t& value : snapshot.values)
+        {
+            value = sequence;
+        }
+    }
+
+    bool IsConsistent(const Snapshot& snapshot)
+    {
+        for (uint64_t value : snapshot.values)
+        {
+            if (value != snapshot.values[0])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Deterministic checks of the triple buffer: a new snapshot is only reported once, the latest of several publications wins,
+    // the writer never gets the buffer held by the reader, and that buffer does not change while there is no new snapshot.
+    void BM_SnapshotPublisherChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            SnapshotPublisher<Snapshot> publisher;
+            if (publisher.Update() || publisher.Read().values[0] != 0 || !IsConsistent(publisher.Read()))
+            {
+                state.SkipWithError("A new publisher reported a snapshot or did not read a default constructed one");
+                return;
+            }
+
+            uint64_t sequence = 0;
+            uint64_t readSequence = 0;
+            const Snapshot* readBuffer = &publisher.Read();
+            for (int step = 0; step < 1000; ++step)
+            {
+                // publish none, one or several snapshots, only the last one is expected to be read
+                const int publishCount = step % 4;
+                for (int i = 0; i < publishCount; ++i)
+                {
+                    if (&publisher.GetWriteBuffer() == &publisher.Read())
+                    {
+                        state.SkipWithError("The write buffer is the buffer held by the reader");
+                        return;
+                    }
+                    WriteSnapshot(publisher.GetWriteBuffer(), ++sequence);
+                    publisher.Publish();
+                }
+
+                // the writer starts on its next snapshot without publishing it
+                if (&publisher.GetWriteBuffer() == &publisher.Read())
+                {
+                    state.SkipWithError("The write buffer is the buffer held by the reader");
+                    return;
+                }
+                WriteSnapshot(publisher.GetWriteBuffer(), UINT64_MAX);
+
+                if (publisher.Update() != (publishCount > 0))
+                {
+                    state.SkipWithError("Update did not report exactly the new snapshots");
+                    return;
+                }
+                if (publishCount > 0)
+                {
+                    readSequence = sequence;
+                    readBuffer = &publisher.Read();
+                }
+                else if (&publisher.Read() != readBuffer)
+                {
+                    state.SkipWithError("Update without a new snapshot changed the buffer held by the reader");
+                    return;
+                }
+
+                if (!IsConsistent(publisher.Read()) || publisher.Read().values[0] != readSequence)
+                {
+                    state.SkipWithError("The reader did not see the latest published snapshot unchanged");
+                    return;
+                }
+                if (publisher.Update())
+                {
+                    state.SkipWithError("A snapshot was reported twice");
+                    return;
+                }
+            }
+        }
+    }
+
+    // The reader side while a writer thread publishes as fast as it can. Fails if a torn or outdated snapshot is observed.
+    void BM_SnapshotPublisherReadUnderContention(benchmark::State& state)
+    {
+        SnapshotPublisher<Snapshot> publisher;
+        std::atomic<bool> stop = false;
+
+        std::thread writer([&]() {
+            for (uint64_t sequence = 1; !stop.load(std::memory_order_relaxed); ++sequence)
+            {
+                WriteSnapshot(publisher.GetWriteBuffer(), sequence);
+                publisher.Publish();
+            }
+        });
+
+        uint64_t lastSequence = 0;
+        int64_t newSnapshots = 0;
+        bool failed = false;
+        for (auto _ : state)
+        {
+            if (publisher.Update())
+            {
+                const Snapshot& snapshot = publisher.Read();
+                if (!IsConsistent(snapshot) || snapshot.values[0] <= lastSequence)
+                {
+                    failed = true;
+                    break;
+                }
+                lastSequence = snapshot.values[0];
+                newSnapshots++;
+            }
+        }
+
+        stop = true;
+        writer.join();
+
+        if (failed)
+        {
+            state.SkipWithError("Reader observed a torn or outdated snapshot");
+            return;
+        }
+        state.counters["new"] = benchmark::Counter(static_cast<double>(newSnapshots) / state.iterations());
+    }
+
+    // The writer side while a reader thread takes every snapshot it can. Fails if the reader observes a torn snapshot.
+    void BM_SnapshotPublisherPublishUnderContention(benchmark::State& state)
+    {
+        SnapshotPublisher<Snapshot> publisher;
+        std::atomic<bool> stop = false;
+        std::atomic<bool> failed = false;
+
+        std::thread reader([&]() {
+            uint64_t lastSequence = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                if (publisher.Update())
+                {
+                    const Snapshot& snapshot = publisher.Read();
+                    if (!IsConsistent(snapshot) || snapshot.values[0] <= lastSequence)
+                    {
+                        failed = true;
+                        return;
+                    }
+                    lastSequence = snapshot.values[0];
+                }
+            }
+        });
+
+        uint64_t sequence = 0;
+        for (auto _ : state)
+        {
+            WriteSnapshot(publisher.GetWriteBuffer(), ++sequence);
+            publisher.Publish();
+        }
+
+        stop = true;
+        reader.join();
+
+        if (failed)
+        {
+            state.SkipWithError("Reader observed a torn or outdated snapshot");
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Polling without a new snapshot, which is what the frame loop does on almost every frame.
+    void BM_SnapshotPublisherPollIdle(benchmark::State& state)
+    {
+        SnapshotPublisher<Snapshot> publisher;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(publisher.Update());
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_SnapshotPublisherChecks)->Iterations(1);
+BENCHMARK(BM_SnapshotPublisherReadUnderContention)->UseRealTime();
+BENCHMARK(BM_SnapshotPublisherPublishUnderContention)->UseRealTime();
+BENCHMARK(BM_SnapshotPublisherPollIdle);
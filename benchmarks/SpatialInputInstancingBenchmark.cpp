@@ -0,0 +1,365 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "BenchmarkUtils.h"
+
+#include <holographic/SpatialInputInstancing.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace BenchmarkUtils;
+using namespace SpatialInputInstancing;
+
+namespace
+{
+    struct JointPose
+    {
+        float position[3];
+        float orientation[4];
+        float radius;
+    };
+
+    // Joint poses of an open right hand held in front of the camera, in the order in which SpatialInputRenderer queries them.
+    constexpr JointPose RightHandFixture[] = {
+        {{0.1200f, -0.2450f, -0.3950f}, {0.0250f, 0.0000f, 0.0000f, 0.9997f}, 0.0140f}, // Palm
+        {{0.1200f, -0.2500f, -0.3500f}, {0.0250f, 0.0000f, 0.0000f, 0.9997f}, 0.0120f}, // Wrist
+        {{0.1095f, -0.2500f, -0.3550f}, {0.0000f, 0.2955f, 0.0000f, 0.9553f}, 0.0110f}, // ThumbMetacarpal
+        {{0.0897f, -0.2500f, -0.3839f}, {-0.0382f, 0.2953f, 0.0118f, 0.9546f}, 0.0100f}, // ThumbProximal
+        {{0.0700f, -0.2528f, -0.4127f}, {-0.0763f, 0.2946f, 0.0236f, 0.9523f}, 0.0090f}, // ThumbDistal
+        {{0.0533f, -0.2576f, -0.4371f}, {-0.1144f, 0.2934f, 0.0354f, 0.9485f}, 0.0080f}, // ThumbTip
+        {{0.1134f, -0.2500f, -0.3550f}, {0.0000f, 0.0400f, 0.0000f, 0.9992f}, 0.0100f}, // IndexMetacarpal
+        {{0.1078f, -0.2500f, -0.4248f}, {-0.0400f, 0.0400f, 0.0016f, 0.9984f}, 0.0090f}, // IndexProximal
+        {{0.1042f, -0.2536f, -0.4695f}, {-0.0799f, 0.0399f, 0.0032f, 0.9960f}, 0.0080f}, // IndexIntermediate
+        {{0.1022f, -0.2576f, -0.4941f}, {-0.1196f, 0.0397f, 0.0048f, 0.9920f}, 0.0070f}, // IndexDistal
+        {{0.1005f, -0.2628f, -0.5154f}, {-0.1592f, 0.0395f, 0.0064f, 0.9864f}, 0.0060f}, // IndexTip
+        {{0.1194f, -0.2500f, -0.3550f}, {0.0000f, 0.0000f, 0.0000f, 1.0000f}, 0.0100f}, // MiddleMetacarpal
+        {{0.1194f, -0.2500f, -0.4250f}, {-0.0400f, 0.0000f, 0.0000f, 0.9992f}, 0.0090f}, // MiddleProximal
+        {{0.1194f, -0.2540f, -0.4748f}, {-0.0799f, 0.0000f, 0.0000f, 0.9968f}, 0.0080f}, // MiddleIntermediate
+        {{0.1194f, -0.2588f, -0.5045f}, {-0.1197f, 0.0000f, 0.0000f, 0.9928f}, 0.0070f}, // MiddleDistal
+        {{0.1194f, -0.2645f, -0.5278f}, {-0.1593f, 0.0000f, 0.0000f, 0.9872f}, 0.0060f}, // MiddleTip
+        {{0.1251f, -0.2500f, -0.3550f}, {0.0000f, -0.0350f, 0.0000f, 0.9994f}, 0.0090f}, // RingMetacarpal
+        {{0.1296f, -0.2500f, -0.4198f}, {-0.0400f, -0.0350f, -0.0014f, 0.9986f}, 0.0080f}, // RingProximal
+        {{0.1328f, -0.2536f, -0.4646f}, {-0.0799f, -0.0349f, -0.0028f, 0.9962f}, 0.0075f}, // RingIntermediate
+        {{0.1347f, -0.2581f, -0.4922f}, {-0.1196f, -0.0347f, -0.0042f, 0.9922f}, 0.0070f}, // RingDistal
+        {{0.1362f, -0.2633f, -0.5135f}, {-0.1592f, -0.0345f, -0.0056f, 0.9866f}, 0.0060f}, // RingTip
+        {{0.1299f, -0.2500f, -0.3550f}, {0.0000f, -0.0749f, 0.0000f, 0.9972f}, 0.0090f}, // LittleMetacarpal
+        {{0.1389f, -0.2500f, -0.4143f}, {-0.0399f, -0.0749f, -0.0030f, 0.9964f}, 0.0075f}, // LittleProximal
+        {{0.1441f, -0.2528f, -0.4488f}, {-0.0797f, -0.0747f, -0.0060f, 0.9940f}, 0.0070f}, // LittleIntermediate
+        {{0.1470f, -0.2560f, -0.4683f}, {-0.1194f, -0.0744f, -0.0090f, 0.9900f}, 0.0065f}, // LittleDistal
+        {{0.1496f, -0.2603f, -0.4856f}, {-0.1589f, -0.0740f, -0.0119f, 0.9845f}, 0.0055f}, // LittleTip
+    };
+
+    struct Vertex
+    {
+        float position[3];
+        float color[3];
+    };
+
+    void Rotate(const float (&q)[4], const float (&v)[3], float (&result)[3])
+    {
+        // v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v), as in SpatialInput_VertexShader
+        const float t[3] = {
+            q[1] * v[2] - q[2] * v[1] + q[3] * v[0], q[2] * v[0] - q[0] * v[2] + q[3] * v[1], q[0] * v[1] - q[1] * v[0] + q[3] * v[2]};
+        result[0] = v[0] + 2.0f * (q[1] * t[2] - q[2] * t[1]);
+        result[1] = v[1] + 2.0f * (q[2] * t[0] - q[0] * t[2]);
+        result[2] = v[2] + 2.0f * (q[0] * t[1] - q[1] * t[0]);
+    }
+
+    // The joints of both hands, as the renderer collects them in Update. Copies beyond the first pair are moved sideways by
+    // offsetStep, so that some of them are outside of the camera frustum.
+    std::vector<JointPose> MakeHands(int handPairCount, float offsetStep)
+    {
+        std::vector<JointPose> joints;
+        for (int pair = 0; pair < handPairCount; ++pair)
+        {
+            for (int side = 0; side < 2; ++side)
+            {
+                for (JointPose joint : RightHandFixture)
+                {
+                    if (side == 1)
+                    {
+                        // mirror to a left hand
+                        joint.position[0] = -joint.position[0];
+                        joint.orientation[1] = -joint.orientation[1];
+                        joint.orientation[2] = -joint.orientation[2];
+                    }
+                    joint.position[0] += pair * offsetStep;
+                    joints.push_back(joint);
+                }
+            }
+        }
+        return joints;
+    }
+
+    // Vertices of a joint pyramid as SpatialInputRenderer generated them on the CPU for every draw before the joints were
+    // instanced.
+    void AppendJointVertices(const JointPose& joint, std::vector<Vertex>& vertices)
+    {
+        const float length = 2.0f * joint.radius;
+        const float centerHeight = std::min(joint.radius, 0.5f * length);
+        const float centerXandY = joint.radius / std::sqrt(2.0f);
+
+        const float local[6][3] = {
+            {0.0f, 0.0f, 0.0f},
+            {-centerXandY, -centerXandY, -centerHeight},
+            {-centerXandY, +centerXandY, -centerHeight},
+            {+centerXandY, +centerXandY, -centerHeight},
+            {+centerXandY, -centerXandY, -centerHeight},
+            {0.0f, 0.0f, -length}};
+        float transformed[6][3];
+        for (int i = 0; i < 6; ++i)
+        {
+            Rotate(joint.orientation, local[i], transformed[i]);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                transformed[i][axis] += joint.position[axis];
+            }
+        }
+
+        const int triangles[8][3] = {{0, 1, 2}, {0, 2, 3}, {0, 3, 4}, {0, 4, 1}, {5, 2, 1}, {5, 3, 2}, {5, 4, 3}, {5, 1, 4}};
+        const float colors[8][3] = {
+            {0.0f, 0.0f, 0.4f},
+            {0.0f, 0.4f, 0.0f},
+            {0.4f, 0.0f, 0.0f},
+            {0.4f, 0.4f, 0.0f},
+            {0.0f, 0.0f, 0.6f},
+            {0.0f, 0.6f, 0.0f},
+            {0.6f, 0.0f, 0.0f},
+            {0.6f, 0.6f, 0.0f}};
+        for (int triangle = 0; triangle < 8; ++triangle)
+        {
+            for (int corner : triangles[triangle])
+            {
+                const float* p = transformed[corner];
+                vertices.push_back({{p[0], p[1], p[2]}, {colors[triangle][0], colors[triangle][1], colors[triangle][2]}});
+            }
+        }
+    }
+
+    // Vertex of an instanced shape as computed by SpatialInput_VertexShader.
+    Vertex TransformShapeVertex(const ShapeVertex& vertex, const Instance& instance)
+    {
+        const float local[3] = {
+            vertex.shape[0] * instance.radius,
+            vertex.shape[1] * instance.radius,
+            vertex.shape[2] * std::min(instance.radius, 0.5f * instance.length) + vertex.shape[3] * instance.length};
+
+        Vertex result;
+        Rotate(instance.orientation, local, result.position);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            result.position[axis] += instance.position[axis];
+            result.color[axis] = vertex.color[axis] + instance.color[axis];
+        }
+        return result;
+    }
+
+    void AddJoints(const std::vector<JointPose>& joints, InstanceBatch& batch)
+    {
+        constexpr float noColor[3] = {0.0f, 0.0f, 0.0f};
+        for (const JointPose& joint : joints)
+        {
+            batch.Add(Shape::Joint, joint.position, joint.orientation, 2.0f * joint.radius, joint.radius, noColor);
+        }
+    }
+
+    // Bounding spheres as built by SpatialInputRenderer::Update, with the rendering space equal to the joint space.
+    void AddJointSpheres(const std::vector<JointPose>& joints, FrustumCulling::SphereBatch& spheres)
+    {
+        spheres.Clear();
+        for (const JointPose& joint : joints)
+        {
+            const float length = 2.0f * joint.radius;
+            const float tip[3] = {0.0f, 0.0f, -0.5f * length};
+            float offset[3];
+            Rotate(joint.orientation, tip, offset);
+            spheres.Add(
+                joint.position[0] + offset[0],
+                joint.position[1] + offset[1],
+                joint.position[2] + offset[2],
+                std::max(joint.radius, 0.5f * length));
+        }
+    }
+
+    // Returns nullptr if the shape meshes, packing and visible ranges are correct, or the description of the first failure.
+    const char* CheckInstancing()
+    {
+        const std::vector<JointPose> joints = MakeHands(3, 0.8f);
+
+        // instanced joints match the pyramids generated on the CPU
+        InstanceBatch batch;
+        AddJoints(joints, batch);
+        batch.Pack();
+
+        const ShapeMesh jointMesh = GetShapeMesh(Shape::Joint);
+        std::vector<Vertex> expected;
+        for (size_t jointIndex = 0; jointIndex < joints.size(); ++jointIndex)
+        {
+            expected.clear();
+            AppendJointVertices(joints[jointIndex], expected);
+            if (expected.size() != jointMesh.vertexCount)
+            {
+                return "joint mesh has a different number of vertices";
+            }
+
+            for (uint32_t i = 0; i < jointMesh.vertexCount; ++i)
+            {
+                const Vertex vertex = TransformShapeVertex(GetShapeVertices()[jointMesh.startVertex + i], batch.GetInstances()[jointIndex]);
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    if (std::abs(vertex.position[axis] - expected[i].position[axis]) > 1e-6f ||
+                        vertex.color[axis] != expected[i].color[axis])
+                    {
+                        return "instanced joint differs from the joint generated on the CPU";
+                    }
+                }
+            }
+        }
+
+        // shapes are packed in order and clamped to the constant buffer size
+        constexpr float position[3] = {0.0f, 0.0f, -1.0f};
+        constexpr float orientation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        constexpr float color[3] = {1.0f, 0.0f, 0.0f};
+        batch.Clear();
+        batch.Add(Shape::Pointer, position, orientation, 0.02f, 0.01f, color);
+        for (uint32_t i = 0; i < InstanceBatch::MaxInstanceCount; ++i)
+        {
+            batch.Add(Shape::Quad, position, orientation, 0.02f, 0.01f, color);
+        }
+        AddJoints(joints, batch);
+        batch.Pack();
+
+        const InstanceRange jointRange = batch.GetRange(Shape::Joint);
+        const InstanceRange quadRange = batch.GetRange(Shape::Quad);
+        const InstanceRange pointerRange = batch.GetRange(Shape::Pointer);
+        if (batch.GetInstances().size() != InstanceBatch::MaxInstanceCount || jointRange.firstInstance != 0 ||
+            jointRange.instanceCount != joints.size() || quadRange.firstInstance != joints.size() ||
+            quadRange.instanceCount != InstanceBatch::MaxInstanceCount - joints.size() || pointerRange.instanceCount != 0 ||
+            batch.GetCount(Shape::Pointer) != 1)
+        {
+            return "instances are not packed by shape within the constant buffer size";
+        }
+
+        // visible ranges cover exactly the visible joints
+        const FrustumCulling::FrustumPlanes planes = MakeCameraFrustum();
+        FrustumCulling::SphereBatch spheres;
+        AddJointSpheres(joints, spheres);
+        spheres.Cull(&planes);
+
+        std::vector<InstanceRange> ranges;
+        AppendVisibleRanges(jointRange, spheres, ranges);
+
+        std::vector<bool> drawn(joints.size(), false);
+        for (const InstanceRange& range : ranges)
+        {
+            if (range.shape != Shape::Joint || range.instanceCount == 0)
+            {
+                return "visible range has the wrong shape or is empty";
+            }
+            for (uint32_t i = range.firstInstance; i < range.firstInstance + range.instanceCount; ++i)
+            {
+                drawn[i] = true;
+            }
+        }
+
+        size_t visibleCount = 0;
+        const FrustumCulling::SphereArrays arrays = spheres.GetArrays();
+        for (size_t i = 0; i < joints.size(); ++i)
+        {
+            const bool visible =
+                FrustumCulling::SphereInFrustum(planes, arrays.centerX[i], arrays.centerY[i], arrays.centerZ[i], arrays.radius[i]);
+            visibleCount += visible ? 1 : 0;
+            if (drawn[i] != visible)
+            {
+                return "visible ranges do not match the culled joints";
+            }
+        }
+        if (visibleCount == 0 || visibleCount == joints.size())
+        {
+            return "fixture should have visible and culled joints";
+        }
+
+        return nullptr;
+    }
+
+    void BM_SpatialInputInstancingChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckInstancing())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Joint vertices generated on the CPU for each draw (per camera), as before instancing. range(0) is the number of cameras.
+    void BM_SpatialInputJointVertices(benchmark::State& state)
+    {
+        const std::vector<JointPose> joints = MakeHands(1, 0.0f);
+        const int cameraCount = static_cast<int>(state.range(0));
+
+        for (auto _ : state)
+        {
+            for (int camera = 0; camera < cameraCount; ++camera)
+            {
+                // per joint vectors like the former CalculateJointVisualizationVertices
+                std::vector<Vertex> vertices;
+                for (const JointPose& joint : joints)
+                {
+                    std::vector<Vertex> jointVertices;
+                    jointVertices.reserve(24);
+                    AppendJointVertices(joint, jointVertices);
+                    vertices.insert(vertices.end(), jointVertices.begin(), jointVertices.end());
+                }
+                benchmark::DoNotOptimize(vertices.data());
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * cameraCount * joints.size());
+    }
+
+    // Instance packing once per Update plus culling into visible ranges per draw. range(0) is the number of cameras.
+    void BM_SpatialInputJointInstances(benchmark::State& state)
+    {
+        const std::vector<JointPose> joints = MakeHands(1, 0.0f);
+        const int cameraCount = static_cast<int>(state.range(0));
+        const FrustumCulling::FrustumPlanes planes = MakeCameraFrustum();
+        InstanceBatch batch;
+        FrustumCulling::SphereBatch spheres;
+        std::vector<InstanceRange> ranges;
+
+        for (auto _ : state)
+        {
+            batch.Clear();
+            AddJoints(joints, batch);
+            batch.Pack();
+            AddJointSpheres(joints, spheres);
+
+            for (int camera = 0; camera < cameraCount; ++camera)
+            {
+                spheres.Cull(&planes);
+                ranges.clear();
+                AppendVisibleRanges(batch.GetRange(Shape::Joint), spheres, ranges);
+                benchmark::DoNotOptimize(ranges.data());
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * cameraCount * joints.size());
+    }
+} // namespace
+
+BENCHMARK(BM_SpatialInputInstancingChecks);
+BENCHMARK(BM_SpatialInputJointVertices)->Arg(1)->Arg(2);
+BENCHMARK(BM_SpatialInputJointInstances)->Arg(1)->Arg(2);
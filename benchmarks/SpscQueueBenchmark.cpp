@@ -0,0 +1,241 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <SpscQueue.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // A producer thread pushes increasing sequence numbers while the benchmark thread pops them. Fails if a value is lost,
+    // duplicated or reordered.
+    void BM_SpscQueueTransfer(benchmark::State& state)
+    {
+        SpscQueue<uint64_t> queue(static_cast<size_t>(state.range(0)));
+        std::atomic<bool> stop = false;
+
+        std::thread producer([&]() {
+            uint64_t next = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                if (queue.TryPush(next))
+                {
+                    next++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        uint64_t expected = 0;
+        bool failed = false;
+        for (auto _ : state)
+        {
+            uint64_t value;
+            while (!queue.TryPop(value))
+            {
+                std::this_thread::yield();
+            }
+
+            if (value != expected)
+            {
+                failed = true;
+                break;
+            }
+            expected++;
+        }
+
+        stop = true;
+        producer.join();
+
+        if (failed)
+        {
+            state.SkipWithError("Values were lost, duplicated or reordered");
+            return;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Ownership transfer of heap blocks, which is how staging blocks are handed to the render thread. Every block is freed by
+    // the consumer, so races on the block content show up under the thread sanitizer.
+    void BM_SpscQueueTransferOwnership(benchmark::State& state)
+    {
+        SpscQueue<std::unique_ptr<uint64_t[]>> queue(64);
+        std::atomic<bool> stop = false;
+
+        std::thread producer([&]() {
+            std::unique_ptr<uint64_t[]> block;
+            for (uint64_t sequence = 0; !stop.load(std::memory_order_relaxed);)
+            {
+                if (!block)
+                {
+                    block = std::make_unique<uint64_t[]>(16);
+                    for (int i = 0; i < 16; ++i)
+                    {
+                        block[i] = sequence;
+                    }
+                    sequence++;
+                }
+
+                if (!queue.TryPush(std::move(block)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        uint64_t expected = 0;
+        bool failed = false;
+        for (auto _ : state)
+        {
+            std::unique_ptr<uint64_t[]> block;
+            while (!queue.TryPop(block))
+            {
+                std::this_thread::yield();
+            }
+
+            for (int i = 0; i < 16; ++i)
+            {
+                failed |= block[i] != expected;
+            }
+            if (failed)
+            {
+                break;
+            }
+            expected++;
+        }
+
+        stop = true;
+        producer.join();
+
+        if (failed)
+        {
+            state.SkipWithError("Blocks were lost, duplicated, reordered or torn");
+            return;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Checks of the queue: the capacity is rounded up to a power of two, a full queue rejects a push without moving from the
+    // value, values keep their order when the positions wrap around the storage many times, and a producer and a consumer
+    // thread on a queue of two entries, which is full or empty most of the time, see every value exactly once and in order.
+    void BM_SpscQueueChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (SpscQueue<int>(1).Capacity() != 1 || SpscQueue<int>(5).Capacity() != 8 || SpscQueue<int>(16).Capacity() != 16)
+            {
+                state.SkipWithError("The capacity is not rounded up to a power of two");
+                return;
+            }
+
+            SpscQueue<std::unique_ptr<uint64_t>> queue(4);
+            std::unique_ptr<uint64_t> value;
+            if (!queue.Empty() || queue.TryPop(value))
+            {
+                state.SkipWithError("A new queue is not empty");
+                return;
+            }
+
+            // fill and drain the queue with a different fill level every round, so that the positions wrap around at every offset
+            uint64_t pushed = 0;
+            uint64_t popped = 0;
+            for (int round = 0; round < 1000; ++round)
+            {
+                const size_t fill = round % 5 == 0 ? queue.Capacity() : 1 + round % queue.Capacity();
+                for (size_t i = 0; i < fill; ++i)
+                {
+                    if (!queue.TryPush(std::make_unique<uint64_t>(pushed++)))
+                    {
+                        state.SkipWithError("A push into a queue with space failed");
+                        return;
+                    }
+                }
+
+                if (fill == queue.Capacity())
+                {
+                    auto rejected = std::make_unique<uint64_t>(pushed);
+                    if (queue.TryPush(std::move(rejected)) || !rejected || queue.Empty())
+                    {
+                        state.SkipWithError("A full queue accepted a push or moved from the value");
+                        return;
+                    }
+                }
+
+                while (queue.TryPop(value))
+                {
+                    if (!value || *value != popped++)
+                    {
+                        state.SkipWithError("Values were lost, duplicated or reordered at a wraparound");
+                        return;
+                    }
+                }
+                if (popped != pushed || !queue.Empty())
+                {
+                    state.SkipWithError("Values were lost at a wraparound");
+                    return;
+                }
+            }
+
+            constexpr uint64_t ValueCount = 200000;
+            SpscQueue<uint64_t> smallQueue(2);
+            std::atomic<bool> stop = false;
+            std::thread producer([&smallQueue, &stop]() {
+                for (uint64_t next = 0; next < ValueCount && !stop.load(std::memory_order_relaxed);)
+                {
+                    if (smallQueue.TryPush(next))
+                    {
+                        next++;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+
+            uint64_t expected = 0;
+            bool ordered = true;
+            while (expected < ValueCount && ordered)
+            {
+                uint64_t received;
+                if (smallQueue.TryPop(received))
+                {
+                    ordered = received == expected++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+            stop = true;
+            producer.join();
+
+            if (!ordered || !smallQueue.Empty())
+            {
+                state.SkipWithError("Values passed between two threads were lost, duplicated or reordered");
+                return;
+            }
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_SpscQueueTransfer)->Arg(64)->Arg(4096)->UseRealTime();
+BENCHMARK(BM_SpscQueueTransferOwnership)->UseRealTime();
+BENCHMARK(BM_SpscQueueChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
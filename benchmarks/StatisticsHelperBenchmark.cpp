@@ -0,0 +1,372 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <FrameStatisticsSummary.h>
+#include <SnapshotPublisher.h>
+#include <StatisticsHelper.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Same fields as winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics.
+    struct FrameStatistics
+    {
+        float TimeSinceLastPresent;
+        uint32_t VideoFramesSkipped;
+        uint32_t VideoFramesReceived;
+        uint32_t VideoFrameReusedCount;
+        float VideoFrameMinDelta;
+        float VideoFrameMaxDelta;
+        float Latency;
+        uint32_t VideoFramesDiscarded;
+    };
+
+    // Clock which only advances when told to, so that the windows see a steady 60 fps frame rate.
+    struct FrameClock
+    {
+        using duration = std::chrono::nanoseconds;
+        using rep = duration::rep;
+        using period = duration::period;
+        using time_point = std::chrono::time_point<FrameClock>;
+        static constexpr bool is_steady = true;
+
+        static time_point now()
+        {
+            return current;
+        }
+
+        static inline time_point current{};
+    };
+
+    // Same fields as Microsoft::Holographic::AppRemoting::HybridPlayerFrameStatistics, which reports the latency in stages.
+    struct HybridFrameStatistics
+    {
+        float TimeSinceLastPresent;
+        uint32_t VideoFramesSkipped;
+        uint32_t VideoFramesReceived;
+        uint32_t VideoFrameReusedCount;
+        float VideoFrameMinDelta;
+        float VideoFrameMaxDelta;
+        float LatencyPoseToReceive;
+        float LatencyReceiveToPresent;
+        float LatencyPresentToDisplay;
+        uint32_t VideoFramesDiscarded;
+    };
+} // namespace
+
+template <>
+class StatisticsHelperSummary<FrameStatistics> : public FrameStatisticsSummary<FrameStatistics>
+{
+};
+
+// As in PlayerFrameStatisticsHelper.h for HybridPlayerFrameStatistics.
+template <>
+struct FrameLatency<HybridFrameStatistics> : public StagedFrameLatency<HybridFrameStatistics>
+{
+};
+
+template <>
+class StatisticsHelperSummary<HybridFrameStatistics> : public StagedLatencySummary<HybridFrameStatistics>
+{
+};
+
+namespace
+{
+
+    std::vector<FrameStatistics> MakeFrames(size_t count)
+    {
+        std::mt19937 random(11);
+        std::normal_distribution<float> frameTime(1.0f / 60.0f, 0.002f);
+        std::lognormal_distribution<float> latency(std::log(0.05f), 0.3f);
+        std::uniform_int_distribution<uint32_t> videoFrames(0, 2);
+
+        std::vector<FrameStatistics> frames(count);
+        for (auto& frame : frames)
+        {
+            frame.TimeSinceLastPresent = frameTime(random);
+            frame.VideoFramesReceived = videoFrames(random);
+            frame.VideoFramesSkipped = frame.VideoFramesReceived > 1 ? 1 : 0;
+            frame.VideoFrameReusedCount = frame.VideoFramesReceived == 0 ? 1 : 0;
+            frame.VideoFrameMinDelta = frameTime(random);
+            frame.VideoFrameMaxDelta = frame.VideoFrameMinDelta + 0.001f;
+            frame.Latency = latency(random);
+            frame.VideoFramesDiscarded = frame.VideoFramesReceived > 1 ? 1 : 0;
+        }
+        return frames;
+    }
+
+    // Per frame cost of StatisticsHelper::Update with the default 250ms, 1s and 10s windows.
+    template <class Summary>
+    void BM_StatisticsHelperUpdate(benchmark::State& state)
+    {
+        const std::vector<FrameStatistics> frames = MakeFrames(4096);
+        StatisticsHelper<FrameStatistics, Summary, FrameClock> statisticsHelper;
+
+        size_t frameIndex = 0;
+        for (auto _ : state)
+        {
+            FrameClock::current += std::chrono::microseconds(16667);
+            statisticsHelper.Update(frames[frameIndex]);
+            frameIndex = (frameIndex + 1) % frames.size();
+            benchmark::DoNotOptimize(statisticsHelper.GetStatisticsSummary().latencyAvg);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // What the frame loop used to pay on every statistics refresh, and what it pays now that a formatter thread does it.
+    template <class Summary>
+    void BM_StatisticsHelperFormat(benchmark::State& state)
+    {
+        const std::vector<FrameStatistics> frames = MakeFrames(128);
+        StatisticsHelper<FrameStatistics, Summary, FrameClock> statisticsHelper;
+        for (const FrameStatistics& frame : frames)
+        {
+            FrameClock::current += std::chrono::microseconds(16667);
+            statisticsHelper.Update(frame);
+        }
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(statisticsHelper.GetStatisticsString());
+        }
+    }
+
+    // What the frame loop pays instead: the reported values and percentiles, copied into the buffer of the formatter thread.
+    template <class Summary>
+    void BM_StatisticsHelperPublishSnapshot(benchmark::State& state)
+    {
+        const std::vector<FrameStatistics> frames = MakeFrames(128);
+        using Helper = PercentileStatisticsHelper<FrameStatistics, Summary, FrameClock>;
+        Helper statisticsHelper;
+        for (const FrameStatistics& frame : frames)
+        {
+            FrameClock::current += std::chrono::microseconds(16667);
+            statisticsHelper.Update(frame);
+        }
+
+        SnapshotPublisher<typename Helper::Snapshot> publisher;
+        for (auto _ : state)
+        {
+            statisticsHelper.GetStatisticsSnapshot(publisher.GetWriteBuffer());
+            publisher.Publish();
+            benchmark::ClobberMemory();
+        }
+        state.counters["bytes"] = static_cast<double>(sizeof(typename Helper::Snapshot));
+    }
+
+    // Frames at 60 fps with a stall longer than the 1s window, a burst at 500 fps which overflows the capacity of the 250ms and
+    // 1s windows, a stretch without video frames and a stall longer than all windows. Returns the frames and the time of each
+    // frame.
+    std::vector<HybridFrameStatistics> MakeHybridFrames(std::vector<FrameClock::duration>& frameTimes)
+    {
+        std::mt19937 random(13);
+        std::normal_distribution<float> frameTime(1.0f / 60.0f, 0.002f);
+        std::lognormal_distribution<float> latency(std::log(0.015f), 0.4f);
+        std::uniform_int_distribution<uint32_t> videoFrames(0, 2);
+
+        std::vector<HybridFrameStatistics> frames(4000);
+        frameTimes.resize(frames.size());
+        FrameClock::duration time{};
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            HybridFrameStatistics& frame = frames[i];
+            frame.TimeSinceLastPresent = frameTime(random);
+            frame.VideoFramesReceived = i >= 3000 && i < 3200 ? 0 : videoFrames(random);
+            frame.VideoFramesSkipped = frame.VideoFramesReceived > 1 ? 1 : 0;
+            frame.VideoFrameReusedCount = frame.VideoFramesReceived == 0 ? 1 : 0;
+            frame.VideoFrameMinDelta = frameTime(random);
+            frame.VideoFrameMaxDelta = frame.VideoFrameMinDelta + 0.004f * frameTime(random);
+            frame.LatencyPoseToReceive = latency(random);
+            frame.LatencyReceiveToPresent = latency(random);
+            frame.LatencyPresentToDisplay = latency(random);
+            frame.VideoFramesDiscarded = frame.VideoFramesReceived > 1 ? 1 : 0;
+
+            FrameClock::duration delta = std::chrono::microseconds(16667);
+            if (i == 700)
+            {
+                delta = std::chrono::milliseconds(1500);
+            }
+            else if (i > 1200 && i <= 2700)
+            {
+                delta = std::chrono::milliseconds(2);
+            }
+            else if (i == 3500)
+            {
+                delta = std::chrono::seconds(12);
+            }
+            time += delta;
+            frameTimes[i] = time;
+        }
+        return frames;
+    }
+
+    // Returns true if the histogram holds exactly the given values: the percentile of each rank matches.
+    bool HistogramHolds(const LatencyHistogram& histogram, const std::vector<float>& values)
+    {
+        LatencyHistogram expected;
+        for (float value : values)
+        {
+            expected.Record(value);
+        }
+        if (histogram.GetCount() != expected.GetCount())
+        {
+            return false;
+        }
+        for (uint64_t rank = 1; rank <= expected.GetCount(); ++rank)
+        {
+            const double fraction = static_cast<double>(rank) / static_cast<double>(expected.GetCount());
+            if (histogram.GetPercentile(fraction) != expected.GetPercentile(fraction))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool NearlyEqual(double actual, double expected)
+    {
+        return std::abs(actual - expected) <= 1e-5 * std::abs(expected) + 1e-7;
+    }
+
+    // Drives the default 250ms, 1s and 10s windows with a fake clock and compares every window after every frame with the
+    // values recomputed from all frames in the window: the sums kept by adding and subtracting frames, the extrema kept in
+    // monotonic queues, the latency stages of HybridPlayerFrameStatistics and, every few frames, the window histograms.
+    // Also checks the session histogram and that StatisticsHaveChanged reports each elapsed primary window length once.
+    void BM_StatisticsHelperChecks(benchmark::State& state)
+    {
+        using Summary = StatisticsHelperPercentileSummary<HybridFrameStatistics>;
+        using Helper = PercentileStatisticsHelper<HybridFrameStatistics, Summary, FrameClock>;
+
+        for (auto _ : state)
+        {
+            std::vector<FrameClock::duration> frameTimes;
+            const std::vector<HybridFrameStatistics> frames = MakeHybridFrames(frameTimes);
+
+            Helper statisticsHelper;
+            const FrameClock::time_point start{};
+            uint32_t discardedTotal = 0;
+            std::vector<float> sessionLatencies;
+            for (size_t sequence = 0; sequence < frames.size(); ++sequence)
+            {
+                statisticsHelper.Update(frames[sequence], start + frameTimes[sequence]);
+                discardedTotal += frames[sequence].VideoFramesDiscarded;
+                sessionLatencies.push_back(FrameLatency<HybridFrameStatistics>::Get(frames[sequence]));
+
+                const auto primaryLength = statisticsHelper.GetWindowLength(1);
+                const bool changed = sequence > 0 && (frameTimes[sequence] - frameTimes[0]) / primaryLength >
+                                                         (frameTimes[sequence - 1] - frameTimes[0]) / primaryLength;
+                if (statisticsHelper.StatisticsHaveChanged() != changed)
+                {
+                    state.SkipWithError(("change not reported once per window length at frame " + std::to_string(sequence)).c_str());
+                    return;
+                }
+
+                for (size_t windowIndex = 0; windowIndex < statisticsHelper.GetWindowCount(); ++windowIndex)
+                {
+                    // The frames in the window: the newest frame and the ones younger than the window length, up to its capacity.
+                    const auto length = statisticsHelper.GetWindowLength(windowIndex);
+                    const size_t capacity = statisticsHelper.GetWindowCapacity(windowIndex);
+                    const size_t ringFirst = sequence + 1 > capacity ? sequence + 1 - capacity : 0;
+                    size_t first = sequence;
+                    while (first > ringFirst && frameTimes[sequence] - frameTimes[first - 1] < length)
+                    {
+                        first--;
+                    }
+
+                    uint32_t count = 0, skipped = 0, reused = 0, received = 0, discarded = 0;
+                    double timeSinceLastPresent = 0.0, latency = 0.0, poseToReceive = 0.0, receiveToPresent = 0.0,
+                           presentToDisplay = 0.0;
+                    float timeSinceLastPresentMax = 0.0f, minDelta = 0.0f, maxDelta = 0.0f;
+                    bool hasDelta = false;
+                    std::vector<float> latencies;
+                    for (size_t i = first; i <= sequence; ++i)
+                    {
+                        const HybridFrameStatistics& frame = frames[i];
+                        count++;
+                        skipped += frame.VideoFramesSkipped;
+                        reused += frame.VideoFrameReusedCount > 0 ? 1 : 0;
+                        received += frame.VideoFramesReceived;
+                        discarded += frame.VideoFramesDiscarded;
+                        timeSinceLastPresent += frame.TimeSinceLastPresent;
+                        timeSinceLastPresentMax = std::max(timeSinceLastPresentMax, frame.TimeSinceLastPresent);
+                        latency += FrameLatency<HybridFrameStatistics>::Get(frame);
+                        latencies.push_back(FrameLatency<HybridFrameStatistics>::Get(frame));
+                        poseToReceive += frame.LatencyPoseToReceive;
+                        receiveToPresent += frame.LatencyReceiveToPresent;
+                        presentToDisplay += frame.LatencyPresentToDisplay;
+                        if (frame.VideoFramesReceived > 0)
+                        {
+                            minDelta = hasDelta ? std::min(minDelta, frame.VideoFrameMinDelta) : frame.VideoFrameMinDelta;
+                            maxDelta = hasDelta ? std::max(maxDelta, frame.VideoFrameMaxDelta) : frame.VideoFrameMaxDelta;
+                            hasDelta = true;
+                        }
+                    }
+
+                    const Summary& summary = statisticsHelper.GetStatisticsSummary(windowIndex);
+                    const char* error = nullptr;
+                    if (summary.frameStatsCount != count || summary.videoFramesSkipped != skipped || summary.videoFramesReused != reused ||
+                        summary.videoFramesReceived != received || summary.videoFramesDiscarded != discarded ||
+                        summary.videoFramesDiscardedTotal != discardedTotal)
+                    {
+                        error = "counts";
+                    }
+                    else if (
+                        !NearlyEqual(summary.timeSinceLastPresentAvg, timeSinceLastPresent / count) ||
+                        !NearlyEqual(summary.latencyAvg, latency / count) ||
+                        !NearlyEqual(summary.latencyPoseToReceiveAvg, poseToReceive / count) ||
+                        !NearlyEqual(summary.latencyReceiveToPresentAvg, receiveToPresent / count) ||
+                        !NearlyEqual(summary.latencyPresentToDisplayAvg, presentToDisplay / count))
+                    {
+                        error = "averages";
+                    }
+                    else if (
+                        summary.timeSinceLastPresentMax != timeSinceLastPresentMax || summary.videoFrameMinDelta != minDelta ||
+                        summary.videoFrameMaxDelta != maxDelta)
+                    {
+                        error = "extrema";
+                    }
+                    else if (sequence % 97 == 0 && !HistogramHolds(summary.GetLatencyHistogram(), latencies))
+                    {
+                        error = "latency histogram";
+                    }
+
+                    if (error)
+                    {
+                        state.SkipWithError(("wrong " + std::string(error) + " in window " + std::to_string(windowIndex) +
+                                             " at frame " + std::to_string(sequence))
+                                                .c_str());
+                        return;
+                    }
+                }
+            }
+
+            if (!HistogramHolds(statisticsHelper.GetSessionLatencyHistogram(), sessionLatencies))
+            {
+                state.SkipWithError("session histogram does not hold all frames");
+                return;
+            }
+        }
+    }
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_StatisticsHelperUpdate, StatisticsHelperSummary<FrameStatistics>);
+BENCHMARK_TEMPLATE(BM_StatisticsHelperUpdate, StatisticsHelperPercentileSummary<FrameStatistics>);
+BENCHMARK_TEMPLATE(BM_StatisticsHelperFormat, StatisticsHelperPercentileSummary<FrameStatistics>);
+BENCHMARK_TEMPLATE(BM_StatisticsHelperPublishSnapshot, StatisticsHelperPercentileSummary<FrameStatistics>);
+BENCHMARK(BM_StatisticsHelperChecks)->Iterations(1)->Unit(benchmark::kMillisecond);
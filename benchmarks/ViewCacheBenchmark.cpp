@@ -0,0 +1,158 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <ViewCache.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    // Stands in for a swapchain texture, only its address is used.
+    struct MockTexture
+    {
+        int id;
+    };
+
+    using Key = sample::TextureViewKey<MockTexture>;
+
+    // Reference counted like a COM view, so that the test can see when the cache releases a view.
+    struct MockView
+    {
+        Key key;
+    };
+
+    struct MockViewFactory : sample::IViewFactory<Key, std::shared_ptr<MockView>>
+    {
+        std::vector<std::weak_ptr<MockView>> created;
+
+        std::shared_ptr<MockView> CreateView(const Key& key) override
+        {
+            auto view = std::make_shared<MockView>(MockView{key});
+            created.push_back(view);
+            return view;
+        }
+
+        size_t AliveCount() const
+        {
+            size_t count = 0;
+            for (const std::weak_ptr<MockView>& view : created)
+            {
+                count += view.expired() ? 0 : 1;
+            }
+            return count;
+        }
+    };
+
+    using MockViewCache = sample::ViewCache<Key, std::shared_ptr<MockView>, Key::Hash>;
+
+    const char* CheckViewCache()
+    {
+        MockTexture textures[8] = {{0}, {1}, {2}, {3}, {4}, {5}, {6}, {7}};
+        MockViewFactory factory;
+        MockViewCache cache(factory, 4);
+
+        // views are created once per key, and formats and slices of the same texture are separate views
+        const std::shared_ptr<MockView> first = cache.Get({&textures[0], 28});
+        if (cache.Get({&textures[0], 28}) != first || factory.created.size() != 1)
+        {
+            return "view of the same key should be created once";
+        }
+        if (cache.Get({&textures[0], 29}) == first || cache.Get({&textures[0], 28, 1}) == first || factory.created.size() != 3)
+        {
+            return "views of other formats or slices should be separate";
+        }
+
+        // the least recently used view is evicted and released
+        cache.Clear();
+        factory.created.clear();
+        for (int i = 0; i < 4; ++i)
+        {
+            cache.Get({&textures[i], 28});
+        }
+        cache.Get({&textures[0], 28}); // texture 1 is now the least recently used
+        cache.Get({&textures[4], 28});
+        if (cache.Size() != 4 || cache.Contains({&textures[1], 28}) || !cache.Contains({&textures[0], 28}) ||
+            cache.GetStatistics().Evictions != 1 || factory.AliveCount() != 4 || !factory.created[1].expired())
+        {
+            return "least recently used view should be evicted and released";
+        }
+
+        // invalidation releases exactly the views of the destroyed textures
+        const size_t invalidated =
+            cache.Invalidate([&](const Key& key) { return key.Texture == &textures[0] || key.Texture == &textures[2]; });
+        if (invalidated != 2 || cache.Size() != 2 || factory.AliveCount() != 2 || cache.Contains({&textures[0], 28}) ||
+            !cache.Contains({&textures[3], 28}) || !cache.Contains({&textures[4], 28}))
+        {
+            return "invalidation should release the views of the destroyed textures only";
+        }
+
+        // a recreated swapchain: prepopulated views make the steady state frames create no views
+        cache.Clear();
+        if (factory.AliveCount() != 0)
+        {
+            return "clear should release all views";
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            cache.Get({&textures[i], 28});
+        }
+        const size_t createdBeforeFrames = factory.created.size();
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            cache.Get({&textures[frame % 3], 28});
+        }
+        if (factory.created.size() != createdBeforeFrames)
+        {
+            return "steady state frames should not create views";
+        }
+        return nullptr;
+    }
+
+    void BM_ViewCacheChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckViewCache())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+    }
+
+    // Color and depth view lookups of one frame with three swapchain images each, after the views were prepopulated.
+    void BM_ViewCacheFrame(benchmark::State& state)
+    {
+        MockTexture textures[6] = {{0}, {1}, {2}, {3}, {4}, {5}};
+        MockViewFactory factory;
+        MockViewCache cache(factory, 16);
+        for (MockTexture& texture : textures)
+        {
+            cache.Get({&texture, 28});
+        }
+
+        size_t frame = 0;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(cache.Get({&textures[frame % 3], 28}).get());
+            benchmark::DoNotOptimize(cache.Get({&textures[3 + frame % 3], 28}).get());
+            ++frame;
+        }
+        state.SetItemsProcessed(state.iterations() * 2);
+    }
+} // namespace
+
+BENCHMARK(BM_ViewCacheChecks);
+BENCHMARK(BM_ViewCacheFrame);
@@ -0,0 +1,484 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <XrUtility/XrPoseBatch.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace xr::math;
+
+namespace
+{
+    constexpr float Tolerance = 1e-5f;
+
+    // Random unit orientations and positions within a few meters, as located anchors and hands in a room.
+    PoseBatch MakePoses(size_t count, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+        std::normal_distribution<float> orientation(0.0f, 1.0f);
+
+        PoseBatch poses;
+        for (size_t i = 0; i < count; ++i)
+        {
+            XrQuaternionf q = {orientation(random), orientation(random), orientation(random), orientation(random)};
+            const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+            q = {q.x / length, q.y / length, q.z / length, q.w / length};
+            poses.Add({q, {position(random), position(random), position(random)}});
+        }
+        return poses;
+    }
+
+    PointBatch MakePoints(size_t count, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+
+        PointBatch points;
+        for (size_t i = 0; i < count; ++i)
+        {
+            points.Add({coordinate(random), coordinate(random), coordinate(random)});
+        }
+        return points;
+    }
+
+    bool Near(float a, float b)
+    {
+        return std::abs(a - b) <= Tolerance;
+    }
+
+    bool Near(const XrVector3f& a, const XrVector3f& b)
+    {
+        return Near(a.x, b.x) && Near(a.y, b.y) && Near(a.z, b.z);
+    }
+
+    bool Near(const XrPosef& a, const XrPosef& b)
+    {
+        return Near(a.position, b.position) && Near(a.orientation.x, b.orientation.x) && Near(a.orientation.y, b.orientation.y) &&
+               Near(a.orientation.z, b.orientation.z) && Near(a.orientation.w, b.orientation.w);
+    }
+
+    // Checks the scalar reference functions against their definitions.
+    const char* CheckScalar(const PoseBatch& a, const PoseBatch& b, const PointBatch& points)
+    {
+        const XrPosef identity = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+        for (size_t i = 0; i < a.Size(); ++i)
+        {
+            const XrPosef pa = a.Get(i);
+            const XrPosef pb = b.Get(i);
+            const XrVector3f point = points.Get(i);
+
+            if (!Near(Batch::Scalar::Multiply(pa, Batch::Scalar::Invert(pa)), identity) ||
+                !Near(Batch::Scalar::Multiply(Batch::Scalar::Invert(pa), pa), identity))
+            {
+                return "pose multiplied with its inverse is not the identity";
+            }
+
+            // a * b applies a first: transforming by the product equals transforming by a, then by b
+            const XrVector3f expected = Batch::Scalar::TransformPoint(pb, Batch::Scalar::TransformPoint(pa, point));
+            if (!Near(Batch::Scalar::TransformPoint(Batch::Scalar::Multiply(pa, pb), point), expected))
+            {
+                return "pose product does not apply the first pose first";
+            }
+
+            // row vector times the matrix
+            float m[16];
+            Batch::Scalar::StoreMatrix(pa, m);
+            const XrVector3f transformed = {point.x * m[0] + point.y * m[4] + point.z * m[8] + m[12],
+                                            point.x * m[1] + point.y * m[5] + point.z * m[9] + m[13],
+                                            point.x * m[2] + point.y * m[6] + point.z * m[10] + m[14]};
+            if (!Near(transformed, Batch::Scalar::TransformPoint(pa, point)) || m[3] != 0.0f || m[7] != 0.0f || m[11] != 0.0f ||
+                m[15] != 1.0f)
+            {
+                return "matrix does not transform like the pose";
+            }
+
+            // column vector times the transposed matrix, with the point scaled first
+            const XrVector3f scale = {0.5f + std::abs(point.x), 0.5f + std::abs(point.y), 0.5f + std::abs(point.z)};
+            Batch::Scalar::StoreTransposedMatrix(pa, scale, m);
+            const XrVector3f scaled = {m[0] * point.x + m[1] * point.y + m[2] * point.z + m[3],
+                                       m[4] * point.x + m[5] * point.y + m[6] * point.z + m[7],
+                                       m[8] * point.x + m[9] * point.y + m[10] * point.z + m[11]};
+            const XrVector3f expectedScaled =
+                Batch::Scalar::TransformPoint(pa, {point.x * scale.x, point.y * scale.y, point.z * scale.z});
+            if (!Near(scaled, expectedScaled) || m[12] != 0.0f || m[13] != 0.0f || m[14] != 0.0f || m[15] != 1.0f)
+            {
+                return "transposed matrix does not scale and transform like the pose";
+            }
+
+            // end points, and the middle of the shorter arc rotates by half of the angle in between
+            const XrPosef start = Batch::Scalar::Slerp(pa, pb, 0.0f);
+            const XrPosef end = Batch::Scalar::Slerp(pa, pb, 1.0f);
+            const XrPosef middle = Batch::Scalar::Slerp(pa, pb, 0.5f);
+            const XrQuaternionf& qa = pa.orientation;
+            const XrQuaternionf& qb = pb.orientation;
+            const XrQuaternionf& qm = middle.orientation;
+            const float dotAB = std::abs(qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w);
+            const float dotAM = std::abs(qa.x * qm.x + qa.y * qm.y + qa.z * qm.z + qa.w * qm.w);
+            const float dotEndB = std::abs(end.orientation.x * qb.x + end.orientation.y * qb.y + end.orientation.z * qb.z +
+                                           end.orientation.w * qb.w);
+            if (!Near(start, pa) || !Near(dotEndB, 1.0f) || !Near(end.position, pb.position) ||
+                std::abs(std::acos(std::min(dotAM, 1.0f)) * 2.0f - std::acos(std::min(dotAB, 1.0f))) > 1e-3f)
+            {
+                return "slerp does not interpolate along the shorter arc";
+            }
+        }
+        return nullptr;
+    }
+
+    // Checks the batch functions against the scalar functions, for a count which is not a multiple of the SIMD width.
+    const char* CheckBatch()
+    {
+        constexpr size_t Count = 1003;
+        const PoseBatch a = MakePoses(Count, 1);
+        const PoseBatch b = MakePoses(Count, 2);
+        const PointBatch points = MakePoints(Count, 3);
+
+        if (const char* error = CheckScalar(a, b, points))
+        {
+            return error;
+        }
+
+        PoseBatch result;
+        Batch::Multiply(a, b, result);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            if (!Near(result.Get(i), Batch::Scalar::Multiply(a.Get(i), b.Get(i))))
+            {
+                return "batch multiply differs from the scalar multiply";
+            }
+        }
+
+        Batch::Multiply(a, b.Get(0), result);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            if (!Near(result.Get(i), Batch::Scalar::Multiply(a.Get(i), b.Get(0))))
+            {
+                return "batch multiply with one pose differs from the scalar multiply";
+            }
+        }
+
+        Batch::Invert(a, result);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            if (!Near(result.Get(i), Batch::Scalar::Invert(a.Get(i))))
+            {
+                return "batch invert differs from the scalar invert";
+            }
+        }
+
+        for (float alpha : {0.0f, 0.25f, 0.5f, 0.9f, 1.0f})
+        {
+            Batch::Slerp(a, b, alpha, result);
+            for (size_t i = 0; i < Count; ++i)
+            {
+                if (!Near(result.Get(i), Batch::Scalar::Slerp(a.Get(i), b.Get(i), alpha)))
+                {
+                    return "batch slerp differs from the scalar slerp";
+                }
+            }
+        }
+
+        // nearly equal and opposite orientations take the linear and the sign flipped paths
+        PoseBatch close = a;
+        for (size_t i = 0; i < Count; ++i)
+        {
+            XrPosef pose = a.Get(i);
+            if (i % 2 == 0)
+            {
+                pose.orientation = {-pose.orientation.x, -pose.orientation.y, -pose.orientation.z, -pose.orientation.w};
+            }
+            close.Set(i, pose);
+        }
+        Batch::Slerp(a, close, 0.3f, result);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            if (!Near(result.Get(i), Batch::Scalar::Slerp(a.Get(i), close.Get(i), 0.3f)))
+            {
+                return "batch slerp of equal orientations differs from the scalar slerp";
+            }
+        }
+
+        PointBatch transformed;
+        Batch::TransformPoints(a, points, transformed);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            if (!Near(transformed.Get(i), Batch::Scalar::TransformPoint(a.Get(i), points.Get(i))))
+            {
+                return "batch point transform differs from the scalar transform";
+            }
+        }
+
+        std::vector<float> matrices(Count * 16);
+        Batch::StoreMatrices(a, matrices.data());
+        for (size_t i = 0; i < Count; ++i)
+        {
+            float expected[16];
+            Batch::Scalar::StoreMatrix(a.Get(i), expected);
+            for (size_t element = 0; element < 16; ++element)
+            {
+                if (!Near(matrices[i * 16 + element], expected[element]))
+                {
+                    return "batch matrix differs from the scalar matrix";
+                }
+            }
+        }
+
+        constexpr size_t Stride = 20;
+        std::vector<float> transposed(Count * Stride);
+        Batch::StoreTransposedMatrices(a, points, transposed.data(), Stride);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            float expected[16];
+            Batch::Scalar::StoreTransposedMatrix(a.Get(i), points.Get(i), expected);
+            for (size_t element = 0; element < 16; ++element)
+            {
+                if (!Near(transposed[i * Stride + element], expected[element]))
+                {
+                    return "batch transposed matrix differs from the scalar transposed matrix";
+                }
+            }
+        }
+
+        // results may overwrite an input
+        PoseBatch inPlace = a;
+        Batch::Multiply(inPlace, b, inPlace);
+        Batch::Multiply(a, b, result);
+        if (inPlace.OrientationW != result.OrientationW || inPlace.PositionX != result.PositionX)
+        {
+            return "batch multiply into its input differs";
+        }
+
+        return nullptr;
+    }
+
+    void BM_XrPoseBatchChecks(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            if (const char* error = CheckBatch())
+            {
+                state.SkipWithError(error);
+                return;
+            }
+        }
+        state.SetLabel(Batch::KernelName());
+    }
+
+    // range(0) is the number of poses.
+    void BM_XrPoseMultiplyScalar(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch a = MakePoses(count, 1);
+        const PoseBatch b = MakePoses(count, 2);
+        std::vector<XrPosef> poseA(count), poseB(count), result(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            poseA[i] = a.Get(i);
+            poseB[i] = b.Get(i);
+        }
+
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                result[i] = Batch::Scalar::Multiply(poseA[i], poseB[i]);
+            }
+            benchmark::DoNotOptimize(result.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+
+    void BM_XrPoseMultiplyBatch(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch a = MakePoses(count, 1);
+        const PoseBatch b = MakePoses(count, 2);
+        PoseBatch result;
+
+        for (auto _ : state)
+        {
+            Batch::Multiply(a, b, result);
+            benchmark::DoNotOptimize(result.PositionX.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+        state.SetLabel(Batch::KernelName());
+    }
+
+    void BM_XrPoseInvertScalar(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch a = MakePoses(count, 1);
+        std::vector<XrPosef> poses(count), result(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            poses[i] = a.Get(i);
+        }
+
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                result[i] = Batch::Scalar::Invert(poses[i]);
+            }
+            benchmark::DoNotOptimize(result.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+
+    void BM_XrPoseInvertBatch(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch a = MakePoses(count, 1);
+        PoseBatch result;
+
+        for (auto _ : state)
+        {
+            Batch::Invert(a, result);
+            benchmark::DoNotOptimize(result.PositionX.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+        state.SetLabel(Batch::KernelName());
+    }
+
+    void BM_XrPoseSlerpScalar(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch a = MakePoses(count, 1);
+        const PoseBatch b = MakePoses(count, 2);
+        std::vector<XrPosef> poseA(count), poseB(count), result(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            poseA[i] = a.Get(i);
+            poseB[i] = b.Get(i);
+        }
+
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                result[i] = Batch::Scalar::Slerp(poseA[i], poseB[i], 0.3f);
+            }
+            benchmark::DoNotOptimize(result.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+
+    void BM_XrPoseSlerpBatch(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch a = MakePoses(count, 1);
+        const PoseBatch b = MakePoses(count, 2);
+        PoseBatch result;
+
+        for (auto _ : state)
+        {
+            Batch::Slerp(a, b, 0.3f, result);
+            benchmark::DoNotOptimize(result.PositionX.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+        state.SetLabel(Batch::KernelName());
+    }
+
+    void BM_XrPoseTransformPointsScalar(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch a = MakePoses(count, 1);
+        const PointBatch p = MakePoints(count, 3);
+        std::vector<XrPosef> poses(count);
+        std::vector<XrVector3f> points(count), result(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            poses[i] = a.Get(i);
+            points[i] = p.Get(i);
+        }
+
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                result[i] = Batch::Scalar::TransformPoint(poses[i], points[i]);
+            }
+            benchmark::DoNotOptimize(result.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+
+    void BM_XrPoseTransformPointsBatch(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch poses = MakePoses(count, 1);
+        const PointBatch points = MakePoints(count, 3);
+        PointBatch result;
+
+        for (auto _ : state)
+        {
+            Batch::TransformPoints(poses, points, result);
+            benchmark::DoNotOptimize(result.X.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+        state.SetLabel(Batch::KernelName());
+    }
+
+    void BM_XrPoseMatricesScalar(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch a = MakePoses(count, 1);
+        std::vector<XrPosef> poses(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            poses[i] = a.Get(i);
+        }
+        std::vector<float> matrices(count * 16);
+
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                Batch::Scalar::StoreMatrix(poses[i], matrices.data() + 16 * i);
+            }
+            benchmark::DoNotOptimize(matrices.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+
+    void BM_XrPoseMatricesBatch(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        const PoseBatch poses = MakePoses(count, 1);
+        std::vector<float> matrices(count * 16);
+
+        for (auto _ : state)
+        {
+            Batch::StoreMatrices(poses, matrices.data());
+            benchmark::DoNotOptimize(matrices.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+        state.SetLabel(Batch::KernelName());
+    }
+} // namespace
+
+BENCHMARK(BM_XrPoseBatchChecks);
+BENCHMARK(BM_XrPoseMultiplyScalar)->Arg(16)->Arg(1024);
+BENCHMARK(BM_XrPoseMultiplyBatch)->Arg(16)->Arg(1024);
+BENCHMARK(BM_XrPoseInvertScalar)->Arg(1024);
+BENCHMARK(BM_XrPoseInvertBatch)->Arg(1024);
+BENCHMARK(BM_XrPoseSlerpScalar)->Arg(1024);
+BENCHMARK(BM_XrPoseSlerpBatch)->Arg(1024);
+BENCHMARK(BM_XrPoseTransformPointsScalar)->Arg(1024);
+BENCHMARK(BM_XrPoseTransformPointsBatch)->Arg(1024);
+BENCHMARK(BM_XrPoseMatricesScalar)->Arg(1024);
+BENCHMARK(BM_XrPoseMatricesBatch)->Arg(1024);
@@ -0,0 +1,1098 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <AsyncLog.h>
+
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace AsyncLog
+{
+    namespace
+    {
+        using Detail::Argument;
+        using Detail::ArgumentType;
+
+        // A message in the ring of a thread, followed by its arguments. A header without a format pads the ring up to its end,
+        // as a message is never split. When less than a header is left up to the end of the ring, the rest is skipped.
+        struct RecordHeader
+        {
+            const char* format;
+            int64_t time;
+            uint32_t size;
+            uint32_t argumentCount;
+        };
+
+        // An encoded argument, followed by the characters of a string (padded to 8 bytes) or the 8 bytes of any other value.
+        struct ArgumentHeader
+        {
+            ArgumentType type;
+            uint8_t size;
+            uint16_t reserved;
+            uint32_t length;
+        };
+
+        static_assert(sizeof(RecordHeader) % 8 == 0 && sizeof(ArgumentHeader) == 8);
+
+        constexpr size_t AlignUp(size_t size)
+        {
+            return (size + 7) & ~size_t(7);
+        }
+
+        bool IsString(ArgumentType type)
+        {
+            return type == ArgumentType::String || type == ArgumentType::WideString;
+        }
+
+        size_t GetCharacterSize(ArgumentType type)
+        {
+            return type == ArgumentType::WideString ? sizeof(wchar_t) : sizeof(char);
+        }
+
+        size_t GetEncodedSize(const Argument& argument)
+        {
+            return sizeof(ArgumentHeader) + (IsString(argument.type) ? AlignUp(argument.length * GetCharacterSize(argument.type)) : 8);
+        }
+
+        int64_t Now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        uint32_t CurrentThreadId()
+        {
+#ifdef _WIN32
+            return ::GetCurrentThreadId();
+#else
+            return static_cast<uint32_t>(gettid());
+#endif
+        }
+
+        // Message ring of one thread. The thread is the only producer, the flusher (holding g_flushMutex) the only consumer.
+        struct ThreadBuffer
+        {
+            ThreadBuffer(size_t capacity, uint32_t id)
+                : threadId(id)
+            {
+                size_t roundedCapacity = 1024;
+                while (roundedCapacity < capacity)
+                {
+                    roundedCapacity *= 2;
+                }
+
+                words = std::make_unique<uint64_t[]>(roundedCapacity / sizeof(uint64_t));
+                data = reinterpret_cast<uint8_t*>(words.get());
+                mask = roundedCapacity - 1;
+            }
+
+            std::unique_ptr<uint64_t[]> words;
+            uint8_t* data = nullptr;
+            size_t mask = 0;
+            const uint32_t threadId;
+
+            // Written by the consumer.
+            alignas(64) std::atomic<uint64_t> read = 0;
+
+            // Written by the producer.
+            alignas(64) std::atomic<uint64_t> write = 0;
+            uint64_t cachedRead = 0;
+            std::atomic<uint64_t> dropped = 0;
+            // Set when the thread exited, after its last message.
+            std::atomic<bool> retired = false;
+        };
+
+        // Marks the buffer of a thread as retired when the thread exits, so the flusher releases it once it is drained.
+        struct ThreadBufferHolder
+        {
+            ~ThreadBufferHolder()
+            {
+                if (buffer)
+                {
+                    buffer->retired.store(true, std::memory_order_release);
+                }
+            }
+
+            std::shared_ptr<ThreadBuffer> buffer;
+        };
+
+        // Position of the flusher in the ring of a thread while merging the messages of all threads.
+        struct Cursor
+        {
+            ThreadBuffer* buffer;
+            uint64_t read;
+            uint64_t write;
+            const RecordHeader* record;
+        };
+
+        std::atomic<bool> g_running = false;
+        std::atomic<OverflowPolicy> g_overflowPolicy = OverflowPolicy::Drop;
+        std::atomic<bool> g_wakeRequested = false;
+
+        // Guards the buffers of the threads. Never held while writing to the sinks, so registering a thread does not wait for I/O.
+        std::mutex g_mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> g_buffers;
+        size_t g_bytesPerThread = Settings{}.bytesPerThread;
+
+        // Serializes flushing, guards the sinks and the state of the flusher.
+        std::mutex g_flushMutex;
+        Settings g_settings;
+        std::vector<std::shared_ptr<Sink>> g_sinks;
+
+        // Reused by the flusher.
+        std::vector<std::shared_ptr<ThreadBuffer>> g_flushBuffers;
+        std::vector<Cursor> g_cursors;
+        std::vector<Argument> g_arguments;
+        std::string g_text;
+        std::string g_line;
+
+        std::thread g_flusher;
+        std::condition_variable g_flusherWake;
+        bool g_stopFlusher = false;
+
+        thread_local ThreadBufferHolder t_buffer;
+
+        ThreadBuffer* RegisterThread()
+        {
+            std::lock_guard lock(g_mutex);
+            t_buffer.buffer = std::make_shared<ThreadBuffer>(g_bytesPerThread, CurrentThreadId());
+            g_buffers.push_back(t_buffer.buffer);
+            return t_buffer.buffer.get();
+        }
+
+        void WakeFlusher()
+        {
+            if (!g_wakeRequested.exchange(true, std::memory_order_relaxed))
+            {
+                g_flusherWake.notify_one();
+            }
+        }
+
+        // Waits according to the overflow policy until the ring has room up to end. Returns false if the message is dropped.
+        bool Reserve(ThreadBuffer& buffer, uint64_t end)
+        {
+            const uint64_t capacity = buffer.mask + 1;
+            if (end - buffer.cachedRead <= capacity)
+            {
+                return true;
+            }
+
+            buffer.cachedRead = buffer.read.load(std::memory_order_acquire);
+            while (end - buffer.cachedRead > capacity)
+            {
+                if (g_overflowPolicy.load(std::memory_order_relaxed) != OverflowPolicy::Block ||
+                    !g_running.load(std::memory_order_relaxed))
+                {
+                    return false;
+                }
+
+                WakeFlusher();
+                std::this_thread::yield();
+                buffer.cachedRead = buffer.read.load(std::memory_order_acquire);
+            }
+            return true;
+        }
+
+        uint8_t* EncodeArgument(uint8_t* out, const Argument& argument)
+        {
+            const ArgumentHeader header{argument.type, argument.size, 0, argument.length};
+            std::memcpy(out, &header, sizeof(header));
+            out += sizeof(header);
+
+            if (IsString(argument.type))
+            {
+                const size_t size = argument.length * GetCharacterSize(argument.type);
+                std::memcpy(out, argument.p, size);
+                return out + AlignUp(size);
+            }
+
+            std::memcpy(out, &argument.u, 8);
+            return out + 8;
+        }
+
+        const uint8_t* DecodeArgument(const uint8_t* in, Argument& argument)
+        {
+            ArgumentHeader header;
+            std::memcpy(&header, in, sizeof(header));
+            in += sizeof(header);
+
+            argument.type = header.type;
+            argument.size = header.size;
+            argument.length = header.length;
+            if (IsString(header.type))
+            {
+                argument.p = in;
+                return in + AlignUp(header.length * GetCharacterSize(header.type));
+            }
+
+            std::memcpy(&argument.u, in, 8);
+            return in + 8;
+        }
+
+        void AppendUtf8(std::string& text, const wchar_t* characters, size_t length)
+        {
+            for (size_t i = 0; i < length; ++i)
+            {
+                uint32_t codePoint = static_cast<uint32_t>(characters[i]);
+                if constexpr (sizeof(wchar_t) == 2)
+                {
+                    if (codePoint >= 0xd800 && codePoint < 0xdc00 && i + 1 < length && characters[i + 1] >= 0xdc00 &&
+                        characters[i + 1] < 0xe000)
+                    {
+                        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (static_cast<uint32_t>(characters[++i]) - 0xdc00);
+                    }
+                }
+                if ((codePoint >= 0xd800 && codePoint < 0xe000) || codePoint > 0x10ffff)
+                {
+                    codePoint = 0xfffd;
+                }
+
+                if (codePoint < 0x80)
+                {
+                    text += static_cast<char>(codePoint);
+                }
+                else if (codePoint < 0x800)
+                {
+                    text += static_cast<char>(0xc0 | (codePoint >> 6));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3f));
+                }
+                else if (codePoint < 0x10000)
+                {
+                    text += static_cast<char>(0xe0 | (codePoint >> 12));
+                    text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3f));
+                }
+                else
+                {
+                    text += static_cast<char>(0xf0 | (codePoint >> 18));
+                    text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+                    text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3f));
+                }
+            }
+        }
+
+        int64_t GetSigned(const Argument& argument)
+        {
+            switch (argument.type)
+            {
+                case ArgumentType::Signed:
+                    return argument.i;
+                case ArgumentType::Unsigned:
+                    return static_cast<int64_t>(argument.u);
+                case ArgumentType::Double:
+                    return static_cast<int64_t>(argument.d);
+                case ArgumentType::Pointer:
+                    return static_cast<int64_t>(reinterpret_cast<intptr_t>(argument.p));
+                default:
+                    return 0;
+            }
+        }
+
+        // Reinterprets a signed integer in its own size, so that e.g. %x of int32 -1 is ffffffff.
+        uint64_t GetUnsigned(const Argument& argument)
+        {
+            if (argument.type == ArgumentType::Signed && argument.size < 8)
+            {
+                return static_cast<uint64_t>(argument.i) & ((uint64_t(1) << (argument.size * 8)) - 1);
+            }
+            return static_cast<uint64_t>(GetSigned(argument));
+        }
+
+        double GetDouble(const Argument& argument)
+        {
+            switch (argument.type)
+            {
+                case ArgumentType::Double:
+                    return argument.d;
+                case ArgumentType::Unsigned:
+                    return static_cast<double>(argument.u);
+                default:
+                    return static_cast<double>(GetSigned(argument));
+            }
+        }
+
+        template <typename... Values>
+        void AppendPrintf(std::string& text, const char* specification, Values... values)
+        {
+            char buffer[128];
+            const int length = std::snprintf(buffer, sizeof(buffer), specification, values...);
+            if (length < 0)
+            {
+                return;
+            }
+            if (static_cast<size_t>(length) < sizeof(buffer))
+            {
+                text.append(buffer, length);
+                return;
+            }
+
+            const size_t offset = text.size();
+            text.resize(offset + length + 1);
+            std::snprintf(text.data() + offset, length + 1, specification, values...);
+            text.resize(offset + length);
+        }
+
+        // Appends the argument as its own type, for a conversion which does not match it.
+        void AppendValue(std::string& text, const Argument& argument)
+        {
+            switch (argument.type)
+            {
+                case ArgumentType::Signed:
+                    AppendPrintf(text, "%lld", static_cast<long long>(argument.i));
+                    break;
+                case ArgumentType::Unsigned:
+                    AppendPrintf(text, "%llu", static_cast<unsigned long long>(argument.u));
+                    break;
+                case ArgumentType::Double:
+                    AppendPrintf(text, "%g", argument.d);
+                    break;
+                case ArgumentType::Pointer:
+                    AppendPrintf(text, "%p", argument.p);
+                    break;
+                case ArgumentType::String:
+                    text.append(argument.s, argument.length);
+                    break;
+                case ArgumentType::WideString:
+                    AppendUtf8(text, argument.ws, argument.length);
+                    break;
+            }
+        }
+
+        const char* ParseNumber(const char* c, int& value)
+        {
+            value = 0;
+            while (*c >= '0' && *c <= '9')
+            {
+                value = std::min(value * 10 + (*c++ - '0'), 4096);
+            }
+            return c;
+        }
+
+        void FormatLine(std::string& line, int64_t time, uint32_t threadId, std::string_view text)
+        {
+            const std::time_t seconds = static_cast<std::time_t>(time / 1'000'000'000);
+            const int microseconds = static_cast<int>(time % 1'000'000'000 / 1000);
+            std::tm localTime{};
+#ifdef _WIN32
+            localtime_s(&localTime, &seconds);
+#else
+            localtime_r(&seconds, &localTime);
+#endif
+
+            line.clear();
+            AppendPrintf(
+                line,
+                "[%02d-%02d-%02d.%06d] (t:%04x): ",
+                localTime.tm_hour,
+                localTime.tm_min,
+                localTime.tm_sec,
+                microseconds,
+                threadId);
+            line += text;
+            line += '\n';
+        }
+
+        // Hands g_text to the sinks. Called with g_flushMutex held.
+        void WriteMessage(int64_t time, uint32_t threadId)
+        {
+            std::string_view text = g_text;
+            while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+            {
+                text.remove_suffix(1);
+            }
+
+            FormatLine(g_line, time, threadId, text);
+            const Message message{time, threadId, text, g_line};
+            for (const std::shared_ptr<Sink>& sink : g_sinks)
+            {
+                sink->Write(message);
+            }
+        }
+
+        // Skips the padding in front of the next message of the cursor and returns the message, or nullptr if there is none.
+        const RecordHeader* PeekRecord(Cursor& cursor)
+        {
+            const ThreadBuffer& buffer = *cursor.buffer;
+            while (cursor.read != cursor.write)
+            {
+                const size_t offset = static_cast<size_t>(cursor.read & buffer.mask);
+                const size_t tail = buffer.mask + 1 - offset;
+                if (tail < sizeof(RecordHeader))
+                {
+                    cursor.read += tail;
+                    continue;
+                }
+
+                const RecordHeader* record = reinterpret_cast<const RecordHeader*>(buffer.data + offset);
+                if (!record->format)
+                {
+                    cursor.read += record->size;
+                    continue;
+                }
+                return record;
+            }
+            return nullptr;
+        }
+
+        // Formats the messages of all threads, merged by time, and hands them to the sinks. Called with g_flushMutex held.
+        void FlushLocked()
+        {
+            bool wroteMessages = false;
+
+            // Threads registering meanwhile are picked up by the next flush.
+            {
+                std::lock_guard lock(g_mutex);
+                g_flushBuffers.assign(g_buffers.begin(), g_buffers.end());
+            }
+
+            g_cursors.clear();
+            for (const std::shared_ptr<ThreadBuffer>& buffer : g_flushBuffers)
+            {
+                g_cursors.push_back(
+                    {buffer.get(), buffer->read.load(std::memory_order_relaxed), buffer->write.load(std::memory_order_acquire), nullptr});
+
+                const uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+                if (dropped > 0 && !g_sinks.empty())
+                {
+                    g_text.clear();
+                    AsyncLog::Format(g_text, "Dropped %llu messages of this thread, its log ring was full.", dropped);
+                    WriteMessage(Now(), buffer->threadId);
+                    wroteMessages = true;
+                }
+            }
+
+            for (;;)
+            {
+                Cursor* earliest = nullptr;
+                for (Cursor& cursor : g_cursors)
+                {
+                    if (!cursor.record)
+                    {
+                        cursor.record = PeekRecord(cursor);
+                    }
+                    if (cursor.record && (!earliest || cursor.record->time < earliest->record->time))
+                    {
+                        earliest = &cursor;
+                    }
+                }
+                if (!earliest)
+                {
+                    break;
+                }
+
+                const RecordHeader& record = *earliest->record;
+                if (!g_sinks.empty())
+                {
+                    g_arguments.resize(record.argumentCount);
+                    const uint8_t* in = reinterpret_cast<const uint8_t*>(&record + 1);
+                    for (Argument& argument : g_arguments)
+                    {
+                        in = DecodeArgument(in, argument);
+                    }
+
+                    g_text.clear();
+                    Detail::Format(g_text, record.format, g_arguments);
+                    WriteMessage(record.time, earliest->buffer->threadId);
+                    wroteMessages = true;
+                }
+
+                // Hand the space back right away, for threads waiting with OverflowPolicy::Block.
+                earliest->read += record.size;
+                earliest->record = nullptr;
+                earliest->buffer->read.store(earliest->read, std::memory_order_release);
+            }
+
+            for (const Cursor& cursor : g_cursors)
+            {
+                cursor.buffer->read.store(cursor.read, std::memory_order_release);
+            }
+
+            g_cursors.clear();
+            g_flushBuffers.clear();
+            {
+                std::lock_guard lock(g_mutex);
+                std::erase_if(g_buffers, [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                    return buffer->retired.load(std::memory_order_acquire) &&
+                           buffer->read.load(std::memory_order_relaxed) == buffer->write.load(std::memory_order_acquire);
+                });
+            }
+
+            if (wroteMessages)
+            {
+                for (const std::shared_ptr<Sink>& sink : g_sinks)
+                {
+                    sink->Flush();
+                }
+            }
+        }
+
+        void RunFlusher()
+        {
+            std::unique_lock lock(g_flushMutex);
+            while (!g_stopFlusher)
+            {
+                g_flusherWake.wait_for(lock, g_settings.flushInterval, [] {
+                    return g_stopFlusher || g_wakeRequested.load(std::memory_order_relaxed);
+                });
+                g_wakeRequested.store(false, std::memory_order_relaxed);
+                FlushLocked();
+            }
+        }
+
+        // Formats and writes a message on the calling thread, while the logger is not running.
+        void WriteNow(const char* format, std::span<const Argument> arguments)
+        {
+            thread_local std::string text;
+            thread_local std::string line;
+
+            text.clear();
+            Detail::Format(text, format, arguments);
+            while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+            {
+                text.pop_back();
+            }
+
+            const int64_t time = Now();
+            const uint32_t threadId = CurrentThreadId();
+            FormatLine(line, time, threadId, text);
+            DebuggerSink().Write({time, threadId, text, line});
+        }
+    } // namespace
+
+    void DebuggerSink::Write(const Message& message)
+    {
+#ifdef _WIN32
+        thread_local std::wstring line;
+        line.resize(message.line.size());
+        const int length = MultiByteToWideChar(
+            CP_UTF8, 0, message.line.data(), static_cast<int>(message.line.size()), line.data(), static_cast<int>(line.size()));
+        line.resize(std::max(length, 0));
+        OutputDebugStringW(line.c_str());
+#else
+        std::fwrite(message.line.data(), 1, message.line.size(), stderr);
+#endif
+    }
+
+    FileSink::FileSink(const std::filesystem::path& path)
+        : m_stream(path, std::ios::binary | std::ios::trunc)
+    {
+    }
+
+    void FileSink::Write(const Message& message)
+    {
+        m_stream.write(message.line.data(), message.line.size());
+    }
+
+    void FileSink::Flush()
+    {
+        m_stream.flush();
+    }
+
+    // Writable mapping of the whole file. The file is extended to the size of the mapping.
+    struct RotatingFileSink::MappedFile
+    {
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+
+        bool Open(const std::filesystem::path& path)
+        {
+            file = CreateFile2(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, CREATE_ALWAYS, nullptr);
+            return file != INVALID_HANDLE_VALUE;
+        }
+
+        uint8_t* Map(uint64_t capacity)
+        {
+            // Creating a mapping larger than the file extends the file.
+            mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READWRITE, capacity, nullptr);
+            if (!mapping)
+            {
+                return nullptr;
+            }
+            void* data = MapViewOfFileFromApp(mapping, FILE_MAP_WRITE, 0, static_cast<SIZE_T>(capacity));
+            if (!data)
+            {
+                CloseHandle(mapping);
+                mapping = nullptr;
+            }
+            return static_cast<uint8_t*>(data);
+        }
+
+        void Unmap(uint8_t* data, uint64_t)
+        {
+            UnmapViewOfFile(data);
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+
+        void Close(uint64_t size)
+        {
+            LARGE_INTEGER end;
+            end.QuadPart = static_cast<LONGLONG>(size);
+            SetFilePointerEx(file, end, nullptr, FILE_BEGIN);
+            SetEndOfFile(file);
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+#else
+        int file = -1;
+
+        bool Open(const std::filesystem::path& path)
+        {
+            file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            return file >= 0;
+        }
+
+        uint8_t* Map(uint64_t capacity)
+        {
+            if (ftruncate(file, static_cast<off_t>(capacity)) != 0)
+            {
+                return nullptr;
+            }
+            void* data = mmap(nullptr, static_cast<size_t>(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+            return data != MAP_FAILED ? static_cast<uint8_t*>(data) : nullptr;
+        }
+
+        void Unmap(uint8_t* data, uint64_t capacity)
+        {
+            munmap(data, static_cast<size_t>(capacity));
+        }
+
+        void Close(uint64_t size)
+        {
+            [[maybe_unused]] const int result = ftruncate(file, static_cast<off_t>(size));
+            close(file);
+            file = -1;
+        }
+#endif
+    };
+
+    RotatingFileSink::RotatingFileSink(std::filesystem::path path, size_t fileSize, uint32_t fileCount)
+        : m_path(std::move(path))
+        , m_fileSize(std::max<size_t>(fileSize, 4096))
+        , m_fileCount(std::max<uint32_t>(fileCount, 1))
+    {
+        OpenFile();
+    }
+
+    RotatingFileSink::~RotatingFileSink()
+    {
+        CloseFile();
+    }
+
+    void RotatingFileSink::Write(const Message& message)
+    {
+        if (!m_data)
+        {
+            return;
+        }
+
+        const size_t size = std::min(message.line.size(), m_fileSize);
+        if (m_size + size > m_fileSize)
+        {
+            CloseFile();
+
+            // <path>.<n - 1> is replaced by <path>.<n - 2>, ..., <path>.1 by <path>.
+            std::error_code error;
+            for (uint32_t i = m_fileCount - 1; i > 0; --i)
+            {
+                std::filesystem::path from = m_path;
+                if (i > 1)
+                {
+                    from += "." + std::to_string(i - 1);
+                }
+                std::filesystem::path to = m_path;
+                to += "." + std::to_string(i);
+                std::filesystem::rename(from, to, error);
+            }
+
+            if (!OpenFile())
+            {
+                return;
+            }
+        }
+
+        std::memcpy(m_data + m_size, message.line.data(), size);
+        m_size += size;
+    }
+
+    bool RotatingFileSink::OpenFile()
+    {
+        m_file = new MappedFile();
+        if (!m_file->Open(m_path))
+        {
+            delete m_file;
+            m_file = nullptr;
+            return false;
+        }
+
+        m_data = m_file->Map(m_fileSize);
+        if (!m_data)
+        {
+            m_file->Close(0);
+            delete m_file;
+            m_file = nullptr;
+            return false;
+        }
+
+        m_size = 0;
+        return true;
+    }
+
+    void RotatingFileSink::CloseFile()
+    {
+        if (m_file)
+        {
+            m_file->Unmap(m_data, m_fileSize);
+            m_file->Close(m_size);
+            delete m_file;
+            m_file = nullptr;
+            m_data = nullptr;
+        }
+    }
+
+    bool Start(std::vector<std::shared_ptr<Sink>> sinks, const Settings& settings)
+    {
+        {
+            std::lock_guard lock(g_flushMutex);
+            if (g_running.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            g_settings = settings;
+            {
+                std::lock_guard buffersLock(g_mutex);
+                g_bytesPerThread = settings.bytesPerThread;
+            }
+            g_sinks = std::move(sinks);
+            g_stopFlusher = false;
+            g_overflowPolicy.store(settings.overflowPolicy, std::memory_order_relaxed);
+
+            // Write what threads logged after the last session stopped.
+            FlushLocked();
+            g_running.store(true, std::memory_order_relaxed);
+        }
+
+        g_flusher = std::thread(RunFlusher);
+        return true;
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard lock(g_flushMutex);
+            if (!g_running.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            g_running.store(false, std::memory_order_relaxed);
+            g_stopFlusher = true;
+        }
+
+        g_flusherWake.notify_one();
+        g_flusher.join();
+
+        std::lock_guard lock(g_flushMutex);
+        FlushLocked();
+        g_sinks.clear();
+    }
+
+    void Flush()
+    {
+        std::lock_guard lock(g_flushMutex);
+        FlushLocked();
+    }
+
+    bool IsRunning()
+    {
+        return g_running.load(std::memory_order_relaxed);
+    }
+
+    void Detail::Write(const char* format, std::span<const Argument> arguments)
+    {
+        if (!g_running.load(std::memory_order_relaxed))
+        {
+            WriteNow(format, arguments);
+            return;
+        }
+
+        ThreadBuffer* buffer = t_buffer.buffer.get();
+        if (!buffer)
+        {
+            buffer = RegisterThread();
+        }
+
+        size_t size = sizeof(RecordHeader);
+        for (const Argument& argument : arguments)
+        {
+            size += GetEncodedSize(argument);
+        }
+
+        const uint64_t capacity = buffer->mask + 1;
+        const uint64_t write = buffer->write.load(std::memory_order_relaxed);
+        const size_t offset = static_cast<size_t>(write & buffer->mask);
+        const size_t tail = static_cast<size_t>(capacity - offset);
+        const size_t padding = tail < size ? tail : 0;
+        if (size > capacity / 2 || !Reserve(*buffer, write + padding + size))
+        {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (padding >= sizeof(RecordHeader))
+        {
+            const RecordHeader header{nullptr, 0, static_cast<uint32_t>(padding), 0};
+            std::memcpy(buffer->data + offset, &header, sizeof(header));
+        }
+
+        uint8_t* out = buffer->data + ((write + padding) & buffer->mask);
+        const RecordHeader header{format, Now(), static_cast<uint32_t>(size), static_cast<uint32_t>(arguments.size())};
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        for (const Argument& argument : arguments)
+        {
+            out = EncodeArgument(out, argument);
+        }
+
+        const uint64_t end = write + padding + size;
+        buffer->write.store(end, std::memory_order_release);
+
+        // Wake the flusher early when the ring fills up, instead of dropping messages at the end of the interval.
+        if (end - buffer->cachedRead > capacity / 2)
+        {
+            buffer->cachedRead = buffer->read.load(std::memory_order_acquire);
+            if (end - buffer->cachedRead > capacity / 2)
+            {
+                WakeFlusher();
+            }
+        }
+    }
+
+    // printf formatting, one conversion at a time. The length modifiers of the format are replaced by the ones of the stored
+    // arguments, %s takes narrow and wide strings, a conversion which does not match its argument prints the argument as is.
+    void Detail::Format(std::string& text, const char* format, std::span<const Argument> arguments)
+    {
+        size_t nextArgument = 0;
+        const char* c = format;
+        while (*c)
+        {
+            if (*c != '%')
+            {
+                const char* end = std::strchr(c, '%');
+                end = end ? end : c + std::strlen(c);
+                text.append(c, end);
+                c = end;
+                continue;
+            }
+            if (c[1] == '%')
+            {
+                text += '%';
+                c += 2;
+                continue;
+            }
+
+            const char* const specificationBegin = c++;
+
+            char flags[8];
+            size_t flagCount = 0;
+            while (*c && std::strchr("-+ #0", *c))
+            {
+                if (flagCount < sizeof(flags) - 1)
+                {
+                    flags[flagCount++] = *c;
+                }
+                c++;
+            }
+
+            int width = -1;
+            if (*c == '*')
+            {
+                c++;
+                if (nextArgument < arguments.size())
+                {
+                    const int64_t value = GetSigned(arguments[nextArgument++]);
+                    if (value < 0 && flagCount < sizeof(flags) - 1)
+                    {
+                        flags[flagCount++] = '-';
+                    }
+                    width = static_cast<int>(std::min<int64_t>(value < 0 ? -value : value, 4096));
+                }
+            }
+            else if (*c >= '0' && *c <= '9')
+            {
+                c = ParseNumber(c, width);
+            }
+
+            int precision = -1;
+            if (*c == '.')
+            {
+                c++;
+                if (*c == '*')
+                {
+                    c++;
+                    if (nextArgument < arguments.size())
+                    {
+                        precision = static_cast<int>(std::clamp<int64_t>(GetSigned(arguments[nextArgument++]), -1, 4096));
+                    }
+                }
+                else
+                {
+                    c = ParseNumber(c, precision);
+                }
+            }
+
+            // Length modifiers, including the ones of Microsoft (I32, I64, w).
+            while (*c && std::strchr("hlLqjztIw", *c))
+            {
+                if (*c == 'I' && (std::strncmp(c, "I32", 3) == 0 || std::strncmp(c, "I64", 3) == 0))
+                {
+                    c += 2;
+                }
+                c++;
+            }
+
+            const char conversion = *c;
+            if (!conversion || !std::strchr("diouxXcfFeEgGaAps", conversion) || nextArgument == arguments.size())
+            {
+                // Not supported (%n) or missing an argument, keep it as is.
+                c += conversion ? 1 : 0;
+                text.append(specificationBegin, c);
+                continue;
+            }
+            c++;
+
+            const Argument& argument = arguments[nextArgument++];
+            if (conversion == 's' && !IsString(argument.type))
+            {
+                AppendValue(text, argument);
+                continue;
+            }
+
+            char specification[48];
+            char* out = specification;
+            char* const end = specification + sizeof(specification);
+            *out++ = '%';
+            out = std::copy(flags, flags + flagCount, out);
+            if (width >= 0)
+            {
+                out = std::to_chars(out, end, width).ptr;
+            }
+
+            switch (conversion)
+            {
+                case 'd':
+                case 'i':
+                case 'o':
+                case 'u':
+                case 'x':
+                case 'X':
+                {
+                    if (precision >= 0)
+                    {
+                        *out++ = '.';
+                        out = std::to_chars(out, end, precision).ptr;
+                    }
+                    *out++ = 'l';
+                    *out++ = 'l';
+                    *out++ = conversion;
+                    *out = '\0';
+                    if (conversion == 'd' || conversion == 'i')
+                    {
+                        AppendPrintf(text, specification, static_cast<long long>(GetSigned(argument)));
+                    }
+                    else
+                    {
+                        AppendPrintf(text, specification, static_cast<unsigned long long>(GetUnsigned(argument)));
+                    }
+                    break;
+                }
+                case 'c':
+                case 'p':
+                {
+                    *out++ = conversion;
+                    *out = '\0';
+                    if (conversion == 'c')
+                    {
+                        AppendPrintf(text, specification, static_cast<int>(GetSigned(argument)));
+                    }
+                    else
+                    {
+                        AppendPrintf(text, specification, argument.type == ArgumentType::Pointer ? argument.p : nullptr);
+                    }
+                    break;
+                }
+                case 's':
+                {
+                    std::string utf8;
+                    std::string_view string(argument.s, argument.length);
+                    if (argument.type == ArgumentType::WideString)
+                    {
+                        AppendUtf8(utf8, argument.ws, argument.length);
+                        string = utf8;
+                    }
+
+                    *out++ = '.';
+                    *out++ = '*';
+                    *out++ = 's';
+                    *out = '\0';
+                    const size_t length = precision >= 0 ? std::min<size_t>(precision, string.size()) : string.size();
+                    AppendPrintf(text, specification, static_cast<int>(length), string.data());
+                    break;
+                }
+                default:
+                {
+                    if (precision >= 0)
+                    {
+                        *out++ = '.';
+                        out = std::to_chars(out, end, precision).ptr;
+                    }
+                    *out++ = conversion;
+                    *out = '\0';
+                    AppendPrintf(text, specification, GetDouble(argument));
+                    break;
+                }
+            }
+        }
+    }
+
+    namespace
+    {
+        // Writes the remaining messages if the app did not stop the logger, and joins the flusher before the globals are
+        // destroyed.
+        struct StopAtExit
+        {
+            ~StopAtExit()
+            {
+                Stop();
+            }
+        } g_stopAtExit;
+    } // namespace
+} // namespace AsyncLog
@@ -0,0 +1,300 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Logging with deferred formatting, so that logging from the render loop or from async completions does not stall a frame.
+//
+//   AsyncLog::Write("Disconnected with reason %d", failureReason);
+//
+// A message is a printf format string literal and its arguments. The calling thread copies the format string pointer, the
+// time and the arguments (strings by value) into a ring buffer of its own, without a lock or an allocation. A background thread
+// formats the messages of all threads in the order of their time and writes them to the sinks. When the ring of a thread is
+// full, OverflowPolicy decides whether the message is dropped (and the number of dropped messages logged later) or the thread
+// waits for the background thread.
+//
+// While the logger is not started, messages are formatted and written to the debugger on the calling thread, so that nothing
+// logged before Start or after Stop is lost.
+//
+// Arguments can be integers, enums, floating point numbers, pointers and narrow or wide strings (character pointers, arrays
+// and std::basic_string/_view). Wide strings are written as UTF-8, for %s as well as %ls. Strings longer than MaxStringLength
+// characters are cut off.
+//
+// Does not depend on WinRT, so that it can be used and benchmarked on any platform.
+namespace AsyncLog
+{
+    constexpr size_t MaxStringLength = 1024;
+
+    // A formatted message, as handed to the sinks.
+    struct Message
+    {
+        // Nanoseconds since the epoch of std::chrono::system_clock.
+        int64_t time;
+        // Id of the logging thread in the operating system.
+        uint32_t threadId;
+        // The formatted message without a trailing line break.
+        std::string_view text;
+        // "[hh-mm-ss.uuuuuu] (t:<thread id>): <text>\n" in local time. Followed by a null character, which is not part of it.
+        std::string_view line;
+    };
+
+    // Receives the messages on the background thread. The calls of all sinks are serialized.
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+
+        virtual void Write(const Message& message) = 0;
+        // Called after each batch of messages.
+        virtual void Flush()
+        {
+        }
+    };
+
+    // Writes to the debugger output on Windows, and to stderr elsewhere.
+    class DebuggerSink : public Sink
+    {
+    public:
+        void Write(const Message& message) override;
+    };
+
+    // Writes the lines to a file, replacing an existing one.
+    class FileSink : public Sink
+    {
+    public:
+        explicit FileSink(const std::filesystem::path& path);
+
+        bool IsOpen() const
+        {
+            return m_stream.is_open();
+        }
+
+        void Write(const Message& message) override;
+        void Flush() override;
+
+    private:
+        std::ofstream m_stream;
+    };
+
+    // Writes the lines into a memory mapped file of fileSize bytes, so that writing a line is a copy without a system call.
+    // When the file is full, it is closed (and truncated to its content) and renamed to <path>.1, an existing <path>.1 to
+    // <path>.2 and so on, keeping fileCount files, and a new file is started at path. A file which was not closed, e.g. when
+    // the process crashed, is padded with null characters.
+    class RotatingFileSink : public Sink
+    {
+    public:
+        RotatingFileSink(std::filesystem::path path, size_t fileSize = 1 << 20, uint32_t fileCount = 4);
+        ~RotatingFileSink() override;
+
+        RotatingFileSink(const RotatingFileSink&) = delete;
+        RotatingFileSink& operator=(const RotatingFileSink&) = delete;
+
+        bool IsOpen() const
+        {
+            return m_data != nullptr;
+        }
+
+        void Write(const Message& message) override;
+
+    private:
+        struct MappedFile;
+
+        bool OpenFile();
+        void CloseFile();
+
+        std::filesystem::path m_path;
+        size_t m_fileSize;
+        uint32_t m_fileCount;
+
+        MappedFile* m_file = nullptr;
+        uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    enum class OverflowPolicy
+    {
+        // Drop the message and count it. The background thread logs the number of dropped messages of each thread.
+        Drop,
+        // Wait until the background thread made room. Nothing is lost, but a burst of messages can stall the thread.
+        Block,
+    };
+
+    struct Settings
+    {
+        // Capacity of the message ring of each thread in bytes, rounded up to a power of two. A message takes 24 bytes plus 16
+        // bytes per argument, a string argument 8 bytes plus its characters rounded up to 8 bytes. Rings are created when a
+        // thread logs its first message and keep their capacity for the lifetime of the thread.
+        size_t bytesPerThread = 1 << 16;
+        OverflowPolicy overflowPolicy = OverflowPolicy::Drop;
+        // The background thread also wakes up early when a ring is half full.
+        std::chrono::milliseconds flushInterval{20};
+    };
+
+    // Starts the background thread writing to sinks. Returns false if the logger is already running.
+    bool Start(std::vector<std::shared_ptr<Sink>> sinks, const Settings& settings = {});
+
+    // Writes the remaining messages, stops the background thread and releases the sinks.
+    void Stop();
+
+    // Writes the messages logged so far to the sinks and flushes them, on the calling thread.
+    void Flush();
+
+    bool IsRunning();
+
+    namespace Detail
+    {
+        enum class ArgumentType : uint8_t
+        {
+            Signed,
+            Unsigned,
+            Double,
+            Pointer,
+            String,
+            WideString,
+        };
+
+        // An argument of a message. Strings are referenced until Write copies them into the ring of the thread.
+        struct Argument
+        {
+            ArgumentType type;
+            // Size of an integer in bytes, so that e.g. %x of a negative int32 prints 8 digits.
+            uint8_t size = 8;
+            uint32_t length = 0;
+            union
+            {
+                int64_t i;
+                uint64_t u;
+                double d;
+                const void* p;
+                const char* s;
+                const wchar_t* ws;
+            };
+        };
+
+        template <typename T>
+        constexpr bool AlwaysFalse = false;
+
+        template <typename TChar>
+        Argument MakeStringArgument(std::basic_string_view<TChar> value)
+        {
+            Argument argument{};
+            argument.type = std::is_same_v<TChar, char> ? ArgumentType::String : ArgumentType::WideString;
+            argument.length = static_cast<uint32_t>(std::min(value.size(), MaxStringLength));
+            argument.p = value.data();
+            return argument;
+        }
+
+        // A character array holds a string up to its first null character, and cannot be null itself.
+        template <size_t N>
+        Argument MakeArgument(const char (&value)[N])
+        {
+            return MakeStringArgument<char>({value, static_cast<size_t>(std::find(value, value + N, '\0') - value)});
+        }
+
+        template <size_t N>
+        Argument MakeArgument(const wchar_t (&value)[N])
+        {
+            return MakeStringArgument<wchar_t>({value, static_cast<size_t>(std::find(value, value + N, L'\0') - value)});
+        }
+
+        template <typename T>
+        Argument MakeArgument(const T& value)
+        {
+            using Type = std::decay_t<T>;
+            if constexpr (std::is_enum_v<Type>)
+            {
+                return MakeArgument(static_cast<std::underlying_type_t<Type>>(value));
+            }
+            else if constexpr (std::is_integral_v<Type>)
+            {
+                Argument argument{};
+                argument.type = std::is_signed_v<Type> ? ArgumentType::Signed : ArgumentType::Unsigned;
+                argument.size = sizeof(Type);
+                if constexpr (std::is_signed_v<Type>)
+                {
+                    argument.i = value;
+                }
+                else
+                {
+                    argument.u = value;
+                }
+                return argument;
+            }
+            else if constexpr (std::is_floating_point_v<Type>)
+            {
+                Argument argument{};
+                argument.type = ArgumentType::Double;
+                argument.d = static_cast<double>(value);
+                return argument;
+            }
+            else if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>)
+            {
+                return MakeStringArgument<char>(value ? value : "(null)");
+            }
+            else if constexpr (std::is_same_v<Type, const wchar_t*> || std::is_same_v<Type, wchar_t*>)
+            {
+                return MakeStringArgument<wchar_t>(value ? value : L"(null)");
+            }
+            else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+            {
+                return MakeStringArgument<char>(value);
+            }
+            else if constexpr (std::is_convertible_v<const T&, std::wstring_view>)
+            {
+                return MakeStringArgument<wchar_t>(value);
+            }
+            else if constexpr (std::is_pointer_v<Type> || std::is_null_pointer_v<Type>)
+            {
+                Argument argument{};
+                argument.type = ArgumentType::Pointer;
+                argument.p = value;
+                return argument;
+            }
+            else
+            {
+                static_assert(AlwaysFalse<T>, "Unsupported log argument, convert it to a number or string.");
+            }
+        }
+
+        void Write(const char* format, std::span<const Argument> arguments);
+        void Format(std::string& text, const char* format, std::span<const Argument> arguments);
+    } // namespace Detail
+
+    // Logs a message. format must be a string literal, as the background thread reads it after Write returned.
+    template <size_t N, typename... Args>
+    void Write(const char (&format)[N], const Args&... args)
+    {
+        const std::array<Detail::Argument, sizeof...(Args)> arguments{Detail::MakeArgument(args)...};
+        Detail::Write(format, arguments);
+    }
+
+    // Appends the message to text, formatted as the background thread formats it.
+    template <typename... Args>
+    void Format(std::string& text, const char* format, const Args&... args)
+    {
+        const std::array<Detail::Argument, sizeof...(Args)> arguments{Detail::MakeArgument(args)...};
+        Detail::Format(text, format, arguments);
+    }
+} // namespace AsyncLog
@@ -0,0 +1,105 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <DataChannelBatcher.h>
+
+namespace DataChannel
+{
+    MessageBatcher::MessageBatcher(IPacketTransport& transport, const BatcherSettings& settings)
+        : m_transport(transport)
+        , m_settings(settings)
+    {
+        m_packet.reserve(m_settings.maxPacketSize);
+    }
+
+    MessageWriter& MessageBatcher::BeginMessage(MessageType type)
+    {
+        m_messageStart = m_packet.size();
+        m_writer.BeginMessage(type);
+        return m_writer;
+    }
+
+    void MessageBatcher::EndMessage(Clock::time_point now, bool urgent)
+    {
+        m_writer.EndMessage();
+
+        // A message which does not fit into the batch anymore starts the next one.
+        if (m_pendingMessageCount > 0 && m_packet.size() > m_settings.maxPacketSize)
+        {
+            SendPacket(m_messageStart, m_statistics.fullPacketCount);
+        }
+
+        if (m_pendingMessageCount == 0)
+        {
+            m_firstMessageTime = now;
+        }
+        ++m_pendingMessageCount;
+        ++m_statistics.messageCount;
+
+        if (urgent)
+        {
+            SendPacket(m_packet.size(), m_statistics.flushedPacketCount);
+        }
+        else if (m_packet.size() >= m_settings.maxPacketSize)
+        {
+            SendPacket(m_packet.size(), m_statistics.fullPacketCount);
+        }
+        else
+        {
+            Poll(now);
+        }
+    }
+
+    void MessageBatcher::Poll(Clock::time_point now)
+    {
+        if (m_pendingMessageCount > 0 && now >= GetDeadline())
+        {
+            SendPacket(m_packet.size(), m_statistics.deadlinePacketCount);
+        }
+    }
+
+    void MessageBatcher::Flush()
+    {
+        if (m_pendingMessageCount > 0)
+        {
+            SendPacket(m_packet.size(), m_statistics.flushedPacketCount);
+        }
+    }
+
+    void MessageBatcher::Clear()
+    {
+        m_packet.clear();
+        m_pendingMessageCount = 0;
+    }
+
+    MessageBatcher::Clock::time_point MessageBatcher::GetDeadline() const
+    {
+        return m_pendingMessageCount > 0 ? m_firstMessageTime + m_settings.latencyBudget : Clock::time_point::max();
+    }
+
+    void MessageBatcher::SendPacket(size_t size, uint64_t& reasonCount)
+    {
+        if (m_transport.SendPacket(std::span<const uint8_t>(m_packet).first(size), m_settings.guaranteedDelivery))
+        {
+            ++m_statistics.packetCount;
+            m_statistics.byteCount += size;
+            ++reasonCount;
+        }
+        else
+        {
+            ++m_statistics.failedPacketCount;
+        }
+
+        // A message after the sent ones is the one EndMessage is adding, which is counted by EndMessage.
+        m_packet.erase(m_packet.begin(), m_packet.begin() + size);
+        m_pendingMessageCount = 0;
+    }
+} // namespace DataChannel
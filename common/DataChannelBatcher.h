@@ -0,0 +1,136 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <DataChannelProtocol.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace DataChannel
+{
+    // Destination of the packets of a MessageBatcher, implemented by the samples over their data channel.
+    class IPacketTransport
+    {
+    public:
+        virtual ~IPacketTransport() = default;
+
+        // Sends one packet. Returns false if the packet was not sent, e.g. because the channel was closed or is congested.
+        virtual bool SendPacket(std::span<const uint8_t> packet, bool guaranteedDelivery) = 0;
+    };
+
+    struct BatcherSettings
+    {
+        // Batches are sent once they reach this size, which stays below a typical MTU. A message larger than this is sent in a
+        // packet of its own.
+        size_t maxPacketSize = 1200;
+
+        // A batch is sent at the latest this long after its first message was added, by EndMessage or Poll.
+        std::chrono::microseconds latencyBudget{2000};
+
+        bool guaranteedDelivery = true;
+    };
+
+    struct BatcherStatistics
+    {
+        uint64_t messageCount = 0;
+        uint64_t packetCount = 0;
+        uint64_t byteCount = 0;
+
+        // Number of packets by the reason they were sent.
+        uint64_t fullPacketCount = 0;
+        uint64_t deadlinePacketCount = 0;
+        uint64_t flushedPacketCount = 0;
+
+        // Packets the transport did not send. Their messages are dropped.
+        uint64_t failedPacketCount = 0;
+
+        double GetMessagesPerPacket() const
+        {
+            return packetCount > 0 ? double(messageCount) / double(packetCount) : 0.0;
+        }
+
+        double GetAveragePacketSize() const
+        {
+            return packetCount > 0 ? double(byteCount) / double(packetCount) : 0.0;
+        }
+    };
+
+    // Coalesces messages into packets, Nagle-style: small messages are collected until the batch is full or the latency budget
+    // of its first message is spent, so that many tiny messages cost one send call. Urgent messages and Flush send the batch
+    // right away. The messages keep their order.
+    //
+    // Sending happens within EndMessage, Poll and Flush, there is no timer: the owner calls Poll at least as often as the
+    // latency budget requires (GetDeadline tells when). Not thread-safe.
+    class MessageBatcher
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit MessageBatcher(IPacketTransport& transport, const BatcherSettings& settings = {});
+
+        MessageBatcher(const MessageBatcher&) = delete;
+        MessageBatcher& operator=(const MessageBatcher&) = delete;
+
+        // Starts a message at the end of the batch. Its payload is written with the returned writer until EndMessage.
+        MessageWriter& BeginMessage(MessageType type);
+
+        // Adds the message to the batch, and sends the batch if it is full, urgent is set or the latency budget is spent.
+        void EndMessage(Clock::time_point now, bool urgent = false);
+
+        // Adds a message with an empty payload.
+        void AddMessage(MessageType type, Clock::time_point now, bool urgent = false)
+        {
+            BeginMessage(type);
+            EndMessage(now, urgent);
+        }
+
+        // Sends the batch if its latency budget is spent.
+        void Poll(Clock::time_point now);
+
+        // Sends the batch.
+        void Flush();
+
+        // Drops the batch without sending it, e.g. when the channel was closed.
+        void Clear();
+
+        // Time at which the batch has to be sent, or Clock::time_point::max() if it is empty.
+        Clock::time_point GetDeadline() const;
+
+        size_t GetPendingMessageCount() const
+        {
+            return m_pendingMessageCount;
+        }
+
+        const BatcherStatistics& GetStatistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        void SendPacket(size_t size, uint64_t& reasonCount);
+
+        IPacketTransport& m_transport;
+        const BatcherSettings m_settings;
+
+        std::vector<uint8_t> m_packet;
+        MessageWriter m_writer{m_packet};
+        size_t m_messageStart = 0;
+        size_t m_pendingMessageCount = 0;
+        Clock::time_point m_firstMessageTime;
+
+        BatcherStatistics m_statistics;
+    };
+} // namespace DataChannel
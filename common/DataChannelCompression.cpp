@@ -0,0 +1,447 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <DataChannelCompression.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    using namespace DataChannel;
+
+    constexpr size_t LzMinMatch = 4;
+    constexpr uint32_t LzHashBits = 12;
+    constexpr size_t LzMaxOffset = 0xFFFF;
+
+    // Uncompressed size field in front of every compressed payload.
+    constexpr size_t UncompressedSizeSize = sizeof(uint32_t);
+
+    uint32_t Load32(const uint8_t* data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint16_t Load16(const uint8_t* data)
+    {
+        uint16_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    // Lengths which do not fit into their nibble of the token continue in bytes of 255, ended by a byte below 255.
+    void WriteLength(std::vector<uint8_t>& output, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            output.push_back(255);
+        }
+        output.push_back(static_cast<uint8_t>(length));
+    }
+
+    bool ReadLength(std::span<const uint8_t> input, size_t& position, size_t& length)
+    {
+        while (position < input.size())
+        {
+            const uint8_t value = input[position++];
+            length += value;
+            if (value != 255)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // A sequence is a token with the literal length in the high nibble and the match length - LzMinMatch in the low nibble,
+    // the literals, and the uint16 offset of the match. The last sequence has literals only.
+    void WriteSequence(std::vector<uint8_t>& output, std::span<const uint8_t> literals, size_t offset, size_t matchLength)
+    {
+        const size_t matchNibble = matchLength > 0 ? matchLength - LzMinMatch : 0;
+        output.push_back(static_cast<uint8_t>((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(matchNibble, 15)));
+        if (literals.size() >= 15)
+        {
+            WriteLength(output, literals.size() - 15);
+        }
+        output.insert(output.end(), literals.begin(), literals.end());
+
+        if (matchLength > 0)
+        {
+            output.push_back(static_cast<uint8_t>(offset));
+            output.push_back(static_cast<uint8_t>(offset >> 8));
+            if (matchNibble >= 15)
+            {
+                WriteLength(output, matchNibble - 15);
+            }
+        }
+    }
+
+    uint16_t ZigZag(int16_t value)
+    {
+        return static_cast<uint16_t>((static_cast<uint16_t>(value) << 1) ^ static_cast<uint16_t>(value >> 15));
+    }
+
+    int16_t UnZigZag(uint16_t value)
+    {
+        return static_cast<int16_t>((value >> 1) ^ (0 - (value & 1)));
+    }
+} // namespace
+
+namespace DataChannel
+{
+    void CompressLz(std::span<const uint8_t> input, std::vector<uint8_t>& output)
+    {
+        // Positions + 1 of the last occurrence of each hashed 4 byte sequence, 0 for none.
+        std::array<uint32_t, size_t(1) << LzHashBits> table{};
+
+        const uint8_t* data = input.data();
+        size_t position = 0;
+        size_t literalStart = 0;
+        while (position + LzMinMatch <= input.size())
+        {
+            const uint32_t sequence = Load32(data + position);
+            const uint32_t hash = (sequence * 2654435761u) >> (32 - LzHashBits);
+            const size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(position + 1);
+
+            if (candidate == 0 || position - (candidate - 1) > LzMaxOffset || Load32(data + candidate - 1) != sequence)
+            {
+                // Skip ahead faster the longer no match was found, as the data is probably incompressible.
+                position += 1 + ((position - literalStart) >> 6);
+                continue;
+            }
+
+            const size_t match = candidate - 1;
+            size_t length = LzMinMatch;
+            while (position + length < input.size() && data[match + length] == data[position + length])
+            {
+                ++length;
+            }
+            WriteSequence(output, input.subspan(literalStart, position - literalStart), position - match, length);
+            position += length;
+            literalStart = position;
+        }
+        WriteSequence(output, input.subspan(literalStart), 0, 0);
+    }
+
+    bool DecompressLz(std::span<const uint8_t> input, std::span<uint8_t> output)
+    {
+        size_t in = 0;
+        size_t out = 0;
+        while (in < input.size())
+        {
+            const uint8_t token = input[in++];
+
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !ReadLength(input, in, literalLength))
+            {
+                return false;
+            }
+            if (literalLength > input.size() - in || literalLength > output.size() - out)
+            {
+                return false;
+            }
+            std::memcpy(output.data() + out, input.data() + in, literalLength);
+            in += literalLength;
+            out += literalLength;
+
+            if (in == input.size())
+            {
+                // the last sequence
+                return out == output.size();
+            }
+
+            if (input.size() - in < 2)
+            {
+                return false;
+            }
+            const size_t offset = Load16(input.data() + in);
+            in += 2;
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !ReadLength(input, in, matchLength))
+            {
+                return false;
+            }
+            matchLength += LzMinMatch;
+            if (offset == 0 || offset > out || matchLength > output.size() - out)
+            {
+                return false;
+            }
+
+            uint8_t* destination = output.data() + out;
+            const uint8_t* source = destination - offset;
+            if (offset >= matchLength)
+            {
+                std::memcpy(destination, source, matchLength);
+            }
+            else
+            {
+                // The match overlaps the bytes it produces, e.g. a run of one byte.
+                for (size_t i = 0; i < matchLength; ++i)
+                {
+                    destination[i] = source[i];
+                }
+            }
+            out += matchLength;
+        }
+        return false;
+    }
+
+    void EncodeDeltaVarint16(std::span<const uint8_t> input, uint8_t stride, std::vector<uint8_t>& output)
+    {
+        const size_t count = input.size() / 2;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint16_t value = Load16(input.data() + i * 2);
+            const uint16_t previous = i >= stride ? Load16(input.data() + (i - stride) * 2) : 0;
+            uint16_t coded = ZigZag(static_cast<int16_t>(static_cast<uint16_t>(value - previous)));
+            for (; coded >= 0x80; coded >>= 7)
+            {
+                output.push_back(static_cast<uint8_t>(coded | 0x80));
+            }
+            output.push_back(static_cast<uint8_t>(coded));
+        }
+        if (input.size() % 2 != 0)
+        {
+            output.push_back(input.back());
+        }
+    }
+
+    bool DecodeDeltaVarint16(std::span<const uint8_t> input, uint8_t stride, std::span<uint8_t> output)
+    {
+        if (stride == 0)
+        {
+            return false;
+        }
+
+        const size_t count = output.size() / 2;
+        size_t in = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t coded = 0;
+            for (uint32_t shift = 0;; shift += 7)
+            {
+                if (in == input.size() || shift > 14)
+                {
+                    return false;
+                }
+                const uint8_t byte = input[in++];
+                coded |= uint32_t(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    break;
+                }
+            }
+            if (coded > 0xFFFF)
+            {
+                return false;
+            }
+
+            const uint16_t previous = i >= stride ? Load16(output.data() + (i - stride) * 2) : 0;
+            const uint16_t value = static_cast<uint16_t>(previous + static_cast<uint16_t>(UnZigZag(static_cast<uint16_t>(coded))));
+            std::memcpy(output.data() + i * 2, &value, sizeof(value));
+        }
+        if (output.size() % 2 != 0)
+        {
+            if (in == input.size())
+            {
+                return false;
+            }
+            output.back() = input[in++];
+        }
+        return in == input.size();
+    }
+
+    bool DecodePayload(const MessageView& message, std::vector<uint8_t>& buffer, std::span<const uint8_t>& payload)
+    {
+        if ((message.flags & ~PayloadCodecMask) != 0)
+        {
+            return false;
+        }
+        const PayloadCodec codec = static_cast<PayloadCodec>(message.flags & PayloadCodecMask);
+        if (codec == PayloadCodec::None)
+        {
+            payload = message.payload;
+            return true;
+        }
+        if (codec >= PayloadCodec::Count)
+        {
+            return false;
+        }
+
+        PayloadReader reader(message.payload);
+        uint32_t size = 0;
+        uint8_t stride = 0;
+        std::span<const uint8_t> encoded;
+        reader.Read(size);
+        if (codec == PayloadCodec::DeltaVarint16)
+        {
+            reader.Read(stride);
+        }
+        reader.ReadRemaining(encoded);
+
+        // Sizes the codec can not produce from the input are rejected before allocating, so that a corrupt size can not
+        // allocate gigabytes.
+        const uint64_t maxSize = codec == PayloadCodec::Lz ? uint64_t(encoded.size()) * 255 + 15
+                                                           : uint64_t(encoded.size()) * 2 + 1;
+        if (!reader.IsValid() || size > maxSize)
+        {
+            return false;
+        }
+
+        buffer.resize(size);
+        const bool decoded = codec == PayloadCodec::Lz ? DecompressLz(encoded, buffer) : DecodeDeltaVarint16(encoded, stride, buffer);
+        payload = buffer;
+        return decoded;
+    }
+
+    PayloadCompressor::PayloadCompressor(const CompressionSettings& settings)
+        : m_settings(settings)
+    {
+    }
+
+    void PayloadCompressor::SetInt16Layout(MessageType type, uint8_t stride)
+    {
+        TypeState& state = m_types[type];
+        state.int16Stride = stride;
+        state.ratios[static_cast<size_t>(PayloadCodec::DeltaVarint16)] = -1.0;
+        // probe with the next payload
+        state.probeCountdown = 0;
+    }
+
+    PayloadCodec PayloadCompressor::Compress(MessageType type, std::span<const uint8_t> payload, std::vector<uint8_t>& output)
+    {
+        ++m_statistics.payloadCount;
+        m_statistics.inputBytes += payload.size();
+
+        PayloadCodec codec = PayloadCodec::None;
+        const size_t outputStart = output.size();
+        if (payload.size() >= m_settings.minPayloadSize)
+        {
+            TypeState& state = m_types[type];
+            if (state.probeCountdown == 0)
+            {
+                codec = Probe(state, payload, output);
+                state.probeCountdown = m_settings.probeInterval;
+            }
+            else
+            {
+                --state.probeCountdown;
+                codec = state.codec;
+                if (codec != PayloadCodec::None)
+                {
+                    Encode(codec, state, payload, output);
+                    UpdateRatio(state, codec, double(output.size() - outputStart) / double(payload.size()));
+                    if (state.ratios[static_cast<size_t>(codec)] > m_settings.maxRatio)
+                    {
+                        // not worth it anymore, until the next probe finds a better codec
+                        state.codec = PayloadCodec::None;
+                    }
+                }
+            }
+
+            // A payload which the codec of its type does not shrink is sent as it is.
+            if (codec != PayloadCodec::None && output.size() - outputStart >= payload.size())
+            {
+                output.resize(outputStart);
+                codec = PayloadCodec::None;
+            }
+        }
+
+        if (codec != PayloadCodec::None)
+        {
+            ++m_statistics.compressedCount;
+            m_statistics.outputBytes += output.size() - outputStart;
+        }
+        else
+        {
+            m_statistics.outputBytes += payload.size();
+        }
+        return codec;
+    }
+
+    void PayloadCompressor::WriteMessage(MessageWriter& writer, MessageType type, std::span<const uint8_t> payload)
+    {
+        m_encoded.clear();
+        const PayloadCodec codec = Compress(type, payload, m_encoded);
+        writer.BeginMessage(type, static_cast<uint8_t>(codec));
+        writer.WriteRawBytes(codec != PayloadCodec::None ? std::span<const uint8_t>(m_encoded) : payload);
+        writer.EndMessage();
+    }
+
+    PayloadCodec PayloadCompressor::GetCodec(MessageType type) const
+    {
+        const auto it = m_types.find(type);
+        return it != m_types.end() ? it->second.codec : PayloadCodec::None;
+    }
+
+    void PayloadCompressor::Encode(
+        PayloadCodec codec, const TypeState& state, std::span<const uint8_t> payload, std::vector<uint8_t>& output)
+    {
+        const uint32_t size = static_cast<uint32_t>(payload.size());
+        const uint8_t* sizeBytes = reinterpret_cast<const uint8_t*>(&size);
+        output.insert(output.end(), sizeBytes, sizeBytes + UncompressedSizeSize);
+        if (codec == PayloadCodec::Lz)
+        {
+            CompressLz(payload, output);
+        }
+        else
+        {
+            output.push_back(state.int16Stride);
+            EncodeDeltaVarint16(payload, state.int16Stride, output);
+        }
+    }
+
+    PayloadCodec PayloadCompressor::Probe(TypeState& state, std::span<const uint8_t> payload, std::vector<uint8_t>& output)
+    {
+        for (PayloadCodec codec : {PayloadCodec::Lz, PayloadCodec::DeltaVarint16})
+        {
+            if (codec == PayloadCodec::DeltaVarint16 && state.int16Stride == 0)
+            {
+                continue;
+            }
+            std::vector<uint8_t>& probeOutput = m_probeOutputs[static_cast<size_t>(codec)];
+            probeOutput.clear();
+            Encode(codec, state, payload, probeOutput);
+            UpdateRatio(state, codec, double(probeOutput.size()) / double(payload.size()));
+        }
+
+        // The best codec by average, if it is worth it. This payload is sent with it even if another codec did better on it,
+        // so that an outlier does not make the type switch back and forth.
+        state.codec = PayloadCodec::None;
+        double bestRatio = m_settings.maxRatio;
+        for (PayloadCodec codec : {PayloadCodec::Lz, PayloadCodec::DeltaVarint16})
+        {
+            const double ratio = state.ratios[static_cast<size_t>(codec)];
+            if (ratio >= 0.0 && ratio <= bestRatio && (codec != PayloadCodec::DeltaVarint16 || state.int16Stride != 0))
+            {
+                state.codec = codec;
+                bestRatio = ratio;
+            }
+        }
+
+        if (state.codec != PayloadCodec::None)
+        {
+            const std::vector<uint8_t>& probeOutput = m_probeOutputs[static_cast<size_t>(state.codec)];
+            output.insert(output.end(), probeOutput.begin(), probeOutput.end());
+        }
+        return state.codec;
+    }
+
+    void PayloadCompressor::UpdateRatio(TypeState& state, PayloadCodec codec, double ratio)
+    {
+        double& average = state.ratios[static_cast<size_t>(codec)];
+        average = average < 0.0 ? ratio : average + m_settings.ratioSmoothing * (ratio - average);
+    }
+} // namespace DataChannel
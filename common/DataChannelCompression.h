@@ -0,0 +1,142 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <DataChannelProtocol.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Optional compression of message payloads. The codec of a payload is stored in the flags of its message header, and a
+// compressed payload starts with its uint32 uncompressed size, followed by the output of the codec. Handlers of messages which
+// may be compressed read their payload through DecodePayload.
+namespace DataChannel
+{
+    enum class PayloadCodec : uint8_t
+    {
+        None = 0,
+        // Byte-oriented LZ77 in the style of LZ4: fast on any data, good on repetitive data like text.
+        Lz = 1,
+        // Delta of each 16-bit value to the value stride values before it, zigzag and varint coded. For arrays of int16 or uint16
+        // elements like the positions of SpatialSurfaceMeshPart::Vertex_t (stride 4) and mesh indices (stride 1). Followed by
+        // the uint8 stride.
+        DeltaVarint16 = 2,
+
+        Count
+    };
+
+    constexpr size_t PayloadCodecCount = static_cast<size_t>(PayloadCodec::Count);
+
+    // Bits of MessageHeader::flags which hold the PayloadCodec.
+    constexpr uint8_t PayloadCodecMask = 0x03;
+
+    // Appends the compressed input to the output.
+    void CompressLz(std::span<const uint8_t> input, std::vector<uint8_t>& output);
+    // Decompresses into output, which has the uncompressed size. Returns false if the input is corrupt.
+    bool DecompressLz(std::span<const uint8_t> input, std::span<uint8_t> output);
+
+    // Appends the coded input to the output. An odd last byte is stored as it is.
+    void EncodeDeltaVarint16(std::span<const uint8_t> input, uint8_t stride, std::vector<uint8_t>& output);
+    // Decodes into output, which has the uncoded size. Returns false if the input is corrupt.
+    bool DecodeDeltaVarint16(std::span<const uint8_t> input, uint8_t stride, std::span<uint8_t> output);
+
+    // Payload of the message, decompressed into the buffer if the message is compressed. Returns false if the payload is
+    // corrupt or has an unknown encoding.
+    bool DecodePayload(const MessageView& message, std::vector<uint8_t>& buffer, std::span<const uint8_t>& payload);
+
+    struct CompressionSettings
+    {
+        // Smaller payloads are sent as they are.
+        size_t minPayloadSize = 64;
+
+        // A codec is used while it shrinks the payloads of a type to at most this ratio, otherwise they are sent as they are.
+        double maxRatio = 0.9;
+
+        // Every probeInterval-th payload of a type is compressed with all codecs of the type, to switch to the best one.
+        uint32_t probeInterval = 32;
+
+        // Weight of a new ratio in its moving average.
+        double ratioSmoothing = 0.25;
+    };
+
+    struct CompressionStatistics
+    {
+        uint64_t payloadCount = 0;
+        uint64_t compressedCount = 0;
+        uint64_t inputBytes = 0;
+        // Bytes of the sent payloads, compressed or not.
+        uint64_t outputBytes = 0;
+
+        double GetRatio() const
+        {
+            return inputBytes > 0 ? double(outputBytes) / double(inputBytes) : 1.0;
+        }
+    };
+
+    // Compresses payloads with the codec which works best for their type. Each type keeps the moving average of the ratio of
+    // its codecs, measured on every payload for the codec in use and on every probeInterval-th payload for all codecs. Types
+    // are told apart by the type of their message, or the content type of a stream. Not thread-safe.
+    class PayloadCompressor
+    {
+    public:
+        explicit PayloadCompressor(const CompressionSettings& settings = {});
+
+        PayloadCompressor(const PayloadCompressor&) = delete;
+        PayloadCompressor& operator=(const PayloadCompressor&) = delete;
+
+        // Declares the payloads of the type to be arrays of 16-bit values with elements of stride values, which makes the
+        // DeltaVarint16 codec a candidate for the type.
+        void SetInt16Layout(MessageType type, uint8_t stride);
+
+        // Appends the compressed payload to the output and returns its codec. Returns PayloadCodec::None without appending if
+        // the payload is better sent as it is.
+        PayloadCodec Compress(MessageType type, std::span<const uint8_t> payload, std::vector<uint8_t>& output);
+
+        // Writes a message with the payload, compressed if worthwhile.
+        void WriteMessage(MessageWriter& writer, MessageType type, std::span<const uint8_t> payload);
+
+        // Codec currently used for the type.
+        PayloadCodec GetCodec(MessageType type) const;
+
+        const CompressionStatistics& GetStatistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        struct TypeState
+        {
+            uint8_t int16Stride = 0;
+            PayloadCodec codec = PayloadCodec::None;
+            // Moving average of compressed size / uncompressed size, per codec. Negative until measured.
+            std::array<double, PayloadCodecCount> ratios = {1.0, -1.0, -1.0};
+            // Payloads until the next probe.
+            uint32_t probeCountdown = 0;
+        };
+
+        // Appends the uncompressed size and the output of the codec.
+        void Encode(PayloadCodec codec, const TypeState& state, std::span<const uint8_t> payload, std::vector<uint8_t>& output);
+        PayloadCodec Probe(TypeState& state, std::span<const uint8_t> payload, std::vector<uint8_t>& output);
+        void UpdateRatio(TypeState& state, PayloadCodec codec, double ratio);
+
+        const CompressionSettings m_settings;
+        std::unordered_map<MessageType, TypeState> m_types;
+        std::array<std::vector<uint8_t>, PayloadCodecCount> m_probeOutputs;
+        std::vector<uint8_t> m_encoded;
+        CompressionStatistics m_statistics;
+    };
+} // namespace DataChannel
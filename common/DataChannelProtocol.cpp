@@ -0,0 +1,187 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <DataChannelProtocol.h>
+
+namespace DataChannel
+{
+    PacketReader::PacketReader(std::span<const uint8_t> packet)
+        : m_remaining(packet)
+        , m_legacyPing(IsLegacyPing(packet))
+    {
+    }
+
+    ReadStatus PacketReader::Next(MessageView& message)
+    {
+        if (m_status != ReadStatus::Ok)
+        {
+            return m_status;
+        }
+
+        if (m_legacyPing)
+        {
+            m_legacyPing = false;
+            m_remaining = {};
+            message = {MessageType::Ping, 0, {}};
+            return ReadStatus::Ok;
+        }
+
+        if (m_remaining.empty())
+        {
+            return m_status = ReadStatus::End;
+        }
+        if (m_remaining.size() < MessageHeaderSize)
+        {
+            return m_status = ReadStatus::Truncated;
+        }
+
+        MessageHeader header;
+        std::memcpy(&header, m_remaining.data(), MessageHeaderSize);
+        if (header.version != ProtocolVersion)
+        {
+            return m_status = ReadStatus::UnsupportedVersion;
+        }
+        if (header.payloadSize > m_remaining.size() - MessageHeaderSize)
+        {
+            return m_status = ReadStatus::Truncated;
+        }
+
+        message = {header.type, header.flags, m_remaining.subspan(MessageHeaderSize, header.payloadSize)};
+        m_remaining = m_remaining.subspan(MessageHeaderSize + header.payloadSize);
+        return ReadStatus::Ok;
+    }
+
+    bool PayloadReader::ReadBytes(std::span<const uint8_t>& bytes)
+    {
+        UnalignedArrayView<uint8_t> values;
+        if (!ReadArray(values))
+        {
+            return false;
+        }
+        bytes = values.GetBytes();
+        return true;
+    }
+
+    bool PayloadReader::ReadString(std::string_view& text)
+    {
+        std::span<const uint8_t> bytes;
+        if (!ReadBytes(bytes))
+        {
+            return false;
+        }
+        text = std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        return true;
+    }
+
+    bool PayloadReader::ReadRemaining(std::span<const uint8_t>& bytes)
+    {
+        if (!m_valid)
+        {
+            return false;
+        }
+        bytes = m_remaining;
+        m_remaining = {};
+        return true;
+    }
+
+    const uint8_t* PayloadReader::Consume(size_t size)
+    {
+        if (!m_valid || size > m_remaining.size())
+        {
+            Fail();
+            return nullptr;
+        }
+        const uint8_t* data = m_remaining.data();
+        m_remaining = m_remaining.subspan(size);
+        return data;
+    }
+
+    bool PayloadReader::Fail()
+    {
+        m_valid = false;
+        m_remaining = {};
+        return false;
+    }
+
+    void MessageWriter::BeginMessage(MessageType type, uint8_t flags)
+    {
+        m_messageStart = m_packet.size();
+        const MessageHeader header = {ProtocolVersion, flags, type, 0};
+        Append(&header, MessageHeaderSize);
+    }
+
+    void MessageWriter::EndMessage()
+    {
+        const uint32_t size = static_cast<uint32_t>(m_packet.size() - m_messageStart - MessageHeaderSize);
+        std::memcpy(m_packet.data() + m_messageStart + offsetof(MessageHeader, payloadSize), &size, sizeof(size));
+    }
+
+    void MessageWriter::WriteBytes(std::span<const uint8_t> bytes)
+    {
+        WriteArray(bytes);
+    }
+
+    void MessageWriter::WriteString(std::string_view text)
+    {
+        WriteBytes({reinterpret_cast<const uint8_t*>(text.data()), text.size()});
+    }
+
+    void MessageWriter::Append(const void* data, size_t size)
+    {
+        const size_t offset = m_packet.size();
+        m_packet.resize(offset + size);
+        if (size > 0)
+        {
+            std::memcpy(m_packet.data() + offset, data, size);
+        }
+    }
+
+    void MessageDispatcher::Register(MessageType type, Handler handler)
+    {
+        const size_t index = static_cast<size_t>(type);
+        if (index >= m_handlers.size())
+        {
+            if (!handler)
+            {
+                return;
+            }
+            m_handlers.resize(index + 1);
+        }
+        m_handlers[index] = std::move(handler);
+    }
+
+    bool MessageDispatcher::IsRegistered(MessageType type) const
+    {
+        const size_t index = static_cast<size_t>(type);
+        return index < m_handlers.size() && m_handlers[index];
+    }
+
+    MessageDispatcher::DispatchResult MessageDispatcher::Dispatch(std::span<const uint8_t> packet) const
+    {
+        DispatchResult result;
+        PacketReader reader(packet);
+        MessageView message;
+        while ((result.status = reader.Next(message)) == ReadStatus::Ok)
+        {
+            const size_t index = static_cast<size_t>(message.type);
+            if (index < m_handlers.size() && m_handlers[index])
+            {
+                m_handlers[index](message);
+                ++result.dispatchedCount;
+            }
+            else
+            {
+                ++result.unhandledCount;
+            }
+        }
+        return result;
+    }
+} // namespace DataChannel
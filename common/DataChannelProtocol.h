@@ -0,0 +1,296 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Message protocol of the custom data channel, shared by the remote and player samples. A packet passed to SendData holds one
+// or more messages back to back. Each message is a MessageHeader followed by its payload. All values are little-endian and
+// unaligned.
+//
+// The payload fields are read in place: PayloadReader returns views into the received packet instead of copies, which stay
+// valid as long as the packet. Does not depend on WinRT, so that the protocol can be used (and benchmarked) on any platform.
+namespace DataChannel
+{
+    static_assert(std::endian::native == std::endian::little, "The protocol is stored in native little-endian byte order");
+
+    // Version of the message header. Version 1 is the legacy protocol, a packet of the single byte LegacyPingPacket.
+    constexpr uint8_t ProtocolVersion = 2;
+    constexpr uint8_t LegacyPingPacket = 1;
+
+    enum class MessageType : uint16_t
+    {
+        // Sent by the remote, echoed by the player.
+        Ping = 1,
+
+        // Chunked transfer of a large payload, see DataChannelStream.h.
+        StreamBegin = 2,
+        StreamChunk = 3,
+        StreamCancel = 4,
+
+        // Sent by the player: the video bitrate in kbps (uint32) which its link carries, see BitrateController.h. The remote
+        // applies it the next time it negotiates the bitrate, i.e. when it connects.
+        BitrateTarget = 5,
+
+        // Types from here on are free for the application.
+        FirstApplicationType = 0x100
+    };
+
+    // Size of the header in front of every message.
+    constexpr size_t MessageHeaderSize = 8;
+
+    struct MessageHeader
+    {
+        uint8_t version;
+        // Encoding of the payload, a PayloadCodec (see DataChannelCompression.h). 0 for a plain payload.
+        uint8_t flags;
+        MessageType type;
+        uint32_t payloadSize;
+    };
+    static_assert(sizeof(MessageHeader) == MessageHeaderSize, "MessageHeader must match the wire layout");
+
+    // A message within a received packet. The payload points into the packet.
+    struct MessageView
+    {
+        MessageType type;
+        uint8_t flags;
+        std::span<const uint8_t> payload;
+    };
+
+    enum class ReadStatus
+    {
+        Ok,
+        // No messages are left.
+        End,
+        // The packet ends within a header or a payload.
+        Truncated,
+        // The header has a newer (or unknown) version. The rest of the packet can not be parsed.
+        UnsupportedVersion
+    };
+
+    // True for the single byte ping of peers which predate the message protocol.
+    inline bool IsLegacyPing(std::span<const uint8_t> packet)
+    {
+        return packet.size() == 1 && packet[0] == LegacyPingPacket;
+    }
+
+    // Iterates the messages of a packet in place. A legacy ping packet is read as one Ping message without payload.
+    class PacketReader
+    {
+    public:
+        explicit PacketReader(std::span<const uint8_t> packet);
+
+        // Reads the next message. Once a status other than Ok is returned, the following calls return the same status.
+        ReadStatus Next(MessageView& message);
+
+    private:
+        std::span<const uint8_t> m_remaining;
+        ReadStatus m_status = ReadStatus::Ok;
+        bool m_legacyPing = false;
+    };
+
+    // Array of trivially copyable elements within a payload. The elements may be unaligned and are copied out on access.
+    template <typename T>
+    class UnalignedArrayView
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+    public:
+        UnalignedArrayView() = default;
+        UnalignedArrayView(const uint8_t* data, size_t size)
+            : m_data(data)
+            , m_size(size)
+        {
+        }
+
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        T operator[](size_t index) const
+        {
+            T value;
+            std::memcpy(&value, m_data + index * sizeof(T), sizeof(T));
+            return value;
+        }
+
+        std::span<const uint8_t> GetBytes() const
+        {
+            return {m_data, m_size * sizeof(T)};
+        }
+
+    private:
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    // Reads the fields of a payload in order, in place. Reading past the end of the payload fails this read and all following
+    // ones, so a handler can read all fields and check IsValid once.
+    class PayloadReader
+    {
+    public:
+        explicit PayloadReader(std::span<const uint8_t> payload)
+            : m_remaining(payload)
+        {
+        }
+
+        template <typename T>
+        bool Read(T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const uint8_t* data = Consume(sizeof(T));
+            if (!data)
+            {
+                return false;
+            }
+            std::memcpy(&value, data, sizeof(T));
+            return true;
+        }
+
+        // Reads bytes written by MessageWriter::WriteBytes.
+        bool ReadBytes(std::span<const uint8_t>& bytes);
+
+        // Reads a string written by MessageWriter::WriteString. The text is not null terminated.
+        bool ReadString(std::string_view& text);
+
+        // Reads the rest of the payload, e.g. bytes written by MessageWriter::WriteRawBytes.
+        bool ReadRemaining(std::span<const uint8_t>& bytes);
+
+        // Reads an array written by MessageWriter::WriteArray.
+        template <typename T>
+        bool ReadArray(UnalignedArrayView<T>& values)
+        {
+            uint32_t count = 0;
+            if (!Read(count) || count > m_remaining.size() / sizeof(T))
+            {
+                return Fail();
+            }
+            values = UnalignedArrayView<T>(Consume(count * sizeof(T)), count);
+            return true;
+        }
+
+        bool IsValid() const
+        {
+            return m_valid;
+        }
+
+        size_t GetRemainingSize() const
+        {
+            return m_remaining.size();
+        }
+
+    private:
+        const uint8_t* Consume(size_t size);
+        bool Fail();
+
+        std::span<const uint8_t> m_remaining;
+        bool m_valid = true;
+    };
+
+    // Appends messages to a packet. The packet is not cleared, so that several messages can be sent in one packet and the
+    // capacity of the packet is reused between sends.
+    class MessageWriter
+    {
+    public:
+        explicit MessageWriter(std::vector<uint8_t>& packet)
+            : m_packet(packet)
+        {
+        }
+
+        // Starts a message, the payload is written by the following Write calls until EndMessage. The flags tell how the
+        // payload is encoded.
+        void BeginMessage(MessageType type, uint8_t flags = 0);
+        void EndMessage();
+
+        // Appends a message with an empty payload.
+        void WriteMessage(MessageType type)
+        {
+            BeginMessage(type);
+            EndMessage();
+        }
+
+        template <typename T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Append(&value, sizeof(T));
+        }
+
+        // Writes a uint32 size followed by the bytes.
+        void WriteBytes(std::span<const uint8_t> bytes);
+        void WriteString(std::string_view text);
+
+        // Writes the bytes without a size, for data which takes up the rest of the payload. Can be called repeatedly to gather
+        // the data from several buffers.
+        void WriteRawBytes(std::span<const uint8_t> bytes)
+        {
+            Append(bytes.data(), bytes.size());
+        }
+
+        // Writes a uint32 element count followed by the elements.
+        template <typename T>
+        void WriteArray(std::span<const T> values)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Write(static_cast<uint32_t>(values.size()));
+            Append(values.data(), values.size_bytes());
+        }
+
+    private:
+        void Append(const void* data, size_t size);
+
+        std::vector<uint8_t>& m_packet;
+        size_t m_messageStart = 0;
+    };
+
+    // Dispatch table from message types to handlers. Handlers are indexed by type, so that dispatching a message is one table
+    // lookup. Types are expected to be dense, the table grows to the largest registered type.
+    class MessageDispatcher
+    {
+    public:
+        using Handler = std::function<void(const MessageView& message)>;
+
+        struct DispatchResult
+        {
+            uint32_t dispatchedCount = 0;
+            // Messages of types without a handler.
+            uint32_t unhandledCount = 0;
+            // End, or the error which stopped parsing the packet.
+            ReadStatus status = ReadStatus::End;
+        };
+
+        // Replaces the handler of the type. An empty handler unregisters it.
+        void Register(MessageType type, Handler handler);
+
+        bool IsRegistered(MessageType type) const;
+
+        // Calls the handlers of all messages of the packet, in order.
+        DispatchResult Dispatch(std::span<const uint8_t> packet) const;
+
+    private:
+        std::vector<Handler> m_handlers;
+    };
+} // namespace DataChannel
@@ -0,0 +1,256 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <DataChannelScheduler.h>
+
+#include <algorithm>
+
+namespace
+{
+    // Buffers kept for reuse by Enqueue. Only buffers of up to a packet are kept, larger messages are rare.
+    constexpr size_t MaxFreeBufferCount = 256;
+} // namespace
+
+namespace DataChannel
+{
+    MessageScheduler::MessageScheduler(IPacketTransport& transport, Clock::time_point now, const SchedulerSettings& settings)
+        : m_transport(transport)
+        , m_settings(settings)
+        , m_lastService(now)
+        , m_drainRate(settings.initialRate)
+        , m_rate(settings.initialRate)
+    {
+        m_packet.reserve(m_settings.maxPacketSize);
+    }
+
+    EnqueueResult MessageScheduler::Enqueue(
+        TrafficClass trafficClass, std::span<const uint8_t> messages, Clock::time_point now, uint64_t coalescingKey)
+    {
+        return Enqueue(trafficClass, messages, now, coalescingKey, false);
+    }
+
+    EnqueueResult MessageScheduler::EnqueuePacket(TrafficClass trafficClass, std::span<const uint8_t> packet, Clock::time_point now)
+    {
+        return Enqueue(trafficClass, packet, now, NoCoalescing, true);
+    }
+
+    EnqueueResult MessageScheduler::Enqueue(
+        TrafficClass trafficClass, std::span<const uint8_t> messages, Clock::time_point now, uint64_t coalescingKey, bool ownPacket)
+    {
+        const TrafficClassSettings& settings = m_settings.classes[static_cast<size_t>(trafficClass)];
+        ClassQueue& queue = m_classes[static_cast<size_t>(trafficClass)];
+        ++queue.statistics.enqueuedCount;
+
+        // The latest state replaces the queued one in place, so that it keeps the place of the state in the queue.
+        if (coalescingKey != NoCoalescing)
+        {
+            for (QueuedMessages& queued : queue.messages)
+            {
+                if (queued.coalescingKey == coalescingKey)
+                {
+                    if (queue.queuedBytes - queued.bytes.size() + messages.size() > settings.byteBudget)
+                    {
+                        break;
+                    }
+                    queue.queuedBytes = queue.queuedBytes - queued.bytes.size() + messages.size();
+                    queued.bytes.assign(messages.begin(), messages.end());
+                    ++queue.statistics.coalescedCount;
+                    return EnqueueResult::Coalesced;
+                }
+            }
+        }
+
+        if (settings.overflowPolicy == OverflowPolicy::DropOldest && messages.size() <= settings.byteBudget)
+        {
+            while (queue.queuedBytes + messages.size() > settings.byteBudget)
+            {
+                PopFront(queue);
+                ++queue.statistics.droppedCount;
+            }
+        }
+        if (queue.queuedBytes + messages.size() > settings.byteBudget)
+        {
+            ++queue.statistics.rejectedCount;
+            return EnqueueResult::Rejected;
+        }
+
+        std::vector<uint8_t> bytes;
+        if (!m_freeBuffers.empty())
+        {
+            bytes = std::move(m_freeBuffers.back());
+            m_freeBuffers.pop_back();
+        }
+        bytes.assign(messages.begin(), messages.end());
+
+        queue.messages.push_back({std::move(bytes), coalescingKey, now, ownPacket});
+        queue.queuedBytes += messages.size();
+        return EnqueueResult::Queued;
+    }
+
+    void MessageScheduler::Service(Clock::time_point now, size_t channelSendQueueSize)
+    {
+        UpdateRate(now, channelSendQueueSize);
+
+        for (TrafficClass trafficClass = SelectClass(); trafficClass != TrafficClass::Count; trafficClass = SelectClass())
+        {
+            ClassQueue& queue = m_classes[static_cast<size_t>(trafficClass)];
+            QueuedMessages& messages = queue.messages.front();
+
+            if (!m_packet.empty() && (messages.ownPacket || m_packet.size() + messages.bytes.size() > m_settings.maxPacketSize))
+            {
+                SendPacket();
+            }
+            m_packet.insert(m_packet.end(), messages.bytes.begin(), messages.bytes.end());
+            const bool ownPacket = messages.ownPacket;
+
+            const Clock::duration queueDelay = now - messages.enqueueTime;
+            queue.statistics.totalQueueDelay += queueDelay;
+            queue.statistics.maxQueueDelay = std::max(queue.statistics.maxQueueDelay, queueDelay);
+            ++queue.statistics.sentCount;
+            queue.statistics.sentBytes += messages.bytes.size();
+
+            m_tokens -= static_cast<double>(messages.bytes.size());
+            if (trafficClass != TrafficClass::Critical)
+            {
+                queue.deficit -= static_cast<int64_t>(messages.bytes.size());
+            }
+            PopFront(queue);
+
+            if (ownPacket)
+            {
+                SendPacket();
+            }
+        }
+
+        if (!m_packet.empty())
+        {
+            SendPacket();
+        }
+    }
+
+    void MessageScheduler::Clear()
+    {
+        for (ClassQueue& queue : m_classes)
+        {
+            while (!queue.messages.empty())
+            {
+                PopFront(queue);
+            }
+            queue.deficit = 0;
+        }
+        m_packet.clear();
+    }
+
+    void MessageScheduler::UpdateRate(Clock::time_point now, size_t channelSendQueueSize)
+    {
+        const double elapsed = std::chrono::duration<double>(now - m_lastService).count();
+        if (elapsed <= 0.0)
+        {
+            return;
+        }
+
+        // What left the channel's send queue since the last call. While the queue does not run empty, this is what the channel
+        // can drain. Once it runs empty, the channel could have drained more, and the measurement only raises the estimate.
+        const double drained =
+            static_cast<double>(m_lastChannelQueueSize + m_sentSinceLastService) - static_cast<double>(channelSendQueueSize);
+        const double measuredRate = std::max(drained, 0.0) / elapsed;
+        const double smoothedRate = m_drainRate + m_settings.drainRateSmoothing * (measuredRate - m_drainRate);
+        if (channelSendQueueSize > 0)
+        {
+            m_drainRate = smoothedRate;
+        }
+        else
+        {
+            m_drainRate = std::max(m_drainRate, smoothedRate);
+        }
+
+        const double targetQueueDelay = std::chrono::duration<double>(m_settings.targetQueueDelay).count();
+        const double targetQueueSize = std::max(m_drainRate * targetQueueDelay, static_cast<double>(m_settings.minTargetQueueSize));
+        const bool aboveTarget = static_cast<double>(channelSendQueueSize) > targetQueueSize;
+        const double factor = aboveTarget ? m_settings.backoffFactor : m_settings.probeFactor;
+        m_rate = std::clamp(m_drainRate * factor, m_settings.minRate, m_settings.maxRate);
+
+        const double burstDuration = std::chrono::duration<double>(m_settings.burstDuration).count();
+        const double burst = std::max(m_rate * burstDuration, static_cast<double>(m_settings.maxPacketSize));
+        m_tokens = std::min(m_tokens + m_rate * elapsed, burst);
+
+        m_lastService = now;
+        m_lastChannelQueueSize = channelSendQueueSize;
+        m_sentSinceLastService = 0;
+    }
+
+    TrafficClass MessageScheduler::SelectClass()
+    {
+        if (!m_classes[static_cast<size_t>(TrafficClass::Critical)].messages.empty())
+        {
+            return TrafficClass::Critical;
+        }
+
+        const auto isEmpty = [this](TrafficClass trafficClass) {
+            return m_classes[static_cast<size_t>(trafficClass)].messages.empty();
+        };
+        if (m_tokens <= 0.0 || (isEmpty(TrafficClass::Interactive) && isEmpty(TrafficClass::Bulk)))
+        {
+            return TrafficClass::Count;
+        }
+
+        // Deficit round robin: each visit of a class adds its weight times a packet to its deficit, and the class sends while its
+        // next messages fit into the deficit. An empty class loses its deficit, so that it can not save up for a burst.
+        while (true)
+        {
+            ClassQueue& queue = m_classes[static_cast<size_t>(m_roundRobinClass)];
+            if (queue.messages.empty())
+            {
+                queue.deficit = 0;
+            }
+            else
+            {
+                if (!m_roundRobinQuantumAdded)
+                {
+                    const uint32_t weight = m_settings.classes[static_cast<size_t>(m_roundRobinClass)].weight;
+                    queue.deficit += static_cast<int64_t>(weight * m_settings.maxPacketSize);
+                    m_roundRobinQuantumAdded = true;
+                }
+                if (static_cast<int64_t>(queue.messages.front().bytes.size()) <= queue.deficit)
+                {
+                    return m_roundRobinClass;
+                }
+            }
+
+            m_roundRobinClass = m_roundRobinClass == TrafficClass::Interactive ? TrafficClass::Bulk : TrafficClass::Interactive;
+            m_roundRobinQuantumAdded = false;
+        }
+    }
+
+    void MessageScheduler::PopFront(ClassQueue& queue)
+    {
+        QueuedMessages& messages = queue.messages.front();
+        queue.queuedBytes -= messages.bytes.size();
+        if (m_freeBuffers.size() < MaxFreeBufferCount && messages.bytes.capacity() <= m_settings.maxPacketSize)
+        {
+            m_freeBuffers.push_back(std::move(messages.bytes));
+        }
+        queue.messages.pop_front();
+    }
+
+    void MessageScheduler::SendPacket()
+    {
+        if (m_transport.SendPacket(m_packet, m_settings.guaranteedDelivery))
+        {
+            m_sentSinceLastService += m_packet.size();
+        }
+        else
+        {
+            ++m_failedPacketCount;
+        }
+        m_packet.clear();
+    }
+} // namespace DataChannel
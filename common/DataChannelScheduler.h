@@ -0,0 +1,243 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <DataChannelBatcher.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+namespace DataChannel
+{
+    enum class TrafficClass : uint8_t
+    {
+        // Pose and input state. Sent ahead of all other traffic and not held back by the shaper.
+        Critical,
+        // Messages a user waits for, e.g. pings and annotations.
+        Interactive,
+        // Large transfers, e.g. meshes, sent with the bandwidth left over.
+        Bulk,
+
+        Count
+    };
+
+    constexpr size_t TrafficClassCount = static_cast<size_t>(TrafficClass::Count);
+
+    enum class OverflowPolicy : uint8_t
+    {
+        // A message which does not fit into the byte budget of its class is rejected.
+        RejectNewest,
+        // The oldest messages of the class are dropped to make room, for streams of which only recent messages matter.
+        DropOldest
+    };
+
+    struct TrafficClassSettings
+    {
+        // Bytes which may be queued in the class.
+        size_t byteBudget;
+        OverflowPolicy overflowPolicy;
+        // Share of the bandwidth left over by the critical class, relative to the other classes. Unused for Critical.
+        uint32_t weight;
+    };
+
+    struct SchedulerSettings
+    {
+        std::array<TrafficClassSettings, TrafficClassCount> classes = {{
+            {64 * 1024, OverflowPolicy::DropOldest, 1},
+            {256 * 1024, OverflowPolicy::RejectNewest, 3},
+            {1024 * 1024, OverflowPolicy::RejectNewest, 1},
+        }};
+
+        // Queued messages are combined into packets of up to this size.
+        size_t maxPacketSize = 1200;
+
+        // Send queue of the channel the shaper aims for, as time to drain it, and at least minTargetQueueSize. Below it, the
+        // shaper probes for more bandwidth by sending faster than the channel drains. Above it, the shaper sends slower than the
+        // channel drains until the queue is back at target. This bounds the time a critical message waits in the channel.
+        std::chrono::microseconds targetQueueDelay{10000};
+        size_t minTargetQueueSize = 4 * 1200;
+        double probeFactor = 1.25;
+        double backoffFactor = 0.8;
+
+        // Shaper rate at start and its limits, in bytes per second.
+        double initialRate = 1024 * 1024;
+        double minRate = 16 * 1024;
+        double maxRate = 256 * 1024 * 1024;
+
+        // Weight of a new drain rate measurement in its moving average.
+        double drainRateSmoothing = 0.25;
+
+        // Burst allowed by the token bucket, as time at the shaper rate.
+        std::chrono::microseconds burstDuration{10000};
+
+        bool guaranteedDelivery = true;
+    };
+
+    enum class EnqueueResult
+    {
+        Queued,
+        // Replaced the queued message with the same coalescing key.
+        Coalesced,
+        // Did not fit into the byte budget of the class.
+        Rejected
+    };
+
+    struct TrafficClassStatistics
+    {
+        uint64_t enqueuedCount = 0;
+        uint64_t coalescedCount = 0;
+        uint64_t rejectedCount = 0;
+        uint64_t droppedCount = 0;
+        uint64_t sentCount = 0;
+        uint64_t sentBytes = 0;
+
+        // Time from enqueueing to sending.
+        std::chrono::steady_clock::duration totalQueueDelay{0};
+        std::chrono::steady_clock::duration maxQueueDelay{0};
+    };
+
+    // Outbound queue of the data channel with one queue per traffic class. Critical messages are sent first, the interactive
+    // and bulk classes share the remaining bandwidth by weight (deficit round robin), so bulk transfers neither starve the
+    // other classes nor are starved by them. Each class has a byte budget with an overflow policy, and state messages can
+    // coalesce: a message with the coalescing key of a queued one replaces it, so that only the latest state is sent.
+    //
+    // A token bucket shapes the sending to the rate at which the channel drains its send queue, which is estimated from the
+    // send queue sizes passed to Service. This keeps the channel's queue short, so that newly queued critical messages are not
+    // stuck behind earlier bulk data. Critical messages are sent regardless of tokens, but consume them.
+    //
+    // Sending happens only within Service, the owner calls it regularly (e.g. every frame). Not thread-safe.
+    class MessageScheduler
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr uint64_t NoCoalescing = 0;
+
+        MessageScheduler(IPacketTransport& transport, Clock::time_point now, const SchedulerSettings& settings = {});
+
+        MessageScheduler(const MessageScheduler&) = delete;
+        MessageScheduler& operator=(const MessageScheduler&) = delete;
+
+        // Queues one or more encoded messages, e.g. a packet written by MessageWriter. They are sent together, in order.
+        EnqueueResult Enqueue(
+            TrafficClass trafficClass, std::span<const uint8_t> messages, Clock::time_point now, uint64_t coalescingKey = NoCoalescing);
+
+        // Queues bytes which are sent as a packet of their own instead of being combined with other messages, e.g. the answer to
+        // a peer which does not parse the message protocol.
+        EnqueueResult EnqueuePacket(TrafficClass trafficClass, std::span<const uint8_t> packet, Clock::time_point now);
+
+        // Updates the drain rate estimate from the current send queue size of the channel, and sends the queued messages the
+        // token bucket allows.
+        void Service(Clock::time_point now, size_t channelSendQueueSize);
+
+        // Drops all queued messages, e.g. when the channel was closed.
+        void Clear();
+
+        size_t GetQueuedBytes(TrafficClass trafficClass) const
+        {
+            return m_classes[static_cast<size_t>(trafficClass)].queuedBytes;
+        }
+
+        // Current rate of the shaper and estimated drain rate of the channel, in bytes per second.
+        double GetRate() const
+        {
+            return m_rate;
+        }
+
+        double GetDrainRate() const
+        {
+            return m_drainRate;
+        }
+
+        const TrafficClassStatistics& GetStatistics(TrafficClass trafficClass) const
+        {
+            return m_classes[static_cast<size_t>(trafficClass)].statistics;
+        }
+
+        // Packets the transport did not send. Their messages are dropped.
+        uint64_t GetFailedPacketCount() const
+        {
+            return m_failedPacketCount;
+        }
+
+    private:
+        struct QueuedMessages
+        {
+            std::vector<uint8_t> bytes;
+            uint64_t coalescingKey;
+            Clock::time_point enqueueTime;
+            bool ownPacket;
+        };
+
+        struct ClassQueue
+        {
+            std::deque<QueuedMessages> messages;
+            size_t queuedBytes = 0;
+            // Bytes the class may send in the current deficit round robin round.
+            int64_t deficit = 0;
+            TrafficClassStatistics statistics;
+        };
+
+        void UpdateRate(Clock::time_point now, size_t channelSendQueueSize);
+        // Class to send from next, or TrafficClass::Count if none may send.
+        TrafficClass SelectClass();
+        EnqueueResult Enqueue(
+            TrafficClass trafficClass, std::span<const uint8_t> messages, Clock::time_point now, uint64_t coalescingKey, bool ownPacket);
+        void PopFront(ClassQueue& queue);
+        void SendPacket();
+
+        IPacketTransport& m_transport;
+        const SchedulerSettings m_settings;
+
+        std::array<ClassQueue, TrafficClassCount> m_classes;
+        TrafficClass m_roundRobinClass = TrafficClass::Interactive;
+        bool m_roundRobinQuantumAdded = false;
+        // Storage of sent messages, reused by Enqueue.
+        std::vector<std::vector<uint8_t>> m_freeBuffers;
+
+        std::vector<uint8_t> m_packet;
+        uint64_t m_failedPacketCount = 0;
+
+        Clock::time_point m_lastService;
+        size_t m_lastChannelQueueSize = 0;
+        size_t m_sentSinceLastService = 0;
+        double m_drainRate;
+        double m_rate;
+        double m_tokens = 0.0;
+    };
+
+    // Transport which queues the packets given to it in one class of a scheduler, e.g. the packets of a MessageBatcher.
+    // The scheduler sends them with its own guaranteedDelivery setting.
+    class ScheduledTransport : public IPacketTransport
+    {
+    public:
+        ScheduledTransport(MessageScheduler& scheduler, TrafficClass trafficClass)
+            : m_scheduler(scheduler)
+            , m_trafficClass(trafficClass)
+        {
+        }
+
+        bool SendPacket(std::span<const uint8_t> packet, bool) override
+        {
+            return m_scheduler.Enqueue(m_trafficClass, packet, MessageScheduler::Clock::now()) != EnqueueResult::Rejected;
+        }
+
+    private:
+        MessageScheduler& m_scheduler;
+        const TrafficClass m_trafficClass;
+    };
+} // namespace DataChannel
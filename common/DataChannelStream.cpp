@@ -0,0 +1,398 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <DataChannelStream.h>
+
+#include <algorithm>
+
+namespace DataChannel
+{
+    StreamSender::StreamSender(IPacketTransport& transport, const StreamSenderSettings& settings, PayloadCompressor* compressor)
+        : m_transport(transport)
+        , m_settings(settings)
+        , m_compressor(compressor)
+    {
+        m_packet.reserve(MessageHeaderSize + StreamChunkHeaderSize + m_settings.chunkSize);
+    }
+
+    uint32_t StreamSender::Send(
+        MessageType contentType, std::span<const std::span<const uint8_t>> segments, StreamProgressHandler progressHandler)
+    {
+        OutgoingStream& stream = m_streams.emplace_back();
+        stream.id = m_nextStreamId++;
+        stream.contentType = contentType;
+        stream.totalBytes = 0;
+        for (const std::span<const uint8_t>& segment : segments)
+        {
+            // empty segments are skipped, so that every segment the chunks are gathered from has data
+            if (!segment.empty())
+            {
+                stream.segments.push_back(segment);
+                stream.totalBytes += segment.size();
+            }
+        }
+        stream.progressHandler = std::move(progressHandler);
+        return stream.id;
+    }
+
+    bool StreamSender::Cancel(uint32_t streamId)
+    {
+        const auto it = std::find_if(m_streams.begin(), m_streams.end(), [streamId](const OutgoingStream& stream) {
+            return stream.id == streamId;
+        });
+        if (it == m_streams.end())
+        {
+            return false;
+        }
+
+        // A receiver which did not get the StreamBegin does not know the stream.
+        if (it->beginSent)
+        {
+            m_pendingCancels.push_back(streamId);
+        }
+        const OutgoingStream stream = std::move(*it);
+        if (static_cast<size_t>(it - m_streams.begin()) < m_nextStream)
+        {
+            --m_nextStream;
+        }
+        m_streams.erase(it);
+        ReportProgress(stream, StreamState::Cancelled);
+        return true;
+    }
+
+    void StreamSender::Clear()
+    {
+        std::vector<OutgoingStream> streams = std::move(m_streams);
+        m_streams.clear();
+        m_pendingCancels.clear();
+        m_nextStream = 0;
+        for (const OutgoingStream& stream : streams)
+        {
+            ReportProgress(stream, StreamState::Cancelled);
+        }
+    }
+
+    size_t StreamSender::Pump(size_t maxBytes)
+    {
+        size_t sentBytes = 0;
+
+        // Cancellations go first, so that the receiver frees the buffers of cancelled streams early.
+        while (!m_pendingCancels.empty() && sentBytes < maxBytes)
+        {
+            m_packet.clear();
+            m_writer.BeginMessage(MessageType::StreamCancel);
+            m_writer.Write(m_pendingCancels.front());
+            m_writer.EndMessage();
+            if (!m_transport.SendPacket(m_packet, m_settings.guaranteedDelivery))
+            {
+                return sentBytes;
+            }
+            sentBytes += m_packet.size();
+            m_pendingCancels.erase(m_pendingCancels.begin());
+        }
+
+        while (!m_streams.empty() && sentBytes < maxBytes)
+        {
+            if (m_nextStream >= m_streams.size())
+            {
+                m_nextStream = 0;
+            }
+            OutgoingStream& stream = m_streams[m_nextStream];
+
+            m_packet.clear();
+            const size_t chunkSize = WriteNextMessage(stream);
+            if (!m_transport.SendPacket(m_packet, m_settings.guaranteedDelivery))
+            {
+                return sentBytes;
+            }
+            sentBytes += m_packet.size();
+
+            if (!stream.beginSent)
+            {
+                stream.beginSent = true;
+            }
+            else
+            {
+                AdvanceSegments(stream, chunkSize);
+                stream.sentBytes += chunkSize;
+                ++stream.nextSequence;
+            }
+
+            if (stream.sentBytes == stream.totalBytes)
+            {
+                const OutgoingStream completed = std::move(stream);
+                m_streams.erase(m_streams.begin() + m_nextStream);
+                ReportProgress(completed, StreamState::Completed);
+            }
+            else
+            {
+                ReportProgress(stream, StreamState::InProgress);
+                ++m_nextStream;
+            }
+        }
+        return sentBytes;
+    }
+
+    size_t StreamSender::WriteNextMessage(const OutgoingStream& stream)
+    {
+        if (!stream.beginSent)
+        {
+            m_writer.BeginMessage(MessageType::StreamBegin);
+            m_writer.Write(stream.id);
+            m_writer.Write(stream.contentType);
+            m_writer.Write(m_settings.chunkSize);
+            m_writer.Write(stream.totalBytes);
+            m_writer.EndMessage();
+            return 0;
+        }
+
+        const size_t chunkSize = static_cast<size_t>(std::min<uint64_t>(m_settings.chunkSize, stream.totalBytes - stream.sentBytes));
+        if (!m_compressor)
+        {
+            // The bytes of the chunk are written after the header fields, which is the end of m_packet.
+            m_writer.BeginMessage(MessageType::StreamChunk);
+            m_writer.Write(stream.id);
+            m_writer.Write(stream.nextSequence);
+            GatherChunk(stream, chunkSize, m_packet);
+            m_writer.EndMessage();
+            return chunkSize;
+        }
+
+        const uint32_t fields[] = {stream.id, stream.nextSequence};
+        const uint8_t* fieldBytes = reinterpret_cast<const uint8_t*>(fields);
+        m_chunk.assign(fieldBytes, fieldBytes + StreamChunkHeaderSize);
+        GatherChunk(stream, chunkSize, m_chunk);
+
+        m_encodedChunk.clear();
+        const PayloadCodec codec = m_compressor->Compress(stream.contentType, m_chunk, m_encodedChunk);
+        m_writer.BeginMessage(MessageType::StreamChunk, static_cast<uint8_t>(codec));
+        m_writer.WriteRawBytes(codec != PayloadCodec::None ? m_encodedChunk : m_chunk);
+        m_writer.EndMessage();
+        return chunkSize;
+    }
+
+    void StreamSender::GatherChunk(const OutgoingStream& stream, size_t size, std::vector<uint8_t>& output) const
+    {
+        size_t segmentIndex = stream.segmentIndex;
+        size_t segmentOffset = stream.segmentOffset;
+        for (size_t remaining = size; remaining > 0;)
+        {
+            const std::span<const uint8_t> segment = stream.segments[segmentIndex];
+            const size_t gathered = std::min(remaining, segment.size() - segmentOffset);
+            output.insert(output.end(), segment.begin() + segmentOffset, segment.begin() + segmentOffset + gathered);
+            remaining -= gathered;
+            segmentOffset += gathered;
+            if (segmentOffset == segment.size())
+            {
+                ++segmentIndex;
+                segmentOffset = 0;
+            }
+        }
+    }
+
+    void StreamSender::AdvanceSegments(OutgoingStream& stream, size_t size)
+    {
+        while (size > 0)
+        {
+            const size_t advance = std::min(size, stream.segments[stream.segmentIndex].size() - stream.segmentOffset);
+            size -= advance;
+            stream.segmentOffset += advance;
+            if (stream.segmentOffset == stream.segments[stream.segmentIndex].size())
+            {
+                ++stream.segmentIndex;
+                stream.segmentOffset = 0;
+            }
+        }
+    }
+
+    void StreamSender::ReportProgress(const OutgoingStream& stream, StreamState state)
+    {
+        if (stream.progressHandler)
+        {
+            stream.progressHandler({stream.id, stream.contentType, stream.sentBytes, stream.totalBytes, state});
+        }
+    }
+
+    StreamReceiver::StreamReceiver(
+        CompletionHandler completionHandler, StreamProgressHandler progressHandler, const StreamReceiverSettings& settings)
+        : m_completionHandler(std::move(completionHandler))
+        , m_progressHandler(std::move(progressHandler))
+        , m_settings(settings)
+    {
+    }
+
+    void StreamReceiver::Register(MessageDispatcher& dispatcher)
+    {
+        for (MessageType type : {MessageType::StreamBegin, MessageType::StreamChunk, MessageType::StreamCancel})
+        {
+            dispatcher.Register(type, [this](const MessageView& message) { HandleMessage(message); });
+        }
+    }
+
+    bool StreamReceiver::HandleMessage(const MessageView& message)
+    {
+        switch (message.type)
+        {
+        case MessageType::StreamBegin:
+            OnBegin(message);
+            return true;
+        case MessageType::StreamChunk:
+            OnChunk(message);
+            return true;
+        case MessageType::StreamCancel:
+            OnCancel(message);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool StreamReceiver::Cancel(uint32_t streamId)
+    {
+        const auto it = m_streams.find(streamId);
+        if (it == m_streams.end())
+        {
+            return false;
+        }
+        const IncomingStream stream = std::move(it->second);
+        m_streams.erase(it);
+        ++m_statistics.cancelledCount;
+        ReportProgress(streamId, stream, StreamState::Cancelled);
+        return true;
+    }
+
+    void StreamReceiver::Clear()
+    {
+        while (!m_streams.empty())
+        {
+            Cancel(m_streams.begin()->first);
+        }
+    }
+
+    void StreamReceiver::OnBegin(const MessageView& message)
+    {
+        uint32_t streamId = 0;
+        MessageType contentType{};
+        uint32_t chunkSize = 0;
+        uint64_t totalSize = 0;
+        PayloadReader reader(message.payload);
+        reader.Read(streamId);
+        reader.Read(contentType);
+        reader.Read(chunkSize);
+        reader.Read(totalSize);
+
+        // A stream id which is still in use belongs to a stream the sender gave up on.
+        Cancel(streamId);
+
+        const uint64_t chunkCount = chunkSize > 0 ? (totalSize + chunkSize - 1) / chunkSize : 0;
+        if (!reader.IsValid() || chunkSize == 0 || totalSize > m_settings.maxStreamSize ||
+            chunkCount > std::numeric_limits<uint32_t>::max() || m_streams.size() >= m_settings.maxActiveStreamCount)
+        {
+            ++m_statistics.rejectedCount;
+            return;
+        }
+
+        IncomingStream& stream = m_streams[streamId];
+        stream.contentType = contentType;
+        stream.chunkSize = chunkSize;
+        stream.payload.resize(static_cast<size_t>(totalSize));
+        stream.receivedChunks.resize(static_cast<size_t>(chunkCount));
+        if (chunkCount == 0)
+        {
+            Complete(streamId);
+        }
+    }
+
+    void StreamReceiver::OnChunk(const MessageView& message)
+    {
+        std::span<const uint8_t> payload;
+        if (!DecodePayload(message, m_decodedChunk, payload))
+        {
+            ++m_statistics.ignoredChunkCount;
+            return;
+        }
+
+        uint32_t streamId = 0;
+        uint32_t sequence = 0;
+        std::span<const uint8_t> bytes;
+        PayloadReader reader(payload);
+        reader.Read(streamId);
+        reader.Read(sequence);
+        reader.ReadRemaining(bytes);
+
+        const auto it = reader.IsValid() ? m_streams.find(streamId) : m_streams.end();
+        if (it == m_streams.end())
+        {
+            ++m_statistics.ignoredChunkCount;
+            return;
+        }
+
+        IncomingStream& stream = it->second;
+        if (sequence >= stream.receivedChunks.size() || stream.receivedChunks[sequence])
+        {
+            ++m_statistics.ignoredChunkCount;
+            return;
+        }
+        const uint64_t offset = uint64_t(sequence) * stream.chunkSize;
+        if (bytes.size() != std::min<uint64_t>(stream.chunkSize, stream.payload.size() - offset))
+        {
+            ++m_statistics.ignoredChunkCount;
+            return;
+        }
+
+        std::copy(bytes.begin(), bytes.end(), stream.payload.begin() + static_cast<ptrdiff_t>(offset));
+        stream.receivedChunks[sequence] = true;
+        ++stream.receivedChunkCount;
+        stream.receivedBytes += bytes.size();
+
+        if (stream.receivedChunkCount == stream.receivedChunks.size())
+        {
+            Complete(streamId);
+        }
+        else
+        {
+            ReportProgress(streamId, stream, StreamState::InProgress);
+        }
+    }
+
+    void StreamReceiver::OnCancel(const MessageView& message)
+    {
+        uint32_t streamId = 0;
+        PayloadReader reader(message.payload);
+        if (reader.Read(streamId))
+        {
+            Cancel(streamId);
+        }
+    }
+
+    void StreamReceiver::Complete(uint32_t streamId)
+    {
+        const auto it = m_streams.find(streamId);
+        IncomingStream stream = std::move(it->second);
+        m_streams.erase(it);
+        ++m_statistics.completedCount;
+
+        ReportProgress(streamId, stream, StreamState::Completed);
+        if (m_completionHandler)
+        {
+            m_completionHandler(streamId, stream.contentType, std::move(stream.payload));
+        }
+    }
+
+    void StreamReceiver::ReportProgress(uint32_t streamId, const IncomingStream& stream, StreamState state)
+    {
+        if (m_progressHandler)
+        {
+            m_progressHandler({streamId, stream.contentType, stream.receivedBytes, stream.payload.size(), state});
+        }
+    }
+} // namespace DataChannel
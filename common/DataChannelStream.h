@@ -0,0 +1,238 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <DataChannelBatcher.h>
+#include <DataChannelCompression.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Transfer of payloads of any size over the custom data channel, e.g. spatial mesh snapshots or textures. A stream is split
+// into sequence-numbered chunks of one packet each, so that its chunks interleave with other streams and, through a
+// MessageScheduler, with other traffic instead of blocking the channel for the whole transfer.
+//
+// A stream is a StreamBegin message with the size of the payload, followed by StreamChunk messages, and is aborted by a
+// StreamCancel message:
+//   StreamBegin:  uint32 streamId, MessageType contentType, uint32 chunkSize, uint64 totalSize
+//   StreamChunk:  uint32 streamId, uint32 sequence, the bytes of the chunk up to the end of the payload
+//   StreamCancel: uint32 streamId
+// Chunk n holds the bytes at n * chunkSize. All chunks are chunkSize long, except for the last one. Chunks may be compressed,
+// keyed by the content type of their stream.
+namespace DataChannel
+{
+    // Size of the fields in front of the bytes of a StreamChunk.
+    constexpr size_t StreamChunkHeaderSize = 8;
+
+    enum class StreamState
+    {
+        InProgress,
+        Completed,
+        Cancelled
+    };
+
+    struct StreamProgress
+    {
+        uint32_t streamId;
+        MessageType contentType;
+        // Sent bytes on the sender, received bytes on the receiver.
+        uint64_t transferredBytes;
+        uint64_t totalBytes;
+        StreamState state;
+    };
+
+    using StreamProgressHandler = std::function<void(const StreamProgress& progress)>;
+
+    struct StreamSenderSettings
+    {
+        // Bytes per chunk, chosen so that a chunk message fills a packet of BatcherSettings::maxPacketSize.
+        uint32_t chunkSize = 1200 - MessageHeaderSize - StreamChunkHeaderSize;
+
+        bool guaranteedDelivery = true;
+    };
+
+    // Sends streams from caller-owned memory. The payload is not copied up front: each chunk is gathered from the segments of
+    // the payload when it is handed to the transport, so the memory has to stay valid and unchanged until the stream completed
+    // or was cancelled.
+    //
+    // Sending happens only within Pump, which hands the chunks of the active streams to the transport in turn until the
+    // transport rejects a packet, e.g. because the class of a ScheduledTransport is full. The owner calls it regularly (e.g.
+    // every frame). Not thread-safe.
+    class StreamSender
+    {
+    public:
+        // Chunks are compressed with the compressor, if given.
+        explicit StreamSender(
+            IPacketTransport& transport, const StreamSenderSettings& settings = {}, PayloadCompressor* compressor = nullptr);
+
+        StreamSender(const StreamSender&) = delete;
+        StreamSender& operator=(const StreamSender&) = delete;
+
+        // Starts a stream of the segments, sent back to back. The progress handler is called for every sent chunk, and once
+        // the last chunk was handed to the transport (Completed) or the stream was cancelled (Cancelled). It must not call
+        // Send or Cancel, e.g. a cancellation is done after Pump returned. Returns the stream id.
+        uint32_t Send(
+            MessageType contentType, std::span<const std::span<const uint8_t>> segments, StreamProgressHandler progressHandler = {});
+
+        uint32_t Send(MessageType contentType, std::span<const uint8_t> payload, StreamProgressHandler progressHandler = {})
+        {
+            return Send(contentType, {&payload, 1}, std::move(progressHandler));
+        }
+
+        // Stops sending the stream and tells the receiver to drop it. Returns false if the stream is not active anymore.
+        bool Cancel(uint32_t streamId);
+
+        // Cancels all streams without telling the receiver, e.g. when the channel was closed.
+        void Clear();
+
+        // Hands messages to the transport until all streams are sent, maxBytes were sent or the transport rejects a packet.
+        // Returns the number of bytes sent.
+        size_t Pump(size_t maxBytes = std::numeric_limits<size_t>::max());
+
+        size_t GetActiveStreamCount() const
+        {
+            return m_streams.size();
+        }
+
+        // True while Pump has chunks or cancellations to send.
+        bool HasPendingMessages() const
+        {
+            return !m_streams.empty() || !m_pendingCancels.empty();
+        }
+
+    private:
+        struct OutgoingStream
+        {
+            uint32_t id;
+            MessageType contentType;
+            std::vector<std::span<const uint8_t>> segments;
+            uint64_t totalBytes;
+            uint64_t sentBytes = 0;
+            uint32_t nextSequence = 0;
+            // Position of the next chunk within the segments.
+            size_t segmentIndex = 0;
+            size_t segmentOffset = 0;
+            bool beginSent = false;
+            StreamProgressHandler progressHandler;
+        };
+
+        // Writes the next message of the stream to m_packet and returns the number of payload bytes it covers.
+        size_t WriteNextMessage(const OutgoingStream& stream);
+        // Appends the next size bytes of the stream to the output.
+        void GatherChunk(const OutgoingStream& stream, size_t size, std::vector<uint8_t>& output) const;
+        void AdvanceSegments(OutgoingStream& stream, size_t size);
+        void ReportProgress(const OutgoingStream& stream, StreamState state);
+
+        IPacketTransport& m_transport;
+        const StreamSenderSettings m_settings;
+        PayloadCompressor* const m_compressor;
+
+        std::vector<OutgoingStream> m_streams;
+        // Index of the stream to send the next chunk of.
+        size_t m_nextStream = 0;
+        // Streams to send a StreamCancel for.
+        std::vector<uint32_t> m_pendingCancels;
+        uint32_t m_nextStreamId = 1;
+
+        std::vector<uint8_t> m_packet;
+        MessageWriter m_writer{m_packet};
+        // Uncompressed and compressed payload of a chunk, if compressed.
+        std::vector<uint8_t> m_chunk;
+        std::vector<uint8_t> m_encodedChunk;
+    };
+
+    struct StreamReceiverSettings
+    {
+        // Streams are reassembled in memory, larger ones are rejected.
+        uint64_t maxStreamSize = 256 * 1024 * 1024;
+        size_t maxActiveStreamCount = 16;
+    };
+
+    struct StreamReceiverStatistics
+    {
+        uint64_t completedCount = 0;
+        uint64_t cancelledCount = 0;
+        // Streams over the size or count limits, or with invalid parameters.
+        uint64_t rejectedCount = 0;
+        // Chunks of unknown or cancelled streams, duplicates and chunks which do not match their stream.
+        uint64_t ignoredChunkCount = 0;
+    };
+
+    // Reassembles received streams. The buffer of a stream is allocated at its full size when it begins, and each chunk is
+    // copied to its place once, so chunks may arrive in any order. A completed stream hands its buffer to the completion
+    // handler. Not thread-safe.
+    class StreamReceiver
+    {
+    public:
+        using CompletionHandler = std::function<void(uint32_t streamId, MessageType contentType, std::vector<uint8_t>&& payload)>;
+
+        explicit StreamReceiver(
+            CompletionHandler completionHandler, StreamProgressHandler progressHandler = {}, const StreamReceiverSettings& settings = {});
+
+        StreamReceiver(const StreamReceiver&) = delete;
+        StreamReceiver& operator=(const StreamReceiver&) = delete;
+
+        // Registers the handlers of the stream messages.
+        void Register(MessageDispatcher& dispatcher);
+
+        // Handles a stream message. Returns false for messages of other types.
+        bool HandleMessage(const MessageView& message);
+
+        // Drops a stream which is being received, its further chunks are ignored. Does not tell the sender.
+        bool Cancel(uint32_t streamId);
+
+        // Drops all streams, e.g. when the channel was closed.
+        void Clear();
+
+        size_t GetActiveStreamCount() const
+        {
+            return m_streams.size();
+        }
+
+        const StreamReceiverStatistics& GetStatistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        struct IncomingStream
+        {
+            MessageType contentType;
+            uint32_t chunkSize;
+            std::vector<uint8_t> payload;
+            std::vector<bool> receivedChunks;
+            uint32_t receivedChunkCount = 0;
+            uint64_t receivedBytes = 0;
+        };
+
+        void OnBegin(const MessageView& message);
+        void OnChunk(const MessageView& message);
+        void OnCancel(const MessageView& message);
+        void Complete(uint32_t streamId);
+        void ReportProgress(uint32_t streamId, const IncomingStream& stream, StreamState state);
+
+        CompletionHandler m_completionHandler;
+        StreamProgressHandler m_progressHandler;
+        const StreamReceiverSettings m_settings;
+
+        std::unordered_map<uint32_t, IncomingStream> m_streams;
+        // Payload of a compressed chunk.
+        std::vector<uint8_t> m_decodedChunk;
+        StreamReceiverStatistics m_statistics;
+    };
+} // namespace DataChannel
@@ -0,0 +1,393 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <FrameProfiler.h>
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FrameProfiler
+{
+    namespace Detail
+    {
+        std::atomic<bool> g_recording = false;
+    }
+
+    namespace
+    {
+        // Event ring of one thread. The thread is the only producer, the flusher (holding g_mutex) the only consumer.
+        struct ThreadBuffer
+        {
+            ThreadBuffer(size_t capacity, uint32_t id)
+                : threadId(id)
+            {
+                size_t roundedCapacity = 1;
+                while (roundedCapacity < capacity)
+                {
+                    roundedCapacity *= 2;
+                }
+
+                events = std::make_unique<Event[]>(roundedCapacity);
+                mask = roundedCapacity - 1;
+            }
+
+            std::unique_ptr<Event[]> events;
+            size_t mask = 0;
+            const uint32_t threadId;
+
+            // Written by the consumer.
+            alignas(64) std::atomic<uint64_t> read = 0;
+
+            // Written by the producer.
+            alignas(64) std::atomic<uint64_t> write = 0;
+            uint64_t cachedRead = 0;
+            std::atomic<uint64_t> dropped = 0;
+            // Set when the thread exited, after its last event.
+            std::atomic<bool> retired = false;
+
+            // Guarded by g_mutex.
+            std::string name;
+            bool nameWritten = false;
+        };
+
+        // Marks the buffer of a thread as retired when the thread exits, so the flusher releases it once it is drained.
+        struct ThreadBufferHolder
+        {
+            ~ThreadBufferHolder()
+            {
+                if (buffer)
+                {
+                    buffer->retired.store(true, std::memory_order_release);
+                }
+            }
+
+            std::shared_ptr<ThreadBuffer> buffer;
+        };
+
+        // Chrome trace_event JSON file written by Start(path).
+        struct FileSink
+        {
+            explicit FileSink(const std::filesystem::path& path)
+                : stream(path, std::ios::binary | std::ios::trunc)
+                , writer(stream)
+            {
+            }
+
+            std::ofstream stream;
+            ChromeTraceWriter writer;
+        };
+
+        std::mutex g_mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> g_buffers;
+        uint32_t g_nextThreadId = 1;
+        Settings g_settings;
+        EventSink* g_sink = nullptr;
+        std::unique_ptr<FileSink> g_fileSink;
+        // Events dropped by threads which exited during the session.
+        uint64_t g_retiredDropped = 0;
+
+        std::thread g_flusher;
+        std::condition_variable g_flusherWake;
+        bool g_stopFlusher = false;
+
+        thread_local ThreadBufferHolder t_buffer;
+
+        ThreadBuffer* RegisterThread()
+        {
+            std::lock_guard lock(g_mutex);
+            t_buffer.buffer = std::make_shared<ThreadBuffer>(g_settings.eventsPerThread, g_nextThreadId++);
+            g_buffers.push_back(t_buffer.buffer);
+            return t_buffer.buffer.get();
+        }
+
+        // Hands the events of all threads to the sink, or drops them without a sink. Called with g_mutex held.
+        void FlushLocked()
+        {
+            for (auto it = g_buffers.begin(); it != g_buffers.end();)
+            {
+                ThreadBuffer& buffer = **it;
+                const bool retired = buffer.retired.load(std::memory_order_acquire);
+
+                const uint64_t read = buffer.read.load(std::memory_order_relaxed);
+                const uint64_t write = buffer.write.load(std::memory_order_acquire);
+                if (g_sink && read != write)
+                {
+                    if (!buffer.nameWritten)
+                    {
+                        g_sink->WriteThreadName(buffer.threadId, buffer.name);
+                        buffer.nameWritten = true;
+                    }
+
+                    // The pending events wrap around the end of the ring at most once.
+                    const size_t first = static_cast<size_t>(read & buffer.mask);
+                    const size_t count = static_cast<size_t>(write - read);
+                    const size_t firstCount = std::min(count, buffer.mask + 1 - first);
+                    g_sink->WriteEvents(buffer.threadId, {buffer.events.get() + first, firstCount});
+                    if (firstCount < count)
+                    {
+                        g_sink->WriteEvents(buffer.threadId, {buffer.events.get(), count - firstCount});
+                    }
+                }
+                buffer.read.store(write, std::memory_order_release);
+
+                if (retired)
+                {
+                    g_retiredDropped += buffer.dropped.load(std::memory_order_relaxed);
+                    it = g_buffers.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        void RunFlusher()
+        {
+            std::unique_lock lock(g_mutex);
+            while (!g_stopFlusher)
+            {
+                g_flusherWake.wait_for(lock, g_settings.flushInterval, [] { return g_stopFlusher; });
+                FlushLocked();
+            }
+        }
+
+        bool StartSession(EventSink& sink, const Settings& settings, std::unique_ptr<FileSink> fileSink)
+        {
+            {
+                std::lock_guard lock(g_mutex);
+                if (g_sink)
+                {
+                    return false;
+                }
+
+                // Drop what threads recorded after the last session stopped, and name the threads again in the new session.
+                FlushLocked();
+                for (const std::shared_ptr<ThreadBuffer>& buffer : g_buffers)
+                {
+                    buffer->dropped.store(0, std::memory_order_relaxed);
+                    buffer->nameWritten = false;
+                }
+                g_retiredDropped = 0;
+
+                g_settings = settings;
+                g_sink = &sink;
+                g_fileSink = std::move(fileSink);
+                g_stopFlusher = false;
+                sink.BeginSession(Now());
+                Detail::g_recording.store(true, std::memory_order_relaxed);
+            }
+
+            g_flusher = std::thread(RunFlusher);
+            return true;
+        }
+
+        // Writes value / 1000 with three decimals, e.g. nanoseconds as microseconds.
+        char* FormatThousandths(char* out, char* end, int64_t value)
+        {
+            value = std::max<int64_t>(value, 0);
+            out = std::to_chars(out, end, value / 1000).ptr;
+            const int64_t fraction = value % 1000;
+            *out++ = '.';
+            *out++ = static_cast<char>('0' + fraction / 100);
+            *out++ = static_cast<char>('0' + fraction / 10 % 10);
+            *out++ = static_cast<char>('0' + fraction % 10);
+            return out;
+        }
+    } // namespace
+
+    ChromeTraceWriter::ChromeTraceWriter(std::ostream& stream)
+        : m_stream(stream)
+    {
+    }
+
+    void ChromeTraceWriter::BeginSession(int64_t startTime)
+    {
+        m_startTime = startTime;
+        m_firstEvent = true;
+        m_stream << "{\"traceEvents\":[\n";
+    }
+
+    void ChromeTraceWriter::WriteThreadName(uint32_t threadId, const std::string& name)
+    {
+        BeginEvent();
+        m_stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId << ",\"args\":{\"name\":";
+        WriteString(name.empty() ? "Thread" : name.c_str());
+        m_stream << "}}";
+    }
+
+    void ChromeTraceWriter::WriteEvents(uint32_t threadId, std::span<const Event> events)
+    {
+        char line[128];
+        for (const Event& event : events)
+        {
+            BeginEvent();
+            m_stream << "{\"name\":";
+            WriteString(event.name);
+
+            char* out = line;
+            char* end = line + sizeof(line);
+            constexpr std::string_view phase = ",\"ph\":\"X\",\"pid\":1,\"tid\":";
+            out = std::copy(phase.begin(), phase.end(), out);
+            out = std::to_chars(out, end, threadId).ptr;
+            constexpr std::string_view timestamp = ",\"ts\":";
+            out = std::copy(timestamp.begin(), timestamp.end(), out);
+            out = FormatThousandths(out, end, event.begin - m_startTime);
+            constexpr std::string_view duration = ",\"dur\":";
+            out = std::copy(duration.begin(), duration.end(), out);
+            out = FormatThousandths(out, end, event.end - event.begin);
+            *out++ = '}';
+            m_stream.write(line, out - line);
+        }
+    }
+
+    void ChromeTraceWriter::EndSession(uint64_t droppedEventCount)
+    {
+        m_stream << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":\"" << droppedEventCount << "\"}}\n";
+        m_stream.flush();
+    }
+
+    void ChromeTraceWriter::BeginEvent()
+    {
+        if (!m_firstEvent)
+        {
+            m_stream << ",\n";
+        }
+        m_firstEvent = false;
+    }
+
+    void ChromeTraceWriter::WriteString(const char* text)
+    {
+        m_stream << '"';
+        for (const char* c = text; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                m_stream << '\\' << *c;
+            }
+            else if (static_cast<unsigned char>(*c) < 0x20)
+            {
+                constexpr char hex[] = "0123456789abcdef";
+                m_stream << "\\u00" << hex[*c >> 4] << hex[*c & 0xf];
+            }
+            else
+            {
+                m_stream << *c;
+            }
+        }
+        m_stream << '"';
+    }
+
+    bool Start(EventSink& sink, const Settings& settings)
+    {
+        return StartSession(sink, settings, nullptr);
+    }
+
+    bool Start(const std::filesystem::path& path, const Settings& settings)
+    {
+        auto fileSink = std::make_unique<FileSink>(path);
+        if (!fileSink->stream)
+        {
+            return false;
+        }
+
+        EventSink& sink = fileSink->writer;
+        return StartSession(sink, settings, std::move(fileSink));
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard lock(g_mutex);
+            if (!g_sink)
+            {
+                return;
+            }
+
+            Detail::g_recording.store(false, std::memory_order_relaxed);
+            g_stopFlusher = true;
+        }
+
+        g_flusherWake.notify_one();
+        g_flusher.join();
+
+        std::lock_guard lock(g_mutex);
+        FlushLocked();
+
+        uint64_t dropped = g_retiredDropped;
+        for (const std::shared_ptr<ThreadBuffer>& buffer : g_buffers)
+        {
+            dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+        }
+        g_sink->EndSession(dropped);
+        g_sink = nullptr;
+        g_fileSink.reset();
+    }
+
+    void Flush()
+    {
+        std::lock_guard lock(g_mutex);
+        FlushLocked();
+    }
+
+    void Record(const char* name, int64_t begin, int64_t end)
+    {
+        ThreadBuffer* buffer = t_buffer.buffer.get();
+        if (!buffer)
+        {
+            buffer = RegisterThread();
+        }
+
+        const uint64_t write = buffer->write.load(std::memory_order_relaxed);
+        if (write - buffer->cachedRead > buffer->mask)
+        {
+            buffer->cachedRead = buffer->read.load(std::memory_order_acquire);
+            if (write - buffer->cachedRead > buffer->mask)
+            {
+                buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        buffer->events[write & buffer->mask] = {name, begin, end};
+        buffer->write.store(write + 1, std::memory_order_release);
+    }
+
+    void SetThreadName(const char* name)
+    {
+        ThreadBuffer* buffer = t_buffer.buffer.get();
+        if (!buffer)
+        {
+            buffer = RegisterThread();
+        }
+
+        std::lock_guard lock(g_mutex);
+        buffer->name = name;
+        buffer->nameWritten = false;
+    }
+
+    namespace
+    {
+        // Finishes the trace if the app did not stop the recording, and joins the flusher before the globals are destroyed.
+        struct StopAtExit
+        {
+            ~StopAtExit()
+            {
+                Stop();
+            }
+        } g_stopAtExit;
+    } // namespace
+} // namespace FrameProfiler
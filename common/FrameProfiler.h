@@ -0,0 +1,170 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+
+// Timing of the phases of the frame loop (update, render, present, waiting for the next frame, ...) as scopes, recorded into
+// per-thread ring buffers and written to a Chrome trace_event JSON file by a background thread, which can be opened with
+// chrome://tracing or https://ui.perfetto.dev.
+//
+//   void SampleRemoteApp::Render(...)
+//   {
+//       FRAME_PROFILER_SCOPE("Render");
+//       ...
+//   }
+//
+// While no recording is started, a scope costs one relaxed atomic load. While recording, it reads the clock twice and appends
+// one event to the ring of its thread, without a lock or an allocation. When a ring is full (the flusher fell behind), further
+// events of its thread are dropped and counted. Defining FRAME_PROFILER_ENABLED to 0 removes the scopes at compile time.
+//
+// Does not depend on WinRT, so that it can be used and benchmarked on any platform.
+#ifndef FRAME_PROFILER_ENABLED
+#    define FRAME_PROFILER_ENABLED 1
+#endif
+
+#define FRAME_PROFILER_CONCAT_INNER(a, b) a##b
+#define FRAME_PROFILER_CONCAT(a, b)       FRAME_PROFILER_CONCAT_INNER(a, b)
+
+#if FRAME_PROFILER_ENABLED
+// Times the enclosing scope. name must be a string literal (or live as long as the process).
+#    define FRAME_PROFILER_SCOPE(name) FrameProfiler::Scope FRAME_PROFILER_CONCAT(frameProfilerScope, __LINE__)(name)
+#    define FRAME_PROFILER_THREAD_NAME(name) FrameProfiler::SetThreadName(name)
+#else
+#    define FRAME_PROFILER_SCOPE(name)
+#    define FRAME_PROFILER_THREAD_NAME(name)
+#endif
+
+namespace FrameProfiler
+{
+    using Clock = std::chrono::steady_clock;
+
+    // A timed scope. Times are in nanoseconds on Clock.
+    struct Event
+    {
+        const char* name;
+        int64_t begin;
+        int64_t end;
+    };
+
+    // Receives the recorded events from the flusher thread.
+    class EventSink
+    {
+    public:
+        virtual ~EventSink() = default;
+
+        virtual void BeginSession(int64_t startTime) = 0;
+        // Called before the first events of a thread, and again when the name of the thread changed.
+        virtual void WriteThreadName(uint32_t threadId, const std::string& name) = 0;
+        // Events of one thread, in the order in which the scopes ended.
+        virtual void WriteEvents(uint32_t threadId, std::span<const Event> events) = 0;
+        virtual void EndSession(uint64_t droppedEventCount) = 0;
+    };
+
+    // Writes the events as Chrome trace_event JSON ("X" complete events, timestamps in microseconds since the session start).
+    class ChromeTraceWriter : public EventSink
+    {
+    public:
+        explicit ChromeTraceWriter(std::ostream& stream);
+
+        void BeginSession(int64_t startTime) override;
+        void WriteThreadName(uint32_t threadId, const std::string& name) override;
+        void WriteEvents(uint32_t threadId, std::span<const Event> events) override;
+        void EndSession(uint64_t droppedEventCount) override;
+
+    private:
+        void BeginEvent();
+        void WriteString(const char* text);
+
+        std::ostream& m_stream;
+        int64_t m_startTime = 0;
+        bool m_firstEvent = true;
+    };
+
+    struct Settings
+    {
+        // Capacity of the event ring of each thread, rounded up to a power of two. Rings are created when a thread records its
+        // first event and keep their capacity for the lifetime of the thread.
+        size_t eventsPerThread = 1 << 14;
+        std::chrono::milliseconds flushInterval{50};
+    };
+
+    // Starts recording into sink, which must outlive the recording. Returns false if a recording is already running.
+    bool Start(EventSink& sink, const Settings& settings = {});
+
+    // Starts recording into a Chrome trace_event JSON file. Returns false if the file can not be created or a recording is
+    // already running.
+    bool Start(const std::filesystem::path& path, const Settings& settings = {});
+
+    // Stops the recording and hands the remaining events to the sink.
+    void Stop();
+
+    // Hands the recorded events to the sink right away, instead of waiting for the flusher thread.
+    void Flush();
+
+    namespace Detail
+    {
+        extern std::atomic<bool> g_recording;
+    }
+
+    inline bool IsRecording()
+    {
+        return Detail::g_recording.load(std::memory_order_relaxed);
+    }
+
+    inline int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // Appends an event to the ring of the calling thread.
+    void Record(const char* name, int64_t begin, int64_t end);
+
+    // Names the calling thread in the trace. name is copied.
+    void SetThreadName(const char* name);
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name)
+        {
+            if (IsRecording())
+            {
+                m_name = name;
+                m_begin = Now();
+            }
+        }
+
+        ~Scope()
+        {
+            if (m_name)
+            {
+                Record(m_name, m_begin, Now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name = nullptr;
+        int64_t m_begin = 0;
+    };
+} // namespace FrameProfiler
@@ -0,0 +1,453 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <FrameTrace.h>
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace FrameTrace
+{
+    namespace
+    {
+        // Largest encoding of a uint64 varint.
+        constexpr size_t MaxVarintSize = 10;
+
+        size_t WriteVarint(uint8_t* data, uint64_t value)
+        {
+            size_t size = 0;
+            while (value >= 0x80)
+            {
+                data[size++] = static_cast<uint8_t>(value | 0x80);
+                value >>= 7;
+            }
+            data[size++] = static_cast<uint8_t>(value);
+            return size;
+        }
+
+        bool ReadVarint(std::span<const uint8_t> data, size_t& offset, uint64_t& value)
+        {
+            value = 0;
+            for (uint32_t shift = 0; shift < 64 && offset < data.size(); shift += 7)
+            {
+                const uint8_t byte = data[offset++];
+                value |= uint64_t(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Size of the record struct of a type, 0 if the payload is not checked.
+        size_t GetRecordSize(RecordType type)
+        {
+            switch (type)
+            {
+                case RecordType::Views:
+                    return sizeof(ViewRecord);
+                case RecordType::Joints:
+                    return sizeof(JointRecord);
+                case RecordType::Holograms:
+                    return sizeof(HologramRecord);
+                case RecordType::FrameStatistics:
+                    return sizeof(FrameStatisticsRecord);
+                default:
+                    return 0;
+            }
+        }
+    } // namespace
+
+    // Writable mapping of the whole file. The file is extended to the size of the mapping.
+    struct TraceWriter::MappedFile
+    {
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+
+        bool Open(const std::filesystem::path& path)
+        {
+            file = CreateFile2(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, CREATE_ALWAYS, nullptr);
+            return file != INVALID_HANDLE_VALUE;
+        }
+
+        uint8_t* Map(uint64_t capacity)
+        {
+            // Creating a mapping larger than the file extends the file.
+            mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READWRITE, capacity, nullptr);
+            if (!mapping)
+            {
+                return nullptr;
+            }
+            void* data = MapViewOfFileFromApp(mapping, FILE_MAP_WRITE, 0, static_cast<SIZE_T>(capacity));
+            if (!data)
+            {
+                CloseHandle(mapping);
+                mapping = nullptr;
+            }
+            return static_cast<uint8_t*>(data);
+        }
+
+        void Unmap(uint8_t* data, uint64_t)
+        {
+            UnmapViewOfFile(data);
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+
+        void Close(uint64_t size)
+        {
+            LARGE_INTEGER end;
+            end.QuadPart = static_cast<LONGLONG>(size);
+            SetFilePointerEx(file, end, nullptr, FILE_BEGIN);
+            SetEndOfFile(file);
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+#else
+        int file = -1;
+
+        bool Open(const std::filesystem::path& path)
+        {
+            file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            return file >= 0;
+        }
+
+        uint8_t* Map(uint64_t capacity)
+        {
+            if (ftruncate(file, static_cast<off_t>(capacity)) != 0)
+            {
+                return nullptr;
+            }
+            void* data = mmap(nullptr, static_cast<size_t>(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+            return data != MAP_FAILED ? static_cast<uint8_t*>(data) : nullptr;
+        }
+
+        void Unmap(uint8_t* data, uint64_t capacity)
+        {
+            munmap(data, static_cast<size_t>(capacity));
+        }
+
+        void Close(uint64_t size)
+        {
+            [[maybe_unused]] const int result = ftruncate(file, static_cast<off_t>(size));
+            close(file);
+            file = -1;
+        }
+#endif
+    };
+
+    TraceWriter::~TraceWriter()
+    {
+        Close();
+    }
+
+    bool TraceWriter::Open(const std::filesystem::path& path, size_t initialCapacity)
+    {
+        Close();
+
+        m_file = new MappedFile();
+        if (!m_file->Open(path))
+        {
+            delete m_file;
+            m_file = nullptr;
+            return false;
+        }
+
+        m_capacity = std::max<uint64_t>(initialCapacity, 4096);
+        m_data = m_file->Map(m_capacity);
+        if (!m_data)
+        {
+            m_file->Close(0);
+            delete m_file;
+            m_file = nullptr;
+            return false;
+        }
+
+        const FileHeader header{FileMagic, FileVersion, sizeof(FileHeader), 0};
+        std::memcpy(m_data, &header, sizeof(header));
+        m_size = sizeof(header);
+        m_lastTimestamp = 0;
+        m_hasRecords = false;
+        return true;
+    }
+
+    void TraceWriter::Close()
+    {
+        if (m_file)
+        {
+            if (m_data)
+            {
+                m_file->Unmap(m_data, m_capacity);
+            }
+            m_file->Close(m_size);
+            delete m_file;
+            m_file = nullptr;
+        }
+        m_data = nullptr;
+        m_capacity = 0;
+    }
+
+    bool TraceWriter::Reserve(uint64_t size)
+    {
+        if (size <= m_capacity)
+        {
+            return true;
+        }
+
+        // The recorded data stays in the file while it is remapped.
+        const uint64_t capacity = std::max(m_capacity * 2, size);
+        m_file->Unmap(m_data, m_capacity);
+        m_data = m_file->Map(capacity);
+        if (!m_data)
+        {
+            Close();
+            return false;
+        }
+        m_capacity = capacity;
+        return true;
+    }
+
+    bool TraceWriter::Write(RecordType type, std::chrono::microseconds timestamp, std::span<const uint8_t> payload)
+    {
+        if (!m_data || !Reserve(m_size + 1 + 2 * MaxVarintSize + payload.size()))
+        {
+            return false;
+        }
+
+        const int64_t time = timestamp.count();
+        if (!m_hasRecords)
+        {
+            const FileHeader header{FileMagic, FileVersion, sizeof(FileHeader), time};
+            std::memcpy(m_data, &header, sizeof(header));
+            m_lastTimestamp = time;
+            m_hasRecords = true;
+        }
+        const int64_t delta = std::max<int64_t>(time - m_lastTimestamp, 0);
+        m_lastTimestamp += delta;
+
+        uint8_t* record = m_data + m_size;
+        size_t size = 0;
+        record[size++] = static_cast<uint8_t>(type);
+        size += WriteVarint(record + size, static_cast<uint64_t>(delta));
+        size += WriteVarint(record + size, payload.size());
+        if (!payload.empty())
+        {
+            std::memcpy(record + size, payload.data(), payload.size());
+        }
+        m_size += size + payload.size();
+        return true;
+    }
+
+    TraceReader::TraceReader(std::span<const uint8_t> trace)
+        : m_trace(trace)
+    {
+        FileHeader header;
+        if (trace.size() >= sizeof(header))
+        {
+            std::memcpy(&header, trace.data(), sizeof(header));
+            m_valid = header.magic == FileMagic && header.version == FileVersion && header.headerSize >= sizeof(header) &&
+                      header.headerSize <= trace.size();
+        }
+        Rewind();
+    }
+
+    void TraceReader::Rewind()
+    {
+        if (m_valid)
+        {
+            FileHeader header;
+            std::memcpy(&header, m_trace.data(), sizeof(header));
+            m_offset = header.headerSize;
+            m_status = ReadStatus::Ok;
+        }
+        else
+        {
+            m_offset = 0;
+            m_status = ReadStatus::Corrupt;
+        }
+        m_timestamp = 0;
+    }
+
+    ReadStatus TraceReader::Next(Record& record)
+    {
+        if (m_status != ReadStatus::Ok)
+        {
+            return m_status;
+        }
+
+        if (m_offset == m_trace.size() || m_trace[m_offset] == static_cast<uint8_t>(RecordType::End))
+        {
+            return m_status = ReadStatus::End;
+        }
+
+        const uint8_t type = m_trace[m_offset++];
+        uint64_t delta = 0;
+        uint64_t size = 0;
+        if (type >= static_cast<uint8_t>(RecordType::Count) || !ReadVarint(m_trace, m_offset, delta) ||
+            !ReadVarint(m_trace, m_offset, size) || size > m_trace.size() - m_offset || delta > uint64_t(INT64_MAX - m_timestamp))
+        {
+            return m_status = ReadStatus::Corrupt;
+        }
+
+        const size_t recordSize = GetRecordSize(static_cast<RecordType>(type));
+        if (recordSize > 0 && size % recordSize != 0)
+        {
+            return m_status = ReadStatus::Corrupt;
+        }
+
+        m_timestamp += static_cast<int64_t>(delta);
+        record.type = static_cast<RecordType>(type);
+        record.timestamp = std::chrono::microseconds(m_timestamp);
+        record.payload = m_trace.subspan(m_offset, static_cast<size_t>(size));
+        m_offset += static_cast<size_t>(size);
+        return ReadStatus::Ok;
+    }
+
+    MappedTrace::~MappedTrace()
+    {
+        Close();
+    }
+
+    bool MappedTrace::Open(const std::filesystem::path& path)
+    {
+        Close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, OPEN_EXISTING, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER size{};
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        {
+            mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+        }
+        if (mapping)
+        {
+            // The view keeps the file mapped after the handles are closed.
+            m_mapping = MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, 0);
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        m_size = m_mapping ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+        struct stat status;
+        if (fstat(file, &status) == 0 && status.st_size > 0)
+        {
+            void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED)
+            {
+                m_mapping = data;
+                m_size = static_cast<size_t>(status.st_size);
+            }
+        }
+        close(file);
+#endif
+        m_data = static_cast<const uint8_t*>(m_mapping);
+        return m_mapping != nullptr;
+    }
+
+    void MappedTrace::Close()
+    {
+        if (m_mapping)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(m_mapping);
+#else
+            munmap(m_mapping, m_size);
+#endif
+        }
+        m_mapping = nullptr;
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    FrameReplayer::FrameReplayer(std::span<const uint8_t> trace, ReplaySpeed speed)
+        : m_reader(trace)
+        , m_speed(speed)
+    {
+    }
+
+    void FrameReplayer::Rewind()
+    {
+        m_reader.Rewind();
+        m_hasPending = false;
+        m_frameIndex = 0;
+        m_status = ReadStatus::Ok;
+        m_started = false;
+    }
+
+    bool FrameReplayer::NextFrame(Frame& frame)
+    {
+        frame.records.clear();
+        if (!m_hasPending)
+        {
+            m_status = m_reader.Next(m_pending);
+            if (m_status != ReadStatus::Ok)
+            {
+                return false;
+            }
+        }
+
+        // The pending record starts the frame, it is either a FrameBegin or the first record of the trace.
+        frame.index = m_frameIndex++;
+        frame.timestamp = m_pending.timestamp;
+        if (m_pending.type != RecordType::FrameBegin)
+        {
+            frame.records.push_back(m_pending);
+        }
+        m_hasPending = false;
+
+        Record record;
+        while ((m_status = m_reader.Next(record)) == ReadStatus::Ok)
+        {
+            if (record.type == RecordType::FrameBegin)
+            {
+                m_pending = record;
+                m_hasPending = true;
+                break;
+            }
+            frame.records.push_back(record);
+        }
+
+        if (m_speed == ReplaySpeed::Recorded)
+        {
+            if (!m_started)
+            {
+                m_startTime = Clock::now() - std::chrono::duration_cast<Clock::duration>(frame.timestamp);
+                m_started = true;
+            }
+            std::this_thread::sleep_until(m_startTime + std::chrono::duration_cast<Clock::duration>(frame.timestamp));
+        }
+        return true;
+    }
+} // namespace FrameTrace
@@ -0,0 +1,294 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Recording of the per-frame input of the samples (camera views, hand joints, hologram poses and player frame statistics), so
+// that the platform-neutral parts of the frame loop can be replayed and benchmarked without a device.
+//
+// A trace file is a FileHeader followed by records back to back:
+//   uint8 RecordType, varint timestamp delta in microseconds to the previous record, varint payload size, payload
+// The payload of a record is an array of the record struct of its type, e.g. one ViewRecord per camera view. All values are
+// little-endian and unaligned. The file is only appended to, a record type of 0 ends the trace, so that the zero-filled tail of
+// a file whose recording was not closed (e.g. because the app crashed) reads as the end.
+//
+// Does not depend on WinRT, so that traces can be replayed on any platform.
+namespace FrameTrace
+{
+    static_assert(std::endian::native == std::endian::little, "Traces are stored in native little-endian byte order");
+
+    constexpr uint32_t FileMagic = 0x54465248; // "HRFT"
+    constexpr uint16_t FileVersion = 1;
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t headerSize;
+        // Timestamp of the first record in microseconds, on the clock of the recording app.
+        int64_t startTimestamp;
+    };
+    static_assert(sizeof(FileHeader) == 16, "FileHeader must match the file layout");
+
+    enum class RecordType : uint8_t
+    {
+        End = 0,
+        // Starts the records of a frame. No payload.
+        FrameBegin = 1,
+        // ViewRecord per camera view.
+        Views = 2,
+        // JointRecord per hand joint or pointer pose.
+        Joints = 3,
+        // HologramRecord per hologram.
+        Holograms = 4,
+        // One FrameStatisticsRecord.
+        FrameStatistics = 5,
+
+        Count
+    };
+
+    struct Pose
+    {
+        float position[3];
+        // Rotation quaternion (x, y, z, w).
+        float orientation[4];
+    };
+
+    // Camera view in the rendering coordinate system. The view projection matrix is stored row by row and transforms row vectors
+    // (clip = [x y z 1] * viewProjection), like float4x4 and DirectXMath, with a clip space depth of 0 to w.
+    struct ViewRecord
+    {
+        Pose pose;
+        float viewProjection[16];
+    };
+
+    // Hand joint (or pointer pose) in the rendering coordinate system. The joint extends along -z of its orientation.
+    struct JointRecord
+    {
+        Pose pose;
+        float length;
+        float radius;
+    };
+
+    struct HologramRecord
+    {
+        uint32_t id;
+        Pose pose;
+        float scale[3];
+        float color[3];
+    };
+
+    // Same fields as winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics, so that it can be summarized by
+    // StatisticsHelper.
+    struct FrameStatisticsRecord
+    {
+        float TimeSinceLastPresent;
+        uint32_t VideoFramesSkipped;
+        uint32_t VideoFramesReceived;
+        uint32_t VideoFrameReusedCount;
+        float VideoFrameMinDelta;
+        float VideoFrameMaxDelta;
+        float Latency;
+        uint32_t VideoFramesDiscarded;
+    };
+
+    // Records a trace into a memory-mapped file. Appending a record copies it into the mapping, the file only grows (by
+    // doubling) when the mapping is full, so that recording costs no system call per frame. Close truncates the file to the
+    // recorded size. Not thread-safe.
+    class TraceWriter
+    {
+    public:
+        TraceWriter() = default;
+        ~TraceWriter();
+
+        TraceWriter(const TraceWriter&) = delete;
+        TraceWriter& operator=(const TraceWriter&) = delete;
+
+        // Creates or replaces the file. Returns false if the file can not be created or mapped.
+        bool Open(const std::filesystem::path& path, size_t initialCapacity = 1 << 20);
+        void Close();
+
+        bool IsOpen() const
+        {
+            return m_data != nullptr;
+        }
+
+        // Appends a record. Timestamps are in microseconds on any clock and must not decrease, a smaller timestamp is stored as
+        // the previous one. Returns false if the file could not grow, which closes it.
+        bool Write(RecordType type, std::chrono::microseconds timestamp, std::span<const uint8_t> payload = {});
+
+        template <typename T>
+        bool Write(RecordType type, std::chrono::microseconds timestamp, std::span<const T> records)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            return Write(type, timestamp, {reinterpret_cast<const uint8_t*>(records.data()), records.size_bytes()});
+        }
+
+        // Bytes recorded so far, including the header.
+        uint64_t GetSize() const
+        {
+            return m_size;
+        }
+
+    private:
+        bool Reserve(uint64_t size);
+
+        struct MappedFile;
+        MappedFile* m_file = nullptr;
+        uint8_t* m_data = nullptr;
+        uint64_t m_capacity = 0;
+        uint64_t m_size = 0;
+        int64_t m_lastTimestamp = 0;
+        bool m_hasRecords = false;
+    };
+
+    // A record within a trace. The payload points into the trace.
+    struct Record
+    {
+        RecordType type;
+        // Microseconds since the first record.
+        std::chrono::microseconds timestamp;
+        std::span<const uint8_t> payload;
+
+        template <typename T>
+        size_t GetCount() const
+        {
+            return payload.size() / sizeof(T);
+        }
+
+        // Copies the records out of the (unaligned) payload, reusing the capacity of records.
+        template <typename T>
+        void CopyTo(std::vector<T>& records) const
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            records.resize(GetCount<T>());
+            std::memcpy(records.data(), payload.data(), records.size() * sizeof(T));
+        }
+    };
+
+    enum class ReadStatus
+    {
+        Ok,
+        End,
+        // The trace ends within a record, or a record has an unknown type or a payload of the wrong size.
+        Corrupt
+    };
+
+    // Iterates the records of a trace in place.
+    class TraceReader
+    {
+    public:
+        TraceReader() = default;
+        explicit TraceReader(std::span<const uint8_t> trace);
+
+        // The header was valid.
+        bool IsValid() const
+        {
+            return m_valid;
+        }
+
+        // Reads the next record. Once a status other than Ok is returned, the following calls return the same status.
+        ReadStatus Next(Record& record);
+
+        // Starts over at the first record.
+        void Rewind();
+
+    private:
+        std::span<const uint8_t> m_trace;
+        size_t m_offset = 0;
+        int64_t m_timestamp = 0;
+        ReadStatus m_status = ReadStatus::End;
+        bool m_valid = false;
+    };
+
+    // Read-only mapping of a trace file.
+    class MappedTrace
+    {
+    public:
+        MappedTrace() = default;
+        ~MappedTrace();
+
+        MappedTrace(const MappedTrace&) = delete;
+        MappedTrace& operator=(const MappedTrace&) = delete;
+
+        bool Open(const std::filesystem::path& path);
+        void Close();
+
+        std::span<const uint8_t> GetData() const
+        {
+            return {m_data, m_size};
+        }
+
+    private:
+        void* m_mapping = nullptr;
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    enum class ReplaySpeed
+    {
+        // Hands out each frame when it is due, relative to the first frame.
+        Recorded,
+        // Hands out the frames as fast as they are asked for.
+        Maximum
+    };
+
+    // The records of one frame, from a FrameBegin record up to the next one.
+    struct Frame
+    {
+        uint64_t index = 0;
+        std::chrono::microseconds timestamp{0};
+        std::vector<Record> records;
+    };
+
+    // Replays a trace frame by frame, at the recorded pace or as fast as possible. Records in front of the first FrameBegin
+    // make up frame 0.
+    class FrameReplayer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        FrameReplayer(std::span<const uint8_t> trace, ReplaySpeed speed);
+
+        // Reads the next frame, reusing the memory of frame. At recorded speed, waits until the frame is due. Returns false at
+        // the end of the trace.
+        bool NextFrame(Frame& frame);
+
+        // Starts over at the first frame. At recorded speed, the first frame is due right away.
+        void Rewind();
+
+        // Status of the last read, Corrupt if the replay stopped at a corrupt record.
+        ReadStatus GetStatus() const
+        {
+            return m_status;
+        }
+
+    private:
+        TraceReader m_reader;
+        ReplaySpeed m_speed;
+        Record m_pending{};
+        bool m_hasPending = false;
+        uint64_t m_frameIndex = 0;
+        ReadStatus m_status = ReadStatus::Ok;
+        bool m_started = false;
+        Clock::time_point m_startTime;
+    };
+} // namespace FrameTrace
@@ -0,0 +1,128 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "BitrateController.h"
+
+#include <algorithm>
+#include <cmath>
+
+BitrateController::BitrateController(const BitrateControllerSettings& settings)
+    : m_settings(settings)
+{
+    m_settings.maxKbps = std::max(m_settings.maxKbps, m_settings.minKbps);
+    m_settings.baselineWindowCount = std::clamp<uint32_t>(m_settings.baselineWindowCount, 1, MaxBaselineWindowCount);
+    Reset();
+}
+
+void BitrateController::Reset()
+{
+    m_targetKbps = std::clamp(m_settings.initialKbps, m_settings.minKbps, m_settings.maxKbps);
+    m_congestedKbps = 0;
+    m_holdWindows = 0;
+    m_cleanWindows = 0;
+    m_startup = true;
+    m_latencyCount = 0;
+    m_nextLatencyIndex = 0;
+}
+
+BitrateUpdate BitrateController::Update(const BitrateWindowStatistics& window)
+{
+    const uint32_t expectedFrames = window.framesReceived + window.framesSkipped;
+    if (expectedFrames == 0)
+    {
+        // No video in this window (not connected, or the remote paused rendering), which says nothing about the link.
+        return {m_targetKbps, BitrateDecision::Hold};
+    }
+
+    // The baseline is the minimum latency over the previous windows, so that a rise within this window stands out. Without a
+    // received frame, the window has no latency.
+    const bool hasLatency = window.framesReceived > 0;
+    const float baselineLatency = m_latencyCount > 0 ? GetBaselineLatency() : window.latencyAvg;
+    if (hasLatency)
+    {
+        RecordLatency(window.latencyAvg);
+    }
+
+    const double lossRatio = double(window.framesSkipped + window.framesDiscarded) / double(expectedFrames);
+    BitrateDecision decision = BitrateDecision::Hold;
+    if (lossRatio > m_settings.maxFrameLossRatio)
+    {
+        decision = BitrateDecision::DecreaseLoss;
+    }
+    else if (window.frameMaxDelta > m_settings.maxFrameDeltaSeconds)
+    {
+        decision = BitrateDecision::DecreaseStall;
+    }
+    else if (hasLatency && window.latencyAvg > baselineLatency + m_settings.latencyMarginSeconds)
+    {
+        decision = BitrateDecision::DecreaseLatency;
+    }
+
+    if (m_holdWindows > 0)
+    {
+        m_holdWindows--;
+        return {m_targetKbps, BitrateDecision::Hold};
+    }
+
+    if (decision != BitrateDecision::Hold)
+    {
+        m_congestedKbps = m_targetKbps;
+        // When frames get lost, the link carried at most the rest of them, so the target drops at least to that share.
+        const double factor = m_settings.decreaseFactor * std::min(1.0, 1.0 - lossRatio + m_settings.maxFrameLossRatio);
+        m_targetKbps = std::max(m_settings.minKbps, static_cast<uint32_t>(std::lround(m_targetKbps * factor)));
+        m_holdWindows = m_settings.holdWindowCount;
+        m_cleanWindows = 0;
+        m_startup = false;
+        return {m_targetKbps, decision};
+    }
+
+    if (++m_cleanWindows >= m_settings.congestionMemoryWindowCount)
+    {
+        m_congestedKbps = 0;
+    }
+
+    if (m_targetKbps >= m_settings.maxKbps)
+    {
+        return {m_targetKbps, BitrateDecision::Hold};
+    }
+
+    // Far below the congested target (after a deep cut, when most frames were lost), the target recovers multiplicatively.
+    double increase = m_settings.increaseKbps;
+    if (m_startup || m_targetKbps < m_congestedKbps * m_settings.decreaseFactor)
+    {
+        increase = std::max(increase, m_targetKbps * (m_settings.startupGrowth - 1.0));
+    }
+    else if (m_congestedKbps > 0 && m_targetKbps + m_settings.increaseKbps > m_congestedKbps &&
+             m_targetKbps < m_congestedKbps + m_settings.increaseKbps)
+    {
+        increase *= m_settings.cautiousIncreaseScale;
+    }
+    m_targetKbps = std::min(m_settings.maxKbps, m_targetKbps + std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(increase))));
+    return {m_targetKbps, BitrateDecision::Increase};
+}
+
+float BitrateController::GetBaselineLatency() const
+{
+    const uint32_t count = std::min(m_latencyCount, m_settings.baselineWindowCount);
+    float baseline = m_latencies[(m_nextLatencyIndex + MaxBaselineWindowCount - 1) % MaxBaselineWindowCount];
+    for (uint32_t i = 2; i <= count; ++i)
+    {
+        baseline = std::min(baseline, m_latencies[(m_nextLatencyIndex + MaxBaselineWindowCount - i) % MaxBaselineWindowCount]);
+    }
+    return baseline;
+}
+
+void BitrateController::RecordLatency(float latency)
+{
+    m_latencies[m_nextLatencyIndex] = latency;
+    m_nextLatencyIndex = (m_nextLatencyIndex + 1) % MaxBaselineWindowCount;
+    m_latencyCount = std::min(m_latencyCount + 1, MaxBaselineWindowCount);
+}
@@ -0,0 +1,128 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Video statistics of one window of remote frames, as summarized by StatisticsHelper.
+struct BitrateWindowStatistics
+{
+    uint32_t framesReceived = 0;
+    // Frames which never arrived.
+    uint32_t framesSkipped = 0;
+    // Frames which arrived too late to be shown.
+    uint32_t framesDiscarded = 0;
+    // Longest gap between two received frames, in seconds.
+    float frameMaxDelta = 0.0f;
+    // Average end-to-end latency of the frames, in seconds.
+    float latencyAvg = 0.0f;
+};
+
+// Picks the video statistics of a FrameStatisticsSummary (or any summary with the same fields).
+template <class Summary>
+BitrateWindowStatistics MakeBitrateWindowStatistics(Summary const& summary)
+{
+    return {
+        summary.videoFramesReceived, summary.videoFramesSkipped, summary.videoFramesDiscarded, summary.videoFrameMaxDelta,
+        summary.latencyAvg};
+}
+
+struct BitrateControllerSettings
+{
+    uint32_t minKbps = 2000;
+    uint32_t maxKbps = 40000;
+    uint32_t initialKbps = 20000;
+
+    // Additive increase per window without congestion.
+    uint32_t increaseKbps = 1000;
+    // Until the first congestion, and while below the target a congestion cuts to, the target grows by this factor per window
+    // instead (but at least by increaseKbps).
+    double startupGrowth = 1.25;
+    // Within increaseKbps around the last congested target, the increase is scaled down by this factor, to probe carefully
+    // where the link gave up the last time.
+    double cautiousIncreaseScale = 0.25;
+    // Multiplicative decrease on congestion.
+    double decreaseFactor = 0.7;
+
+    // A window is congested if more than this fraction of the frames were skipped or discarded,
+    double maxFrameLossRatio = 0.02;
+    // or no frame arrived for longer than this (seconds),
+    float maxFrameDeltaSeconds = 0.1f;
+    // or the latency rose by more than this (seconds) above its minimum over the last baselineWindowCount windows, which tells
+    // that the video queues up in the network before frames get lost.
+    float latencyMarginSeconds = 0.03f;
+    uint32_t baselineWindowCount = 10;
+
+    // Windows after a decrease in which the target is held, since the window which follows a decrease still shows (part of)
+    // the congestion.
+    uint32_t holdWindowCount = 1;
+    // Windows without congestion after which the last congested target is forgotten, so the link is probed at full speed again.
+    uint32_t congestionMemoryWindowCount = 20;
+};
+
+enum class BitrateDecision
+{
+    // Target unchanged, while holding after a decrease, at the maximum, or for a window without video.
+    Hold,
+    Increase,
+    DecreaseLoss,
+    DecreaseStall,
+    DecreaseLatency
+};
+
+struct BitrateUpdate
+{
+    uint32_t targetKbps;
+    BitrateDecision decision;
+};
+
+// AIMD congestion control of the video bitrate, driven by the video statistics the player measures per window (e.g. once per
+// second). Frame loss, stalls and a latency rise above the recent minimum (a BBR-style queueing signal) cut the target
+// multiplicatively, windows without any of these raise it additively.
+//
+// The target only depends on the sequence of windows passed to Update, so a recorded or simulated trace replays exactly. There
+// is no clock and no allocation. Not thread-safe.
+class BitrateController
+{
+public:
+    static constexpr uint32_t MaxBaselineWindowCount = 32;
+
+    explicit BitrateController(const BitrateControllerSettings& settings = {});
+
+    // Advances the controller by one window and returns the new target.
+    BitrateUpdate Update(const BitrateWindowStatistics& window);
+
+    uint32_t GetTargetKbps() const
+    {
+        return m_targetKbps;
+    }
+
+    // Starts over from the initial target, e.g. for a new connection.
+    void Reset();
+
+private:
+    float GetBaselineLatency() const;
+    void RecordLatency(float latency);
+
+    BitrateControllerSettings m_settings;
+    uint32_t m_targetKbps = 0;
+    // Target at the last congestion, 0 if there was none (yet, or within congestionMemoryWindowCount windows).
+    uint32_t m_congestedKbps = 0;
+    uint32_t m_holdWindows = 0;
+    uint32_t m_cleanWindows = 0;
+    bool m_startup = true;
+
+    std::array<float, MaxBaselineWindowCount> m_latencies{};
+    uint32_t m_latencyCount = 0;
+    uint32_t m_nextLatencyIndex = 0;
+};
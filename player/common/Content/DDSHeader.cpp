@@ -0,0 +1,60 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DDSHeader.h"
+
+#include <cstring>
+
+bool ParseDDSHeader(const uint8_t* ddsData, size_t ddsDataSize, DDSFileLayout& layout)
+{
+    layout = {};
+
+    // Need at least enough data to fill the header and magic number to be a valid DDS
+    if (!ddsData || ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
+    {
+        return false;
+    }
+
+    // DDS files always start with the same magic number ("DDS ")
+    uint32_t magicNumber;
+    std::memcpy(&magicNumber, ddsData, sizeof(magicNumber));
+    if (magicNumber != DDS_MAGIC)
+    {
+        return false;
+    }
+
+    auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
+
+    // Verify header to validate DDS file
+    if (header->size != sizeof(DDS_HEADER) || header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return false;
+    }
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+
+    // Check for DX10 extension
+    if ((header->ddspf.flags & DDS_FOURCC) && (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+    {
+        // Must be long enough for both headers and magic value
+        if (ddsDataSize < offset + sizeof(DDS_HEADER_DXT10))
+        {
+            return false;
+        }
+
+        layout.headerDxt10 = reinterpret_cast<const DDS_HEADER_DXT10*>(ddsData + offset);
+        offset += sizeof(DDS_HEADER_DXT10);
+    }
+
+    layout.header = header;
+    layout.bitOffset = offset;
+    return true;
+}
@@ -0,0 +1,441 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "LatencyHistogram.h"
+#include "StatisticsHelper.h"
+
+// Returns the end-to-end latency of a single frame.
+template <class T>
+struct FrameLatency
+{
+    static float Get(T const& frameStatistics)
+    {
+        return frameStatistics.Latency;
+    }
+};
+
+// Values reported by FrameStatisticsSummary. Plain data, so that it can be copied cheaply to the thread which formats it.
+struct FrameStatisticsValues
+{
+    std::wstring ToWString() const;
+
+    float timeSinceLastPresentAvg = 0.0f;
+    float timeSinceLastPresentMax = 0.0f;
+    uint32_t videoFramesSkipped = 0;
+    uint32_t videoFramesReused = 0;
+    uint32_t videoFramesReceived = 0;
+    float videoFrameMinDelta = 0.0f;
+    float videoFrameMaxDelta = 0.0f;
+    float latencyAvg = 0.0f;
+    uint32_t videoFramesDiscarded = 0;
+    uint32_t videoFramesDiscardedTotal = 0;
+    uint32_t frameStatsCount = 0;
+};
+
+// Sliding window summary of frame statistics types with the fields of PlayerFrameStatistics
+// (TimeSinceLastPresent, VideoFramesSkipped, VideoFramesReceived, VideoFrameReusedCount, VideoFrameMinDelta,
+// VideoFrameMaxDelta, VideoFramesDiscarded) and a latency provided by FrameLatency<T>.
+// Sums are updated by adding and subtracting frames, extrema are tracked with monotonic queues.
+template <class T>
+class FrameStatisticsSummary : public FrameStatisticsValues
+{
+public:
+    // The reported values, without the state needed to update them.
+    using Report = FrameStatisticsValues;
+
+    void Initialize(size_t capacity);
+    void AddFrame(uint64_t sequence, T const& frameStatistics);
+    void RemoveFrame(uint64_t sequence, T const& frameStatistics);
+    void Refresh();
+
+    void GetReport(Report& report) const
+    {
+        report = *this;
+    }
+
+private:
+    // Sums are kept in double precision so that subtracting evicted frames does not accumulate rounding errors.
+    double m_timeSinceLastPresentSum = 0.0;
+    double m_latencySum = 0.0;
+
+    MonotonicWindowQueue<float, std::greater<float>> m_timeSinceLastPresentMax;
+    MonotonicWindowQueue<float, std::less<float>> m_videoFrameMinDelta;
+    MonotonicWindowQueue<float, std::greater<float>> m_videoFrameMaxDelta;
+};
+
+template <class T>
+void FrameStatisticsSummary<T>::Initialize(size_t capacity)
+{
+    m_timeSinceLastPresentMax.Initialize(capacity);
+    m_videoFrameMinDelta.Initialize(capacity);
+    m_videoFrameMaxDelta.Initialize(capacity);
+}
+
+template <class T>
+void FrameStatisticsSummary<T>::AddFrame(uint64_t sequence, T const& frameStatistics)
+{
+    frameStatsCount++;
+
+    m_timeSinceLastPresentSum += frameStatistics.TimeSinceLastPresent;
+    m_timeSinceLastPresentMax.Push(sequence, frameStatistics.TimeSinceLastPresent);
+
+    videoFramesSkipped += frameStatistics.VideoFramesSkipped;
+    videoFramesReused += frameStatistics.VideoFrameReusedCount > 0 ? 1 : 0;
+    videoFramesReceived += frameStatistics.VideoFramesReceived;
+
+    if (frameStatistics.VideoFramesReceived > 0)
+    {
+        m_videoFrameMinDelta.Push(sequence, frameStatistics.VideoFrameMinDelta);
+        m_videoFrameMaxDelta.Push(sequence, frameStatistics.VideoFrameMaxDelta);
+    }
+
+    videoFramesDiscarded += frameStatistics.VideoFramesDiscarded;
+    videoFramesDiscardedTotal += frameStatistics.VideoFramesDiscarded;
+
+    m_latencySum += FrameLatency<T>::Get(frameStatistics);
+}
+
+template <class T>
+void FrameStatisticsSummary<T>::RemoveFrame(uint64_t sequence, T const& frameStatistics)
+{
+    frameStatsCount--;
+
+    m_timeSinceLastPresentSum -= frameStatistics.TimeSinceLastPresent;
+    m_timeSinceLastPresentMax.Evict(sequence);
+
+    videoFramesSkipped -= frameStatistics.VideoFramesSkipped;
+    videoFramesReused -= frameStatistics.VideoFrameReusedCount > 0 ? 1 : 0;
+    videoFramesReceived -= frameStatistics.VideoFramesReceived;
+
+    m_videoFrameMinDelta.Evict(sequence);
+    m_videoFrameMaxDelta.Evict(sequence);
+
+    videoFramesDiscarded -= frameStatistics.VideoFramesDiscarded;
+
+    m_latencySum -= FrameLatency<T>::Get(frameStatistics);
+}
+
+template <class T>
+void FrameStatisticsSummary<T>::Refresh()
+{
+    if (frameStatsCount > 0)
+    {
+        timeSinceLastPresentAvg = static_cast<float>(m_timeSinceLastPresentSum / frameStatsCount);
+        latencyAvg = static_cast<float>(m_latencySum / frameStatsCount);
+    }
+    else
+    {
+        timeSinceLastPresentAvg = 0.0f;
+        latencyAvg = 0.0f;
+    }
+
+    timeSinceLastPresentMax = m_timeSinceLastPresentMax.Empty() ? 0.0f : m_timeSinceLastPresentMax.Front();
+    videoFrameMinDelta = m_videoFrameMinDelta.Empty() ? 0.0f : m_videoFrameMinDelta.Front();
+    videoFrameMaxDelta = m_videoFrameMaxDelta.Empty() ? 0.0f : m_videoFrameMaxDelta.Front();
+}
+
+// frameStatsCount is reported as frame rate, which only holds for the 1s window at frame rates its capacity covers, see
+// StatisticsHelper.
+inline std::wstring FrameStatisticsValues::ToWString() const
+{
+    std::wstringstream statisticsStringStream;
+    statisticsStringStream.precision(3);
+    statisticsStringStream << L"Render: " << frameStatsCount << L" fps - " << timeSinceLastPresentAvg * 1000 << L" / "
+                           << timeSinceLastPresentMax * 1000 << L" ms (avg/max)" << std::endl
+                           << L"Video frames: " << videoFramesSkipped << L" / " << videoFramesReused << L" / " << videoFramesReceived
+                           << L" skipped/reused/received" << std::endl
+                           << L"Video frames delta: " << videoFrameMinDelta * 1000 << L" / " << videoFrameMaxDelta * 1000
+                           << L" ms (min/max)" << std::endl
+                           << L"Latency: " << latencyAvg * 1000 << L" ms (avg)" << std::endl
+                           << L"Video frames discarded: " << videoFramesDiscarded << L" / " << videoFramesDiscardedTotal
+                           << L" frames (last sec/total)" << std::endl;
+
+    return statisticsStringStream.str();
+}
+
+// Latency of frame statistics types which report it in the stages of HybridPlayerFrameStatistics
+// (LatencyPoseToReceive, LatencyReceiveToPresent, LatencyPresentToDisplay).
+template <class T>
+struct StagedFrameLatency
+{
+    static float Get(T const& frameStatistics)
+    {
+        return frameStatistics.LatencyPoseToReceive + frameStatistics.LatencyReceiveToPresent + frameStatistics.LatencyPresentToDisplay;
+    }
+};
+
+// FrameStatisticsSummary which in addition averages the latency stages of StagedFrameLatency.
+template <class T>
+class StagedLatencySummary : public FrameStatisticsSummary<T>
+{
+public:
+    void AddFrame(uint64_t sequence, T const& frameStatistics);
+    void RemoveFrame(uint64_t sequence, T const& frameStatistics);
+    void Refresh();
+
+    float latencyPoseToReceiveAvg = 0.0f;
+    float latencyReceiveToPresentAvg = 0.0f;
+    float latencyPresentToDisplayAvg = 0.0f;
+
+private:
+    double m_latencyPoseToReceiveSum = 0.0;
+    double m_latencyReceiveToPresentSum = 0.0;
+    double m_latencyPresentToDisplaySum = 0.0;
+};
+
+template <class T>
+void StagedLatencySummary<T>::AddFrame(uint64_t sequence, T const& frameStatistics)
+{
+    FrameStatisticsSummary<T>::AddFrame(sequence, frameStatistics);
+    m_latencyPoseToReceiveSum += frameStatistics.LatencyPoseToReceive;
+    m_latencyReceiveToPresentSum += frameStatistics.LatencyReceiveToPresent;
+    m_latencyPresentToDisplaySum += frameStatistics.LatencyPresentToDisplay;
+}
+
+template <class T>
+void StagedLatencySummary<T>::RemoveFrame(uint64_t sequence, T const& frameStatistics)
+{
+    FrameStatisticsSummary<T>::RemoveFrame(sequence, frameStatistics);
+    m_latencyPoseToReceiveSum -= frameStatistics.LatencyPoseToReceive;
+    m_latencyReceiveToPresentSum -= frameStatistics.LatencyReceiveToPresent;
+    m_latencyPresentToDisplaySum -= frameStatistics.LatencyPresentToDisplay;
+}
+
+template <class T>
+void StagedLatencySummary<T>::Refresh()
+{
+    FrameStatisticsSummary<T>::Refresh();
+
+    const double frameCount = this->frameStatsCount > 0 ? static_cast<double>(this->frameStatsCount) : 1.0;
+    latencyPoseToReceiveAvg = static_cast<float>(m_latencyPoseToReceiveSum / frameCount);
+    latencyReceiveToPresentAvg = static_cast<float>(m_latencyReceiveToPresentSum / frameCount);
+    latencyPresentToDisplayAvg = static_cast<float>(m_latencyPresentToDisplaySum / frameCount);
+}
+
+// Percentiles of a LatencyHistogram in seconds.
+struct LatencyPercentiles
+{
+    float p50 = 0.0f;
+    float p90 = 0.0f;
+    float p99 = 0.0f;
+    float p999 = 0.0f;
+
+    LatencyPercentiles() = default;
+
+    explicit LatencyPercentiles(LatencyHistogram const& histogram)
+        : p50(histogram.GetPercentile(0.5))
+        , p90(histogram.GetPercentile(0.9))
+        , p99(histogram.GetPercentile(0.99))
+        , p999(histogram.GetPercentile(0.999))
+    {
+    }
+
+    // Writes the percentiles in milliseconds.
+    void Write(std::wostream& stream) const
+    {
+        stream << p50 * 1000 << L" / " << p90 * 1000 << L" / " << p99 * 1000 << L" / " << p999 * 1000 << L" ms (p50/p90/p99/p99.9)";
+    }
+};
+
+// Summary which in addition to the values of Base records the distribution of the latency, the render frame time and the
+// video frame deltas of its window in fixed memory histograms, and reports their percentiles.
+template <class T, class Base = StatisticsHelperSummary<T>>
+class StatisticsHelperPercentileSummary : public Base
+{
+public:
+    using Percentiles = LatencyPercentiles;
+
+    // The reported values of Base and the percentiles, without the histograms.
+    struct Report
+    {
+        typename Base::Report base;
+        Percentiles latency;
+        Percentiles timeSinceLastPresent;
+        Percentiles videoFrameDelta;
+
+        std::wstring ToWString() const;
+    };
+
+    void AddFrame(uint64_t sequence, T const& frameStatistics);
+    void RemoveFrame(uint64_t sequence, T const& frameStatistics);
+
+    void GetReport(Report& report) const
+    {
+        Base::GetReport(report.base);
+        report.latency = GetLatencyPercentiles();
+        report.timeSinceLastPresent = GetTimeSinceLastPresentPercentiles();
+        report.videoFrameDelta = GetVideoFrameDeltaPercentiles();
+    }
+
+    std::wstring ToWString() const
+    {
+        Report report;
+        GetReport(report);
+        return report.ToWString();
+    }
+
+    // Percentiles are computed on request, which keeps Refresh O(1).
+    Percentiles GetLatencyPercentiles() const
+    {
+        return Percentiles(m_latency);
+    }
+
+    Percentiles GetTimeSinceLastPresentPercentiles() const
+    {
+        return Percentiles(m_timeSinceLastPresent);
+    }
+
+    Percentiles GetVideoFrameDeltaPercentiles() const
+    {
+        return Percentiles(m_videoFrameDelta);
+    }
+
+    LatencyHistogram const& GetLatencyHistogram() const
+    {
+        return m_latency;
+    }
+
+private:
+    template <class Function>
+    void ForEachVideoFrameDelta(T const& frameStatistics, Function&& function)
+    {
+        if (frameStatistics.VideoFramesReceived > 0)
+        {
+            function(frameStatistics.VideoFrameMaxDelta);
+            if (frameStatistics.VideoFramesReceived > 1)
+            {
+                function(frameStatistics.VideoFrameMinDelta);
+            }
+        }
+    }
+
+    LatencyHistogram m_latency;
+    LatencyHistogram m_timeSinceLastPresent;
+    LatencyHistogram m_videoFrameDelta;
+};
+
+template <class T, class Base>
+void StatisticsHelperPercentileSummary<T, Base>::AddFrame(uint64_t sequence, T const& frameStatistics)
+{
+    Base::AddFrame(sequence, frameStatistics);
+
+    m_latency.Record(FrameLatency<T>::Get(frameStatistics));
+    m_timeSinceLastPresent.Record(frameStatistics.TimeSinceLastPresent);
+    ForEachVideoFrameDelta(frameStatistics, [this](float delta) { m_videoFrameDelta.Record(delta); });
+}
+
+template <class T, class Base>
+void StatisticsHelperPercentileSummary<T, Base>::RemoveFrame(uint64_t sequence, T const& frameStatistics)
+{
+    Base::RemoveFrame(sequence, frameStatistics);
+
+    m_latency.Remove(FrameLatency<T>::Get(frameStatistics));
+    m_timeSinceLastPresent.Remove(frameStatistics.TimeSinceLastPresent);
+    ForEachVideoFrameDelta(frameStatistics, [this](float delta) { m_videoFrameDelta.Remove(delta); });
+}
+
+template <class T, class Base>
+std::wstring StatisticsHelperPercentileSummary<T, Base>::Report::ToWString() const
+{
+    std::wstringstream statisticsStringStream;
+    statisticsStringStream.precision(3);
+    statisticsStringStream << base.ToWString() << L"Latency: ";
+    latency.Write(statisticsStringStream);
+    statisticsStringStream << std::endl << L"Render: ";
+    timeSinceLastPresent.Write(statisticsStringStream);
+    statisticsStringStream << std::endl << L"Video frames delta: ";
+    videoFrameDelta.Write(statisticsStringStream);
+    statisticsStringStream << std::endl;
+
+    return statisticsStringStream.str();
+}
+
+// StatisticsHelper which in addition records the latency of all frames of the session in one histogram, which is never
+// evicted. The histogram is kept once by the helper rather than by the summary of every window.
+template <class T, class Summary = StatisticsHelperPercentileSummary<T>, class Clock = std::chrono::steady_clock>
+class PercentileStatisticsHelper : public StatisticsHelper<T, Summary, Clock>
+{
+    using Base = StatisticsHelper<T, Summary, Clock>;
+
+public:
+    // Reported values of the primary window and the session latency, copied so that they can be formatted on another thread.
+    // Only holds plain values, the window state and the histograms stay with the helper.
+    struct Snapshot
+    {
+        typename Summary::Report summary;
+        LatencyPercentiles sessionLatency;
+
+        std::wstring ToWString() const;
+    };
+
+    using Base::Base;
+
+    void Update(const T& frameStatistics)
+    {
+        Update(frameStatistics, Clock::now());
+    }
+
+    void Update(const T& frameStatistics, typename Base::TimePoint now)
+    {
+        m_sessionLatency.Record(FrameLatency<T>::Get(frameStatistics));
+        Base::Update(frameStatistics, now);
+    }
+
+    // Returns the statistics of the primary window and the session latency as string.
+    std::wstring GetStatisticsString() const
+    {
+        Snapshot snapshot;
+        GetStatisticsSnapshot(snapshot);
+        return snapshot.ToWString();
+    }
+
+    void GetStatisticsSnapshot(Snapshot& snapshot) const
+    {
+        static_assert(std::is_trivially_copyable_v<typename Summary::Report>, "snapshots are copied on the render thread");
+        Base::GetStatisticsSummary().GetReport(snapshot.summary);
+        snapshot.sessionLatency = GetSessionLatencyPercentiles();
+    }
+
+    // Percentiles are computed on request, which keeps Update O(1).
+    LatencyPercentiles GetSessionLatencyPercentiles() const
+    {
+        return LatencyPercentiles(m_sessionLatency);
+    }
+
+    LatencyHistogram const& GetSessionLatencyHistogram() const
+    {
+        return m_sessionLatency;
+    }
+
+private:
+    LatencyHistogram m_sessionLatency;
+};
+
+template <class T, class Summary, class Clock>
+std::wstring PercentileStatisticsHelper<T, Summary, Clock>::Snapshot::ToWString() const
+{
+    std::wstringstream statisticsStringStream;
+    statisticsStringStream.precision(3);
+    statisticsStringStream << summary.ToWString() << L"Session latency: ";
+    sessionLatency.Write(statisticsStringStream);
+    statisticsStringStream << std::endl;
+
+    return statisticsStringStream.str();
+}
@@ -0,0 +1,118 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace
+{
+    constexpr uint32_t LinearBucketCount = 1u << LatencyHistogram::SignificantBits;
+    constexpr uint32_t SubBucketCount = LinearBucketCount / 2;
+} // namespace
+
+void LatencyHistogram::Record(float seconds)
+{
+    m_buckets[BucketIndex(ToMicroseconds(seconds))]++;
+    m_count++;
+}
+
+void LatencyHistogram::Remove(float seconds)
+{
+    uint32_t& bucket = m_buckets[BucketIndex(ToMicroseconds(seconds))];
+    if (bucket > 0)
+    {
+        bucket--;
+        m_count--;
+    }
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other)
+{
+    for (uint32_t i = 0; i < BucketCount; ++i)
+    {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+}
+
+void LatencyHistogram::Reset()
+{
+    m_buckets.fill(0);
+    m_count = 0;
+}
+
+float LatencyHistogram::GetPercentile(double fraction) const
+{
+    if (m_count == 0)
+    {
+        return 0.0f;
+    }
+
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * m_count)));
+
+    uint64_t cumulativeCount = 0;
+    uint32_t bucketIndex = 0;
+    for (; bucketIndex < BucketCount - 1; ++bucketIndex)
+    {
+        cumulativeCount += m_buckets[bucketIndex];
+        if (cumulativeCount >= rank)
+        {
+            break;
+        }
+    }
+
+    // Report the middle of the bucket.
+    const uint32_t lowerBound = BucketLowerBound(bucketIndex);
+    const uint32_t upperBound = BucketLowerBound(bucketIndex + 1);
+    return (lowerBound + 0.5f * (upperBound - lowerBound)) * 1e-6f;
+}
+
+uint32_t LatencyHistogram::BucketIndex(uint32_t microseconds)
+{
+    if (microseconds < LinearBucketCount)
+    {
+        return microseconds;
+    }
+
+    const uint32_t exponent = static_cast<uint32_t>(std::bit_width(microseconds)) - 1;
+    if (exponent >= MaxExponent)
+    {
+        return BucketCount - 1;
+    }
+
+    const uint32_t shift = exponent - SignificantBits + 1;
+    return shift * SubBucketCount + (microseconds >> shift);
+}
+
+uint32_t LatencyHistogram::BucketLowerBound(uint32_t bucketIndex)
+{
+    if (bucketIndex < LinearBucketCount)
+    {
+        return bucketIndex;
+    }
+
+    const uint32_t shift = bucketIndex / SubBucketCount - 1;
+    return (bucketIndex % SubBucketCount + SubBucketCount) << shift;
+}
+
+uint32_t LatencyHistogram::ToMicroseconds(float seconds)
+{
+    if (!(seconds > 0.0f))
+    {
+        return 0;
+    }
+
+    const double microseconds = seconds * 1e6 + 0.5;
+    return microseconds < static_cast<double>(UINT32_MAX) ? static_cast<uint32_t>(microseconds) : UINT32_MAX;
+}
@@ -0,0 +1,58 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Fixed memory histogram of durations with log-linear buckets (HDR histogram layout).
+// Durations are recorded with microsecond resolution. Values below 64us get their own bucket, larger values share a bucket
+// with all values of the same 6 most significant bits, which bounds the relative error of reported percentiles to ~1.6%.
+// Recording is O(1) and never allocates. Histograms can be merged to summarize longer horizons.
+class LatencyHistogram
+{
+public:
+    // Number of most significant bits that determine the bucket.
+    static constexpr uint32_t SignificantBits = 6;
+    // Durations of 2^MaxExponent microseconds (~134s) and above are recorded in the last bucket.
+    static constexpr uint32_t MaxExponent = 27;
+    static constexpr uint32_t BucketCount = (MaxExponent - SignificantBits + 2) << (SignificantBits - 1);
+
+    // Records a duration given in seconds.
+    void Record(float seconds);
+
+    // Removes a duration previously recorded with Record.
+    void Remove(float seconds);
+
+    // Adds all values recorded in other.
+    void Merge(const LatencyHistogram& other);
+
+    void Reset();
+
+    uint64_t GetCount() const
+    {
+        return m_count;
+    }
+
+    // Returns the value in seconds below which the given fraction (0..1) of the recorded values fall,
+    // or 0 if the histogram is empty.
+    float GetPercentile(double fraction) const;
+
+    static uint32_t BucketIndex(uint32_t microseconds);
+    static uint32_t BucketLowerBound(uint32_t bucketIndex);
+
+private:
+    static uint32_t ToMicroseconds(float seconds);
+
+    std::array<uint32_t, BucketCount> m_buckets{};
+    uint64_t m_count = 0;
+};
@@ -0,0 +1,94 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer handing the latest value of T from one writer thread to one reader thread.
+// The writer fills the back buffer and publishes it by swapping it with the middle buffer, the reader takes the middle
+// buffer by swapping it with the front buffer. Neither side ever blocks or waits for the other, and a reader only sees
+// completely written values. Values published while the reader does not pick them up are overwritten by newer ones.
+// Buffers are reused, so a T which keeps its capacity on assignment (like std::vector or std::wstring) does not allocate
+// once all three buffers have reached their final size.
+template <class T>
+class SnapshotPublisher
+{
+public:
+    SnapshotPublisher() = default;
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // Writer: returns the buffer to fill before calling Publish. Its content is the value published two calls ago.
+    T& GetWriteBuffer()
+    {
+        return m_buffers[m_writeIndex].value;
+    }
+
+    // Writer: makes the content of the write buffer the latest snapshot.
+    void Publish()
+    {
+        const uint32_t previous = m_middle.exchange(m_writeIndex | NewSnapshotBit, std::memory_order_acq_rel);
+        m_writeIndex = previous & IndexMask;
+    }
+
+    void Publish(const T& value)
+    {
+        GetWriteBuffer() = value;
+        Publish();
+    }
+
+    // Reader: returns true if a snapshot was published since the last call of Update.
+    bool HasNewSnapshot() const
+    {
+        return (m_middle.load(std::memory_order_relaxed) & NewSnapshotBit) != 0;
+    }
+
+    // Reader: takes the latest snapshot, if there is a new one, and returns true in that case.
+    bool Update()
+    {
+        if (!HasNewSnapshot())
+        {
+            return false;
+        }
+
+        const uint32_t previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = previous & IndexMask;
+        return true;
+    }
+
+    // Reader: returns the snapshot taken by the last successful Update, or a default constructed T before that.
+    // The reference stays valid and unchanged until the next call of Update.
+    const T& Read() const
+    {
+        return m_buffers[m_readIndex].value;
+    }
+
+private:
+    static constexpr uint32_t IndexMask = 0x3;
+    static constexpr uint32_t NewSnapshotBit = 0x4;
+
+    // Each buffer gets its own cache lines so that the writer and the reader do not contend on them.
+    struct alignas(64) Buffer
+    {
+        T value{};
+    };
+
+    Buffer m_buffers[3];
+
+    // Index of the middle buffer, plus NewSnapshotBit if it has not been taken by the reader yet.
+    alignas(64) std::atomic<uint32_t> m_middle = 1;
+
+    // Owned by the writer and the reader respectively.
+    alignas(64) uint32_t m_writeIndex = 0;
+    alignas(64) uint32_t m_readIndex = 2;
+};
@@ -0,0 +1,283 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Helper class producing and storing statistics summary values
+// Template type of input data
+template <class T>
+class StatisticsHelperSummary;
+
+// Queue of (sequence, value) pairs which keeps only the values that can still become the extremum of a sliding window.
+// With Compare = std::greater<> the front is the maximum of the window, with std::less<> the minimum.
+// Values have to be pushed and evicted in sequence order. All operations are amortized O(1) and do not allocate.
+template <class V, class Compare>
+class MonotonicWindowQueue
+{
+public:
+    void Initialize(size_t capacity)
+    {
+        m_entries.resize(capacity);
+        Clear();
+    }
+
+    void Clear()
+    {
+        m_first = 0;
+        m_size = 0;
+    }
+
+    bool Empty() const
+    {
+        return m_size == 0;
+    }
+
+    // Returns the extremum of all values in the window.
+    V const& Front() const
+    {
+        return m_entries[m_first].value;
+    }
+
+    void Push(uint64_t sequence, V const& value)
+    {
+        while (m_size > 0 && !Compare()(m_entries[Index(m_size - 1)].value, value))
+        {
+            m_size--;
+        }
+
+        assert(m_size < m_entries.size());
+        m_entries[Index(m_size)] = {sequence, value};
+        m_size++;
+    }
+
+    // Removes the value with the given sequence number, if it is still in the queue.
+    void Evict(uint64_t sequence)
+    {
+        if (m_size > 0 && m_entries[m_first].sequence == sequence)
+        {
+            m_first = Index(1);
+            m_size--;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t sequence;
+        V value;
+    };
+
+    size_t Index(size_t offset) const
+    {
+        const size_t index = m_first + offset;
+        return index < m_entries.size() ? index : index - m_entries.size();
+    }
+
+    std::vector<Entry> m_entries;
+    size_t m_first = 0;
+    size_t m_size = 0;
+};
+
+// Helper class aggregating frame statistics over sliding time windows (by default 250ms, 1s and 10s),
+// producing summary values which can be presented as readable strings.
+// Frames are stored in a ring buffer which is allocated once. When a frame is added, it is added to the summary of every
+// window, and all frames which fell out of a window are removed from its summary again, so the summaries are always
+// up to date and each update costs O(1) per window.
+// Each window holds at most its length times maxFrameRate frames. Above that frame rate a window only holds its newest
+// frames and covers less time than its length, so the frame count of the 1s window stops being the frame rate.
+// Template arguments allow to use different input types `T`, Summary types `Summary` and clocks `Clock`.
+// A Summary has to provide:
+//   void Initialize(size_t capacity);                    // capacity is the maximal number of frames in a window
+//   void AddFrame(uint64_t sequence, T const& frame);
+//   void RemoveFrame(uint64_t sequence, T const& frame); // called in the same order as AddFrame
+//   void Refresh();                                       // updates derived values after frames were added or removed
+//   std::wstring ToWString() const;
+template <class T, class Summary = StatisticsHelperSummary<T>, class Clock = std::chrono::steady_clock>
+class StatisticsHelper
+{
+public:
+    typedef Summary SummaryType;
+    using TimePoint = typename Clock::time_point;
+    using Duration = typename Clock::duration;
+
+    // Highest frame rate at which the windows hold all frames of their length, above the refresh rates of current headsets
+    // and desktop displays. The default windows then store 2400 frames.
+    static constexpr uint32_t DefaultMaxFrameRate = 240;
+
+    StatisticsHelper();
+
+    // Creates windows of the given lengths. The window at primaryWindowIndex is used for GetStatisticsString and
+    // GetStatisticsSummary, and its length is the interval in which StatisticsHaveChanged reports a change.
+    StatisticsHelper(
+        std::initializer_list<Duration> windowLengths, size_t primaryWindowIndex, uint32_t maxFrameRate = DefaultMaxFrameRate);
+
+    // Returns the statistics of the primary window as string.
+    inline std::wstring GetStatisticsString() const
+    {
+        return GetStatisticsSummary().ToWString();
+    }
+
+    inline Summary const& GetStatisticsSummary() const
+    {
+        return m_windows[m_primaryWindowIndex].summary;
+    }
+
+    inline Summary const& GetStatisticsSummary(size_t windowIndex) const
+    {
+        return m_windows[windowIndex].summary;
+    }
+
+    inline size_t GetWindowCount() const
+    {
+        return m_windows.size();
+    }
+
+    inline Duration GetWindowLength(size_t windowIndex) const
+    {
+        return m_windows[windowIndex].length;
+    }
+
+    // Returns the maximal number of frames in the window.
+    inline size_t GetWindowCapacity(size_t windowIndex) const
+    {
+        return m_windows[windowIndex].capacity;
+    }
+
+    // Updates the statistics with the provided statistics data.
+    void Update(const T& frameStatistics)
+    {
+        Update(frameStatistics, Clock::now());
+    }
+
+    void Update(const T& frameStatistics, TimePoint now);
+
+    // Returns true once per length of the primary window, to limit how often the statistics are presented.
+    inline bool StatisticsHaveChanged() const
+    {
+        return m_statsHasChanged;
+    }
+
+private:
+    struct Frame
+    {
+        TimePoint time;
+        T statistics;
+    };
+
+    struct Window
+    {
+        Duration length;
+        size_t capacity = 0;
+        // Sequence number of the oldest frame in the window.
+        uint64_t oldestSequence = 0;
+        Summary summary;
+    };
+
+    Frame const& GetFrame(uint64_t sequence) const
+    {
+        return m_frames[static_cast<size_t>(sequence % m_frames.size())];
+    }
+
+    std::vector<Frame> m_frames;
+    std::vector<Window> m_windows;
+    size_t m_primaryWindowIndex = 0;
+    uint64_t m_nextSequence = 0;
+
+    bool m_hasUpdated = false;
+    TimePoint m_nextChangeTime;
+    bool m_statsHasChanged = true;
+};
+
+template <class T, class Summary, class Clock>
+StatisticsHelper<T, Summary, Clock>::StatisticsHelper()
+    : StatisticsHelper({std::chrono::milliseconds(250), std::chrono::seconds(1), std::chrono::seconds(10)}, 1)
+{
+}
+
+template <class T, class Summary, class Clock>
+StatisticsHelper<T, Summary, Clock>::StatisticsHelper(
+    std::initializer_list<Duration> windowLengths, size_t primaryWindowIndex, uint32_t maxFrameRate)
+    : m_windows(windowLengths.size())
+    , m_primaryWindowIndex(primaryWindowIndex)
+{
+    assert(maxFrameRate > 0 && primaryWindowIndex < windowLengths.size());
+
+    size_t windowIndex = 0;
+    size_t frameCapacity = 1;
+    for (Duration length : windowLengths)
+    {
+        Window& window = m_windows[windowIndex];
+        window.length = length;
+        window.capacity = std::max<size_t>(
+            1, static_cast<size_t>(std::ceil(std::chrono::duration<double>(length).count() * static_cast<double>(maxFrameRate))));
+        window.summary.Initialize(window.capacity);
+        frameCapacity = std::max(frameCapacity, window.capacity);
+        windowIndex++;
+    }
+    m_frames.resize(frameCapacity);
+}
+
+template <class T, class Summary, class Clock>
+void StatisticsHelper<T, Summary, Clock>::Update(const T& frameStatistics, TimePoint now)
+{
+    m_statsHasChanged = false;
+    if (!m_hasUpdated)
+    {
+        m_hasUpdated = true;
+        m_nextChangeTime = now + m_windows[m_primaryWindowIndex].length;
+    }
+    else if (now >= m_nextChangeTime)
+    {
+        m_statsHasChanged = true;
+        do
+        {
+            m_nextChangeTime += m_windows[m_primaryWindowIndex].length;
+        } while (now >= m_nextChangeTime);
+    }
+
+    // A full window drops its oldest frame. This happens before the new frame is stored, as it can take the ring buffer slot
+    // of that frame.
+    const uint64_t sequence = m_nextSequence++;
+    for (Window& window : m_windows)
+    {
+        if (sequence - window.oldestSequence == window.capacity)
+        {
+            window.summary.RemoveFrame(window.oldestSequence, GetFrame(window.oldestSequence).statistics);
+            window.oldestSequence++;
+        }
+    }
+
+    Frame& frame = m_frames[static_cast<size_t>(sequence % m_frames.size())];
+    frame.time = now;
+    frame.statistics = frameStatistics;
+
+    for (Window& window : m_windows)
+    {
+        window.summary.AddFrame(sequence, frame.statistics);
+
+        while (window.oldestSequence < sequence && now - GetFrame(window.oldestSequence).time >= window.length)
+        {
+            window.summary.RemoveFrame(window.oldestSequence, GetFrame(window.oldestSequence).statistics);
+            window.oldestSequence++;
+        }
+
+        window.summary.Refresh();
+    }
+}
@@ -19,6 +19,7 @@
 #include <sstream>
 
 #include <winrt/Windows.Foundation.Metadata.h>
+#include <winrt/Windows.Storage.h>
 #include <winrt/Windows.Ui.Popups.h>
 
 using namespace std::chrono_literals;
@@ -45,6 +46,16 @@ SamplePlayerMain::SamplePlayerMain()
         L"Windows.Graphics.Holographic.HolographicCameraRenderingParameters", L"CommitDirect3D11DepthBuffer");
 
     m_ipAddressUpdater = CreateIpAddressUpdater();
+
+    StartStatisticsFormatter();
+
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+    // simple echo ping, sent right away since the remote measures the round trip
+    m_customDataChannelDispatcher.Register(DataChannel::MessageType::Ping, [this](const DataChannel::MessageView&) {
+        m_customDataChannelBatcher.AddMessage(DataChannel::MessageType::Ping, std::chrono::steady_clock::now(), true);
+    });
+    m_customDataChannelStreamReceiver.Register(m_customDataChannelDispatcher);
+#endif
 }
 SamplePlayerMain::~SamplePlayerMain()
 {
@@ -115,6 +126,8 @@ winrt::fire_and_forget SamplePlayerMain::ConnectOrListenAfter(std::chrono::syste
 
 HolographicFrame SamplePlayerMain::Update(float deltaTimeInSeconds, const HolographicFrame& prevHolographicFrame)
 {
+    FRAME_PROFILER_SCOPE("Update");
+
     SpatialCoordinateSystem focusPointCoordinateSystem = nullptr;
     float3 focusPointPosition{0.0f, 0.0f, 0.0f};
 
@@ -147,9 +160,30 @@ HolographicFrame SamplePlayerMain::Update(float deltaTimeInSeconds, const Hologr
     // Update content of the status and error display.
     {
         // Update the accumulated statistics with the statistics from the last frame.
-        m_statisticsHelper.Update(m_playerContext.LastFrameStatistics());
+        const PlayerFrameStatistics frameStatistics = m_playerContext.LastFrameStatistics();
+        m_statisticsHelper.Update(frameStatistics);
+        if (m_frameTrace.IsOpen())
+        {
+            RecordFrameTrace(frameStatistics);
+        }
+
+        // Hand changed statistics over to the formatter thread, and pick up the text it formatted for earlier snapshots.
+        if (m_statisticsHelper.StatisticsHaveChanged() && m_playerOptions.m_showStatistics)
+        {
+            m_statisticsHelper.GetStatisticsSnapshot(m_statisticsSnapshot.GetWriteBuffer());
+            m_statisticsSnapshot.Publish();
+            m_statisticsSnapshotCount.fetch_add(1, std::memory_order_release);
+            m_statisticsSnapshotCount.notify_one();
+        }
+
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+        if (m_statisticsHelper.StatisticsHaveChanged())
+        {
+            UpdateBitrateTarget();
+        }
+#endif
 
-        const bool updateStats = m_statisticsHelper.StatisticsHaveChanged() && m_playerOptions.m_showStatistics;
+        const bool updateStats = m_statisticsText.Update();
         if (updateStats || !m_firstRemoteFrameWasBlitted)
         {
             UpdateStatusDisplay();
@@ -180,6 +214,7 @@ HolographicFrame SamplePlayerMain::Update(float deltaTimeInSeconds, const Hologr
         // Note, we don't wait for the next frame on present which allows us to first update all view independent stuff and also create the
         // next frame before we actually wait. By doing so everything before the wait is executed while the previous frame is presented by
         // the OS and thus saves us quite some CPU time after the wait.
+        FRAME_PROFILER_SCOPE("WaitForNextFrameReady");
         m_deviceResources->WaitForNextFrameReady();
     }
     holographicFrame.UpdateCurrentPrediction();
@@ -212,6 +247,8 @@ HolographicFrame SamplePlayerMain::Update(float deltaTimeInSeconds, const Hologr
 
 void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
 {
+    FRAME_PROFILER_SCOPE("Render");
+
     bool atLeastOneCameraRendered = false;
 
     m_deviceResources->UseHolographicCameraResources(
@@ -291,6 +328,7 @@ void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
                                 // Blit the remote frame into the backbuffer for the HolographicFrame.
                                 // NOTE: This overwrites the focus point for the current frame, if the remote application
                                 // has specified a focus point during the rendering of the remote frame.
+                                FRAME_PROFILER_SCOPE("BlitRemoteFrame");
                                 blitResult = m_playerContext.BlitRemoteFrame();
                             }
                         }
@@ -359,6 +397,7 @@ void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
 
     if (atLeastOneCameraRendered)
     {
+        FRAME_PROFILER_SCOPE("Present");
         m_deviceResources->Present(holographicFrame);
     }
 }
@@ -561,6 +600,14 @@ void SamplePlayerMain::Run()
             CoreWindow::GetForCurrentThread().Dispatcher().ProcessEvents(CoreProcessEventsOption::ProcessOneAndAllPending);
         }
 
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+        {
+            // Queue the batched answers whose latency budget is spent, and send what the channel can take.
+            std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
+            ServiceCustomDataChannel();
+        }
+#endif
+
         timeLastUpdate = timeCurrUpdate;
     }
 }
@@ -571,6 +618,9 @@ void SamplePlayerMain::Uninitialize()
     OnCustomDataChannelClosed();
 #endif
 
+    StopStatisticsFormatter();
+    FrameProfiler::Stop();
+
     m_suspendingEventRevoker.revoke();
     m_viewActivatedRevoker.revoke();
     m_windowClosedEventRevoker.revoke();
@@ -641,6 +691,8 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
     uint16_t port = 0;
     bool listen = false;
     bool showStatistics = false;
+    bool recordTrace = false;
+    bool profile = false;
 
     if (activationArgs != nullptr)
     {
@@ -683,6 +735,16 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
                                 listen = true;
                             }
 
+                            if (param == L"trace")
+                            {
+                                recordTrace = true;
+                            }
+
+                            if (param == L"profile")
+                            {
+                                profile = true;
+                            }
+
                             continue;
                         }
 
@@ -751,6 +813,8 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
         playerOptions.m_listen = listen;
         playerOptions.m_showStatistics = showStatistics;
         playerOptions.m_ipv6 = !hostname.empty() && hostname.front() == L'[';
+        playerOptions.m_recordTrace = recordTrace;
+        playerOptions.m_profile = profile;
     }
     else
     {
@@ -760,6 +824,23 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
     return playerOptions;
 }
 
+void SamplePlayerMain::RecordFrameTrace(const PlayerFrameStatistics& frameStatistics)
+{
+    const FrameTrace::FrameStatisticsRecord record{
+        frameStatistics.TimeSinceLastPresent,
+        frameStatistics.VideoFramesSkipped,
+        frameStatistics.VideoFramesReceived,
+        frameStatistics.VideoFrameReusedCount,
+        frameStatistics.VideoFrameMinDelta,
+        frameStatistics.VideoFrameMaxDelta,
+        frameStatistics.Latency,
+        frameStatistics.VideoFramesDiscarded};
+
+    const auto timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    m_frameTrace.Write(FrameTrace::RecordType::FrameBegin, timestamp);
+    m_frameTrace.Write(FrameTrace::RecordType::FrameStatistics, timestamp, std::span<const FrameTrace::FrameStatisticsRecord>(&record, 1));
+}
+
 void SamplePlayerMain::UpdateStatusDisplay()
 {
     m_statusDisplay->ClearLines();
@@ -820,9 +901,7 @@ void SamplePlayerMain::UpdateStatusDisplay()
         {
             if (m_playerOptions.m_showStatistics)
             {
-                std::wstring statisticsString = m_statisticsHelper.GetStatisticsString();
-
-                StatusDisplay::Line line = {std::move(statisticsString), StatusDisplay::Medium, StatusDisplay::Yellow, 1.0f, true};
+                StatusDisplay::Line line = {m_statisticsText.Read(), StatusDisplay::Medium, StatusDisplay::Yellow, 1.0f, true};
                 m_statusDisplay->AddLine(line);
             }
         }
@@ -831,47 +910,101 @@ void SamplePlayerMain::UpdateStatusDisplay()
     m_errorHelper.Apply(m_statusDisplay);
 }
 
-#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
-void SamplePlayerMain::OnCustomDataChannelDataReceived(winrt::array_view<const uint8_t> dataView)
+void SamplePlayerMain::StartStatisticsFormatter()
 {
-    std::vector<uint8_t> answer;
-    bool alwaysSend = false;
+    m_statisticsFormatterThread = std::jthread([this](std::stop_token stopToken) { FormatStatistics(stopToken); });
+}
 
-    const uint8_t packetType = (dataView.size() > 0) ? dataView[0] : 1;
-    switch (packetType)
+void SamplePlayerMain::StopStatisticsFormatter()
+{
+    if (m_statisticsFormatterThread.joinable())
     {
-        case 1: // simple echo ping
-            answer.resize(1);
-            answer[0] = 1;
-            break;
+        m_statisticsFormatterThread.request_stop();
 
-        default:
-            return; // no answer to unknown packets
+        // Wake up the formatter thread, which waits for the next snapshot.
+        m_statisticsSnapshotCount.fetch_add(1, std::memory_order_release);
+        m_statisticsSnapshotCount.notify_one();
+
+        m_statisticsFormatterThread.join();
     }
+}
 
-    std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
-    if (m_customDataChannel)
+void SamplePlayerMain::FormatStatistics(std::stop_token stopToken)
+{
+    // Formatting is not time critical, it should never take CPU time from the frame loop or the remoting threads.
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+    uint32_t snapshotCount = 0;
+    while (!stopToken.stop_requested())
     {
-        // Get send queue size. The send queue size returns the size of data, that has not been send yet, in bytes. A big number can
-        // indicate that more data is being queued for sending than is actually getting sent. If possible skip sending data in this
-        // case, to help the queue getting smaller again.
-        uint32_t sendQueueSize = m_customDataChannel.SendQueueSize();
+        m_statisticsSnapshotCount.wait(snapshotCount, std::memory_order_acquire);
+        snapshotCount = m_statisticsSnapshotCount.load(std::memory_order_acquire);
 
-        // Only send the packet if the send queue is smaller than 1MiB
-        if (alwaysSend || sendQueueSize < 1 * 1024 * 1024)
+        if (m_statisticsSnapshot.Update())
         {
-            try
-            {
-                m_customDataChannel.SendData(winrt::array_view<const uint8_t>{answer.data(), static_cast<uint32_t>(answer.size())}, true);
-            }
-            catch (...)
-            {
-                // SendData might throw if channel is closed, but we did not get or process the async closed event yet.
-            }
+            m_statisticsText.GetWriteBuffer() = m_statisticsSnapshot.Read().ToWString();
+            m_statisticsText.Publish();
         }
     }
 }
 
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+void SamplePlayerMain::OnCustomDataChannelDataReceived(winrt::array_view<const uint8_t> dataView)
+{
+    const std::span<const uint8_t> packet(dataView.data(), dataView.size());
+
+    std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
+    if (DataChannel::IsLegacyPing(packet))
+    {
+        // Remotes which predate the message protocol expect the single byte ping back, on its own. It is queued as critical
+        // traffic like pose updates, so that it is neither held back by the shaper nor sent past the scheduler.
+        const uint8_t answer = DataChannel::LegacyPingPacket;
+        m_customDataChannelScheduler.EnqueuePacket(DataChannel::TrafficClass::Critical, {&answer, 1}, std::chrono::steady_clock::now());
+        ServiceCustomDataChannel();
+        return;
+    }
+
+    // The handlers answer through m_customDataChannelBatcher, unknown packets get no answer.
+    m_customDataChannelDispatcher.Dispatch(packet);
+    ServiceCustomDataChannel();
+}
+
+void SamplePlayerMain::ServiceCustomDataChannel()
+{
+    if (m_customDataChannel)
+    {
+        // The send queue size is the size of the data which has not been sent yet, in bytes. The scheduler keeps it short, so
+        // that the channel does not queue more data than it actually sends.
+        const auto now = std::chrono::steady_clock::now();
+        m_customDataChannelBatcher.Poll(now);
+        m_customDataChannelScheduler.Service(now, m_customDataChannel.SendQueueSize());
+    }
+}
+
+void SamplePlayerMain::UpdateBitrateTarget()
+{
+    // StatisticsHaveChanged reports once per primary window, so consecutive updates see (about) disjoint windows of frames.
+    const BitrateUpdate update = m_bitrateController.Update(MakeBitrateWindowStatistics(m_statisticsHelper.GetStatisticsSummary()));
+
+    std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
+    if (m_customDataChannel && update.targetKbps != m_reportedBitrateKbps)
+    {
+        m_customDataChannelBatcher.BeginMessage(DataChannel::MessageType::BitrateTarget).Write(update.targetKbps);
+        m_customDataChannelBatcher.EndMessage(std::chrono::steady_clock::now());
+        m_reportedBitrateKbps = update.targetKbps;
+    }
+}
+
+void SamplePlayerMain::OnCustomDataChannelStreamCompleted(
+    uint32_t streamId, DataChannel::MessageType contentType, std::vector<uint8_t>&& payload)
+{
+    // The sample has no content sent as streams. An application hands the payload to the consumer of its content type.
+    const std::wstring text = L"Custom Data Channel: Stream " + std::to_wstring(streamId) + L" of type " +
+                              std::to_wstring(static_cast<uint16_t>(contentType)) + L" received, " + std::to_wstring(payload.size()) +
+                              L" bytes.\n";
+    OutputDebugStringW(text.c_str());
+}
+
 void SamplePlayerMain::OnCustomDataChannelClosed()
 {
     std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
@@ -880,6 +1013,29 @@ void SamplePlayerMain::OnCustomDataChannelClosed()
         m_customChannelDataReceivedEventRevoker.revoke();
         m_customChannelClosedEventRevoker.revoke();
         m_customDataChannel = nullptr;
+        m_customDataChannelBatcher.Clear();
+        m_customDataChannelScheduler.Clear();
+        m_customDataChannelStreamReceiver.Clear();
+        m_reportedBitrateKbps = 0;
+    }
+}
+
+bool SamplePlayerMain::CustomDataChannelTransport::SendPacket(std::span<const uint8_t> packet, bool guaranteedDelivery)
+{
+    if (!m_channel)
+    {
+        return false;
+    }
+
+    try
+    {
+        m_channel.SendData(winrt::array_view<const uint8_t>{packet.data(), static_cast<uint32_t>(packet.size())}, guaranteedDelivery);
+        return true;
+    }
+    catch (...)
+    {
+        // SendData might throw if channel is closed, but we did not get or process the async closed event yet.
+        return false;
     }
 }
 #endif
@@ -962,6 +1118,27 @@ void SamplePlayerMain::OnViewActivated(const CoreApplicationView& sender, const
 
     m_playerOptions = playerOptionsNew;
 
+    if (m_playerOptions.m_recordTrace && !m_frameTrace.IsOpen())
+    {
+        const std::filesystem::path path =
+            std::filesystem::path(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) / L"SamplePlayer.trace";
+        if (!m_frameTrace.Open(path))
+        {
+            m_errorHelper.AddError(L"Failed to create the frame trace " + path.wstring());
+        }
+    }
+
+    if (m_playerOptions.m_profile && !FrameProfiler::IsRecording())
+    {
+        const std::filesystem::path path =
+            std::filesystem::path(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) / L"SamplePlayer.json";
+        FRAME_PROFILER_THREAD_NAME("Main");
+        if (!FrameProfiler::Start(path))
+        {
+            m_errorHelper.AddError(L"Failed to create the frame profile " + path.wstring());
+        }
+    }
+
     if (m_playerContext.ConnectionState() == ConnectionState::Disconnected)
     {
         // Try to connect to or listen on the provided hostname/port
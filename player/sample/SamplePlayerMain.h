@@ -15,16 +15,24 @@
 
 // #define ENABLE_USER_COORDINATE_SYSTEM_SAMPLE
 
+#include "../common/BitrateController.h"
 #include "../common/Content/ErrorHelper.h"
 #include "../common/Content/StatusDisplay.h"
 #include "../common/IpAddressUpdater.h"
 #include "../common/PlayerFrameStatisticsHelper.h"
+#include "../common/SnapshotPublisher.h"
 
 #include <winrt/Microsoft.Holographic.AppRemoting.h>
 
+#include <atomic>
 #include <chrono>
+#include <thread>
 
+#include <DataChannelScheduler.h>
+#include <DataChannelStream.h>
 #include <DeviceResourcesD3D11Holographic.h>
+#include <FrameProfiler.h>
+#include <FrameTrace.h>
 #include <SimpleCubeRenderer.h>
 
 class SamplePlayerMain : public winrt::implements<
@@ -74,6 +82,10 @@ private:
         bool m_listen = true;
         bool m_showStatistics = false;
         bool m_ipv6 = false;
+        // Records the statistics of every frame into a frame trace in the local app data folder (-trace).
+        bool m_recordTrace = false;
+        // Records the timing of the frame phases into a Chrome trace in the local app data folder (-profile).
+        bool m_profile = false;
     };
 
 private:
@@ -86,9 +98,41 @@ private:
     // Setup the text display to show the connection info text
     void UpdateStatusDisplay();
 
+    // Appends the statistics of the last remote frame to the frame trace.
+    void RecordFrameTrace(const winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics& frameStatistics);
+
+    // Statistics formatter thread, which turns published statistics snapshots into text
+    void StartStatisticsFormatter();
+    void StopStatisticsFormatter();
+    void FormatStatistics(std::stop_token stopToken);
+
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
     void OnCustomDataChannelDataReceived(winrt::array_view<const uint8_t> dataView);
     void OnCustomDataChannelClosed();
+
+    // Sends the queued answers the custom data channel can take. Requires m_customDataChannelLock.
+    void ServiceCustomDataChannel();
+
+    // Feeds the primary statistics window to m_bitrateController and reports a changed target to the remote.
+    void UpdateBitrateTarget();
+
+    // Called with the payload of a stream once all its chunks were received.
+    void OnCustomDataChannelStreamCompleted(uint32_t streamId, DataChannel::MessageType contentType, std::vector<uint8_t>&& payload);
+
+    // Sends the packets of the custom data channel scheduler over the custom data channel.
+    class CustomDataChannelTransport : public DataChannel::IPacketTransport
+    {
+    public:
+        explicit CustomDataChannelTransport(const winrt::Microsoft::Holographic::AppRemoting::IDataChannel2& channel)
+            : m_channel(channel)
+        {
+        }
+
+        bool SendPacket(std::span<const uint8_t> packet, bool guaranteedDelivery) override;
+
+    private:
+        const winrt::Microsoft::Holographic::AppRemoting::IDataChannel2& m_channel;
+    };
 #endif
 
     // PlayerContext event handlers
@@ -153,11 +197,38 @@ private:
     PlayerFrameStatisticsHelper m_statisticsHelper;
     ErrorHelper m_errorHelper;
 
+    // Hands the statistics summary from the frame loop to the formatter thread, and the formatted text back to the frame loop,
+    // so that the frame loop neither formats strings nor takes locks for the statistics display.
+    SnapshotPublisher<PlayerFrameStatisticsHelper::Snapshot> m_statisticsSnapshot;
+    SnapshotPublisher<std::wstring> m_statisticsText;
+    std::atomic<uint32_t> m_statisticsSnapshotCount = 0;
+    std::jthread m_statisticsFormatterThread;
+
+    // Frame trace, open if requested with -trace, so that the statistics can be replayed by the benchmarks.
+    FrameTrace::TraceWriter m_frameTrace;
+
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
     std::mutex m_customDataChannelLock;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2 m_customDataChannel = nullptr;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2::OnDataReceived_revoker m_customChannelDataReceivedEventRevoker;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2::OnClosed_revoker m_customChannelClosedEventRevoker;
+    DataChannel::MessageDispatcher m_customDataChannelDispatcher;
+    // The batcher coalesces the answers sent within its latency budget and queues its packets as interactive traffic in the
+    // scheduler, which paces them to what the channel drains. Both are serviced once per frame and after each received packet,
+    // and guarded by m_customDataChannelLock.
+    CustomDataChannelTransport m_customDataChannelTransport{m_customDataChannel};
+    DataChannel::MessageScheduler m_customDataChannelScheduler{m_customDataChannelTransport, std::chrono::steady_clock::now()};
+    DataChannel::ScheduledTransport m_customDataChannelBatcherTransport{
+        m_customDataChannelScheduler, DataChannel::TrafficClass::Interactive};
+    DataChannel::MessageBatcher m_customDataChannelBatcher{m_customDataChannelBatcherTransport};
+    // Reassembles the streams sent by the remote, registered with m_customDataChannelDispatcher.
+    DataChannel::StreamReceiver m_customDataChannelStreamReceiver{
+        std::bind_front(&SamplePlayerMain::OnCustomDataChannelStreamCompleted, this)};
+
+    // Picks the video bitrate from the statistics of each window. Only used on the frame loop. The target last sent to the
+    // remote is guarded by m_customDataChannelLock, 0 if it was not sent on the current channel yet.
+    BitrateController m_bitrateController;
+    uint32_t m_reportedBitrateKbps = 0;
 #endif
 
     // Indicates that tracking has been lost
@@ -11,27 +11,12 @@
 
 #pragma once
 
-#include <strsafe.h>
+#include <AsyncLog.h>
 
-static void DebugLog(_In_z_ LPCWSTR format, ...)
+// Logs a printf formatted message. The message is formatted and written to the debugger (and the log file) by the background
+// thread of AsyncLog once it is started, see AsyncLog.h. format must be a string literal, a trailing line break is optional.
+template <size_t N, typename... Args>
+void DebugLog(const char (&format)[N], const Args&... args)
 {
-    wchar_t buffer[1024];
-    LPWSTR bufEnd = nullptr;
-
-    va_list args;
-    va_start(args, format);
-    HRESULT hr =
-        StringCchVPrintfExW(buffer, _countof(buffer), &bufEnd, nullptr, STRSAFE_FILL_BEHIND_NULL | STRSAFE_FILL_ON_FAILURE, format, args);
-
-    if (SUCCEEDED(hr))
-    {
-        if (*bufEnd != L'\n')
-        {
-            StringCchCatW(buffer, _countof(buffer), L"\r\n");
-        }
-
-        OutputDebugStringW(buffer);
-    }
-
-    va_end(args);
+    AsyncLog::Write(format, args...);
 }
@@ -0,0 +1,198 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <JobPool.h>
+
+#include <algorithm>
+#include <latch>
+
+namespace
+{
+    // Pool and index of the worker running on the current thread.
+    thread_local const JobPool* t_workerPool = nullptr;
+    thread_local uint32_t t_workerIndex = JobPool::InvalidWorkerIndex;
+} // namespace
+
+JobPool::JobPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        threadCount = std::max(1u, threadCount);
+    }
+
+    m_queues.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back([this, i]() { WorkerMain(i); });
+    }
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_jobQueued.notify_all();
+
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void JobPool::Submit(Job job)
+{
+    uint32_t queueIndex = GetCurrentWorkerIndex();
+    if (queueIndex == InvalidWorkerIndex)
+    {
+        queueIndex = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % GetThreadCount();
+    }
+
+    m_pendingJobCount.fetch_add(1, std::memory_order_relaxed);
+    {
+        WorkerQueue& queue = *m_queues[queueIndex];
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    // Pairs with the sleeping worker, which increments m_sleepingCount before it checks m_queuedJobCount: either the worker
+    // sees the job, or this sees the sleeping worker. Taking the mutex makes sure the worker is waiting before it is notified.
+    m_queuedJobCount.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleepingCount.load(std::memory_order_seq_cst) > 0)
+    {
+        {
+            std::lock_guard lock(m_sleepMutex);
+        }
+        m_jobQueued.notify_one();
+    }
+}
+
+void JobPool::WaitIdle()
+{
+    if (m_pendingJobCount.load(std::memory_order_acquire) == 0)
+    {
+        return;
+    }
+    std::unique_lock lock(m_sleepMutex);
+    m_idle.wait(lock, [this]() { return m_pendingJobCount.load(std::memory_order_acquire) == 0; });
+}
+
+void JobPool::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& job)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    batchSize = std::max<size_t>(1, batchSize);
+    const size_t batchCount = (count + batchSize - 1) / batchSize;
+
+    std::latch done(static_cast<std::ptrdiff_t>(batchCount));
+    for (size_t begin = 0; begin < count; begin += batchSize)
+    {
+        const size_t end = std::min(count, begin + batchSize);
+        Submit([&job, &done, begin, end]() {
+            job(begin, end);
+            done.count_down();
+        });
+    }
+    done.wait();
+}
+
+uint32_t JobPool::GetCurrentWorkerIndex() const
+{
+    return t_workerPool == this ? t_workerIndex : InvalidWorkerIndex;
+}
+
+void JobPool::WorkerMain(uint32_t workerIndex)
+{
+    t_workerPool = this;
+    t_workerIndex = workerIndex;
+
+    Job job;
+    while (true)
+    {
+        if (TryPopOrSteal(workerIndex, job))
+        {
+            m_queuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+
+            job();
+            job = nullptr;
+
+            if (m_pendingJobCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                {
+                    std::lock_guard lock(m_sleepMutex);
+                }
+                m_idle.notify_all();
+            }
+            continue;
+        }
+
+        // The queues looked empty, but a job can have been pushed behind the queue this worker checked last, or another worker
+        // took a job and did not count it yet. Try again until the count says that no job is left.
+        if (m_queuedJobCount.load(std::memory_order_seq_cst) > 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock lock(m_sleepMutex);
+        m_sleepingCount.fetch_add(1, std::memory_order_seq_cst);
+        m_jobQueued.wait(lock, [this]() { return m_queuedJobCount.load(std::memory_order_seq_cst) > 0 || m_stopping; });
+        m_sleepingCount.fetch_sub(1, std::memory_order_relaxed);
+        if (m_queuedJobCount.load(std::memory_order_seq_cst) <= 0)
+        {
+            // stopping and all jobs were taken
+            break;
+        }
+    }
+
+    t_workerPool = nullptr;
+    t_workerIndex = InvalidWorkerIndex;
+}
+
+bool JobPool::TryPopOrSteal(uint32_t workerIndex, Job& job)
+{
+    {
+        WorkerQueue& queue = *m_queues[workerIndex];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            return true;
+        }
+    }
+
+    const uint32_t threadCount = GetThreadCount();
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        WorkerQueue& queue = *m_queues[(workerIndex + i) % threadCount];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
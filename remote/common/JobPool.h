@@ -0,0 +1,96 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running jobs, with one job queue per worker.
+// Workers run the newest job of their own queue first and steal the oldest job of another worker's queue when their own queue
+// is empty, so bursts of jobs submitted to one worker spread over all workers. Workers sleep while no job is queued.
+// Jobs submitted from a worker go to that worker's queue, jobs submitted from other threads are distributed round robin.
+// Submitting, taking and finishing a job only touch atomic counters and the lock of one worker queue. The pool mutex is only
+// taken to put a thread to sleep and to wake it up.
+class JobPool
+{
+public:
+    using Job = std::function<void()>;
+
+    static constexpr uint32_t InvalidWorkerIndex = ~0u;
+
+    // Starts threadCount workers, or one less than the number of hardware threads (at least one) if threadCount is 0.
+    explicit JobPool(uint32_t threadCount = 0);
+
+    // Runs all queued jobs and joins the workers.
+    ~JobPool();
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    void Submit(Job job);
+
+    // Blocks until all submitted jobs have finished. Must not be called from a worker.
+    void WaitIdle();
+
+    // Splits [0, count) into ranges of at most batchSize items, runs job(begin, end) for each range on the workers and blocks
+    // until all ranges are done. Only waits for its own ranges, other jobs may keep running. Must not be called from a worker.
+    void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& job);
+
+    uint32_t GetThreadCount() const
+    {
+        // the queues are complete before the first worker starts, unlike m_threads
+        return static_cast<uint32_t>(m_queues.size());
+    }
+
+    // Returns the index of the calling worker of this pool, or InvalidWorkerIndex if called from another thread.
+    uint32_t GetCurrentWorkerIndex() const;
+
+    // Returns true once the pool is being destroyed. Jobs which wait for other threads should give up then.
+    bool IsStopping() const
+    {
+        return m_stopping.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void WorkerMain(uint32_t workerIndex);
+    bool TryPopOrSteal(uint32_t workerIndex, Job& job);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<uint32_t> m_nextQueue = 0;
+    std::atomic<bool> m_stopping = false;
+
+    // Jobs in the queues. Incremented after a job was pushed, so it can briefly be negative when a worker takes the job first.
+    alignas(64) std::atomic<int64_t> m_queuedJobCount = 0;
+    // Jobs submitted and not finished yet. WaitIdle waits for it to become 0.
+    alignas(64) std::atomic<uint64_t> m_pendingJobCount = 0;
+
+    // Workers which found no job sleep on m_jobQueued, WaitIdle sleeps on m_idle. Submit only takes the mutex to wake a worker
+    // if m_sleepingCount is not 0, a worker only takes it to wake WaitIdle when it finished the last pending job.
+    alignas(64) std::atomic<uint32_t> m_sleepingCount = 0;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_jobQueued;
+    std::condition_variable m_idle;
+};
@@ -0,0 +1,101 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <RingBufferAllocator.h>
+
+namespace
+{
+    size_t AlignUp(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+} // namespace
+
+RingBufferAllocator::RingBufferAllocator(size_t capacity)
+    : m_capacity(capacity)
+{
+}
+
+size_t RingBufferAllocator::Allocate(size_t size, size_t alignment)
+{
+    if (size == 0 || size > m_capacity)
+    {
+        return InvalidOffset;
+    }
+
+    if (GetUsedSize() == 0 && m_head != 0)
+    {
+        // Nothing is in use, restart at the beginning so the whole buffer is contiguous. Frames still pending have no
+        // allocations left and end at the new position.
+        m_head = 0;
+        m_tail = 0;
+        for (Frame& frame : m_frames)
+        {
+            frame.head = 0;
+        }
+    }
+
+    const size_t offset = AlignUp(m_head, alignment);
+    if (m_head > m_tail || GetUsedSize() == 0)
+    {
+        // free space from the write position to the end and from the start to the oldest allocation
+        if (offset <= m_capacity && m_capacity - offset >= size)
+        {
+            m_allocatedTotal += offset + size - m_head;
+            m_head = offset + size;
+            return offset;
+        }
+
+        if (size <= m_tail)
+        {
+            // wrap around, the end of the buffer is freed together with this allocation
+            m_allocatedTotal += m_capacity - m_head + size;
+            m_head = size;
+            return 0;
+        }
+    }
+    else if (offset <= m_tail && m_tail - offset >= size)
+    {
+        // free space between the write position and the oldest allocation, none if the buffer is full
+        m_allocatedTotal += offset + size - m_head;
+        m_head = offset + size;
+        return offset;
+    }
+
+    return InvalidOffset;
+}
+
+void RingBufferAllocator::EndFrame(uint64_t fenceValue)
+{
+    m_frames.push_back({fenceValue, m_head, m_allocatedTotal});
+    m_frameStartTotal = m_allocatedTotal;
+}
+
+void RingBufferAllocator::Release(uint64_t completedFenceValue)
+{
+    while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue)
+    {
+        m_tail = m_frames.front().head;
+        m_releasedTotal = m_frames.front().allocatedTotal;
+        m_frames.pop_front();
+    }
+}
+
+void RingBufferAllocator::Reset(size_t capacity)
+{
+    m_capacity = capacity;
+    m_head = 0;
+    m_tail = 0;
+    m_allocatedTotal = 0;
+    m_releasedTotal = 0;
+    m_frameStartTotal = 0;
+    m_frames.clear();
+}
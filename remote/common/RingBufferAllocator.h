@@ -0,0 +1,82 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Bookkeeping for sub-allocating a fixed size buffer as a ring, independent of the graphics API.
+// Allocations are made in frames. EndFrame tags the allocations made since the previous EndFrame with a fence value, and
+// Release frees the allocations of all frames up to a completed fence value, oldest first. An allocation which does not fit
+// between the write position and the end of the buffer wraps to the start, the skipped bytes are freed with its frame.
+class RingBufferAllocator
+{
+public:
+    static constexpr size_t InvalidOffset = ~size_t(0);
+
+    explicit RingBufferAllocator(size_t capacity = 0);
+
+    // Returns the offset of size bytes aligned to alignment (a power of two), or InvalidOffset if there is not enough free space.
+    size_t Allocate(size_t size, size_t alignment = 1);
+
+    // Ends the current frame. Its allocations are freed by a Release with a completed fence value of at least fenceValue.
+    // Fence values must increase from frame to frame.
+    void EndFrame(uint64_t fenceValue);
+
+    // Frees the allocations of all ended frames whose fence value is at most completedFenceValue.
+    void Release(uint64_t completedFenceValue);
+
+    // Frees everything, including frames not completed yet, and changes the capacity. Used when the buffer is replaced.
+    void Reset(size_t capacity);
+
+    size_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    // Bytes in use by allocations which are not freed yet, including alignment and wrap padding.
+    size_t GetUsedSize() const
+    {
+        return static_cast<size_t>(m_allocatedTotal - m_releasedTotal);
+    }
+
+    // True if allocations were made since the last EndFrame.
+    bool HasOpenFrame() const
+    {
+        return m_allocatedTotal != m_frameStartTotal;
+    }
+
+    size_t GetPendingFrameCount() const
+    {
+        return m_frames.size();
+    }
+
+private:
+    struct Frame
+    {
+        uint64_t fenceValue;
+        // Write position and allocation counter at the end of the frame.
+        size_t head;
+        uint64_t allocatedTotal;
+    };
+
+    size_t m_capacity = 0;
+    // Next write position and start of the oldest allocation not freed yet.
+    size_t m_head = 0;
+    size_t m_tail = 0;
+    // Bytes allocated and freed since the last Reset, their difference is the used size.
+    uint64_t m_allocatedTotal = 0;
+    uint64_t m_releasedTotal = 0;
+    uint64_t m_frameStartTotal = 0;
+    std::deque<Frame> m_frames;
+};
@@ -0,0 +1,118 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// The capacity is rounded up to a power of two and allocated once. Each side keeps a cached copy of the other side's position,
+// so the shared positions are only read when the queue looks full (producer) or empty (consumer).
+template <class T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t roundedCapacity = 1;
+        while (roundedCapacity < capacity)
+        {
+            roundedCapacity *= 2;
+        }
+
+        m_items = std::make_unique<T[]>(roundedCapacity);
+        m_mask = roundedCapacity - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t Capacity() const
+    {
+        return m_mask + 1;
+    }
+
+    // Producer: appends the value and returns true, or returns false without moving from value if the queue is full.
+    bool TryPush(T&& value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (!HasSpace(tail))
+        {
+            return false;
+        }
+
+        m_items[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPush(const T& value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (!HasSpace(tail))
+        {
+            return false;
+        }
+
+        m_items[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: moves the oldest value to value and returns true, or returns false if the queue is empty.
+    bool TryPop(T& value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail)
+            {
+                return false;
+            }
+        }
+
+        value = std::move(m_items[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: returns true if no value is ready to be popped.
+    bool Empty() const
+    {
+        return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    bool HasSpace(size_t tail)
+    {
+        if (tail - m_cachedHead > m_mask)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            return tail - m_cachedHead <= m_mask;
+        }
+        return true;
+    }
+
+    std::unique_ptr<T[]> m_items;
+    size_t m_mask = 0;
+
+    // Written by the consumer.
+    alignas(64) std::atomic<size_t> m_head = 0;
+    size_t m_cachedTail = 0;
+
+    // Written by the producer.
+    alignas(64) std::atomic<size_t> m_tail = 0;
+    size_t m_cachedHead = 0;
+};
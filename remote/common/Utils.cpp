@@ -9,8 +9,9 @@
 //
 //*********************************************************
 
-#include <pch.h>
+#include <Utils.h>
 
+#include <cwchar>
 #include <regex>
 #include <string>
 
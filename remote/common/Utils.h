@@ -11,10 +11,17 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 
+#ifdef _WIN32
+#    include <guiddef.h>
+#endif
+
 namespace Utils
 {
+#ifdef _WIN32
     // comparison function to allow for GUID as a hash map key
     struct GUIDComparer
     {
@@ -33,6 +40,9 @@ namespace Utils
             return compare(Left, Right) < 0;
         }
     };
+#endif
 
+    // Splits "hostname[:port]" or "[ipv6 address][:port]". Leaves port unchanged if the address has none.
+    // Does not depend on Windows, so that it can be used on any platform.
     std::wstring SplitHostnameAndPortString(const std::wstring& address, uint16_t& port);
 } // namespace Utils
@@ -0,0 +1,256 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <holographic/BoundingVolumeHierarchy.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace FrustumCulling;
+
+namespace
+{
+    constexpr uint32_t AllPlanesMask = (1u << FrustumPlanes::PlaneCount) - 1;
+
+    // Deep enough for the median split, which produces a tree of depth ceil(log2(leafCount)).
+    constexpr size_t MaxTraversalDepth = 64;
+
+    enum class Containment
+    {
+        Outside,
+        Intersecting,
+        Inside
+    };
+
+    // Tests the box against the planes in planeMask. Planes the box is completely inside of are removed from planeMask, so
+    // that the children of the box do not need to test them again.
+    Containment TestBox(const FrustumPlanes& planes, const BoundingBox& box, uint32_t& planeMask)
+    {
+        const float centerX = 0.5f * (box.max[0] + box.min[0]);
+        const float centerY = 0.5f * (box.max[1] + box.min[1]);
+        const float centerZ = 0.5f * (box.max[2] + box.min[2]);
+        const float extentX = 0.5f * (box.max[0] - box.min[0]);
+        const float extentY = 0.5f * (box.max[1] - box.min[1]);
+        const float extentZ = 0.5f * (box.max[2] - box.min[2]);
+
+        for (uint32_t i = 0; i < FrustumPlanes::PlaneCount; ++i)
+        {
+            if ((planeMask & (1u << i)) == 0)
+            {
+                continue;
+            }
+
+            const float distance = planes.normalX[i] * centerX + planes.normalY[i] * centerY + planes.normalZ[i] * centerZ + planes.d[i];
+            const float radius =
+                std::abs(planes.normalX[i]) * extentX + std::abs(planes.normalY[i]) * extentY + std::abs(planes.normalZ[i]) * extentZ;
+
+            if (distance - radius > 0)
+            {
+                return Containment::Outside;
+            }
+            if (distance + radius <= 0)
+            {
+                planeMask &= ~(1u << i);
+            }
+        }
+
+        return planeMask == 0 ? Containment::Inside : Containment::Intersecting;
+    }
+} // namespace
+
+bool BoundingBox::operator==(const BoundingBox& other) const
+{
+    return std::equal(std::begin(min), std::end(min), std::begin(other.min)) &&
+           std::equal(std::begin(max), std::end(max), std::begin(other.max));
+}
+
+BoundingBox BoundingBox::Union(const BoundingBox& a, const BoundingBox& b)
+{
+    BoundingBox result;
+    for (int i = 0; i < 3; ++i)
+    {
+        result.min[i] = std::min(a.min[i], b.min[i]);
+        result.max[i] = std::max(a.max[i], b.max[i]);
+    }
+    return result;
+}
+
+bool FrustumCulling::BoxInFrustum(const FrustumPlanes& planes, const BoundingBox& box)
+{
+    uint32_t planeMask = AllPlanesMask;
+    return TestBox(planes, box, planeMask) != Containment::Outside;
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+    m_nodes.clear();
+    m_leafNodes.clear();
+}
+
+void BoundingVolumeHierarchy::Build(const BoundingBox* leafBoxes, uint32_t leafCount)
+{
+    Clear();
+    if (leafCount == 0)
+    {
+        return;
+    }
+
+    m_nodes.reserve(2 * static_cast<size_t>(leafCount) - 1);
+    m_leafNodes.resize(leafCount);
+
+    m_buildCenters.resize(3 * static_cast<size_t>(leafCount));
+    for (uint32_t i = 0; i < leafCount; ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            m_buildCenters[3 * i + axis] = 0.5f * (leafBoxes[i].min[axis] + leafBoxes[i].max[axis]);
+        }
+    }
+
+    m_buildOrder.resize(leafCount);
+    for (uint32_t i = 0; i < leafCount; ++i)
+    {
+        m_buildOrder[i] = i;
+    }
+
+    BuildRecursive(leafBoxes, m_buildOrder.data(), m_buildOrder.data() + leafCount, InvalidIndex);
+}
+
+uint32_t BoundingVolumeHierarchy::BuildRecursive(const BoundingBox* leafBoxes, uint32_t* first, uint32_t* last, uint32_t parent)
+{
+    const uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+    m_nodes[nodeIndex].parent = parent;
+
+    if (last - first == 1)
+    {
+        m_nodes[nodeIndex].box = leafBoxes[*first];
+        m_nodes[nodeIndex].leaf = *first;
+        m_leafNodes[*first] = nodeIndex;
+        return nodeIndex;
+    }
+
+    // Split at the median of the box centers along the axis with the largest spread.
+    float centerMin[3] = {INFINITY, INFINITY, INFINITY};
+    float centerMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t* it = first; it != last; ++it)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            centerMin[axis] = std::min(centerMin[axis], m_buildCenters[3 * *it + axis]);
+            centerMax[axis] = std::max(centerMax[axis], m_buildCenters[3 * *it + axis]);
+        }
+    }
+
+    int splitAxis = 0;
+    for (int axis = 1; axis < 3; ++axis)
+    {
+        if (centerMax[axis] - centerMin[axis] > centerMax[splitAxis] - centerMin[splitAxis])
+        {
+            splitAxis = axis;
+        }
+    }
+
+    uint32_t* middle = first + (last - first) / 2;
+    std::nth_element(first, middle, last, [this, splitAxis](uint32_t a, uint32_t b) {
+        return m_buildCenters[3 * a + splitAxis] < m_buildCenters[3 * b + splitAxis];
+    });
+
+    const uint32_t left = BuildRecursive(leafBoxes, first, middle, nodeIndex);
+    const uint32_t right = BuildRecursive(leafBoxes, middle, last, nodeIndex);
+
+    Node& node = m_nodes[nodeIndex];
+    node.left = left;
+    node.right = right;
+    node.box = BoundingBox::Union(m_nodes[left].box, m_nodes[right].box);
+    return nodeIndex;
+}
+
+void BoundingVolumeHierarchy::Refit(uint32_t leaf, const BoundingBox& box)
+{
+    uint32_t nodeIndex = m_leafNodes[leaf];
+    m_nodes[nodeIndex].box = box;
+
+    for (nodeIndex = m_nodes[nodeIndex].parent; nodeIndex != InvalidIndex; nodeIndex = m_nodes[nodeIndex].parent)
+    {
+        Node& node = m_nodes[nodeIndex];
+        const BoundingBox refitted = BoundingBox::Union(m_nodes[node.left].box, m_nodes[node.right].box);
+        if (refitted == node.box)
+        {
+            break;
+        }
+        node.box = refitted;
+    }
+}
+
+void BoundingVolumeHierarchy::Query(const FrustumPlanes& planes, std::vector<uint32_t>& visibleLeaves) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    struct StackEntry
+    {
+        uint32_t node;
+        uint32_t planeMask;
+    };
+    StackEntry stack[MaxTraversalDepth];
+    size_t stackSize = 0;
+    stack[stackSize++] = {0, AllPlanesMask};
+
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+        const Node& node = m_nodes[entry.node];
+
+        const Containment containment = TestBox(planes, node.box, entry.planeMask);
+        if (containment == Containment::Outside)
+        {
+            continue;
+        }
+
+        if (node.leaf != InvalidIndex)
+        {
+            visibleLeaves.push_back(node.leaf);
+        }
+        else if (containment == Containment::Inside)
+        {
+            AppendSubtreeLeaves(entry.node, visibleLeaves);
+        }
+        else
+        {
+            stack[stackSize++] = {node.right, entry.planeMask};
+            stack[stackSize++] = {node.left, entry.planeMask};
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::AppendSubtreeLeaves(uint32_t node, std::vector<uint32_t>& visibleLeaves) const
+{
+    uint32_t stack[MaxTraversalDepth];
+    size_t stackSize = 0;
+    stack[stackSize++] = node;
+
+    while (stackSize > 0)
+    {
+        const Node& current = m_nodes[stack[--stackSize]];
+        if (current.leaf != InvalidIndex)
+        {
+            visibleLeaves.push_back(current.leaf);
+        }
+        else
+        {
+            stack[stackSize++] = current.right;
+            stack[stackSize++] = current.left;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <holographic/FrustumCullingBatch.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace FrustumCulling
+{
+    // Axis aligned bounding box.
+    struct BoundingBox
+    {
+        float min[3] = {0.0f, 0.0f, 0.0f};
+        float max[3] = {0.0f, 0.0f, 0.0f};
+
+        bool operator==(const BoundingBox& other) const;
+        bool operator!=(const BoundingBox& other) const
+        {
+            return !(*this == other);
+        }
+
+        // Returns the smallest box containing both boxes.
+        static BoundingBox Union(const BoundingBox& a, const BoundingBox& b);
+    };
+
+    // Returns true if the box intersects or is inside the frustum.
+    bool BoxInFrustum(const FrustumPlanes& planes, const BoundingBox& box);
+
+    // Binary bounding volume hierarchy over a set of boxes (leaves). Leaves are identified by their index in the array passed
+    // to Build. The tree is built top down by splitting at the median along the largest extent, and the boxes of individual
+    // leaves can be updated afterwards without rebuilding by refitting the ancestors of the changed leaf.
+    class BoundingVolumeHierarchy
+    {
+    public:
+        static constexpr uint32_t InvalidIndex = ~0u;
+
+        void Clear();
+
+        // Rebuilds the hierarchy over the given boxes.
+        void Build(const BoundingBox* leafBoxes, uint32_t leafCount);
+
+        // Replaces the box of a leaf and updates the boxes of its ancestors. Stops as soon as an ancestor is unchanged.
+        void Refit(uint32_t leaf, const BoundingBox& box);
+
+        // Appends the indices of all leaves intersecting the frustum to visibleLeaves. Subtrees which are completely inside the
+        // frustum are appended without testing their nodes.
+        void Query(const FrustumPlanes& planes, std::vector<uint32_t>& visibleLeaves) const;
+
+        const BoundingBox& GetLeafBox(uint32_t leaf) const
+        {
+            return m_nodes[m_leafNodes[leaf]].box;
+        }
+
+        uint32_t GetLeafCount() const
+        {
+            return static_cast<uint32_t>(m_leafNodes.size());
+        }
+
+    private:
+        struct Node
+        {
+            BoundingBox box;
+            uint32_t parent = InvalidIndex;
+            // Children of an inner node, or InvalidIndex for leaves.
+            uint32_t left = InvalidIndex;
+            uint32_t right = InvalidIndex;
+            // Index of the leaf, or InvalidIndex for inner nodes.
+            uint32_t leaf = InvalidIndex;
+        };
+
+        uint32_t BuildRecursive(const BoundingBox* leafBoxes, uint32_t* first, uint32_t* last, uint32_t parent);
+        void AppendSubtreeLeaves(uint32_t node, std::vector<uint32_t>& visibleLeaves) const;
+
+        std::vector<Node> m_nodes;
+        // Node index for each leaf.
+        std::vector<uint32_t> m_leafNodes;
+        // Scratch storage reused between builds.
+        std::vector<uint32_t> m_buildOrder;
+        std::vector<float> m_buildCenters;
+    };
+} // namespace FrustumCulling
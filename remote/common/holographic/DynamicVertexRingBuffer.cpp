@@ -0,0 +1,118 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <holographic/DynamicVertexRingBuffer.h>
+
+namespace
+{
+    // Enough for the QR codes and hand joints of a few frames.
+    constexpr size_t s_initialCapacity = 64 * 1024;
+    constexpr size_t s_uploadAlignment = 16;
+} // namespace
+
+UINT DynamicVertexRingBuffer::Upload(ID3D11Device* device, ID3D11DeviceContext* context, const void* data, size_t size)
+{
+    ReleaseCompletedFrames(context);
+
+    size_t offset = m_allocator.Allocate(size, s_uploadAlignment);
+    if (offset == RingBufferAllocator::InvalidOffset)
+    {
+        // Frames in flight still use the rest of the buffer. The old buffer stays alive until the GPU is done with it.
+        Grow(device, m_allocator.GetCapacity() + size);
+        offset = m_allocator.Allocate(size, s_uploadAlignment);
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const D3D11_MAP mapType = m_discardOnNextMap ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+    winrt::check_hresult(context->Map(m_buffer.get(), 0, mapType, 0, &mapped));
+    memcpy(static_cast<uint8_t*>(mapped.pData) + offset, data, size);
+    context->Unmap(m_buffer.get(), 0);
+    m_discardOnNextMap = false;
+
+    return static_cast<UINT>(offset);
+}
+
+void DynamicVertexRingBuffer::EndFrame(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    if (!m_allocator.HasOpenFrame())
+    {
+        return;
+    }
+
+    winrt::com_ptr<ID3D11Query> query;
+    if (!m_freeQueries.empty())
+    {
+        query = std::move(m_freeQueries.back());
+        m_freeQueries.pop_back();
+    }
+    else
+    {
+        const CD3D11_QUERY_DESC queryDesc(D3D11_QUERY_EVENT);
+        winrt::check_hresult(device->CreateQuery(&queryDesc, query.put()));
+    }
+
+    context->End(query.get());
+
+    const uint64_t fenceValue = m_nextFenceValue++;
+    m_allocator.EndFrame(fenceValue);
+    m_pendingFrames.push_back({fenceValue, std::move(query)});
+}
+
+void DynamicVertexRingBuffer::ReleaseDeviceDependentResources()
+{
+    m_buffer = nullptr;
+    m_allocator.Reset(0);
+    m_discardOnNextMap = true;
+    m_pendingFrames.clear();
+    m_freeQueries.clear();
+}
+
+void DynamicVertexRingBuffer::ReleaseCompletedFrames(ID3D11DeviceContext* context)
+{
+    uint64_t completedFenceValue = 0;
+    while (!m_pendingFrames.empty() &&
+           context->GetData(m_pendingFrames.front().query.get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+    {
+        completedFenceValue = m_pendingFrames.front().fenceValue;
+        m_freeQueries.push_back(std::move(m_pendingFrames.front().query));
+        m_pendingFrames.pop_front();
+    }
+
+    if (completedFenceValue != 0)
+    {
+        m_allocator.Release(completedFenceValue);
+    }
+}
+
+void DynamicVertexRingBuffer::Grow(ID3D11Device* device, size_t minimumCapacity)
+{
+    size_t capacity = std::max(s_initialCapacity, m_allocator.GetCapacity());
+    while (capacity < minimumCapacity)
+    {
+        capacity *= 2;
+    }
+
+    m_buffer = nullptr;
+    const CD3D11_BUFFER_DESC bufferDesc(
+        static_cast<UINT>(capacity), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    winrt::check_hresult(device->CreateBuffer(&bufferDesc, nullptr, m_buffer.put()));
+
+    // The new buffer is not used by any frame in flight.
+    m_allocator.Reset(capacity);
+    m_discardOnNextMap = true;
+    for (PendingFrame& frame : m_pendingFrames)
+    {
+        m_freeQueries.push_back(std::move(frame.query));
+    }
+    m_pendingFrames.clear();
+}
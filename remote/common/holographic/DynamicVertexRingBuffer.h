@@ -0,0 +1,61 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <RingBufferAllocator.h>
+
+#include <d3d11.h>
+#include <winrt/base.h>
+
+#include <deque>
+#include <vector>
+
+// Dynamic vertex buffer for vertices which are generated every frame. Uploads are sub-allocated from the buffer with
+// D3D11_MAP_WRITE_NO_OVERWRITE, and the space of a frame is reused once an event query issued at its end has completed.
+// The buffer grows when a frame does not fit, so after a few frames the same buffer is reused without creating resources.
+class DynamicVertexRingBuffer
+{
+public:
+    // Copies size bytes into the buffer and returns their byte offset. Uploading can replace the buffer, so the buffer must be
+    // bound with GetBuffer after the last upload before the draw.
+    UINT Upload(ID3D11Device* device, ID3D11DeviceContext* context, const void* data, size_t size);
+
+    // Ends the frame. Call once per frame after the last draw using the uploaded vertices.
+    void EndFrame(ID3D11Device* device, ID3D11DeviceContext* context);
+
+    ID3D11Buffer* GetBuffer() const
+    {
+        return m_buffer.get();
+    }
+
+    void ReleaseDeviceDependentResources();
+
+private:
+    struct PendingFrame
+    {
+        uint64_t fenceValue;
+        winrt::com_ptr<ID3D11Query> query;
+    };
+
+    // Frees the space of the frames the GPU has finished.
+    void ReleaseCompletedFrames(ID3D11DeviceContext* context);
+    void Grow(ID3D11Device* device, size_t minimumCapacity);
+
+    winrt::com_ptr<ID3D11Buffer> m_buffer;
+    RingBufferAllocator m_allocator;
+    // True until the first map of a new buffer, which discards instead of not overwriting.
+    bool m_discardOnNextMap = true;
+
+    uint64_t m_nextFenceValue = 1;
+    std::deque<PendingFrame> m_pendingFrames;
+    std::vector<winrt::com_ptr<ID3D11Query>> m_freeQueries;
+};
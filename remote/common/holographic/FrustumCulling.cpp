@@ -87,3 +87,30 @@ bool FrustumCulling::SphereInFrustum(
     }
     return true;
 }
+
+bool FrustumCulling::TryGetFrustumPlanes(
+    const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum, FrustumPlanes& planes)
+{
+    if (!cullingFrustum)
+    {
+        return false;
+    }
+    SpatialBoundingFrustum frustum = cullingFrustum.Value();
+    const winrt::Windows::Foundation::Numerics::plane frustumPlanes[FrustumPlanes::PlaneCount] = {
+        frustum.Bottom, frustum.Far, frustum.Left, frustum.Near, frustum.Right, frustum.Top};
+    for (size_t i = 0; i < FrustumPlanes::PlaneCount; ++i)
+    {
+        planes.normalX[i] = frustumPlanes[i].normal.x;
+        planes.normalY[i] = frustumPlanes[i].normal.y;
+        planes.normalZ[i] = frustumPlanes[i].normal.z;
+        planes.d[i] = frustumPlanes[i].d;
+    }
+    return true;
+}
+
+void FrustumCulling::CullSpheres(
+    SphereBatch& spheres, const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum)
+{
+    FrustumPlanes planes;
+    spheres.Cull(TryGetFrustumPlanes(cullingFrustum, planes) ? &planes : nullptr);
+}
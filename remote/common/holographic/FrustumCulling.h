@@ -11,6 +11,8 @@
 
 #pragma once
 
+#include <holographic/FrustumCullingBatch.h>
+
 #include <winrt/Windows.Foundation.Metadata.h>
 #include <winrt/Windows.Perception.Spatial.h>
 
@@ -27,4 +29,11 @@ namespace FrustumCulling
         const winrt::Windows::Foundation::Numerics::float3& sphereCenter,
         float sphereRadius,
         const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum);
+
+    // Extracts the planes of the cullingFrustum for the batched culling functions. Returns false if no cullingFrustum is available.
+    bool TryGetFrustumPlanes(
+        const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum, FrustumPlanes& planes);
+
+    // Culls all spheres of the batch against the cullingFrustum. All spheres are visible if no cullingFrustum is available.
+    void CullSpheres(SphereBatch& spheres, const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum);
 }; // namespace FrustumCulling
@@ -0,0 +1,256 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <holographic/FrustumCullingBatch.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#    define FRUSTUM_CULLING_AVX2
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define FRUSTUM_CULLING_SSE2
+#    include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#    define FRUSTUM_CULLING_NEON
+#    include <arm_neon.h>
+#endif
+
+using namespace FrustumCulling;
+
+namespace
+{
+    constexpr size_t PlaneCount = FrustumPlanes::PlaneCount;
+
+    // The plane distance is accumulated in the same order by all kernels so that they agree on spheres touching a plane.
+    inline bool SphereOutsideAnyPlane(const FrustumPlanes& planes, float x, float y, float z, float radius)
+    {
+        bool outside = false;
+        for (size_t i = 0; i < PlaneCount; ++i)
+        {
+            const float distance = planes.normalX[i] * x + planes.normalY[i] * y + planes.normalZ[i] * z + planes.d[i];
+            outside |= distance - radius > 0;
+        }
+        return outside;
+    }
+
+    // Sets the visibility bits for the spheres [first, spheres.count).
+    void CullScalarRange(const FrustumPlanes& planes, const SphereArrays& spheres, size_t first, uint64_t* visibilityMask)
+    {
+        for (size_t i = first; i < spheres.count; ++i)
+        {
+            if (!SphereOutsideAnyPlane(planes, spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], spheres.radius[i]))
+            {
+                visibilityMask[i / 64] |= uint64_t(1) << (i % 64);
+            }
+        }
+    }
+
+#if defined(FRUSTUM_CULLING_AVX2)
+    // Tests 8 spheres per iteration. Returns the number of spheres processed.
+    size_t CullSimd(const FrustumPlanes& planes, const SphereArrays& spheres, uint64_t* visibilityMask)
+    {
+        __m256 normalX[PlaneCount], normalY[PlaneCount], normalZ[PlaneCount], d[PlaneCount];
+        for (size_t p = 0; p < PlaneCount; ++p)
+        {
+            normalX[p] = _mm256_set1_ps(planes.normalX[p]);
+            normalY[p] = _mm256_set1_ps(planes.normalY[p]);
+            normalZ[p] = _mm256_set1_ps(planes.normalZ[p]);
+            d[p] = _mm256_set1_ps(planes.d[p]);
+        }
+        const __m256 zero = _mm256_setzero_ps();
+
+        size_t i = 0;
+        for (; i + 8 <= spheres.count; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(spheres.centerX + i);
+            const __m256 y = _mm256_loadu_ps(spheres.centerY + i);
+            const __m256 z = _mm256_loadu_ps(spheres.centerZ + i);
+            const __m256 r = _mm256_loadu_ps(spheres.radius + i);
+
+            __m256 outside = zero;
+            for (size_t p = 0; p < PlaneCount; ++p)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(normalX[p], x), _mm256_mul_ps(normalY[p], y));
+                distance = _mm256_add_ps(_mm256_add_ps(distance, _mm256_mul_ps(normalZ[p], z)), d[p]);
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_sub_ps(distance, r), zero, _CMP_GT_OQ));
+            }
+
+            const uint64_t visible = ~static_cast<uint64_t>(_mm256_movemask_ps(outside)) & 0xFF;
+            visibilityMask[i / 64] |= visible << (i % 64);
+        }
+        return i;
+    }
+
+    constexpr const char* KernelName = "AVX2";
+#elif defined(FRUSTUM_CULLING_SSE2)
+    // Tests 4 spheres per iteration. Returns the number of spheres processed.
+    size_t CullSimd(const FrustumPlanes& planes, const SphereArrays& spheres, uint64_t* visibilityMask)
+    {
+        __m128 normalX[PlaneCount], normalY[PlaneCount], normalZ[PlaneCount], d[PlaneCount];
+        for (size_t p = 0; p < PlaneCount; ++p)
+        {
+            normalX[p] = _mm_set1_ps(planes.normalX[p]);
+            normalY[p] = _mm_set1_ps(planes.normalY[p]);
+            normalZ[p] = _mm_set1_ps(planes.normalZ[p]);
+            d[p] = _mm_set1_ps(planes.d[p]);
+        }
+        const __m128 zero = _mm_setzero_ps();
+
+        size_t i = 0;
+        for (; i + 4 <= spheres.count; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(spheres.centerX + i);
+            const __m128 y = _mm_loadu_ps(spheres.centerY + i);
+            const __m128 z = _mm_loadu_ps(spheres.centerZ + i);
+            const __m128 r = _mm_loadu_ps(spheres.radius + i);
+
+            __m128 outside = zero;
+            for (size_t p = 0; p < PlaneCount; ++p)
+            {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(normalX[p], x), _mm_mul_ps(normalY[p], y));
+                distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(normalZ[p], z)), d[p]);
+                outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_sub_ps(distance, r), zero));
+            }
+
+            const uint64_t visible = ~static_cast<uint64_t>(_mm_movemask_ps(outside)) & 0xF;
+            visibilityMask[i / 64] |= visible << (i % 64);
+        }
+        return i;
+    }
+
+    constexpr const char* KernelName = "SSE2";
+#elif defined(FRUSTUM_CULLING_NEON)
+    // Tests 4 spheres per iteration. Returns the number of spheres processed.
+    size_t CullSimd(const FrustumPlanes& planes, const SphereArrays& spheres, uint64_t* visibilityMask)
+    {
+        float32x4_t normalX[PlaneCount], normalY[PlaneCount], normalZ[PlaneCount], d[PlaneCount];
+        for (size_t p = 0; p < PlaneCount; ++p)
+        {
+            normalX[p] = vdupq_n_f32(planes.normalX[p]);
+            normalY[p] = vdupq_n_f32(planes.normalY[p]);
+            normalZ[p] = vdupq_n_f32(planes.normalZ[p]);
+            d[p] = vdupq_n_f32(planes.d[p]);
+        }
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const uint32_t laneBitValues[4] = {1, 2, 4, 8};
+        const uint32x4_t laneBits = vld1q_u32(laneBitValues);
+
+        size_t i = 0;
+        for (; i + 4 <= spheres.count; i += 4)
+        {
+            const float32x4_t x = vld1q_f32(spheres.centerX + i);
+            const float32x4_t y = vld1q_f32(spheres.centerY + i);
+            const float32x4_t z = vld1q_f32(spheres.centerZ + i);
+            const float32x4_t r = vld1q_f32(spheres.radius + i);
+
+            uint32x4_t outside = vdupq_n_u32(0);
+            for (size_t p = 0; p < PlaneCount; ++p)
+            {
+                float32x4_t distance = vaddq_f32(vmulq_f32(normalX[p], x), vmulq_f32(normalY[p], y));
+                distance = vaddq_f32(vaddq_f32(distance, vmulq_f32(normalZ[p], z)), d[p]);
+                outside = vorrq_u32(outside, vcgtq_f32(vsubq_f32(distance, r), zero));
+            }
+
+            const uint64_t visible = ~static_cast<uint64_t>(vaddvq_u32(vandq_u32(outside, laneBits))) & 0xF;
+            visibilityMask[i / 64] |= visible << (i % 64);
+        }
+        return i;
+    }
+
+    constexpr const char* KernelName = "NEON";
+#else
+    size_t CullSimd(const FrustumPlanes&, const SphereArrays&, uint64_t*)
+    {
+        return 0;
+    }
+
+    constexpr const char* KernelName = "Scalar";
+#endif
+} // namespace
+
+bool FrustumCulling::SphereInFrustum(const FrustumPlanes& planes, float centerX, float centerY, float centerZ, float radius)
+{
+    for (size_t i = 0; i < PlaneCount; ++i)
+    {
+        const float distance = planes.normalX[i] * centerX + planes.normalY[i] * centerY + planes.normalZ[i] * centerZ + planes.d[i];
+        if (distance - radius > 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrustumCulling::SpheresInFrustum(const FrustumPlanes& planes, const SphereArrays& spheres, uint64_t* visibilityMask)
+{
+    std::memset(visibilityMask, 0, VisibilityMaskWordCount(spheres.count) * sizeof(uint64_t));
+
+    const size_t processed = CullSimd(planes, spheres, visibilityMask);
+    CullScalarRange(planes, spheres, processed, visibilityMask);
+}
+
+void FrustumCulling::SpheresInFrustumScalar(const FrustumPlanes& planes, const SphereArrays& spheres, uint64_t* visibilityMask)
+{
+    std::memset(visibilityMask, 0, VisibilityMaskWordCount(spheres.count) * sizeof(uint64_t));
+
+    CullScalarRange(planes, spheres, 0, visibilityMask);
+}
+
+const char* FrustumCulling::SpheresInFrustumKernelName()
+{
+    return KernelName;
+}
+
+void SphereBatch::Clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_radius.clear();
+}
+
+void SphereBatch::Reserve(size_t count)
+{
+    m_centerX.reserve(count);
+    m_centerY.reserve(count);
+    m_centerZ.reserve(count);
+    m_radius.reserve(count);
+    m_visibilityMask.reserve(VisibilityMaskWordCount(count));
+}
+
+void SphereBatch::Add(float centerX, float centerY, float centerZ, float radius)
+{
+    m_centerX.push_back(centerX);
+    m_centerY.push_back(centerY);
+    m_centerZ.push_back(centerZ);
+    m_radius.push_back(radius);
+}
+
+void SphereBatch::Cull(const FrustumPlanes* planes)
+{
+    m_visibilityMask.resize(VisibilityMaskWordCount(Size()));
+
+    if (planes)
+    {
+        SpheresInFrustum(*planes, GetArrays(), m_visibilityMask.data());
+    }
+    else
+    {
+        std::fill(m_visibilityMask.begin(), m_visibilityMask.end(), ~uint64_t(0));
+    }
+}
+
+SphereArrays SphereBatch::GetArrays() const
+{
+    return {m_centerX.data(), m_centerY.data(), m_centerZ.data(), m_radius.data(), m_radius.size()};
+}
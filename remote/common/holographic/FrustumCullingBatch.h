@@ -0,0 +1,98 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Batched frustum culling which does not depend on WinRT or DirectXMath, so that it can be used (and benchmarked) on any
+// platform. The SIMD kernel (AVX2, SSE2, NEON or scalar) is selected at compile time.
+namespace FrustumCulling
+{
+    // The six planes of a frustum in structure-of-arrays form. A point p lies outside of plane i if
+    // normalX[i] * p.x + normalY[i] * p.y + normalZ[i] * p.z + d[i] > 0, which matches dot_coordinate.
+    struct FrustumPlanes
+    {
+        static constexpr size_t PlaneCount = 6;
+
+        float normalX[PlaneCount];
+        float normalY[PlaneCount];
+        float normalZ[PlaneCount];
+        float d[PlaneCount];
+    };
+
+    // Read-only view on spheres stored in structure-of-arrays form.
+    struct SphereArrays
+    {
+        const float* centerX = nullptr;
+        const float* centerY = nullptr;
+        const float* centerZ = nullptr;
+        const float* radius = nullptr;
+        size_t count = 0;
+    };
+
+    // Returns the number of 64 bit words needed to store one visibility bit for each of count spheres.
+    constexpr size_t VisibilityMaskWordCount(size_t count)
+    {
+        return (count + 63) / 64;
+    }
+
+    inline bool IsVisible(const uint64_t* visibilityMask, size_t index)
+    {
+        return (visibilityMask[index / 64] >> (index % 64)) & 1;
+    }
+
+    // Returns true if the sphere is inside the frustum. Tests one sphere at a time with an early out per plane.
+    bool SphereInFrustum(const FrustumPlanes& planes, float centerX, float centerY, float centerZ, float radius);
+
+    // Tests all spheres against the frustum and writes one bit per sphere (set if visible) into visibilityMask, which must hold
+    // VisibilityMaskWordCount(spheres.count) words.
+    void SpheresInFrustum(const FrustumPlanes& planes, const SphereArrays& spheres, uint64_t* visibilityMask);
+
+    // Portable implementation of SpheresInFrustum which is used for the tail of each batch and on platforms without SIMD support.
+    void SpheresInFrustumScalar(const FrustumPlanes& planes, const SphereArrays& spheres, uint64_t* visibilityMask);
+
+    // Returns the name of the kernel used by SpheresInFrustum.
+    const char* SpheresInFrustumKernelName();
+
+    // Collects spheres for a batched culling pass. The storage is retained between passes to avoid per frame allocations.
+    class SphereBatch
+    {
+    public:
+        void Clear();
+        void Reserve(size_t count);
+        void Add(float centerX, float centerY, float centerZ, float radius);
+
+        // Culls all spheres against the given planes. If planes is null all spheres are considered visible.
+        void Cull(const FrustumPlanes* planes);
+
+        bool IsVisible(size_t index) const
+        {
+            return FrustumCulling::IsVisible(m_visibilityMask.data(), index);
+        }
+
+        size_t Size() const
+        {
+            return m_radius.size();
+        }
+
+        SphereArrays GetArrays() const;
+
+    private:
+        std::vector<float> m_centerX;
+        std::vector<float> m_centerY;
+        std::vector<float> m_centerZ;
+        std::vector<float> m_radius;
+        std::vector<uint64_t> m_visibilityMask;
+    };
+} // namespace FrustumCulling
@@ -0,0 +1,396 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <holographic/MeshSimplifier.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace MeshSimplification;
+
+namespace
+{
+    // A collapse is rejected if it turns the normal of a remaining triangle by more than ~75 degrees.
+    constexpr float MinNormalCosine = 0.25f;
+
+    struct Vector3
+    {
+        float x, y, z;
+    };
+
+    Vector3 Subtract(const float* a, const float* b)
+    {
+        return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+    }
+
+    Vector3 Cross(const Vector3& a, const Vector3& b)
+    {
+        return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    float Dot(const Vector3& a, const Vector3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+} // namespace
+
+uint32_t Simplifier::Simplify(const MeshView& mesh, uint32_t targetIndexCount, float maxError, std::vector<uint16_t>& result)
+{
+    assert(mesh.indexCount % 3 == 0);
+
+    const uint32_t vertexCount = mesh.vertexCount;
+
+    m_positions.resize(size_t(vertexCount) * 3);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const int16_t* position = mesh.positions + size_t(i) * mesh.positionStride;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            m_positions[size_t(i) * 3 + axis] = std::max(position[axis] / 32767.0f, -1.0f) * mesh.scale[axis];
+        }
+    }
+
+    // Triangles with an out of range index are dropped.
+    m_indices.clear();
+    m_indices.reserve(mesh.indexCount);
+    for (uint32_t i = 0; i + 2 < mesh.indexCount; i += 3)
+    {
+        const uint32_t a = mesh.indices[i + 0];
+        const uint32_t b = mesh.indices[i + 1];
+        const uint32_t c = mesh.indices[i + 2];
+        if (a < vertexCount && b < vertexCount && c < vertexCount)
+        {
+            m_indices.push_back(a);
+            m_indices.push_back(b);
+            m_indices.push_back(c);
+        }
+    }
+
+    m_remap.resize(vertexCount);
+    m_vertexRemap.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        m_remap[i] = i;
+        m_vertexRemap[i] = i;
+    }
+
+    ComputeQuadrics(mesh);
+    FindBorderVertices(vertexCount);
+
+    targetIndexCount -= targetIndexCount % 3;
+    while (m_indices.size() > targetIndexCount)
+    {
+        const uint32_t removeTriangleCount = static_cast<uint32_t>(m_indices.size() - targetIndexCount) / 3;
+
+        ComputeAdjacency(vertexCount);
+        RankCollapses();
+        if (CollapsePass(removeTriangleCount, maxError) == 0)
+        {
+            break;
+        }
+
+        // apply the collapses and drop the triangles which became degenerate
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < m_indices.size(); i += 3)
+        {
+            const uint32_t a = m_remap[m_indices[i + 0]];
+            const uint32_t b = m_remap[m_indices[i + 1]];
+            const uint32_t c = m_remap[m_indices[i + 2]];
+            if (a != b && b != c && c != a)
+            {
+                m_indices[writeIndex++] = a;
+                m_indices[writeIndex++] = b;
+                m_indices[writeIndex++] = c;
+            }
+        }
+        m_indices.resize(writeIndex);
+
+        // vertices collapsed in earlier passes follow their target, a target never collapses in the same pass
+        for (uint32_t& target : m_vertexRemap)
+        {
+            target = m_remap[target];
+        }
+        for (const Collapse& collapse : m_collapses)
+        {
+            m_remap[collapse.from] = collapse.from;
+        }
+    }
+
+    result.resize(m_indices.size());
+    for (size_t i = 0; i < m_indices.size(); ++i)
+    {
+        result[i] = static_cast<uint16_t>(m_indices[i]);
+    }
+    return static_cast<uint32_t>(m_indices.size());
+}
+
+void Simplifier::ComputeQuadrics(const MeshView& mesh)
+{
+    m_quadrics.assign(mesh.vertexCount, Quadric{});
+
+    for (size_t i = 0; i < m_indices.size(); i += 3)
+    {
+        const float* p0 = &m_positions[size_t(m_indices[i + 0]) * 3];
+        const float* p1 = &m_positions[size_t(m_indices[i + 1]) * 3];
+        const float* p2 = &m_positions[size_t(m_indices[i + 2]) * 3];
+
+        Vector3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+        const float length = std::sqrt(Dot(normal, normal));
+        if (length == 0.0f)
+        {
+            continue;
+        }
+
+        normal = {normal.x / length, normal.y / length, normal.z / length};
+        const float d = -(normal.x * p0[0] + normal.y * p0[1] + normal.z * p0[2]);
+
+        // the plane quadric is weighted by the triangle area, so large triangles dominate the error of their vertices
+        const float w = 0.5f * length;
+        const Quadric plane = {
+            w * normal.x * normal.x,
+            w * normal.y * normal.y,
+            w * normal.z * normal.z,
+            w * normal.x * normal.y,
+            w * normal.x * normal.z,
+            w * normal.y * normal.z,
+            w * normal.x * d,
+            w * normal.y * d,
+            w * normal.z * d,
+            w * d * d,
+            w};
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            Quadric& q = m_quadrics[m_indices[i + corner]];
+            q.a00 += plane.a00;
+            q.a11 += plane.a11;
+            q.a22 += plane.a22;
+            q.a01 += plane.a01;
+            q.a02 += plane.a02;
+            q.a12 += plane.a12;
+            q.b0 += plane.b0;
+            q.b1 += plane.b1;
+            q.b2 += plane.b2;
+            q.c += plane.c;
+            q.weight += plane.weight;
+        }
+    }
+}
+
+void Simplifier::ComputeAdjacency(uint32_t vertexCount)
+{
+    m_adjacencyOffsets.assign(size_t(vertexCount) + 1, 0);
+    for (uint32_t index : m_indices)
+    {
+        m_adjacencyOffsets[index + 1]++;
+    }
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        m_adjacencyOffsets[i + 1] += m_adjacencyOffsets[i];
+    }
+
+    m_adjacency.resize(m_indices.size());
+    for (size_t i = 0; i < m_indices.size(); ++i)
+    {
+        m_adjacency[m_adjacencyOffsets[m_indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // filling advanced every offset to the start of the next vertex
+    for (uint32_t i = vertexCount; i > 0; --i)
+    {
+        m_adjacencyOffsets[i] = m_adjacencyOffsets[i - 1];
+    }
+    m_adjacencyOffsets[0] = 0;
+
+    m_touched.assign(vertexCount, 0);
+}
+
+void Simplifier::FindBorderVertices(uint32_t vertexCount)
+{
+    m_edges.clear();
+    m_edges.reserve(m_indices.size());
+    for (size_t i = 0; i < m_indices.size(); i += 3)
+    {
+        m_edges.push_back(EdgeKey(m_indices[i + 0], m_indices[i + 1]));
+        m_edges.push_back(EdgeKey(m_indices[i + 1], m_indices[i + 2]));
+        m_edges.push_back(EdgeKey(m_indices[i + 2], m_indices[i + 0]));
+    }
+    std::sort(m_edges.begin(), m_edges.end());
+
+    // edges which are not shared by exactly two triangles are open borders or non-manifold, their vertices stay in place
+    m_locked.assign(vertexCount, 0);
+    for (size_t i = 0; i < m_edges.size();)
+    {
+        size_t end = i + 1;
+        while (end < m_edges.size() && m_edges[end] == m_edges[i])
+        {
+            end++;
+        }
+
+        if (end - i != 2)
+        {
+            m_locked[m_edges[i] >> 32] = 1;
+            m_locked[m_edges[i] & 0xffffffff] = 1;
+        }
+        i = end;
+    }
+}
+
+void Simplifier::RankCollapses()
+{
+    m_edges.clear();
+    for (size_t i = 0; i < m_indices.size(); i += 3)
+    {
+        m_edges.push_back(EdgeKey(m_indices[i + 0], m_indices[i + 1]));
+        m_edges.push_back(EdgeKey(m_indices[i + 1], m_indices[i + 2]));
+        m_edges.push_back(EdgeKey(m_indices[i + 2], m_indices[i + 0]));
+    }
+    std::sort(m_edges.begin(), m_edges.end());
+    m_edges.erase(std::unique(m_edges.begin(), m_edges.end()), m_edges.end());
+
+    // error of moving the surface around both vertices to the position of vertex "to"
+    auto collapseError = [this](uint32_t from, uint32_t to) {
+        const Quadric& q0 = m_quadrics[from];
+        const Quadric& q1 = m_quadrics[to];
+        const float weight = q0.weight + q1.weight;
+        if (weight == 0.0f)
+        {
+            return 0.0f;
+        }
+
+        const float* p = &m_positions[size_t(to) * 3];
+        const float x = p[0], y = p[1], z = p[2];
+        const float error = (q0.a00 + q1.a00) * x * x + (q0.a11 + q1.a11) * y * y + (q0.a22 + q1.a22) * z * z +
+                            2.0f * ((q0.a01 + q1.a01) * x * y + (q0.a02 + q1.a02) * x * z + (q0.a12 + q1.a12) * y * z) +
+                            2.0f * ((q0.b0 + q1.b0) * x + (q0.b1 + q1.b1) * y + (q0.b2 + q1.b2) * z) + (q0.c + q1.c);
+        return std::max(error, 0.0f) / weight;
+    };
+
+    m_collapses.clear();
+    for (uint64_t edge : m_edges)
+    {
+        const uint32_t a = static_cast<uint32_t>(edge >> 32);
+        const uint32_t b = static_cast<uint32_t>(edge & 0xffffffff);
+        if (m_locked[a] && m_locked[b])
+        {
+            continue;
+        }
+
+        const float errorAB = m_locked[a] ? INFINITY : collapseError(a, b);
+        const float errorBA = m_locked[b] ? INFINITY : collapseError(b, a);
+        m_collapses.push_back(errorAB <= errorBA ? Collapse{a, b, errorAB} : Collapse{b, a, errorBA});
+    }
+
+    std::sort(m_collapses.begin(), m_collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+}
+
+bool Simplifier::FlipsTriangle(uint32_t from, uint32_t to) const
+{
+    const float* target = &m_positions[size_t(to) * 3];
+    for (uint32_t i = m_adjacencyOffsets[from]; i < m_adjacencyOffsets[from + 1]; ++i)
+    {
+        const uint32_t* triangle = &m_indices[size_t(m_adjacency[i]) * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            // removed by the collapse
+            continue;
+        }
+
+        const float* p[3];
+        const float* q[3];
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            p[corner] = &m_positions[size_t(triangle[corner]) * 3];
+            q[corner] = triangle[corner] == from ? target : p[corner];
+        }
+
+        const Vector3 before = Cross(Subtract(p[1], p[0]), Subtract(p[2], p[0]));
+        const Vector3 after = Cross(Subtract(q[1], q[0]), Subtract(q[2], q[0]));
+        const float dot = Dot(before, after);
+        if (dot <= 0.0f || dot * dot < MinNormalCosine * MinNormalCosine * Dot(before, before) * Dot(after, after))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t Simplifier::RemovedTriangles(uint32_t from, uint32_t to) const
+{
+    uint32_t count = 0;
+    for (uint32_t i = m_adjacencyOffsets[from]; i < m_adjacencyOffsets[from + 1]; ++i)
+    {
+        const uint32_t* triangle = &m_indices[size_t(m_adjacency[i]) * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint32_t Simplifier::CollapsePass(uint32_t removeTriangleCount, float maxError)
+{
+    const float maxSquaredError = maxError * maxError;
+
+    // Collapses are applied cheapest first. A vertex is only involved in one collapse per pass, so the flip test of every
+    // collapse sees the geometry it changes.
+    uint32_t removedTriangleCount = 0;
+    size_t collapseCount = 0;
+    for (const Collapse& collapse : m_collapses)
+    {
+        if (collapse.error > maxSquaredError || removedTriangleCount >= removeTriangleCount)
+        {
+            break;
+        }
+
+        if (m_touched[collapse.from] || m_touched[collapse.to] || FlipsTriangle(collapse.from, collapse.to))
+        {
+            continue;
+        }
+
+        for (uint32_t i = m_adjacencyOffsets[collapse.from]; i < m_adjacencyOffsets[collapse.from + 1]; ++i)
+        {
+            const uint32_t* triangle = &m_indices[size_t(m_adjacency[i]) * 3];
+            m_touched[triangle[0]] = 1;
+            m_touched[triangle[1]] = 1;
+            m_touched[triangle[2]] = 1;
+        }
+
+        Quadric& target = m_quadrics[collapse.to];
+        const Quadric& source = m_quadrics[collapse.from];
+        target.a00 += source.a00;
+        target.a11 += source.a11;
+        target.a22 += source.a22;
+        target.a01 += source.a01;
+        target.a02 += source.a02;
+        target.a12 += source.a12;
+        target.b0 += source.b0;
+        target.b1 += source.b1;
+        target.b2 += source.b2;
+        target.c += source.c;
+        target.weight += source.weight;
+
+        removedTriangleCount += RemovedTriangles(collapse.from, collapse.to);
+        m_remap[collapse.from] = collapse.to;
+        m_collapses[collapseCount++] = collapse;
+    }
+
+    // keep only the applied collapses, Simplify uses them to reset m_remap
+    m_collapses.resize(collapseCount);
+    return static_cast<uint32_t>(collapseCount);
+}
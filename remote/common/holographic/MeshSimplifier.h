@@ -0,0 +1,85 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace MeshSimplification
+{
+    // Indexed triangle list with normalized int16 positions, the layout of SpatialSurfaceMesh (R16G16B16A16IntNormalized
+    // positions and R16UInt indices). A position is (component / 32767) * scale.
+    struct MeshView
+    {
+        const int16_t* positions = nullptr;
+        // Distance between two positions in int16 components.
+        uint32_t positionStride = 4;
+        uint32_t vertexCount = 0;
+        const uint16_t* indices = nullptr;
+        uint32_t indexCount = 0;
+        float scale[3] = {1.0f, 1.0f, 1.0f};
+    };
+
+    // Simplifies triangle meshes by collapsing edges in the order of their quadric error (Garland and Heckbert).
+    // An edge always collapses into one of its two vertices, so the simplified mesh indexes the vertices of the source mesh and
+    // several levels of detail can share one vertex buffer. Vertices on open borders are never moved, which keeps the borders
+    // between neighboring surface parts free of cracks, and collapses which would flip a triangle are rejected.
+    // The simplifier keeps its scratch memory between calls, an instance must not be used by several threads at once.
+    class Simplifier
+    {
+    public:
+        // Writes the indices of the simplified mesh to result. Stops when the mesh has at most targetIndexCount indices or when
+        // every remaining collapse would move the surface by more than maxError (in units of the scaled positions).
+        // Returns the number of indices written.
+        uint32_t Simplify(const MeshView& mesh, uint32_t targetIndexCount, float maxError, std::vector<uint16_t>& result);
+
+        // The vertex each vertex of the mesh passed to the last Simplify call was collapsed into, or the vertex itself if it was
+        // kept. Valid until the next call.
+        const std::vector<uint32_t>& GetVertexRemap() const
+        {
+            return m_vertexRemap;
+        }
+
+    private:
+        struct Quadric
+        {
+            float a00, a11, a22, a01, a02, a12, b0, b1, b2, c, weight;
+        };
+
+        struct Collapse
+        {
+            uint32_t from;
+            uint32_t to;
+            float error;
+        };
+
+        void ComputeQuadrics(const MeshView& mesh);
+        void ComputeAdjacency(uint32_t vertexCount);
+        void FindBorderVertices(uint32_t vertexCount);
+        void RankCollapses();
+        bool FlipsTriangle(uint32_t from, uint32_t to) const;
+        uint32_t RemovedTriangles(uint32_t from, uint32_t to) const;
+        uint32_t CollapsePass(uint32_t removeTriangleCount, float maxError);
+
+        std::vector<float> m_positions;
+        std::vector<uint32_t> m_indices;
+        std::vector<Quadric> m_quadrics;
+        std::vector<uint32_t> m_adjacencyOffsets;
+        std::vector<uint32_t> m_adjacency;
+        std::vector<uint64_t> m_edges;
+        std::vector<Collapse> m_collapses;
+        std::vector<uint32_t> m_remap;
+        std::vector<uint32_t> m_vertexRemap;
+        std::vector<uint8_t> m_locked;
+        std::vector<uint8_t> m_touched;
+    };
+} // namespace MeshSimplification
@@ -82,6 +82,15 @@ void QRCodeRenderer::Update(winrt::Windows::Perception::Spatial::SpatialCoordina
         }
     }
 
+    m_cullingSpheres.Clear();
+    m_cullingSpheres.Reserve(m_renderableQrCodes.size());
+    for (const auto& renderableCode : m_renderableQrCodes)
+    {
+        const float size = renderableCode.size;
+        float3 center = transform({0, 0, 0}, renderableCode.codeToRendering);
+        m_cullingSpheres.Add(center.x, center.y, center.z, sqrtf(2 * size * size));
+    }
+
     // The vertices are already in rendering space.
     auto modelTransform = winrt::Windows::Foundation::Numerics::float4x4::identity();
     UpdateModelConstantBuffer(modelTransform);
@@ -94,15 +103,15 @@ void QRCodeRenderer::Draw(unsigned int numInstances, winrt::Windows::Foundation:
     // Clear the vertices.
     m_vertices.clear();
 
-    for (auto renderableCode : m_renderableQrCodes)
+    // Apply frustum culling.
+    FrustumCulling::CullSpheres(m_cullingSpheres, cullingFrustum);
+
+    for (size_t codeIndex = 0; codeIndex < m_renderableQrCodes.size(); ++codeIndex)
     {
-        // Apply frustum culling.
+        const auto& renderableCode = m_renderableQrCodes[codeIndex];
         const float size = renderableCode.size;
-        winrt::Windows::Foundation::Numerics::float3 center =
-            winrt::Windows::Foundation::Numerics::transform({0, 0, 0}, renderableCode.codeToRendering);
-        float radius = sqrtf(2 * size * size);
 
-        if (FrustumCulling::SphereInFrustum(center, radius, cullingFrustum))
+        if (m_cullingSpheres.IsVisible(codeIndex))
         {
             float3 positions[4] = {{0.0f, 0.0f, 0.0f}, {0.0f, size, 0.0f}, {size, size, 0.0f}, {size, 0.0f, 0.0f}};
             for (int i = 0; i < 4; ++i)
@@ -117,27 +126,7 @@ void QRCodeRenderer::Draw(unsigned int numInstances, winrt::Windows::Foundation:
         }
     }
 
-    // Only render if vertices are available.
-    if (m_vertices.empty())
-    {
-        return;
-    }
-
-    const UINT stride = sizeof(m_vertices[0]);
-    const UINT offset = 0;
-    D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-    vertexBufferData.pSysMem = m_vertices.data();
-    const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(m_vertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-    winrt::com_ptr<ID3D11Buffer> vertexBuffer;
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, vertexBuffer.put()));
-
-    m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-        ID3D11Buffer* pBuffer = vertexBuffer.get();
-        context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
-        context->DrawInstanced(static_cast<UINT>(m_vertices.size()), numInstances, offset, 0);
-    });
+    DrawVertices(m_vertices, numInstances);
 }
 
 void QRCodeRenderer::Reset()
@@ -146,5 +135,6 @@ void QRCodeRenderer::Reset()
 
     m_qrCodes.clear();
     m_renderableQrCodes.clear();
+    m_cullingSpheres.Clear();
     m_vertices.clear();
 }
@@ -13,6 +13,7 @@
 
 #include <vector>
 
+#include <holographic/FrustumCullingBatch.h>
 #include <holographic/RenderableObject.h>
 
 #include <winrt/Microsoft.MixedReality.QR.h>
@@ -47,5 +48,8 @@ private:
     std::map<winrt::Microsoft::MixedReality::QR::QRCode, winrt::Windows::Perception::Spatial::SpatialCoordinateSystem> m_qrCodes{};
     std::vector<RenderableQRCode> m_renderableQrCodes{};
 
+    // Bounding spheres of m_renderableQrCodes, culled once per Draw.
+    FrustumCulling::SphereBatch m_cullingSpheres;
+
     std::mutex m_mutex;
 };
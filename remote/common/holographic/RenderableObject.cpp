@@ -75,6 +75,36 @@ void RenderableObject::Render(bool isStereo, winrt::Windows::Foundation::IRefere
     });
 }
 
+void RenderableObject::EndFrame()
+{
+    if (!m_loadingComplete)
+    {
+        return;
+    }
+
+    m_deviceResources->UseD3DDeviceContext([&](auto context) { m_vertexBuffer.EndFrame(m_deviceResources->GetD3DDevice(), context); });
+}
+
+void RenderableObject::DrawVertices(const std::vector<VertexPositionNormalColor>& vertices, unsigned int numInstances)
+{
+    if (vertices.empty())
+    {
+        return;
+    }
+
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        const UINT offset = m_vertexBuffer.Upload(
+            m_deviceResources->GetD3DDevice(), context, vertices.data(), vertices.size() * sizeof(VertexPositionNormalColor));
+
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        const UINT stride = sizeof(VertexPositionNormalColor);
+        ID3D11Buffer* pBuffer = m_vertexBuffer.GetBuffer();
+        context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
+        context->DrawInstanced(static_cast<UINT>(vertices.size()), numInstances, 0, 0);
+    });
+}
+
 void RenderableObject::CreateDeviceDependentResources()
 {
     m_usingVprtShaders = m_deviceResources->GetDeviceSupportsVprt();
@@ -146,6 +176,7 @@ void RenderableObject::ReleaseDeviceDependentResources()
     m_geometryShader = nullptr;
     m_modelConstantBuffer = nullptr;
     m_rasterizerState = nullptr;
+    m_vertexBuffer.ReleaseDeviceDependentResources();
 }
 
 void RenderableObject::AppendColoredTriangle(
@@ -14,6 +14,8 @@
 #include <DeviceResourcesD3D11.h>
 #include <SimpleColor_ShaderStructures.h>
 
+#include <holographic/DynamicVertexRingBuffer.h>
+
 #include <future>
 
 #include <winrt/Windows.Perception.Spatial.h>
@@ -30,6 +32,10 @@ public:
     void Render(
         bool isStereo, winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum);
 
+    // Lets the vertex buffer space used by the draws of this frame be reused once the GPU has finished the frame. Call once per
+    // frame after rendering all cameras.
+    void EndFrame();
+
 protected:
     void UpdateModelConstantBuffer(const winrt::Windows::Foundation::Numerics::float4x4& modelTransform);
 
@@ -37,6 +43,10 @@ protected:
         unsigned int numInstances,
         winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum) = 0;
 
+    // Uploads the vertices to the per-frame vertex buffer and draws them as a triangle list. Only QRCodeRenderer draws this way,
+    // SpatialInputRenderer draws instanced.
+    void DrawVertices(const std::vector<VertexPositionNormalColor>& vertices, unsigned int numInstances);
+
     static void AppendColoredTriangle(
         DirectX::XMFLOAT3 p0,
         DirectX::XMFLOAT3 p1,
@@ -65,6 +75,9 @@ private:
     winrt::com_ptr<ID3D11RasterizerState> m_rasterizerState;
     DirectX::XMFLOAT4 m_filterColorData = {1, 1, 1, 1};
 
+    // Vertices generated by Draw, shared by all cameras and frames.
+    DynamicVertexRingBuffer m_vertexBuffer;
+
     // System resources for geometry.
     ModelConstantBuffer m_modelConstantBufferData;
     uint32_t m_indexCount = 0;
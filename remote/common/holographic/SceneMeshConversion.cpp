@@ -0,0 +1,174 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <holographic/SceneMeshConversion.h>
+
+namespace SceneMeshConversion
+{
+    namespace
+    {
+        // Appends the corners 0, 2, 3 and 3, 1, 0 of a quad whose corners are given in object space, in the order
+        // (-x, -y), (x, -y), (-x, y), (x, y).
+        void AppendQuad(
+            const float (&positions)[4][3],
+            const float (&uvs)[4][2],
+            const float (&objectToScene)[16],
+            const float (&color)[3],
+            std::vector<QuadVertex>& vertices)
+        {
+            const float(&m)[16] = objectToScene;
+
+            // Transform the corners to scene space.
+            float scenePositions[4][3];
+            for (int i = 0; i < 4; ++i)
+            {
+                const float x = positions[i][0];
+                const float y = positions[i][1];
+                const float z = positions[i][2];
+                scenePositions[i][0] = x * m[0] + y * m[4] + z * m[8] + m[12];
+                scenePositions[i][1] = x * m[1] + y * m[5] + z * m[9] + m[13];
+                scenePositions[i][2] = x * m[2] + y * m[6] + z * m[10] + m[14];
+            }
+
+            constexpr int corners[6] = {0, 2, 3, 3, 1, 0};
+            const size_t firstVertex = vertices.size();
+            vertices.resize(firstVertex + 6);
+            QuadVertex* destination = vertices.data() + firstVertex;
+            for (int i = 0; i < 6; ++i)
+            {
+                const int corner = corners[i];
+                destination[i] = {
+                    {scenePositions[corner][0], scenePositions[corner][1], scenePositions[corner][2]},
+                    {uvs[corner][0], uvs[corner][1]},
+                    {color[0], color[1], color[2]}};
+            }
+        }
+    } // namespace
+
+    void AppendSceneQuad(
+        float width, float height, const float (&objectToScene)[16], const float (&color)[3], std::vector<QuadVertex>& vertices)
+    {
+        const float positions[4][3] = {
+            {-width / 2, -height / 2, 0.0f}, {width / 2, -height / 2, 0.0f}, {-width / 2, height / 2, 0.0f}, {width / 2, height / 2, 0.0f}};
+
+        // Create uv coordinates so that the checkerboard pattern becomes uniformly.
+        const float uvs[4][2] = {{0, 0}, {0, width}, {height, 0}, {height, width}};
+
+        AppendQuad(positions, uvs, objectToScene, color, vertices);
+    }
+
+    void AppendSceneQuadLabel(const float (&objectToScene)[16], const float (&color)[3], std::vector<QuadVertex>& vertices)
+    {
+        // Slightly offset in the z-direction, so that the label is drawn on top of the quad.
+        const float positions[4][3] = {
+            {-LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
+            {LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
+            {-LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f},
+            {LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f}};
+
+        const float uvs[4][2] = {{0, 1}, {1, 1}, {0, 0}, {1, 0}};
+
+        AppendQuad(positions, uvs, objectToScene, color, vertices);
+    }
+
+    void IndexedMeshBuilder::Clear()
+    {
+        m_vertices.clear();
+        m_indices.clear();
+        m_draws.clear();
+    }
+
+    void IndexedMeshBuilder::Reserve(size_t vertexCount, size_t indexCount)
+    {
+        m_vertices.reserve(vertexCount);
+        m_indices.reserve(indexCount);
+    }
+
+    void IndexedMeshBuilder::AppendMesh(
+        const float* positions,
+        uint32_t vertexCount,
+        const uint32_t* indices,
+        uint32_t indexCount,
+        const float (&objectToScene)[16],
+        const float (&color)[3])
+    {
+        if (vertexCount == 0 || indexCount == 0)
+        {
+            return;
+        }
+
+        const float(&m)[16] = objectToScene;
+
+        const size_t firstVertex = m_vertices.size();
+        m_vertices.resize(firstVertex + vertexCount);
+        Vertex* vertices = m_vertices.data() + firstVertex;
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            const float x = positions[i * 3 + 0];
+            const float y = positions[i * 3 + 1];
+            const float z = positions[i * 3 + 2];
+            vertices[i].position[0] = x * m[0] + y * m[4] + z * m[8] + m[12];
+            vertices[i].position[1] = x * m[1] + y * m[5] + z * m[9] + m[13];
+            vertices[i].position[2] = x * m[2] + y * m[6] + z * m[10] + m[14];
+        }
+
+        const uint32_t vertexOffset = static_cast<uint32_t>(firstVertex);
+        const size_t firstIndex = m_indices.size();
+        m_indices.resize(firstIndex + indexCount);
+        uint32_t* destination = m_indices.data() + firstIndex;
+        for (uint32_t i = 0; i < indexCount; ++i)
+        {
+            destination[i] = indices[i] + vertexOffset;
+        }
+
+        AddDraw(static_cast<uint32_t>(firstIndex), indexCount, color);
+    }
+
+    void IndexedMeshBuilder::Append(const IndexedMeshBuilder& other)
+    {
+        if (other.Empty())
+        {
+            return;
+        }
+
+        const uint32_t vertexOffset = static_cast<uint32_t>(m_vertices.size());
+        m_vertices.insert(m_vertices.end(), other.m_vertices.begin(), other.m_vertices.end());
+
+        const uint32_t indexOffset = static_cast<uint32_t>(m_indices.size());
+        m_indices.resize(m_indices.size() + other.m_indices.size());
+        uint32_t* destination = m_indices.data() + indexOffset;
+        for (size_t i = 0; i < other.m_indices.size(); ++i)
+        {
+            destination[i] = other.m_indices[i] + vertexOffset;
+        }
+
+        for (const Draw& draw : other.m_draws)
+        {
+            AddDraw(draw.startIndex + indexOffset, draw.indexCount, draw.color);
+        }
+    }
+
+    void IndexedMeshBuilder::AddDraw(uint32_t startIndex, uint32_t indexCount, const float (&color)[3])
+    {
+        if (!m_draws.empty())
+        {
+            // draws are appended in index order, a draw with the same color as the last one extends it
+            Draw& last = m_draws.back();
+            if (last.color[0] == color[0] && last.color[1] == color[1] && last.color[2] == color[2])
+            {
+                last.indexCount += indexCount;
+                return;
+            }
+        }
+
+        m_draws.push_back({startIndex, indexCount, {color[0], color[1], color[2]}});
+    }
+} // namespace SceneMeshConversion
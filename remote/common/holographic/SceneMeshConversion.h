@@ -0,0 +1,106 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SceneMeshConversion
+{
+    // Scene space position, the only per-vertex data of the scene mesh vertex buffer.
+    struct Vertex
+    {
+        float position[3];
+    };
+
+    // Vertex of the scene quads and their labels, with the layout of the quad vertex buffer.
+    struct QuadVertex
+    {
+        float position[3];
+        float uv[2];
+        float color[3];
+    };
+
+    // The size of the label quads in rendering space.
+    constexpr float LabelQuadWidth = 0.6f;
+    constexpr float LabelQuadHeight = 0.3f;
+
+    // Appends the two triangles (six vertices) of a Scene Understanding quad with the given extents, which is centered in the xy
+    // plane of its object. objectToScene is laid out like for IndexedMeshBuilder::AppendMesh. The uv coordinates are scaled by
+    // the extents, so that the checkerboard pattern has the same size on all quads.
+    void AppendSceneQuad(
+        float width, float height, const float (&objectToScene)[16], const float (&color)[3], std::vector<QuadVertex>& vertices);
+
+    // Appends the two triangles of the label of a quad, LabelQuadWidth by LabelQuadHeight and slightly in front of the quad.
+    void AppendSceneQuadLabel(const float (&objectToScene)[16], const float (&color)[3], std::vector<QuadVertex>& vertices);
+
+    // Range of the index buffer drawn with one color.
+    struct Draw
+    {
+        uint32_t startIndex;
+        uint32_t indexCount;
+        float color[3];
+    };
+
+    // Collects the indexed meshes of Scene Understanding scene objects into one vertex and one index buffer.
+    // Every source vertex is transformed to scene space once and the source indices are kept, offset to the shared vertex buffer.
+    // Meshes appended one after another with the same color share one draw.
+    class IndexedMeshBuilder
+    {
+    public:
+        void Clear();
+
+        // Reserves room for the given total numbers of vertices and indices, so appending does not reallocate.
+        void Reserve(size_t vertexCount, size_t indexCount);
+
+        // Appends a mesh with vertexCount positions (x, y, z) in object space. objectToScene is a row-major 4x4 matrix applied to
+        // row vectors, the layout of Windows::Foundation::Numerics::float4x4, and is expected to be affine.
+        void AppendMesh(
+            const float* positions,
+            uint32_t vertexCount,
+            const uint32_t* indices,
+            uint32_t indexCount,
+            const float (&objectToScene)[16],
+            const float (&color)[3]);
+
+        // Appends the meshes collected by another builder, which are already in scene space.
+        void Append(const IndexedMeshBuilder& other);
+
+        bool Empty() const
+        {
+            return m_indices.empty();
+        }
+
+        const std::vector<Vertex>& GetVertices() const
+        {
+            return m_vertices;
+        }
+
+        const std::vector<uint32_t>& GetIndices() const
+        {
+            return m_indices;
+        }
+
+        const std::vector<Draw>& GetDraws() const
+        {
+            return m_draws;
+        }
+
+    private:
+        void AddDraw(uint32_t startIndex, uint32_t indexCount, const float (&color)[3]);
+
+        std::vector<Vertex> m_vertices;
+        std::vector<uint32_t> m_indices;
+        std::vector<Draw> m_draws;
+    };
+} // namespace SceneMeshConversion
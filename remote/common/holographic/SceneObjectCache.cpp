@@ -0,0 +1,88 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <holographic/SceneObjectCache.h>
+
+#include <bit>
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t s_multiplier = 0xbf58476d1ce4e5b9ull;
+    constexpr size_t s_laneCount = 8;
+
+    uint64_t Mix(uint64_t state, uint64_t word)
+    {
+        state = (state ^ word) * s_multiplier;
+        return state ^ (state >> 31);
+    }
+} // namespace
+
+namespace SceneObjectCaching
+{
+    void ContentHasher::Add(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        size_t offset = 0;
+
+        // Independent lanes for large inputs like mesh data, so the multiplications do not wait for each other. The rotation
+        // carries the high bits of each word into the low bits of the next product.
+        if (size >= s_laneCount * sizeof(uint64_t))
+        {
+            uint64_t lanes[s_laneCount];
+            for (size_t i = 0; i < s_laneCount; ++i)
+            {
+                lanes[i] = m_state + i * 0x9e3779b97f4a7c15ull;
+            }
+
+            for (; offset + sizeof(lanes) <= size; offset += sizeof(lanes))
+            {
+                uint64_t words[s_laneCount];
+                memcpy(words, bytes + offset, sizeof(words));
+                for (size_t i = 0; i < s_laneCount; ++i)
+                {
+                    lanes[i] = std::rotl(lanes[i] ^ words[i], 29) * s_multiplier;
+                }
+            }
+
+            for (size_t i = 0; i < s_laneCount; ++i)
+            {
+                m_state = Mix(m_state, lanes[i]);
+            }
+        }
+
+        uint64_t state = m_state;
+        for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, bytes + offset, sizeof(word));
+            state = Mix(state, word);
+        }
+
+        if (offset < size)
+        {
+            uint64_t word = 0;
+            memcpy(&word, bytes + offset, size - offset);
+            state = Mix(state, word);
+        }
+
+        m_state = state;
+        m_size += size;
+    }
+
+    uint64_t ContentHasher::Get() const
+    {
+        // the length keeps data and the same data followed by zero bytes apart
+        uint64_t hash = Mix(m_state, m_size);
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+        return hash ^ (hash >> 31);
+    }
+} // namespace SceneObjectCaching
@@ -0,0 +1,127 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SceneObjectCaching
+{
+    // The 128 bit id (GUID) of a scene object.
+    struct ObjectId
+    {
+        uint64_t data[2] = {};
+
+        bool operator==(const ObjectId& other) const
+        {
+            return data[0] == other.data[0] && data[1] == other.data[1];
+        }
+    };
+
+    struct ObjectIdHash
+    {
+        size_t operator()(const ObjectId& id) const
+        {
+            return static_cast<size_t>(id.data[0] ^ (id.data[1] * 0x9e3779b97f4a7c15ull));
+        }
+    };
+
+    // 64 bit hash of the content of a scene object. Large inputs are consumed in eight independent lanes of eight bytes, so hashing
+    // mesh data stays cheap compared to converting it. Not suitable where collisions can be provoked.
+    class ContentHasher
+    {
+    public:
+        void Add(const void* data, size_t size);
+
+        template <class T>
+        void AddValue(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "only the bytes of the value are hashed");
+            Add(&value, sizeof(T));
+        }
+
+        uint64_t Get() const;
+
+    private:
+        uint64_t m_state = 0x243f6a8885a308d3ull;
+        uint64_t m_size = 0;
+    };
+
+    // Results of processing scene objects, keyed by object id and content hash, for reusing the results of the objects which
+    // did not change between two updates of a scene.
+    // Find may be called from several threads at once, but not while Replace runs.
+    template <class Result>
+    class ObjectResultCache
+    {
+    public:
+        using ResultPtr = std::shared_ptr<const Result>;
+
+        struct Entry
+        {
+            ObjectId id;
+            uint64_t contentHash = 0;
+            ResultPtr result;
+            // True if the result was taken from the cache.
+            bool reused = false;
+        };
+
+        // Returns the cached entry for the object if its content hash matches, or an entry without result otherwise.
+        Entry Find(const ObjectId& id, uint64_t contentHash) const
+        {
+            auto it = m_entries.find(id);
+            if (it != m_entries.end() && it->second.contentHash == contentHash)
+            {
+                return {id, contentHash, it->second.result, true};
+            }
+            return {id, contentHash, nullptr, false};
+        }
+
+        // Replaces the cached entries with the entries of the current scene, which drops the objects no longer in the scene.
+        // Entries without result belong to objects which are not processed and are not cached.
+        void Replace(const std::vector<Entry>& entries)
+        {
+            m_entries.clear();
+            m_entries.reserve(entries.size());
+            for (const Entry& entry : entries)
+            {
+                if (entry.result)
+                {
+                    m_entries.insert_or_assign(entry.id, CachedResult{entry.contentHash, entry.result});
+                }
+            }
+        }
+
+        void Clear()
+        {
+            m_entries.clear();
+        }
+
+        size_t Size() const
+        {
+            return m_entries.size();
+        }
+
+    private:
+        struct CachedResult
+        {
+            uint64_t contentHash;
+            ResultPtr result;
+        };
+
+        std::unordered_map<ObjectId, CachedResult, ObjectIdHash> m_entries;
+    };
+} // namespace SceneObjectCaching
@@ -16,6 +16,7 @@
 #include <DbgLog.h>
 #include <DirectXColors.h>
 #include <DirectXHelper.h>
+#include <FrameProfiler.h>
 
 #include <winrt/Windows.Perception.Spatial.Preview.h>
 
@@ -29,10 +30,6 @@ using namespace Microsoft::MixedReality::SceneUnderstanding;
 
 namespace
 {
-    // The size of the label quads in rendering space.
-    constexpr float LabelQuadWidth = 0.6f;
-    constexpr float LabelQuadHeight = 0.3f;
-
     // The texture size in pixels.
     constexpr int TextTextureWidth = 256;
     constexpr int TextTextureHeight = 128;
@@ -40,6 +37,10 @@ namespace
     // Logical size of the font in DIP.
     constexpr float LabelFontSize = 40.0f;
 
+    // Scene objects are processed in batches, most of them are a single quad and too small for a job of their own.
+    constexpr uint32_t ObjectProcessingThreadCount = 2;
+    constexpr size_t ObjectProcessingBatchSize = 32;
+
     // Struct to hold one entity label type entry
     struct SceneObjectLabel
     {
@@ -68,10 +69,51 @@ namespace
         memcpy_s(&locationDst, sizeof(locationDst), &locationSrc, sizeof(locationSrc));
         return locationDst;
     }
+
+    // Positions and indices of one scene mesh in object space.
+    struct SceneMeshData
+    {
+        std::vector<float3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // Reads the meshes of the object into meshes, reusing their memory, and returns the number of meshes read.
+    size_t ReadSceneMeshes(const SceneObject& object, std::vector<SceneMeshData>& meshes)
+    {
+        size_t meshCount = 0;
+        for (const std::shared_ptr<SceneMesh> mesh : object.GetMeshes())
+        {
+            if (meshes.size() <= meshCount)
+            {
+                meshes.emplace_back();
+            }
+            SceneMeshData& data = meshes[meshCount++];
+
+            data.indices.resize(mesh->GetTriangleIndexCount());
+            mesh->GetTriangleIndices(data.indices);
+
+            const uint32_t vertexCount = mesh->GetVertexCount();
+            data.positions.resize(vertexCount);
+            float3* ptr = data.positions.data();
+            mesh->GetVertexPositions(ptr, vertexCount);
+        }
+        return meshCount;
+    }
+
+    SceneObjectCaching::ObjectId GetObjectId(const SceneObject& object)
+    {
+        const auto id = object.GetId();
+        static_assert(sizeof(id) == sizeof(SceneObjectCaching::ObjectId::data), "scene object ids are GUIDs");
+
+        SceneObjectCaching::ObjectId result;
+        memcpy_s(result.data, sizeof(result.data), &id, sizeof(id));
+        return result;
+    }
 } // namespace
 
 SceneUnderstandingRenderer::SceneUnderstandingRenderer(const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources)
     : m_deviceResources(deviceResources)
+    , m_objectProcessingPool(ObjectProcessingThreadCount)
 {
     CreateDeviceDependentResources();
 }
@@ -175,6 +217,24 @@ void SceneUnderstandingRenderer::CreateDeviceDependentResources()
             m_inputLayout.put()));
     }
 
+    // Vertex shader and input layout for the scene mesh, which only has positions.
+    {
+        std::vector<byte> vertexShaderFileData = DXHelper::ReadFromFile(L"SUMesh_VertexShader.cso");
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateVertexShader(
+            vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_meshVertexShader.put()));
+
+        constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 1> vertexDesc = {{
+            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        }};
+
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
+            vertexDesc.data(),
+            static_cast<UINT>(vertexDesc.size()),
+            vertexShaderFileData.data(),
+            static_cast<UINT>(vertexShaderFileData.size()),
+            m_meshInputLayout.put()));
+    }
+
     // Pixel shader for scene quads.
     {
         std::vector<byte> pixelShaderFileData = DXHelper::ReadFromFile(L"SUQuads_PixelShader.cso");
@@ -211,6 +271,10 @@ void SceneUnderstandingRenderer::CreateDeviceDependentResources()
     const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(DirectX::XMFLOAT4X4), D3D11_BIND_CONSTANT_BUFFER);
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, m_modelConstantBuffer.put()));
 
+    const CD3D11_BUFFER_DESC colorConstantBufferDesc(sizeof(DirectX::XMFLOAT4), D3D11_BIND_CONSTANT_BUFFER);
+    winrt::check_hresult(
+        m_deviceResources->GetD3DDevice()->CreateBuffer(&colorConstantBufferDesc, nullptr, m_meshColorConstantBuffer.put()));
+
     // Create the blend state.
     {
         CD3D11_BLEND_DESC blendStateDesc(D3D11_DEFAULT);
@@ -244,12 +308,15 @@ void SceneUnderstandingRenderer::ReleaseDeviceDependentResources()
     m_loadingComplete = false;
 
     m_inputLayout = nullptr;
+    m_meshInputLayout = nullptr;
     m_vertexShader = nullptr;
+    m_meshVertexShader = nullptr;
     m_geometryShader = nullptr;
     m_quadsPixelShader = nullptr;
     m_meshPixelShader = nullptr;
     m_rasterizerState = nullptr;
     m_modelConstantBuffer = nullptr;
+    m_meshColorConstantBuffer = nullptr;
 
     for (auto const& [kind, label] : m_sceneQuadsLabels)
     {
@@ -269,15 +336,14 @@ void SceneUnderstandingRenderer::ReleaseDeviceDependentResources()
 
 void SceneUnderstandingRenderer::SetScene(std::shared_ptr<Scene> scene, SpatialStationaryFrameOfReference lastUpdateLocation)
 {
-    // While the vertices are updated asynchronously the scene cannot be set.
+    // The vertices are created from the scene taken at the start of their update, a scene set meanwhile gets its own update.
     std::lock_guard lock(m_mutex);
 
     m_scene = scene;
     m_sceneLastUpdateLocation = lastUpdateLocation;
+    m_sceneVersion++;
 
     m_verticesOutdated = true;
-
-    m_coordinateSystem = nullptr;
 }
 
 void SceneUnderstandingRenderer::Update(SpatialCoordinateSystem renderingCoordinateSystem)
@@ -298,14 +364,15 @@ void SceneUnderstandingRenderer::Update(SpatialCoordinateSystem renderingCoordin
 
     m_validSceneToRenderingTransform = false;
 
-    if (m_scene)
+    // The vertices are in the space of the scene they were created from, which is replaced only together with them.
+    if (m_scene && m_renderedScene)
     {
         if (m_coordinateSystem == nullptr)
         {
             try
             {
                 m_coordinateSystem =
-                    Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(m_scene->GetOriginSpatialGraphNodeId());
+                    Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(m_renderedScene->GetOriginSpatialGraphNodeId());
             }
             catch (winrt::hresult_error const&)
             {
@@ -346,169 +413,242 @@ winrt::fire_and_forget SceneUnderstandingRenderer::CreateVerticesAsync(
 
     if (auto strongThis = weakThis.lock())
     {
-        std::lock_guard lock(m_mutex);
-
-        // Clear the vertices.
-        m_quadVertices.clear();
-        m_quadLabelsVertices.clear();
-        m_meshVertices.clear();
+        FRAME_PROFILER_SCOPE("CreateSceneVertices");
+        std::lock_guard processingLock(m_processingMutex);
 
-        // Collect all scene objects, then iterate to find quad entities
-        for (const std::shared_ptr<SceneObject> object : m_scene->GetSceneObjects())
+        std::shared_ptr<Scene> scene;
+        uint64_t sceneVersion = 0;
         {
-            // Check if the object is in the quads labels.
-            auto quadLabelPos = m_sceneQuadsLabels.find(object->GetKind());
-            if (quadLabelPos != m_sceneQuadsLabels.end())
-            {
-                const SceneObjectLabel& label = quadLabelPos->second;
-                auto [r, g, b] = label.color;
-                float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
+            std::lock_guard lock(m_mutex);
+            scene = m_scene;
+            sceneVersion = m_sceneVersion;
+        }
 
-                // Adds the quads to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's owner
-                // entity's type.
-                AddSceneQuadsVertices(*object, color);
+        std::vector<std::shared_ptr<SceneObject>> objects;
+        if (scene)
+        {
+            objects = scene->GetSceneObjects();
+        }
 
-                // Adds the label quads to the vertex buffer for rendering.
-                AddSceneQuadLabelVertices(*object, color);
+        // Create the vertices of the changed scene objects on the workers and take the vertices of the others from the cache.
+        std::vector<SceneObjectCache::Entry> entries(objects.size());
+        m_objectProcessingPool.ParallelFor(objects.size(), ObjectProcessingBatchSize, [&](size_t begin, size_t end) {
+            FRAME_PROFILER_SCOPE("ProcessSceneObjects");
+            for (size_t i = begin; i < end; ++i)
+            {
+                entries[i] = ProcessSceneObject(*objects[i]);
             }
+        });
+        m_objectCache.Replace(entries);
 
-            // Check if the object is in the mesh labels.
-            auto meshLabelPos = m_sceneMeshLabels.find(object->GetKind());
-            if (meshLabelPos != m_sceneMeshLabels.end())
+        std::vector<SceneObjectCache::ResultPtr> results;
+        results.reserve(entries.size());
+        for (const SceneObjectCache::Entry& entry : entries)
+        {
+            if (entry.result)
             {
-                const SceneObjectLabel& label = meshLabelPos->second;
-                auto [r, g, b] = label.color;
-                float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
-
-                // Adds the sceneMeshes to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's
-                // owner entity's type.
-                AddSceneMeshVertices(*object, color);
+                results.push_back(entry.result);
             }
         }
 
-        // Create the d3d11 vertex buffers.
-        const UINT stride = sizeof(VertexPositionUVColor);
-        const UINT offset = 0;
+        // The vertices only need to be merged again if an object was added, changed or removed. The merged results are kept
+        // alive, so an unchanged pointer means an unchanged object.
+        const bool objectsChanged = results != m_mergedResults;
 
-        // Quads.
-        if (!m_quadVertices.empty())
-        {
-            m_quadVerticesBuffer = nullptr;
-            D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-            vertexBufferData.pSysMem = m_quadVertices.data();
-            const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(m_quadVertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-            winrt::check_hresult(
-                m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_quadVerticesBuffer.put()));
-        }
-        // Labels.
-        for (auto const& [kind, vertices] : m_quadLabelsVertices)
+        std::vector<VertexPositionUVColor> quadVertices;
+        std::map<SceneObjectKind, std::vector<VertexPositionUVColor>> quadLabelsVertices;
+        SceneMeshConversion::IndexedMeshBuilder mesh;
+        winrt::com_ptr<ID3D11Buffer> quadVerticesBuffer;
+        std::map<SceneObjectKind, winrt::com_ptr<ID3D11Buffer>> quadLabelsVerticesBuffer;
+        winrt::com_ptr<ID3D11Buffer> meshVerticesBuffer;
+        winrt::com_ptr<ID3D11Buffer> meshIndicesBuffer;
+
+        if (objectsChanged)
         {
-            if (!vertices.empty())
+            // Merge the vertices of all objects.
+            size_t quadVertexCount = 0;
+            size_t meshVertexCount = 0;
+            size_t meshIndexCount = 0;
+            for (const SceneObjectCache::ResultPtr& result : results)
+            {
+                quadVertexCount += result->quadVertices.size();
+                meshVertexCount += result->mesh.GetVertices().size();
+                meshIndexCount += result->mesh.GetIndices().size();
+            }
+
+            quadVertices.reserve(quadVertexCount);
+            mesh.Reserve(meshVertexCount, meshIndexCount);
+            for (const SceneObjectCache::ResultPtr& result : results)
+            {
+                quadVertices.insert(quadVertices.end(), result->quadVertices.begin(), result->quadVertices.end());
+                if (!result->labelVertices.empty())
+                {
+                    std::vector<VertexPositionUVColor>& labelVertices = quadLabelsVertices[result->labelKind];
+                    labelVertices.insert(labelVertices.end(), result->labelVertices.begin(), result->labelVertices.end());
+                }
+                mesh.Append(result->mesh);
+            }
+
+            // Create the d3d11 vertex buffers.
+            FRAME_PROFILER_SCOPE("UploadSceneVertices");
+            const UINT stride = sizeof(VertexPositionUVColor);
+
+            // Quads.
+            if (!quadVertices.empty())
+            {
+                D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
+                vertexBufferData.pSysMem = quadVertices.data();
+                const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(quadVertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
+                winrt::check_hresult(
+                    m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, quadVerticesBuffer.put()));
+            }
+            // Labels.
+            for (auto const& [kind, vertices] : quadLabelsVertices)
             {
-                m_quadLabelsVerticesBuffer[kind] = nullptr;
                 D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
                 vertexBufferData.pSysMem = vertices.data();
                 const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(vertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
                 winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(
-                    &vertexBufferDesc, &vertexBufferData, m_quadLabelsVerticesBuffer[kind].put()));
+                    &vertexBufferDesc, &vertexBufferData, quadLabelsVerticesBuffer[kind].put()));
+            }
+            // Mesh.
+            if (!mesh.Empty())
+            {
+                const std::vector<SceneMeshConversion::Vertex>& vertices = mesh.GetVertices();
+                D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
+                vertexBufferData.pSysMem = vertices.data();
+                const CD3D11_BUFFER_DESC vertexBufferDesc(
+                    static_cast<UINT>(vertices.size() * sizeof(SceneMeshConversion::Vertex)), D3D11_BIND_VERTEX_BUFFER);
+                winrt::check_hresult(
+                    m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, meshVerticesBuffer.put()));
+
+                const std::vector<uint32_t>& indices = mesh.GetIndices();
+                D3D11_SUBRESOURCE_DATA indexBufferData = {0};
+                indexBufferData.pSysMem = indices.data();
+                const CD3D11_BUFFER_DESC indexBufferDesc(static_cast<UINT>(indices.size() * sizeof(uint32_t)), D3D11_BIND_INDEX_BUFFER);
+                winrt::check_hresult(
+                    m_deviceResources->GetD3DDevice()->CreateBuffer(&indexBufferDesc, &indexBufferData, meshIndicesBuffer.put()));
             }
         }
-        // Mesh.
-        if (!m_meshVertices.empty())
+
+        // Exchange the vertices used for rendering. The previous vertices are released after the lock.
         {
-            m_meshVerticesBuffer = nullptr;
-            D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-            vertexBufferData.pSysMem = m_meshVertices.data();
-            const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(m_meshVertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-            winrt::check_hresult(
-                m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_meshVerticesBuffer.put()));
+            std::lock_guard lock(m_mutex);
+
+            if (objectsChanged)
+            {
+                std::swap(m_quadVertices, quadVertices);
+                std::swap(m_quadLabelsVertices, quadLabelsVertices);
+                std::swap(m_mesh, mesh);
+                std::swap(m_quadVerticesBuffer, quadVerticesBuffer);
+                std::swap(m_quadLabelsVerticesBuffer, quadLabelsVerticesBuffer);
+                std::swap(m_meshVerticesBuffer, meshVerticesBuffer);
+                std::swap(m_meshIndicesBuffer, meshIndicesBuffer);
+            }
+
+            // The origin of the scene can have changed, even if the vertices relative to it did not.
+            if (m_renderedScene != scene)
+            {
+                m_renderedScene = scene;
+                m_coordinateSystem = nullptr;
+            }
+
+            // Done with updating.
+            m_verticesUpdating = false;
+            // The vertices are up to date unless the scene was set again in the meantime.
+            if (m_sceneVersion == sceneVersion)
+            {
+                m_verticesOutdated = false;
+            }
         }
 
-        // Done with updating.
-        m_verticesUpdating = false;
-        // All the vertices are now up to date and can be used for rendering.
-        m_verticesOutdated = false;
+        m_mergedResults = std::move(results);
     }
 }
 
-void SceneUnderstandingRenderer::AddSceneQuadsVertices(const SceneObject& object, const float3& color)
+SceneUnderstandingRenderer::SceneObjectCache::Entry SceneUnderstandingRenderer::ProcessSceneObject(const SceneObject& object) const
 {
-    float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
-    const std::shared_ptr<SceneQuad> quad = object.GetQuad();
-    // Create the quad's corner points in object space.
-    const float width = quad->GetExtents().X;
-    const float height = quad->GetExtents().Y;
-    float3 positions[4] = {
-        {-width / 2, -height / 2, 0.0f}, {width / 2, -height / 2, 0.0f}, {-width / 2, height / 2, 0.0f}, {width / 2, height / 2, 0.0f}};
-
-    // Transform the vertices to scene space.
-    for (int i = 0; i < 4; ++i)
+    thread_local std::vector<SceneMeshData> meshes;
+
+    const SceneObjectKind kind = object.GetKind();
+    const auto quadLabelPos = m_sceneQuadsLabels.find(kind);
+    const auto meshLabelPos = m_sceneMeshLabels.find(kind);
+    const bool hasQuad = quadLabelPos != m_sceneQuadsLabels.end();
+    const bool hasMesh = meshLabelPos != m_sceneMeshLabels.end();
+    if (!hasQuad && !hasMesh)
     {
-        positions[i] = transform(positions[i], objectToSceneTransform);
+        return {};
     }
 
-    // Create uv coordinates so that the checkerboard pattern becomes uniformly.
-    float2 uvs[4] = {{0, 0}, {0, width}, {height, 0}, {height, width}};
+    // The content hash covers everything the vertices are created from.
+    const float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
+    SceneObjectCaching::ContentHasher hasher;
+    hasher.AddValue(kind);
+    hasher.AddValue(objectToSceneTransform);
+    if (hasQuad)
+    {
+        hasher.AddValue(object.GetQuad()->GetExtents());
+    }
 
-    // Create the vertices with uv coordinates for the quad.
-    AppendQuad(positions, uvs, height, width, color, m_quadVertices);
-}
+    size_t meshCount = 0;
+    if (hasMesh)
+    {
+        meshCount = ReadSceneMeshes(object, meshes);
+        for (size_t i = 0; i < meshCount; ++i)
+        {
+            hasher.AddValue(meshes[i].positions.size());
+            hasher.Add(meshes[i].positions.data(), meshes[i].positions.size() * sizeof(float3));
+            hasher.Add(meshes[i].indices.data(), meshes[i].indices.size() * sizeof(uint32_t));
+        }
+    }
 
-void SceneUnderstandingRenderer::AddSceneQuadLabelVertices(const SceneObject& object, const float3& color)
-{
-    float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
-    const std::shared_ptr<SceneQuad> quad = object.GetQuad();
-    // Create the quad's corner points in object space with a slight offset in the z-direction.
-    float3 positions[4] = {
-        {-LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
-        {LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
-        {-LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f},
-        {LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f}};
-
-    // Transform the vertices to scene space.
-    for (int i = 0; i < 4; ++i)
+    SceneObjectCache::Entry entry = m_objectCache.Find(GetObjectId(object), hasher.Get());
+    if (entry.result)
     {
-        positions[i] = transform(positions[i], objectToSceneTransform);
+        return entry;
     }
-    // Create uv coordinates.
-    float2 uvs[4] = {{0, 1}, {1, 1}, {0, 0}, {1, 0}};
 
-    // Create the vertices with uv coordinates for the quad labels.
-    AppendQuad(positions, uvs, LabelQuadHeight, LabelQuadWidth, color, m_quadLabelsVertices[object.GetKind()]);
-}
+    float objectToScene[16];
+    memcpy_s(objectToScene, sizeof(objectToScene), &objectToSceneTransform, sizeof(objectToSceneTransform));
 
-void SceneUnderstandingRenderer::AddSceneMeshVertices(const SceneObject& object, const float3& color)
-{
-    float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
-    for (const std::shared_ptr<SceneMesh> mesh : object.GetMeshes())
+    auto vertices = std::make_shared<SceneObjectVertices>();
+    if (hasQuad)
     {
-        const uint32_t indicesCount = mesh->GetTriangleIndexCount();
-        std::vector<uint32_t> indices(indicesCount);
-        mesh->GetTriangleIndices(indices);
-
-        // Get the mesh's vertices in object space.
-        uint32_t vertexCount = mesh->GetVertexCount();
-        std::vector<float3> vertices(vertexCount);
-        float3* ptr = vertices.data();
-        mesh->GetVertexPositions(ptr, vertexCount);
-
-        // Transform the vertices to scene space and create the triangles.
-        for (uint32_t i = 0; i < indices.size(); i += 3)
-        {
-            VertexPositionUVColor vertex;
-            vertex.color = DXHelper::Float3ToXMFloat3(color);
-            vertex.uv = {0, 0};
-
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
+        const SceneObjectLabel& label = quadLabelPos->second;
+        auto [r, g, b] = label.color;
+        const float color[3] = {r / 255.0f, g / 255.0f, b / 255.0f};
+
+        // Adds the quads to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's owner
+        // entity's type.
+        const auto extents = object.GetQuad()->GetExtents();
+        SceneMeshConversion::AppendSceneQuad(extents.X, extents.Y, objectToScene, color, vertices->quadVertices);
+
+        // Adds the label quads to the vertex buffer for rendering.
+        vertices->labelKind = kind;
+        SceneMeshConversion::AppendSceneQuadLabel(objectToScene, color, vertices->labelVertices);
+    }
 
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i + 1]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
+    if (hasMesh)
+    {
+        const SceneObjectLabel& label = meshLabelPos->second;
+        auto [r, g, b] = label.color;
+        const float color[3] = {r / 255.0f, g / 255.0f, b / 255.0f};
 
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i + 2]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
+        // Transform the vertices to scene space once each and keep the triangles indexed.
+        for (size_t i = 0; i < meshCount; ++i)
+        {
+            vertices->mesh.AppendMesh(
+                reinterpret_cast<const float*>(meshes[i].positions.data()),
+                static_cast<uint32_t>(meshes[i].positions.size()),
+                meshes[i].indices.data(),
+                static_cast<uint32_t>(meshes[i].indices.size()),
+                objectToScene,
+                color);
         }
     }
+
+    entry.result = std::move(vertices);
+    return entry;
 }
 
 void SceneUnderstandingRenderer::ToggleRenderingType()
@@ -524,8 +664,10 @@ void SceneUnderstandingRenderer::Render(bool isStereo)
         return;
     }
 
-    // Only render if the scene is not being updated and there is a valid scene to rendering transformation.
-    if (!m_verticesUpdating && m_validSceneToRenderingTransform)
+    // Only render if there is a valid scene to rendering transformation. While the scene is updated, the vertices of the
+    // previous update are rendered with the transform of the scene they were created from.
+    std::lock_guard lock(m_mutex);
+    if (m_validSceneToRenderingTransform)
     {
         // For RenderingType::Mesh only render the scene mesh. In case of RenderingType::Quads only render the scene quads with labels. For
         // RenderingType::All render the scene mesh and the scene quads with labels.
@@ -630,7 +772,7 @@ void SceneUnderstandingRenderer::RenderSceneQuadsLabel(bool isStereo)
 void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
 {
     // Only render if vertices are available.
-    if (m_meshVertices.empty())
+    if (m_mesh.Empty())
     {
         return;
     }
@@ -639,11 +781,13 @@ void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
         context->OMSetBlendState(m_blendState.get(), nullptr, 0xffffffff);
 
-        context->IASetInputLayout(m_inputLayout.get());
+        context->IASetInputLayout(m_meshInputLayout.get());
 
-        context->VSSetShader(m_vertexShader.get(), nullptr, 0);
+        context->VSSetShader(m_meshVertexShader.get(), nullptr, 0);
         ID3D11Buffer* modelBuffer = m_modelConstantBuffer.get();
         context->VSSetConstantBuffers(0, 1, &modelBuffer);
+        ID3D11Buffer* colorBuffer = m_meshColorConstantBuffer.get();
+        context->VSSetConstantBuffers(2, 1, &colorBuffer);
 
         context->GSSetShader(m_geometryShader.get(), nullptr, 0);
 
@@ -653,59 +797,30 @@ void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
 
         context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        const UINT stride = sizeof(VertexPositionUVColor);
+        const UINT stride = sizeof(SceneMeshConversion::Vertex);
         const UINT offset = 0;
         ID3D11Buffer* pBuffer = m_meshVerticesBuffer.get();
         context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
+        context->IASetIndexBuffer(m_meshIndicesBuffer.get(), DXGI_FORMAT_R32_UINT, 0);
+
+        for (const SceneMeshConversion::Draw& draw : m_mesh.GetDraws())
+        {
+            const DirectX::XMFLOAT4 color = {draw.color[0], draw.color[1], draw.color[2], 1.0f};
+            context->UpdateSubresource(m_meshColorConstantBuffer.get(), 0, nullptr, &color, 0, 0);
 
-        context->DrawInstanced(static_cast<UINT>(m_meshVertices.size()), isStereo ? 2 : 1, offset, 0);
+            context->DrawIndexedInstanced(draw.indexCount, isStereo ? 2 : 1, draw.startIndex, 0, 0);
+        }
 
         context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
     });
 }
 
-// Appends a quad to the given collection.
-void SceneUnderstandingRenderer::AppendQuad(
-    const float3 positions[4],
-    const float2 uvs[4],
-    const float height,
-    const float width,
-    const float3& color,
-    std::vector<VertexPositionUVColor>& vertices)
-{
-    VertexPositionUVColor vertex;
-    vertex.color = DXHelper::Float3ToXMFloat3(color);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[0]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[0]);
-    vertices.push_back(vertex);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[2]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[2]);
-    vertices.push_back(vertex);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[3]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[3]);
-    vertices.push_back(vertex);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[3]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[3]);
-    vertices.push_back(vertex);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[1]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[1]);
-    vertices.push_back(vertex);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[0]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[0]);
-    vertices.push_back(vertex);
-}
-
 void SceneUnderstandingRenderer::Reset()
 {
     std::lock_guard lock(m_mutex);
 
     m_scene = nullptr;
+    m_renderedScene = nullptr;
     m_sceneLastUpdateLocation = nullptr;
     m_verticesOutdated = false;
     m_verticesUpdating = false;
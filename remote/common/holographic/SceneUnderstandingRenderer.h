@@ -15,6 +15,10 @@
 #include <string>
 
 #include <DeviceResourcesD3D11.h>
+#include <JobPool.h>
+
+#include <holographic/SceneMeshConversion.h>
+#include <holographic/SceneObjectCache.h>
 
 #include <Microsoft.MixedReality.SceneUnderstanding.h>
 #include <winrt/Windows.Perception.Spatial.h>
@@ -42,13 +46,19 @@ public:
     void Reset();
 
 private:
-    struct VertexPositionUVColor
+    using VertexPositionUVColor = SceneMeshConversion::QuadVertex;
+
+    // The vertices created for one scene object, cached between scene updates while the object does not change.
+    struct SceneObjectVertices
     {
-        DirectX::XMFLOAT3 pos;
-        DirectX::XMFLOAT2 uv;
-        DirectX::XMFLOAT3 color;
+        std::vector<VertexPositionUVColor> quadVertices;
+        Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind labelKind{};
+        std::vector<VertexPositionUVColor> labelVertices;
+        SceneMeshConversion::IndexedMeshBuilder mesh;
     };
 
+    using SceneObjectCache = SceneObjectCaching::ObjectResultCache<SceneObjectVertices>;
+
     enum RenderingType
     {
         None = 0,
@@ -62,27 +72,14 @@ private:
         winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem,
         winrt::Windows::Perception::Spatial::SpatialStationaryFrameOfReference lastUpdateLocation);
 
-    void AddSceneQuadsVertices(
-        const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, const winrt::Windows::Foundation::Numerics::float3& color);
-
-    void AddSceneQuadLabelVertices(
-        const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, const winrt::Windows::Foundation::Numerics::float3& color);
-
-    void AddSceneMeshVertices(
-        const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, const winrt::Windows::Foundation::Numerics::float3& color);
+    // Returns the cached vertices of the object if its content did not change since the last update, or creates them.
+    // Called on the object processing workers.
+    SceneObjectCache::Entry ProcessSceneObject(const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object) const;
 
     void RenderSceneMesh(bool isStereo);
     void RenderSceneQuads(bool isStereo);
     void RenderSceneQuadsLabel(bool isStereo);
 
-    static void AppendQuad(
-        const winrt::Windows::Foundation::Numerics::float3 positions[4],
-        const winrt::Windows::Foundation::Numerics::float2 uvs[4],
-        const float height,
-        const float width,
-        const winrt::Windows::Foundation::Numerics::float3& color,
-        std::vector<VertexPositionUVColor>& vertices);
-
     // The current renderingType.
     RenderingType m_renderingType = RenderingType::None;
 
@@ -92,8 +89,8 @@ private:
     // The vertices for the same SceneObjectKind are stored in the same collection.
     std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, std::vector<VertexPositionUVColor>> m_quadLabelsVertices;
 
-    // The vertices for the scene mesh.
-    std::vector<VertexPositionUVColor> m_meshVertices;
+    // The indexed scene mesh, with one draw per color.
+    SceneMeshConversion::IndexedMeshBuilder m_mesh;
 
     // Cached pointer to device resources.
     std::shared_ptr<DXHelper::DeviceResourcesD3D11> m_deviceResources;
@@ -102,13 +99,17 @@ private:
     winrt::com_ptr<ID3D11Buffer> m_quadVerticesBuffer;
     std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11Buffer>> m_quadLabelsVerticesBuffer;
     winrt::com_ptr<ID3D11Buffer> m_meshVerticesBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_meshIndicesBuffer;
     winrt::com_ptr<ID3D11InputLayout> m_inputLayout = nullptr;
+    winrt::com_ptr<ID3D11InputLayout> m_meshInputLayout = nullptr;
     winrt::com_ptr<ID3D11VertexShader> m_vertexShader = nullptr;
+    winrt::com_ptr<ID3D11VertexShader> m_meshVertexShader = nullptr;
     winrt::com_ptr<ID3D11GeometryShader> m_geometryShader = nullptr;
     winrt::com_ptr<ID3D11PixelShader> m_quadsPixelShader = nullptr;
     winrt::com_ptr<ID3D11PixelShader> m_meshPixelShader = nullptr;
     winrt::com_ptr<ID3D11RasterizerState> m_rasterizerState = nullptr;
     winrt::com_ptr<ID3D11Buffer> m_modelConstantBuffer = nullptr;
+    winrt::com_ptr<ID3D11Buffer> m_meshColorConstantBuffer = nullptr;
 
     // True if the model constant buffer up to date.
     bool m_validSceneToRenderingTransform = false;
@@ -119,13 +120,25 @@ private:
     // The scene understanding scene.
     std::shared_ptr<Microsoft::MixedReality::SceneUnderstanding::Scene> m_scene = nullptr;
     winrt::Windows::Perception::Spatial::SpatialStationaryFrameOfReference m_sceneLastUpdateLocation = nullptr;
+    // The scene the vertices used for rendering were created from. m_coordinateSystem is at its origin.
+    std::shared_ptr<Microsoft::MixedReality::SceneUnderstanding::Scene> m_renderedScene = nullptr;
+    // Incremented by every SetScene, tells whether the scene changed while its vertices were created.
+    uint64_t m_sceneVersion = 0;
     // True if the scene was updated but the vertices for the rendering are not created yet.
     bool m_verticesOutdated = false;
     // True if the scene was updated and the vertices are currently asynchronously updated.
     bool m_verticesUpdating = false;
-    // Mutex to prevent the scene from updating while the vertices are still updating.
+    // Protects the scene and the vertices and buffers used for rendering. Only held briefly to exchange them, the vertices are
+    // created without holding it.
     std::mutex m_mutex;
 
+    // Serializes the creation of vertices, which owns m_objectCache.
+    std::mutex m_processingMutex;
+    // The vertices of the scene objects of the last update by object id.
+    SceneObjectCache m_objectCache;
+    // The vertices of the scene objects in the order they were merged for rendering.
+    std::vector<SceneObjectCache::ResultPtr> m_mergedResults;
+
     // DirectX resources for text rendering.
     std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11Texture2D>> m_textTextures;
     std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11ShaderResourceView>>
@@ -142,4 +155,7 @@ private:
 
     // The spatial coordinate system.
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_coordinateSystem = nullptr;
+
+    // Workers processing the scene objects. Declared last, so the workers are joined before the members they use are destroyed.
+    JobPool m_objectProcessingPool;
 };
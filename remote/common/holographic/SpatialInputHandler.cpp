@@ -13,6 +13,8 @@
 
 #include <holographic/SpatialInputHandler.h>
 
+#include <DbgLog.h>
+
 #include <winrt/Windows.Foundation.h>
 #include <winrt/Windows.UI.Input.Spatial.h>
 
@@ -94,14 +96,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
             [this](
                 winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer,
                 winrt::Windows::UI::Input::Spatial::SpatialNavigationStartedEventArgs args) {
-                char buf[128];
-                sprintf_s(
-                    buf,
-                    "NS: %d %d %d\n",
-                    static_cast<int>(args.IsNavigatingX()),
-                    static_cast<int>(args.IsNavigatingY()),
-                    static_cast<int>(args.IsNavigatingZ()));
-                OutputDebugStringA(buf);
+                DebugLog("NS: %d %d %d", args.IsNavigatingX(), args.IsNavigatingY(), args.IsNavigatingZ());
             }));
 
     m_navigationUpdatedEventToken =
@@ -112,9 +107,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
                 winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer,
                 winrt::Windows::UI::Input::Spatial::SpatialNavigationUpdatedEventArgs args) {
                 winrt::Windows::Foundation::Numerics::float3 offset = args.NormalizedOffset();
-                char buf[128];
-                sprintf_s(buf, "NU: %f %f %f\n", offset.x, offset.y, offset.z);
-                OutputDebugStringA(buf);
+                DebugLog("NU: %f %f %f", offset.x, offset.y, offset.z);
             }));
 
     m_navigationCompletedEventToken =
@@ -125,9 +118,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
                 winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer,
                 winrt::Windows::UI::Input::Spatial::SpatialNavigationCompletedEventArgs args) {
                 winrt::Windows::Foundation::Numerics::float3 offset = args.NormalizedOffset();
-                char buf[128];
-                sprintf_s(buf, "NC: %f %f %f\n", offset.x, offset.y, offset.z);
-                OutputDebugStringA(buf);
+                DebugLog("NC: %f %f %f", offset.x, offset.y, offset.z);
             }));
 
     m_navigationCanceledEventToken =
@@ -137,9 +128,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
             [this](
                 winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer,
                 winrt::Windows::UI::Input::Spatial::SpatialNavigationCanceledEventArgs args) {
-                char buf[128];
-                sprintf_s(buf, "N: canceled\n");
-                OutputDebugStringA(buf);
+                DebugLog("N: canceled");
             }));
 }
 
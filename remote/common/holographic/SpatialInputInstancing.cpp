@@ -0,0 +1,168 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <holographic/SpatialInputInstancing.h>
+
+#include <algorithm>
+
+namespace
+{
+    using namespace SpatialInputInstancing;
+
+    void AppendTriangle(
+        const float (&p0)[4], const float (&p1)[4], const float (&p2)[4], float r, float g, float b, std::vector<ShapeVertex>& vertices)
+    {
+        vertices.push_back({{p0[0], p0[1], p0[2], p0[3]}, {r, g, b}});
+        vertices.push_back({{p1[0], p1[1], p1[2], p1[3]}, {r, g, b}});
+        vertices.push_back({{p2[0], p2[1], p2[2], p2[3]}, {r, g, b}});
+    }
+
+    struct ShapeMeshes
+    {
+        std::vector<ShapeVertex> vertices;
+        ShapeMesh meshes[static_cast<size_t>(Shape::Count)];
+
+        ShapeMeshes()
+        {
+            // Joint: the base at the joint position, a square at the joint radius and min(radius, length / 2) along -z, and the
+            // top at length along -z. The faces have fixed colors, the instances add black.
+            {
+                const float c = 0.70710678f;
+                const float base[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                const float center[4][4] = {{-c, -c, -1.0f, 0.0f}, {-c, c, -1.0f, 0.0f}, {c, c, -1.0f, 0.0f}, {c, -c, -1.0f, 0.0f}};
+                const float top[4] = {0.0f, 0.0f, 0.0f, -1.0f};
+
+                Begin(Shape::Joint);
+                AppendTriangle(base, center[0], center[1], 0.0f, 0.0f, 0.4f, vertices);
+                AppendTriangle(base, center[1], center[2], 0.0f, 0.4f, 0.0f, vertices);
+                AppendTriangle(base, center[2], center[3], 0.4f, 0.0f, 0.0f, vertices);
+                AppendTriangle(base, center[3], center[0], 0.4f, 0.4f, 0.0f, vertices);
+                AppendTriangle(top, center[1], center[0], 0.0f, 0.0f, 0.6f, vertices);
+                AppendTriangle(top, center[2], center[1], 0.0f, 0.6f, 0.0f, vertices);
+                AppendTriangle(top, center[3], center[2], 0.6f, 0.0f, 0.0f, vertices);
+                AppendTriangle(top, center[0], center[3], 0.6f, 0.6f, 0.0f, vertices);
+                End(Shape::Joint);
+            }
+
+            // Quad and pointer: sized by the radius alone (with length = 2 * radius), colored by the instances.
+            {
+                const float corners[4][4] = {
+                    {-1.0f, 0.0f, -1.0f, 0.0f}, {1.0f, 0.0f, -1.0f, 0.0f}, {1.0f, 0.0f, 1.0f, 0.0f}, {-1.0f, 0.0f, 1.0f, 0.0f}};
+
+                Begin(Shape::Quad);
+                AppendTriangle(corners[0], corners[1], corners[2], 0.0f, 0.0f, 0.0f, vertices);
+                AppendTriangle(corners[2], corners[3], corners[0], 0.0f, 0.0f, 0.0f, vertices);
+                End(Shape::Quad);
+            }
+
+            {
+                const float tip[4] = {0.0f, 3.0f, 0.0f, 0.0f};
+                const float right[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+                const float left[4] = {-1.0f, 0.0f, 0.0f, 0.0f};
+
+                Begin(Shape::Pointer);
+                AppendTriangle(tip, right, left, 0.0f, 0.0f, 0.0f, vertices);
+                End(Shape::Pointer);
+            }
+        }
+
+        void Begin(Shape shape)
+        {
+            meshes[static_cast<size_t>(shape)].startVertex = static_cast<uint32_t>(vertices.size());
+        }
+
+        void End(Shape shape)
+        {
+            ShapeMesh& mesh = meshes[static_cast<size_t>(shape)];
+            mesh.vertexCount = static_cast<uint32_t>(vertices.size()) - mesh.startVertex;
+        }
+    };
+
+    const ShapeMeshes& GetShapeMeshes()
+    {
+        static const ShapeMeshes s_shapeMeshes;
+        return s_shapeMeshes;
+    }
+} // namespace
+
+namespace SpatialInputInstancing
+{
+    const std::vector<ShapeVertex>& GetShapeVertices()
+    {
+        return GetShapeMeshes().vertices;
+    }
+
+    ShapeMesh GetShapeMesh(Shape shape)
+    {
+        return GetShapeMeshes().meshes[static_cast<size_t>(shape)];
+    }
+
+    void InstanceBatch::Clear()
+    {
+        for (std::vector<Instance>& instances : m_shapeInstances)
+        {
+            instances.clear();
+        }
+        m_packed.clear();
+        std::fill(std::begin(m_ranges), std::end(m_ranges), InstanceRange{});
+    }
+
+    void InstanceBatch::Add(
+        Shape shape,
+        const float (&position)[3],
+        const float (&orientation)[4],
+        float length,
+        float radius,
+        const float (&color)[3])
+    {
+        m_shapeInstances[static_cast<size_t>(shape)].push_back(
+            {{position[0], position[1], position[2]},
+             length,
+             {orientation[0], orientation[1], orientation[2], orientation[3]},
+             {color[0], color[1], color[2]},
+             radius});
+    }
+
+    void InstanceBatch::Pack()
+    {
+        m_packed.clear();
+        for (size_t shape = 0; shape < static_cast<size_t>(Shape::Count); ++shape)
+        {
+            const std::vector<Instance>& instances = m_shapeInstances[shape];
+            const size_t count = std::min(instances.size(), MaxInstanceCount - m_packed.size());
+
+            m_ranges[shape] = {static_cast<Shape>(shape), static_cast<uint32_t>(m_packed.size()), static_cast<uint32_t>(count)};
+            m_packed.insert(m_packed.end(), instances.begin(), instances.begin() + count);
+        }
+    }
+
+    void AppendVisibleRanges(const InstanceRange& range, const FrustumCulling::SphereBatch& spheres, std::vector<InstanceRange>& ranges)
+    {
+        const uint32_t count = std::min(range.instanceCount, static_cast<uint32_t>(spheres.Size()));
+
+        uint32_t index = 0;
+        while (index < count)
+        {
+            if (!spheres.IsVisible(index))
+            {
+                ++index;
+                continue;
+            }
+
+            const uint32_t first = index;
+            while (index < count && spheres.IsVisible(index))
+            {
+                ++index;
+            }
+            ranges.push_back({range.shape, range.firstInstance + first, index - first});
+        }
+    }
+} // namespace SpatialInputInstancing
@@ -0,0 +1,126 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <holographic/FrustumCullingBatch.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Instanced visualization of hand joints, controller elements and pointer poses. Each kind of element is one small shape mesh
+// which is shared by all of its instances, the vertex shader (SpatialInput_VertexShader.hlsl) places it using the per-instance
+// pose and size. Does not depend on WinRT or Direct3D, so that the instance packing can be used (and benchmarked) on any
+// platform.
+namespace SpatialInputInstancing
+{
+    enum class Shape : uint32_t
+    {
+        // Pyramid along -z from the joint position, with a square cross section of the joint radius.
+        Joint,
+        // Square in the xz plane with a half size of the radius.
+        Quad,
+        // Triangle in the xy plane pointing up along y.
+        Pointer,
+
+        Count
+    };
+
+    // Per-instance data, laid out like the SpatialInputInstance structure of the vertex shader's constant buffer.
+    struct Instance
+    {
+        float position[3];
+        float length;
+        // Rotation quaternion (x, y, z, w).
+        float orientation[4];
+        // Added to the color of the shape vertices.
+        float color[3];
+        float radius;
+    };
+    static_assert(sizeof(Instance) == 48, "Instance must match the constant buffer layout");
+
+    // Vertex of a shape mesh. The vertex shader computes the position in instance space as
+    // (shape.x * radius, shape.y * radius, shape.z * min(radius, length / 2) + shape.w * length).
+    struct ShapeVertex
+    {
+        float shape[4];
+        float color[3];
+    };
+
+    // Vertices of a shape within the vertex buffer returned by GetShapeVertices.
+    struct ShapeMesh
+    {
+        uint32_t startVertex;
+        uint32_t vertexCount;
+    };
+
+    // Consecutive instances of one shape which are drawn with one instanced draw call.
+    struct InstanceRange
+    {
+        Shape shape;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // Triangle list with the meshes of all shapes.
+    const std::vector<ShapeVertex>& GetShapeVertices();
+    ShapeMesh GetShapeMesh(Shape shape);
+
+    // Collects the instances of one frame and packs them grouped by shape, which is the order of the instance constant buffer.
+    // The storage is retained between frames to avoid per frame allocations.
+    class InstanceBatch
+    {
+    public:
+        // Size of the instance constant buffer. Instances beyond are dropped by Pack.
+        static constexpr uint32_t MaxInstanceCount = 256;
+
+        void Clear();
+
+        void Add(
+            Shape shape,
+            const float (&position)[3],
+            const float (&orientation)[4],
+            float length,
+            float radius,
+            const float (&color)[3]);
+
+        // Number of instances of the shape added since Clear.
+        uint32_t GetCount(Shape shape) const
+        {
+            return static_cast<uint32_t>(m_shapeInstances[static_cast<size_t>(shape)].size());
+        }
+
+        // Copies the instances of all shapes into one array, Joint instances first.
+        void Pack();
+
+        // Packed instances, valid after Pack.
+        const std::vector<Instance>& GetInstances() const
+        {
+            return m_packed;
+        }
+
+        // Packed instances of one shape, valid after Pack.
+        InstanceRange GetRange(Shape shape) const
+        {
+            return m_ranges[static_cast<size_t>(shape)];
+        }
+
+    private:
+        std::vector<Instance> m_shapeInstances[static_cast<size_t>(Shape::Count)];
+        std::vector<Instance> m_packed;
+        InstanceRange m_ranges[static_cast<size_t>(Shape::Count)] = {};
+    };
+
+    // Appends the runs of visible instances in range to ranges. Sphere i of the batch bounds instance range.firstInstance + i
+    // and the batch must have been culled.
+    void AppendVisibleRanges(const InstanceRange& range, const FrustumCulling::SphereBatch& spheres, std::vector<InstanceRange>& ranges);
+} // namespace SpatialInputInstancing
@@ -27,6 +27,33 @@
 
 using namespace winrt::Windows::Perception::Spatial;
 
+namespace
+{
+    // Range of instances of one draw, laid out like SpatialInputDrawConstantBuffer.
+    struct DrawConstants
+    {
+        uint32_t viewCount;
+        uint32_t firstInstance;
+        uint32_t padding[2];
+    };
+
+    void StorePose(const QTransform& transform, float (&position)[3], float (&orientation)[4])
+    {
+        DirectX::XMFLOAT3 xmPosition;
+        DirectX::XMFLOAT4 xmOrientation;
+        DirectX::XMStoreFloat3(&xmPosition, transform.m_position);
+        DirectX::XMStoreFloat4(&xmOrientation, transform.m_orientation);
+
+        position[0] = xmPosition.x;
+        position[1] = xmPosition.y;
+        position[2] = xmPosition.z;
+        orientation[0] = xmOrientation.x;
+        orientation[1] = xmOrientation.y;
+        orientation[2] = xmOrientation.z;
+        orientation[3] = xmOrientation.w;
+    }
+} // namespace
+
 SpatialInputRenderer::SpatialInputRenderer(
     const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources,
     winrt::Windows::UI::Input::Spatial::SpatialInteractionManager interactionManager)
@@ -34,6 +61,67 @@ SpatialInputRenderer::SpatialInputRenderer(
     , m_interactionManager(interactionManager)
 {
     m_referenceFrame = winrt::Windows::Perception::Spatial::SpatialLocator::GetDefault().CreateAttachedFrameOfReferenceAtCurrentHeading();
+
+    // The base class constructor only creates its own resources.
+    CreateInstancingResources();
+}
+
+void SpatialInputRenderer::CreateDeviceDependentResources()
+{
+    RenderableObject::CreateDeviceDependentResources();
+    CreateInstancingResources();
+}
+
+void SpatialInputRenderer::ReleaseDeviceDependentResources()
+{
+    RenderableObject::ReleaseDeviceDependentResources();
+    m_shapeInputLayout = nullptr;
+    m_instanceVertexShader = nullptr;
+    m_shapeVertexBuffer = nullptr;
+    m_instanceConstantBuffer = nullptr;
+    m_drawConstantBuffer = nullptr;
+}
+
+void SpatialInputRenderer::CreateInstancingResources()
+{
+    using namespace SpatialInputInstancing;
+
+    // The instances are placed by the vertex shader, which has the same outputs as SimpleColor_VertexShader(Vprt).
+    std::wstring vertexShaderFileName =
+        m_deviceResources->GetDeviceSupportsVprt() ? L"SpatialInput_VertexShaderVprt.cso" : L"SpatialInput_VertexShader.cso";
+    std::vector<byte> vertexShaderFileData = DXHelper::ReadFromFile(vertexShaderFileName);
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateVertexShader(
+        vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_instanceVertexShader.put()));
+
+    constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 2> vertexDesc = {{
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    }};
+
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
+        vertexDesc.data(),
+        static_cast<UINT>(vertexDesc.size()),
+        vertexShaderFileData.data(),
+        static_cast<UINT>(vertexShaderFileData.size()),
+        m_shapeInputLayout.put()));
+
+    // The shape meshes never change.
+    const std::vector<ShapeVertex>& shapeVertices = GetShapeVertices();
+    D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
+    vertexBufferData.pSysMem = shapeVertices.data();
+    const CD3D11_BUFFER_DESC vertexBufferDesc(
+        static_cast<UINT>(shapeVertices.size() * sizeof(ShapeVertex)), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_shapeVertexBuffer.put()));
+
+    const CD3D11_BUFFER_DESC instanceBufferDesc(
+        sizeof(Instance) * InstanceBatch::MaxInstanceCount, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&instanceBufferDesc, nullptr, m_instanceConstantBuffer.put()));
+
+    const CD3D11_BUFFER_DESC drawBufferDesc(sizeof(DrawConstants), D3D11_BIND_CONSTANT_BUFFER);
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&drawBufferDesc, nullptr, m_drawConstantBuffer.put()));
+
+    // Instances of the last Update, if the resources are recreated.
+    UploadInstances();
 }
 
 void SpatialInputRenderer::Update(
@@ -272,109 +360,138 @@ void SpatialInputRenderer::Update(
         m_modelTransform = modelTransform.Value();
         UpdateModelConstantBuffer(m_modelTransform);
     }
+
+    m_jointCullingSpheres.Clear();
+    m_jointCullingSpheres.Reserve(m_joints.size());
+    for (const auto& joint : m_joints)
+    {
+        QTransform jointTransform = QTransform(joint.position, joint.orientation);
+        float3 jointCenter = joint.position + (0.5f * jointTransform.TransformPosition(float3(0.0f, 0.0f, -joint.length)));
+        float3 renderingCenter = transform(jointCenter, m_modelTransform);
+        float jointCullingRadius = std::max<float>(joint.radius, joint.length / 2.0f);
+        m_jointCullingSpheres.Add(renderingCenter.x, renderingCenter.y, renderingCenter.z, jointCullingRadius);
+    }
+
+    UpdateInstances();
 }
 
-void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
+void SpatialInputRenderer::AppendRenderingJoints(std::vector<FrameTrace::JointRecord>& joints) const
 {
-    std::vector<VertexPositionNormalColor> vertices;
-
-    for (const auto& transform : m_transforms)
+    const quaternion modelOrientation = make_quaternion_from_rotation_matrix(m_modelTransform);
+    for (const auto& joint : m_joints)
     {
-        DirectX::XMFLOAT3 trianglePositions[3] = {
-            DirectX::XMFLOAT3(0.0f, 0.03f, 0.0f), DirectX::XMFLOAT3(0.01f, 0.0f, 0.0f), DirectX::XMFLOAT3(-0.01f, 0.0f, 0.0f)};
-
-        AppendColoredTriangle(
-            transform.TransformPosition(trianglePositions[0]),
-            transform.TransformPosition(trianglePositions[1]),
-            transform.TransformPosition(trianglePositions[2]),
-            DirectX::XMFLOAT3{0, 0, 1},
-            vertices);
+        const float3 position = transform(joint.position, m_modelTransform);
+        const quaternion orientation = concatenate(joint.orientation, modelOrientation);
+        FrameTrace::JointRecord& record = joints.emplace_back();
+        record.pose = {{position.x, position.y, position.z}, {orientation.x, orientation.y, orientation.z, orientation.w}};
+        record.length = joint.length;
+        record.radius = joint.radius;
     }
+}
+
+void SpatialInputRenderer::UpdateInstances()
+{
+    using namespace SpatialInputInstancing;
+
+    // Controller elements and pointers are 2 cm wide.
+    constexpr float elementRadius = 0.01f;
+    constexpr float noColor[3] = {0.0f, 0.0f, 0.0f};
+    constexpr float pointerColor[3] = {0.0f, 0.0f, 1.0f};
+
+    m_instances.Clear();
 
     for (const auto& joint : m_joints)
     {
-        // Frustum culling
-        QTransform jointTransform = QTransform(joint.position, joint.orientation);
-        float3 jointCenter = joint.position + (0.5f * jointTransform.TransformPosition(float3(0.0f, 0.0f, -joint.length)));
-        float jointCullingRadius = std::max<float>(joint.radius, joint.length / 2.0f);
-        if (FrustumCulling::SphereInFrustum(transform(jointCenter, m_modelTransform), jointCullingRadius, cullingFrustum))
-        {
-            auto jointVertices = CalculateJointVisualizationVertices(joint.position, joint.orientation, joint.length, joint.radius);
-            vertices.insert(vertices.end(), jointVertices.begin(), jointVertices.end());
-        }
+        const float position[3] = {joint.position.x, joint.position.y, joint.position.z};
+        const float orientation[4] = {joint.orientation.x, joint.orientation.y, joint.orientation.z, joint.orientation.w};
+        m_instances.Add(Shape::Joint, position, orientation, joint.length, joint.radius, noColor);
     }
 
     for (const auto& coloredTransform : m_coloredTransforms)
     {
-        DirectX::XMFLOAT3 quadPositions[4] = {
-            DirectX::XMFLOAT3(-0.01f, 0.0f, -0.01f),
-            DirectX::XMFLOAT3(0.01f, 0.0f, -0.01f),
-            DirectX::XMFLOAT3(0.01f, 0.0f, 0.01f),
-            DirectX::XMFLOAT3(-0.01f, 0.0f, 0.01f)};
-        DirectX::XMFLOAT3 transformedPositions[4];
-
-        for (uint32_t i = 0; i < 4; ++i)
-        {
-            transformedPositions[i] = coloredTransform.m_transform.TransformPosition(quadPositions[i]);
-        }
+        float position[3];
+        float orientation[4];
+        StorePose(coloredTransform.m_transform, position, orientation);
+        const float color[3] = {coloredTransform.m_color.x, coloredTransform.m_color.y, coloredTransform.m_color.z};
+        m_instances.Add(Shape::Quad, position, orientation, 2.0f * elementRadius, elementRadius, color);
+    }
 
-        AppendColoredTriangle(
-            transformedPositions[0], transformedPositions[1], transformedPositions[2], coloredTransform.m_color, vertices);
-        AppendColoredTriangle(
-            transformedPositions[2], transformedPositions[3], transformedPositions[0], coloredTransform.m_color, vertices);
+    for (const auto& transform : m_transforms)
+    {
+        float position[3];
+        float orientation[4];
+        StorePose(transform, position, orientation);
+        m_instances.Add(Shape::Pointer, position, orientation, 2.0f * elementRadius, elementRadius, pointerColor);
     }
 
-    if (!vertices.empty())
+    m_instances.Pack();
+    UploadInstances();
+}
+
+void SpatialInputRenderer::UploadInstances()
+{
+    using namespace SpatialInputInstancing;
+
+    const std::vector<Instance>& instances = m_instances.GetInstances();
+    if (!m_instanceConstantBuffer || instances.empty())
     {
-        const UINT stride = sizeof(vertices[0]);
-        const UINT offset = 0;
-        D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-        vertexBufferData.pSysMem = vertices.data();
-        const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(vertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-        winrt::com_ptr<ID3D11Buffer> vertexBuffer;
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, vertexBuffer.put()));
-
-        m_deviceResources->UseD3DDeviceContext([&](auto context) {
-            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-            ID3D11Buffer* pBuffer = vertexBuffer.get();
-            context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
-            context->DrawInstanced(static_cast<UINT>(vertices.size()), numInstances, offset, 0);
-        });
+        return;
     }
+
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        winrt::check_hresult(context->Map(m_instanceConstantBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+        memcpy(mapped.pData, instances.data(), instances.size() * sizeof(Instance));
+        context->Unmap(m_instanceConstantBuffer.get(), 0);
+    });
 }
 
-std::vector<VertexPositionNormalColor> SpatialInputRenderer::CalculateJointVisualizationVertices(
-    float3 jointPosition, quaternion jointOrientation, float jointLength, float jointRadius)
+void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
 {
-    using namespace DirectX;
+    using namespace SpatialInputInstancing;
 
-    constexpr const size_t verticesCount = 2 * 4 * 3;
-    std::vector<VertexPositionNormalColor> vertices;
-    vertices.reserve(verticesCount);
+    if (!m_instanceVertexShader || m_instances.GetInstances().empty())
+    {
+        return;
+    }
 
-    float centerHeight = std::min<float>(jointRadius, 0.5f * jointLength);
-    float centerXandY = jointRadius / sqrtf(2.0f);
+    // Frustum culling
+    FrustumCulling::CullSpheres(m_jointCullingSpheres, cullingFrustum);
 
-    QTransform jointTransform = QTransform(jointPosition, jointOrientation);
+    // One instanced draw per run of visible joints and per shape of the controller elements and pointers.
+    m_drawRanges.clear();
+    AppendVisibleRanges(m_instances.GetRange(Shape::Joint), m_jointCullingSpheres, m_drawRanges);
+    for (Shape shape : {Shape::Quad, Shape::Pointer})
+    {
+        const InstanceRange range = m_instances.GetRange(shape);
+        if (range.instanceCount > 0)
+        {
+            m_drawRanges.push_back(range);
+        }
+    }
 
-    XMFLOAT3 baseVertexPosition = jointTransform.TransformPosition(XMFLOAT3(0.0f, 0.0f, 0.0f));
-    XMFLOAT3 centerVertexPositions[4] = {
-        jointTransform.TransformPosition(XMFLOAT3(-centerXandY, -centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(-centerXandY, +centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(+centerXandY, +centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(+centerXandY, -centerXandY, -centerHeight)),
-    };
-    XMFLOAT3 topVertexPosition = jointTransform.TransformPosition(XMFLOAT3(0.0f, 0.0f, -jointLength));
-
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[0], centerVertexPositions[1], XMFLOAT3(0.0f, 0.0f, 0.4f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[1], centerVertexPositions[2], XMFLOAT3(0.0f, 0.4f, 0.0f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[2], centerVertexPositions[3], XMFLOAT3(0.4f, 0.0f, 0.0f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[3], centerVertexPositions[0], XMFLOAT3(0.4f, 0.4f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[1], centerVertexPositions[0], XMFLOAT3(0.0f, 0.0f, 0.6f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[2], centerVertexPositions[1], XMFLOAT3(0.0f, 0.6f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[3], centerVertexPositions[2], XMFLOAT3(0.6f, 0.0f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[0], centerVertexPositions[3], XMFLOAT3(0.6f, 0.6f, 0.0f), vertices);
-
-    return vertices;
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        context->IASetInputLayout(m_shapeInputLayout.get());
+        context->VSSetShader(m_instanceVertexShader.get(), nullptr, 0);
+
+        ID3D11Buffer* constantBuffers[] = {m_instanceConstantBuffer.get(), m_drawConstantBuffer.get()};
+        context->VSSetConstantBuffers(2, 2, constantBuffers);
+
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        const UINT stride = sizeof(ShapeVertex);
+        const UINT offset = 0;
+        ID3D11Buffer* pBuffer = m_shapeVertexBuffer.get();
+        context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
+
+        for (const InstanceRange& range : m_drawRanges)
+        {
+            const DrawConstants drawConstants = {numInstances, range.firstInstance};
+            context->UpdateSubresource(m_drawConstantBuffer.get(), 0, nullptr, &drawConstants, 0, 0);
+
+            // Each instance is drawn once per view.
+            const ShapeMesh mesh = GetShapeMesh(range.shape);
+            context->DrawInstanced(mesh.vertexCount, range.instanceCount * numInstances, mesh.startVertex, 0);
+        }
+    });
 }
@@ -11,7 +11,10 @@
 
 #pragma once
 
+#include <FrameTrace.h>
+#include <holographic/FrustumCullingBatch.h>
 #include <holographic/RenderableObject.h>
+#include <holographic/SpatialInputInstancing.h>
 
 #include <vector>
 
@@ -79,6 +82,13 @@ public:
         winrt::Windows::Perception::PerceptionTimestamp timestamp,
         winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
+    void CreateDeviceDependentResources() override;
+    void ReleaseDeviceDependentResources() override;
+
+    // Appends the hand joints and pointer poses of the last Update in the rendering coordinate system, e.g. to record them in a
+    // frame trace.
+    void AppendRenderingJoints(std::vector<FrameTrace::JointRecord>& joints) const;
+
 private:
     struct Joint
     {
@@ -105,8 +115,11 @@ private:
     };
 
 private:
-    static std::vector<VertexPositionNormalColor> CalculateJointVisualizationVertices(
-        float3 jointPosition, quaternion jointOrientation, float jointLength, float jointRadius);
+    void CreateInstancingResources();
+
+    // Packs the instances of all elements and uploads them to the instance constant buffer.
+    void UpdateInstances();
+    void UploadInstances();
 
     void Draw(
         unsigned int numInstances,
@@ -116,7 +129,21 @@ private:
     winrt::Windows::Perception::Spatial::SpatialLocatorAttachedFrameOfReference m_referenceFrame{nullptr};
     std::vector<QTransform> m_transforms;
     std::vector<Joint> m_joints;
+    // Bounding spheres of m_joints in rendering space, culled once per Draw.
+    FrustumCulling::SphereBatch m_jointCullingSpheres;
     std::vector<ColoredTransform> m_coloredTransforms;
 
+    // Instances of the joints, controller elements and pointers, built once per Update.
+    SpatialInputInstancing::InstanceBatch m_instances;
+    // Instance ranges drawn by Draw, kept to reuse their memory.
+    std::vector<SpatialInputInstancing::InstanceRange> m_drawRanges;
+
+    // Direct3D resources for instanced drawing. The shaders following the vertex shader are the ones of RenderableObject.
+    winrt::com_ptr<ID3D11InputLayout> m_shapeInputLayout;
+    winrt::com_ptr<ID3D11VertexShader> m_instanceVertexShader;
+    winrt::com_ptr<ID3D11Buffer> m_shapeVertexBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_instanceConstantBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_drawConstantBuffer;
+
     winrt::Windows::Foundation::Numerics::float4x4 m_modelTransform;
 };
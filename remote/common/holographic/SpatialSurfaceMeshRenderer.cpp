@@ -13,7 +13,11 @@
 
 #include <holographic/SpatialSurfaceMeshRenderer.h>
 
+#include <DbgLog.h>
 #include <DirectXHelper.h>
+#include <FrameProfiler.h>
+#include <holographic/FrustumCulling.h>
+#include <holographic/MeshSimplifier.h>
 
 using namespace winrt::Windows;
 using namespace winrt::Windows::Perception::Spatial;
@@ -25,10 +29,113 @@ using namespace Concurrency;
 bool g_freeze = false;
 bool g_freezeOnFrame = false;
 
+namespace
+{
+    // Surface updates arrive in bursts (after relocalization dozens of parts change at once), two workers keep up with them
+    // without competing with the render and remoting threads.
+    constexpr uint32_t s_meshIngestionThreadCount = 2;
+    constexpr size_t s_stagingQueueCapacity = 64;
+
+    // Levels of detail of the mesh parts: share of the triangles of the full mesh, maximal distance of the simplified surface to
+    // the full mesh in meters, and the distance to the camera from which on the level is rendered.
+    struct LevelOfDetailSettings
+    {
+        float triangleRatio;
+        float maxError;
+        float minDistance;
+    };
+
+    constexpr LevelOfDetailSettings s_levelOfDetailSettings[] = {{1.0f, 0.0f, 0.0f}, {0.4f, 0.01f, 2.0f}, {0.15f, 0.03f, 5.0f}};
+
+    // Returns the distance of the point to the box, 0 if it is inside.
+    float DistanceToBoundingBox(const float3& point, const FrustumCulling::BoundingBox& box)
+    {
+        const float3 delta = {
+            std::max({box.min[0] - point.x, 0.0f, point.x - box.max[0]}),
+            std::max({box.min[1] - point.y, 0.0f, point.y - box.max[1]}),
+            std::max({box.min[2] - point.z, 0.0f, point.z - box.max[2]})};
+        return length(delta);
+    }
+
+    // Appends the simplified levels of detail to the index data of the block, which starts with the indexCount indices of the full
+    // mesh. Each level is simplified from the previous one, which keeps the cost of the farther levels low. The index data has to
+    // have capacity for LevelOfDetailCount times the full mesh, so that the previous level stays in place while the next one is
+    // appended.
+    void SimplifyLevelsOfDetail(SpatialSurfaceMeshStagingBlock& block, uint32_t indexCount)
+    {
+        // every worker simplifies with its own scratch memory
+        thread_local MeshSimplification::Simplifier simplifier;
+        thread_local std::vector<uint16_t> levelIndices;
+
+        MeshSimplification::MeshView meshView;
+        meshView.positions = block.vertexData[0].pos;
+        meshView.positionStride = sizeof(SpatialSurfaceMeshPart::Vertex_t) / sizeof(int16_t);
+        meshView.vertexCount = static_cast<uint32_t>(block.vertexData.size());
+        meshView.indices = block.indexData.data();
+        meshView.indexCount = indexCount;
+        meshView.scale[0] = block.vertexScale.x;
+        meshView.scale[1] = block.vertexScale.y;
+        meshView.scale[2] = block.vertexScale.z;
+
+        block.levelsOfDetail[0] = {0, indexCount};
+        for (uint32_t level = 1; level < SpatialSurfaceMeshPart::LevelOfDetailCount; level++)
+        {
+            const LevelOfDetailSettings& settings = s_levelOfDetailSettings[level];
+            const uint32_t targetIndexCount = static_cast<uint32_t>(indexCount * settings.triangleRatio);
+            const uint32_t levelIndexCount = simplifier.Simplify(meshView, targetIndexCount, settings.maxError, levelIndices);
+
+            // levels which could not be simplified further within their error bound reuse the previous level
+            if (levelIndexCount == 0 || levelIndexCount >= meshView.indexCount)
+            {
+                block.levelsOfDetail[level] = block.levelsOfDetail[level - 1];
+                continue;
+            }
+
+            const uint32_t start = static_cast<uint32_t>(block.indexData.size());
+            assert(start + levelIndexCount <= block.indexData.capacity());
+            block.indexData.insert(block.indexData.end(), levelIndices.begin(), levelIndices.begin() + levelIndexCount);
+            block.levelsOfDetail[level] = {start, levelIndexCount};
+
+            meshView.indices = block.indexData.data() + start;
+            meshView.indexCount = levelIndexCount;
+        }
+    }
+
+    // Transforms the box and returns the axis aligned box enclosing the result.
+    FrustumCulling::BoundingBox TransformBoundingBox(const FrustumCulling::BoundingBox& box, const float4x4& matrix)
+    {
+        const float3 center = {
+            0.5f * (box.max[0] + box.min[0]), 0.5f * (box.max[1] + box.min[1]), 0.5f * (box.max[2] + box.min[2])};
+        const float3 extent = {
+            0.5f * (box.max[0] - box.min[0]), 0.5f * (box.max[1] - box.min[1]), 0.5f * (box.max[2] - box.min[2])};
+
+        const float3 transformedCenter = transform(center, matrix);
+        const float3 transformedExtent = {
+            std::abs(matrix.m11) * extent.x + std::abs(matrix.m21) * extent.y + std::abs(matrix.m31) * extent.z,
+            std::abs(matrix.m12) * extent.x + std::abs(matrix.m22) * extent.y + std::abs(matrix.m32) * extent.z,
+            std::abs(matrix.m13) * extent.x + std::abs(matrix.m23) * extent.y + std::abs(matrix.m33) * extent.z};
+
+        FrustumCulling::BoundingBox result;
+        result.min[0] = transformedCenter.x - transformedExtent.x;
+        result.min[1] = transformedCenter.y - transformedExtent.y;
+        result.min[2] = transformedCenter.z - transformedExtent.z;
+        result.max[0] = transformedCenter.x + transformedExtent.x;
+        result.max[1] = transformedCenter.y + transformedExtent.y;
+        result.max[2] = transformedCenter.z + transformedExtent.z;
+        return result;
+    }
+} // namespace
+
 // Initializes D2D resources used for text rendering.
 SpatialSurfaceMeshRenderer::SpatialSurfaceMeshRenderer(const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources)
     : m_deviceResources(deviceResources)
+    , m_meshIngestionPool(s_meshIngestionThreadCount)
 {
+    for (uint32_t i = 0; i < m_meshIngestionPool.GetThreadCount(); ++i)
+    {
+        m_stagingQueues.push_back(std::make_unique<StagingQueue>(s_stagingQueueCapacity));
+    }
+
     CreateDeviceDependentResources();
 
     m_spatialLocator = SpatialLocator::GetDefault();
@@ -121,7 +228,8 @@ void SpatialSurfaceMeshRenderer::OnLocatibilityChanged(
     SpatialLocatability locatibility = spatialLocator.Locatability();
     if (locatibility != SpatialLocatability::PositionalTrackingActive)
     {
-        m_meshParts.clear();
+        // runs on the thread of the event, the parts are dropped by the render thread in Update
+        m_resetRequested.store(true, std::memory_order_relaxed);
     }
 }
 
@@ -131,7 +239,7 @@ SpatialSurfaceMeshPart* SpatialSurfaceMeshRenderer::GetOrCreateMeshPart(winrt::g
     auto found = m_meshParts.find(key);
     if (found == m_meshParts.cend())
     {
-        m_meshParts[id] = std::make_unique<SpatialSurfaceMeshPart>(this);
+        m_meshParts[id] = std::make_unique<SpatialSurfaceMeshPart>(this, key);
         return m_meshParts[id].get();
     }
 
@@ -142,9 +250,19 @@ void SpatialSurfaceMeshRenderer::Update(
     winrt::Windows::Perception::PerceptionTimestamp timestamp,
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
 {
+    if (m_resetRequested.exchange(false, std::memory_order_relaxed))
+    {
+        m_cullingParts.clear();
+        m_cullingHierarchy.Clear();
+        m_cullingHierarchyDirty = true;
+        m_meshParts.clear();
+    }
+
     if (m_surfaceObserver == nullptr)
         return;
 
+    ApplyStagingBlocks();
+
     // update bounding volume (every frame)
     {
         SpatialBoundingBox axisAlignedBoundingBox = {
@@ -189,7 +307,15 @@ void SpatialSurfaceMeshRenderer::Update(
         // purge the ones not used
         for (MeshPartMap::const_iterator itr = m_meshParts.cbegin(); itr != m_meshParts.cend();)
         {
-            itr = itr->second->IsInUse() ? std::next(itr) : m_meshParts.erase(itr);
+            if (itr->second->IsInUse())
+            {
+                itr = std::next(itr);
+            }
+            else
+            {
+                itr = m_meshParts.erase(itr);
+                m_cullingHierarchyDirty = true;
+            }
         }
 
         m_sufaceChanged = false;
@@ -200,11 +326,169 @@ void SpatialSurfaceMeshRenderer::Update(
     {
         pair.second->UpdateModelMatrix(renderingCoordinateSystem);
     }
+
+    // choose the level of detail by the distance of the parts to the camera, which is at the origin of the attached frame
+    if (m_attachedFrameOfReference)
+    {
+        SpatialCoordinateSystem attachedCoordinateSystem = m_attachedFrameOfReference.GetStationaryCoordinateSystemAtTimestamp(timestamp);
+        if (auto cameraTransform = attachedCoordinateSystem.TryGetTransformTo(renderingCoordinateSystem))
+        {
+            const float3 cameraPosition = transform(float3::zero(), cameraTransform.Value());
+            for (auto& pair : m_meshParts)
+            {
+                pair.second->UpdateLevelOfDetail(cameraPosition);
+            }
+        }
+    }
+
+    UpdateCullingHierarchy();
+}
+
+void SpatialSurfaceMeshRenderer::IngestMesh(const GUID& id, uint64_t updateSequence, Surfaces::SpatialSurfaceMesh mesh)
+{
+    m_meshIngestionPool.Submit([this, id, updateSequence, mesh]() {
+        auto block = std::make_unique<SpatialSurfaceMeshStagingBlock>();
+        block->id = id;
+        block->updateSequence = updateSequence;
+        if (mesh)
+        {
+            FRAME_PROFILER_SCOPE("ConvertSurfaceMesh");
+            if (!SpatialSurfaceMeshPart::ConvertMesh(mesh, *block))
+            {
+                m_rejectedMeshCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Once a block went to the overflow list, the following ones go there as well until the render thread drained it, which
+        // keeps the blocks of a worker in order.
+        StagingQueue& queue = *m_stagingQueues[m_meshIngestionPool.GetCurrentWorkerIndex()];
+        if (m_stagingOverflowPending.load(std::memory_order_acquire) || !queue.TryPush(std::move(block)))
+        {
+            std::lock_guard lock(m_stagingOverflowMutex);
+            m_stagingOverflow.push_back(std::move(block));
+            m_stagingOverflowPending.store(true, std::memory_order_release);
+            m_stagingOverflowCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+}
+
+void SpatialSurfaceMeshRenderer::ApplyStagingBlock(SpatialSurfaceMeshStagingBlock& block)
+{
+    // the part may have been removed while its mesh was converted
+    auto found = m_meshParts.find(block.id);
+    if (found != m_meshParts.end())
+    {
+        found->second->ApplyMesh(block);
+    }
+}
+
+void SpatialSurfaceMeshRenderer::ApplyStagingBlocks()
+{
+    FRAME_PROFILER_SCOPE("ApplySurfaceMeshes");
+
+    std::unique_ptr<SpatialSurfaceMeshStagingBlock> block;
+    for (auto& queue : m_stagingQueues)
+    {
+        while (queue->TryPop(block))
+        {
+            ApplyStagingBlock(*block);
+            block = nullptr;
+        }
+    }
+
+    // the overflow list only holds blocks newer than the ones in the queues, so it is applied after them
+    if (m_stagingOverflowPending.load(std::memory_order_acquire))
+    {
+        std::vector<std::unique_ptr<SpatialSurfaceMeshStagingBlock>> overflow;
+        {
+            std::lock_guard lock(m_stagingOverflowMutex);
+            overflow.swap(m_stagingOverflow);
+            m_stagingOverflowPending.store(false, std::memory_order_relaxed);
+        }
+        for (auto& overflowBlock : overflow)
+        {
+            ApplyStagingBlock(*overflowBlock);
+        }
+
+        DebugLog(
+            "Surface mesh staging queues overflowed, %u blocks so far", m_stagingOverflowCount.load(std::memory_order_relaxed));
+    }
+
+    const uint32_t rejectedMeshCount = m_rejectedMeshCount.load(std::memory_order_relaxed);
+    if (rejectedMeshCount != m_reportedRejectedMeshCount)
+    {
+        DebugLog(
+            "Rejected %u surface meshes in an unexpected format or with out of range indices",
+            rejectedMeshCount - m_reportedRejectedMeshCount);
+        m_reportedRejectedMeshCount = rejectedMeshCount;
+    }
+}
+
+void SpatialSurfaceMeshRenderer::UpdateCullingHierarchy()
+{
+    // parts which received their first mesh or were located or lost require a rebuild, moved or changed parts are refit
+    for (auto& pair : m_meshParts)
+    {
+        const SpatialSurfaceMeshPart* part = pair.second.get();
+        if (part->HasRenderingBounds() != (part->m_cullingLeaf != FrustumCulling::BoundingVolumeHierarchy::InvalidIndex))
+        {
+            m_cullingHierarchyDirty = true;
+            break;
+        }
+    }
+
+    if (m_cullingHierarchyDirty)
+    {
+        m_cullingParts.clear();
+        m_cullingBoxes.clear();
+        for (auto& pair : m_meshParts)
+        {
+            SpatialSurfaceMeshPart* part = pair.second.get();
+            part->m_cullingLeaf = FrustumCulling::BoundingVolumeHierarchy::InvalidIndex;
+            if (part->HasRenderingBounds())
+            {
+                part->m_cullingLeaf = static_cast<uint32_t>(m_cullingParts.size());
+                m_cullingParts.push_back(part);
+                m_cullingBoxes.push_back(part->m_renderingBounds);
+            }
+        }
+
+        m_cullingHierarchy.Build(m_cullingBoxes.data(), static_cast<uint32_t>(m_cullingBoxes.size()));
+        m_cullingHierarchyDirty = false;
+        return;
+    }
+
+    for (uint32_t leaf = 0; leaf < m_cullingHierarchy.GetLeafCount(); ++leaf)
+    {
+        const SpatialSurfaceMeshPart* part = m_cullingParts[leaf];
+        if (part->m_renderingBounds != m_cullingHierarchy.GetLeafBox(leaf))
+        {
+            m_cullingHierarchy.Refit(leaf, part->m_renderingBounds);
+        }
+    }
 }
 
-void SpatialSurfaceMeshRenderer::Render(bool isStereo)
+void SpatialSurfaceMeshRenderer::Render(
+    bool isStereo, winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum)
 {
-    if (!m_loadingComplete || m_meshParts.empty())
+    if (!m_loadingComplete || m_cullingParts.empty())
+        return;
+
+    m_visibleParts.clear();
+    FrustumCulling::FrustumPlanes planes;
+    if (FrustumCulling::TryGetFrustumPlanes(cullingFrustum, planes))
+    {
+        m_cullingHierarchy.Query(planes, m_visibleParts);
+    }
+    else
+    {
+        for (uint32_t leaf = 0; leaf < m_cullingHierarchy.GetLeafCount(); ++leaf)
+        {
+            m_visibleParts.push_back(leaf);
+        }
+    }
+
+    if (m_visibleParts.empty())
         return;
 
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
@@ -231,13 +515,15 @@ void SpatialSurfaceMeshRenderer::Render(bool isStereo)
         pBufferToSet = m_modelConstantBuffer.get();
         context->PSSetConstantBuffers(0, 1, &pBufferToSet);
 
-        // render each mesh part
-        for (auto& pair : m_meshParts)
+        // render each visible mesh part
+        for (uint32_t leaf : m_visibleParts)
         {
-            SpatialSurfaceMeshPart* part = pair.second.get();
+            SpatialSurfaceMeshPart* part = m_cullingParts[leaf];
             if (part->m_indexCount == 0)
                 continue;
 
+            const SpatialSurfaceMeshPart::IndexRange& levelOfDetail = part->m_levelsOfDetail[part->m_levelOfDetail];
+
             if (part->m_needsUpload)
             {
                 part->UploadData();
@@ -250,7 +536,7 @@ void SpatialSurfaceMeshRenderer::Render(bool isStereo)
             context->IASetVertexBuffers(0, 1, &pBufferToSet2, &stride, &offset);
             context->IASetIndexBuffer(part->m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
             // draw the mesh
-            context->DrawIndexedInstanced(part->m_indexCount, isStereo ? 2 : 1, 0, 0, 0);
+            context->DrawIndexedInstanced(levelOfDetail.count, isStereo ? 2 : 1, levelOfDetail.start, 0, 0);
         }
 
         // set geometry shader back
@@ -262,9 +548,13 @@ void SpatialSurfaceMeshRenderer::Render(bool isStereo)
 // SRMeshPart
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-SpatialSurfaceMeshPart::SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner)
+SpatialSurfaceMeshPart::SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner, const GUID& id)
     : m_owner(owner)
+    , m_ID(id)
 {
+    // a part recreated with the id of a dropped one must not apply the blocks still converted for the dropped one
+    m_appliedUpdateSequence = owner->m_meshUpdateSequence;
+
     auto identity = DirectX::XMMatrixIdentity();
     m_constantBufferData.modelMatrix = reinterpret_cast<DirectX::XMFLOAT4X4&>(identity);
     m_vertexScale.x = m_vertexScale.y = m_vertexScale.z = 1.0f;
@@ -274,34 +564,66 @@ void SpatialSurfaceMeshPart::Update(Surfaces::SpatialSurfaceInfo surfaceInfo)
 {
     m_inUse = true;
     m_updateInProgress = true;
+    const uint64_t updateSequence = ++m_owner->m_meshUpdateSequence;
+    m_updateSequence = updateSequence;
     double TriangleDensity = 750.0; // from Hydrogen
     auto asyncOpertation = surfaceInfo.TryComputeLatestMeshAsync(TriangleDensity);
-    asyncOpertation.Completed([this](winrt::Windows::Foundation::IAsyncOperation<Surfaces::SpatialSurfaceMesh> result, auto asyncStatus) {
-        Surfaces::SpatialSurfaceMesh mesh = result.GetResults();
-        UpdateMesh(mesh);
-        m_updateInProgress = false;
+    // The part is only accessed by the render thread, the mesh is converted by the mesh ingestion pool and handed back to the
+    // render thread, which applies it in SpatialSurfaceMeshRenderer::Update.
+    // A surface can change again before its previous mesh arrived. The meshes are converted by different workers and can be
+    // applied in any order, the sequence number tells ApplyMesh which one is the latest.
+    asyncOpertation.Completed([owner = m_owner, id = m_ID, updateSequence](
+                                  winrt::Windows::Foundation::IAsyncOperation<Surfaces::SpatialSurfaceMesh> result, auto asyncStatus) {
+        Surfaces::SpatialSurfaceMesh mesh = nullptr;
+        if (asyncStatus == winrt::Windows::Foundation::AsyncStatus::Completed)
+        {
+            mesh = result.GetResults();
+        }
+        owner->IngestMesh(id, updateSequence, mesh);
     });
 }
 
 void SpatialSurfaceMeshPart::UpdateModelMatrix(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
 {
+    m_located = false;
     if (m_coordinateSystem == nullptr)
         return;
 
     auto modelTransform = m_coordinateSystem.TryGetTransformTo(renderingCoordinateSystem);
     if (modelTransform)
     {
+        m_located = true;
         float4x4 matrixWinRt = transpose(modelTransform.Value());
         DirectX::XMMATRIX transformMatrix = DirectX::XMLoadFloat4x4(&matrixWinRt);
         DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(m_vertexScale.x, m_vertexScale.y, m_vertexScale.z);
         DirectX::XMMATRIX result = DirectX::XMMatrixMultiply(transformMatrix, scaleMatrix);
         DirectX::XMStoreFloat4x4(&m_constantBufferData.modelMatrix, result);
+
+        if (m_hasBounds)
+        {
+            m_renderingBounds = TransformBoundingBox(m_localBounds, modelTransform.Value());
+        }
+    }
+}
+
+void SpatialSurfaceMeshPart::UpdateLevelOfDetail(const float3& cameraPosition)
+{
+    if (!HasRenderingBounds())
+        return;
+
+    const float distance = DistanceToBoundingBox(cameraPosition, m_renderingBounds);
+
+    m_levelOfDetail = 0;
+    while (m_levelOfDetail + 1 < LevelOfDetailCount && distance >= s_levelOfDetailSettings[m_levelOfDetail + 1].minDistance)
+    {
+        m_levelOfDetail++;
     }
 }
 
-void SpatialSurfaceMeshPart::UpdateMesh(Surfaces::SpatialSurfaceMesh mesh)
+bool SpatialSurfaceMeshPart::ConvertMesh(Surfaces::SpatialSurfaceMesh mesh, SpatialSurfaceMeshStagingBlock& block)
 {
-    m_coordinateSystem = mesh.CoordinateSystem();
+    block.hasMesh = true;
+    block.coordinateSystem = mesh.CoordinateSystem();
 
     Surfaces::SpatialSurfaceMeshBuffer vertexBuffer = mesh.VertexPositions();
     Surfaces::SpatialSurfaceMeshBuffer indexBuffer = mesh.TriangleIndices();
@@ -309,75 +631,123 @@ void SpatialSurfaceMeshPart::UpdateMesh(Surfaces::SpatialSurfaceMesh mesh)
     DirectXPixelFormat vertexFormat = vertexBuffer.Format();
     DirectXPixelFormat indexFormat = indexBuffer.Format();
 
-    assert(vertexFormat == DirectXPixelFormat::R16G16B16A16IntNormalized);
-    assert(indexFormat == DirectXPixelFormat::R16UInt);
-
     uint32_t vertexCount = vertexBuffer.ElementCount();
     uint32_t indexCount = indexBuffer.ElementCount();
-    assert((indexCount % 3) == 0);
 
+    winrt::Windows::Storage::Streams::IBuffer vertexData = vertexBuffer.Data();
+    winrt::Windows::Storage::Streams::IBuffer indexData = indexBuffer.Data();
+
+    // empty meshes and meshes in an unexpected format are treated as empty, the latter are reported as rejected
     if (vertexCount == 0 || indexCount == 0)
     {
-        m_indexCount = 0;
-        return;
+        return true;
+    }
+    if ((indexCount % 3) != 0 || vertexCount > UINT16_MAX + 1 || vertexFormat != DirectXPixelFormat::R16G16B16A16IntNormalized ||
+        indexFormat != DirectXPixelFormat::R16UInt || vertexData.Length() / vertexCount != sizeof(Vertex_t) ||
+        indexData.Length() < indexCount * sizeof(uint16_t))
+    {
+        return false;
     }
 
-    // convert vertices:
+    // validate indices: a single pass over the source, which the compiler can vectorize
+    const uint16_t* sourceIndices = reinterpret_cast<const uint16_t*>(indexData.data());
+    uint16_t maxIndex = 0;
+    for (uint32_t i = 0; i < indexCount; i++)
     {
-        Vertex_t* dest = MapVertices(vertexCount);
-        winrt::Windows::Storage::Streams::IBuffer vertexData = vertexBuffer.Data();
-        uint8_t* vertexRaw = vertexData.data();
-        int vertexStride = vertexData.Length() / vertexCount;
-        assert(vertexStride == 8); // DirectXPixelFormat::R16G16B16A16IntNormalized
-        winrt::Windows::Foundation::Numerics::float3 positionScale = mesh.VertexPositionScale();
-        m_vertexScale.x = positionScale.x;
-        m_vertexScale.y = positionScale.y;
-        m_vertexScale.z = positionScale.z;
-        memcpy(dest, vertexRaw, vertexCount * sizeof(Vertex_t));
-        UnmapVertices();
+        maxIndex = std::max(maxIndex, sourceIndices[i]);
+    }
+    if (maxIndex >= vertexCount)
+    {
+        // a corrupt mesh is rejected, the part keeps its current mesh
+        block.hasMesh = false;
+        return false;
     }
 
-    // convert indices
+    // convert vertices:
     {
-        uint16_t* dest = MapIndices(indexCount);
-        winrt::Windows::Storage::Streams::IBuffer indexData = indexBuffer.Data();
-        uint16_t* source = (uint16_t*)indexData.data();
-        for (uint32_t i = 0; i < indexCount; i++)
+        winrt::Windows::Foundation::Numerics::float3 positionScale = mesh.VertexPositionScale();
+        block.vertexScale.x = positionScale.x;
+        block.vertexScale.y = positionScale.y;
+        block.vertexScale.z = positionScale.z;
+
+        block.vertexData.resize(vertexCount);
+        memcpy(block.vertexData.data(), vertexData.data(), vertexCount * sizeof(Vertex_t));
+
+        // bounds for culling, the positions are normalized and scaled by vertexScale in the vertex shader
+        int16_t minPosition[3] = {INT16_MAX, INT16_MAX, INT16_MAX};
+        int16_t maxPosition[3] = {INT16_MIN, INT16_MIN, INT16_MIN};
+        for (const Vertex_t& vertex : block.vertexData)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                minPosition[axis] = std::min(minPosition[axis], vertex.pos[axis]);
+                maxPosition[axis] = std::max(maxPosition[axis], vertex.pos[axis]);
+            }
+        }
+
+        const float scale[3] = {block.vertexScale.x, block.vertexScale.y, block.vertexScale.z};
+        for (int axis = 0; axis < 3; axis++)
         {
-            assert(source[i] < vertexCount);
-            dest[i] = source[i];
+            const float a = std::max(minPosition[axis] / 32767.0f, -1.0f) * scale[axis];
+            const float b = std::max(maxPosition[axis] / 32767.0f, -1.0f) * scale[axis];
+            block.localBounds.min[axis] = std::min(a, b);
+            block.localBounds.max[axis] = std::max(a, b);
         }
-        UnmapIndices();
     }
-    m_needsUpload = true;
-}
 
-SpatialSurfaceMeshPart::Vertex_t* SpatialSurfaceMeshPart::MapVertices(uint32_t vertexCount)
-{
-    m_vertexCount = vertexCount;
-    if (vertexCount > m_vertexData.size())
-        m_vertexData.resize(vertexCount);
-    return &m_vertexData[0];
+    // copy indices, followed by the simplified levels of detail
+    {
+        block.indexData.reserve(size_t(indexCount) * LevelOfDetailCount);
+        block.indexData.assign(sourceIndices, sourceIndices + indexCount);
+        SimplifyLevelsOfDetail(block, indexCount);
+    }
+    return true;
 }
 
-void SpatialSurfaceMeshPart::UnmapVertices()
+void SpatialSurfaceMeshPart::ApplyMesh(SpatialSurfaceMeshStagingBlock& block)
 {
-}
+    // drop blocks of updates older than the applied one, they arrived late through the queue of another worker
+    if (block.updateSequence <= m_appliedUpdateSequence)
+        return;
 
-uint16_t* SpatialSurfaceMeshPart::MapIndices(uint32_t indexCount)
-{
-    m_indexCount = indexCount;
-    if (indexCount > m_indexData.size())
-        m_indexData.resize(indexCount);
-    return &m_indexData[0];
-}
+    m_appliedUpdateSequence = block.updateSequence;
+    if (block.updateSequence == m_updateSequence)
+    {
+        m_updateInProgress = false;
+    }
+    if (!block.hasMesh)
+        return;
 
-void SpatialSurfaceMeshPart::UnmapIndices()
-{
+    m_coordinateSystem = block.coordinateSystem;
+    m_vertexScale = block.vertexScale;
+
+    // swapping hands the previous buffers to the block, which releases them on the render thread
+    m_vertexData.swap(block.vertexData);
+    m_indexData.swap(block.indexData);
+    m_vertexCount = static_cast<uint32_t>(m_vertexData.size());
+    m_indexCount = static_cast<uint32_t>(m_indexData.size());
+    std::copy(std::begin(block.levelsOfDetail), std::end(block.levelsOfDetail), std::begin(m_levelsOfDetail));
+
+    // an empty mesh leaves the part without bounds, which takes it out of the culling hierarchy
+    if (m_indexCount == 0)
+    {
+        if (m_hasBounds)
+        {
+            m_hasBounds = false;
+            m_owner->m_cullingHierarchyDirty = true;
+        }
+        return;
+    }
+
+    m_localBounds = block.localBounds;
+    m_hasBounds = true;
+    m_needsUpload = true;
 }
 
 void SpatialSurfaceMeshPart::UploadData()
 {
+    FRAME_PROFILER_SCOPE("UploadSurfaceMesh");
+
     if (m_vertexCount > m_allocatedVertexCount)
     {
         m_vertexBuffer = nullptr;
@@ -405,16 +775,17 @@ void SpatialSurfaceMeshPart::UploadData()
         winrt::check_hresult(m_owner->m_deviceResources->GetD3DDevice()->CreateBuffer(&indexBufferDesc, nullptr, m_indexBuffer.put()));
     }
 
-    // upload data
+    // upload data, once per mesh: the buffers keep it until the next mesh is applied
     D3D11_MAPPED_SUBRESOURCE resource;
 
     m_owner->m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        context->Map(m_vertexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
+        winrt::check_hresult(context->Map(m_vertexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
         memcpy(resource.pData, &m_vertexData[0], sizeof(Vertex_t) * m_vertexCount);
         context->Unmap(m_vertexBuffer.get(), 0);
 
-        context->Map(m_indexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
+        winrt::check_hresult(context->Map(m_indexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
         memcpy(resource.pData, &m_indexData[0], sizeof(uint16_t) * m_indexCount);
         context->Unmap(m_indexBuffer.get(), 0);
     });
+    m_needsUpload = false;
 }
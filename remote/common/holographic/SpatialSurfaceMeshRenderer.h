@@ -12,15 +12,22 @@
 #pragma once
 
 #include <DeviceResourcesD3D11.h>
+#include <JobPool.h>
+#include <SpscQueue.h>
 #include <Utils.h>
 
+#include <holographic/BoundingVolumeHierarchy.h>
+
 #include <winrt/windows.perception.spatial.surfaces.h>
 
+#include <atomic>
 #include <future>
+#include <mutex>
 #include <string>
 
 // forward
 class SpatialSurfaceMeshRenderer;
+struct SpatialSurfaceMeshStagingBlock;
 
 struct SRMeshConstantBuffer
 {
@@ -41,10 +48,26 @@ public:
         // float pos[4];
         int16_t pos[4];
     };
-    SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner);
+
+    // levels of detail: all levels share the vertices and are stored one after another in the index data, level 0 is the full
+    // mesh. The level is chosen every frame by the distance to the camera.
+    static constexpr uint32_t LevelOfDetailCount = 3;
+    struct IndexRange
+    {
+        uint32_t start = 0;
+        uint32_t count = 0;
+    };
+
+    SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner, const GUID& id);
     void Update(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo surfaceInfo);
 
-    void UpdateMesh(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh mesh);
+    // Converts a mesh delivered by the surface observer into a staging block. Runs on a worker of the mesh ingestion job pool.
+    // Returns false if the mesh was rejected: a mesh in an unexpected format is treated as empty, a mesh with out of range indices
+    // leaves the block without a mesh, so that the part keeps its current one.
+    static bool ConvertMesh(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh mesh, SpatialSurfaceMeshStagingBlock& block);
+
+    // Takes over the mesh of a staging block, unless the part already applied a block of a later update. Runs on the render thread.
+    void ApplyMesh(SpatialSurfaceMeshStagingBlock& block);
 
     bool IsInUse() const
     {
@@ -52,18 +75,26 @@ public:
     }
 
 private:
-    Vertex_t* MapVertices(uint32_t vertexCount);
-    void UnmapVertices();
-    uint16_t* MapIndices(uint32_t indexCount);
-    void UnmapIndices();
     void UploadData();
     void UpdateModelMatrix(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
+    void UpdateLevelOfDetail(const winrt::Windows::Foundation::Numerics::float3& cameraPosition);
+
+    // true if m_renderingBounds is valid: the part has a mesh and was located in the rendering coordinate system this frame
+    bool HasRenderingBounds() const
+    {
+        return m_hasBounds && m_located;
+    }
 
     friend class SpatialSurfaceMeshRenderer;
     SpatialSurfaceMeshRenderer* m_owner;
     bool m_inUse = true;
+    // set when a mesh was applied, cleared once the part uploaded it to its buffers
     bool m_needsUpload = false;
     bool m_updateInProgress = false;
+    // sequence number of the last Update, and of the update whose block was applied last. Both are taken from
+    // SpatialSurfaceMeshRenderer::m_meshUpdateSequence.
+    uint64_t m_updateSequence = 0;
+    uint64_t m_appliedUpdateSequence = 0;
 
     GUID m_ID;
     uint32_t m_allocatedVertexCount = 0;
@@ -80,6 +111,35 @@ private:
     std::vector<uint16_t> m_indexData;
     SRMeshConstantBuffer m_constantBufferData;
     DirectX::XMFLOAT3 m_vertexScale;
+
+    // culling: bounds of the mesh in mesh space (scaled by m_vertexScale) and in rendering space
+    bool m_hasBounds = false;
+    // false while the coordinate system of the mesh cannot be located, the part is then neither culled nor rendered
+    bool m_located = false;
+    FrustumCulling::BoundingBox m_localBounds;
+    FrustumCulling::BoundingBox m_renderingBounds;
+    uint32_t m_cullingLeaf = FrustumCulling::BoundingVolumeHierarchy::InvalidIndex;
+
+    IndexRange m_levelsOfDetail[LevelOfDetailCount];
+    uint32_t m_levelOfDetail = 0;
+};
+
+// Mesh of a part converted, validated and simplified by a worker, ready to be uploaded by the render thread.
+struct SpatialSurfaceMeshStagingBlock
+{
+    GUID id;
+    // the SpatialSurfaceMeshPart::Update which requested the mesh
+    uint64_t updateSequence = 0;
+    // false if computing the mesh failed, the part then keeps its current mesh
+    bool hasMesh = false;
+
+    winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem = nullptr;
+    DirectX::XMFLOAT3 vertexScale = {1.0f, 1.0f, 1.0f};
+    std::vector<SpatialSurfaceMeshPart::Vertex_t> vertexData;
+    // the full mesh followed by the simplified levels of detail
+    std::vector<uint16_t> indexData;
+    SpatialSurfaceMeshPart::IndexRange levelsOfDetail[SpatialSurfaceMeshPart::LevelOfDetailCount];
+    FrustumCulling::BoundingBox localBounds;
 };
 
 // Renders the SR mesh
@@ -93,7 +153,9 @@ public:
         winrt::Windows::Perception::PerceptionTimestamp timestamp,
         winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
-    void Render(bool isStereo);
+    void Render(
+        bool isStereo,
+        winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum);
 
     void CreateDeviceDependentResources();
     void ReleaseDeviceDependentResources();
@@ -103,6 +165,11 @@ private:
     void OnLocatibilityChanged(
         const winrt::Windows::Perception::Spatial::SpatialLocator& spatialLocator, const winrt::Windows::Foundation::IInspectable&);
     SpatialSurfaceMeshPart* GetOrCreateMeshPart(winrt::guid id);
+    void UpdateCullingHierarchy();
+
+    void IngestMesh(const GUID& id, uint64_t updateSequence, winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh mesh);
+    void ApplyStagingBlocks();
+    void ApplyStagingBlock(SpatialSurfaceMeshStagingBlock& block);
 
 private:
     friend class SpatialSurfaceMeshPart;
@@ -119,6 +186,17 @@ private:
     // mesh parts
     using MeshPartMap = std::map<GUID, std::unique_ptr<SpatialSurfaceMeshPart>, Utils::GUIDComparer>;
     MeshPartMap m_meshParts;
+    // set when positional tracking was lost, all parts are then dropped at the start of the next Update
+    std::atomic<bool> m_resetRequested = false;
+    // incremented by every SpatialSurfaceMeshPart::Update, shared by all parts so that it keeps increasing when a part is recreated
+    uint64_t m_meshUpdateSequence = 0;
+
+    // culling: hierarchy over the rendering space bounds of all parts with a mesh, m_cullingParts maps leaves to parts
+    FrustumCulling::BoundingVolumeHierarchy m_cullingHierarchy;
+    std::vector<SpatialSurfaceMeshPart*> m_cullingParts;
+    std::vector<FrustumCulling::BoundingBox> m_cullingBoxes;
+    std::vector<uint32_t> m_visibleParts;
+    bool m_cullingHierarchyDirty = true;
 
     // rendering
     bool m_zfillOnly = false;
@@ -138,4 +216,18 @@ private:
     winrt::Windows::Perception::Spatial::SpatialLocatorAttachedFrameOfReference m_attachedFrameOfReference = nullptr;
 
     std::chrono::time_point<std::chrono::steady_clock> m_boundingVolumeUpdateTime;
+
+    // Mesh ingestion: meshes are converted into staging blocks by the job pool, every worker hands its blocks to the render
+    // thread through its own queue. The job pool is declared last, so that its workers are joined before the queues are destroyed.
+    using StagingQueue = SpscQueue<std::unique_ptr<SpatialSurfaceMeshStagingBlock>>;
+    std::vector<std::unique_ptr<StagingQueue>> m_stagingQueues;
+    // Blocks which did not fit into a full staging queue instead of blocking the worker until the next frame. Bursts larger than
+    // the queues are rare, so the list is guarded by a mutex. The counters are reported by the render thread.
+    std::mutex m_stagingOverflowMutex;
+    std::vector<std::unique_ptr<SpatialSurfaceMeshStagingBlock>> m_stagingOverflow;
+    std::atomic<bool> m_stagingOverflowPending = false;
+    std::atomic<uint32_t> m_stagingOverflowCount = 0;
+    std::atomic<uint32_t> m_rejectedMeshCount = 0;
+    uint32_t m_reportedRejectedMeshCount = 0;
+    JobPool m_meshIngestionPool;
 };
@@ -110,6 +110,7 @@ void SpinningCubeRenderer::Update(
     }
     const float radians = static_cast<float>(fmod(totalRotation, XM_2PI));
     const XMMATRIX modelRotation = XMMatrixRotationY(-radians);
+    m_rotation = -radians;
 
     {
         // Position the cube.
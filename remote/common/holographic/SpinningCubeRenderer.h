@@ -50,6 +50,20 @@ public:
     {
         return m_position;
     }
+    // Rotation of the hologram around the y axis in radians, as of the last Update.
+    float GetRotation() const
+    {
+        return m_rotation;
+    }
+    const DirectX::XMFLOAT4& GetColorFilter() const
+    {
+        return m_filterColorData;
+    }
+    // Half the edge length of the cube in meters.
+    float GetExtent() const
+    {
+        return m_cubeExtent;
+    }
 
     void Pause()
     {
@@ -94,6 +108,7 @@ private:
     winrt::Windows::Foundation::Numerics::float3 m_position = {0.0f, 0.0f, -2.0f};
     PauseState m_pauseState = PauseState::Unpaused;
     double m_rotationOffset = 0;
+    float m_rotation = 0.0f;
 
     // If the current D3D Device supports VPRT, we can avoid using a geometry
     // shader just to set the render target array index.
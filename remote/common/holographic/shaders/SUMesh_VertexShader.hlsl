@@ -0,0 +1,69 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+// A constant buffer that stores the model transform.
+cbuffer SUMeshConstantBuffer : register(b0)
+{
+    float4x4 model;
+};
+
+// A constant buffer that stores each set of view and projection matrices in column-major format.
+cbuffer ViewProjectionConstantBuffer : register(b1)
+{
+    float4x4 viewProjection[2];
+};
+
+// A constant buffer that stores the color of the current draw.
+cbuffer SUMeshColorConstantBuffer : register(b2)
+{
+    float4 color;
+};
+
+// Per-vertex data used as input to the vertex shader. The scene mesh only stores positions, the color is the same for the
+// whole draw.
+struct VertexShaderInput
+{
+    float3      pos     : POSITION;
+    uint        instId  : SV_InstanceID;
+};
+
+// Per-vertex data passed to the geometry shader, the same as for SU_VertexShader.
+struct VertexShaderOutput
+{
+    float4      pos     : SV_POSITION;
+    min16float3 color   : COLOR0;
+    float2      uv      : TEXCOORD0;
+    uint        viewId  : TEXCOORD1; // SV_InstanceID % 2
+};
+
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+    float4 pos = float4(input.pos, 1.0f);
+
+    // Note which view this vertex has been sent to. Used for matrix lookup.
+    int idx = input.instId % 2;
+
+    // Transform the vertex position into world space.
+    pos = mul(pos, model);
+
+    // Correct for perspective and project the vertex position onto the screen.
+    output.pos = mul(pos, viewProjection[idx]);
+
+    output.color = (min16float3)color.rgb;
+    output.uv = float2(0.0f, 0.0f);
+
+    // The pass-through geometry shader sets the render target array index to this value.
+    output.viewId = idx;
+
+    return output;
+}
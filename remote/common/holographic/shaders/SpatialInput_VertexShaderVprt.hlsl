@@ -0,0 +1,99 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// A constant buffer that stores the model transform.
+cbuffer ModelConstantBuffer : register(b0)
+{
+    float4x4 model;
+};
+
+// A constant buffer that stores each set of view and projection matrices in column-major format.
+cbuffer ViewProjectionConstantBuffer : register(b1)
+{
+    float4x4 viewProjection[2];
+};
+
+// Pose, size and color of one instance, see SpatialInputInstancing::Instance.
+struct SpatialInputInstance
+{
+    float3 position;
+    float  length;
+    float4 orientation;
+    float3 color;
+    float  radius;
+};
+
+// A constant buffer that stores the instances of all shapes, updated once per frame.
+cbuffer SpatialInputInstanceConstantBuffer : register(b2)
+{
+    SpatialInputInstance instances[256];
+};
+
+// A constant buffer that stores the range of instances of the current draw.
+cbuffer SpatialInputDrawConstantBuffer : register(b3)
+{
+    uint viewCount;
+    uint firstInstance;
+};
+
+// Per-vertex data of the shared shape meshes, see SpatialInputInstancing::ShapeVertex.
+struct VertexShaderInput
+{
+    float4      shape   : POSITION;
+    min16float3 color   : COLOR0;
+    uint        instId  : SV_InstanceID;
+};
+
+// Per-vertex data passed to the pixel shader, the same as for SimpleColor_VertexShaderVprt.
+// Note that the render target array index is set here in the vertex shader.
+struct VertexShaderOutput
+{
+    float4      pos     : SV_POSITION;
+    min16float3 color   : COLOR0;
+    uint        idx     : TEXCOORD0;
+    uint        rtvId   : SV_RenderTargetArrayIndex; // view of the instance
+};
+
+// Rotates v by the quaternion q.
+float3 Rotate(float4 q, float3 v)
+{
+    return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+
+    // Each instance is drawn once per view, so the instance ID selects both the instance and the view.
+    SpatialInputInstance instance = instances[firstInstance + input.instId / viewCount];
+    int idx = input.instId % viewCount;
+
+    // Size the shape by the instance and move it to the instance pose.
+    float3 local = float3(
+        input.shape.x * instance.radius,
+        input.shape.y * instance.radius,
+        input.shape.z * min(instance.radius, 0.5f * instance.length) + input.shape.w * instance.length);
+    float4 pos = float4(Rotate(instance.orientation, local) + instance.position, 1.0f);
+
+    // Transform the vertex position into world space.
+    pos = mul(pos, model);
+
+    // Correct for perspective and project the vertex position onto the screen.
+    output.pos = mul(pos, viewProjection[idx]);
+
+    output.color = input.color + (min16float3)instance.color;
+
+    // Set the render target array index.
+    output.rtvId = idx;
+    output.idx   = idx;
+
+    return output;
+}
@@ -13,8 +13,10 @@
 
 #include <SampleRemoteApp.h>
 
+#include <AsyncLog.h>
 #include <DbgLog.h>
 #include <DirectXHelper.h>
+#include <FrameProfiler.h>
 #include <Utils.h>
 #include <holographic/RemoteWindowHolographic.h>
 #include <holographic/Speech.h>
@@ -30,6 +32,7 @@
 #include <winrt/Windows.Foundation.Metadata.h>
 #include <winrt/Windows.Perception.People.h>
 #include <winrt/Windows.Security.Authorization.AppCapabilityAccess.h>
+#include <winrt/Windows.Storage.h>
 
 using namespace concurrency;
 
@@ -64,18 +67,46 @@ namespace
 
         return L"Unknown";
     }
+
+    // Output files of packaged apps are created in the local app data folder, unless the path is absolute.
+    std::filesystem::path GetOutputPath(const std::wstring& file)
+    {
+        std::filesystem::path path = file;
+#if !WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        if (path.is_relative())
+        {
+            path = std::filesystem::path(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) / path;
+        }
+#endif
+        return path;
+    }
 } // namespace
 
 SampleRemoteApp::SampleRemoteApp()
 {
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+    m_customDataChannelDispatcher.Register(DataChannel::MessageType::Ping, [](const DataChannel::MessageView&) {
+        DebugLog("Custom Data Channel: Response Received.\n");
+    });
+    m_customDataChannelDispatcher.Register(DataChannel::MessageType::BitrateTarget, [this](const DataChannel::MessageView& message) {
+        DataChannel::PayloadReader reader(message.payload);
+        uint32_t targetKbps = 0;
+        if (reader.Read(targetKbps) && targetKbps > 0)
+        {
+            m_bitrateTargetKbps = targetKbps;
+        }
+    });
+#endif
 }
 
 SampleRemoteApp::~SampleRemoteApp()
 {
+    FrameProfiler::Stop();
     ShutdownRemoteContext();
 
     m_deviceResources->RegisterDeviceNotify(nullptr);
     UnregisterHolographicEventHandlers();
+    AsyncLog::Stop();
 }
 
 void SampleRemoteApp::SetWindow(RemoteWindowHolographic* window)
@@ -94,6 +125,7 @@ void SampleRemoteApp::SetWindow(RemoteWindowHolographic* window)
 
 void SampleRemoteApp::Tick()
 {
+    FRAME_PROFILER_SCOPE("Tick");
     if (const HolographicFrame& holographicFrame = Update())
     {
         Render(holographicFrame);
@@ -294,11 +326,53 @@ void SampleRemoteApp::ParseLaunchArguments(std::wstring_view arguments)
                 }
                 continue;
             }
+
+            if (param == L"trace")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    options.traceFile = args[argIndex + 1];
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"profile")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    options.profileFile = args[argIndex + 1];
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"log")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    options.logFile = args[argIndex + 1];
+                    argIndex++;
+                }
+                continue;
+            }
         }
 
         options.hostname = Utils::SplitHostnameAndPortString(arg, options.port);
     }
 
+    StartLog(options.logFile);
+
+    if (!options.traceFile.empty())
+    {
+        OpenFrameTrace(options.traceFile);
+    }
+
+    if (!options.profileFile.empty())
+    {
+        StartFrameProfiler(options.profileFile);
+    }
+
     if (!isStandalone)
     {
         ConfigureRemoting(options);
@@ -361,6 +435,8 @@ void SampleRemoteApp::OnRecognizedSpeech(const winrt::hstring& recognizedText)
 
 HolographicFrame SampleRemoteApp::Update()
 {
+    FRAME_PROFILER_SCOPE("Update");
+
     auto timeDelta = std::chrono::high_resolution_clock::now() - m_windowTitleUpdateTime;
     if (timeDelta >= 1s)
     {
@@ -384,7 +460,10 @@ HolographicFrame SampleRemoteApp::Update()
         //       Instead we wait here before we do the call to CreateNextFrame on the HolographicSpace.
         //       We do this to avoid that PeekMessage causes frame delta time spikes, say if we wait
         //       after PeekMessage WaitForNextFrameReady will compensate any time spend in PeekMessage.
-        m_deviceResources->GetHolographicSpace().WaitForNextFrameReady();
+        {
+            FRAME_PROFILER_SCOPE("WaitForNextFrameReady");
+            m_deviceResources->GetHolographicSpace().WaitForNextFrameReady();
+        }
 
         // Update to latest prediction immediately after waiting.
         holographicFrame.UpdateCurrentPrediction();
@@ -469,6 +548,11 @@ HolographicFrame SampleRemoteApp::Update()
         }
         m_spatialInputRenderer->Update(prediction.Timestamp(), coordinateSystem);
 
+        if (m_frameTrace.IsOpen())
+        {
+            RecordFrameTrace(prediction, coordinateSystem);
+        }
+
         // We complete the frame update by using information about our content positioning to set the focus point.
         if (!m_canCommitDirect3D11DepthBuffer || !m_commitDirect3D11DepthBuffer)
         {
@@ -499,29 +583,22 @@ HolographicFrame SampleRemoteApp::Update()
             std::lock_guard lock(m_customDataChannelLock);
             if (m_customDataChannel)
             {
-                // Try to get send queue size. The send queue size returns the size of data, that has not been send yet, in bytes.
-                // A big number might indicate that more data is queued to send than the amount of data, that is actually sent.
-                // If possible skip sending data in this case, to help the queue getting smaller again.
-                uint32_t sendQueueSize = m_customDataChannel.SendQueueSize();
-
-                // Only send the packet if the send queue is smaller than 1MiB
-                if (sendQueueSize < 1 * 1024 * 1024)
-                {
-                    uint8_t data = 1;
+                m_customDataChannelBatcher.AddMessage(DataChannel::MessageType::Ping, std::chrono::steady_clock::now());
+                DebugLog("Custom Data Channel: Request Queued.\n");
+            }
+        }
 
-                    try
-                    {
-                        m_customDataChannel.SendData(
-                            winrt::array_view<const uint8_t>(
-                                reinterpret_cast<const uint8_t*>(&data), reinterpret_cast<const uint8_t*>(&data + 1)),
-                            true);
-                        OutputDebugString(TEXT("Custom Data Channel: Request Sent.\n"));
-                    }
-                    catch (...)
-                    {
-                        // SendData might throw if channel is closed, but we did not get or process the async closed event yet.
-                    }
-                }
+        {
+            // Queue the batched messages whose latency budget is spent, and send what the channel can take. The send queue size
+            // is the size of the data which has not been sent yet, in bytes. The scheduler keeps it short, so that the channel
+            // does not queue more data than it actually sends.
+            std::lock_guard lock(m_customDataChannelLock);
+            if (m_customDataChannel)
+            {
+                const auto now = std::chrono::steady_clock::now();
+                m_customDataChannelBatcher.Poll(now);
+                m_customDataChannelStreamSender.Pump();
+                m_customDataChannelScheduler.Service(now, m_customDataChannel.SendQueueSize());
             }
         }
 #endif
@@ -534,8 +611,129 @@ HolographicFrame SampleRemoteApp::Update()
     }
 }
 
+void SampleRemoteApp::OpenFrameTrace(const std::wstring& traceFile)
+{
+    const std::filesystem::path path = GetOutputPath(traceFile);
+    if (m_frameTrace.Open(path))
+    {
+        DebugLog("Recording the frame trace to %ls.\n", path.c_str());
+    }
+    else
+    {
+        DebugLog("Failed to create the frame trace %ls.\n", path.c_str());
+    }
+}
+
+void SampleRemoteApp::StartLog(const std::wstring& logFile)
+{
+    // Launch arguments are parsed again on each activation, keep the log of the first one.
+    if (AsyncLog::IsRunning())
+    {
+        return;
+    }
+
+    std::vector<std::shared_ptr<AsyncLog::Sink>> sinks{std::make_shared<AsyncLog::DebuggerSink>()};
+    const std::filesystem::path path = GetOutputPath(logFile);
+    bool logFileFailed = false;
+    if (!logFile.empty())
+    {
+        auto fileSink = std::make_shared<AsyncLog::RotatingFileSink>(path);
+        logFileFailed = !fileSink->IsOpen();
+        if (!logFileFailed)
+        {
+            sinks.push_back(std::move(fileSink));
+        }
+    }
+
+    AsyncLog::Start(std::move(sinks));
+    if (logFileFailed)
+    {
+        DebugLog("Failed to create the log file %ls.", path.c_str());
+    }
+}
+
+void SampleRemoteApp::StartFrameProfiler(const std::wstring& profileFile)
+{
+    const std::filesystem::path path = GetOutputPath(profileFile);
+    if (FrameProfiler::Start(path))
+    {
+        FRAME_PROFILER_THREAD_NAME("Main");
+        DebugLog("Recording the frame timing to %ls.\n", path.c_str());
+    }
+    else
+    {
+        DebugLog("Failed to create the frame timing trace %ls.\n", path.c_str());
+    }
+}
+
+void SampleRemoteApp::RecordFrameTrace(const HolographicFramePrediction& prediction, const SpatialCoordinateSystem& coordinateSystem)
+{
+    using namespace FrameTrace;
+
+    const auto storePose = [](const float3& position, const quaternion& orientation, Pose& pose) {
+        pose = {{position.x, position.y, position.z}, {orientation.x, orientation.y, orientation.z, orientation.w}};
+    };
+
+    m_frameTraceViews.clear();
+    for (const HolographicCameraPose& cameraPose : prediction.CameraPoses())
+    {
+        auto viewTransform = cameraPose.TryGetViewTransform(coordinateSystem);
+        if (!viewTransform)
+        {
+            continue;
+        }
+
+        const HolographicStereoTransform projection = cameraPose.ProjectionTransform();
+        const auto appendView = [&](const float4x4& view, const float4x4& projectionMatrix) {
+            float4x4 viewInverse;
+            float3 scale, position;
+            quaternion orientation;
+            if (!invert(view, &viewInverse) || !decompose(viewInverse, &scale, &orientation, &position))
+            {
+                return;
+            }
+
+            ViewRecord& record = m_frameTraceViews.emplace_back();
+            storePose(position, orientation, record.pose);
+            const float4x4 viewProjection = view * projectionMatrix;
+            std::memcpy(record.viewProjection, &viewProjection, sizeof(record.viewProjection));
+        };
+        appendView(viewTransform.Value().Left, projection.Left);
+        if (cameraPose.HolographicCamera().IsStereo())
+        {
+            appendView(viewTransform.Value().Right, projection.Right);
+        }
+    }
+
+    m_frameTraceJoints.clear();
+    m_spatialInputRenderer->AppendRenderingJoints(m_frameTraceJoints);
+
+    HologramRecord cube{};
+    const quaternion cubeOrientation = make_quaternion_from_axis_angle(float3::unit_y(), m_spinningCubeRenderer->GetRotation());
+    storePose(m_spinningCubeRenderer->GetPosition(), cubeOrientation, cube.pose);
+    std::fill(std::begin(cube.scale), std::end(cube.scale), 2.0f * m_spinningCubeRenderer->GetExtent());
+    const DirectX::XMFLOAT4& color = m_spinningCubeRenderer->GetColorFilter();
+    cube.color[0] = color.x;
+    cube.color[1] = color.y;
+    cube.color[2] = color.z;
+
+    // Timestamps are the predicted display times of the frames.
+    const auto timestamp =
+        std::chrono::duration_cast<std::chrono::microseconds>(prediction.Timestamp().TargetTime().time_since_epoch());
+    const bool recorded = m_frameTrace.Write(RecordType::FrameBegin, timestamp) &&
+                          m_frameTrace.Write(RecordType::Views, timestamp, std::span<const ViewRecord>(m_frameTraceViews)) &&
+                          m_frameTrace.Write(RecordType::Joints, timestamp, std::span<const JointRecord>(m_frameTraceJoints)) &&
+                          m_frameTrace.Write(RecordType::Holograms, timestamp, std::span<const HologramRecord>(&cube, 1));
+    if (!recorded)
+    {
+        DebugLog("Stopped recording the frame trace, the file could not grow.\n");
+    }
+}
+
 void SampleRemoteApp::Render(HolographicFrame holographicFrame)
 {
+    FRAME_PROFILER_SCOPE("Render");
+
     bool atLeastOneCameraRendered = false;
 
     m_deviceResources->UseHolographicCameraResources(
@@ -595,7 +793,7 @@ void SampleRemoteApp::Render(HolographicFrame holographicFrame)
 
                             if (m_spatialSurfaceMeshRenderer)
                             {
-                                m_spatialSurfaceMeshRenderer->Render(pCameraResources->IsRenderingStereoscopic());
+                                m_spatialSurfaceMeshRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
                             }
                             m_spatialInputRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
 
@@ -618,8 +816,12 @@ void SampleRemoteApp::Render(HolographicFrame holographicFrame)
             }
         });
 
+    // The vertex buffer space used by all cameras of this frame becomes reusable once the GPU has finished the frame.
+    m_qrCodeRenderer->EndFrame();
+
     if (atLeastOneCameraRendered)
     {
+        FRAME_PROFILER_SCOPE("Present");
         m_deviceResources->Present(holographicFrame);
     }
 
@@ -693,19 +895,29 @@ void SampleRemoteApp::EnsureRemoteContextInitialized()
     if (!m_remoteContext && !m_isStandalone)
     {
 
+        uint32_t maxBitrateKbps = m_options.maxBitrateKbps;
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+        // Use the bitrate the player reported for its link during the last connection, within the configured maximum.
+        if (const uint32_t targetKbps = m_bitrateTargetKbps; targetKbps > 0 && targetKbps < maxBitrateKbps)
+        {
+            DebugLog("Using the bitrate of %u kbps reported by the player.\n", targetKbps);
+            maxBitrateKbps = targetKbps;
+        }
+#endif
+
         // Create the RemoteContext
         // IMPORTANT: This must be done before creating the HolographicSpace (or any other call to the Holographic API).
-        HRESULT hr = CreateRemoteContext(m_remoteContext, m_options.maxBitrateKbps, m_options.enableAudio, PreferredVideoCodec::Any);
+        HRESULT hr = CreateRemoteContext(m_remoteContext, maxBitrateKbps, m_options.enableAudio, PreferredVideoCodec::Any);
 
         if (hr != S_OK)
         {
             if (hr == WINCODEC_ERR_COMPONENTNOTFOUND)
             {
-                DebugLog(L"Preferred video codec not found.\n");
+                DebugLog("Preferred video codec not found.\n");
             }
             else
             {
-                DebugLog(L"Failed to create the remote context.\n");
+                DebugLog("Failed to create the remote context.\n");
             }
             m_remoteContext = nullptr;
             return;
@@ -734,7 +946,7 @@ void SampleRemoteApp::EnsureRemoteContextInitialized()
         if (SUCCEEDED(GetDeviceResources()->GetDXGIAdapter()->GetDesc2(&dxgiAdapterDesc)) &&
             (dxgiAdapterDesc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE))
         {
-            DebugLog(L"Software video adapter is not supported for holographic streamer.\n");
+            DebugLog("Software video adapter is not supported for holographic streamer.\n");
             m_remoteContext = nullptr;
             return;
         }
@@ -882,11 +1094,11 @@ void SampleRemoteApp::ConnectOrListen()
     {
         if (m_options.listen)
         {
-            DebugLog(L"Listen failed with hr = 0x%08X", e.code());
+            DebugLog("Listen failed with hr = 0x%08X", static_cast<int32_t>(e.code()));
         }
         else
         {
-            DebugLog(L"Connect failed with hr = 0x%08X", e.code());
+            DebugLog("Connect failed with hr = 0x%08X", static_cast<int32_t>(e.code()));
         }
     }
 }
@@ -918,7 +1130,7 @@ void SampleRemoteApp::LoadPosition()
                 {
                     const float3 res = transform(float3::zero(), positionToOrigin.Value());
                     m_spinningCubeRenderer->SetPosition(res);
-                    OutputDebugStringW(L"Loaded cube position from SpatialAnchorStore.\n");
+                    DebugLog("Loaded cube position from SpatialAnchorStore.\n");
                 }
             }
         }
@@ -950,7 +1162,7 @@ void SampleRemoteApp::SavePosition()
                 store.Clear();
                 if (store.TrySave(L"position", position))
                 {
-                    OutputDebugStringW(L"Saved cube position to SpatialAnchorStore.\n");
+                    DebugLog("Saved cube position to SpatialAnchorStore.\n");
                 }
             }
         });
@@ -993,7 +1205,7 @@ winrt::fire_and_forget SampleRemoteApp::ExportPosition()
 
         if (!sufficient.IsMinimallySufficient())
         {
-            OutputDebugStringW(L"\r\nNot enough data for the anchor to export. Try again later.");
+            DebugLog("Not enough data for the anchor to export. Try again later.");
             co_return;
         }
 
@@ -1014,11 +1226,7 @@ winrt::fire_and_forget SampleRemoteApp::ExportPosition()
             reader.LoadAsync(static_cast<uint32_t>(size));
             reader.ReadBytes(winrt::array_view(data.data(), data.data() + data.size()));
 
-            {
-                std::wostringstream debugMsg;
-                debugMsg << "\r\nSuccessfully exported anchor. Size is " << size << " bytes.";
-                OutputDebugStringW(debugMsg.str().c_str());
-            }
+            DebugLog("Successfully exported anchor. Size is %llu bytes.", size);
         }
     }
     catch (...)
@@ -1054,16 +1262,16 @@ void SampleRemoteApp::RequestEyesPoseAccess()
                 switch (status)
                 {
                     case winrt::Windows::UI::Input::GazeInputAccessStatus::Unspecified:
-                        OutputDebugStringA("ParseGazeInputResponseData Unspecified\n");
+                        DebugLog("ParseGazeInputResponseData Unspecified\n");
                         break;
                     case winrt::Windows::UI::Input::GazeInputAccessStatus::Allowed:
-                        OutputDebugStringA("ParseGazeInputResponseData Allowed\n");
+                        DebugLog("ParseGazeInputResponseData Allowed\n");
                         break;
                     case winrt::Windows::UI::Input::GazeInputAccessStatus::DeniedByUser:
-                        OutputDebugStringA("ParseGazeInputResponseData DeniedByUser\n");
+                        DebugLog("ParseGazeInputResponseData DeniedByUser\n");
                         break;
                     case winrt::Windows::UI::Input::GazeInputAccessStatus::DeniedBySystem:
-                        OutputDebugStringA("ParseGazeInputResponseData DeniedBySystem\n");
+                        DebugLog("ParseGazeInputResponseData DeniedBySystem\n");
                         break;
                     default:
                         break;
@@ -1081,7 +1289,7 @@ void SampleRemoteApp::RequestSceneObserverAccess()
 
     if (!m_sceneFactory->IsSupported())
     {
-        OutputDebugStringA("SceneObserver Unsupported\n");
+        DebugLog("SceneObserver Unsupported\n");
         return;
     }
 
@@ -1091,19 +1299,19 @@ void SampleRemoteApp::RequestSceneObserverAccess()
             {
                 if (status != Status::OK)
                 {
-                    OutputDebugStringA("SceneObserver Access Failed\n");
+                    DebugLog("SceneObserver Access Failed\n");
                     m_hasSceneObserverAccess = false;
                     return;
                 }
 
                 if (accessStatus == PerceptionSceneFactoryAccessStatus::Allowed)
                 {
-                    OutputDebugStringA("SceneObserver Access Allowed\n");
+                    DebugLog("SceneObserver Access Allowed\n");
                     m_hasSceneObserverAccess = true;
                 }
                 else
                 {
-                    OutputDebugStringA("SceneObserver Access Denied\n");
+                    DebugLog("SceneObserver Access Denied\n");
                     m_hasSceneObserverAccess = false;
                 }
             }
@@ -1151,14 +1359,14 @@ winrt::fire_and_forget SampleRemoteApp::RequestQRCodeWatcherUpdates()
     {
         if (!QRCodeWatcher::IsSupported())
         {
-            OutputDebugStringA("QRCodeWatcher Unsupported\n");
+            DebugLog("QRCodeWatcher Unsupported\n");
             co_return;
         }
 
         QRCodeWatcherAccessStatus accessStatus = co_await QRCodeWatcher::RequestAccessAsync();
         if (accessStatus == winrt::Microsoft::MixedReality::QR::QRCodeWatcherAccessStatus::Allowed)
         {
-            OutputDebugStringA("QRCodeWatcher Access Allowed\n");
+            DebugLog("QRCodeWatcher Access Allowed\n");
 
             if (auto strongThis = weakThis.lock())
             {
@@ -1180,12 +1388,12 @@ winrt::fire_and_forget SampleRemoteApp::RequestQRCodeWatcherUpdates()
         }
         else
         {
-            OutputDebugStringA("QRCodeWatcher Access Denied\n");
+            DebugLog("QRCodeWatcher Access Denied\n");
         }
     }
     catch (...)
     {
-        OutputDebugStringA("QRCodeWatcher Access Failed\n");
+        DebugLog("QRCodeWatcher Access Failed\n");
     }
 }
 
@@ -1213,6 +1421,9 @@ void SampleRemoteApp::ShutdownRemoteContext()
             m_customChannelDataReceivedEventRevoker.revoke();
             m_customChannelClosedEventRevoker.revoke();
             m_customDataChannel = nullptr;
+            m_customDataChannelBatcher.Clear();
+            m_customDataChannelStreamSender.Clear();
+            m_customDataChannelScheduler.Clear();
         }
 #endif
 
@@ -1275,8 +1486,7 @@ void SampleRemoteApp::OnLocatabilityChanged(const SpatialLocator& sender, const
             break;
     }
 
-    winrt::hstring message = L"Positional tracking is " + winrt::to_hstring(locatability) + L".\n";
-    OutputDebugStringW(message.data());
+    DebugLog("Positional tracking is %ls.", winrt::to_hstring(locatability));
 }
 
 void SampleRemoteApp::OnConnected()
@@ -1300,7 +1510,7 @@ void SampleRemoteApp::OnConnected()
 
 void SampleRemoteApp::OnDisconnected(winrt::Microsoft::Holographic::AppRemoting::ConnectionFailureReason failureReason)
 {
-    DebugLog(L"Disconnected with reason %d", failureReason);
+    DebugLog("Disconnected with reason %d", failureReason);
 
     {
         std::lock_guard remoteContextLock(m_remoteContextAccess);
@@ -1318,7 +1528,7 @@ void SampleRemoteApp::OnDisconnected(winrt::Microsoft::Holographic::AppRemoting:
     {
         if (m_options.autoReconnect)
         {
-            DebugLog(L"Reconnecting...");
+            DebugLog("Reconnecting...");
             ConnectOrListen();
         }
         else
@@ -1329,7 +1539,7 @@ void SampleRemoteApp::OnDisconnected(winrt::Microsoft::Holographic::AppRemoting:
     // Failure reason None indicates a normal disconnect.
     else if (failureReason != ConnectionFailureReason::None)
     {
-        DebugLog(L"Disconnected with unrecoverable error, not attempting to reconnect.");
+        DebugLog("Disconnected with unrecoverable error, not attempting to reconnect.");
         ShutdownRemoteContext();
     }
 
@@ -1454,6 +1664,8 @@ void SampleRemoteApp::WindowCreateSwapChain(const winrt::com_ptr<ID3D11Device1>&
 
 void SampleRemoteApp::WindowPresentSwapChain()
 {
+    FRAME_PROFILER_SCOPE("PresentPreview");
+
     HRESULT hr = m_swapChain->Present(0, 0);
 
     if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
@@ -1507,16 +1719,11 @@ void SampleRemoteApp::WindowUpdateTitle()
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
 void SampleRemoteApp::OnCustomDataChannelDataReceived(winrt::array_view<const uint8_t> dataView)
 {
-    const uint8_t packetType = (dataView.size() > 0) ? dataView[0] : 1;
-    switch (packetType)
+    const DataChannel::MessageDispatcher::DispatchResult result =
+        m_customDataChannelDispatcher.Dispatch({dataView.data(), dataView.size()});
+    if (result.unhandledCount > 0 || result.status != DataChannel::ReadStatus::End)
     {
-        case 1: // legacy ping; ignore any message content
-            OutputDebugString(TEXT("Custom Data Channel: Response Received.\n"));
-            break;
-
-        default:
-            OutputDebugString(TEXT("Custom Data Channel: Unknown Response Received.\n"));
-            break;
+        DebugLog("Custom Data Channel: Unknown Response Received.\n");
     }
 }
 
@@ -1528,6 +1735,29 @@ void SampleRemoteApp::OnCustomDataChannelClosed()
         m_customChannelDataReceivedEventRevoker.revoke();
         m_customChannelClosedEventRevoker.revoke();
         m_customDataChannel = nullptr;
+        m_customDataChannelBatcher.Clear();
+        m_customDataChannelStreamSender.Clear();
+        m_customDataChannelScheduler.Clear();
+    }
+}
+
+bool SampleRemoteApp::CustomDataChannelTransport::SendPacket(std::span<const uint8_t> packet, bool guaranteedDelivery)
+{
+    if (!m_channel)
+    {
+        return false;
+    }
+
+    try
+    {
+        m_channel.SendData(winrt::array_view<const uint8_t>(packet.data(), static_cast<uint32_t>(packet.size())), guaranteedDelivery);
+        DebugLog("Custom Data Channel: Packet Sent.\n");
+        return true;
+    }
+    catch (...)
+    {
+        // SendData might throw if channel is closed, but we did not get or process the async closed event yet.
+        return false;
     }
 }
 #endif
@@ -13,7 +13,10 @@
 
 #include <holographic/IRemoteAppHolographic.h>
 
+#include <DataChannelScheduler.h>
+#include <DataChannelStream.h>
 #include <DeviceResourcesD3D11Holographic.h>
+#include <FrameTrace.h>
 #include <SimpleCubeRenderer.h>
 #include <holographic/QRCodeRenderer.h>
 #include <holographic/SceneUnderstandingRenderer.h>
@@ -58,6 +61,13 @@ public:
         bool autoReconnect = true;
         bool enableAudio = true;
         uint32_t maxBitrateKbps = 20000;
+        // Records the input of every frame into this file if set (-trace <file>), so that it can be replayed by the benchmarks.
+        std::wstring traceFile;
+        // Records the timing of the frame phases into this Chrome trace file if set (-profile <file>).
+        std::wstring profileFile;
+        // Writes the log into this file, besides the debugger output, if set (-log <file>). Older logs are kept in <file>.1 to
+        // <file>.3.
+        std::wstring logFile;
     };
 
 public:
@@ -138,6 +148,21 @@ private:
     // Compute scene update and toggle rendering mode.
     void ToggleSceneUnderstanding();
 
+    // Creates the frame trace file. Relative paths of packaged apps are resolved in the local app data folder.
+    void OpenFrameTrace(const std::wstring& traceFile);
+
+    // Starts recording the frame timing. Relative paths of packaged apps are resolved in the local app data folder.
+    void StartFrameProfiler(const std::wstring& profileFile);
+
+    // Starts writing the log on a background thread, to the debugger and logFile if set. Relative paths of packaged apps are
+    // resolved in the local app data folder.
+    void StartLog(const std::wstring& logFile);
+
+    // Appends the camera views, hand joints and hologram poses of the current frame to the frame trace.
+    void RecordFrameTrace(
+        const winrt::Windows::Graphics::Holographic::HolographicFramePrediction& prediction,
+        const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& coordinateSystem);
+
     // Clears event registration state. Used when changing to a new HolographicSpace
     // and when tearing down SampleRemoteApp.
     void UnregisterHolographicEventHandlers();
@@ -174,6 +199,21 @@ private:
     // Used to notify the app when the custom data channel was closed
     void OnCustomDataChannelClosed();
 
+    // Sends the packets of the custom data channel scheduler over the custom data channel.
+    class CustomDataChannelTransport : public DataChannel::IPacketTransport
+    {
+    public:
+        explicit CustomDataChannelTransport(const winrt::Microsoft::Holographic::AppRemoting::IDataChannel2& channel)
+            : m_channel(channel)
+        {
+        }
+
+        bool SendPacket(std::span<const uint8_t> packet, bool guaranteedDelivery) override;
+
+    private:
+        const winrt::Microsoft::Holographic::AppRemoting::IDataChannel2& m_channel;
+    };
+
 #endif
 private:
     bool m_isInitialized = false;
@@ -235,6 +275,11 @@ private:
     // Host options
     Options m_options = {};
 
+    // Frame trace, open if requested with -trace. The record vectors are kept to reuse their memory.
+    FrameTrace::TraceWriter m_frameTrace;
+    std::vector<FrameTrace::ViewRecord> m_frameTraceViews;
+    std::vector<FrameTrace::JointRecord> m_frameTraceJoints;
+
     // Host window related variables
     RemoteWindowHolographic* m_window = nullptr;
     int m_width = INITIAL_WINDOW_WIDTH;
@@ -263,6 +308,23 @@ private:
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2::OnDataReceived_revoker m_customChannelDataReceivedEventRevoker;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2::OnClosed_revoker m_customChannelClosedEventRevoker;
     std::chrono::high_resolution_clock::time_point m_customDataChannelSendTime = std::chrono::high_resolution_clock::now();
+    DataChannel::MessageDispatcher m_customDataChannelDispatcher;
+    // The batcher coalesces the messages sent within its latency budget and queues its packets as interactive traffic in the
+    // scheduler, which paces them to what the channel drains. Both are serviced once per frame, and guarded by
+    // m_customDataChannelLock.
+    CustomDataChannelTransport m_customDataChannelTransport{m_customDataChannel};
+    DataChannel::MessageScheduler m_customDataChannelScheduler{m_customDataChannelTransport, std::chrono::steady_clock::now()};
+    DataChannel::ScheduledTransport m_customDataChannelBatcherTransport{
+        m_customDataChannelScheduler, DataChannel::TrafficClass::Interactive};
+    DataChannel::MessageBatcher m_customDataChannelBatcher{m_customDataChannelBatcherTransport};
+    // Sends large payloads, e.g. spatial mesh snapshots, in chunks queued as bulk traffic. Pumped once per frame. The chunks
+    // are compressed with the codec which suits their content type, see PayloadCompressor::SetInt16Layout for mesh data.
+    DataChannel::ScheduledTransport m_customDataChannelStreamTransport{m_customDataChannelScheduler, DataChannel::TrafficClass::Bulk};
+    DataChannel::PayloadCompressor m_customDataChannelCompressor;
+    DataChannel::StreamSender m_customDataChannelStreamSender{m_customDataChannelStreamTransport, {}, &m_customDataChannelCompressor};
+    // Latest video bitrate in kbps the player asked for with a BitrateTarget message, 0 before the first one. The bitrate is
+    // fixed for the lifetime of a remote context, so it takes effect when the next one is created.
+    std::atomic<uint32_t> m_bitrateTargetKbps = 0;
 #endif
 
 #ifdef ENABLE_USER_COORDINATE_SYSTEM_SAMPLE
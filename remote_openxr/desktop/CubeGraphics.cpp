@@ -17,6 +17,8 @@
 #include "pch.h"
 #include "OpenXrProgram.h"
 #include "DxUtility.h"
+#include "CubeInstancing.h"
+#include "ViewCache.h"
 
 namespace {
     namespace CubeShader {
@@ -77,25 +79,25 @@ namespace {
             1, 7, 5,
         };
 
-        struct ModelConstantBuffer {
-            DirectX::XMFLOAT4X4 Model;
-        };
-
         struct ViewProjectionConstantBuffer {
             DirectX::XMFLOAT4X4 ViewProjection[2];
-        };
-
-        struct ColorFilterConstantBuffer {
-            DirectX::XMFLOAT4 colorFilter;
+            uint32_t ViewInstanceCount;
+            uint32_t Padding[3];
         };
 
         constexpr uint32_t MaxViewInstance = 2;
 
+        // Initial capacity of the instance buffer, which grows to the next power of two when more cubes are visible.
+        constexpr uint32_t MinInstanceCapacity = 64;
+
         // Separate entrypoints for the vertex and pixel shader functions.
+        // All cubes are drawn with one draw call of ViewInstanceCount instances per cube, the model matrix and color filter of
+        // each cube are read from the instance buffer (sample::CubeInstance).
         constexpr char ShaderHlsl[] = R"_(
             struct VSOutput {
                 float4 Pos : SV_POSITION;
                 float3 Color : COLOR0;
+                float4 ColorFilter : COLOR1;
                 uint viewId : SV_RenderTargetArrayIndex;
             };
             struct VSInput {
@@ -103,36 +105,83 @@ namespace {
                 float3 Color : COLOR0;
                 uint instId : SV_InstanceID;
             };
-            cbuffer ModelConstantBuffer : register(b0) {
-                float4x4 Model;
+            struct CubeInstance {
+                column_major float4x4 Model;
+                float4 ColorFilter;
             };
-            cbuffer ViewProjectionConstantBuffer : register(b1) {
+            cbuffer ViewProjectionConstantBuffer : register(b0) {
                 float4x4 ViewProjection[2];
+                uint ViewInstanceCount;
             };
-            cbuffer ColorFilterConstantBuffer: register(b0) {
-                float4 colorFilter;
-            };
+            StructuredBuffer<CubeInstance> Instances : register(t0);
 
             VSOutput MainVS(VSInput input) {
                 VSOutput output;
-                output.Pos = mul(mul(float4(input.Pos, 1), Model), ViewProjection[input.instId]);
+                const uint viewId = input.instId % ViewInstanceCount;
+                const CubeInstance instance = Instances[input.instId / ViewInstanceCount];
+                output.Pos = mul(mul(float4(input.Pos, 1), instance.Model), ViewProjection[viewId]);
                 output.Color = input.Color;
-                output.viewId = input.instId;
+                output.ColorFilter = instance.ColorFilter;
+                output.viewId = viewId;
                 return output;
             }
 
             float4 MainPS(VSOutput input) : SV_TARGET {
-                return float4(input.Color, 1) * colorFilter;
+                return float4(input.Color, 1) * input.ColorFilter;
             }
             )_";
 
     } // namespace CubeShader
 
+    using TextureViewKey = sample::TextureViewKey<ID3D11Texture2D>;
+
+    // Views of the swapchain textures, which include the images of both OpenXR swapchains and the window's back buffer.
+    constexpr size_t MaxCachedViewCount = 16;
+
+    // Creates texture array views of the whole array or one slice. DXGI_FORMAT_UNKNOWN uses the format of the texture.
+    struct RenderTargetViewFactory : sample::IViewFactory<TextureViewKey, winrt::com_ptr<ID3D11RenderTargetView>> {
+        ID3D11Device* Device = nullptr;
+
+        winrt::com_ptr<ID3D11RenderTargetView> CreateView(const TextureViewKey& key) override {
+            winrt::com_ptr<ID3D11RenderTargetView> view;
+            if (key.Format == DXGI_FORMAT_UNKNOWN) {
+                CHECK_HRCMD(Device->CreateRenderTargetView(key.Texture, nullptr, view.put()));
+            } else {
+                const bool allSlices = key.ArraySlice == TextureViewKey::AllArraySlices;
+                const CD3D11_RENDER_TARGET_VIEW_DESC viewDesc(D3D11_RTV_DIMENSION_TEXTURE2DARRAY,
+                                                              (DXGI_FORMAT)key.Format,
+                                                              0 /*mipSlice*/,
+                                                              allSlices ? 0 : key.ArraySlice,
+                                                              allSlices ? (UINT)-1 : 1);
+                CHECK_HRCMD(Device->CreateRenderTargetView(key.Texture, &viewDesc, view.put()));
+            }
+            return view;
+        }
+    };
+
+    struct DepthStencilViewFactory : sample::IViewFactory<TextureViewKey, winrt::com_ptr<ID3D11DepthStencilView>> {
+        ID3D11Device* Device = nullptr;
+
+        winrt::com_ptr<ID3D11DepthStencilView> CreateView(const TextureViewKey& key) override {
+            const bool allSlices = key.ArraySlice == TextureViewKey::AllArraySlices;
+            const CD3D11_DEPTH_STENCIL_VIEW_DESC viewDesc(D3D11_DSV_DIMENSION_TEXTURE2DARRAY,
+                                                          (DXGI_FORMAT)key.Format,
+                                                          0 /*mipSlice*/,
+                                                          allSlices ? 0 : key.ArraySlice,
+                                                          allSlices ? (UINT)-1 : 1);
+            winrt::com_ptr<ID3D11DepthStencilView> view;
+            CHECK_HRCMD(Device->CreateDepthStencilView(key.Texture, &viewDesc, view.put()));
+            return view;
+        }
+    };
+
     struct CubeGraphics : sample::IGraphicsPluginD3D11 {
         ID3D11Device* InitializeDevice(LUID adapterLuid, const std::vector<D3D_FEATURE_LEVEL>& featureLevels) override {
             const winrt::com_ptr<IDXGIAdapter1> adapter = sample::dx::GetAdapter(adapterLuid);
 
             sample::dx::CreateD3D11DeviceAndContext(adapter.get(), featureLevels, m_device.put(), m_deviceContext.put());
+            m_renderTargetViewFactory.Device = m_device.get();
+            m_depthStencilViewFactory.Device = m_device.get();
 
             InitializeD3DResources();
 
@@ -159,17 +208,10 @@ namespace {
                                                     vertexShaderBytes->GetBufferSize(),
                                                     m_inputLayout.put()));
 
-            const CD3D11_BUFFER_DESC modelConstantBufferDesc(sizeof(CubeShader::ModelConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-            CHECK_HRCMD(m_device->CreateBuffer(&modelConstantBufferDesc, nullptr, m_modelCBuffer.put()));
-
             const CD3D11_BUFFER_DESC viewProjectionConstantBufferDesc(sizeof(CubeShader::ViewProjectionConstantBuffer),
                                                                       D3D11_BIND_CONSTANT_BUFFER);
             CHECK_HRCMD(m_device->CreateBuffer(&viewProjectionConstantBufferDesc, nullptr, m_viewProjectionCBuffer.put()));
 
-            const CD3D11_BUFFER_DESC colorFilterConstantBufferDesc(sizeof(CubeShader::ColorFilterConstantBuffer),
-                                                                   D3D11_BIND_CONSTANT_BUFFER);
-            CHECK_HRCMD(m_device->CreateBuffer(&colorFilterConstantBufferDesc, nullptr, m_colorFilterCBuffer.put()));
-
             const D3D11_SUBRESOURCE_DATA vertexBufferData{CubeShader::c_cubeVertices};
             const CD3D11_BUFFER_DESC vertexBufferDesc(sizeof(CubeShader::c_cubeVertices), D3D11_BIND_VERTEX_BUFFER);
             CHECK_HRCMD(m_device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_cubeVertexBuffer.put()));
@@ -190,6 +232,36 @@ namespace {
             CHECK_HRCMD(m_device->CreateDepthStencilState(&depthStencilDesc, m_reversedZDepthNoStencilTest.put()));
         }
 
+        // Uploads the instances of all cubes, growing the instance buffer if it is too small.
+        void UpdateInstanceBuffer(const std::vector<sample::CubeInstance>& instances) {
+            if (instances.size() > m_instanceCapacity) {
+                uint32_t capacity = std::max(m_instanceCapacity, CubeShader::MinInstanceCapacity);
+                while (capacity < instances.size()) {
+                    capacity *= 2;
+                }
+
+                const CD3D11_BUFFER_DESC instanceBufferDesc(capacity * sizeof(sample::CubeInstance),
+                                                            D3D11_BIND_SHADER_RESOURCE,
+                                                            D3D11_USAGE_DYNAMIC,
+                                                            D3D11_CPU_ACCESS_WRITE,
+                                                            D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+                                                            sizeof(sample::CubeInstance));
+                m_instanceBuffer = nullptr;
+                m_instanceBufferView = nullptr;
+                CHECK_HRCMD(m_device->CreateBuffer(&instanceBufferDesc, nullptr, m_instanceBuffer.put()));
+
+                const CD3D11_SHADER_RESOURCE_VIEW_DESC instanceBufferViewDesc(m_instanceBuffer.get(), DXGI_FORMAT_UNKNOWN, 0, capacity);
+                CHECK_HRCMD(
+                    m_device->CreateShaderResourceView(m_instanceBuffer.get(), &instanceBufferViewDesc, m_instanceBufferView.put()));
+                m_instanceCapacity = capacity;
+            }
+
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            CHECK_HRCMD(m_deviceContext->Map(m_instanceBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+            memcpy(mapped.pData, instances.data(), instances.size() * sizeof(sample::CubeInstance));
+            m_deviceContext->Unmap(m_instanceBuffer.get(), 0);
+        }
+
         const std::vector<DXGI_FORMAT>& SupportedColorFormats() const override {
             const static std::vector<DXGI_FORMAT> SupportedColorFormats = {
                 DXGI_FORMAT_R8G8B8A8_UNORM,
@@ -210,6 +282,25 @@ namespace {
             return SupportedDepthFormats;
         }
 
+        void OnSwapchainImagesCreated(DXGI_FORMAT format, bool isDepth, const std::vector<ID3D11Texture2D*>& textures) override {
+            // Create the views used by RenderView, so that no views are created while rendering.
+            for (ID3D11Texture2D* texture : textures) {
+                if (isDepth) {
+                    m_depthStencilViews.Get({texture, (uint32_t)format});
+                } else {
+                    m_renderTargetViews.Get({texture, (uint32_t)format});
+                }
+            }
+        }
+
+        void OnSwapchainImagesDestroyed(const std::vector<ID3D11Texture2D*>& textures) override {
+            auto isDestroyed = [&](const TextureViewKey& key) {
+                return std::find(textures.begin(), textures.end(), key.Texture) != textures.end();
+            };
+            m_renderTargetViews.Invalidate(isDestroyed);
+            m_depthStencilViews.Invalidate(isDestroyed);
+        }
+
         void RenderView(const XrRect2Di& imageRect,
                         const float renderTargetClearColor[4],
                         const std::vector<xr::math::ViewProjection>& viewProjections,
@@ -226,15 +317,11 @@ namespace {
                 (float)imageRect.offset.x, (float)imageRect.offset.y, (float)imageRect.extent.width, (float)imageRect.extent.height);
             m_deviceContext->RSSetViewports(1, &viewport);
 
-            // Create RenderTargetView with the original swapchain format (swapchain image is typeless).
-            winrt::com_ptr<ID3D11RenderTargetView> renderTargetView;
-            const CD3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc(D3D11_RTV_DIMENSION_TEXTURE2DARRAY, colorSwapchainFormat);
-            CHECK_HRCMD(m_device->CreateRenderTargetView(colorTexture, &renderTargetViewDesc, renderTargetView.put()));
-
-            // Create a DepthStencilView with the original swapchain format (swapchain image is typeless)
-            winrt::com_ptr<ID3D11DepthStencilView> depthStencilView;
-            CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(D3D11_DSV_DIMENSION_TEXTURE2DARRAY, depthSwapchainFormat);
-            CHECK_HRCMD(m_device->CreateDepthStencilView(depthTexture, &depthStencilViewDesc, depthStencilView.put()));
+            // Use views with the original swapchain format (swapchain image is typeless), created with the swapchain.
+            const winrt::com_ptr<ID3D11RenderTargetView>& renderTargetView =
+                m_renderTargetViews.Get({colorTexture, (uint32_t)colorSwapchainFormat});
+            const winrt::com_ptr<ID3D11DepthStencilView>& depthStencilView =
+                m_depthStencilViews.Get({depthTexture, (uint32_t)depthSwapchainFormat});
 
             const bool reversedZ = viewProjections[0].NearFar.Near > viewProjections[0].NearFar.Far;
             const float depthClearValue = reversedZ ? 0.f : 1.f;
@@ -247,15 +334,28 @@ namespace {
             ID3D11RenderTargetView* renderTargets[] = {renderTargetView.get()};
             m_deviceContext->OMSetRenderTargets((UINT)std::size(renderTargets), renderTargets, depthStencilView.get());
 
-            ID3D11Buffer* const vsConstantBuffers[] = {m_modelCBuffer.get(), m_viewProjectionCBuffer.get()};
+            if (cubes.empty()) {
+                return;
+            }
+
+            // Pack the model transforms and color filters of all cubes into the instance buffer.
+            m_cubeInstanceBatch.Clear();
+            for (const sample::Cube* cube : cubes) {
+                m_cubeInstanceBatch.Add(cube->PoseInAppSpace, cube->Scale, cube->colorFilter);
+            }
+            m_cubeInstanceBatch.Pack(m_cubeInstances);
+            UpdateInstanceBuffer(m_cubeInstances);
+
+            ID3D11Buffer* const vsConstantBuffers[] = {m_viewProjectionCBuffer.get()};
             m_deviceContext->VSSetConstantBuffers(0, (UINT)std::size(vsConstantBuffers), vsConstantBuffers);
+            ID3D11ShaderResourceView* const vsShaderResources[] = {m_instanceBufferView.get()};
+            m_deviceContext->VSSetShaderResources(0, (UINT)std::size(vsShaderResources), vsShaderResources);
             m_deviceContext->VSSetShader(m_vertexShader.get(), nullptr, 0);
 
-            ID3D11Buffer* const psConstantBuffers[] = {m_colorFilterCBuffer.get()};
-            m_deviceContext->PSSetConstantBuffers(0, (UINT)std::size(psConstantBuffers), psConstantBuffers);
             m_deviceContext->PSSetShader(m_pixelShader.get(), nullptr, 0);
 
             CubeShader::ViewProjectionConstantBuffer viewProjectionCBufferData{};
+            viewProjectionCBufferData.ViewInstanceCount = viewInstanceCount;
 
             for (uint32_t k = 0; k < viewInstanceCount; k++) {
                 const DirectX::XMMATRIX spaceToView = xr::math::LoadInvertedXrPose(viewProjections[k].Pose);
@@ -276,27 +376,14 @@ namespace {
             m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
             m_deviceContext->IASetInputLayout(m_inputLayout.get());
 
-            // Render each cube
-            for (const sample::Cube* cube : cubes) {
-                // Compute and update the model transform for each cube, transpose for shader usage.
-                CubeShader::ModelConstantBuffer model;
-                const DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(cube->Scale.x, cube->Scale.y, cube->Scale.z);
-                DirectX::XMStoreFloat4x4(&model.Model,
-                                         DirectX::XMMatrixTranspose(scaleMatrix * xr::math::LoadXrPose(cube->PoseInAppSpace)));
-                m_deviceContext->UpdateSubresource(m_modelCBuffer.get(), 0, nullptr, &model, 0, 0);
-
-                CubeShader::ColorFilterConstantBuffer color;
-                color.colorFilter = DirectX::XMFLOAT4(cube->colorFilter.x, cube->colorFilter.y, cube->colorFilter.z, 1.0f);
-                m_deviceContext->UpdateSubresource(m_colorFilterCBuffer.get(), 0, nullptr, &color, 0, 0);
-
-                // Draw the cube.
-                m_deviceContext->DrawIndexedInstanced((UINT)std::size(CubeShader::c_cubeIndices), viewInstanceCount, 0, 0, 0);
-            }
+            // Draw all cubes, with one instance per cube and view.
+            m_deviceContext->DrawIndexedInstanced(
+                (UINT)std::size(CubeShader::c_cubeIndices), viewInstanceCount * (UINT)cubes.size(), 0, 0, 0);
         }
 
         void ClearView(ID3D11Texture2D* colorTexture, const float renderTargetClearColor[4]) override {
-            winrt::com_ptr<ID3D11RenderTargetView> renderTargetView;
-            CHECK_HRCMD(m_device->CreateRenderTargetView(colorTexture, nullptr, renderTargetView.put()));
+            const winrt::com_ptr<ID3D11RenderTargetView>& renderTargetView =
+                m_renderTargetViews.Get({colorTexture, (uint32_t)DXGI_FORMAT_UNKNOWN});
             m_deviceContext->ClearRenderTargetView(renderTargetView.get(), renderTargetClearColor);
         }
 
@@ -306,12 +393,24 @@ namespace {
         winrt::com_ptr<ID3D11VertexShader> m_vertexShader;
         winrt::com_ptr<ID3D11PixelShader> m_pixelShader;
         winrt::com_ptr<ID3D11InputLayout> m_inputLayout;
-        winrt::com_ptr<ID3D11Buffer> m_modelCBuffer;
         winrt::com_ptr<ID3D11Buffer> m_viewProjectionCBuffer;
-        winrt::com_ptr<ID3D11Buffer> m_colorFilterCBuffer;
+        winrt::com_ptr<ID3D11Buffer> m_instanceBuffer;
+        winrt::com_ptr<ID3D11ShaderResourceView> m_instanceBufferView;
+        uint32_t m_instanceCapacity{0};
         winrt::com_ptr<ID3D11Buffer> m_cubeVertexBuffer;
         winrt::com_ptr<ID3D11Buffer> m_cubeIndexBuffer;
         winrt::com_ptr<ID3D11DepthStencilState> m_reversedZDepthNoStencilTest;
+
+        RenderTargetViewFactory m_renderTargetViewFactory;
+        DepthStencilViewFactory m_depthStencilViewFactory;
+        sample::ViewCache<TextureViewKey, winrt::com_ptr<ID3D11RenderTargetView>, TextureViewKey::Hash> m_renderTargetViews{
+            m_renderTargetViewFactory, MaxCachedViewCount};
+        sample::ViewCache<TextureViewKey, winrt::com_ptr<ID3D11DepthStencilView>, TextureViewKey::Hash> m_depthStencilViews{
+            m_depthStencilViewFactory, MaxCachedViewCount};
+
+        // Per frame storage of RenderView, retained to avoid per frame allocations.
+        sample::CubeInstanceBatch m_cubeInstanceBatch;
+        std::vector<sample::CubeInstance> m_cubeInstances;
     };
 } // namespace
 
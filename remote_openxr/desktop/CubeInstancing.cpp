@@ -0,0 +1,51 @@
+//*********************************************************
+//    Copyright (c) Microsoft. All rights reserved.
+//
+//    Apache 2.0 License
+//
+//    You may obtain a copy of the License at
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+//    implied. See the License for the specific language governing
+//    permissions and limitations under the License.
+//
+//*********************************************************
+
+#include "CubeInstancing.h"
+
+#include <cstddef>
+
+namespace sample {
+    void CubeInstanceBatch::Clear() {
+        m_poses.Clear();
+        m_scales.Clear();
+        m_colorFilters.clear();
+    }
+
+    void CubeInstanceBatch::Add(const XrPosef& pose, const XrVector3f& scale, const XrVector3f& colorFilter) {
+        m_poses.Add(pose);
+        m_scales.Add(scale);
+        m_colorFilters.push_back(colorFilter);
+    }
+
+    void CubeInstanceBatch::Pack(std::vector<CubeInstance>& instances) const {
+        instances.resize(Size());
+        if (instances.empty()) {
+            return;
+        }
+
+        constexpr size_t stride = sizeof(CubeInstance) / sizeof(float);
+        xr::math::Batch::StoreTransposedMatrices(m_poses, m_scales, reinterpret_cast<float*>(instances.data()), stride);
+
+        for (size_t i = 0; i < instances.size(); i++) {
+            const XrVector3f& colorFilter = m_colorFilters[i];
+            instances[i].ColorFilter[0] = colorFilter.x;
+            instances[i].ColorFilter[1] = colorFilter.y;
+            instances[i].ColorFilter[2] = colorFilter.z;
+            instances[i].ColorFilter[3] = 1.0f;
+        }
+    }
+} // namespace sample
@@ -0,0 +1,50 @@
+//*********************************************************
+//    Copyright (c) Microsoft. All rights reserved.
+//
+//    Apache 2.0 License
+//
+//    You may obtain a copy of the License at
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+//    implied. See the License for the specific language governing
+//    permissions and limitations under the License.
+//
+//*********************************************************
+
+#pragma once
+
+#include <XrUtility/XrPoseBatch.h>
+
+#include <vector>
+
+namespace sample {
+    // Per-instance data of one cube, laid out like CubeInstance in the structured buffer of the cube shader.
+    struct CubeInstance {
+        float Model[16]; // Transposed model matrix including the scale, for the column_major matrix of the shader.
+        float ColorFilter[4];
+    };
+    static_assert(sizeof(CubeInstance) == 80, "CubeInstance must match the structured buffer layout");
+
+    // Collects the visible cubes of a frame and packs them into the instance data of one instanced draw. Does not depend on
+    // Direct3D, so that the packing can be used (and benchmarked) on any platform. The storage is retained between frames.
+    class CubeInstanceBatch {
+    public:
+        void Clear();
+        void Add(const XrPosef& pose, const XrVector3f& scale, const XrVector3f& colorFilter);
+
+        size_t Size() const {
+            return m_poses.Size();
+        }
+
+        // Resizes instances to Size() and stores the model matrices and color filters of the cubes in the order they were added.
+        void Pack(std::vector<CubeInstance>& instances) const;
+
+    private:
+        xr::math::PoseBatch m_poses;
+        xr::math::PointBatch m_scales;
+        std::vector<XrVector3f> m_colorFilters;
+    };
+} // namespace sample
@@ -0,0 +1,173 @@
+//*********************************************************
+//    Copyright (c) Microsoft. All rights reserved.
+//
+//    Apache 2.0 License
+//
+//    You may obtain a copy of the License at
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+//    implied. See the License for the specific language governing
+//    permissions and limitations under the License.
+//
+//*********************************************************
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <utility>
+
+namespace sample {
+    // Hands frame packets from one producer (simulation) thread to one consumer (render) thread through two packet slots,
+    // so that the producer fills the packet of frame N + 1 while the consumer renders frame N. Every packet is consumed in
+    // order, none is dropped: each waited OpenXR frame must be begun and ended. The positions are atomic counters, a blocked
+    // side waits on the counter of the other side (std::atomic::wait) instead of holding a lock.
+    template <typename TPacket>
+    class FramePacketExchange {
+    public:
+        static constexpr uint64_t SlotCount = 2;
+
+        FramePacketExchange() = default;
+        FramePacketExchange(const FramePacketExchange&) = delete;
+        FramePacketExchange& operator=(const FramePacketExchange&) = delete;
+
+        // Producer: returns the packet to fill next, waiting while both slots hold packets the consumer has not finished.
+        // The slot keeps the contents of the packet it held two frames before, so that its storage can be reused.
+        TPacket& BeginWrite() {
+            const uint64_t written = m_written.load(std::memory_order_relaxed) >> 1;
+            uint64_t read = m_read.load(std::memory_order_acquire);
+            while (written - read >= SlotCount) {
+                m_read.wait(read, std::memory_order_acquire);
+                read = m_read.load(std::memory_order_acquire);
+            }
+            return m_slots[written % SlotCount];
+        }
+
+        // Producer: publishes the packet returned by BeginWrite.
+        void EndWrite() {
+            m_written.fetch_add(2, std::memory_order_release);
+            m_written.notify_one();
+        }
+
+        // Producer: no packets follow. The consumer still receives the packets published before.
+        void Close() {
+            m_written.fetch_or(ClosedFlag, std::memory_order_release);
+            m_written.notify_one();
+        }
+
+        // Consumer: returns the next packet, waiting until it is published, or nullptr once closed and all packets are consumed.
+        TPacket* BeginRead() {
+            const uint64_t read = m_read.load(std::memory_order_relaxed);
+            uint64_t written = m_written.load(std::memory_order_acquire);
+            while ((written >> 1) == read) {
+                if (written & ClosedFlag) {
+                    return nullptr;
+                }
+                m_written.wait(written, std::memory_order_acquire);
+                written = m_written.load(std::memory_order_acquire);
+            }
+            return &m_slots[read % SlotCount];
+        }
+
+        // Consumer: hands the packet returned by BeginRead back to the producer.
+        void EndRead() {
+            m_read.fetch_add(1, std::memory_order_release);
+            m_read.notify_one();
+        }
+
+        // Reopens a closed exchange. Neither side may use the exchange concurrently.
+        void Reset() {
+            m_written.store(0, std::memory_order_relaxed);
+            m_read.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr uint64_t ClosedFlag = 1;
+
+        std::array<TPacket, SlotCount> m_slots{};
+        std::atomic<uint64_t> m_written{0}; // Published packets << 1 | ClosedFlag
+        std::atomic<uint64_t> m_read{0};    // Packets finished by the consumer
+    };
+
+    // Runs the render stage of a two stage frame loop on its own thread. The calling thread is the simulation stage: it fills
+    // the packet of the next frame between BeginFrame and SubmitFrame while the render thread calls render for the frames
+    // submitted before. An exception thrown by render is rethrown by the following BeginFrame, the frames submitted after it
+    // are not rendered.
+    template <typename TPacket>
+    class FramePipeline {
+    public:
+        using RenderCallback = std::function<void(TPacket& packet)>;
+
+        explicit FramePipeline(RenderCallback render)
+            : m_render(std::move(render)) {
+        }
+
+        ~FramePipeline() {
+            Stop();
+        }
+
+        FramePipeline(const FramePipeline&) = delete;
+        FramePipeline& operator=(const FramePipeline&) = delete;
+
+        bool IsRunning() const {
+            return m_renderThread.joinable();
+        }
+
+        // Starts the render thread, if it is not running.
+        void Start() {
+            if (!IsRunning()) {
+                m_exchange.Reset();
+                m_exception = nullptr;
+                m_failed.store(false, std::memory_order_relaxed);
+                m_renderThread = std::thread([this] {
+                    while (TPacket* packet = m_exchange.BeginRead()) {
+                        if (!m_failed.load(std::memory_order_relaxed)) {
+                            try {
+                                m_render(*packet);
+                            } catch (...) {
+                                m_exception = std::current_exception();
+                                m_failed.store(true, std::memory_order_release);
+                            }
+                        }
+                        m_exchange.EndRead();
+                    }
+                });
+            }
+        }
+
+        // Returns the packet of the next frame, waiting while the render thread is two frames behind. Until SubmitFrame,
+        // BeginFrame returns the same packet again.
+        TPacket& BeginFrame() {
+            if (m_failed.load(std::memory_order_acquire)) {
+                std::rethrow_exception(m_exception);
+            }
+            return m_exchange.BeginWrite();
+        }
+
+        void SubmitFrame() {
+            m_exchange.EndWrite();
+        }
+
+        // Renders the submitted frames and stops the render thread.
+        void Stop() {
+            if (IsRunning()) {
+                m_exchange.Close();
+                m_renderThread.join();
+            }
+        }
+
+    private:
+        RenderCallback m_render;
+        FramePacketExchange<TPacket> m_exchange;
+        std::exception_ptr m_exception; // Written by the render thread before m_failed is set.
+        std::atomic<bool> m_failed{false};
+        std::thread m_renderThread;
+    };
+} // namespace sample
@@ -17,7 +17,11 @@
 #include "pch.h"
 
 #include <OpenXrProgram.h>
+#include <DataChannelScheduler.h>
 #include <DxUtility.h>
+#include <FramePipeline.h>
+#include <FrameProfiler.h>
+#include <FrameTrace.h>
 #include <SecureConnectionCallbacks.h>
 
 #include <fstream>
@@ -50,6 +54,16 @@ namespace {
                                           m_options.subjectName,
                                           m_options.certificateStore,
                                           m_options.listen) {
+            if (!m_options.traceFile.empty() && !m_frameTrace.Open(m_options.traceFile)) {
+                DEBUG_PRINT("Failed to create the frame trace %s", m_options.traceFile.c_str());
+            }
+
+            if (!m_options.profileFile.empty()) {
+                FRAME_PROFILER_THREAD_NAME("Main");
+                if (!FrameProfiler::Start(std::filesystem::path(m_options.profileFile))) {
+                    DEBUG_PRINT("Failed to create the frame profile %s", m_options.profileFile.c_str());
+                }
+            }
         }
 
         void Run() override {
@@ -84,20 +98,27 @@ namespace {
                     }
 
                     if (m_sessionRunning) {
+                        m_framePipeline.Start();
+
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
                         auto timeDelta = std::chrono::high_resolution_clock::now() - m_customDataChannelSendTime;
                         if (timeDelta > std::chrono::seconds(5)) {
                             m_customDataChannelSendTime = std::chrono::high_resolution_clock::now();
 
                             if (!m_userDataChannelDestroyed && m_usingRemotingRuntime) {
-                                SendPingViaUserDataChannel(m_userDataChannel);
+                                m_userDataChannelBatcher.AddMessage(DataChannel::MessageType::Ping, std::chrono::steady_clock::now());
                             }
                         }
+
+                        // Queue the batched messages whose latency budget is spent, and send what the channel can take.
+                        if (!m_userDataChannelDestroyed && m_usingRemotingRuntime && m_userDataChannel != XR_NULL_HANDLE) {
+                            ServiceUserDataChannel();
+                        }
 #endif
 
                         try {
                             PollActions();
-                            RenderFrame();
+                            SimulateFrame();
                         } catch (const std::logic_error& ex) {
                             DEBUG_PRINT("Render Loop Exception: %s\n", ex.what());
                         }
@@ -108,10 +129,14 @@ namespace {
                     }
                 }
 
+                m_framePipeline.Stop();
+
                 if (requestRestart) {
                     PrepareSessionRestart();
                 }
             } while (requestRestart);
+
+            FrameProfiler::Stop();
         }
 
     private:
@@ -128,33 +153,53 @@ namespace {
 
         void DestroyUserDataChannel(XrRemotingDataChannelMSFT channelHandle) {
             CHECK_XRCMD(xrDestroyRemotingDataChannelMSFT(channelHandle));
+            m_userDataChannelBatcher.Clear();
+            m_userDataChannelScheduler.Clear();
         }
 
-        template <size_t N>
-        void SendDataViaUserDataChannel(XrRemotingDataChannelMSFT channelHandle, const std::array<uint8_t, N>& data) {
+        void ServiceUserDataChannel() {
             XrRemotingDataChannelStateMSFT channelState{static_cast<XrStructureType>(XR_TYPE_REMOTING_DATA_CHANNEL_STATE_MSFT)};
-            CHECK_XRCMD(xrGetRemotingDataChannelStateMSFT(channelHandle, &channelState));
+            CHECK_XRCMD(xrGetRemotingDataChannelStateMSFT(m_userDataChannel, &channelState));
+            if (channelState.connectionStatus != XR_REMOTING_DATA_CHANNEL_STATUS_OPENED_MSFT) {
+                return;
+            }
 
-            if (channelState.connectionStatus == XR_REMOTING_DATA_CHANNEL_STATUS_OPENED_MSFT) {
-                // Only send the packet if the send queue is smaller than 1MiB
-                if (channelState.sendQueueSize >= 1 * 1024 * 1024) {
-                    return;
+            // The send queue size is the size of the data which has not been sent yet, in bytes. The scheduler keeps it short, so
+            // that the channel does not queue more data than it actually sends.
+            const auto now = std::chrono::steady_clock::now();
+            m_userDataChannelBatcher.Poll(now);
+            m_userDataChannelScheduler.Service(now, channelState.sendQueueSize);
+        }
+
+        // Sends the packets of m_userDataChannelScheduler over the user data channel.
+        class UserDataChannelTransport : public DataChannel::IPacketTransport {
+        public:
+            explicit UserDataChannelTransport(const XrRemotingDataChannelMSFT& channelHandle)
+                : m_channelHandle(channelHandle) {
+            }
+
+            bool SendPacket(std::span<const uint8_t> packet, bool guaranteedDelivery) override {
+                XrRemotingDataChannelStateMSFT channelState{static_cast<XrStructureType>(XR_TYPE_REMOTING_DATA_CHANNEL_STATE_MSFT)};
+                CHECK_XRCMD(xrGetRemotingDataChannelStateMSFT(m_channelHandle, &channelState));
+
+                if (channelState.connectionStatus != XR_REMOTING_DATA_CHANNEL_STATUS_OPENED_MSFT) {
+                    return false;
                 }
 
                 DEBUG_PRINT("Holographic Remoting: SendDataViaUserDataChannel.");
 
                 XrRemotingDataChannelSendDataInfoMSFT sendInfo{
                     static_cast<XrStructureType>(XR_TYPE_REMOTING_DATA_CHANNEL_SEND_DATA_INFO_MSFT)};
-                sendInfo.data = data.data();
-                sendInfo.size = static_cast<uint32_t>(data.size());
-                sendInfo.guaranteedDelivery = true;
-                CHECK_XRCMD(xrSendRemotingDataMSFT(channelHandle, &sendInfo));
+                sendInfo.data = packet.data();
+                sendInfo.size = static_cast<uint32_t>(packet.size());
+                sendInfo.guaranteedDelivery = guaranteedDelivery;
+                CHECK_XRCMD(xrSendRemotingDataMSFT(m_channelHandle, &sendInfo));
+                return true;
             }
-        }
 
-        void SendPingViaUserDataChannel(XrRemotingDataChannelMSFT channelHandle) {
-            SendDataViaUserDataChannel(channelHandle, std::array<uint8_t, 1>{1});
-        }
+        private:
+            const XrRemotingDataChannelMSFT& m_channelHandle;
+        };
 
 #endif
         bool EnableRemotingXR() {
@@ -360,6 +405,12 @@ namespace {
                     XrRemotingRemoteContextPropertiesMSFT{static_cast<XrStructureType>(XR_TYPE_REMOTING_REMOTE_CONTEXT_PROPERTIES_MSFT)};
                 contextProperties.enableAudio = false;
                 contextProperties.maxBitrateKbps = 20000;
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+                // Use the bitrate the player reported for its link during the last connection, within the default maximum.
+                if (m_bitrateTargetKbps > 0) {
+                    contextProperties.maxBitrateKbps = std::min(contextProperties.maxBitrateKbps, m_bitrateTargetKbps);
+                }
+#endif
                 contextProperties.videoCodec = XR_REMOTING_VIDEO_CODEC_H265_MSFT;
 
                 contextProperties.depthBufferStreamResolution = XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_HALF_MSFT;
@@ -668,9 +719,20 @@ namespace {
                                                    &chainLength,
                                                    reinterpret_cast<XrSwapchainImageBaseHeader*>(swapchain.Images.data())));
 
+            const bool isDepth = (usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0;
+            m_graphicsPlugin->OnSwapchainImagesCreated(format, isDepth, GetSwapchainTextures(swapchain));
+
             return swapchain;
         }
 
+        static std::vector<ID3D11Texture2D*> GetSwapchainTextures(const SwapchainD3D11& swapchain) {
+            std::vector<ID3D11Texture2D*> textures;
+            for (const XrSwapchainImageD3D11KHR& image : swapchain.Images) {
+                textures.push_back(image.texture);
+            }
+            return textures;
+        }
+
         void HandleRecognizedSpeechText(const std::string& text) {
             if (text == "Red") {
                 m_cubeColorFilter = {1.0f, 0.0f, 0.0f};
@@ -724,6 +786,7 @@ namespace {
                     }
                     case XR_SESSION_STATE_STOPPING: {
                         m_sessionRunning = false;
+                        m_framePipeline.Stop(); // Ends the frames already waited before ending the session.
                         CHECK_XRCMD(xrEndSession(m_session.Get()));
                         break;
                     }
@@ -795,7 +858,19 @@ namespace {
                                                            static_cast<uint32_t>(packet.size()),
                                                            &dataBytesCount,
                                                            packet.data()));
-                    DEBUG_PRINT("Holographic Remoting: Custom data channel data received: %d", static_cast<uint32_t>(packet[0]));
+
+                    DataChannel::PacketReader reader({packet.data(), dataBytesCount});
+                    DataChannel::MessageView message;
+                    while (reader.Next(message) == DataChannel::ReadStatus::Ok) {
+                        DEBUG_PRINT("Holographic Remoting: Custom data channel message received: %d", static_cast<uint32_t>(message.type));
+                        if (message.type == DataChannel::MessageType::BitrateTarget) {
+                            DataChannel::PayloadReader payloadReader(message.payload);
+                            uint32_t targetKbps = 0;
+                            if (payloadReader.Read(targetKbps) && targetKbps > 0) {
+                                m_bitrateTargetKbps = targetKbps;
+                            }
+                        }
+                    }
 
                     break;
                 }
@@ -940,15 +1015,48 @@ namespace {
             }
         }
 
-        void RenderFrame() {
+        struct FramePacket;
+
+        // Simulation stage of the frame loop: waits for the next frame and locates the holograms at its predicted display time,
+        // while the render thread still renders the previous frame.
+        void SimulateFrame() {
             CHECK(m_session.Get() != XR_NULL_HANDLE);
 
+            FramePacket& packet = m_framePipeline.BeginFrame();
+
             XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
-            XrFrameState frameState{XR_TYPE_FRAME_STATE};
-            CHECK_XRCMD(xrWaitFrame(m_session.Get(), &frameWaitInfo, &frameState));
+            packet.FrameState = {XR_TYPE_FRAME_STATE};
+            {
+                FRAME_PROFILER_SCOPE("xrWaitFrame");
+                CHECK_XRCMD(xrWaitFrame(m_session.Get(), &frameWaitInfo, &packet.FrameState));
+            }
+
+            FRAME_PROFILER_SCOPE("UpdateVisibleCubes");
+
+            // Every waited frame must be begun and ended, so the frame is submitted even if updating the holograms fails.
+            try {
+                packet.VisibleCubes.clear();
+                if (packet.FrameState.shouldRender) {
+                    UpdateVisibleCubes(packet.FrameState.predictedDisplayTime, packet.VisibleCubes);
+                }
+            } catch (...) {
+                packet.VisibleCubes.clear();
+                m_framePipeline.SubmitFrame();
+                throw;
+            }
+            m_framePipeline.SubmitFrame();
+        }
+
+        // Render stage of the frame loop, called on the render thread of m_framePipeline.
+        void RenderFrame(const FramePacket& packet) {
+            FRAME_PROFILER_SCOPE("RenderFrame");
+            const XrFrameState& frameState = packet.FrameState;
 
             XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
-            CHECK_XRCMD(xrBeginFrame(m_session.Get(), &frameBeginInfo));
+            {
+                FRAME_PROFILER_SCOPE("xrBeginFrame");
+                CHECK_XRCMD(xrBeginFrame(m_session.Get(), &frameBeginInfo));
+            }
 
             // xrEndFrame can submit multiple layers. This sample submits one.
             std::vector<XrCompositionLayerBaseHeader*> layers;
@@ -988,7 +1096,7 @@ namespace {
                 }
 
                 // Then, render projection layer into each view.
-                if (RenderLayer(frameState.predictedDisplayTime, layer)) {
+                if (RenderLayer(packet, layer)) {
                     layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&layer));
                 }
             }
@@ -1014,10 +1122,16 @@ namespace {
             frameEndInfo.next = &mirrorImageEndInfo;
 #endif
 
-            CHECK_XRCMD(xrEndFrame(m_session.Get(), &frameEndInfo));
+            {
+                FRAME_PROFILER_SCOPE("xrEndFrame");
+                CHECK_XRCMD(xrEndFrame(m_session.Get(), &frameEndInfo));
+            }
 
 #if (defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP))
-            m_window->PresentSwapchain();
+            {
+                FRAME_PROFILER_SCOPE("PresentSwapchain");
+                m_window->PresentSwapchain();
+            }
 #endif
         }
 
@@ -1107,15 +1221,14 @@ namespace {
             }
         }
 
-        bool RenderLayer(XrTime predictedDisplayTime, XrCompositionLayerProjection& layer) {
-            const uint32_t viewCount = (uint32_t)m_renderResources->ConfigViews.size();
-
-            if (!xr::math::Pose::IsPoseValid(m_renderResources->ViewState)) {
-                DEBUG_PRINT("xrLocateViews returned an invalid pose.");
-                return false; // Skip rendering layers if view location is invalid
-            }
+        // Locates the cubes at the predicted display time and copies the render state of the located ones to visibleCubes.
+        void UpdateVisibleCubes(XrTime predictedDisplayTime, std::vector<sample::Cube>& visibleCubes) {
+            m_locatedCubes.clear();
 
-            std::vector<const sample::Cube*> visibleCubes;
+            // Cubes posed relative to their space are multiplied with the located spaces in one batch below.
+            m_relativeCubes.clear();
+            m_relativeCubePosesInSpace.Clear();
+            m_relativeCubeSpacePoses.Clear();
 
             auto UpdateVisibleCube = [&](sample::Cube& cube) {
                 if (cube.Space.Get() != XR_NULL_HANDLE) {
@@ -1125,11 +1238,13 @@ namespace {
                     // Update cube's location with latest space location
                     if (xr::math::Pose::IsPoseValid(cubeSpaceInAppSpace)) {
                         if (cube.PoseInSpace.has_value()) {
-                            cube.PoseInAppSpace = xr::math::Pose::Multiply(cube.PoseInSpace.value(), cubeSpaceInAppSpace.pose);
+                            m_relativeCubes.push_back(&cube);
+                            m_relativeCubePosesInSpace.Add(cube.PoseInSpace.value());
+                            m_relativeCubeSpacePoses.Add(cubeSpaceInAppSpace.pose);
                         } else {
                             cube.PoseInAppSpace = cubeSpaceInAppSpace.pose;
                         }
-                        visibleCubes.push_back(&cube);
+                        m_locatedCubes.push_back(&cube);
                     }
 
                     // Update cube color
@@ -1146,6 +1261,78 @@ namespace {
                 UpdateVisibleCube(hologram.Cube);
             }
 
+            xr::math::Batch::Multiply(m_relativeCubePosesInSpace, m_relativeCubeSpacePoses, m_relativeCubePosesInSpace);
+            for (size_t i = 0; i < m_relativeCubes.size(); i++) {
+                m_relativeCubes[i]->PoseInAppSpace = m_relativeCubePosesInSpace.Get(i);
+            }
+
+            // The render thread gets copies, the cubes themselves are updated by the next frame meanwhile.
+            for (const sample::Cube* cube : m_locatedCubes) {
+                sample::Cube& visibleCube = visibleCubes.emplace_back();
+                visibleCube.Scale = cube->Scale;
+                visibleCube.colorFilter = cube->colorFilter;
+                visibleCube.PoseInAppSpace = cube->PoseInAppSpace;
+            }
+        }
+
+        // Appends the views and the visible cubes of a rendered frame to the frame trace. Called on the render thread.
+        void RecordFrameTrace(const FramePacket& packet, const std::vector<xr::math::ViewProjection>& viewProjections) {
+            using namespace FrameTrace;
+
+            const auto storePose = [](const XrPosef& xrPose, Pose& pose) {
+                pose = {{xrPose.position.x, xrPose.position.y, xrPose.position.z},
+                        {xrPose.orientation.x, xrPose.orientation.y, xrPose.orientation.z, xrPose.orientation.w}};
+            };
+
+            m_frameTraceViews.clear();
+            for (const xr::math::ViewProjection& viewProjection : viewProjections) {
+                ViewRecord& record = m_frameTraceViews.emplace_back();
+                storePose(viewProjection.Pose, record.pose);
+                DirectX::XMFLOAT4X4 matrix;
+                DirectX::XMStoreFloat4x4(&matrix,
+                                         xr::math::LoadInvertedXrPose(viewProjection.Pose) *
+                                             xr::math::ComposeProjectionMatrix(viewProjection.Fov, viewProjection.NearFar));
+                std::memcpy(record.viewProjection, &matrix, sizeof(record.viewProjection));
+            }
+
+            m_frameTraceHolograms.clear();
+            for (const sample::Cube& cube : packet.VisibleCubes) {
+                HologramRecord& record = m_frameTraceHolograms.emplace_back();
+                record.id = static_cast<uint32_t>(m_frameTraceHolograms.size() - 1);
+                storePose(cube.PoseInAppSpace, record.pose);
+                record.scale[0] = cube.Scale.x;
+                record.scale[1] = cube.Scale.y;
+                record.scale[2] = cube.Scale.z;
+                record.color[0] = cube.colorFilter.x;
+                record.color[1] = cube.colorFilter.y;
+                record.color[2] = cube.colorFilter.z;
+            }
+
+            // XrTime is in nanoseconds.
+            const std::chrono::microseconds timestamp(packet.FrameState.predictedDisplayTime / 1000);
+            const bool recorded =
+                m_frameTrace.Write(RecordType::FrameBegin, timestamp) &&
+                m_frameTrace.Write(RecordType::Views, timestamp, std::span<const ViewRecord>(m_frameTraceViews)) &&
+                m_frameTrace.Write(RecordType::Holograms, timestamp, std::span<const HologramRecord>(m_frameTraceHolograms));
+            if (!recorded) {
+                DEBUG_PRINT("Stopped recording the frame trace, the file could not grow.");
+            }
+        }
+
+        bool RenderLayer(const FramePacket& packet, XrCompositionLayerProjection& layer) {
+            FRAME_PROFILER_SCOPE("RenderLayer");
+            const uint32_t viewCount = (uint32_t)m_renderResources->ConfigViews.size();
+
+            if (!xr::math::Pose::IsPoseValid(m_renderResources->ViewState)) {
+                DEBUG_PRINT("xrLocateViews returned an invalid pose.");
+                return false; // Skip rendering layers if view location is invalid
+            }
+
+            std::vector<const sample::Cube*> visibleCubes;
+            for (const sample::Cube& cube : packet.VisibleCubes) {
+                visibleCubes.push_back(&cube);
+            }
+
             m_renderResources->ProjectionLayerViews.resize(viewCount);
             if (m_optionalExtensions.DepthExtensionSupported) {
                 m_renderResources->DepthInfoViews.resize(viewCount);
@@ -1190,6 +1377,10 @@ namespace {
                 }
             }
 
+            if (m_frameTrace.IsOpen()) {
+                RecordFrameTrace(packet, viewProjections);
+            }
+
             // For HoloLens additive display, best to clear render target with transparent black color (0,0,0,0)
             constexpr DirectX::XMVECTORF32 opaqueColor = {0.184313729f, 0.309803933f, 0.309803933f, 1.000000000f};
             constexpr DirectX::XMVECTORF32 transparent = {0.000000000f, 0.000000000f, 0.000000000f, 0.000000000f};
@@ -1218,6 +1409,10 @@ namespace {
         void PrepareSessionRestart() {
             m_mainCubeIndex = m_spinningCubeIndex = {};
             m_holograms.clear();
+            if (m_renderResources) {
+                m_graphicsPlugin->OnSwapchainImagesDestroyed(GetSwapchainTextures(m_renderResources->ColorSwapchain));
+                m_graphicsPlugin->OnSwapchainImagesDestroyed(GetSwapchainTextures(m_renderResources->DepthSwapchain));
+            }
             m_renderResources.reset();
             m_appSpace.Reset();
             m_cubesInHand[LeftSide].Space.Reset();
@@ -1354,6 +1549,18 @@ namespace {
         };
         std::vector<Hologram> m_holograms;
 
+        // Frame trace, open if requested with -trace. Only used on the render thread, the record vectors are kept to reuse their
+        // memory.
+        FrameTrace::TraceWriter m_frameTrace;
+        std::vector<FrameTrace::ViewRecord> m_frameTraceViews;
+        std::vector<FrameTrace::HologramRecord> m_frameTraceHolograms;
+
+        // Per frame storage of UpdateVisibleCubes, retained to avoid per frame allocations.
+        std::vector<sample::Cube*> m_locatedCubes;
+        std::vector<sample::Cube*> m_relativeCubes;
+        xr::math::PoseBatch m_relativeCubePosesInSpace;
+        xr::math::PoseBatch m_relativeCubeSpacePoses;
+
         std::optional<uint32_t> m_mainCubeIndex;
         std::optional<uint32_t> m_spinningCubeIndex;
         XrTime m_spinningCubeStartTime;
@@ -1407,6 +1614,16 @@ namespace {
         std::chrono::high_resolution_clock::time_point m_customDataChannelSendTime = std::chrono::high_resolution_clock::now();
         XrRemotingDataChannelMSFT m_userDataChannel = XR_NULL_HANDLE;
         bool m_userDataChannelDestroyed = false;
+        // The batcher coalesces the messages sent within its latency budget and queues its packets as interactive traffic in the
+        // scheduler, which paces them to what the channel drains. Both are serviced once per frame.
+        UserDataChannelTransport m_userDataChannelTransport{m_userDataChannel};
+        DataChannel::MessageScheduler m_userDataChannelScheduler{m_userDataChannelTransport, std::chrono::steady_clock::now()};
+        DataChannel::ScheduledTransport m_userDataChannelBatcherTransport{m_userDataChannelScheduler,
+                                                                          DataChannel::TrafficClass::Interactive};
+        DataChannel::MessageBatcher m_userDataChannelBatcher{m_userDataChannelBatcherTransport};
+        // Latest video bitrate in kbps the player asked for with a BitrateTarget message, 0 before the first one. Applied with the
+        // context properties before the next connection.
+        uint32_t m_bitrateTargetKbps = 0;
 #endif
         std::vector<uint8_t> m_grammarFileContent;
         std::vector<const char*> m_dictionaryEntries;
@@ -1414,6 +1631,28 @@ namespace {
         float m_rotationDirection = 1.0f;
 
         SecureConnectionCallbacks m_secureConnectionCallbacks;
+
+        // State of one frame, prepared by SimulateFrame and rendered by RenderFrame.
+        struct FramePacket {
+            XrFrameState FrameState{XR_TYPE_FRAME_STATE};
+            std::vector<sample::Cube> VisibleCubes;
+        };
+
+        // Declared last, so that the render thread is stopped before the members it uses are destroyed.
+        sample::FramePipeline<FramePacket> m_framePipeline{[this](FramePacket& packet) {
+            // The render thread is started again with every session, name it on its first frame.
+            static thread_local bool renderThreadNamed = false;
+            if (!renderThreadNamed) {
+                FRAME_PROFILER_THREAD_NAME("Render");
+                renderThreadNamed = true;
+            }
+
+            try {
+                RenderFrame(packet);
+            } catch (const std::logic_error& ex) {
+                DEBUG_PRINT("Render Loop Exception: %s\n", ex.what());
+            }
+        }};
     };
 } // namespace
 
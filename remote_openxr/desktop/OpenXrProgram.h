@@ -42,6 +42,11 @@ namespace sample {
         virtual const std::vector<DXGI_FORMAT>& SupportedColorFormats() const = 0;
         virtual const std::vector<DXGI_FORMAT>& SupportedDepthFormats() const = 0;
 
+        // Called after the images of a swapchain are enumerated and before the swapchain is destroyed, so that views of the
+        // swapchain textures can be created ahead of the first frame and released together with the swapchain.
+        virtual void OnSwapchainImagesCreated(DXGI_FORMAT format, bool isDepth, const std::vector<ID3D11Texture2D*>& textures) = 0;
+        virtual void OnSwapchainImagesDestroyed(const std::vector<ID3D11Texture2D*>& textures) = 0;
+
         // Render to swapchain images using stereo image array
         virtual void RenderView(const XrRect2Di& imageRect,
                                 const float renderTargetClearColor[4],
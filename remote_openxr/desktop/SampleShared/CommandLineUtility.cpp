@@ -136,6 +136,22 @@ namespace sample {
                     }
                     continue;
                 }
+
+                if (param == "trace") {
+                    if (numArgs > i + 1) {
+                        options.traceFile = argList[i + 1];
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "profile") {
+                    if (numArgs > i + 1) {
+                        options.profileFile = argList[i + 1];
+                        i++;
+                    }
+                    continue;
+                }
             }
 
             options.host = SplitHostnameAndPortString(arg, options.port);
@@ -28,6 +28,10 @@ namespace sample {
         std::string keyPassphrase;
         std::string subjectName;
         std::string authenticationRealm{"OpenXR Remoting"};
+        // Records the views and visible cubes of every rendered frame into this file if set, see FrameTrace.h.
+        std::string traceFile;
+        // Records the timing of the frame phases into this Chrome trace file if set, see FrameProfiler.h.
+        std::string profileFile;
     };
 
     void ParseCommandLine(sample::AppOptions& options);
@@ -0,0 +1,142 @@
+//*********************************************************
+//    Copyright (c) Microsoft. All rights reserved.
+//
+//    Apache 2.0 License
+//
+//    You may obtain a copy of the License at
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+//    implied. See the License for the specific language governing
+//    permissions and limitations under the License.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace sample {
+    // Identifies a view of a texture. Views of the whole texture array use AllArraySlices.
+    template <typename TTexture>
+    struct TextureViewKey {
+        static constexpr uint32_t AllArraySlices = UINT32_MAX;
+
+        TTexture* Texture{nullptr};
+        uint32_t Format{0};
+        uint32_t ArraySlice{AllArraySlices};
+
+        bool operator==(const TextureViewKey& other) const = default;
+
+        struct Hash {
+            size_t operator()(const TextureViewKey& key) const {
+                const uint64_t formatAndSlice = (uint64_t(key.Format) << 32 | key.ArraySlice) * 0x9E3779B97F4A7C15ull;
+                return std::hash<const void*>{}(key.Texture) ^ static_cast<size_t>(formatAndSlice ^ (formatAndSlice >> 32));
+            }
+        };
+    };
+
+    // Creates the views of a ViewCache, which keeps the graphics API out of the cache.
+    template <typename Key, typename View>
+    struct IViewFactory {
+        virtual ~IViewFactory() = default;
+        virtual View CreateView(const Key& key) = 0;
+    };
+
+    // Least recently used cache of views, so that views of the same textures are not created every frame. A view is released
+    // by destroying its View value (e.g. a winrt::com_ptr), when it is evicted to make room for a new one or invalidated.
+    template <typename Key, typename View, typename Hash = std::hash<Key>>
+    class ViewCache {
+    public:
+        struct Statistics {
+            uint64_t Hits{0};
+            uint64_t Misses{0};
+            uint64_t Evictions{0};
+            uint64_t Invalidations{0};
+        };
+
+        ViewCache(IViewFactory<Key, View>& factory, size_t capacity)
+            : m_factory(factory)
+            , m_capacity(capacity) {
+        }
+
+        ViewCache(const ViewCache&) = delete;
+        ViewCache& operator=(const ViewCache&) = delete;
+
+        // Returns the view of the key, creating it on a miss. The reference is valid until the view is evicted or invalidated.
+        const View& Get(const Key& key) {
+            if (auto it = m_index.find(key); it != m_index.end()) {
+                m_stats.Hits++;
+                m_entries.splice(m_entries.begin(), m_entries, it->second);
+                return it->second->second;
+            }
+
+            m_stats.Misses++;
+            View view = m_factory.CreateView(key);
+            if (m_entries.size() >= m_capacity && !m_entries.empty()) {
+                m_index.erase(m_entries.back().first);
+                m_entries.pop_back();
+                m_stats.Evictions++;
+            }
+
+            m_entries.emplace_front(key, std::move(view));
+            m_index.emplace(key, m_entries.begin());
+            return m_entries.front().second;
+        }
+
+        bool Contains(const Key& key) const {
+            return m_index.find(key) != m_index.end();
+        }
+
+        // Releases the views whose keys match the predicate, e.g. the views of the images of a destroyed swapchain.
+        template <typename Predicate>
+        size_t Invalidate(Predicate&& predicate) {
+            size_t count = 0;
+            for (auto it = m_entries.begin(); it != m_entries.end();) {
+                if (predicate(it->first)) {
+                    m_index.erase(it->first);
+                    it = m_entries.erase(it);
+                    count++;
+                } else {
+                    ++it;
+                }
+            }
+            m_stats.Invalidations += count;
+            return count;
+        }
+
+        void Clear() {
+            m_stats.Invalidations += m_entries.size();
+            m_index.clear();
+            m_entries.clear();
+        }
+
+        size_t Size() const {
+            return m_entries.size();
+        }
+
+        size_t Capacity() const {
+            return m_capacity;
+        }
+
+        const Statistics& GetStatistics() const {
+            return m_stats;
+        }
+
+    private:
+        using Entry = std::pair<Key, View>;
+
+        IViewFactory<Key, View>& m_factory;
+        const size_t m_capacity;
+        std::list<Entry> m_entries; // Most recently used first.
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> m_index;
+        Statistics m_stats;
+    };
+} // namespace sample
@@ -0,0 +1,626 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <openxr/openxr.h>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Batched versions of the pose functions in XrMath.h, for scenes with many located objects. Poses are stored in
+// structure-of-arrays form and processed four at a time with SSE2 or NEON, or with the scalar functions below on other
+// platforms. Does not depend on DirectXMath, so that it can be used (and benchmarked) on any platform.
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XR_POSE_BATCH_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define XR_POSE_BATCH_NEON
+#include <arm_neon.h>
+#endif
+
+namespace xr::math {
+    // Poses in structure-of-arrays form.
+    struct PoseBatch {
+        std::vector<float> PositionX, PositionY, PositionZ;
+        std::vector<float> OrientationX, OrientationY, OrientationZ, OrientationW;
+
+        size_t Size() const {
+            return PositionX.size();
+        }
+
+        void Resize(size_t size);
+        void Clear();
+        void Add(const XrPosef& pose);
+        void Set(size_t index, const XrPosef& pose);
+        XrPosef Get(size_t index) const;
+    };
+
+    // Points in structure-of-arrays form.
+    struct PointBatch {
+        std::vector<float> X, Y, Z;
+
+        size_t Size() const {
+            return X.size();
+        }
+
+        void Resize(size_t size);
+        void Clear();
+        void Add(const XrVector3f& point);
+        void Set(size_t index, const XrVector3f& point);
+        XrVector3f Get(size_t index) const;
+    };
+
+    namespace Batch {
+        // The results are equal to the ones of the functions in XrMath.h within float rounding, except for Slerp which
+        // approximates the trigonometric functions (to about 1e-6). The result may be one of the inputs.
+
+        // result[i] = Pose::Multiply(a[i], b[i])
+        void Multiply(const PoseBatch& a, const PoseBatch& b, PoseBatch& result);
+        // result[i] = Pose::Multiply(a[i], b), e.g. the poses of many objects relative to one located space.
+        void Multiply(const PoseBatch& a, const XrPosef& b, PoseBatch& result);
+        // result[i] = Pose::Invert(poses[i])
+        void Invert(const PoseBatch& poses, PoseBatch& result);
+        // result[i] = Pose::Slerp(a[i], b[i], alpha) for alpha in [0, 1]
+        void Slerp(const PoseBatch& a, const PoseBatch& b, float alpha, PoseBatch& result);
+        // result[i] = points[i] transformed by LoadXrPose(poses[i])
+        void TransformPoints(const PoseBatch& poses, const PointBatch& points, PointBatch& result);
+        // Stores LoadXrPose(poses[i]) as 16 row-major floats (the layout of DirectX::XMFLOAT4X4) at matrices + 16 * i.
+        void StoreMatrices(const PoseBatch& poses, float* matrices);
+        // Stores the transpose of XMMatrixScaling(scales[i]) * LoadXrPose(poses[i]) as 16 floats at matrices + stride * i,
+        // which is the layout of a column_major float4x4 in a shader buffer.
+        void StoreTransposedMatrices(const PoseBatch& poses, const PointBatch& scales, float* matrices, size_t stride);
+
+        // Name of the SIMD instruction set used by the batch functions.
+        const char* KernelName();
+
+        // The functions of XrMath.h for a single pose, without DirectXMath. Used for the poses which do not fill a SIMD
+        // register, and as reference for the batch functions.
+        namespace Scalar {
+            XrPosef Multiply(const XrPosef& a, const XrPosef& b);
+            XrPosef Invert(const XrPosef& pose);
+            XrPosef Slerp(const XrPosef& a, const XrPosef& b, float alpha);
+            XrVector3f TransformPoint(const XrPosef& pose, const XrVector3f& point);
+            void StoreMatrix(const XrPosef& pose, float* matrix);
+            void StoreTransposedMatrix(const XrPosef& pose, const XrVector3f& scale, float* matrix);
+        } // namespace Scalar
+    } // namespace Batch
+} // namespace xr::math
+
+namespace xr::math {
+    inline void PoseBatch::Resize(size_t size) {
+        for (std::vector<float>* component :
+             {&PositionX, &PositionY, &PositionZ, &OrientationX, &OrientationY, &OrientationZ, &OrientationW}) {
+            component->resize(size);
+        }
+    }
+
+    inline void PoseBatch::Clear() {
+        Resize(0);
+    }
+
+    inline void PoseBatch::Add(const XrPosef& pose) {
+        PositionX.push_back(pose.position.x);
+        PositionY.push_back(pose.position.y);
+        PositionZ.push_back(pose.position.z);
+        OrientationX.push_back(pose.orientation.x);
+        OrientationY.push_back(pose.orientation.y);
+        OrientationZ.push_back(pose.orientation.z);
+        OrientationW.push_back(pose.orientation.w);
+    }
+
+    inline void PoseBatch::Set(size_t index, const XrPosef& pose) {
+        PositionX[index] = pose.position.x;
+        PositionY[index] = pose.position.y;
+        PositionZ[index] = pose.position.z;
+        OrientationX[index] = pose.orientation.x;
+        OrientationY[index] = pose.orientation.y;
+        OrientationZ[index] = pose.orientation.z;
+        OrientationW[index] = pose.orientation.w;
+    }
+
+    inline XrPosef PoseBatch::Get(size_t index) const {
+        return {{OrientationX[index], OrientationY[index], OrientationZ[index], OrientationW[index]},
+                {PositionX[index], PositionY[index], PositionZ[index]}};
+    }
+
+    inline void PointBatch::Resize(size_t size) {
+        X.resize(size);
+        Y.resize(size);
+        Z.resize(size);
+    }
+
+    inline void PointBatch::Clear() {
+        Resize(0);
+    }
+
+    inline void PointBatch::Add(const XrVector3f& point) {
+        X.push_back(point.x);
+        Y.push_back(point.y);
+        Z.push_back(point.z);
+    }
+
+    inline void PointBatch::Set(size_t index, const XrVector3f& point) {
+        X[index] = point.x;
+        Y[index] = point.y;
+        Z[index] = point.z;
+    }
+
+    inline XrVector3f PointBatch::Get(size_t index) const {
+        return {X[index], Y[index], Z[index]};
+    }
+
+    namespace Batch::detail {
+        // Four lanes of floats and the operations used by the kernels, so that the kernels are written once for all
+        // instruction sets.
+#if defined(XR_POSE_BATCH_SSE2)
+        using Float4 = __m128;
+        using Mask4 = __m128;
+        constexpr const char* KernelName = "SSE2";
+
+        inline Float4 Load(const float* p) {
+            return _mm_loadu_ps(p);
+        }
+        inline void Store(float* p, Float4 v) {
+            _mm_storeu_ps(p, v);
+        }
+        inline Float4 Splat(float s) {
+            return _mm_set1_ps(s);
+        }
+        inline Float4 Add(Float4 a, Float4 b) {
+            return _mm_add_ps(a, b);
+        }
+        inline Float4 Sub(Float4 a, Float4 b) {
+            return _mm_sub_ps(a, b);
+        }
+        inline Float4 Mul(Float4 a, Float4 b) {
+            return _mm_mul_ps(a, b);
+        }
+        inline Float4 Div(Float4 a, Float4 b) {
+            return _mm_div_ps(a, b);
+        }
+        inline Float4 Sqrt(Float4 a) {
+            return _mm_sqrt_ps(a);
+        }
+        inline Mask4 Less(Float4 a, Float4 b) {
+            return _mm_cmplt_ps(a, b);
+        }
+        inline Float4 Select(Mask4 mask, Float4 ifTrue, Float4 ifFalse) {
+            return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+        }
+        inline void Transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3) {
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        }
+#elif defined(XR_POSE_BATCH_NEON)
+        using Float4 = float32x4_t;
+        using Mask4 = uint32x4_t;
+        constexpr const char* KernelName = "NEON";
+
+        inline Float4 Load(const float* p) {
+            return vld1q_f32(p);
+        }
+        inline void Store(float* p, Float4 v) {
+            vst1q_f32(p, v);
+        }
+        inline Float4 Splat(float s) {
+            return vdupq_n_f32(s);
+        }
+        inline Float4 Add(Float4 a, Float4 b) {
+            return vaddq_f32(a, b);
+        }
+        inline Float4 Sub(Float4 a, Float4 b) {
+            return vsubq_f32(a, b);
+        }
+        inline Float4 Mul(Float4 a, Float4 b) {
+            return vmulq_f32(a, b);
+        }
+        inline Float4 Div(Float4 a, Float4 b) {
+            return vdivq_f32(a, b);
+        }
+        inline Float4 Sqrt(Float4 a) {
+            return vsqrtq_f32(a);
+        }
+        inline Mask4 Less(Float4 a, Float4 b) {
+            return vcltq_f32(a, b);
+        }
+        inline Float4 Select(Mask4 mask, Float4 ifTrue, Float4 ifFalse) {
+            return vbslq_f32(mask, ifTrue, ifFalse);
+        }
+        inline void Transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3) {
+            const float32x4x2_t t01 = vtrnq_f32(r0, r1);
+            const float32x4x2_t t23 = vtrnq_f32(r2, r3);
+            r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+            r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+            r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+            r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+        }
+#else
+        constexpr const char* KernelName = "Scalar";
+#endif
+
+#if defined(XR_POSE_BATCH_SSE2) || defined(XR_POSE_BATCH_NEON)
+#define XR_POSE_BATCH_SIMD
+        constexpr size_t LaneCount = 4;
+
+        struct Vector3x4 {
+            Float4 X, Y, Z;
+        };
+
+        struct Quaternionx4 {
+            Float4 X, Y, Z, W;
+        };
+
+        inline Vector3x4 LoadPosition(const PoseBatch& poses, size_t i) {
+            return {Load(&poses.PositionX[i]), Load(&poses.PositionY[i]), Load(&poses.PositionZ[i])};
+        }
+
+        inline Quaternionx4 LoadOrientation(const PoseBatch& poses, size_t i) {
+            return {Load(&poses.OrientationX[i]), Load(&poses.OrientationY[i]), Load(&poses.OrientationZ[i]), Load(&poses.OrientationW[i])};
+        }
+
+        inline void StorePose(PoseBatch& poses, size_t i, const Quaternionx4& orientation, const Vector3x4& position) {
+            Store(&poses.PositionX[i], position.X);
+            Store(&poses.PositionY[i], position.Y);
+            Store(&poses.PositionZ[i], position.Z);
+            Store(&poses.OrientationX[i], orientation.X);
+            Store(&poses.OrientationY[i], orientation.Y);
+            Store(&poses.OrientationZ[i], orientation.Z);
+            Store(&poses.OrientationW[i], orientation.W);
+        }
+
+        // Hamilton product b * a, which is DirectX::XMQuaternionMultiply(a, b): rotation a followed by rotation b.
+        inline Quaternionx4 QuaternionMultiply(const Quaternionx4& a, const Quaternionx4& b) {
+            return {Sub(Add(Add(Mul(b.W, a.X), Mul(b.X, a.W)), Mul(b.Y, a.Z)), Mul(b.Z, a.Y)),
+                    Add(Add(Sub(Mul(b.W, a.Y), Mul(b.X, a.Z)), Mul(b.Y, a.W)), Mul(b.Z, a.X)),
+                    Add(Sub(Add(Mul(b.W, a.Z), Mul(b.X, a.Y)), Mul(b.Y, a.X)), Mul(b.Z, a.W)),
+                    Sub(Sub(Sub(Mul(b.W, a.W), Mul(b.X, a.X)), Mul(b.Y, a.Y)), Mul(b.Z, a.Z))};
+        }
+
+        inline Vector3x4 Cross(Float4 ax, Float4 ay, Float4 az, const Vector3x4& b) {
+            return {Sub(Mul(ay, b.Z), Mul(az, b.Y)), Sub(Mul(az, b.X), Mul(ax, b.Z)), Sub(Mul(ax, b.Y), Mul(ay, b.X))};
+        }
+
+        // DirectX::XMVector3Rotate(v, q) for a unit quaternion: v + w * t + cross(q.xyz, t) with t = 2 * cross(q.xyz, v).
+        inline Vector3x4 Rotate(const Vector3x4& v, const Quaternionx4& q) {
+            const Float4 two = Splat(2.0f);
+            Vector3x4 t = Cross(q.X, q.Y, q.Z, v);
+            t = {Mul(t.X, two), Mul(t.Y, two), Mul(t.Z, two)};
+            const Vector3x4 u = Cross(q.X, q.Y, q.Z, t);
+            return {Add(Add(v.X, Mul(q.W, t.X)), u.X), Add(Add(v.Y, Mul(q.W, t.Y)), u.Y), Add(Add(v.Z, Mul(q.W, t.Z)), u.Z)};
+        }
+
+        inline Vector3x4 AddVector(const Vector3x4& a, const Vector3x4& b) {
+            return {Add(a.X, b.X), Add(a.Y, b.Y), Add(a.Z, b.Z)};
+        }
+
+        // Stores row `row` of the 4x4 matrices of four lanes, given the four elements of the row for each lane.
+        inline void StoreRow(float* matrices, size_t stride, size_t row, Float4 c0, Float4 c1, Float4 c2, Float4 c3) {
+            Transpose(c0, c1, c2, c3);
+            Store(matrices + row * 4, c0);
+            Store(matrices + stride + row * 4, c1);
+            Store(matrices + 2 * stride + row * 4, c2);
+            Store(matrices + 3 * stride + row * 4, c3);
+        }
+
+        // atan(x) for x >= 0, with the range reduction and polynomial of the Cephes atanf (relative error about 1e-7).
+        inline Float4 ArcTangent(Float4 x) {
+            const Mask4 large = Less(Splat(2.414213562373095f), x);
+            const Mask4 medium = Less(Splat(0.4142135623730950f), x);
+
+            const Float4 one = Splat(1.0f);
+            Float4 offset = Select(medium, Splat(0.7853981633974483f), Splat(0.0f));
+            offset = Select(large, Splat(1.5707963267948966f), offset);
+            Float4 reduced = Select(medium, Div(Sub(x, one), Add(x, one)), x);
+            reduced = Select(large, Div(Splat(-1.0f), x), reduced);
+
+            const Float4 z = Mul(reduced, reduced);
+            Float4 p = Sub(Mul(Splat(8.05374449538e-2f), z), Splat(1.38776856032e-1f));
+            p = Add(Mul(p, z), Splat(1.99777106478e-1f));
+            p = Sub(Mul(p, z), Splat(3.33329491539e-1f));
+            return Add(offset, Add(Mul(Mul(p, z), reduced), reduced));
+        }
+
+        // sin(x) for x in [0, pi / 2], the Taylor series up to x^11 (error below 1e-7).
+        inline Float4 Sine(Float4 x) {
+            const Float4 z = Mul(x, x);
+            Float4 p = Splat(-2.5052108385e-8f);
+            p = Add(Mul(p, z), Splat(2.7557319224e-6f));
+            p = Add(Mul(p, z), Splat(-1.9841269841e-4f));
+            p = Add(Mul(p, z), Splat(8.3333333333e-3f));
+            p = Add(Mul(p, z), Splat(-1.6666666667e-1f));
+            return Add(Mul(Mul(p, z), x), x);
+        }
+#endif
+    } // namespace Batch::detail
+
+    namespace Batch::Scalar {
+        inline XrQuaternionf QuaternionMultiply(const XrQuaternionf& a, const XrQuaternionf& b) {
+            return {b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+                    b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+                    b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+                    b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z};
+        }
+
+        inline XrVector3f Rotate(const XrVector3f& v, const XrQuaternionf& q) {
+            // q * v * conjugate(q)
+            const XrQuaternionf conjugate = {-q.x, -q.y, -q.z, q.w};
+            const XrQuaternionf rotated = QuaternionMultiply(QuaternionMultiply(conjugate, {v.x, v.y, v.z, 0.0f}), q);
+            return {rotated.x, rotated.y, rotated.z};
+        }
+
+        inline XrPosef Multiply(const XrPosef& a, const XrPosef& b) {
+            const XrVector3f rotated = Rotate(a.position, b.orientation);
+            return {QuaternionMultiply(a.orientation, b.orientation),
+                    {rotated.x + b.position.x, rotated.y + b.position.y, rotated.z + b.position.z}};
+        }
+
+        inline XrPosef Invert(const XrPosef& pose) {
+            const XrQuaternionf orientation = {-pose.orientation.x, -pose.orientation.y, -pose.orientation.z, pose.orientation.w};
+            return {orientation, Rotate({-pose.position.x, -pose.position.y, -pose.position.z}, orientation)};
+        }
+
+        inline XrPosef Slerp(const XrPosef& a, const XrPosef& b, float alpha) {
+            // DirectX::XMQuaternionSlerp
+            const XrQuaternionf& qa = a.orientation;
+            const XrQuaternionf& qb = b.orientation;
+            float cosOmega = qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w;
+            const float sign = cosOmega < 0.0f ? -1.0f : 1.0f;
+            cosOmega *= sign;
+
+            float s0 = 1.0f - alpha;
+            float s1 = alpha;
+            if (cosOmega < 1.0f - 0.00001f) {
+                const float sinOmega = std::sqrt(1.0f - cosOmega * cosOmega);
+                const float omega = std::atan2(sinOmega, cosOmega);
+                s0 = std::sin((1.0f - alpha) * omega) / sinOmega;
+                s1 = std::sin(alpha * omega) / sinOmega;
+            }
+            s1 *= sign;
+
+            return {{qa.x * s0 + qb.x * s1, qa.y * s0 + qb.y * s1, qa.z * s0 + qb.z * s1, qa.w * s0 + qb.w * s1},
+                    {a.position.x + (b.position.x - a.position.x) * alpha,
+                     a.position.y + (b.position.y - a.position.y) * alpha,
+                     a.position.z + (b.position.z - a.position.z) * alpha}};
+        }
+
+        inline XrVector3f TransformPoint(const XrPosef& pose, const XrVector3f& point) {
+            const XrVector3f rotated = Rotate(point, pose.orientation);
+            return {rotated.x + pose.position.x, rotated.y + pose.position.y, rotated.z + pose.position.z};
+        }
+
+        inline void StoreMatrix(const XrPosef& pose, float* matrix) {
+            // DirectX::XMMatrixRotationQuaternion with the position in the last row
+            const float x = pose.orientation.x, y = pose.orientation.y, z = pose.orientation.z, w = pose.orientation.w;
+            const float values[16] = {1.0f - 2.0f * (y * y + z * z),
+                                      2.0f * (x * y + z * w),
+                                      2.0f * (x * z - y * w),
+                                      0.0f,
+                                      2.0f * (x * y - z * w),
+                                      1.0f - 2.0f * (x * x + z * z),
+                                      2.0f * (y * z + x * w),
+                                      0.0f,
+                                      2.0f * (x * z + y * w),
+                                      2.0f * (y * z - x * w),
+                                      1.0f - 2.0f * (x * x + y * y),
+                                      0.0f,
+                                      pose.position.x,
+                                      pose.position.y,
+                                      pose.position.z,
+                                      1.0f};
+            for (size_t i = 0; i < 16; ++i) {
+                matrix[i] = values[i];
+            }
+        }
+
+        inline void StoreTransposedMatrix(const XrPosef& pose, const XrVector3f& scale, float* matrix) {
+            float m[16];
+            StoreMatrix(pose, m);
+            const float s[3] = {scale.x, scale.y, scale.z};
+            for (size_t row = 0; row < 4; ++row) {
+                for (size_t column = 0; column < 4; ++column) {
+                    matrix[row * 4 + column] = column < 3 ? s[column] * m[column * 4 + row] : m[column * 4 + row];
+                }
+            }
+        }
+    } // namespace Batch::Scalar
+
+    namespace Batch {
+        inline const char* KernelName() {
+            return detail::KernelName;
+        }
+
+        inline void Multiply(const PoseBatch& a, const PoseBatch& b, PoseBatch& result) {
+            const size_t count = a.Size();
+            result.Resize(count);
+
+            size_t i = 0;
+#if defined(XR_POSE_BATCH_SIMD)
+            using namespace detail;
+            for (; i + LaneCount <= count; i += LaneCount) {
+                const Quaternionx4 qb = LoadOrientation(b, i);
+                const Vector3x4 position = AddVector(Rotate(LoadPosition(a, i), qb), LoadPosition(b, i));
+                StorePose(result, i, QuaternionMultiply(LoadOrientation(a, i), qb), position);
+            }
+#endif
+            for (; i < count; ++i) {
+                result.Set(i, Scalar::Multiply(a.Get(i), b.Get(i)));
+            }
+        }
+
+        inline void Multiply(const PoseBatch& a, const XrPosef& b, PoseBatch& result) {
+            const size_t count = a.Size();
+            result.Resize(count);
+
+            size_t i = 0;
+#if defined(XR_POSE_BATCH_SIMD)
+            using namespace detail;
+            const Quaternionx4 qb = {Splat(b.orientation.x), Splat(b.orientation.y), Splat(b.orientation.z), Splat(b.orientation.w)};
+            const Vector3x4 pb = {Splat(b.position.x), Splat(b.position.y), Splat(b.position.z)};
+            for (; i + LaneCount <= count; i += LaneCount) {
+                const Vector3x4 position = AddVector(Rotate(LoadPosition(a, i), qb), pb);
+                StorePose(result, i, QuaternionMultiply(LoadOrientation(a, i), qb), position);
+            }
+#endif
+            for (; i < count; ++i) {
+                result.Set(i, Scalar::Multiply(a.Get(i), b));
+            }
+        }
+
+        inline void Invert(const PoseBatch& poses, PoseBatch& result) {
+            const size_t count = poses.Size();
+            result.Resize(count);
+
+            size_t i = 0;
+#if defined(XR_POSE_BATCH_SIMD)
+            using namespace detail;
+            const Float4 zero = Splat(0.0f);
+            for (; i + LaneCount <= count; i += LaneCount) {
+                const Quaternionx4 q = LoadOrientation(poses, i);
+                const Quaternionx4 inverse = {Sub(zero, q.X), Sub(zero, q.Y), Sub(zero, q.Z), q.W};
+                const Vector3x4 p = LoadPosition(poses, i);
+                StorePose(result, i, inverse, Rotate({Sub(zero, p.X), Sub(zero, p.Y), Sub(zero, p.Z)}, inverse));
+            }
+#endif
+            for (; i < count; ++i) {
+                result.Set(i, Scalar::Invert(poses.Get(i)));
+            }
+        }
+
+        inline void Slerp(const PoseBatch& a, const PoseBatch& b, float alpha, PoseBatch& result) {
+            const size_t count = a.Size();
+            result.Resize(count);
+
+            size_t i = 0;
+#if defined(XR_POSE_BATCH_SIMD)
+            using namespace detail;
+            const Float4 zero = Splat(0.0f);
+            const Float4 one = Splat(1.0f);
+            const Float4 t = Splat(alpha);
+            const Float4 oneMinusT = Splat(1.0f - alpha);
+            for (; i + LaneCount <= count; i += LaneCount) {
+                const Quaternionx4 qa = LoadOrientation(a, i);
+                const Quaternionx4 qb = LoadOrientation(b, i);
+
+                // Same steps as Scalar::Slerp, with both branches computed and selected per lane.
+                Float4 cosOmega = Add(Add(Mul(qa.X, qb.X), Mul(qa.Y, qb.Y)), Add(Mul(qa.Z, qb.Z), Mul(qa.W, qb.W)));
+                const Float4 sign = Select(Less(cosOmega, zero), Splat(-1.0f), one);
+                cosOmega = Mul(cosOmega, sign);
+
+                const Mask4 distinct = Less(cosOmega, Splat(1.0f - 0.00001f));
+                const Float4 sinOmega = Sqrt(Sub(one, Mul(cosOmega, cosOmega)));
+                // atan2(sinOmega, cosOmega) with both non-negative, so omega is in [0, pi / 2]
+                const Float4 omega = ArcTangent(Div(sinOmega, cosOmega));
+                const Float4 s0 = Select(distinct, Div(Sine(Mul(oneMinusT, omega)), sinOmega), oneMinusT);
+                const Float4 s1 = Mul(Select(distinct, Div(Sine(Mul(t, omega)), sinOmega), t), sign);
+
+                const Quaternionx4 orientation = {Add(Mul(qa.X, s0), Mul(qb.X, s1)),
+                                                  Add(Mul(qa.Y, s0), Mul(qb.Y, s1)),
+                                                  Add(Mul(qa.Z, s0), Mul(qb.Z, s1)),
+                                                  Add(Mul(qa.W, s0), Mul(qb.W, s1))};
+
+                const Vector3x4 pa = LoadPosition(a, i);
+                const Vector3x4 pb = LoadPosition(b, i);
+                const Vector3x4 position = {
+                    Add(pa.X, Mul(Sub(pb.X, pa.X), t)), Add(pa.Y, Mul(Sub(pb.Y, pa.Y), t)), Add(pa.Z, Mul(Sub(pb.Z, pa.Z), t))};
+                StorePose(result, i, orientation, position);
+            }
+#endif
+            for (; i < count; ++i) {
+                result.Set(i, Scalar::Slerp(a.Get(i), b.Get(i), alpha));
+            }
+        }
+
+        inline void TransformPoints(const PoseBatch& poses, const PointBatch& points, PointBatch& result) {
+            const size_t count = poses.Size();
+            result.Resize(count);
+
+            size_t i = 0;
+#if defined(XR_POSE_BATCH_SIMD)
+            using namespace detail;
+            for (; i + LaneCount <= count; i += LaneCount) {
+                const Vector3x4 point = {Load(&points.X[i]), Load(&points.Y[i]), Load(&points.Z[i])};
+                const Vector3x4 transformed = AddVector(Rotate(point, LoadOrientation(poses, i)), LoadPosition(poses, i));
+                Store(&result.X[i], transformed.X);
+                Store(&result.Y[i], transformed.Y);
+                Store(&result.Z[i], transformed.Z);
+            }
+#endif
+            for (; i < count; ++i) {
+                result.Set(i, Scalar::TransformPoint(poses.Get(i), points.Get(i)));
+            }
+        }
+
+        inline void StoreMatrices(const PoseBatch& poses, float* matrices) {
+            const size_t count = poses.Size();
+
+            size_t i = 0;
+#if defined(XR_POSE_BATCH_SIMD)
+            using namespace detail;
+            const Float4 zero = Splat(0.0f);
+            const Float4 one = Splat(1.0f);
+            const Float4 two = Splat(2.0f);
+            for (; i + LaneCount <= count; i += LaneCount) {
+                const Quaternionx4 q = LoadOrientation(poses, i);
+                const Float4 xx = Mul(q.X, q.X), yy = Mul(q.Y, q.Y), zz = Mul(q.Z, q.Z);
+                const Float4 xy = Mul(q.X, q.Y), xz = Mul(q.X, q.Z), yz = Mul(q.Y, q.Z);
+                const Float4 xw = Mul(q.X, q.W), yw = Mul(q.Y, q.W), zw = Mul(q.Z, q.W);
+
+                float* matrix = matrices + 16 * i;
+                StoreRow(matrix, 16, 0, Sub(one, Mul(two, Add(yy, zz))), Mul(two, Add(xy, zw)), Mul(two, Sub(xz, yw)), zero);
+                StoreRow(matrix, 16, 1, Mul(two, Sub(xy, zw)), Sub(one, Mul(two, Add(xx, zz))), Mul(two, Add(yz, xw)), zero);
+                StoreRow(matrix, 16, 2, Mul(two, Add(xz, yw)), Mul(two, Sub(yz, xw)), Sub(one, Mul(two, Add(xx, yy))), zero);
+                StoreRow(matrix, 16, 3, Load(&poses.PositionX[i]), Load(&poses.PositionY[i]), Load(&poses.PositionZ[i]), one);
+            }
+#endif
+            for (; i < count; ++i) {
+                Scalar::StoreMatrix(poses.Get(i), matrices + 16 * i);
+            }
+        }
+
+        inline void StoreTransposedMatrices(const PoseBatch& poses, const PointBatch& scales, float* matrices, size_t stride) {
+            const size_t count = poses.Size();
+
+            size_t i = 0;
+#if defined(XR_POSE_BATCH_SIMD)
+            using namespace detail;
+            const Float4 zero = Splat(0.0f);
+            const Float4 one = Splat(1.0f);
+            const Float4 two = Splat(2.0f);
+            for (; i + LaneCount <= count; i += LaneCount) {
+                const Quaternionx4 q = LoadOrientation(poses, i);
+                const Float4 xx = Mul(q.X, q.X), yy = Mul(q.Y, q.Y), zz = Mul(q.Z, q.Z);
+                const Float4 xy = Mul(q.X, q.Y), xz = Mul(q.X, q.Z), yz = Mul(q.Y, q.Z);
+                const Float4 xw = Mul(q.X, q.W), yw = Mul(q.Y, q.W), zw = Mul(q.Z, q.W);
+                const Float4 sx = Load(&scales.X[i]), sy = Load(&scales.Y[i]), sz = Load(&scales.Z[i]);
+
+                float* matrix = matrices + stride * i;
+                StoreRow(matrix,
+                         stride,
+                         0,
+                         Mul(sx, Sub(one, Mul(two, Add(yy, zz)))),
+                         Mul(sy, Mul(two, Sub(xy, zw))),
+                         Mul(sz, Mul(two, Add(xz, yw))),
+                         Load(&poses.PositionX[i]));
+                StoreRow(matrix,
+                         stride,
+                         1,
+                         Mul(sx, Mul(two, Add(xy, zw))),
+                         Mul(sy, Sub(one, Mul(two, Add(xx, zz)))),
+                         Mul(sz, Mul(two, Sub(yz, xw))),
+                         Load(&poses.PositionY[i]));
+                StoreRow(matrix,
+                         stride,
+                         2,
+                         Mul(sx, Mul(two, Sub(xz, yw))),
+                         Mul(sy, Mul(two, Add(yz, xw))),
+                         Mul(sz, Sub(one, Mul(two, Add(xx, yy)))),
+                         Load(&poses.PositionZ[i]));
+                StoreRow(matrix, stride, 3, zero, zero, zero, one);
+            }
+#endif
+            for (; i < count; ++i) {
+                Scalar::StoreTransposedMatrix(poses.Get(i), scales.Get(i), matrices + stride * i);
+            }
+        }
+    } // namespace Batch
+} // namespace xr::math
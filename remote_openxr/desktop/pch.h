@@ -50,6 +50,7 @@
 #include <XrUtility/XrError.h>
 #include <XrUtility/XrHandle.h>
 #include <XrUtility/XrMath.h>
+#include <XrUtility/XrPoseBatch.h>
 #include <XrUtility/XrString.h>
 
 #include <winrt/base.h> // winrt::com_ptr